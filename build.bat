@@ -46,6 +46,12 @@ set GAME=%PROJECT:Reloaded=""%
 robocopy /mir .\src\hlsl\%GAME%\Shaders .\build\%PROJECT%\Shaders\%PROJECT%\Shaders
 robocopy /mir .\src\hlsl\%GAME%\Effects .\build\%PROJECT%\Shaders\%PROJECT%\Effects
 
+@REM Precompile the shaders into an archive when fxc (Windows SDK) is available
+where fxc >nul 2>nul
+if %ERRORLEVEL% EQU 0 (
+    python packShaders.py build --game %GAME% --fxc fxc --out "build\%PROJECT%\Shaders\%PROJECT%\Shaders.pack"
+)
+
 @REM Copy Textures
 robocopy /mir .\resource\Textures\ .\build\%PROJECT%\Textures\
 
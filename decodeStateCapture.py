@@ -0,0 +1,194 @@
+import argparse
+import struct
+import sys
+
+# Decodes a state capture written by the Develop.TraceStates setting (Test\states *.bin).
+# It replays the device calls of each frame against a shadow of the device state, reports the redundant state changes
+# of each pass (GPU profiler scope) and ranks the passes by state change cost.
+#
+#   python decodeStateCapture.py "Test/states 20260101 12.00.00.bin" [--sort cost|redundant|calls] [--states 20]
+
+HEADER = struct.Struct("<4s5I")
+EVENT = struct.Struct("<BBHIQ")
+PASS_NAME_SIZE = 64
+STATE_NAME_SIZE = 32
+RENDER_STATES_COUNT = 256
+
+EVENT_TYPES = [
+    "RenderState", "SamplerState", "Texture", "TextureStageState", "VertexShader", "PixelShader", "VertexDeclaration",
+    "FVF", "StreamSource", "StreamFrequency", "Indices", "StateBlock", "Draw", "DrawIndexed", "DrawUP", "DrawIndexedUP",
+    "PassBegin", "PassEnd", "Frame",
+]
+(RENDER_STATE, SAMPLER_STATE, TEXTURE, TEXTURE_STAGE_STATE, VERTEX_SHADER, PIXEL_SHADER, VERTEX_DECLARATION, FVF,
+ STREAM_SOURCE, STREAM_FREQUENCY, INDICES, STATE_BLOCK, DRAW, DRAW_INDEXED, DRAW_UP, DRAW_INDEXED_UP,
+ PASS_BEGIN, PASS_END, FRAME) = range(len(EVENT_TYPES))
+
+DRAWS = (DRAW, DRAW_INDEXED, DRAW_UP, DRAW_INDEXED_UP)
+
+# Relative driver cost of a state change: binding a shader revalidates the pipeline, textures and vertex formats
+# rebind resources, the fixed function states only update a register.
+COSTS = {
+    VERTEX_SHADER: 8, PIXEL_SHADER: 8,
+    TEXTURE: 4, VERTEX_DECLARATION: 4, FVF: 4,
+    STREAM_SOURCE: 2, STREAM_FREQUENCY: 2, INDICES: 2,
+    RENDER_STATE: 1, SAMPLER_STATE: 1, TEXTURE_STAGE_STATE: 1,
+}
+
+OUTSIDE_PASSES = "(outside passes)"
+
+
+class PassStats:
+    def __init__(self, name):
+        self.name = name
+        self.calls = 0          # state calls issued by the game
+        self.redundant = 0      # calls setting a state to its current value
+        self.filtered = 0       # redundant calls dropped by the device proxy
+        self.draws = 0
+        self.primitives = 0
+        self.cost = 0           # cost of the calls reaching the device
+        self.redundant_cost = 0 # cost of the redundant calls reaching the device
+
+
+def read_capture(path):
+    with open(path, "rb") as fd:
+        data = fd.read()
+
+    magic, version, frames, events_count, lost, passes_count = HEADER.unpack_from(data, 0)
+    if magic != b"TRSC":
+        sys.exit(f"{path} is not a state capture")
+    if version != 1:
+        sys.exit(f"{path}: unsupported version {version}")
+
+    offset = HEADER.size
+    passes = []
+    for i in range(passes_count):
+        passes.append(data[offset:offset + PASS_NAME_SIZE].split(b"\0", 1)[0].decode("ascii", "replace"))
+        offset += PASS_NAME_SIZE
+
+    state_names = []
+    for i in range(RENDER_STATES_COUNT):
+        state_names.append(data[offset:offset + STATE_NAME_SIZE].split(b"\0", 1)[0].decode("ascii", "replace"))
+        offset += STATE_NAME_SIZE
+
+    if len(data) < offset + events_count * EVENT.size:
+        sys.exit(f"{path} is truncated")
+    events = EVENT.iter_unpack(data[offset:offset + events_count * EVENT.size])
+    return frames, lost, passes, state_names, events
+
+
+def state_label(kind, slot, index, state_names):
+    if kind == RENDER_STATE:
+        return state_names[slot] or f"D3DRS {slot}"
+    if kind == SAMPLER_STATE:
+        return f"Sampler {slot} state {index}"
+    if kind == TEXTURE_STAGE_STATE:
+        return f"Stage {slot} state {index}"
+    if kind in (TEXTURE, STREAM_SOURCE, STREAM_FREQUENCY):
+        return f"{EVENT_TYPES[kind]} {slot}"
+    return EVENT_TYPES[kind]
+
+
+def decode(passes, state_names, events):
+    stats = {}
+    states = {}     # redundant calls per state
+    shadow = {}
+    stack = []
+
+    def current():
+        name = passes[stack[-1]] if stack else OUTSIDE_PASSES
+        if name not in stats:
+            stats[name] = PassStats(name)
+        return stats[name]
+
+    for kind, filtered, index, slot, value in events:
+        if kind == FRAME or kind == STATE_BLOCK:
+            # the proxy forgets its shadow at the frame start and when a state block is applied
+            shadow.clear()
+            if kind == FRAME:
+                stack.clear()
+            continue
+        if kind == PASS_BEGIN:
+            stack.append(slot)
+            continue
+        if kind == PASS_END:
+            if stack:
+                stack.pop()
+            continue
+
+        entry = current()
+        if kind in DRAWS:
+            entry.draws += 1
+            entry.primitives += value
+            continue
+        if kind not in COSTS:
+            continue
+
+        key = (kind, slot, index if kind != STREAM_SOURCE else 0)
+        setting = (value, index) if kind == STREAM_SOURCE else value
+        redundant = filtered or shadow.get(key) == setting
+        shadow[key] = setting
+        if kind == VERTEX_DECLARATION:
+            shadow.pop((FVF, 0, 0), None)
+        elif kind == FVF:
+            shadow.pop((VERTEX_DECLARATION, 0, 0), None)
+
+        entry.calls += 1
+        if redundant:
+            entry.redundant += 1
+            label = state_label(kind, slot, index, state_names)
+            states[label] = states.get(label, 0) + 1
+        if filtered:
+            entry.filtered += 1
+        else:
+            entry.cost += COSTS[kind]
+            if redundant:
+                entry.redundant_cost += COSTS[kind]
+
+    return list(stats.values()), states
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reports the redundant state changes of a state capture.")
+    parser.add_argument("capture")
+    parser.add_argument("--sort", choices=["cost", "redundant", "calls"], default="cost")
+    parser.add_argument("--states", type=int, default=20, help="most redundant states listed")
+    args = parser.parse_args()
+
+    frames, lost, passes, state_names, events = read_capture(args.capture)
+    stats, states = decode(passes, state_names, events)
+    frames = max(frames, 1)
+
+    print(f"{args.capture}: {frames} frames, values per frame")
+    if lost:
+        print(f"{lost} events were overwritten in the ring buffer, the first frame is partial")
+
+    sort_keys = {
+        "cost": lambda s: s.cost,
+        "redundant": lambda s: s.redundant,
+        "calls": lambda s: s.calls,
+    }
+    stats.sort(key=sort_keys[args.sort], reverse=True)
+
+    print()
+    print(f"{'Pass':<32} {'Cost':>9} {'Calls':>9} {'Redundant':>10} {'Filtered':>9} {'Left':>7} {'Draws':>7} {'Primitives':>11}")
+    total = PassStats("Total")
+    for s in stats + [total]:
+        if s is not total:
+            for field in ("cost", "calls", "redundant", "filtered", "redundant_cost", "draws", "primitives"):
+                setattr(total, field, getattr(total, field) + getattr(s, field))
+        share = f"{100.0 * s.redundant / s.calls:5.1f}%" if s.calls else "     -"
+        print(f"{s.name[:32]:<32} {s.cost / frames:9.0f} {s.calls / frames:9.0f} {s.redundant / frames:10.0f} "
+              f"{s.filtered / frames:9.0f} {s.redundant_cost / frames:7.0f} {s.draws / frames:7.0f} {s.primitives / frames:11.0f}  {share} redundant")
+
+    print()
+    print("Cost: weighted state calls reaching the device. Left: cost of the redundant calls the proxy could not filter.")
+
+    if args.states:
+        print()
+        print(f"{'State':<40} {'Redundant':>10}")
+        for label, count in sorted(states.items(), key=lambda item: item[1], reverse=True)[:args.states]:
+            print(f"{label:<40} {count / frames:10.0f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,401 @@
+import argparse
+import os
+import re
+import shlex
+import struct
+import subprocess
+import sys
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+
+# Builds the precompiled shader archive (Data\Shaders\<Game>Reloaded\Shaders.pack) memory mapped by ShaderArchive at runtime,
+# so that the shaders and effects are not compiled on the first launch.
+#
+#   python packShaders.py list --game NewVegas
+#       Enumerates every shader template permutation (generic, Exteriors and Interiors), standalone shader and effect.
+#   python packShaders.py build --game NewVegas --fxc "fxc.exe" --out build/Shaders.pack
+#       Compiles the permutations with fxc (Windows SDK; on Linux "wine fxc.exe") and packs them.
+#   python packShaders.py pack-cache --game NewVegas --game-folder <game folder> --out Shaders.pack
+#       Packs the loose cache written by the game itself, no compiler needed.
+#
+# list and build report the permutations sharing a program: same source, profile and defines (so the same preprocessed
+# code), and for build the same preprocessed code or binary. Such permutations are compiled once here and by the game.
+#
+# Enumeration and packing only use the standard library and run on any platform.
+
+FNV_OFFSET = 14695981039346656037
+FNV_PRIME = 1099511628211
+MASK = (1 << 64) - 1
+
+ARCHIVE_VERSION = 1
+HEADER = struct.Struct("<4s5I")
+ENTRY = struct.Struct("<Q6I")
+FILE = struct.Struct("<QII")
+
+SUB_PATHS = ["", "Exteriors\\", "Interiors\\"]
+TEMPLATE_LINE = re.compile(r'^\s*\{\s*"([^"]+)"\s*,\s*ShaderTemplate\s*\{\s*"([^"]+)"\s*,(.*)$')
+MACRO = re.compile(r'\{\s*"([^"]*)"\s*,\s*"([^"]*)"\s*\}')
+
+REPO = os.path.dirname(os.path.abspath(__file__))
+
+
+# Same hashes as ShaderCache (FNV-1a, strings hashed with their terminator).
+def fnv(data, seed=FNV_OFFSET):
+    result = seed
+    for byte in data:
+        result ^= byte
+        result = (result * FNV_PRIME) & MASK
+    return result
+
+
+def hash_string(text, seed):
+    return fnv(b"\0" if text is None else text.encode("ascii") + b"\0", seed)
+
+
+def hash_config(source_path, template_name, macros, profile):
+    result = hash_string(source_path, FNV_OFFSET)
+    result = hash_string(template_name, result)
+    result = hash_string(profile, result)
+    for name, definition in macros:
+        result = hash_string(name, result)
+        result = hash_string(definition, result)
+    return result
+
+
+class Permutation:
+    def __init__(self, name, sub_path, source, compiled, template, macros, profile):
+        self.name = name
+        self.sub_path = sub_path
+        self.source = source        # game relative paths, as built by ShaderRecord::GetShaderPaths and EffectRecord::GetEffectPaths
+        self.compiled = compiled
+        self.template = template
+        self.macros = macros
+        self.profile = profile
+        self.key = hash_string(compiled, hash_config(source, template, macros, profile))
+
+
+class Game:
+    """Maps the game relative paths to a folder holding the Shaders and Effects folders."""
+
+    def __init__(self, root, prefix):
+        self.root = root
+        self.prefix = prefix
+
+    def local(self, path):
+        relative = path[len(self.prefix):] if path.startswith(self.prefix) else path
+        return resolve(os.path.join(self.root, *relative.replace("\\", "/").split("/")))
+
+
+def resolve(path):
+    """Finds a path case insensitively, like the game does on Windows."""
+    path = os.path.normpath(path)
+    if os.path.exists(path):
+        return path
+    parent, name = os.path.split(path)
+    if not parent or parent == path:
+        return path
+    parent = resolve(parent)
+    if os.path.isdir(parent):
+        for entry in os.listdir(parent):
+            if entry.lower() == name.lower():
+                return os.path.join(parent, entry)
+    return os.path.join(parent, name)
+
+
+def parse_templates(folder):
+    """Reads the ShaderCollection::Templates() maps of the effect headers."""
+    templates = {}
+    for file_name in sorted(os.listdir(folder)):
+        if not file_name.endswith(".h"):
+            continue
+        with open(os.path.join(folder, file_name), encoding="latin-1") as fd:
+            for line in fd:
+                match = TEMPLATE_LINE.match(line)
+                if match:
+                    templates[match.group(1)] = (match.group(2), MACRO.findall(match.group(3)))
+    return templates
+
+
+def get_profile(name):
+    if ".vso" in name:
+        return "vs_3_0"
+    if ".pso" in name:
+        return "ps_3_0"
+    return ""
+
+
+def enumerate_permutations(game, templates, reversed_depth):
+    shaders = game.prefix + "Shaders\\"
+    effects = game.prefix + "Effects\\"
+    variants = {"off": [False], "on": [True], "both": [False, True]}[reversed_depth]
+    permutations = []
+
+    def add_shader(name, sub_path, template, macros):
+        source = shaders + sub_path + (template or name) + ".hlsl"
+        if not os.path.isfile(game.local(source)):
+            return
+        compiled = shaders + "Cache\\" + sub_path + name
+        for reversed in variants:
+            defines = macros + [("REVERSED_DEPTH", "")] if reversed else macros
+            permutations.append(Permutation(name, sub_path, source, compiled, template, defines, get_profile(name)))
+
+    for sub_path in SUB_PATHS:
+        for name, (template, macros) in sorted(templates.items()):
+            add_shader(name, sub_path, template, macros)
+
+    # shaders without template, in the shaders folder and its subfolders (Bink, Shadows, Exteriors, Interiors)
+    root = game.local(shaders)
+    for folder, sub_folders, files in os.walk(root):
+        sub_folders[:] = [f for f in sub_folders if f.lower() not in ("cache", "includes")]
+        relative = os.path.relpath(folder, root)
+        sub_path = "" if relative == "." else relative.replace(os.sep, "\\") + "\\"
+        for file_name in sorted(files):
+            if not (file_name.endswith(".vso.hlsl") or file_name.endswith(".pso.hlsl")):
+                continue
+            name = file_name[:-len(".hlsl")]
+            if name in templates and sub_path in SUB_PATHS:
+                continue  # the game uses the template
+            add_shader(name, sub_path, None, [])
+
+    effects_folder = game.local(effects)
+    if os.path.isdir(effects_folder):
+        for file_name in sorted(os.listdir(effects_folder)):
+            if file_name.endswith(".fx.hlsl"):
+                name = file_name[:-len(".fx.hlsl")]
+                permutations.append(Permutation(name, "", effects + file_name, effects + "Cache\\" + name + ".fx", None, [], "fx_2_0"))
+
+    return permutations
+
+
+def get_includes(game, source):
+    """Same walk as ShaderCache::GetIncludes: the source and every file it includes, from the including folder then the source folder."""
+    root = source[:max(source.rfind("\\"), source.rfind("/")) + 1]
+    includes = []
+    pending = [source]
+    while pending:
+        path = pending.pop()
+        if any(other.lower() == path.lower() for other in includes):
+            continue
+        includes.append(path)
+
+        local = game.local(path)
+        if not os.path.isfile(local):
+            continue
+        folder = path[:max(path.rfind("\\"), path.rfind("/")) + 1]
+        with open(local, encoding="latin-1") as fd:
+            for line in fd:
+                directive = line.find("#include")
+                if directive < 0:
+                    continue
+                start = line.find('"', directive)
+                end = line.find('"', start + 1)
+                if start < 0 or end < 0:
+                    continue
+                name = line[start + 1:end]
+                if os.path.isfile(game.local(folder + name)):
+                    pending.append(folder + name)
+                elif os.path.isfile(game.local(root + name)):
+                    pending.append(root + name)
+    return includes
+
+
+def hash_dependencies(game, source, hashes):
+    dependencies = []
+    for path in get_includes(game, source):
+        local = game.local(path)
+        if not os.path.isfile(local):
+            continue
+        if path not in hashes:
+            with open(local, "rb") as fd:
+                hashes[path] = fnv(fd.read())
+        dependencies.append((path, hashes[path]))
+    return dependencies
+
+
+def write_archive(path, items):
+    """items: (key, preprocessed source, binary, [(path, hash)]). Identical blobs are stored once."""
+    items = sorted(items, key=lambda item: item[0])
+    files = {}
+    dependencies = []
+    for key, source, binary, item_dependencies in items:
+        for dependency in item_dependencies:
+            files.setdefault(dependency, len(files))
+
+    data_offset = HEADER.size + len(items) * ENTRY.size + len(files) * FILE.size + 4 * sum(len(item[3]) for item in items)
+    data = bytearray()
+    blobs = {}
+
+    def store(blob, terminated=False):
+        if blob in blobs:
+            return blobs[blob]
+        while (data_offset + len(data)) % 4:
+            data.append(0)
+        offset = data_offset + len(data)
+        data.extend(blob + (b"\0" if terminated else b""))
+        blobs[blob] = offset
+        return offset
+
+    file_records = []
+    for (file_path, file_hash), index in sorted(files.items(), key=lambda item: item[1]):
+        encoded = file_path.encode("ascii")
+        file_records.append(FILE.pack(file_hash, store(encoded, True), len(encoded)))
+
+    entry_records = []
+    for key, source, binary, item_dependencies in items:
+        first = len(dependencies)
+        dependencies.extend(files[dependency] for dependency in item_dependencies)
+        entry_records.append(ENTRY.pack(key, store(source), len(source), store(binary), len(binary), first, len(item_dependencies)))
+
+    with open(path, "wb") as fd:
+        fd.write(HEADER.pack(b"TRSP", ARCHIVE_VERSION, len(items), len(files), len(dependencies), 0))
+        fd.write(b"".join(entry_records))
+        fd.write(b"".join(file_records))
+        fd.write(struct.pack(f"<{len(dependencies)}I", *dependencies))
+        fd.write(data)
+        size = fd.tell()
+    print(f"{path}: {len(items)} entries, {len(files)} source files, {size} bytes")
+
+
+def compile_permutation(game, fxc, permutation, folder):
+    """Preprocesses and compiles a permutation like the game does, returns (source, binary) or None."""
+    command = shlex.split(fxc)
+    wine = os.path.basename(command[0]).lower() == "wine"
+
+    def file_argument(path):
+        if not wine:
+            return path
+        return subprocess.run(["winepath", "-w", path], capture_output=True, text=True).stdout.strip() or path
+
+    base = os.path.join(folder, f"{permutation.key:016x}")
+    defines = []
+    for name, definition in permutation.macros:
+        defines += ["/D", f"{name}={definition}"]
+    source = file_argument(game.local(permutation.source))
+    preprocess = command + ["/nologo", "/P", file_argument(base + ".hlsl")] + defines + [source]
+    build = command + ["/nologo", "/T", permutation.profile, "/Fo", file_argument(base + ".bin")] + defines + [source]
+    if permutation.profile != "fx_2_0":
+        build[len(command) + 3:len(command) + 3] = ["/E", "main"]
+
+    for step in (preprocess, build):
+        result = subprocess.run(step, capture_output=True, text=True)
+        if result.returncode:
+            print(f"{permutation.compiled} failed:\n{result.stdout}{result.stderr}", file=sys.stderr)
+            return None
+    with open(base + ".hlsl", "rb") as fd:
+        preprocessed = fd.read()
+    with open(base + ".bin", "rb") as fd:
+        binary = fd.read()
+    return preprocessed, binary
+
+
+def program_key(permutation):
+    """Permutations with the same key preprocess to the same code, the defines order doesn't matter."""
+    return permutation.source, permutation.profile, tuple(sorted(permutation.macros))
+
+
+def group_permutations(permutations, key):
+    groups = {}
+    for permutation in permutations:
+        groups.setdefault(key(permutation), []).append(permutation)
+    return list(groups.values())
+
+
+def command_list(game, args):
+    permutations = enumerate_permutations(game, parse_templates(args.templates), args.reversed_depth)
+    for permutation in permutations:
+        defines = " ".join(f"{name}={definition}" if definition else name for name, definition in permutation.macros)
+        print(f"{permutation.key:016x} {permutation.profile:7} {permutation.compiled} <- {permutation.source} {defines}")
+    groups = group_permutations(permutations, program_key)
+    for group in groups:
+        if len(group) > 1:
+            print("identical: " + ", ".join(permutation.compiled for permutation in group))
+    print(f"{len(permutations)} permutations, {len(groups)} unique programs")
+
+
+def command_build(game, args):
+    permutations = enumerate_permutations(game, parse_templates(args.templates), args.reversed_depth)
+    groups = group_permutations(permutations, program_key)
+    hashes = {}
+    items = []
+    failed = 0
+    with tempfile.TemporaryDirectory() as folder, ThreadPoolExecutor(args.jobs) as pool:
+        # a group is compiled once, its permutations get entries sharing the blobs in the archive
+        results = pool.map(lambda group: compile_permutation(game, args.fxc, group[0], folder), groups)
+        for group, result in zip(groups, results):
+            if not result:
+                failed += len(group)
+                continue
+            for permutation in group:
+                items.append((permutation.key, result[0], result[1], hash_dependencies(game, permutation.source, hashes)))
+    write_archive(args.out, items)
+    print(f"{len(permutations)} permutations, {len(groups)} compiled, "
+          f"{len(set(item[1] for item in items))} unique preprocessed sources, {len(set(item[2] for item in items))} unique binaries")
+    if failed:
+        sys.exit(f"{failed} permutations failed to compile")
+
+
+def command_pack_cache(game, args):
+    """Packs the entries of the game cache indexes whose sources are unchanged."""
+    items = []
+    hashes = {}
+    for folder in ("Shaders", "Effects"):
+        index = game.local(f"Data\\Shaders\\{args.game}Reloaded\\{folder}\\Cache\\CacheIndex.txt")
+        if not os.path.isfile(index):
+            continue
+        entries = []
+        with open(index) as fd:
+            for line in fd:
+                line = line.rstrip("\r\n")
+                if line.startswith("E "):
+                    config_hash, key = line[2:].split(" ", 1)
+                    entries.append((key, int(config_hash, 16), []))
+                elif line.startswith("D ") and entries:
+                    write_time, file_hash, path = line[2:].split(" ", 2)
+                    entries[-1][2].append((path, int(file_hash, 16)))
+
+        for compiled, config_hash, dependencies in entries:
+            stale = False
+            for path, file_hash in dependencies:
+                local = game.local(path)
+                if path not in hashes and os.path.isfile(local):
+                    with open(local, "rb") as fd:
+                        hashes[path] = fnv(fd.read())
+                stale |= hashes.get(path) != file_hash
+            binary_path = game.local(compiled)
+            source_path = game.local(compiled + ".hlsl")
+            if stale or not os.path.isfile(binary_path) or not os.path.isfile(source_path):
+                print(f"{compiled} is outdated, skipped", file=sys.stderr)
+                continue
+            with open(source_path, "rb") as fd:
+                source = fd.read()
+            with open(binary_path, "rb") as fd:
+                binary = fd.read()
+            items.append((hash_string(compiled, config_hash), source, binary, dependencies))
+    write_archive(args.out, items)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Builds the precompiled shader archive.")
+    parser.add_argument("command", choices=["list", "build", "pack-cache"])
+    parser.add_argument("--game", default="NewVegas", choices=["NewVegas", "Oblivion"])
+    parser.add_argument("--source", help="folder holding the Shaders and Effects folders, default src/hlsl/<game>")
+    parser.add_argument("--game-folder", help="game folder holding Data, for pack-cache")
+    parser.add_argument("--templates", default=os.path.join(REPO, "src", "effects"), help="headers declaring the shader templates")
+    parser.add_argument("--reversed-depth", choices=["off", "on", "both"], default="both", help="REVERSED_DEPTH variants of the shaders")
+    parser.add_argument("--fxc", default="fxc.exe", help="compiler command, e.g. \"wine fxc.exe\"")
+    parser.add_argument("--out", default="Shaders.pack")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count())
+    args = parser.parse_args()
+
+    if args.command == "pack-cache":
+        if not args.game_folder:
+            sys.exit("pack-cache needs --game-folder")
+        command_pack_cache(Game(args.game_folder, ""), args)  # the cache index paths are relative to the game folder
+        return
+
+    game = Game(args.source or os.path.join(REPO, "src", "hlsl", args.game), f"Data\\Shaders\\{args.game}Reloaded\\")
+    {"list": command_list, "build": command_build}[args.command](game, args)
+
+
+if __name__ == "__main__":
+    main()
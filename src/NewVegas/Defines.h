@@ -5,6 +5,7 @@
 #define DefaultsSettingsFile "\\Data\\NVSE\\Plugins\\NewVegasReloaded.dll.defaults.toml"
 #define ShadersPath "Data\\Shaders\\NewVegasReloaded\\Shaders\\"
 #define EffectsPath "Data\\Shaders\\NewVegasReloaded\\Effects\\"
+#define ShaderArchivePath "Data\\Shaders\\NewVegasReloaded\\Shaders.pack"
 #define RenderStateArgs 0, 0
 #define TerrainShadersNames "SLS2002.vso SLS2003.pso SLS2006.pso SLS2080.vso SLS2082.pso SLS2100.vso SLS2092.pso SLS2096.pso SLS2100.pso SLS2104.pso SLS2108.pso SLS2112.pso SLS2116.pso SLS2120.pso SLS2124.pso SLS2128.pso SLS2132.pso SLS2136.pso SLS2140.pso SLS2144.pso"
 #define BloodShaders ""
@@ -26,6 +26,8 @@
 #include "../lib/Bink/bink.h"
 #include "../Base/Logger.h"
 #include "../Base/Types.h"
+#include "../Base/TraceRecorder.h"
+#include "../Base/StateCapture.h"
 #include "../Base/SafeWrite.h"
 #include "../Base/PluginVersion.h"
 #include "..//Base/Utils.h"
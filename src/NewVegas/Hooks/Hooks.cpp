@@ -1,4 +1,5 @@
 #include "Hooks.h"
+#include "../../core/Device/Hook.h"
 
 void AttachHooks() {
 
@@ -71,6 +72,7 @@ void AttachHooks() {
 	SafeWriteCall(0x9BB158, (UInt32)MuzzleLightCullingFix);
 	SafeWriteCall(0x879061, (UInt32)CreateSaveTextureHook); // Fixes image corruption in save screenshots when using DXVK with the HDR mod 
 
+	AttachDeviceHooks(SettingsMain->Main.FilterDeviceStates);
 	if (TheSettingManager->SettingsMain.Main.ReplaceIntro) SafeWriteJump(Jumpers::SetTileShaderConstants::Hook, (UInt32)SetTileShaderConstantsHook);
 
 	if (TheSettingManager->SettingsMain.Main.RemovePrecipitations) {
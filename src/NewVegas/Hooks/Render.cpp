@@ -8,6 +8,12 @@ void __fastcall RenderHook(Main* This, UInt32 edx, BSRenderedTexture* RenderedTe
 	
 	SettingsMainStruct* SettingsMain = &TheSettingManager->SettingsMain;
 
+	TheRenderManager->UpdateTraceCapture();
+	TraceZone Zone("Frame");
+
+	TheTextureManager->CommitFileTextures();
+	TheTextureManager->UpdateTargetsBudget();
+
 	TheFrameRateManager->UpdatePerformance();
 	TheCameraManager->SetSceneGraph();
 	TheRenderManager->UpdateSceneCameraData();
@@ -15,7 +21,12 @@ void __fastcall RenderHook(Main* This, UInt32 edx, BSRenderedTexture* RenderedTe
 
 	TheShaderManager->UpdateConstants();
 	//if (SettingsMain->Develop.TraceShaders && InterfaceManager->IsActive(Menu::MenuType::kMenuType_None) && Global->OnKeyDown(SettingsMain->Develop.TraceShaders) && DWNode::Get() == NULL) DWNode::Create();
+	TheShaderManager->Profiler.BeginFrame();
 	(*Render)(This, RenderedTexture, Arg2, Arg3);
+	TheShaderManager->Profiler.EndFrame();
+
+	// the shaders trace key also prints the GPU timings of the effects, shadow maps and passes
+	if (SettingsMain->Develop.DebugMode && !InterfaceManager->IsActive(Menu::MenuType::kMenuType_Console) && Global->OnKeyDown(SettingsMain->Develop.TraceShaders)) TheShaderManager->Profiler.LogTimings();
 
 }
 
@@ -192,7 +203,7 @@ void __cdecl ProcessImageSpaceShadersHook(NiDX9Renderer* Renderer, BSRenderedTex
 
 			// run Vulkan compute pass
 
-			Logger::Log("Running Test vulkan compute");
+			Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "Running Test vulkan compute");
 			TheVulkanTestShader->RunCompute(GameSurface);
 			// run Vulkan compute pass
 		}
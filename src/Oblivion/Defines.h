@@ -5,6 +5,7 @@
 #define FastMMFile "\\Data\\OBSE\\Plugins\\OblivionReloadedFastMM.dll"
 #define ShadersPath "Data\\Shaders\\OblivionReloaded\\Shaders\\"
 #define EffectsPath "Data\\Shaders\\OblivionReloaded\\Effects\\"
+#define ShaderArchivePath "Data\\Shaders\\OblivionReloaded\\Shaders.pack"
 #define AnimString "_OR_"
 #define RenderStateArgs 0
 #define kFormType_MoveableStatic kFormType_Stat
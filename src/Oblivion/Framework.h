@@ -24,6 +24,8 @@
 #include "../../lib/Nvidia/nvapi.h"
 #include "../../src/base/Logger.h"
 #include "../../src/base/Types.h"
+#include "../../src/base/TraceRecorder.h"
+#include "../../src/base/StateCapture.h"
 #include "../../src/base/SafeWrite.h"
 #include "../../src/base/PluginVersion.h"
 #include "Plugin.h"
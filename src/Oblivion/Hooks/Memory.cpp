@@ -22,7 +22,7 @@ HRESULT __stdcall CreateTextureFromFileInMemory(LPDIRECT3DDEVICE9 pDevice, LPCVO
 
 char (__thiscall* LoadTextureFile)(NiDX9SourceTextureData*, char*, NiDX9Renderer*, UInt32*) = (char (__thiscall*)(NiDX9SourceTextureData*, char*, NiDX9Renderer*, UInt32*)) Hooks::LoadTextureData;
 char __fastcall LoadTextureFileHook(NiDX9SourceTextureData *This, UInt32 edx, char *Src, NiDX9Renderer *a5, UInt32 *a6) {
-    Logger::Log("%s", Src);
+    Logger::Log(Logger::CategoryTexture, Logger::LevelDebug, "%s", Src);
     return (*LoadTextureFile)(This, Src,a5,a6);
 }
 
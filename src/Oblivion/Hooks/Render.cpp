@@ -5,6 +5,12 @@ void __fastcall RenderHook(Main* This, UInt32 edx, BSRenderedTexture* RenderedTe
 	
 	SettingsMainStruct* SettingsMain = &TheSettingManager->SettingsMain;
 	
+	TheRenderManager->UpdateTraceCapture();
+	TraceZone Zone("Frame");
+
+	TheTextureManager->CommitFileTextures();
+	TheTextureManager->UpdateTargetsBudget();
+
 	TheFrameRateManager->UpdatePerformance();
 	TheCameraManager->SetSceneGraph();
 	TheShaderManager->UpdateConstants();
@@ -12,7 +18,12 @@ void __fastcall RenderHook(Main* This, UInt32 edx, BSRenderedTexture* RenderedTe
 	if (SettingsMain->OcclusionCulling.Enabled) TheOcclusionManager->PerformOcclusionCulling();
 	if(TheRenderManager->BackBuffer) TheRenderManager->defaultRTGroup->RenderTargets[0]->data->Surface = TheRenderManager->defaultRTGroup->RenderTargets[1]->data->Surface;
 	if (SettingsMain->Develop.TraceShaders && InterfaceManager->IsActive(Menu::MenuType::kMenuType_None) && Global->OnKeyDown(SettingsMain->Develop.TraceShaders) && DWNode::Get() == NULL) DWNode::Create();
+	TheShaderManager->Profiler.BeginFrame();
 	(*Render)(This, RenderedTexture);
+	TheShaderManager->Profiler.EndFrame();
+
+	// the shaders trace key also prints the GPU timings of the effects, shadow maps and passes
+	if (SettingsMain->Develop.DebugMode && !InterfaceManager->IsActive(Menu::MenuType::kMenuType_Console) && Global->OnKeyDown(SettingsMain->Develop.TraceShaders)) TheShaderManager->Profiler.LogTimings();
 
 }
 
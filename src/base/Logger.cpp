@@ -1,6 +1,20 @@
 #include "Logger.h"
+#include "TraceRecorder.h"
 //char	Logger::MessageBuffer[8192];
 FILE*	Logger::LogFile;
+std::atomic<UInt32>	Logger::OverflowCount;
+std::atomic<UInt32>	Logger::SuppressedCount;
+Logger::Entry*		Logger::Ring;
+std::atomic<UInt32>	Logger::WriteIndex;
+UInt32				Logger::ReadIndex;
+std::atomic<bool>	Logger::Draining;
+std::atomic<bool>	Logger::WriterSleeping;
+std::atomic<bool>	Logger::Stopping;
+HANDLE				Logger::WakeEvent;
+UInt8				Logger::Levels[CategoriesCount] = { LevelInfo, LevelInfo, LevelInfo };
+UInt32				Logger::RateLimit = 20;
+Logger::RateSlot	Logger::RateSlots[RateSlotsCount];
+LPTOP_LEVEL_EXCEPTION_FILTER Logger::PreviousFilter;
 
 #include<chrono>
 
@@ -8,8 +22,8 @@ FILE*	Logger::LogFile;
 //#define logperf
 
 TimeLogger::TimeLogger() {
-	start = std::chrono::system_clock::now();
-	end = std::chrono::system_clock::now();
+	start = std::chrono::steady_clock::now();
+	end = start;
 };
 
 
@@ -21,8 +35,9 @@ TimeLogger::~TimeLogger() {
 * Starts the animator by setting a target value and a duration to reach it.
 */
 float TimeLogger::LogTime(const char* Name) {
-	end = std::chrono::system_clock::now();
+	end = std::chrono::steady_clock::now();
 	std::chrono::duration<double> elapsed_seconds = (end - start) * 1000;
+	if (TraceRecorder::Recording) TraceRecorder::AddZone(Name, start, end);
 #ifdef logperf
 	Logger::Log("%s ran in %f ms", Name, elapsed_seconds);
 #endif
@@ -35,6 +50,14 @@ stateMap RENDERSTATETYPE;
 void Logger::Initialize(const char* FileName) {
 
 	LogFile = _fsopen(FileName, "w", _SH_DENYWR);
+	if (LogFile) setvbuf(LogFile, NULL, _IOFBF, 64 * 1024);
+
+	Ring = new Entry[RingSize];
+	for (UInt32 i = 0; i < RingSize; i++) Ring[i].Sequence.store(i, std::memory_order_relaxed);
+	WakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+	std::thread(&Logger::WriterLoop).detach();
+	PreviousFilter = SetUnhandledExceptionFilter(CrashHandler);
+	atexit(Shutdown);
 
 	RENDERSTATETYPE["D3DRS_ZENABLE"] = 7;
 	RENDERSTATETYPE["D3DRS_FILLMODE"] = 8;
@@ -146,14 +169,9 @@ void Logger::Log(char* Message, ...) {
 
 	va_list Args;
 
-	if (LogFile) {
-		va_start(Args, Message);
-		vfprintf_s(LogFile, Message, Args);
-		va_end(Args);
-//		fputs(MessageBuffer, LogFile);
-		fputc('\n', LogFile);
-		fflush(LogFile);
-	}
+	va_start(Args, Message);
+	Write(CategoryGeneral, LevelInfo, Message, Args);
+	va_end(Args);
 
 }
 
@@ -161,43 +179,264 @@ void Logger::Log(const char* Message, ...) {
 
 	va_list Args;
 
-	if (LogFile) {
-		va_start(Args, Message);
-		vfprintf_s(LogFile, Message, Args);
-		va_end(Args);
-//		fputs(MessageBuffer, LogFile);
-		fputc('\n', LogFile);
-		fflush(LogFile);
-	}
+	va_start(Args, Message);
+	Write(CategoryGeneral, LevelInfo, Message, Args);
+	va_end(Args);
+
+}
+
+void Logger::Log(LogCategory Category, LogLevel Level, const char* Message, ...) {
+
+	va_list Args;
+
+	va_start(Args, Message);
+	Write(Category, Level, Message, Args);
+	va_end(Args);
 
 }
 
 void Logger::Debug(char* Message, ...) {
 #ifdef debugmode
 	va_list Args;
-	if (LogFile) {
-		va_start(Args, Message);
-		vfprintf_s(LogFile, Message, Args);
-		va_end(Args);
-		//		fputs(MessageBuffer, LogFile);
-		fputc('\n', LogFile);
-		fflush(LogFile);
-	}
+	va_start(Args, Message);
+	WriteMessage(Message, Args); // debug builds log every Debug line whatever the General level
+	va_end(Args);
 #endif // debugmode
 }
 
 void Logger::Debug(const char* Message, ...) {
 #ifdef debugmode
 	va_list Args;
-	if (LogFile) {
-		va_start(Args, Message);
-		vfprintf_s(LogFile, Message, Args);
-		va_end(Args);
-		//		fputs(MessageBuffer, LogFile);
+	va_start(Args, Message);
+	WriteMessage(Message, Args); // debug builds log every Debug line whatever the General level
+	va_end(Args);
+#endif // debugmode
+}
+
+void Logger::SetLevel(LogCategory Category, UInt32 Level) {
+
+	Levels[Category] = min(Level, (UInt32)LevelDebug);
+
+}
+
+/*
+* Maximum count of identical messages logged per second, 0 disables the limit.
+*/
+void Logger::SetRateLimit(UInt32 Limit) {
+
+	RateLimit = Limit;
+
+}
+
+void Logger::Write(LogCategory Category, LogLevel Level, const char* Message, va_list Args) {
+
+	if (Level > Levels[Category]) return;
+	WriteMessage(Message, Args);
+
+}
+
+/*
+* Formats the message on the calling thread. Messages too long for an entry, messages not fitting in a full ring and all the messages
+* once the writer is stopped are written synchronously after draining the entries already published in the ring.
+*/
+void Logger::WriteMessage(const char* Message, va_list Args) {
+
+	char Buffer[EntrySize];
+	char Prefixed[EntrySize];
+	UInt32 Suppressed = 1;
+
+	if (!LogFile) return;
+
+	va_list Copy;
+	va_copy(Copy, Args);
+	int Length = vsnprintf(Buffer, EntrySize, Message, Args);
+	if (Length < 0) {
+		va_end(Copy);
+		return;
+	}
+
+	if ((UInt32)Length < EntrySize) {
+		if (RateLimit && !(Suppressed = CheckRate(Buffer, Length))) {
+			va_end(Copy);
+			return;
+		}
+		if (Suppressed > 1) {
+			Length = min(_snprintf_s(Prefixed, EntrySize, _TRUNCATE, "(%u identical messages suppressed) %s", Suppressed - 1, Buffer), (int)EntrySize - 1);
+			if (Length < 0) Length = EntrySize - 1;
+			memcpy(Buffer, Prefixed, Length);
+		}
+		if (Ring && !Stopping && Push(Buffer, Length)) {
+			va_end(Copy);
+			return;
+		}
+	}
+
+	// synchronous path, the drain lock serializes the writes with the writer thread
+	AcquireDrain(false);
+	Drain();
+	if ((UInt32)Length < EntrySize)
+		fwrite(Buffer, 1, Length, LogFile);
+	else
+		vfprintf_s(LogFile, Message, Copy);
+	fputc('\n', LogFile);
+	fflush(LogFile);
+	Draining.store(false, std::memory_order_release);
+	va_end(Copy);
+
+}
+
+/*
+* Multiple producers single consumer bounded queue: every entry has a sequence number telling whether it is free for the
+* producer at that position (Sequence == Position) or ready for the consumer (Sequence == Position + 1).
+* When the ring is full the producer wakes the writer and yields for a while, then gives up and the message is written synchronously.
+*/
+bool Logger::Push(const char* Text, UInt32 Length) {
+
+	UInt32 Position = WriteIndex.load(std::memory_order_relaxed);
+	Entry* Slot = NULL;
+	UInt32 Retries = 0;
+
+	while (true) {
+		Slot = &Ring[Position & (RingSize - 1)];
+		SInt32 Difference = (SInt32)(Slot->Sequence.load(std::memory_order_acquire) - Position);
+		if (Difference == 0) {
+			if (WriteIndex.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) break;
+		}
+		else if (Difference < 0) {
+			if (++Retries > 64) {
+				OverflowCount++;
+				return false;
+			}
+			SetEvent(WakeEvent);
+			Sleep(0);
+			Position = WriteIndex.load(std::memory_order_relaxed);
+		}
+		else {
+			Position = WriteIndex.load(std::memory_order_relaxed);
+		}
+	}
+
+	memcpy(Slot->Text, Text, Length);
+	Slot->Length = Length;
+	Slot->Sequence.store(Position + 1, std::memory_order_release);
+	if (WriterSleeping.load(std::memory_order_acquire)) SetEvent(WakeEvent);
+	return true;
+
+}
+
+/*
+* Returns 0 if the message is over the rate limit, otherwise 1 + the count of identical messages suppressed since the last one.
+* Messages are identified by a hash of their text, a collision only shares the budget of the 2 messages.
+*/
+UInt32 Logger::CheckRate(const char* Text, UInt32 Length) {
+
+	UInt32 Hash = 2166136261u;
+	for (UInt32 i = 0; i < Length; i++) Hash = (Hash ^ (UInt8)Text[i]) * 16777619u;
+
+	RateSlot* Slot = &RateSlots[Hash & (RateSlotsCount - 1)];
+	UInt32 Second = GetTickCount() / 1000;
+	bool SameHash = Slot->Hash.exchange(Hash, std::memory_order_relaxed) == Hash;
+	bool SameSecond = Slot->Second.exchange(Second, std::memory_order_relaxed) == Second;
+	if (!SameHash || !SameSecond) {
+		Slot->Count.store(1, std::memory_order_relaxed);
+		UInt32 Suppressed = Slot->Suppressed.exchange(0, std::memory_order_relaxed);
+		return SameHash ? Suppressed + 1 : 1;
+	}
+	if (Slot->Count.fetch_add(1, std::memory_order_relaxed) >= RateLimit) {
+		Slot->Suppressed.fetch_add(1, std::memory_order_relaxed);
+		SuppressedCount++;
+		return 0;
+	}
+	return 1;
+
+}
+
+/*
+* Only one thread at a time writes the file. Forced acquisitions (exit and crash) give up waiting after a while,
+* the writer thread may have been killed while holding the lock.
+*/
+bool Logger::AcquireDrain(bool Force) {
+
+	UInt32 Retries = 0;
+
+	while (Draining.exchange(true, std::memory_order_acquire)) {
+		if (Force && ++Retries > 100) return false;
+		Sleep(Force ? 1 : 0);
+	}
+	return true;
+
+}
+
+/*
+* Writes every ready entry, the caller must own the drain lock. Returns true if something was written.
+*/
+bool Logger::Drain() {
+
+	bool Written = false;
+
+	if (!Ring) return false;
+	while (true) {
+		Entry* Slot = &Ring[ReadIndex & (RingSize - 1)];
+		if (Slot->Sequence.load(std::memory_order_acquire) != ReadIndex + 1) break;
+
+		fwrite(Slot->Text, 1, Slot->Length, LogFile);
 		fputc('\n', LogFile);
-		fflush(LogFile);
+		Slot->Sequence.store(ReadIndex + RingSize, std::memory_order_release);
+		ReadIndex++;
+		Written = true;
 	}
-#endif // debugmode
+	return Written;
+
+}
+
+void Logger::WriterLoop() {
+
+	while (!Stopping) {
+		AcquireDrain(false);
+		bool Written = Drain();
+		if (Written) fflush(LogFile);
+		Draining.store(false, std::memory_order_release);
+		if (Written) continue;
+
+		// sleep until a producer wakes us up, the timeout covers the race with a push done just before the flag is set
+		WriterSleeping.store(true, std::memory_order_release);
+		WaitForSingleObject(WakeEvent, 100);
+		WriterSleeping.store(false, std::memory_order_release);
+	}
+
+}
+
+/*
+* Writes everything logged so far and flushes the file, from the calling thread.
+*/
+void Logger::Flush() {
+
+	if (!LogFile) return;
+
+	bool Owned = AcquireDrain(true);
+	Drain();
+	fflush(LogFile);
+	if (Owned) Draining.store(false, std::memory_order_release);
+
+}
+
+/*
+* Called on exit: the other threads may already be terminated (inside DllMain), so the writer is never joined,
+* the remaining entries are written by the calling thread and later messages go through the synchronous path.
+*/
+void Logger::Shutdown() {
+
+	Stopping = true;
+	Flush();
+
+}
+
+LONG WINAPI Logger::CrashHandler(EXCEPTION_POINTERS* ExceptionInfo) {
+
+	Stopping = true;
+	Flush();
+	return PreviousFilter ? PreviousFilter(ExceptionInfo) : EXCEPTION_CONTINUE_SEARCH;
+
 }
 
 NiDX9RenderState::NiRenderStateSetting* RenderStateSettings;
@@ -219,4 +458,14 @@ void Logger::TraceRenderState() {
 		}
 		if(print) Logger::Log("End");
 	}
+}
+
+/*
+* Name of a render state traced by TraceRenderState, NULL for the others.
+*/
+const char* Logger::GetRenderStateName(UInt32 State) {
+	for (const auto& [settingName, i] : RENDERSTATETYPE) {
+		if ((UInt32)i == State) return settingName;
+	}
+	return NULL;
 }
\ No newline at end of file
@@ -1,27 +1,96 @@
 #pragma once
 #include <chrono>
 #include <map>
+#include <atomic>
+#include <thread>
+#include "Types.h"
 
 typedef std::map<const char*, int> stateMap;
 
+/*
+* Messages are formatted by the calling thread and pushed in a lock free ring buffer, a writer thread drains it to the file.
+* The file is flushed when the ring is empty, on Flush, on exit and on an unhandled exception, never once per line.
+* Every category has its own level, a message is kept if its level is lower or equal. Identical messages over the rate limit
+* in the same second are dropped and counted, the count is written with the next occurrence.
+*/
 class Logger {
 public:
+	enum LogCategory {
+		CategoryGeneral,
+		CategoryTexture,
+		CategoryVulkan,
+		CategoriesCount,
+	};
+
+	enum LogLevel {
+		LevelError,
+		LevelWarning,
+		LevelInfo,
+		LevelDebug,
+	};
+
 	static void Initialize(const char* FileName);
 	static void Log(char* Message, ...);
 	static void Log(const char* Message, ...);
+	static void Log(LogCategory Category, LogLevel Level, const char* Message, ...);
 	static void Debug(char* Message, ...);
 	static void Debug(const char* Message, ...);
+	static void Flush();
+	static void Shutdown();
+	static void SetLevel(LogCategory Category, UInt32 Level);
+	static void SetRateLimit(UInt32 Limit);
 	static void TraceRenderState();
+	static const char* GetRenderStateName(UInt32 State);
 	
 //	static char			MessageBuffer[8192];
 	static FILE*		LogFile;
+	static std::atomic<UInt32> OverflowCount;	// messages written synchronously because the ring was full
+	static std::atomic<UInt32> SuppressedCount;	// messages over the rate limit
+
+private:
+	static const UInt32	RingSize = 2048;	// power of 2
+	static const UInt32	EntrySize = 508;	// text bytes per entry, longer messages are written synchronously
+	static const UInt32	RateSlotsCount = 256;
+
+	struct Entry {
+		std::atomic<UInt32>	Sequence;
+		UInt32				Length;
+		char				Text[EntrySize];
+	};
+
+	struct RateSlot {
+		std::atomic<UInt32>	Hash;
+		std::atomic<UInt32>	Second;
+		std::atomic<UInt32>	Count;
+		std::atomic<UInt32>	Suppressed;
+	};
+
+	static void			Write(LogCategory Category, LogLevel Level, const char* Message, va_list Args);
+	static void			WriteMessage(const char* Message, va_list Args);
+	static bool			Push(const char* Text, UInt32 Length);
+	static bool			Drain();
+	static bool			AcquireDrain(bool Force);
+	static UInt32		CheckRate(const char* Text, UInt32 Length);
+	static void			WriterLoop();
+	static LONG WINAPI	CrashHandler(EXCEPTION_POINTERS* ExceptionInfo);
 
+	static Entry*		Ring;
+	static std::atomic<UInt32> WriteIndex;
+	static UInt32		ReadIndex;
+	static std::atomic<bool> Draining;
+	static std::atomic<bool> WriterSleeping;
+	static std::atomic<bool> Stopping;
+	static HANDLE		WakeEvent;
+	static UInt8		Levels[CategoriesCount];
+	static UInt32		RateLimit;
+	static RateSlot		RateSlots[RateSlotsCount];
+	static LPTOP_LEVEL_EXCEPTION_FILTER PreviousFilter;
 };
 
 class TimeLogger {
 public:
-	std::chrono::system_clock::time_point start;
-	std::chrono::system_clock::time_point end;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point end;
 	TimeLogger();
 	~TimeLogger();
 
@@ -0,0 +1,125 @@
+#include "StateCapture.h"
+
+bool					StateCapture::Recording = false;
+bool					StateCapture::Armed = false;
+bool					StateCapture::Complete = false;
+StateCapture::Event*	StateCapture::Events = NULL;
+UInt64					StateCapture::Written = 0;
+UInt32					StateCapture::FramesRequested = 0;
+UInt32					StateCapture::FramesCount = 0;
+UInt32					StateCapture::PassesCount = 0;
+const char*				StateCapture::PassKeys[MaxPasses];
+char					StateCapture::PassNames[MaxPasses][NameSize];
+
+/*
+* Arms a capture of Frames frames. Recording begins at the next frame boundary so the capture holds whole frames.
+*/
+void StateCapture::Start(UInt32 Frames) {
+
+	if (!Events) Events = new Event[MaxEvents];
+	Recording = false;
+	Complete = false;
+	Written = 0;
+	FramesRequested = max(Frames, (UInt32)1);
+	FramesCount = 0;
+	PassesCount = 0;
+	Armed = true;
+	Logger::Log("State capture started for %u frames.", FramesRequested);
+
+}
+
+/*
+* Drops the capture in progress.
+*/
+void StateCapture::Stop() {
+
+	Armed = Recording = Complete = false;
+
+}
+
+/*
+* Marks the frame boundary, called when the device presents.
+*/
+void StateCapture::EndFrame() {
+
+	if (Recording && ++FramesCount == FramesRequested) {
+		Recording = false;
+		Complete = true;
+		return;
+	}
+	if (Armed) {
+		Armed = false;
+		Recording = true;
+	}
+	Add(Frame, FramesCount, 0, 0, false);
+
+}
+
+/*
+* Names are interned by pointer, the callers pass literals or names living as long as their pass.
+* Once the table is full the new names share the overflow pass, so every PassEnd still has its PassBegin.
+*/
+void StateCapture::BeginPass(const char* Name) {
+
+	if (!Recording) return;
+
+	UInt32 Named = min(PassesCount, OverflowPass);
+	UInt32 Index = 0;
+	while (Index < Named && PassKeys[Index] != Name) Index++;
+	if (Index == PassesCount) {
+		if (Index == OverflowPass) {
+			PassKeys[Index] = NULL;
+			strncpy_s(PassNames[Index], NameSize, "(other passes)", _TRUNCATE);
+		}
+		else {
+			PassKeys[Index] = Name;
+			strncpy_s(PassNames[Index], NameSize, Name ? Name : "", _TRUNCATE);
+		}
+		PassesCount++;
+	}
+	Add(PassBegin, Index, 0, 0, false);
+
+}
+
+void StateCapture::EndPass() {
+
+	Add(PassEnd, 0, 0, 0, false);
+
+}
+
+/*
+* Writes the complete capture and releases it. Returns false if the file cannot be written.
+*/
+bool StateCapture::Write(const char* FileName) {
+
+	FileHeader Header = { { 'T', 'R', 'S', 'C' }, Version, FramesCount, 0, 0, PassesCount };
+	UInt64 First = Written > MaxEvents ? Written - MaxEvents : 0;
+	char StateNames[RenderStatesCount][StateNameSize] = {};
+
+	Complete = false;
+	Header.EventsCount = Written - First;
+	Header.LostCount = First;
+	for (UInt32 i = 0; i < RenderStatesCount; i++) {
+		const char* Name = Logger::GetRenderStateName(i);
+		if (Name) strncpy_s(StateNames[i], StateNameSize, Name, _TRUNCATE);
+	}
+
+	FILE* File = NULL;
+	if (fopen_s(&File, FileName, "wb") || !File) {
+		Logger::Log("State capture: cannot write %s.", FileName);
+		return false;
+	}
+	fwrite(&Header, sizeof(Header), 1, File);
+	fwrite(PassNames, NameSize, PassesCount, File);
+	fwrite(StateNames, sizeof(StateNames), 1, File);
+	UInt32 Begin = First & (MaxEvents - 1);
+	UInt32 Head = min(Header.EventsCount, MaxEvents - Begin); // up to the end of the ring, then the wrapped part
+	fwrite(Events + Begin, sizeof(Event), Head, File);
+	fwrite(Events, sizeof(Event), Header.EventsCount - Head, File);
+	fclose(File);
+
+	if (Header.LostCount) Logger::Log("State capture: %u events lost, the ring buffer holds %u events.", Header.LostCount, MaxEvents);
+	Logger::Log("State capture written to %s: %u frames, %u events.", FileName, FramesCount, Header.EventsCount);
+	return true;
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "Types.h"
+
+/*
+* Records every state, texture, shader and draw call issued through the device proxy for a number of frames, into a ring buffer
+* allocated once: recording an event is a store and an increment. The capture is written as a binary file decoded offline by
+* decodeStateCapture.py, which reports the redundant state changes of each pass and ranks the passes by state change cost.
+* Passes are the GPU profiler scopes. Only the render thread issues device calls, so nothing is locked.
+*/
+class StateCapture {
+public:
+	enum EventType : UInt8 {
+		RenderState,		// Slot: D3DRENDERSTATETYPE
+		SamplerState,		// Slot: sampler, Index: D3DSAMPLERSTATETYPE
+		Texture,			// Slot: sampler
+		TextureStageState,	// Slot: stage, Index: D3DTEXTURESTAGESTATETYPE
+		VertexShader,
+		PixelShader,
+		VertexDeclaration,
+		FVF,
+		StreamSource,		// Slot: stream, Index: stride, Value: buffer in the high dword and offset in the low one
+		StreamFrequency,	// Slot: stream
+		Indices,
+		StateBlock,			// a state block was applied, the states it holds are unknown
+		Draw,				// Slot: D3DPRIMITIVETYPE, Value: primitives count
+		DrawIndexed,
+		DrawUP,
+		DrawIndexedUP,
+		PassBegin,			// Slot: pass name index
+		PassEnd,
+		Frame,				// Slot: frame index in the capture
+	};
+
+	static const UInt32 Version = 1;
+	static const UInt32 MaxEvents = 1 << 20;	// 16 MB, the oldest events are overwritten past it
+	static const UInt32 MaxPasses = 256;
+	static const UInt32 OverflowPass = MaxPasses - 1;	// shared by the passes named after the table is full
+	static const UInt32 NameSize = 64;
+	static const UInt32 StateNameSize = 32;
+	static const UInt32 RenderStatesCount = 256;
+
+	struct Event {
+		UInt8		Type;
+		UInt8		Filtered;	// dropped by the proxy because it would not change the state
+		UInt16		Index;
+		UInt32		Slot;
+		UInt64		Value;
+	};
+
+	/*
+	* File layout: the header, the pass names (NameSize each), the render state names (StateNameSize each, RenderStatesCount)
+	* and the events in recording order.
+	*/
+	struct FileHeader {
+		char		Magic[4];	// TRSC
+		UInt32		Version;
+		UInt32		FramesCount;
+		UInt32		EventsCount;
+		UInt32		LostCount;	// events overwritten in the ring buffer
+		UInt32		PassesCount;
+	};
+
+	static void			Start(UInt32 Frames);
+	static void			Stop();
+	static bool			Write(const char* FileName);
+	static void			BeginPass(const char* Name);
+	static void			EndPass();
+	static void			EndFrame();
+
+	static void Add(EventType Type, UInt32 Slot, UInt32 Index, UInt64 Value, bool Filtered) {
+		if (!Recording) return;
+		Event* Item = &Events[Written++ & (MaxEvents - 1)];
+		Item->Type = Type;
+		Item->Filtered = Filtered;
+		Item->Index = Index;
+		Item->Slot = Slot;
+		Item->Value = Value;
+	}
+
+	static bool			Recording;	// events are recorded
+	static bool			Armed;		// started, recording begins at the next frame boundary
+	static bool			Complete;	// all the frames are recorded, waiting to be written
+
+private:
+	static Event*		Events;		// allocated on the first capture, never freed
+	static UInt64		Written;
+	static UInt32		FramesRequested;
+	static UInt32		FramesCount;
+	static UInt32		PassesCount;
+	static const char*	PassKeys[MaxPasses];
+	static char			PassNames[MaxPasses][NameSize];
+};
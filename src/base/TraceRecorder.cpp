@@ -0,0 +1,151 @@
+#include "TraceRecorder.h"
+
+std::atomic<bool>						TraceRecorder::Recording;
+std::mutex								TraceRecorder::BuffersLock;
+std::vector<TraceRecorder::ThreadBuffer*> TraceRecorder::Buffers;
+TraceRecorder::TimePoint				TraceRecorder::Origin;
+
+/*
+* Returns the buffer of the calling thread, registering it on its first zone.
+*/
+TraceRecorder::ThreadBuffer* TraceRecorder::GetThreadBuffer() {
+
+	thread_local ThreadBuffer* Buffer = NULL;
+
+	if (!Buffer) {
+		Buffer = new ThreadBuffer();
+		Buffer->ThreadId = GetCurrentThreadId();
+		Buffer->Dropped = 0;
+		std::lock_guard<std::mutex> Guard(BuffersLock);
+		Buffers.push_back(Buffer);
+	}
+	return Buffer;
+
+}
+
+/*
+* Clears the buffers of all the threads and starts recording.
+*/
+void TraceRecorder::Start() {
+
+	std::lock_guard<std::mutex> Guard(BuffersLock);
+	for (ThreadBuffer* Buffer : Buffers) {
+		std::lock_guard<std::mutex> BufferGuard(Buffer->Lock);
+		Buffer->Events.clear();
+		Buffer->Dropped = 0;
+	}
+	Origin = std::chrono::steady_clock::now();
+	Recording = true;
+	Logger::Log("Trace capture started.");
+
+}
+
+void TraceRecorder::AddZone(const char* Name, TimePoint Begin, TimePoint End) {
+
+	if (!Recording || Begin < Origin) return; // zones opened before the capture started are ignored
+
+	ThreadBuffer* Buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> Guard(Buffer->Lock);
+	if (Buffer->Events.size() == MaxEvents) {
+		Buffer->Dropped++;
+		return;
+	}
+
+	Event& Item = Buffer->Events.emplace_back();
+	strncpy_s(Item.Name, NameSize, Name, _TRUNCATE);
+	Item.Start = std::chrono::duration_cast<std::chrono::microseconds>(Begin - Origin).count();
+	Item.Duration = std::chrono::duration_cast<std::chrono::microseconds>(End - Begin).count();
+
+}
+
+/*
+* Stops recording and writes the capture. Returns false if the file cannot be written.
+*/
+bool TraceRecorder::Stop(const char* FileName) {
+
+	std::string Output;
+	UInt32 EventsCount = 0;
+	UInt32 Dropped = 0;
+
+	Recording = false;
+
+	std::lock_guard<std::mutex> Guard(BuffersLock);
+	for (ThreadBuffer* Buffer : Buffers) Buffer->Lock.lock();
+	for (ThreadBuffer* Buffer : Buffers) {
+		EventsCount += Buffer->Events.size();
+		Dropped += Buffer->Dropped;
+	}
+	Serialize(&Output, &Buffers);
+	for (ThreadBuffer* Buffer : Buffers) Buffer->Lock.unlock();
+
+	FILE* File = NULL;
+	if (fopen_s(&File, FileName, "wb") || !File) {
+		Logger::Log("Trace capture: cannot write %s.", FileName);
+		return false;
+	}
+	fwrite(Output.data(), 1, Output.size(), File);
+	fclose(File);
+	Logger::Log("Trace capture written to %s: %u zones, %u dropped.", FileName, EventsCount, Dropped);
+	return true;
+
+}
+
+/*
+* Writes the events of the threads in the trace event format: one complete event ("ph":"X") per zone,
+* sorted by start time (ties keep the enclosing zone first), plus the thread name metadata.
+*/
+void TraceRecorder::Serialize(std::string* Output, std::vector<ThreadBuffer*>* Threads) {
+
+	char Buffer[128];
+	bool First = true;
+
+	Output->reserve(Output->size() + 64 * 1024);
+	Output->append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (ThreadBuffer* Thread : *Threads) {
+		if (Thread->Events.empty()) continue;
+
+		std::vector<Event*> Events;
+		Events.reserve(Thread->Events.size());
+		for (Event& Item : Thread->Events) Events.push_back(&Item);
+		std::stable_sort(Events.begin(), Events.end(), [](Event* a, Event* b) {
+			return a->Start < b->Start || (a->Start == b->Start && a->Duration > b->Duration);
+		});
+
+		if (!First) Output->push_back(',');
+		First = false;
+		sprintf_s(Buffer, sizeof(Buffer), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}", Thread->ThreadId, Thread->ThreadId);
+		Output->append(Buffer);
+
+		for (Event* Item : Events) {
+			Output->append(",{\"name\":\"");
+			AppendEscaped(Output, Item->Name);
+			sprintf_s(Buffer, sizeof(Buffer), "\",\"cat\":\"TESR\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}", Thread->ThreadId, Item->Start, Item->Duration);
+			Output->append(Buffer);
+		}
+	}
+	Output->append("]}\n");
+
+}
+
+void TraceRecorder::AppendEscaped(std::string* Output, const char* Text) {
+
+	char Buffer[8];
+
+	for (const char* c = Text; *c; c++) {
+		switch (*c) {
+			case '"': Output->append("\\\""); break;
+			case '\\': Output->append("\\\\"); break;
+			case '\n': Output->append("\\n"); break;
+			case '\t': Output->append("\\t"); break;
+			default:
+				if ((UInt8)*c < 0x20) {
+					sprintf_s(Buffer, sizeof(Buffer), "\\u%04x", (UInt8)*c);
+					Output->append(Buffer);
+				}
+				else {
+					Output->push_back(*c);
+				}
+		}
+	}
+
+}
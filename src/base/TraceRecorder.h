@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include "Types.h"
+
+/*
+* Records CPU zones into per thread buffers and writes them as a Chrome trace (JSON trace event format), to be opened offline
+* in chrome://tracing or ui.perfetto.dev. Every TimeLogger::LogTime is recorded as a zone, TraceZone adds scoped zones elsewhere.
+* Zones are complete events: nesting is given by their time ranges, so zones of a thread must be properly nested or sequential.
+*/
+class TraceRecorder {
+public:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	static const UInt32	NameSize = 56;
+	static const UInt32	MaxEvents = 1 << 20;	// per thread and per capture
+
+	struct Event {
+		char		Name[NameSize];
+		UInt64		Start;		// microseconds since the start of the capture
+		UInt64		Duration;
+	};
+
+	struct ThreadBuffer {
+		UInt32				ThreadId;
+		std::mutex			Lock;	// only contended when the capture stops
+		std::vector<Event>	Events;
+		UInt32				Dropped;
+	};
+
+	static void			Start();
+	static bool			Stop(const char* FileName);
+	static void			AddZone(const char* Name, TimePoint Begin, TimePoint End);
+	static void			Serialize(std::string* Output, std::vector<ThreadBuffer*>* Threads);
+	static void			AppendEscaped(std::string* Output, const char* Text);
+
+	static std::atomic<bool> Recording;
+
+private:
+	static ThreadBuffer* GetThreadBuffer();
+
+	static std::mutex	BuffersLock;
+	static std::vector<ThreadBuffer*> Buffers;	// never freed, threads may still hold them
+	static TimePoint	Origin;
+};
+
+
+/*
+* Records the zone from its construction to its destruction.
+*/
+class TraceZone {
+public:
+	TraceZone(const char* ZoneName) {
+		Name = ZoneName;
+		if (TraceRecorder::Recording) Begin = std::chrono::steady_clock::now();
+	}
+	~TraceZone() {
+		if (TraceRecorder::Recording) TraceRecorder::AddZone(Name, Begin, std::chrono::steady_clock::now());
+	}
+
+private:
+	const char*				Name;
+	TraceRecorder::TimePoint Begin;
+};
@@ -0,0 +1,105 @@
+BinkFrameQueue::BinkFrameQueue() {
+
+	Reset();
+
+}
+
+
+/*
+* Waits for a free slot, NULL once the queue is stopped.
+*/
+BinkFrameQueue::Frame* BinkFrameQueue::AcquireWrite() {
+
+	std::unique_lock<std::mutex> Guard(Lock);
+	while (true) {
+		if (Stopping) return NULL;
+		for (UInt32 i = 0; i < Slots; i++) {
+			if (States[i] == Free) {
+				States[i] = Writing;
+				return &Frames[i];
+			}
+		}
+		SlotFreed.wait(Guard);
+	}
+
+}
+
+
+void BinkFrameQueue::Publish(Frame* Item) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	States[Item - Frames] = Ready;
+
+}
+
+
+/*
+* Takes the most recent ready frame due at Now, NULL if there is none. The ready frames published before it are dropped.
+*/
+BinkFrameQueue::Frame* BinkFrameQueue::AcquireRead(double Now) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	Frame* Item = NULL;
+
+	for (UInt32 i = 0; i < Slots; i++) {
+		if (States[i] == Ready && Frames[i].Time <= Now && (!Item || Frames[i].Index > Item->Index)) Item = &Frames[i];
+	}
+	if (!Item) return NULL;
+
+	for (UInt32 i = 0; i < Slots; i++) {
+		if (States[i] == Ready && Frames[i].Index < Item->Index) {
+			States[i] = Free;
+			Dropped++;
+		}
+	}
+	States[Item - Frames] = Reading;
+	SlotFreed.notify_one();
+	return Item;
+
+}
+
+
+void BinkFrameQueue::Release(Frame* Item) {
+
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		States[Item - Frames] = Free;
+	}
+	SlotFreed.notify_one();
+
+}
+
+
+/*
+* Wakes the decoder waiting for a slot, and makes it stop.
+*/
+void BinkFrameQueue::Stop() {
+
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Stopping = true;
+	}
+	SlotFreed.notify_all();
+
+}
+
+
+/*
+* Frees all the slots for a new playback. Neither thread can hold a frame.
+*/
+void BinkFrameQueue::Reset() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	for (UInt32 i = 0; i < Slots; i++) States[i] = Free;
+	Dropped = 0;
+	Stopping = false;
+
+}
+
+
+bool BinkFrameQueue::IsStopping() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	return Stopping;
+
+}
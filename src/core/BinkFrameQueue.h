@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+
+/*
+* Decoded video frames passed from the decoding thread to the render thread.
+* The decoder writes a free slot and publishes it with its presentation time; the renderer takes the most recent frame that is due,
+* the older ready ones are dropped. The decoder waits while all the slots are ready or being read, so it runs at most Slots frames ahead.
+*/
+class BinkFrameQueue {
+public:
+	static const UInt32 Slots = 3;
+	static const UInt32 PlanesCount = 4; // Y, cR, cB, A
+
+	struct Frame {
+		std::vector<UInt8>	Planes[PlanesCount];
+		UInt32				Pitches[PlanesCount];
+		UInt32				Index;		// decoded frames before this one
+		double				Time;		// presentation time in ms from the start of the playback
+		bool				Last;		// last frame of the movie
+	};
+
+	BinkFrameQueue();
+
+	Frame*					AcquireWrite();
+	void					Publish(Frame* Item);
+	Frame*					AcquireRead(double Now);
+	void					Release(Frame* Item);
+	void					Stop();
+	void					Reset();
+	bool					IsStopping();
+	UInt32					GetDroppedCount() { return Dropped; }
+
+private:
+	enum SlotState {
+		Free,
+		Writing,
+		Ready,
+		Reading,
+	};
+
+	Frame					Frames[Slots];
+	SlotState				States[Slots];
+	std::mutex				Lock;
+	std::condition_variable	SlotFreed;
+	UInt32					Dropped;
+	bool					Stopping;
+};
@@ -2,85 +2,109 @@ void BinkManager::Initialize() {
 
 	Logger::Log("Starting the bink manager...");
 	TheBinkManager = new BinkManager();
-	
+
 	TheBinkManager->VertexDefinition[0] = { 0, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITIONT, 0 };
 	TheBinkManager->VertexDefinition[1] = { 0, (4 * sizeof(float)), D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 };
 	TheBinkManager->VertexDefinition[2] = D3DDECL_END();
 	TheRenderManager->device->CreateVertexDeclaration(TheBinkManager->VertexDefinition, &TheBinkManager->VertexShaderDeclaration);
+	TheBinkManager->CreateVertexBuffer();
 	TheBinkManager->Pixel = (ShaderRecordPixel*)ShaderRecord::LoadShader("Bink.pso", "Bink\\");
 	TheBinkManager->Bink = NULL;
 	TheBinkManager->Textures = { NULL };
 
 }
 
-void BinkManager::CreateTextures() {
-	
-	IDirect3DDevice9* Device = TheRenderManager->device;
+/*
+* The movie covers the whole screen, the quad never changes.
+*/
+void BinkManager::CreateVertexBuffer() {
+
+	POS_TC_VERTEX vertices[4];
+	void* VertexData = NULL;
+
+	vertices[0].sx = 0.0f;
+	vertices[0].sy = 0.0f;
+	vertices[0].sz = 0.0f;
+	vertices[0].rhw = 1.0f;
+	vertices[0].tu = 0.0f;
+	vertices[0].tv = 0.0f;
+	vertices[1] = vertices[0];
+	vertices[1].sx = TheRenderManager->width;
+	vertices[1].tu = 1.0f;
+	vertices[2] = vertices[0];
+	vertices[2].sy = TheRenderManager->height;
+	vertices[2].tv = 1.0f;
+	vertices[3] = vertices[1];
+	vertices[3].sy = vertices[2].sy;
+	vertices[3].tv = 1.0f;
+
+	VertexBuffer = NULL;
+	if (FAILED(TheRenderManager->device->CreateVertexBuffer(sizeof(vertices), D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &VertexBuffer, NULL))) {
+		Logger::Log("[ERROR] : Failed to create the bink vertex buffer");
+		return;
+	}
+	VertexBuffer->Lock(0, 0, &VertexData, 0);
+	memcpy(VertexData, vertices, sizeof(vertices));
+	VertexBuffer->Unlock();
+
+}
+
+/*
+* Allocates the planes Bink decodes into. It keeps predicting from them, so they stay registered for the whole playback.
+*/
+void BinkManager::CreateBuffers() {
+
 	BINKFRAMEBUFFERS* Buffers = &Textures.Buffers;
 
-    for (int i = 0; i < Buffers->TotalFrames; ++i) {
-		if (Buffers->Frames[i].YPlane.Allocate) {
-			Device->CreateTexture(Buffers->YABufferWidth, Buffers->YABufferHeight, 1, 0, D3DFMT_A8, D3DPOOL_MANAGED, &Textures.Textures[i].Y, NULL);
-			Textures.Textures[i].Ysize = Buffers->YABufferWidth * Buffers->YABufferHeight;
-		}
-		if (Buffers->Frames[i].cRPlane.Allocate) {
-			Device->CreateTexture(Buffers->cRcBBufferWidth, Buffers->cRcBBufferHeight, 1, 0, D3DFMT_A8, D3DPOOL_MANAGED, &Textures.Textures[i].cR, NULL);
-			Textures.Textures[i].cRsize = Buffers->cRcBBufferWidth * Buffers->cRcBBufferHeight;
-		}
-		if (Buffers->Frames[i].cBPlane.Allocate) {
-			Device->CreateTexture(Buffers->cRcBBufferWidth, Buffers->cRcBBufferHeight, 1, 0, D3DFMT_A8, D3DPOOL_MANAGED, &Textures.Textures[i].cB, NULL);
-			Textures.Textures[i].cBsize = Buffers->cRcBBufferWidth * Buffers->cRcBBufferHeight;
+	for (int i = 0; i < Buffers->TotalFrames; ++i) {
+		BINKPLANE* Planes = &Buffers->Frames[i].YPlane;
+		for (UInt32 p = 0; p < BinkFrameQueue::PlanesCount; p++) {
+			if (!Planes[p].Allocate) continue;
+			bool YA = p == 0 || p == 3;
+			UInt32 Pitch = ((YA ? Buffers->YABufferWidth : Buffers->cRcBBufferWidth) + 15) & ~15;
+			UInt32 Height = YA ? Buffers->YABufferHeight : Buffers->cRcBBufferHeight;
+			Planes[p].Buffer = _aligned_malloc(Pitch * Height, 16);
+			Planes[p].BufferPitch = Pitch;
 		}
-		if (Buffers->Frames[i].APlane.Allocate) {
-			Device->CreateTexture(Buffers->YABufferHeight, Buffers->YABufferHeight, 1, 0, D3DFMT_A8, D3DPOOL_MANAGED, &Textures.Textures[i].A, NULL);
-			Textures.Textures[i].Asize = Buffers->YABufferWidth * Buffers->YABufferHeight;
-		}
-    }
+	}
+	BinkRegisterFrameBuffers(Bink, Buffers);
 
 }
 
-void BinkManager::LockTextures() {
+void BinkManager::CreateTextures() {
 
-	BINKFRAMETEXTURES* bt = Textures.Textures;
-	BINKFRAMEPLANESET* bp = Textures.Buffers.Frames;
-	D3DLOCKED_RECT r;
-	UInt32 Flags = 0;
-
-	for (int i = 0; i < Textures.Buffers.TotalFrames; ++i, ++bt, ++bp) {
-		Flags = i == Textures.Buffers.FrameNum ? 0 : D3DLOCK_READONLY;
-		bt->Y->LockRect(0, &r, NULL, Flags);
-		bp->YPlane.Buffer = r.pBits;
-		bp->YPlane.BufferPitch = r.Pitch;
-		bt->cR->LockRect(0, &r, NULL, Flags);
-		bp->cRPlane.Buffer = r.pBits;
-		bp->cRPlane.BufferPitch = r.Pitch;
-		bt->cB->LockRect(0, &r, NULL, Flags);
-		bp->cBPlane.Buffer = r.pBits;
-		bp->cBPlane.BufferPitch = r.Pitch;
-		if (bt->A) {
-			bt->A->LockRect(0, &r, NULL, Flags);
-			bp->APlane.Buffer = r.pBits;
-			bp->APlane.BufferPitch = r.Pitch;
+	IDirect3DDevice9* Device = TheRenderManager->device;
+	BINKFRAMEBUFFERS* Buffers = &Textures.Buffers;
+	BINKFRAMEPLANESET* Planes = &Buffers->Frames[0];
+
+	for (UInt32 i = 0; i < TextureSetsCount; ++i) {
+		BINKFRAMETEXTURES* bt = &Textures.Textures[i];
+		Device->CreateTexture(Buffers->YABufferWidth, Buffers->YABufferHeight, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8, D3DPOOL_DEFAULT, &bt->Y, NULL);
+		bt->Ysize = Buffers->YABufferWidth * Buffers->YABufferHeight;
+		Device->CreateTexture(Buffers->cRcBBufferWidth, Buffers->cRcBBufferHeight, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8, D3DPOOL_DEFAULT, &bt->cR, NULL);
+		bt->cRsize = Buffers->cRcBBufferWidth * Buffers->cRcBBufferHeight;
+		Device->CreateTexture(Buffers->cRcBBufferWidth, Buffers->cRcBBufferHeight, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8, D3DPOOL_DEFAULT, &bt->cB, NULL);
+		bt->cBsize = Buffers->cRcBBufferWidth * Buffers->cRcBBufferHeight;
+		if (Planes->APlane.Allocate) {
+			Device->CreateTexture(Buffers->YABufferWidth, Buffers->YABufferHeight, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8, D3DPOOL_DEFAULT, &bt->A, NULL);
+			bt->Asize = Buffers->YABufferWidth * Buffers->YABufferHeight;
 		}
 	}
+	Textures.Current = 0;
+	Textures.Uploaded = false;
+	Textures.Last = false;
 
 }
 
-void BinkManager::UnlockTextures() {
-
-	BINKFRAMETEXTURES* bt = Textures.Textures;
-	BINKFRAMEPLANESET* bp = Textures.Buffers.Frames;
-
-	for (int i = 0; i < Textures.Buffers.TotalFrames; ++i, ++bt, ++bp) {
-		bt->Y->UnlockRect(0);
-		bp->YPlane.Buffer = NULL;
-		bt->cR->UnlockRect(0);
-		bp->cRPlane.Buffer = NULL;
-		bt->cB->UnlockRect(0);
-		bp->cBPlane.Buffer = NULL;
-		if (bt->A) {
-			bt->A->UnlockRect(0);
-			bp->APlane.Buffer = NULL;
+void BinkManager::FreeBuffers() {
+
+	BINKFRAMEBUFFERS* Buffers = &Textures.Buffers;
+
+	for (int i = 0; i < Buffers->TotalFrames; ++i) {
+		BINKPLANE* Planes = &Buffers->Frames[i].YPlane;
+		for (UInt32 p = 0; p < BinkFrameQueue::PlanesCount; p++) {
+			if (Planes[p].Buffer) _aligned_free(Planes[p].Buffer);
+			Planes[p].Buffer = NULL;
 		}
 	}
 
@@ -88,11 +112,10 @@ void BinkManager::UnlockTextures() {
 
 void BinkManager::FreeTextures() {
 
-	BINKFRAMETEXTURES* abt[] = { &Textures.Textures[0], &Textures.Textures[1], &Textures.DrawingTextures };
 	BINKFRAMETEXTURES* bt;
 
-	for (int i = 0; i < sizeof(abt) / sizeof(*abt); ++i) {
-		bt = abt[i];
+	for (UInt32 i = 0; i < TextureSetsCount; ++i) {
+		bt = &Textures.Textures[i];
 		if (bt->Y) { bt->Y->Release(); bt->Y = NULL; }
 		if (bt->cR) { bt->cR->Release(); bt->cR = NULL; }
 		if (bt->cB) { bt->cB->Release(); bt->cB = NULL; }
@@ -101,14 +124,90 @@ void BinkManager::FreeTextures() {
 
 }
 
+/*
+* Decoding thread: decodes each frame as soon as a slot is free and queues it with its presentation time.
+* It is the only one using the Bink handle until Close stops it.
+*/
+void BinkManager::DecodeLoop() {
+
+	double FrameDuration = 1000.0 * Bink->FrameRateDiv / max(Bink->FrameRate, 1u);
+	UInt32 Index = 0;
+
+	while (true) {
+		BinkFrameQueue::Frame* Item = Frames.AcquireWrite();
+		if (!Item) return;
+
+		TraceZone Zone("BinkManager::Decode");
+		BinkDoFrame(Bink);
+		CopyFrame(Item);
+		Item->Index = Index;
+		Item->Time = Index * FrameDuration;
+		Item->Last = Bink->FrameNum == Bink->Frames;
+		Frames.Publish(Item);
+		BinkNextFrame(Bink);
+		Index++;
+	}
+
+}
+
+/*
+* Copies the planes of the frame just decoded, Bink overwrites them with the next ones.
+*/
+void BinkManager::CopyFrame(BinkFrameQueue::Frame* Item) {
+
+	BINKFRAMEBUFFERS* Buffers = &Textures.Buffers;
+	BINKPLANE* Planes = &Buffers->Frames[Buffers->FrameNum].YPlane;
+
+	for (UInt32 p = 0; p < BinkFrameQueue::PlanesCount; p++) {
+		if (!Planes[p].Buffer) {
+			Item->Planes[p].clear();
+			continue;
+		}
+		UInt32 Height = (p == 0 || p == 3) ? Buffers->YABufferHeight : Buffers->cRcBBufferHeight;
+		Item->Planes[p].resize(Planes[p].BufferPitch * Height);
+		Item->Pitches[p] = Planes[p].BufferPitch;
+		memcpy(Item->Planes[p].data(), Planes[p].Buffer, Item->Planes[p].size());
+	}
+
+}
+
+/*
+* Uploads the frame due now, if any, into the next texture set. The discard lock gives new memory instead of waiting for the GPU to release the texture.
+*/
+void BinkManager::UploadFrame() {
+
+	double Now = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	BinkFrameQueue::Frame* Item = Frames.AcquireRead(Now);
+	if (!Item) return;
+
+	UInt32 Next = (Textures.Current + 1) % TextureSetsCount;
+	IDirect3DTexture9** Targets = &Textures.Textures[Next].Y;
+	D3DLOCKED_RECT r;
+
+	for (UInt32 p = 0; p < BinkFrameQueue::PlanesCount; p++) {
+		if (!Targets[p] || Item->Planes[p].empty()) continue;
+		if (FAILED(Targets[p]->LockRect(0, &r, NULL, D3DLOCK_DISCARD))) continue;
+
+		UInt32 Height = Item->Planes[p].size() / Item->Pitches[p];
+		UInt32 RowSize = min(Item->Pitches[p], (UInt32)r.Pitch);
+		for (UInt32 y = 0; y < Height; y++) {
+			memcpy((UInt8*)r.pBits + y * r.Pitch, Item->Planes[p].data() + y * Item->Pitches[p], RowSize);
+		}
+		Targets[p]->UnlockRect(0);
+	}
+	Textures.Current = Next;
+	Textures.Uploaded = true;
+	Textures.Last = Item->Last;
+	Frames.Release(Item);
+
+}
+
 void BinkManager::Draw() {
 
-	POS_TC_VERTEX vertices[4];
 	float ac[4];
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	NiDX9RenderState* RenderState = TheRenderManager->renderState;
-	BINKFRAMEPLANESET* bp = &Textures.Buffers.Frames[Textures.Buffers.FrameNum];
-	BINKFRAMETEXTURES* bt = &Textures.Textures[Textures.Buffers.FrameNum];
+	BINKFRAMETEXTURES* bt = &Textures.Textures[Textures.Current];
 
 	ac[0] = 1.0f;
 	ac[1] = ac[0];
@@ -131,22 +230,9 @@ void BinkManager::Draw() {
 	Device->SetPixelShader(Pixel->ShaderHandle);
 	Device->SetVertexDeclaration(VertexShaderDeclaration);
 	Device->SetPixelShaderConstantF(0, ac, 1);
-	vertices[0].sx = 0.0f;
-	vertices[0].sy = 0.0f;
-	vertices[0].sz = 0.0f;
-	vertices[0].rhw = 1.0f;
-	vertices[0].tu = 0.0f;
-	vertices[0].tv = 0.0f;
-	vertices[1] = vertices[0];
-	vertices[1].sx = TheRenderManager->width;
-	vertices[1].tu = 1.0f;
-	vertices[2] = vertices[0];
-	vertices[2].sy = TheRenderManager->height;
-	vertices[2].tv = 1.0f;
-	vertices[3] = vertices[1];
-	vertices[3].sy = vertices[2].sy;
-	vertices[3].tv = 1.0f;
-	Device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, vertices, sizeof(vertices[0]));
+	Device->SetStreamSource(0, VertexBuffer, 0, sizeof(POS_TC_VERTEX));
+	Device->DrawPrimitive(D3DPT_TRIANGLESTRIP, 0, 2);
+	Device->SetStreamSource(0, NULL, 0, 0); // as left by the DrawPrimitiveUP call the game expects
 }
 
 void BinkManager::Render(const char* MovieFilename) {
@@ -154,29 +240,26 @@ void BinkManager::Render(const char* MovieFilename) {
 	IDirect3DBaseTexture9* Texture0 = NULL;
 	IDirect3DBaseTexture9* Texture1 = NULL;
 	IDirect3DBaseTexture9* Texture2 = NULL;
-	bool NewFrame = 0;
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	char Filename[MAX_PATH] = { NULL };
 
-	if (!Bink) {
+	if (!Bink && VertexBuffer) {
 		GetCurrentDirectoryA(MAX_PATH, Filename);
 		strcat(Filename, MovieFilename);
 		Bink = BinkOpen(Filename, BINKNOFRAMEBUFFERS);
 		if (Bink) {
 			BinkSetVolume(Bink, 0, 0);
 			BinkGetFrameBuffersInfo(Bink, &Textures.Buffers);
+			CreateBuffers();
 			CreateTextures();
+			Frames.Reset();
+			Start = std::chrono::steady_clock::now();
+			Decoder = std::thread(&BinkManager::DecodeLoop, this);
 		}
 	}
 	if (Bink) {
-		if (!BinkWait(Bink)) NewFrame = 1;
-		if (NewFrame) {
-			LockTextures();
-			BinkRegisterFrameBuffers(Bink, &Textures.Buffers);
-			BinkDoFrame(Bink);
-			UnlockTextures();
-		}
-		if (Bink->FrameNum != Bink->Frames) {
+		UploadFrame();
+		if (Textures.Uploaded && !Textures.Last) {
 			Device->GetTexture(0, &Texture0);
 			Device->GetTexture(1, &Texture1);
 			Device->GetTexture(2, &Texture2);
@@ -185,7 +268,6 @@ void BinkManager::Render(const char* MovieFilename) {
 			Device->SetTexture(1, Texture1);
 			Device->SetTexture(2, Texture2);
 		}
-		if (NewFrame) BinkNextFrame(Bink);
 	}
 
 }
@@ -193,9 +275,12 @@ void BinkManager::Render(const char* MovieFilename) {
 void BinkManager::Close() {
 
 	if (Bink) {
+		Frames.Stop();
+		Decoder.join();
 		BinkClose(Bink);
 		FreeTextures();
+		FreeBuffers();
 		Bink = NULL;
 	}
 
-}
\ No newline at end of file
+}
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <thread>
+#include <chrono>
+#include "BinkFrameQueue.h"
+
+/*
+* Plays the main menu movie. Frames are decoded on a worker thread into system memory planes and queued,
+* the render thread only uploads the due frame into the next set of dynamic textures and draws it.
+*/
 class BinkManager { // Never disposed
 public:
-	
+	static const UInt32 TextureSetsCount = 3;
+
 	struct BINKFRAMETEXTURES {
 		UInt32 Ysize;
 		UInt32 cRsize;
@@ -15,11 +24,13 @@ public:
 	};
 
 	struct BINKTEXTURESET {
-		BINKFRAMEBUFFERS Buffers;
-		BINKFRAMETEXTURES Textures[BINKMAXFRAMEBUFFERS];
-		BINKFRAMETEXTURES DrawingTextures;
+		BINKFRAMEBUFFERS Buffers;								// system memory planes Bink decodes into, used by the decoding thread only
+		BINKFRAMETEXTURES Textures[TextureSetsCount];			// a frame is uploaded in the next set while the previous ones can still be in use by the GPU
+		UInt32 Current;											// set of the last uploaded frame
+		bool Uploaded;
+		bool Last;
 	};
-	
+
 	struct POS_TC_VERTEX {
 		float sx, sy, sz, rhw;
 		float tu, tv;
@@ -28,10 +39,14 @@ public:
 	static void		Initialize();
 
 private:
+	void			CreateBuffers();
 	void			CreateTextures();
-	void			LockTextures();
-	void			UnlockTextures();
+	void			FreeBuffers();
 	void			FreeTextures();
+	void			CreateVertexBuffer();
+	void			DecodeLoop();
+	void			CopyFrame(BinkFrameQueue::Frame* Item);
+	void			UploadFrame();
 	void			Draw();
 
 public:
@@ -40,8 +55,12 @@ public:
 
 	D3DVERTEXELEMENT9				VertexDefinition[3];
 	IDirect3DVertexDeclaration9*	VertexShaderDeclaration;
+	IDirect3DVertexBuffer9*			VertexBuffer;
 	ShaderRecordPixel*				Pixel;
 	HBINK							Bink;
 	BINKTEXTURESET					Textures;
+	BinkFrameQueue					Frames;
+	std::thread						Decoder;
+	std::chrono::steady_clock::time_point Start;
 
-};
\ No newline at end of file
+};
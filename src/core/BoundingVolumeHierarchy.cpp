@@ -0,0 +1,281 @@
+BoundingVolumeHierarchy::BoundingVolumeHierarchy() {
+
+	ItemsCount = 0;
+	Dirty = false;
+	Moved = false;
+	Rebuilds = 0;
+	Refits = 0;
+
+}
+
+
+/*
+* Adds an item and returns its handle. The tree is rebuilt on the next commit.
+*/
+UInt32 BoundingVolumeHierarchy::Insert(void* Data, const NiBound& Bound) {
+	UInt32 Handle;
+	if (!FreeItems.empty()) {
+		Handle = FreeItems.back();
+		FreeItems.pop_back();
+	}
+	else {
+		Handle = Items.size();
+		Items.push_back({});
+	}
+
+	Items[Handle] = { Data, Bound, true };
+	ItemsCount++;
+	Dirty = true;
+	return Handle;
+}
+
+
+void BoundingVolumeHierarchy::Remove(UInt32 Handle) {
+	if (Handle >= Items.size() || !Items[Handle].Alive) return;
+
+	Items[Handle].Alive = false;
+	Items[Handle].Data = NULL;
+	FreeItems.push_back(Handle);
+	ItemsCount--;
+	Dirty = true;
+}
+
+
+void BoundingVolumeHierarchy::Move(UInt32 Handle, const NiBound& Bound) {
+	if (Handle >= Items.size() || !Items[Handle].Alive) return;
+
+	Items[Handle].Bound = Bound;
+	Moved = true;
+}
+
+
+void BoundingVolumeHierarchy::Clear() {
+	Items.clear();
+	FreeItems.clear();
+	LeafItems.clear();
+	Nodes.clear();
+	ItemsCount = 0;
+	Dirty = false;
+	Moved = false;
+}
+
+
+void BoundingVolumeHierarchy::Commit() {
+	if (Dirty)
+		Build();
+	else if (Moved)
+		Refit();
+
+	Dirty = false;
+	Moved = false;
+}
+
+
+BoundingVolumeHierarchy::Box BoundingVolumeHierarchy::GetItemBox(UInt32 Index) {
+	NiBound& Bound = Items[Index].Bound;
+	return {
+		NiPoint3(Bound.Center.x - Bound.Radius, Bound.Center.y - Bound.Radius, Bound.Center.z - Bound.Radius),
+		NiPoint3(Bound.Center.x + Bound.Radius, Bound.Center.y + Bound.Radius, Bound.Center.z + Bound.Radius),
+	};
+}
+
+
+static void GrowBox(BoundingVolumeHierarchy::Box* Target, const BoundingVolumeHierarchy::Box& Other) {
+	Target->Min = NiPoint3(min(Target->Min.x, Other.Min.x), min(Target->Min.y, Other.Min.y), min(Target->Min.z, Other.Min.z));
+	Target->Max = NiPoint3(max(Target->Max.x, Other.Max.x), max(Target->Max.y, Other.Max.y), max(Target->Max.z, Other.Max.z));
+}
+
+
+static float GetBoxArea(const BoundingVolumeHierarchy::Box& Bounds) {
+	float x = Bounds.Max.x - Bounds.Min.x;
+	float y = Bounds.Max.y - Bounds.Min.y;
+	float z = Bounds.Max.z - Bounds.Min.z;
+	return (x * y + y * z + z * x) * 2.0f;
+}
+
+
+static const BoundingVolumeHierarchy::Box EmptyBox = { NiPoint3(FLT_MAX, FLT_MAX, FLT_MAX), NiPoint3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+
+
+void BoundingVolumeHierarchy::Build() {
+	LeafItems.clear();
+	Nodes.clear();
+	for (UInt32 i = 0; i < Items.size(); i++) {
+		if (Items[i].Alive) LeafItems.push_back(i);
+	}
+	if (LeafItems.empty()) return;
+
+	Nodes.reserve(LeafItems.size() / LeafSize * 2 + 1);
+	BuildNode(0, LeafItems.size());
+	Rebuilds++;
+}
+
+
+/*
+* Builds the subtree of the given range of leaf items. The split is chosen among the bins of the centers of the items on each axis
+* by minimizing the surface area heuristic, falling back to a median split when all the centers are in the same bin.
+*/
+UInt32 BoundingVolumeHierarchy::BuildNode(UInt32 First, UInt32 Count) {
+	UInt32 Index = Nodes.size();
+	Nodes.push_back({ EmptyBox, 0, 0, First, Count });
+
+	Box Bounds = EmptyBox;
+	Box Centers = EmptyBox;
+	for (UInt32 i = First; i < First + Count; i++) {
+		NiPoint3& Center = Items[LeafItems[i]].Bound.Center;
+		GrowBox(&Bounds, GetItemBox(LeafItems[i]));
+		GrowBox(&Centers, { Center, Center });
+	}
+	Nodes[Index].Bounds = Bounds;
+	if (Count <= LeafSize) return Index;
+
+	SInt32 BestAxis = -1;
+	UInt32 BestBin = 0;
+	float BestCost = GetBoxArea(Bounds) * Count; // cost of keeping everything in a leaf
+	float Extent[3] = { Centers.Max.x - Centers.Min.x, Centers.Max.y - Centers.Min.y, Centers.Max.z - Centers.Min.z };
+	float Origin[3] = { Centers.Min.x, Centers.Min.y, Centers.Min.z };
+
+	for (UInt32 Axis = 0; Axis < 3; Axis++) {
+		if (Extent[Axis] <= 0.0f) continue;
+
+		Box BinBounds[BinsCount];
+		UInt32 BinCount[BinsCount] = { 0 };
+		for (UInt32 b = 0; b < BinsCount; b++) BinBounds[b] = EmptyBox;
+
+		float Scale = BinsCount / Extent[Axis];
+		for (UInt32 i = First; i < First + Count; i++) {
+			NiPoint3& Center = Items[LeafItems[i]].Bound.Center;
+			UInt32 Bin = min((UInt32)(((&Center.x)[Axis] - Origin[Axis]) * Scale), BinsCount - 1);
+			BinCount[Bin]++;
+			GrowBox(&BinBounds[Bin], GetItemBox(LeafItems[i]));
+		}
+
+		// sweep from the right to get the cost of every split plane in a single pass
+		float RightArea[BinsCount];
+		UInt32 RightCount[BinsCount];
+		Box Right = EmptyBox;
+		UInt32 Sum = 0;
+		for (UInt32 b = BinsCount - 1; b > 0; b--) {
+			GrowBox(&Right, BinBounds[b]);
+			Sum += BinCount[b];
+			RightArea[b] = Sum ? GetBoxArea(Right) : 0.0f;
+			RightCount[b] = Sum;
+		}
+
+		Box Left = EmptyBox;
+		Sum = 0;
+		for (UInt32 b = 0; b < BinsCount - 1; b++) {
+			GrowBox(&Left, BinBounds[b]);
+			Sum += BinCount[b];
+			if (!Sum || !RightCount[b + 1]) continue;
+
+			float Cost = GetBoxArea(Left) * Sum + RightArea[b + 1] * RightCount[b + 1];
+			if (Cost < BestCost) {
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestBin = b;
+			}
+		}
+	}
+
+	UInt32 Middle = First + Count / 2;
+	if (BestAxis != -1) {
+		float Scale = BinsCount / Extent[BestAxis];
+		auto Split = std::partition(LeafItems.begin() + First, LeafItems.begin() + First + Count, [&](UInt32 Item) {
+			NiPoint3& Center = Items[Item].Bound.Center;
+			return min((UInt32)(((&Center.x)[BestAxis] - Origin[BestAxis]) * Scale), BinsCount - 1) <= BestBin;
+		});
+		Middle = Split - LeafItems.begin();
+	}
+	else {
+		// no split is better than a leaf (or all centers are the same), split by the median on the longest axis to keep the leaves small
+		UInt32 Axis = (Extent[0] >= Extent[1] && Extent[0] >= Extent[2]) ? 0 : (Extent[1] >= Extent[2] ? 1 : 2);
+		std::nth_element(LeafItems.begin() + First, LeafItems.begin() + Middle, LeafItems.begin() + First + Count, [&](UInt32 a, UInt32 b) {
+			return (&Items[a].Bound.Center.x)[Axis] < (&Items[b].Bound.Center.x)[Axis];
+		});
+	}
+
+	UInt32 Left = BuildNode(First, Middle - First);
+	UInt32 Right = BuildNode(Middle, First + Count - Middle);
+	Nodes[Index].Left = Left;
+	Nodes[Index].Right = Right;
+	Nodes[Index].Count = 0;
+	return Index;
+}
+
+
+/*
+* Updates the boxes after items moved. Children are always stored after their parent, so walking the nodes backwards
+* refits the leaves before the inner nodes that contain them.
+*/
+void BoundingVolumeHierarchy::Refit() {
+	for (SInt32 i = Nodes.size() - 1; i >= 0; i--) {
+		Node& Current = Nodes[i];
+		Current.Bounds = EmptyBox;
+		if (Current.Count) {
+			for (UInt32 j = Current.First; j < Current.First + Current.Count; j++) GrowBox(&Current.Bounds, GetItemBox(LeafItems[j]));
+		}
+		else {
+			GrowBox(&Current.Bounds, Nodes[Current.Left].Bounds);
+			GrowBox(&Current.Bounds, Nodes[Current.Right].Bounds);
+		}
+	}
+	Refits++;
+}
+
+
+/*
+* Same convention as NiBound::WithinFrustum: the volume is culled only if it is completely on the negative side of an active plane.
+*/
+bool BoundingVolumeHierarchy::BoxInFrustum(const Box& Bounds, NiFrustumPlanes* Planes) {
+	for (UInt32 i = 0; i < NiFrustumPlanes::MaxPlanes; i++) {
+		if (!Planes->IsPlaneActive(i)) continue;
+
+		const NiPlane& Plane = Planes->CullingPlanes[i];
+		NiPoint3 Farthest = NiPoint3(
+			Plane.Normal.x >= 0.0f ? Bounds.Max.x : Bounds.Min.x,
+			Plane.Normal.y >= 0.0f ? Bounds.Max.y : Bounds.Min.y,
+			Plane.Normal.z >= 0.0f ? Bounds.Max.z : Bounds.Min.z);
+		if (Plane.Distance(Farthest) <= 0.0f) return false;
+	}
+	return true;
+}
+
+
+bool BoundingVolumeHierarchy::SphereInFrustum(const NiBound& Bound, NiFrustumPlanes* Planes) {
+	for (UInt32 i = 0; i < NiFrustumPlanes::MaxPlanes; i++) {
+		if (Planes->IsPlaneActive(i) && Planes->CullingPlanes[i].Distance(Bound.Center) <= -Bound.Radius) return false;
+	}
+	return true;
+}
+
+
+bool BoundingVolumeHierarchy::BoxInSphere(const Box& Bounds, const NiPoint3& Center, float Radius) {
+	float x = max(Bounds.Min.x - Center.x, max(0.0f, Center.x - Bounds.Max.x));
+	float y = max(Bounds.Min.y - Center.y, max(0.0f, Center.y - Bounds.Max.y));
+	float z = max(Bounds.Min.z - Center.z, max(0.0f, Center.z - Bounds.Max.z));
+	return x * x + y * y + z * z <= Radius * Radius;
+}
+
+
+bool BoundingVolumeHierarchy::SphereInSphere(const NiBound& Bound, const NiPoint3& Center, float Radius) {
+	NiPoint3 Distance = Bound.Center - Center;
+	float Sum = Bound.Radius + Radius;
+	return Distance * Distance <= Sum * Sum;
+}
+
+
+/*
+* Sphere against a cone capped at Range from its apex. The sphere intersects if its distance to the cone surface is less than its radius.
+*/
+bool BoundingVolumeHierarchy::SphereInCone(const NiPoint3& Center, float Radius, const NiPoint3& Apex, const NiPoint3& Direction, float Sin, float Cos, float Range) {
+	NiPoint3 ToCenter = Center - Apex;
+	float DistanceSq = ToCenter * ToCenter;
+	if (DistanceSq <= Radius * Radius) return true; // apex inside the sphere
+
+	float Along = ToCenter * Direction;
+	if (Along < -Radius || Along > Range + Radius) return false;
+
+	float Across = sqrtf(max(0.0f, DistanceSq - Along * Along));
+	return Across * Cos - Along * Sin <= Radius;
+}
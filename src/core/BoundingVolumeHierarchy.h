@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+* Bounding volume hierarchy over bounding spheres, used to cull shadow casters and lights.
+* Items are inserted/removed with a handle and can be moved at any time. Commit applies the pending changes before queries:
+* - if items were inserted or removed the tree is rebuilt with a binned surface area heuristic;
+* - if items only moved the boxes are refitted bottom-up, keeping the topology.
+* Nodes are stored in depth first order, so a parent always precedes its children.
+*/
+class BoundingVolumeHierarchy {
+public:
+	struct Box {
+		NiPoint3	Min;
+		NiPoint3	Max;
+	};
+
+	struct Node {
+		Box			Bounds;
+		UInt32		Left;		// inner nodes only: children indices
+		UInt32		Right;
+		UInt32		First;		// leaves only: range in the leaf items array
+		UInt32		Count;		// 0 for inner nodes
+	};
+
+	struct Item {
+		void*		Data;
+		NiBound		Bound;
+		bool		Alive;
+	};
+
+	BoundingVolumeHierarchy();
+
+	UInt32				Insert(void* Data, const NiBound& Bound);
+	void				Remove(UInt32 Handle);
+	void				Move(UInt32 Handle, const NiBound& Bound);
+	void				Commit();
+	void				Clear();
+	UInt32				GetItemsCount() { return ItemsCount; }
+	UInt32				GetNodesCount() { return Nodes.size(); }
+
+	template <typename F> void QueryFrustum(NiFrustumPlanes* Planes, F Function);
+	template <typename F> void QuerySphere(const NiPoint3& Center, float Radius, F Function);
+	template <typename F> void QueryCone(const NiPoint3& Apex, const NiPoint3& Direction, float Angle, float Range, F Function);
+
+	static bool			BoxInFrustum(const Box& Bounds, NiFrustumPlanes* Planes);
+	static bool			SphereInFrustum(const NiBound& Bound, NiFrustumPlanes* Planes);
+	static bool			BoxInSphere(const Box& Bounds, const NiPoint3& Center, float Radius);
+	static bool			SphereInSphere(const NiBound& Bound, const NiPoint3& Center, float Radius);
+	static bool			SphereInCone(const NiPoint3& Center, float Radius, const NiPoint3& Apex, const NiPoint3& Direction, float Sin, float Cos, float Range);
+
+	UInt32				Rebuilds;
+	UInt32				Refits;
+
+private:
+	static const UInt32	LeafSize = 4;
+	static const UInt32	BinsCount = 12;
+
+	UInt32				BuildNode(UInt32 First, UInt32 Count);
+	Box					GetItemBox(UInt32 Index);
+	void				Build();
+	void				Refit();
+	template <typename T, typename F> void Traverse(T NodeTest, F ItemTest);
+
+	std::vector<Item>	Items;
+	std::vector<UInt32>	FreeItems;
+	std::vector<UInt32>	LeafItems;
+	std::vector<Node>	Nodes;
+	UInt32				ItemsCount;
+	bool				Dirty;
+	bool				Moved;
+};
+
+
+/*
+* Walks the tree with an explicit stack, descending into the nodes accepted by NodeTest and calling ItemTest on the leaf items.
+*/
+template <typename T, typename F> void BoundingVolumeHierarchy::Traverse(T NodeTest, F ItemTest) {
+	if (Nodes.empty()) return;
+
+	std::vector<UInt32> Stack;
+	Stack.reserve(64);
+	Stack.push_back(0);
+	while (!Stack.empty()) {
+		Node& Current = Nodes[Stack.back()];
+		Stack.pop_back();
+		if (!NodeTest(Current.Bounds)) continue;
+
+		if (Current.Count) {
+			for (UInt32 i = Current.First; i < Current.First + Current.Count; i++) ItemTest(Items[LeafItems[i]]);
+		}
+		else {
+			Stack.push_back(Current.Right);
+			Stack.push_back(Current.Left);
+		}
+	}
+}
+
+
+template <typename F> void BoundingVolumeHierarchy::QueryFrustum(NiFrustumPlanes* Planes, F Function) {
+	Traverse(
+		[Planes](const Box& Bounds) { return BoxInFrustum(Bounds, Planes); },
+		[Planes, &Function](Item& Entry) { if (SphereInFrustum(Entry.Bound, Planes)) Function(Entry.Data); }
+	);
+}
+
+
+template <typename F> void BoundingVolumeHierarchy::QuerySphere(const NiPoint3& Center, float Radius, F Function) {
+	Traverse(
+		[&Center, Radius](const Box& Bounds) { return BoxInSphere(Bounds, Center, Radius); },
+		[&Center, Radius, &Function](Item& Entry) { if (SphereInSphere(Entry.Bound, Center, Radius)) Function(Entry.Data); }
+	);
+}
+
+
+/*
+* Direction must be normalized, Angle is the half angle of the cone in radians.
+* Boxes are tested through their bounding sphere which is conservative.
+*/
+template <typename F> void BoundingVolumeHierarchy::QueryCone(const NiPoint3& Apex, const NiPoint3& Direction, float Angle, float Range, F Function) {
+	float Sin = sinf(Angle);
+	float Cos = cosf(Angle);
+	Traverse(
+		[&](const Box& Bounds) {
+			NiPoint3 Center = NiPoint3((Bounds.Min.x + Bounds.Max.x) * 0.5f, (Bounds.Min.y + Bounds.Max.y) * 0.5f, (Bounds.Min.z + Bounds.Max.z) * 0.5f);
+			NiPoint3 Extent = NiPoint3(Bounds.Max.x - Center.x, Bounds.Max.y - Center.y, Bounds.Max.z - Center.z);
+			return SphereInCone(Center, sqrtf(Extent * Extent), Apex, Direction, Sin, Cos, Range);
+		},
+		[&](Item& Entry) { if (SphereInCone(Entry.Bound.Center, Entry.Bound.Radius, Apex, Direction, Sin, Cos, Range)) Function(Entry.Data); }
+	);
+}
@@ -0,0 +1,149 @@
+/*
+* Starts the workers. By default one per hardware thread, minus the render thread that waits in Flush.
+* Without workers every job runs on the thread calling Flush.
+*/
+CompileQueue::CompileQueue(UInt32 WorkersCount) {
+
+	Running = 0;
+	PeakConcurrency = 0;
+	Unfinished = 0;
+	Stopping = false;
+
+	if (WorkersCount == HardwareWorkers) WorkersCount = max(std::thread::hardware_concurrency(), 2u) - 1;
+	for (UInt32 i = 0; i < WorkersCount; i++) {
+		Workers.emplace_back(&CompileQueue::WorkerLoop, this);
+	}
+
+}
+
+
+CompileQueue::~CompileQueue() {
+
+	Flush();
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Stopping = true;
+	}
+	WorkAvailable.notify_all();
+	for (std::thread& Worker : Workers) Worker.join();
+
+}
+
+
+/*
+* Adds a job and returns its id, to be used as a dependency of later jobs.
+* Dependencies must have been enqueued before; a job whose dependency failed still runs, its Work step decides what to do.
+*/
+UInt32 CompileQueue::Enqueue(const char* Name, WorkFunction Work, CommitFunction Commit, const std::vector<UInt32>& Dependencies) {
+	std::unique_lock<std::mutex> Guard(Lock);
+
+	UInt32 Id = Jobs.size();
+	Job& Item = Jobs.emplace_back();
+	Item.Name = Name;
+	Item.Work = Work;
+	Item.Commit = Commit;
+	Item.PendingDependencies = 0;
+	Item.Finished = false;
+	Item.Result = false;
+
+	for (UInt32 Dependency : Dependencies) {
+		if (Dependency >= Id || Jobs[Dependency].Finished) continue;
+		Jobs[Dependency].Dependents.push_back(Id);
+		Item.PendingDependencies++;
+	}
+
+	Unfinished++;
+	if (!Item.PendingDependencies) {
+		Ready.push_back(Id);
+		Guard.unlock();
+		WorkAvailable.notify_one();
+	}
+	return Id;
+}
+
+
+/*
+* Waits for all the Work steps, helping the workers meanwhile, then runs the Commit steps in the order the jobs were enqueued.
+*/
+void CompileQueue::Flush() {
+	auto timer = TimeLogger();
+
+	std::unique_lock<std::mutex> Guard(Lock);
+	while (Unfinished) {
+		if (Ready.empty()) {
+			WorkFinished.wait(Guard);
+			continue;
+		}
+
+		// without workers (or while they are busy) the calling thread compiles as well
+		UInt32 Id = Ready.front();
+		Ready.pop_front();
+		Running++;
+		PeakConcurrency = max(PeakConcurrency, Running);
+
+		Job& Item = Jobs[Id];
+		Guard.unlock();
+		bool Result = Item.Work ? Item.Work() : true;
+		Guard.lock();
+		Running--;
+		FinishJob(Id, Result);
+	}
+
+	std::deque<Job> Committed;
+	Committed.swap(Jobs);
+	Guard.unlock();
+
+	for (Job& Item : Committed) {
+		if (Item.Commit) Item.Commit(Item.Result);
+	}
+	ShaderCache::Shaders.Flush();
+	ShaderCache::Effects.Flush();
+
+	if (!Committed.empty()) {
+		Logger::Log("CompileQueue: %u jobs on %u workers, peak concurrency %u", Committed.size(), Workers.size(), PeakConcurrency);
+		timer.LogTime("CompileQueue::Flush");
+	}
+}
+
+
+/*
+* Marks a job as finished and releases the jobs waiting for it. Called with the lock held.
+*/
+void CompileQueue::FinishJob(UInt32 Id, bool Result) {
+	Job& Item = Jobs[Id];
+	Item.Finished = true;
+	Item.Result = Result;
+	Unfinished--;
+
+	UInt32 Released = 0;
+	for (UInt32 Dependent : Item.Dependents) {
+		if (--Jobs[Dependent].PendingDependencies == 0) {
+			Ready.push_back(Dependent);
+			Released++;
+		}
+	}
+
+	if (Released) WorkAvailable.notify_all();
+	WorkFinished.notify_all();
+}
+
+
+void CompileQueue::WorkerLoop() {
+	std::unique_lock<std::mutex> Guard(Lock);
+	while (true) {
+		WorkAvailable.wait(Guard, [this] { return Stopping || !Ready.empty(); });
+		if (Stopping) return;
+
+		UInt32 Id = Ready.front();
+		Ready.pop_front();
+		Running++;
+		PeakConcurrency = max(PeakConcurrency, Running);
+
+		Job& Item = Jobs[Id]; // the deque only grows while jobs are pending, references stay valid
+		Guard.unlock();
+		bool Result = Item.Work ? Item.Work() : true;
+		Guard.lock();
+		Running--;
+		FinishJob(Id, Result);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+/*
+* Job queue used to compile shaders and effects on worker threads.
+* A job has a Work step, run by any worker, and an optional Commit step run by the thread calling Flush (the render thread),
+* so that only the creation of the device objects is serialized.
+* A job can depend on other jobs of the same queue: its Work step starts once all of theirs have finished.
+*/
+class CompileQueue {
+public:
+	typedef std::function<bool()>		WorkFunction;
+	typedef std::function<void(bool)>	CommitFunction;
+
+	static const UInt32 HardwareWorkers = 0xFFFFFFFF;	// one worker per hardware thread, minus the render thread
+
+	CompileQueue(UInt32 WorkersCount = HardwareWorkers);
+	~CompileQueue();
+
+	UInt32					Enqueue(const char* Name, WorkFunction Work, CommitFunction Commit = nullptr, const std::vector<UInt32>& Dependencies = {});
+	void					Flush();
+	UInt32					GetWorkersCount() { return Workers.size(); }
+	UInt32					GetPeakConcurrency() { return PeakConcurrency; }
+
+private:
+	struct Job {
+		std::string			Name;
+		WorkFunction		Work;
+		CommitFunction		Commit;
+		UInt32				PendingDependencies;
+		std::vector<UInt32>	Dependents;
+		bool				Finished;
+		bool				Result;
+	};
+
+	void					WorkerLoop();
+	void					FinishJob(UInt32 Id, bool Result);
+
+	std::deque<Job>			Jobs;
+	std::deque<UInt32>		Ready;
+	std::vector<std::thread> Workers;
+	std::mutex				Lock;
+	std::condition_variable	WorkAvailable;
+	std::condition_variable	WorkFinished;
+	UInt32					Running;
+	UInt32					PeakConcurrency;
+	UInt32					Unfinished;
+	bool					Stopping;
+};
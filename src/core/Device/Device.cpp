@@ -1,13 +1,105 @@
 #include "Device.h"
 
-TESRDirect3DDevice9::TESRDirect3DDevice9(IDirect3D9Ex* D3DInterface, IDirect3DDevice9Ex* D3DDevice) : IDirect3DDevice9Ex() {
+TESRDirect3DDevice9* TESRDirect3DDevice9::Instance = NULL;
+std::vector<TESRDirect3DDevice9::ResetCallback> TESRDirect3DDevice9::ResetCallbacks;
+
+TESRDirect3DDevice9::TESRDirect3DDevice9(IDirect3D9Ex* D3DInterface, IDirect3DDevice9Ex* D3DDevice, bool FilterStates) : IDirect3DDevice9Ex() {
 	this->D3DInterface = D3DInterface;
 	this->D3DDevice = D3DDevice;
+	this->FilterStates = FilterStates;
+
+	// generation 0 marks the unknown states
+	memset(RenderStates, 0, sizeof(RenderStates));
+	memset(SamplerStates, 0, sizeof(SamplerStates));
+	memset(Textures, 0, sizeof(Textures));
+	memset(TextureStageStates, 0, sizeof(TextureStageStates));
+	memset(Streams, 0, sizeof(Streams));
+	Indices = VertexShader = PixelShader = VertexDeclaration = FVF = { 0, 0 };
+	Generation = 1;
+	RecordingStateBlock = false;
+	Frame = LastFrame = { 0, 0 };
+	Instance = this;
+}
+
+TESRDirect3DDevice9::~TESRDirect3DDevice9() {
+	if (Instance == this) Instance = NULL;
+}
+
+/*
+* Forgets all the states, the next call setting each of them is forwarded.
+* Used when the device state changes without going through the proxy: reset, state blocks and the start of a frame.
+*/
+void TESRDirect3DDevice9::InvalidateStates() {
+	if (++Generation == 0) Generation = 1;
 }
 
-TESRDirect3DDevice9::~TESRDirect3DDevice9() { }
+void TESRDirect3DDevice9::EndFrame() {
+	LastFrame = Frame;
+	Frame = { 0, 0 };
+	InvalidateStates();
+}
+
+/*
+* Registers a function releasing default pool resources, called before the device is reset.
+*/
+void TESRDirect3DDevice9::AddResetCallback(ResetCallback Callback) {
+	ResetCallbacks.push_back(Callback);
+}
+
+/*
+* Index of a sampler in the shadow, -1 for the samplers that don't exist.
+*/
+int TESRDirect3DDevice9::GetSamplerIndex(DWORD Sampler) {
+	if (Sampler < 16) return Sampler;
+	if (Sampler >= D3DDMAPSAMPLER && Sampler <= D3DVERTEXTEXTURESAMPLER3) return 16 + Sampler - D3DDMAPSAMPLER;
+	return -1;
+}
+
+bool TESRDirect3DDevice9::IsKnown(const StateValue* State, UINT_PTR Value) {
+	return State->Generation == Generation && State->Value == Value;
+}
+
+/*
+* Counts the call as filtered if the state already has Value. Nothing is filtered while a state block is recorded,
+* the calls are captured by the state block instead of setting the device state.
+*/
+bool TESRDirect3DDevice9::IsRedundant(const StateValue* State, UINT_PTR Value) {
+	if (FilterStates && !RecordingStateBlock && IsKnown(State, Value)) {
+		Frame.Filtered++;
+		return true;
+	}
+	Frame.Forwarded++;
+	return false;
+}
+
+HRESULT TESRDirect3DDevice9::Track(StateValue* State, UINT_PTR Value, HRESULT Result) {
+	if (!RecordingStateBlock) {
+		State->Value = Value;
+		State->Generation = SUCCEEDED(Result) ? Generation : 0;
+	}
+	return Result;
+}
 
 STDMETHODIMP TESRDirect3DDevice9::QueryInterface(REFIID riid, void **ppvObj) {
+	// the device interfaces must keep going through the proxy, the others (DXVK interop) are the ones of the device
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(IDirect3DDevice9)) {
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
+	if (riid == __uuidof(IDirect3DDevice9Ex)) {
+		// the device is created with CreateDevice, the Ex methods only exist if the runtime gave an Ex device anyway
+		IUnknown* DeviceEx = NULL;
+		HRESULT Result = D3DDevice->QueryInterface(riid, (void**)&DeviceEx);
+		if (FAILED(Result)) {
+			*ppvObj = NULL;
+			return Result;
+		}
+		DeviceEx->Release();
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
 	return D3DDevice->QueryInterface(riid, ppvObj);
 }
 
@@ -76,10 +168,14 @@ COM_DECLSPEC_NOTHROW UINT STDMETHODCALLTYPE TESRDirect3DDevice9::GetNumberOfSwap
 }
 
 STDMETHODIMP TESRDirect3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresentationParameters) {
+	InvalidateStates();
+	for (ResetCallback Callback : ResetCallbacks) Callback();
 	return D3DDevice->Reset(pPresentationParameters);
 }
 
 STDMETHODIMP TESRDirect3DDevice9::Present(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride, CONST RGNDATA *pDirtyRegion) {
+	EndFrame();
+	StateCapture::EndFrame();
 	return D3DDevice->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
 }
 
@@ -240,7 +336,11 @@ STDMETHODIMP TESRDirect3DDevice9::GetClipPlane(DWORD Index, float *pPlane) {
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value) {
-	return D3DDevice->SetRenderState(State, Value);
+	if (State >= RenderStatesCount) return D3DDevice->SetRenderState(State, Value);
+	bool Filtered = IsRedundant(&RenderStates[State], Value);
+	Capture(StateCapture::RenderState, State, 0, Value, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(&RenderStates[State], Value, D3DDevice->SetRenderState(State, Value));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetRenderState(D3DRENDERSTATETYPE State, DWORD *pValue) {
@@ -248,15 +348,22 @@ STDMETHODIMP TESRDirect3DDevice9::GetRenderState(D3DRENDERSTATETYPE State, DWORD
 }
 
 STDMETHODIMP TESRDirect3DDevice9::CreateStateBlock(D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9 **ppSB) {
-	return D3DDevice->CreateStateBlock(Type, ppSB);
+	HRESULT hr = D3DDevice->CreateStateBlock(Type, ppSB);
+	if (SUCCEEDED(hr) && *ppSB) *ppSB = new TESRDirect3DStateBlock9(this, *ppSB);
+	return hr;
 }
 
 STDMETHODIMP TESRDirect3DDevice9::BeginStateBlock() {
-	return D3DDevice->BeginStateBlock();
+	HRESULT hr = D3DDevice->BeginStateBlock();
+	if (SUCCEEDED(hr)) RecordingStateBlock = true;
+	return hr;
 }
 
 STDMETHODIMP TESRDirect3DDevice9::EndStateBlock(IDirect3DStateBlock9 **ppSB) {
-	return D3DDevice->EndStateBlock(ppSB);
+	HRESULT hr = D3DDevice->EndStateBlock(ppSB);
+	RecordingStateBlock = false;
+	if (SUCCEEDED(hr) && *ppSB) *ppSB = new TESRDirect3DStateBlock9(this, *ppSB);
+	return hr;
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetClipStatus(CONST D3DCLIPSTATUS9 *pClipStatus) {
@@ -272,7 +379,12 @@ STDMETHODIMP TESRDirect3DDevice9::GetTexture(DWORD Sampler, IDirect3DBaseTexture
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetTexture(DWORD Sampler, IDirect3DBaseTexture9 *pTexture) {
-	return D3DDevice->SetTexture(Sampler, pTexture);
+	int Index = GetSamplerIndex(Sampler);
+	if (Index < 0) return D3DDevice->SetTexture(Sampler, pTexture);
+	bool Filtered = IsRedundant(&Textures[Index], (UINT_PTR)pTexture);
+	Capture(StateCapture::Texture, Sampler, 0, (UINT_PTR)pTexture, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(&Textures[Index], (UINT_PTR)pTexture, D3DDevice->SetTexture(Sampler, pTexture));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD *pValue) {
@@ -280,7 +392,12 @@ STDMETHODIMP TESRDirect3DDevice9::GetTextureStageState(DWORD Stage, D3DTEXTUREST
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) {
-	return D3DDevice->SetTextureStageState(Stage, Type, Value);
+	if (Stage >= TextureStagesCount || Type >= TextureStageStatesCount) return D3DDevice->SetTextureStageState(Stage, Type, Value);
+	StateValue* State = &TextureStageStates[Stage][Type];
+	bool Filtered = IsRedundant(State, Value);
+	Capture(StateCapture::TextureStageState, Stage, Type, Value, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(State, Value, D3DDevice->SetTextureStageState(Stage, Type, Value));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD *pValue) {
@@ -288,7 +405,13 @@ STDMETHODIMP TESRDirect3DDevice9::GetSamplerState(DWORD Sampler, D3DSAMPLERSTATE
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) {
-	return D3DDevice->SetSamplerState(Sampler, Type, Value);
+	int Index = GetSamplerIndex(Sampler);
+	if (Index < 0 || Type >= SamplerStatesCount) return D3DDevice->SetSamplerState(Sampler, Type, Value);
+	StateValue* State = &SamplerStates[Index][Type];
+	bool Filtered = IsRedundant(State, Value);
+	Capture(StateCapture::SamplerState, Sampler, Type, Value, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(State, Value, D3DDevice->SetSamplerState(Sampler, Type, Value));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::ValidateDevice(DWORD *pNumPasses) {
@@ -336,18 +459,22 @@ COM_DECLSPEC_NOTHROW float STDMETHODCALLTYPE TESRDirect3DDevice9::GetNPatchMode(
 }
 
 STDMETHODIMP TESRDirect3DDevice9::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) {
+	Capture(StateCapture::Draw, PrimitiveType, 0, PrimitiveCount, false);
 	return D3DDevice->DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
 }
 
 STDMETHODIMP TESRDirect3DDevice9::DrawIndexedPrimitive(D3DPRIMITIVETYPE PrimitiveType, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount) {
+	Capture(StateCapture::DrawIndexed, PrimitiveType, 0, primCount, false);
 	return D3DDevice->DrawIndexedPrimitive(PrimitiveType, BaseVertexIndex, MinVertexIndex, NumVertices, startIndex, primCount);
 }
 
 STDMETHODIMP TESRDirect3DDevice9::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride) {
+	Capture(StateCapture::DrawUP, PrimitiveType, 0, PrimitiveCount, false);
 	return D3DDevice->DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
 }
 
 STDMETHODIMP TESRDirect3DDevice9::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertices, UINT PrimitiveCount, CONST void *pIndexData, D3DFORMAT IndexDataFormat, CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride) {
+	Capture(StateCapture::DrawIndexedUP, PrimitiveType, 0, PrimitiveCount, false);
 	return D3DDevice->DrawIndexedPrimitiveUP(PrimitiveType, MinVertexIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
 }
 
@@ -360,7 +487,11 @@ STDMETHODIMP TESRDirect3DDevice9::CreateVertexDeclaration(CONST D3DVERTEXELEMENT
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetVertexDeclaration(IDirect3DVertexDeclaration9 *pDecl) {
-	return D3DDevice->SetVertexDeclaration(pDecl);
+	bool Filtered = IsRedundant(&VertexDeclaration, (UINT_PTR)pDecl);
+	Capture(StateCapture::VertexDeclaration, 0, 0, (UINT_PTR)pDecl, Filtered);
+	if (Filtered) return D3D_OK;
+	if (!RecordingStateBlock) FVF.Generation = 0; // the FVF is derived from the declaration
+	return Track(&VertexDeclaration, (UINT_PTR)pDecl, D3DDevice->SetVertexDeclaration(pDecl));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetVertexDeclaration(IDirect3DVertexDeclaration9 **ppDecl) {
@@ -368,7 +499,11 @@ STDMETHODIMP TESRDirect3DDevice9::GetVertexDeclaration(IDirect3DVertexDeclaratio
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetFVF(DWORD FVF) {
-	return D3DDevice->SetFVF(FVF);
+	bool Filtered = IsRedundant(&this->FVF, FVF);
+	Capture(StateCapture::FVF, 0, 0, FVF, Filtered);
+	if (Filtered) return D3D_OK;
+	if (!RecordingStateBlock) VertexDeclaration.Generation = 0; // replaced by the declaration of the FVF
+	return Track(&this->FVF, FVF, D3DDevice->SetFVF(FVF));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetFVF(DWORD *pFVF) {
@@ -380,7 +515,10 @@ STDMETHODIMP TESRDirect3DDevice9::CreateVertexShader(CONST DWORD *pFunction, IDi
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetVertexShader(IDirect3DVertexShader9 *pShader) {
-	return D3DDevice->SetVertexShader(pShader);
+	bool Filtered = IsRedundant(&VertexShader, (UINT_PTR)pShader);
+	Capture(StateCapture::VertexShader, 0, 0, (UINT_PTR)pShader, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(&VertexShader, (UINT_PTR)pShader, D3DDevice->SetVertexShader(pShader));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetVertexShader(IDirect3DVertexShader9 **ppShader) {
@@ -412,7 +550,20 @@ STDMETHODIMP TESRDirect3DDevice9::GetVertexShaderConstantB(UINT StartRegister, B
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9 *pStreamData, UINT OffsetInBytes, UINT Stride) {
-	return D3DDevice->SetStreamSource(StreamNumber, pStreamData, OffsetInBytes, Stride);
+	if (StreamNumber >= StreamsCount) return D3DDevice->SetStreamSource(StreamNumber, pStreamData, OffsetInBytes, Stride);
+
+	StreamState* Stream = &Streams[StreamNumber];
+	bool Filtered = FilterStates && !RecordingStateBlock && IsKnown(&Stream->Buffer, (UINT_PTR)pStreamData) && IsKnown(&Stream->Offset, OffsetInBytes) && IsKnown(&Stream->Stride, Stride);
+	Capture(StateCapture::StreamSource, StreamNumber, Stride, ((UInt64)(UINT_PTR)pStreamData << 32) | OffsetInBytes, Filtered);
+	if (Filtered) {
+		Frame.Filtered++;
+		return D3D_OK;
+	}
+	Frame.Forwarded++;
+	HRESULT hr = D3DDevice->SetStreamSource(StreamNumber, pStreamData, OffsetInBytes, Stride);
+	Track(&Stream->Offset, OffsetInBytes, hr);
+	Track(&Stream->Stride, Stride, hr);
+	return Track(&Stream->Buffer, (UINT_PTR)pStreamData, hr);
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9 **ppStreamData, UINT *pOffsetInBytes, UINT *pStride) {
@@ -420,7 +571,11 @@ STDMETHODIMP TESRDirect3DDevice9::GetStreamSource(UINT StreamNumber, IDirect3DVe
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetStreamSourceFreq(UINT StreamNumber, UINT Setting) {
-	return D3DDevice->SetStreamSourceFreq(StreamNumber, Setting);
+	if (StreamNumber >= StreamsCount) return D3DDevice->SetStreamSourceFreq(StreamNumber, Setting);
+	bool Filtered = IsRedundant(&Streams[StreamNumber].Frequency, Setting);
+	Capture(StateCapture::StreamFrequency, StreamNumber, 0, Setting, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(&Streams[StreamNumber].Frequency, Setting, D3DDevice->SetStreamSourceFreq(StreamNumber, Setting));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetStreamSourceFreq(UINT StreamNumber, UINT *pSetting) {
@@ -428,7 +583,10 @@ STDMETHODIMP TESRDirect3DDevice9::GetStreamSourceFreq(UINT StreamNumber, UINT *p
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetIndices(IDirect3DIndexBuffer9 *pIndexData) {
-	return D3DDevice->SetIndices(pIndexData);
+	bool Filtered = IsRedundant(&Indices, (UINT_PTR)pIndexData);
+	Capture(StateCapture::Indices, 0, 0, (UINT_PTR)pIndexData, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(&Indices, (UINT_PTR)pIndexData, D3DDevice->SetIndices(pIndexData));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetIndices(IDirect3DIndexBuffer9 **ppIndexData) {
@@ -440,7 +598,10 @@ STDMETHODIMP TESRDirect3DDevice9::CreatePixelShader(CONST DWORD *pFunction, IDir
 }
 
 STDMETHODIMP TESRDirect3DDevice9::SetPixelShader(IDirect3DPixelShader9 *pShader) {
-	return D3DDevice->SetPixelShader(pShader);
+	bool Filtered = IsRedundant(&PixelShader, (UINT_PTR)pShader);
+	Capture(StateCapture::PixelShader, 0, 0, (UINT_PTR)pShader, Filtered);
+	if (Filtered) return D3D_OK;
+	return Track(&PixelShader, (UINT_PTR)pShader, D3DDevice->SetPixelShader(pShader));
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetPixelShader(IDirect3DPixelShader9 **ppShader) {
@@ -496,6 +657,8 @@ STDMETHODIMP TESRDirect3DDevice9::ComposeRects(IDirect3DSurface9 * pSrc, IDirect
 }
 
 STDMETHODIMP TESRDirect3DDevice9::PresentEx(CONST RECT * pSourceRect, CONST RECT * pDestRect, HWND hDestWindowOverride, CONST RGNDATA * pDirtyRegion, DWORD dwFlags) {
+	EndFrame();
+	StateCapture::EndFrame();
 	return D3DDevice->PresentEx(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
 }
 
@@ -540,9 +703,52 @@ STDMETHODIMP TESRDirect3DDevice9::CreateDepthStencilSurfaceEx(UINT Width, UINT H
 }
 
 STDMETHODIMP TESRDirect3DDevice9::ResetEx(D3DPRESENT_PARAMETERS * pPresentationParameters, D3DDISPLAYMODEEX * pFullscreenDisplayMode) {
+	InvalidateStates();
+	for (ResetCallback Callback : ResetCallbacks) Callback();
 	return D3DDevice->ResetEx(pPresentationParameters, pFullscreenDisplayMode);
 }
 
 STDMETHODIMP TESRDirect3DDevice9::GetDisplayModeEx(UINT iSwapChain, D3DDISPLAYMODEEX * pMode, D3DDISPLAYROTATION * pRotation) {
 	return D3DDevice->GetDisplayModeEx(iSwapChain, pMode, pRotation);
 }
+
+
+TESRDirect3DStateBlock9::TESRDirect3DStateBlock9(TESRDirect3DDevice9* Device, IDirect3DStateBlock9* StateBlock) {
+	this->Device = Device;
+	this->StateBlock = StateBlock;
+}
+
+STDMETHODIMP TESRDirect3DStateBlock9::QueryInterface(REFIID riid, void** ppvObj) {
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(IDirect3DStateBlock9)) {
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
+	return StateBlock->QueryInterface(riid, ppvObj);
+}
+
+STDMETHODIMP_(ULONG) TESRDirect3DStateBlock9::AddRef() {
+	return StateBlock->AddRef();
+}
+
+STDMETHODIMP_(ULONG) TESRDirect3DStateBlock9::Release() {
+	ULONG count = StateBlock->Release();
+	if (count == 0) delete this;
+	return count;
+}
+
+STDMETHODIMP TESRDirect3DStateBlock9::GetDevice(IDirect3DDevice9** ppDevice) {
+	*ppDevice = Device;
+	Device->AddRef();
+	return D3D_OK;
+}
+
+STDMETHODIMP TESRDirect3DStateBlock9::Capture() {
+	return StateBlock->Capture();
+}
+
+STDMETHODIMP TESRDirect3DStateBlock9::Apply() {
+	Device->InvalidateStates();
+	StateCapture::Add(StateCapture::StateBlock, 0, 0, 0, false);
+	return StateBlock->Apply();
+}
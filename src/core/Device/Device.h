@@ -1,10 +1,52 @@
 #pragma once
 
+/*
+* Proxy of the game device. It keeps a shadow of the pipeline state set through it and, if FilterStates, drops the calls setting a state to its current value.
+* Render targets, viewports and shader constants are not shadowed: ShaderRecord already filters the constants, the others have side effects.
+* It is always installed, as it also runs the reset callbacks of the default pool resources created by the plugin.
+*/
 class TESRDirect3DDevice9 : public IDirect3DDevice9Ex {
 public:
-	TESRDirect3DDevice9(IDirect3D9Ex* D3DInterface, IDirect3DDevice9Ex* D3DDevice);
+	static const UInt32 RenderStatesCount = 256;
+	static const UInt32 SamplersCount = 21;				// 16 pixel samplers, the displacement map sampler and 4 vertex samplers
+	static const UInt32 SamplerStatesCount = 14;		// up to D3DSAMP_DMAPOFFSET
+	static const UInt32 TextureStagesCount = 8;
+	static const UInt32 TextureStageStatesCount = 33;	// up to D3DTSS_CONSTANT
+	static const UInt32 StreamsCount = 16;
+
+	/*
+	* Last value set for a state, known while its generation is the current one.
+	*/
+	struct StateValue {
+		UINT_PTR	Value;
+		UInt32		Generation;
+	};
+
+	struct StreamState {
+		StateValue	Buffer;
+		StateValue	Offset;
+		StateValue	Stride;
+		StateValue	Frequency;
+	};
+
+	struct StateStatistics {
+		UInt32		Forwarded;	// state calls passed to the device
+		UInt32		Filtered;	// state calls dropped because they would not change the state
+	};
+
+	typedef void (*ResetCallback)();
+
+	TESRDirect3DDevice9(IDirect3D9Ex* D3DInterface, IDirect3DDevice9Ex* D3DDevice, bool FilterStates);
 	~TESRDirect3DDevice9();
 
+	void				InvalidateStates();
+	void				EndFrame();
+
+	static void			AddResetCallback(ResetCallback Callback);
+
+	static TESRDirect3DDevice9* Instance;	// NULL if the device is not wrapped
+	StateStatistics		LastFrame;			// counters of the last presented frame
+
 	/*** IUnknown methods ***/
 	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj);
 	STDMETHOD_(ULONG, AddRef)(THIS);
@@ -146,6 +188,48 @@ public:
 	STDMETHOD(GetDisplayModeEx)(THIS_ UINT iSwapChain, D3DDISPLAYMODEEX* pMode, D3DDISPLAYROTATION* pRotation);
 
 private:
+	static int			GetSamplerIndex(DWORD Sampler);
+	bool				IsKnown(const StateValue* State, UINT_PTR Value);
+	bool				IsRedundant(const StateValue* State, UINT_PTR Value);
+	HRESULT				Track(StateValue* State, UINT_PTR Value, HRESULT Result);
+	void				Capture(StateCapture::EventType Type, UInt32 Slot, UInt32 Index, UInt64 Value, bool Filtered) { if (!RecordingStateBlock) StateCapture::Add(Type, Slot, Index, Value, Filtered); }
+
+	static std::vector<ResetCallback> ResetCallbacks;
+
 	IDirect3D9Ex* D3DInterface;
 	IDirect3DDevice9Ex* D3DDevice;
+
+	bool				FilterStates;
+	UInt32				Generation;
+	bool				RecordingStateBlock;
+	StateStatistics		Frame;
+	StateValue			RenderStates[RenderStatesCount];
+	StateValue			SamplerStates[SamplersCount][SamplerStatesCount];
+	StateValue			Textures[SamplersCount];
+	StateValue			TextureStageStates[TextureStagesCount][TextureStageStatesCount];
+	StreamState			Streams[StreamsCount];
+	StateValue			Indices;
+	StateValue			VertexShader;
+	StateValue			PixelShader;
+	StateValue			VertexDeclaration;
+	StateValue			FVF;
+};
+
+/*
+* Proxy of the state blocks created through the device: applying a state block changes the device state behind the shadow.
+*/
+class TESRDirect3DStateBlock9 : public IDirect3DStateBlock9 {
+public:
+	TESRDirect3DStateBlock9(TESRDirect3DDevice9* Device, IDirect3DStateBlock9* StateBlock);
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj);
+	STDMETHOD_(ULONG, AddRef)(THIS);
+	STDMETHOD_(ULONG, Release)(THIS);
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice);
+	STDMETHOD(Capture)(THIS);
+	STDMETHOD(Apply)(THIS);
+
+private:
+	TESRDirect3DDevice9* Device;
+	IDirect3DStateBlock9* StateBlock;
 };
@@ -1,11 +1,13 @@
 #include "Hook.h"
 #include "Device.h"
 
+static bool FilterDeviceStates = false;
+
 static HRESULT STDMETHODCALLTYPE CreateDevice(IDirect3D9Ex* D3DInterface, UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice9Ex** ppReturnedDeviceInterface) {
 //	pPresentationParameters->AutoDepthStencilFormat = D3DFMT_D32;
 	HRESULT R = D3DInterface->CreateDevice(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, (IDirect3DDevice9**)ppReturnedDeviceInterface);
 	//HRESULT R = D3DInterface->CreateDeviceEx(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, NULL, ppReturnedDeviceInterface);
-//	*ppReturnedDeviceInterface = new TESRDirect3DDevice9(D3DInterface, *ppReturnedDeviceInterface);
+	if (SUCCEEDED(R)) *ppReturnedDeviceInterface = new TESRDirect3DDevice9(D3DInterface, *ppReturnedDeviceInterface, FilterDeviceStates);
 	return R;
 	
 }
@@ -22,8 +24,9 @@ static __declspec(naked) void CreateDeviceHook()
 
 }
 
-void AttachDeviceHooks() {
+void AttachDeviceHooks(bool FilterStates) {
 
+	FilterDeviceStates = FilterStates;
 	SafeWriteJump(Jumpers::CreateDevice::Hook, (UInt32)CreateDeviceHook);
 
 }
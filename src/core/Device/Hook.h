@@ -1,3 +1,3 @@
 #pragma once
 
-void AttachDeviceHooks();
\ No newline at end of file
+void AttachDeviceHooks(bool FilterStates);
\ No newline at end of file
@@ -9,11 +9,18 @@ EffectRecord::EffectRecord(const char* effectName) {
 	Enabled = false;
 	renderTime = 0;
 	constantUpdateTime = 0;
+	RenderedBufferSampler = -1;
+	HasSourceBuffer = false;
+	DiscardsPixels = false;
+	CompiledSource = NULL;
+	CompiledBinary = NULL;
 }
 
 /*Shader Values arrays are freed in the superclass Destructor*/
 EffectRecord::~EffectRecord() {
 	if (Effect) Effect->Release();
+	if (CompiledSource) CompiledSource->Release();
+	if (CompiledBinary) CompiledBinary->Release();
 }
 
 /*
@@ -48,155 +55,186 @@ void EffectRecord::DisposeEffect() {
 	Enabled = false;
 }
 
+/*
+ * Builds the source, preprocessed and compiled paths of the effect.
+ */
+void EffectRecord::GetEffectPaths(char* SourcePath, char* PreprocessedPath, char* CompiledPath) {
+	strcpy(SourcePath, EffectsPath);
+	strcat(SourcePath, Name);
+	strcat(SourcePath, ".fx.hlsl");
+
+	strcpy(PreprocessedPath, EffectsPath);
+	strcat(PreprocessedPath, "Cache\\");
+	strcat(PreprocessedPath, Name);
+	strcat(PreprocessedPath, ".fx.hlsl");
+
+	strcpy(CompiledPath, EffectsPath);
+	strcat(CompiledPath, "Cache\\");
+	strcat(CompiledPath, Name);
+	strcat(CompiledPath, ".fx");
+}
+
 /*
  * Compile and Load the Effect shader
  */
 bool EffectRecord::LoadEffect() {
+	return CreateEffect(CompileEffect());
+}
+
+/*
+ * Preprocesses the effect and compiles it if the cache is outdated. Doesn't use the device, so it can run on a worker thread.
+ * The preprocessed source is kept until CreateEffect is called.
+ */
+bool EffectRecord::CompileEffect(bool Force) {
 	auto timer = TimeLogger();
-	bool success = false;
 
-	ID3DXEffect* Effect = NULL;
 	ID3DXEffectCompiler* Compiler = NULL;
 	ID3DXBuffer* EffectSource = NULL;
 	ID3DXBuffer* Errors = NULL;
 	ID3DXBuffer* EffectBuffer = NULL;
 
-	char BaseDirectory[MAX_PATH];
-	char CacheDirectory[MAX_PATH];
 	char EffectSourcePath[MAX_PATH];
 	char EffectPreprocessedPath[MAX_PATH];
 	char EffectCompiledPath[MAX_PATH];
 
-	// Build filenames.
-	strcpy(BaseDirectory, EffectsPath);
-	strcpy(CacheDirectory, BaseDirectory);
-	strcat(CacheDirectory, "Cache\\");
+	GetEffectPaths(EffectSourcePath, EffectPreprocessedPath, EffectCompiledPath);
+	if (!FileExists(EffectSourcePath)) return false;
+
+	// an unchanged index entry means the cached preprocessed source and binary can be used without running the preprocessor
+	UInt64 ConfigHash = ShaderCache::HashConfig(EffectSourcePath, NULL, NULL, "fx_2_0");
+	if (CompiledBinary) CompiledBinary->Release();
+	CompiledBinary = NULL;
+	if (!Force && ShaderArchive::Precompiled.Find(EffectCompiledPath, ConfigHash, &EffectSource, &CompiledBinary)) {
+		if (CompiledSource) CompiledSource->Release();
+		CompiledSource = EffectSource;
+		timer.LogTime("EffectRecord::CompileEffect");
+		return true;
+	}
 
-	strcpy(EffectSourcePath, BaseDirectory);
-	strcat(EffectSourcePath, Name);
-	strcat(EffectSourcePath, ".fx.hlsl");
+	bool Cached = !Force && ShaderCache::Effects.IsEntryValid(EffectCompiledPath, ConfigHash) && FileExists(EffectCompiledPath) && LoadFileBuffer(EffectPreprocessedPath, &EffectSource);
 
-	if (!FileExists(EffectSourcePath)) {
-		return success;
+	HRESULT prepass = Cached ? D3D_OK : D3DXPreprocessShaderFromFileA(EffectSourcePath, NULL, NULL, &EffectSource, &Errors);
+	if (prepass != D3D_OK) {
+		ReportError(prepass);
+		if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+		if (Errors) Errors->Release();
+		if (EffectSource) EffectSource->Release();
+		return false;
 	}
 
-	strcpy(EffectPreprocessedPath, CacheDirectory);
-	strcat(EffectPreprocessedPath, Name);
-	strcat(EffectPreprocessedPath, ".fx.hlsl");
+	bool Compile = !Cached && (Force || !CheckPreprocessResult(EffectPreprocessedPath, EffectSource) || !FileExists(EffectCompiledPath));
+	if (Compile) {
+		// compile if option was enabled or compiled version not found
+		HRESULT compiled = D3DXCreateEffectCompiler(
+			(const char*)EffectSource->GetBufferPointer(), 
+			EffectSource->GetBufferSize(), 
+			NULL, 
+			NULL, 
+			NULL, 
+			&Compiler, 
+			&Errors
+		);
+		if (SUCCEEDED(compiled)) {
+			if (Errors) { Logger::Log((char*)Errors->GetBufferPointer()); Errors->Release(); Errors = NULL; }
+			compiled = Compiler->CompileEffect(NULL, &EffectBuffer, &Errors);
+		}
+		if (FAILED(compiled)) {
+			ReportError(compiled);
+			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+			if (Compiler) Compiler->Release();
+			if (EffectSource) EffectSource->Release();
+			if (Errors) Errors->Release();
+			return false;
+		}
+		if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
 
-	strcpy(EffectCompiledPath, CacheDirectory);
-	strcat(EffectCompiledPath, Name);
-	strcat(EffectCompiledPath, ".fx");
+		if (EffectBuffer) {
+			std::ofstream FileBinary(EffectCompiledPath, std::ios::out | std::ios::binary);
+			FileBinary.write((const char*)EffectBuffer->GetBufferPointer(), EffectBuffer->GetBufferSize());
+			FileBinary.flush();
+			FileBinary.close();
 
-	HRESULT prepass = D3DXPreprocessShaderFromFileA(EffectSourcePath, NULL, NULL, &EffectSource, &Errors);
-	if (prepass == D3D_OK) {
-		bool Compile = !CheckPreprocessResult(EffectPreprocessedPath, EffectSource);
-		bool CompiledExists = FileExists(EffectCompiledPath);
+			std::ofstream FilePreprocess(EffectPreprocessedPath, std::ios::out | std::ios::binary);
+			FilePreprocess.write((const char*)EffectSource->GetBufferPointer(), EffectSource->GetBufferSize());
+			FilePreprocess.flush();
+			FilePreprocess.close();
 
-		if (!Compile && CompiledExists) {
-			HRESULT loaded = D3DXCreateEffectFromFileA(TheRenderManager->device, EffectCompiledPath, NULL, NULL, D3DXFX_LARGEADDRESSAWARE, NULL, &Effect, &Errors);
-			if (FAILED(loaded)) {
-				ReportError(loaded);
-				if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+			Logger::Log("Effect compiled: %s", EffectPreprocessedPath);
+		}
+	}
 
-				if (Effect) { Effect->Release(); Effect = NULL; }
-				if (Errors) { Errors->Release(); Errors = NULL; }
-			}
+	// remember the state of the sources so that the next launch can skip preprocessing
+	if (!Cached) ShaderCache::Effects.UpdateEntry(EffectCompiledPath, EffectSourcePath, ConfigHash);
 
-			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
-			
-			success = true;
-		}
+	if (CompiledSource) CompiledSource->Release();
+	CompiledSource = EffectSource;
 
-		if (Compile || !CompiledExists || !Effect) {
-			// compile if option was enabled or compiled version not found
-			HRESULT compiled = D3DXCreateEffectCompiler(
-				(const char*)EffectSource->GetBufferPointer(), 
-				EffectSource->GetBufferSize(), 
-				NULL, 
-				NULL, 
-				NULL, 
-				&Compiler, 
-				&Errors
-			);
-			if (FAILED(compiled)) {
-				ReportError(compiled);
-				if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
-				if (Compiler) Compiler->Release();
-				if (EffectSource) EffectSource->Release();
-				if (Effect) Effect->Release();
-				if (Errors) Errors->Release();
-				Enabled = false;
-				return success;
-			}
-			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+	if (Compiler) Compiler->Release();
+	if (Errors) Errors->Release();
+	if (EffectBuffer) EffectBuffer->Release();
 
-			compiled = Compiler->CompileEffect(NULL, &EffectBuffer, &Errors);
-			if (FAILED(compiled)) {
-				ReportError(compiled);
-				if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
-				if (Compiler) Compiler->Release();
-				if (EffectSource) EffectSource->Release();
-				if (Effect) Effect->Release();
-				if (Errors) Errors->Release();
-				Enabled = false;
-				return success;
-			}
-			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+	timer.LogTime("EffectRecord::CompileEffect");
 
-			if (EffectBuffer) {
-				std::ofstream FileBinary(EffectCompiledPath, std::ios::out | std::ios::binary);
-				FileBinary.write((const char*)EffectBuffer->GetBufferPointer(), EffectBuffer->GetBufferSize());
-				FileBinary.flush();
-				FileBinary.close();
+	return true;
+}
 
-				std::ofstream FilePreprocess(EffectPreprocessedPath, std::ios::out | std::ios::binary);
-				FilePreprocess.write((const char*)EffectSource->GetBufferPointer(), EffectSource->GetBufferSize());
-				FilePreprocess.flush();
-				FilePreprocess.close();
+/*
+ * Creates the effect from the binary produced by CompileEffect. Uses the device, so it must run on the render thread.
+ * A cached binary the runtime refuses is compiled again once.
+ */
+bool EffectRecord::CreateEffect(bool Compiled) {
+	auto timer = TimeLogger();
 
-				Logger::Log("Effect compiled: %s", EffectPreprocessedPath);
-			}
+	ID3DXEffect* Effect = NULL;
+	ID3DXBuffer* Errors = NULL;
 
-			HRESULT loaded = D3DXCreateEffectFromFileA(TheRenderManager->device, EffectCompiledPath, NULL, NULL, D3DXFX_LARGEADDRESSAWARE, NULL, &Effect, &Errors);
-			if (FAILED(loaded)) {
-				ReportError(loaded);
-				if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
-				if (Compiler) Compiler->Release();
-				if (EffectSource) EffectSource->Release();
-				if (Effect) Effect->Release();
-				if (Errors) Errors->Release();
-				if (EffectBuffer) EffectBuffer->Release();
-				Enabled = false;
-				return success;
-			}
-			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+	char EffectSourcePath[MAX_PATH];
+	char EffectPreprocessedPath[MAX_PATH];
+	char EffectCompiledPath[MAX_PATH];
+
+	GetEffectPaths(EffectSourcePath, EffectPreprocessedPath, EffectCompiledPath);
 
-			success = true;
+	if (Compiled && CompiledSource) {
+		HRESULT loaded = CompiledBinary ?
+			D3DXCreateEffect(TheRenderManager->device, CompiledBinary->GetBufferPointer(), CompiledBinary->GetBufferSize(), NULL, NULL, D3DXFX_LARGEADDRESSAWARE, NULL, &Effect, &Errors) :
+			D3DXCreateEffectFromFileA(TheRenderManager->device, EffectCompiledPath, NULL, NULL, D3DXFX_LARGEADDRESSAWARE, NULL, &Effect, &Errors);
+		if (FAILED(loaded)) {
+			ReportError(loaded);
+			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+			if (Effect) { Effect->Release(); Effect = NULL; }
+			if (Errors) { Errors->Release(); Errors = NULL; }
+
+			ShaderCache::Effects.InvalidateEntry(EffectCompiledPath);
+			if (CompileEffect(true)) {
+				loaded = D3DXCreateEffectFromFileA(TheRenderManager->device, EffectCompiledPath, NULL, NULL, D3DXFX_LARGEADDRESSAWARE, NULL, &Effect, &Errors);
+				if (FAILED(loaded)) {
+					ReportError(loaded);
+					if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+					if (Effect) { Effect->Release(); Effect = NULL; }
+				}
+			}
 		}
-	}
-	else {
-		ReportError(prepass);
 		if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
 	}
 
 	if (Effect) {
 		this->Effect = Effect;
-		CreateCT(EffectSource, NULL); //Create the object which will associate a register index to a float pointer for constants updates;
+		CreateCT(CompiledSource, NULL); //Create the object which will associate a register index to a float pointer for constants updates;
 		Logger::Log("Effect loaded: %s", EffectCompiledPath);
 	}
 
 	// set enabled status of effect based on success and setting
 	Enabled = Effect != nullptr && TheSettingManager->GetMenuShaderEnabled(Name);
 
-	if (Compiler) Compiler->Release();
 	if (Errors) Errors->Release();
-	if (EffectBuffer) EffectBuffer->Release();
-	if (EffectSource) EffectSource->Release();
+	if (CompiledSource) CompiledSource->Release();
+	if (CompiledBinary) CompiledBinary->Release();
+	CompiledSource = NULL;
+	CompiledBinary = NULL;
 
-	timer.LogTime("EffectRecord::LoadEffect");
+	timer.LogTime("EffectRecord::CreateEffect");
 
-	return success;
+	return Effect != nullptr;
 }
 
 
@@ -210,6 +248,37 @@ bool EffectRecord::IsLoaded() {
 }
 
 
+/*
+* Checks the pixel shaders of every pass for a texkill instruction (clip or discard in HLSL).
+* The bytecode is walked instruction by instruction, skipping the comments holding the constant table.
+*/
+bool EffectRecord::HasDiscardingPass() {
+	D3DXEFFECT_DESC EffectDesc;
+	D3DXTECHNIQUE_DESC TechniqueDesc;
+	D3DXPASS_DESC PassDesc;
+
+	Effect->GetDesc(&EffectDesc);
+	for (UINT t = 0; t < EffectDesc.Techniques; t++) {
+		D3DXHANDLE Technique = Effect->GetTechnique(t);
+		Effect->GetTechniqueDesc(Technique, &TechniqueDesc);
+		for (UINT p = 0; p < TechniqueDesc.Passes; p++) {
+			if (FAILED(Effect->GetPassDesc(Effect->GetPass(Technique, p), &PassDesc)) || !PassDesc.pPixelShaderFunction) continue;
+
+			const DWORD* Token = PassDesc.pPixelShaderFunction + 1; // after the version
+			while ((*Token & 0xFFFF) != D3DSIO_END) {
+				DWORD Opcode = *Token & 0xFFFF;
+				if (Opcode == D3DSIO_TEXKILL) return true;
+				if (Opcode == D3DSIO_COMMENT)
+					Token += 1 + ((*Token & D3DSI_COMMENTSIZE_MASK) >> D3DSI_COMMENTSIZE_SHIFT);
+				else
+					Token += 1 + ((*Token & D3DSI_INSTLENGTH_MASK) >> D3DSI_INSTLENGTH_SHIFT);
+			}
+		}
+	}
+	return false;
+}
+
+
 /**
 Creates the Constant Table for the Effect Record.
 */
@@ -233,6 +302,9 @@ void EffectRecord::CreateCT(ID3DXBuffer* ShaderSource, ID3DXConstantTable* Const
 	}
 	FloatShaderValues = new ShaderFloatValue[FloatShaderValuesCount];
 	TextureShaderValues = new ShaderTextureValue[TextureShaderValuesCount];
+	RenderedBufferSampler = -1;
+	HasSourceBuffer = false;
+	DiscardsPixels = HasDiscardingPass();
 
 	//Logger::Debug("CreateCT: Effect has %i constants", ConstantTableDesc.Parameters);
 
@@ -265,6 +337,10 @@ void EffectRecord::CreateCT(ID3DXBuffer* ShaderSource, ID3DXConstantTable* Const
 				TextureShaderValues[TextureIndex].GetSamplerStateString(ShaderSource, TextureIndex);
 				TextureShaderValues[TextureIndex].GetTextureRecord();
 
+				// remember which buffers of the effects chain are sampled, to only copy the render target when needed
+				if (!strcmp(ConstantDesc.Name, "TESR_RenderedBuffer")) RenderedBufferSampler = TextureIndex;
+				if (!strcmp(ConstantDesc.Name, "TESR_SourceBuffer")) HasSourceBuffer = true;
+
 				TextureIndex++;
 			}
 			break;
@@ -356,7 +432,23 @@ void EffectRecord::Render(IDirect3DDevice9* Device, IDirect3DSurface9* RenderTar
 	}
 
 	auto timer = TimeLogger();
-	if (SourceBuffer) Device->StretchRect(RenderTarget, NULL, SourceBuffer, NULL, D3DTEXF_LINEAR);
+	UInt32 GpuScope = TheShaderManager->Profiler.BeginScope(Name);
+
+	// Effects in the chain (RenderedSurface set) ping-pong between the rendered buffer pair instead of copying the render target after every pass.
+	// The render target is copied once, into the source buffer if the effect samples it (it then also feeds the first pass), or into the rendered buffer.
+	// Passes that discard pixels leave what their target held, so it is first seeded with the previous pass output like the copy path did.
+	bool PingPong = RenderedSurface != nullptr && RenderedSurface != RenderTarget;
+	IDirect3DTexture9* PassInput = nullptr;
+	if (PingPong) {
+		if (SourceBuffer && HasSourceBuffer) {
+			Device->StretchRect(RenderTarget, NULL, SourceBuffer, NULL, D3DTEXF_NONE);
+			PassInput = TheTextureManager->SourceTexture;
+		}
+		else if (RenderedBufferSampler != -1) {
+			TheTextureManager->ResolveRenderedBuffer(RenderTarget);
+			PassInput = TheTextureManager->RenderedTexture;
+		}
+	}
 
 	try {
 		D3DXHANDLE technique = Effect->GetTechnique(techniqueIndex);
@@ -364,12 +456,25 @@ void EffectRecord::Render(IDirect3DDevice9* Device, IDirect3DSurface9* RenderTar
 		SetCT(); // update the constant table
 		UINT Passes;
 		Effect->Begin(&Passes, NULL);
+		IDirect3DSurface9* PassTargets[2] = { TheTextureManager->PingPongSurface, TheTextureManager->RenderedSurface };
+		IDirect3DTexture9* PassTextures[2] = { TheTextureManager->PingPongTexture, TheTextureManager->RenderedTexture };
 		for (UINT p = 0; p < Passes; p++) {
+			// intermediate passes alternate between the pair, the last one writes to the render target
+			bool Intermediate = PingPong && p < Passes - 1;
+			if (PingPong) {
+				IDirect3DSurface9* PassTarget = Intermediate ? PassTargets[p % 2] : RenderTarget;
+				IDirect3DSurface9* PreviousOutput = p ? PassTargets[(p - 1) % 2] : RenderTarget;
+				if (DiscardsPixels && !ClearRenderTarget && PassTarget != PreviousOutput) Device->StretchRect(PreviousOutput, NULL, PassTarget, NULL, D3DTEXF_NONE);
+				Device->SetRenderTarget(0, PassTarget);
+			}
+
 			if (ClearRenderTarget) Device->Clear(0L, NULL, D3DCLEAR_TARGET, D3DCOLOR_ARGB(255, 0, 0, 0), 1.0f, 0L);
 			Effect->BeginPass(p);
+			if (PassInput && RenderedBufferSampler != -1) Device->SetTexture(RenderedBufferSampler, PassInput);
 			Device->DrawPrimitive(D3DPT_TRIANGLESTRIP, 0, 2);
 			Effect->EndPass();
-			if (RenderedSurface) Device->StretchRect(RenderTarget, NULL, RenderedSurface, NULL, D3DTEXF_LINEAR); // copy the result from the pass into the texture
+
+			if (Intermediate) PassInput = PassTextures[p % 2];
 		}
 		Effect->End();
 	}
@@ -377,6 +482,10 @@ void EffectRecord::Render(IDirect3DDevice9* Device, IDirect3DSurface9* RenderTar
 		Logger::Log("Error during rendering of effect %s: %s", Name, e.what());
 	}
 
+	// the render target has changed, the rendered buffer doesn't hold a copy of it anymore
+	if (PingPong) TheTextureManager->InvalidateRenderedBuffer();
+
+	TheShaderManager->Profiler.EndScope(GpuScope);
 	std::string name = "EffectRecord::Render " + std::string(Name);
 	renderTime = timer.LogTime(name.c_str());
 }
@@ -9,6 +9,7 @@ public:
 	virtual void			CreateCT(ID3DXBuffer* ShaderSource, ID3DXConstantTable* ConstantTable);
 	virtual void			UpdateConstants() {};
 	virtual void			UpdateSettings() {};
+	virtual const char*		GetSettingsContext() { return NULL; }; // reimplement in subclasses whose settings depend on the game state
 	virtual void			RegisterConstants() {};
 	virtual void			RegisterTextures() {};
 	virtual bool			ShouldRender() { return true; }; // reimplement in subclasses to disable render under certain conditions
@@ -17,11 +18,20 @@ public:
 	void					ClearSampler(const char* TextureName, size_t Length);
 	void					DisposeEffect();
 	bool					LoadEffect();
+	bool					CompileEffect(bool Force = false);
+	bool					CreateEffect(bool Compiled);
+	void					GetEffectPaths(char* SourcePath, char* PreprocessedPath, char* CompiledPath);
+	bool					HasDiscardingPass();
 
 	bool 					IsLoaded();
 	bool					Enabled;
 	float					renderTime;
 	float					constantUpdateTime;
+	SInt32					RenderedBufferSampler;	// sampler index of TESR_RenderedBuffer, -1 if the effect doesn't sample it
+	bool					HasSourceBuffer;
+	bool					DiscardsPixels;			// a pass uses clip or discard, its target must hold the previous pass output
+	ID3DXBuffer*			CompiledSource;			// preprocessed source kept between CompileEffect and CreateEffect
+	ID3DXBuffer*			CompiledBinary;			// binary found in the shader archive, kept between CompileEffect and CreateEffect
 
 	ID3DXEffect* Effect;
 	const char* Name;
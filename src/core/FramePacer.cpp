@@ -0,0 +1,165 @@
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+WindowsFrameClock::WindowsFrameClock() {
+
+	LARGE_INTEGER Value;
+
+	QueryPerformanceFrequency(&Value); Frequency = Value.QuadPart;
+	QueryPerformanceCounter(&Value); Start = Value.QuadPart;
+
+	Timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	HighResolution = Timer != NULL;
+	if (!HighResolution) {
+		Timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+		timeBeginPeriod(1);
+	}
+	Logger::Log("Frame pacing with %s waitable timer.", HighResolution ? "a high resolution" : "a standard");
+
+}
+
+WindowsFrameClock::~WindowsFrameClock() {
+
+	if (Timer) CloseHandle(Timer);
+	if (!HighResolution) timeEndPeriod(1);
+
+}
+
+double WindowsFrameClock::Now() {
+
+	LARGE_INTEGER Value;
+
+	QueryPerformanceCounter(&Value);
+	return (double)(Value.QuadPart - Start) * 1000.0 / (double)Frequency;
+
+}
+
+void WindowsFrameClock::Wait(double Duration) {
+
+	LARGE_INTEGER DueTime;
+
+	if (!Timer) {
+		Sleep((DWORD)Duration);
+		return;
+	}
+	DueTime.QuadPart = -(LONGLONG)(Duration * 10000.0); // relative, in 100 ns units
+	if (SetWaitableTimer(Timer, &DueTime, 0, NULL, NULL, FALSE)) WaitForSingleObject(Timer, INFINITE);
+
+}
+
+void WindowsFrameClock::Spin() {
+
+	YieldProcessor();
+
+}
+
+
+FrameTimeStats::FrameTimeStats() {
+
+	Clear();
+
+}
+
+void FrameTimeStats::Add(double FrameTime) {
+
+	Samples[Next] = FrameTime;
+	Next = (Next + 1) % WindowSize;
+	Count = min(Count + 1, WindowSize);
+
+}
+
+/*
+* Nearest rank percentile of the window, 0 when empty.
+*/
+double FrameTimeStats::GetPercentile(double Percentile) {
+
+	double Sorted[WindowSize];
+
+	if (!Count) return 0.0;
+
+	memcpy(Sorted, Samples, Count * sizeof(double));
+	UInt32 Rank = (UInt32)ceil(Percentile / 100.0 * Count);
+	UInt32 Index = min(max(Rank, 1u), Count) - 1;
+	std::nth_element(Sorted, Sorted + Index, Sorted + Count);
+	return Sorted[Index];
+
+}
+
+void FrameTimeStats::Clear() {
+
+	memset(Samples, 0, sizeof(Samples));
+	Count = 0;
+	Next = 0;
+
+}
+
+
+FramePacer::FramePacer(FrameClock* PacerClock) {
+
+	Clock = PacerClock;
+	TargetDuration = 0.0;
+	LastSync = -1.0;
+	SpinMargin = 1.0;
+	OvershootAverage = 0.0;
+	PredictedFrameTime = 0.0;
+
+}
+
+/*
+* Waits for the end of the frame. Returns the duration in ms since the previous sync, 0 on the first one.
+*/
+double FramePacer::Sync() {
+
+	double Now = Clock->Now();
+	double Previous = LastSync;
+	double Target = LastSync + TargetDuration;
+
+	if (LastSync < 0.0 || Now >= Target) {
+		LastSync = Now;
+		return Previous < 0.0 ? 0.0 : Now - Previous;
+	}
+
+	double WakeTime = Target - SpinMargin;
+	if (WakeTime > Now) {
+		Clock->Wait(WakeTime - Now);
+		Now = Clock->Now();
+		Calibrate(Now - WakeTime);
+	}
+	while (Now < Target) {
+		Clock->Spin();
+		Now = Clock->Now();
+	}
+
+	// overshooting the whole spin margin is rare, the schedule is kept unless the frame is already lost
+	LastSync = (Now - Target < TargetDuration) ? Target : Now;
+	return LastSync - Previous;
+
+}
+
+/*
+* The margin follows twice the average overshoot, jumps up at once on a spike and slowly shrinks back.
+*/
+void FramePacer::Calibrate(double Overshoot) {
+
+	Overshoot = max(Overshoot, 0.0);
+	OvershootAverage += (Overshoot - OvershootAverage) * 0.1;
+	SpinMargin = max(SpinMargin * 0.99, OvershootAverage * 2.0);
+	if (Overshoot > SpinMargin) SpinMargin = Overshoot;
+	SpinMargin = min(max(SpinMargin, MinSpinMargin), MaxSpinMargin);
+
+}
+
+/*
+* Exponential smoothing of the frame time given to the game: 0 returns the measured time, values close to 1 follow it slowly.
+*/
+double FramePacer::Predict(double FrameTime, float Smoothing) {
+
+	if (Smoothing <= 0.0f || PredictedFrameTime <= 0.0) {
+		PredictedFrameTime = FrameTime;
+		return FrameTime;
+	}
+	PredictedFrameTime += (FrameTime - PredictedFrameTime) * (1.0 - min(Smoothing, 0.95f));
+	return PredictedFrameTime;
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+* Time source of the frame pacer, in ms. The pacer only goes through it, so it can be driven by a simulated clock.
+*/
+class FrameClock {
+public:
+	virtual double		Now() = 0;
+	virtual void		Wait(double Duration) = 0;	// coarse wait, can overshoot
+	virtual void		Spin() = 0;					// one iteration of the final busy wait
+};
+
+
+/*
+* Performance counter clock. Coarse waits use a high resolution waitable timer (Windows 10 1803 and later),
+* or a standard waitable timer with a 1 ms system timer period on older systems.
+*/
+class WindowsFrameClock : public FrameClock {
+public:
+	WindowsFrameClock();
+	~WindowsFrameClock();
+
+	double				Now();
+	void				Wait(double Duration);
+	void				Spin();
+
+	LONGLONG			Frequency;
+	LONGLONG			Start;
+	HANDLE				Timer;
+	bool				HighResolution;
+};
+
+
+/*
+* Frame times of the last WindowSize frames, for the percentiles shown in the menu.
+*/
+class FrameTimeStats {
+public:
+	static const UInt32	WindowSize = 256;
+
+	FrameTimeStats();
+
+	void				Add(double FrameTime);
+	double				GetPercentile(double Percentile);
+	void				Clear();
+
+	double				Samples[WindowSize];
+	UInt32				Count;
+	UInt32				Next;
+};
+
+
+/*
+* Caps the frame rate on a fixed schedule: each sync waits until TargetDuration after the previous one.
+* The coarse wait wakes SpinMargin ms early and the rest is spun, the margin follows the measured overshoot of the coarse waits.
+* A late frame restarts the schedule instead of shortening the following ones.
+*/
+class FramePacer {
+public:
+	static constexpr double MinSpinMargin = 0.1;
+	static constexpr double MaxSpinMargin = 4.0;
+
+	FramePacer(FrameClock* PacerClock);
+
+	double				Sync();
+	double				Predict(double FrameTime, float Smoothing);
+	void				SetTarget(double Duration) { TargetDuration = Duration; }
+
+	FrameClock*			Clock;
+	double				TargetDuration;
+	double				LastSync;
+	double				SpinMargin;
+	double				OvershootAverage;
+	double				PredictedFrameTime;
+
+private:
+	void				Calibrate(double Overshoot);
+};
@@ -13,6 +13,7 @@ void FrameRateManager::Initialize() {
 	TheFrameRateManager->SmartControlMPF = 1000.0 / TheSettingManager->SettingsMain.FrameRate.SmartControlFPS;
 	QueryPerformanceFrequency(&Frequency); TheFrameRateManager->PerformanceFrequency = Frequency.QuadPart;
 	QueryPerformanceCounter(&PerformanceCounter); TheFrameRateManager->PerformanceCounterStart = PerformanceCounter.QuadPart;
+	TheFrameRateManager->Pacer = new FramePacer(new WindowsFrameClock());
 
 }
 
@@ -24,6 +25,7 @@ void FrameRateManager::UpdatePerformance() {
 	Time = (double)(PerformanceCounterEnd.QuadPart - PerformanceCounterStart) / (double)PerformanceFrequency;
 	ElapsedTime = Time - LastTime;
 	LastTime = Time;
+	FrameTimes.Add(ElapsedTime * 1000.0);
 
 }
 
@@ -38,14 +40,17 @@ double FrameRateManager::GetPerformance() {
 
 void FrameRateManager::PerformSync() {
 
-	double CurrentPerformance = GetPerformance();
-	double FrameTime = CurrentPerformance - LastPerformance;
+	TraceZone Zone("FrameRateManager::PerformSync");
+
+	SettingsMainStruct::FrameRateStruct* FrameRate = &TheSettingManager->SettingsMain.FrameRate;
 	float NMPF = 0.0f;
 
 	*Pointers::Generic::MPF = NMPF;
-	if (FrameTime < SmartControlMPF) Sleep(SmartControlMPF - FrameTime);
+	SmartControlMPF = 1000.0 / max(FrameRate->SmartControlFPS, 1);
+	Pacer->SetTarget(SmartControlMPF);
+	double FramePeriod = Pacer->Sync(); // frame time including the wait
 	LastPerformance = GetPerformance();
-	NMPF = (float)(FrameTime + TheSettingManager->SettingsMain.FrameRate.FlowControl + (LastPerformance - CurrentPerformance));
+	NMPF = (float)(Pacer->Predict(FramePeriod, FrameRate->FrameSmoothing) + FrameRate->FlowControl);
 	if (NMPF >= 10.0f && NMPF <= 120.0f) *Pointers::Generic::MPF = NMPF;
 	
 }
\ No newline at end of file
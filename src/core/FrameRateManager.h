@@ -1,4 +1,5 @@
 #pragma once
+#include "FramePacer.h"
 
 class FrameRateManager { // Never disposed
 public:
@@ -16,4 +17,6 @@ public:
 	double			ElapsedTime;
 	double			SmartControlMPF;
 	double			LastPerformance;
+	FramePacer*		Pacer;
+	FrameTimeStats	FrameTimes;		// ms, fed every frame
 };
\ No newline at end of file
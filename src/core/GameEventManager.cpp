@@ -11,7 +11,7 @@ void GameEventManager::OnHitByPlayer() {
 
 	if (TheShaderManager->Effects.BloodLens->Constants.Percent == 0) {
 		RandomPercent = (double)rand() / (RAND_MAX + 1) * (100 - 1) + 1;
-		if (RandomPercent <= TheSettingManager->GetSettingF("Shaders.BloodLens.Main", "Chance")) TheShaderManager->Effects.BloodLens->Constants.Percent = 1;
+		if (RandomPercent <= TheShaderManager->Effects.BloodLens->Chance) TheShaderManager->Effects.BloodLens->Constants.Percent = 1;
 	}
 
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "Device/Device.h"
+
 #define MenuSettings TheSettingManager->SettingsMain.Menu
 #define TextColorNormal D3DCOLOR_XRGB(MenuSettings.TextColorNormal[0], MenuSettings.TextColorNormal[1], MenuSettings.TextColorNormal[2])
 #define TextShadowColorNormal D3DCOLOR_XRGB(MenuSettings.TextShadowColorNormal[0], MenuSettings.TextShadowColorNormal[1], MenuSettings.TextShadowColorNormal[2])
@@ -381,7 +383,6 @@ void GameMenuManager::HandleInput() {
 			else if (SelectedColumn == COLUMNS::SETTINGS) {
 				TheSettingManager->Increment(SelectedNode.Section, SelectedNode.Key);
 			}
-			TheSettingManager->LoadSettings(); //update constants stored in Settings structs
 		}
 		else if (IsKeyPressed(MenuSettings.KeySubtract)) {
 			//Logger::Log("Subtract for %s.%s, isShader Section? %i, isStatusSection? %i, Column %i", SelectedNode.Section, SelectedNode.Key, isShaderSection, isStatusSection, SelectedColumn);
@@ -395,7 +396,6 @@ void GameMenuManager::HandleInput() {
 			else if (SelectedColumn == COLUMNS::SETTINGS) {
 				TheSettingManager->Decrement(SelectedNode.Section, SelectedNode.Key);
 			}
-			TheSettingManager->LoadSettings(); //update constants stored in Settings structs
 		}
 	}
 }
@@ -488,6 +488,17 @@ void GameMenuManager::Render() {
 
 	if (TheSettingManager->hasUnsavedChanges)
 		DrawShadowedText(std::string("/!\\ You have unsaved changes. To avoid losing them, save them using the " + GetKeyName(MenuSettings.KeySave) + " Key").c_str(), MainColumnWidth * 3, 0, MainColumnWidth * 2, TextColorEditing, FontNormal, DT_LEFT);
+	else if (TheSettingManager->SettingsMain.Develop.DebugMode) {
+		// frame time percentiles of the last frames
+		FrameTimeStats* FrameTimes = &TheFrameRateManager->FrameTimes;
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(2) << "Frame p50 " << FrameTimes->GetPercentile(50.0) << " ms | p99 " << FrameTimes->GetPercentile(99.0) << " ms";
+		ss << std::setprecision(1) << " | Targets " << TheTextureManager->GetTargetsMemory(NULL) / (1024.0f * 1024.0f) << " MB";
+		if (TESRDirect3DDevice9* Device = TESRDirect3DDevice9::Instance)
+			ss << " | States " << Device->LastFrame.Forwarded << " set, " << Device->LastFrame.Filtered << " filtered";
+		ss << " | Shaders " << ShaderRecord::DeviceShaders.GetProgramsCount() << " unique of " << ShaderRecord::DeviceShaders.GetUsersCount();
+		DrawShadowedText(ss.str().c_str(), 0, 0, 3 * ItemColumnWidth, TextColorNormal, FontNormal, DT_RIGHT);
+	}
 
 	DrawLine(0, textSize + RowSpace, 3 * ItemColumnWidth); 	// draw line under Title
 
@@ -551,7 +562,9 @@ void GameMenuManager::Render() {
 			if (effect && TheSettingManager->SettingsMain.Develop.DebugMode) { 
 				std::stringstream ss;
 
+				GpuProfiler* Profiler = &TheShaderManager->Profiler;
 				float total = max(effect->renderTime + effect->constantUpdateTime, 0);
+				float gpuTotal = Profiler->GetTime(effect->Name);
 
 				// in the case of Shadows, we add the time spent rendering the shadows buffer and shadow maps
 				if ((effect == TheShaderManager->Effects.ShadowsExteriors && TheShaderManager->GameState.isExterior)|| 
@@ -561,13 +574,22 @@ void GameMenuManager::Render() {
 					total += TheShaderManager->Effects.PointShadows2->renderTime;
 					total += TheShaderManager->Effects.SunShadows->renderTime;
 					total += TheShadowManager->shadowMapsRenderTime;
+
+					gpuTotal += Profiler->GetTime(TheShaderManager->Effects.PointShadows->Name);
+					gpuTotal += Profiler->GetTime(TheShaderManager->Effects.PointShadows2->Name);
+					gpuTotal += Profiler->GetTime(TheShaderManager->Effects.SunShadows->Name);
+					gpuTotal += Profiler->GetTime("ShadowMaps");
 				}
 
-				if (!TheSettingManager->SettingsMain.Main.RenderEffects) total = 0;
+				if (!TheSettingManager->SettingsMain.Main.RenderEffects) total = gpuTotal = 0;
+
+				ss << std::fixed << std::setprecision(4) << total << " ms";
+				if (Profiler->Supported) ss << " | GPU " << gpuTotal << " ms";
 
-				ss << std::fixed << std::setprecision(4) << total;
+				// video memory of the render targets created by the effect
+				UInt32 targetsMemory = TheTextureManager->GetTargetsMemory(effect);
+				if (targetsMemory) ss << std::setprecision(1) << " | " << targetsMemory / (1024.0f * 1024.0f) << " MB";
 				std::string duration = ss.str();
-				duration += " ms";
 
 				//Logger::Log("%s render time: %s", Sections[i].c_str(), duration.c_str());
 
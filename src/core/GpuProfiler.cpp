@@ -0,0 +1,219 @@
+GpuTimings::GpuTimings() {
+
+	FramesCommitted = 0;
+	FramesDropped = 0;
+
+}
+
+
+void GpuTimings::BeginFrame() {
+	for (auto& Entry : Entries) Entry.second.FrameTime = 0.0f;
+}
+
+
+/*
+* Adds the duration in ms of a scope, given its raw timestamps and the timestamp frequency of the frame.
+*/
+void GpuTimings::AddScope(const char* Name, UInt64 Begin, UInt64 End, UInt64 Frequency) {
+	if (!Frequency || End < Begin) return;
+
+	auto Item = Entries.try_emplace(Name);
+	Series& Entry = Item.first->second;
+	if (Item.second) {
+		memset(&Entry, 0, sizeof(Series));
+	}
+	Entry.FrameTime += (float)((double)(End - Begin) * 1000.0 / (double)Frequency);
+}
+
+
+void GpuTimings::EndFrame(bool Disjoint) {
+	if (Disjoint) {
+		FramesDropped++;
+		return;
+	}
+
+	for (auto& Item : Entries) {
+		Series& Entry = Item.second;
+		if (Entry.Count == WindowSize) Entry.Sum -= Entry.Samples[Entry.Next];
+		Entry.Samples[Entry.Next] = Entry.FrameTime;
+		Entry.Sum += Entry.FrameTime;
+		Entry.Next = (Entry.Next + 1) % WindowSize;
+		Entry.Count = min(Entry.Count + 1, WindowSize);
+	}
+	FramesCommitted++;
+}
+
+
+/*
+* Returns the average GPU time per frame of the scope in ms, 0 if it was never measured.
+*/
+float GpuTimings::GetAverage(const char* Name) {
+	auto Item = Entries.find(Name);
+	if (Item == Entries.end() || !Item->second.Count) return 0.0f;
+
+	return max(Item->second.Sum / Item->second.Count, 0.0f);
+}
+
+
+void GpuTimings::Clear() {
+	Entries.clear();
+	FramesCommitted = 0;
+	FramesDropped = 0;
+}
+
+
+GpuProfiler::GpuProfiler() {
+
+	Supported = false;
+	Device = NULL;
+	FrameIndex = 0;
+	InFrame = false;
+	memset(Frames, 0, sizeof(Frames));
+
+}
+
+
+/*
+* Creates the per frame queries. Scope queries are created on demand, the first time a frame has that many scopes.
+*/
+bool GpuProfiler::Initialize() {
+	Device = TheRenderManager->device;
+
+	IDirect3DQuery9* Query = NULL;
+	if (FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &Query)) || FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, NULL)) || FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, NULL))) {
+		Logger::Log("GPU profiler: timestamp queries are not supported by the device.");
+		if (Query) Query->Release();
+		return false;
+	}
+	Query->Release();
+
+	for (UInt32 i = 0; i < FramesLatency; i++) {
+		if (FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, &Frames[i].Disjoint)) || FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, &Frames[i].Frequency))) {
+			Logger::Log("GPU profiler: cannot create the frame queries.");
+			Release();
+			return false;
+		}
+	}
+	Supported = true;
+	return true;
+}
+
+
+void GpuProfiler::Release() {
+	for (UInt32 i = 0; i < FramesLatency; i++) {
+		Frame& Item = Frames[i];
+		if (Item.Disjoint) Item.Disjoint->Release();
+		if (Item.Frequency) Item.Frequency->Release();
+		for (UInt32 s = 0; s < Item.QueriesCount; s++) {
+			Item.Scopes[s].Begin->Release();
+			Item.Scopes[s].End->Release();
+		}
+	}
+	memset(Frames, 0, sizeof(Frames));
+	Timings.Clear();
+	Supported = false;
+	InFrame = false;
+}
+
+
+/*
+* Reads back the oldest frame, which reuses the queries of the new one, and opens the new frame.
+* The profiler only runs in debug mode, where the timings are shown in the menu.
+*/
+void GpuProfiler::BeginFrame() {
+	if (!TheSettingManager->SettingsMain.Develop.DebugMode) return;
+	if (!Device && !Initialize()) return;
+	if (!Supported) return;
+
+	Frame* Item = &Frames[FrameIndex];
+	if (Item->Issued) ReadFrame(Item);
+
+	Item->ScopesCount = 0;
+	Item->Issued = false;
+	Item->Disjoint->Issue(D3DISSUE_BEGIN);
+	Item->Frequency->Issue(D3DISSUE_END);
+	InFrame = true;
+}
+
+
+void GpuProfiler::EndFrame() {
+	if (!InFrame) return;
+
+	Frame* Item = &Frames[FrameIndex];
+	Item->Disjoint->Issue(D3DISSUE_END);
+	Item->Issued = true;
+	FrameIndex = (FrameIndex + 1) % FramesLatency;
+	InFrame = false;
+}
+
+
+/*
+* Issues the begin timestamp of a scope and returns its index for EndScope, InvalidScope when not profiling.
+*/
+UInt32 GpuProfiler::BeginScope(const char* Name) {
+	StateCapture::BeginPass(Name); // the scopes are also the passes of the state capture
+	if (!InFrame) return InvalidScope;
+
+	Frame* Item = &Frames[FrameIndex];
+	if (Item->ScopesCount == MaxScopes) return InvalidScope;
+
+	UInt32 Index = Item->ScopesCount;
+	Scope* Entry = &Item->Scopes[Index];
+	if (Index == Item->QueriesCount) {
+		if (FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &Entry->Begin))) return InvalidScope;
+		if (FAILED(Device->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &Entry->End))) {
+			Entry->Begin->Release();
+			Entry->Begin = NULL;
+			return InvalidScope;
+		}
+		Item->QueriesCount++;
+	}
+
+	Entry->Name = Name;
+	Entry->Begin->Issue(D3DISSUE_END);
+	Item->ScopesCount++;
+	return Index;
+}
+
+
+void GpuProfiler::EndScope(UInt32 Index) {
+	StateCapture::EndPass();
+	if (!InFrame || Index == InvalidScope) return;
+
+	Frames[FrameIndex].Scopes[Index].End->Issue(D3DISSUE_END);
+}
+
+
+/*
+* Gets the results of a frame without flushing. If any of them isn't available yet the frame is dropped.
+*/
+void GpuProfiler::ReadFrame(Frame* Item) {
+	BOOL Disjoint = TRUE;
+	UINT64 Frequency = 0;
+
+	if (Item->Disjoint->GetData(&Disjoint, sizeof(BOOL), 0) != S_OK || Item->Frequency->GetData(&Frequency, sizeof(UINT64), 0) != S_OK) {
+		Timings.FramesDropped++;
+		return;
+	}
+
+	Timings.BeginFrame();
+	for (UInt32 i = 0; i < Item->ScopesCount; i++) {
+		Scope* Entry = &Item->Scopes[i];
+		UINT64 Begin = 0;
+		UINT64 End = 0;
+		if (Entry->Begin->GetData(&Begin, sizeof(UINT64), 0) != S_OK || Entry->End->GetData(&End, sizeof(UINT64), 0) != S_OK) {
+			Timings.FramesDropped++;
+			return;
+		}
+		Timings.AddScope(Entry->Name, Begin, End, Frequency);
+	}
+	Timings.EndFrame(Disjoint);
+}
+
+
+void GpuProfiler::LogTimings() {
+	Logger::Log("GPU timings, average of the last %u frames (%u dropped):", GpuTimings::WindowSize, Timings.FramesDropped);
+	for (auto& Item : Timings.Entries) {
+		Logger::Log("%s: %.4f ms", Item.first.c_str(), GetTime(Item.first.c_str()));
+	}
+}
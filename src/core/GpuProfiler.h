@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+* Rolling averages of GPU durations by scope name, fed with the raw timestamps read back by the profiler.
+* The scopes of a frame are summed by name (a pass rendered for every cascade gives one sample per frame) and every known
+* scope gets a sample per committed frame, 0 if it didn't run, so the averages are a cost per frame. Disjoint frames are dropped.
+* It only does the bookkeeping and doesn't touch the device.
+*/
+class GpuTimings {
+public:
+	static const UInt32	WindowSize = 64;
+
+	struct Series {
+		float	Samples[WindowSize];
+		float	Sum;
+		float	FrameTime;	// accumulated for the frame being read
+		UInt32	Count;
+		UInt32	Next;
+	};
+
+	GpuTimings();
+
+	void				BeginFrame();
+	void				AddScope(const char* Name, UInt64 Begin, UInt64 End, UInt64 Frequency);
+	void				EndFrame(bool Disjoint);
+	float				GetAverage(const char* Name);
+	void				Clear();
+
+	std::map<std::string, Series>	Entries;
+	UInt32				FramesCommitted;
+	UInt32				FramesDropped;
+};
+
+
+/*
+* Measures the GPU time of scopes with D3DQUERYTYPE_TIMESTAMP pairs, inside a TIMESTAMPDISJOINT query per frame.
+* Queries of a frame are read back FramesLatency frames later without flushing; a frame whose results are not ready by then is dropped
+* instead of stalling the CPU. Scopes can nest and repeat, the averages are kept in Timings by name.
+* Name pointers must stay valid until the frame is read back (string literals or effect names).
+*/
+class GpuProfiler {
+public:
+	static const UInt32	FramesLatency = 4;
+	static const UInt32	MaxScopes = 256;	// per frame
+	static const UInt32	InvalidScope = 0xFFFFFFFF;
+
+	struct Scope {
+		const char*			Name;
+		IDirect3DQuery9*	Begin;
+		IDirect3DQuery9*	End;
+	};
+
+	struct Frame {
+		IDirect3DQuery9*	Disjoint;
+		IDirect3DQuery9*	Frequency;
+		Scope				Scopes[MaxScopes];
+		UInt32				ScopesCount;
+		UInt32				QueriesCount;	// scopes with created queries
+		bool				Issued;
+	};
+
+	GpuProfiler();
+
+	void				BeginFrame();
+	void				EndFrame();
+	UInt32				BeginScope(const char* Name);
+	void				EndScope(UInt32 Index);
+	float				GetTime(const char* Name) { return Timings.GetAverage(Name); }
+	void				LogTimings();
+	void				Release();
+
+	GpuTimings			Timings;
+	bool				Supported;
+
+private:
+	bool				Initialize();
+	void				ReadFrame(Frame* Item);
+
+	IDirect3DDevice9*	Device;
+	Frame				Frames[FramesLatency];
+	UInt32				FrameIndex;
+	bool				InFrame;
+};
@@ -0,0 +1,122 @@
+#include "InstanceStream.h"
+#include "Device/Device.h"
+
+IDirect3DVertexBuffer9* InstanceStream::Buffer = NULL;
+UInt32 InstanceStream::Offset = 0;
+UInt32 InstanceStream::Next = 0;
+std::unordered_map<IDirect3DVertexDeclaration9*, InstanceStream::Declaration> InstanceStream::Declarations;
+
+
+/*
+* Returns the declaration of the geometry with the instance stream added after its streams, created once per declaration.
+* The world transform columns are read as TEXCOORD4 to TEXCOORD6, a declaration already using them is not extended.
+*/
+InstanceStream::Declaration InstanceStream::GetDeclaration(IDirect3DDevice9* Device, IDirect3DVertexDeclaration9* GeometryDeclaration) {
+	auto Item = Declarations.find(GeometryDeclaration);
+	if (Item != Declarations.end()) return Item->second;
+
+	Declaration Instanced = { NULL, 0 };
+	D3DVERTEXELEMENT9 Elements[MAXD3DDECLLENGTH + 1];
+	UINT Count = 0;
+
+	RegisterReset();
+	if (SUCCEEDED(GeometryDeclaration->GetDeclaration(NULL, &Count)) && Count + 3 <= MAXD3DDECLLENGTH + 1 && SUCCEEDED(GeometryDeclaration->GetDeclaration(Elements, &Count))) {
+		bool Valid = true;
+		Count--; // D3DDECL_END
+		for (UINT i = 0; i < Count; i++) {
+			if (Elements[i].Usage == D3DDECLUSAGE_TEXCOORD && Elements[i].UsageIndex >= 4 && Elements[i].UsageIndex <= 6) Valid = false;
+			Instanced.Stream = max(Instanced.Stream, Elements[i].Stream + 1U);
+		}
+		if (Valid) {
+			for (BYTE c = 0; c < 3; c++) {
+				Elements[Count++] = { (WORD)Instanced.Stream, (WORD)(c * 16), D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, (BYTE)(4 + c) };
+			}
+			Elements[Count] = D3DDECL_END();
+			if (FAILED(Device->CreateVertexDeclaration(Elements, &Instanced.Extended))) Instanced.Extended = NULL;
+		}
+	}
+
+	GeometryDeclaration->AddRef(); // the key must not be released and its address reused by another declaration
+	Declarations[GeometryDeclaration] = Instanced;
+	return Instanced;
+}
+
+
+/*
+* Locks the room of Count instances in the ring buffer, after the ones the GPU can still read. Returns NULL if the buffer cannot be
+* created or locked, Buffer is still NULL in the first case.
+*/
+float* InstanceStream::Lock(IDirect3DDevice9* Device, UInt32 Count) {
+	if (!Buffer) {
+		if (FAILED(Device->CreateVertexBuffer(BufferSize * Stride, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &Buffer, NULL))) {
+			Logger::Log("[ERROR]: Could not create the instance buffer, instancing disabled.");
+			Buffer = NULL;
+			return NULL;
+		}
+		RegisterReset();
+		Next = 0;
+	}
+
+	DWORD LockFlags = D3DLOCK_NOOVERWRITE;
+	if (Next + Count > BufferSize) {
+		Next = 0;
+		LockFlags = D3DLOCK_DISCARD;
+	}
+	float* Instances = NULL;
+	if (FAILED(Buffer->Lock(Next * Stride, Count * Stride, (void**)&Instances, LockFlags))) return NULL;
+
+	Offset = Next;
+	Next += Count;
+	return Instances;
+}
+
+
+void InstanceStream::Unlock() {
+	Buffer->Unlock();
+}
+
+
+/*
+* Draws the geometry streams Count times, reading the instances of the last lock.
+*/
+void InstanceStream::Bind(IDirect3DDevice9* Device, const Declaration& Instanced, UInt32 GeometryStreams, UInt32 Count) {
+	for (UInt32 i = 0; i < GeometryStreams; i++) {
+		Device->SetStreamSourceFreq(i, D3DSTREAMSOURCE_INDEXEDDATA | Count);
+	}
+	Device->SetStreamSource(Instanced.Stream, Buffer, Offset * Stride, Stride);
+	Device->SetStreamSourceFreq(Instanced.Stream, D3DSTREAMSOURCE_INSTANCEDATA | 1);
+}
+
+
+void InstanceStream::Unbind(IDirect3DDevice9* Device, const Declaration& Instanced, UInt32 GeometryStreams) {
+	for (UInt32 i = 0; i < GeometryStreams; i++) {
+		Device->SetStreamSourceFreq(i, 1);
+	}
+	Device->SetStreamSourceFreq(Instanced.Stream, 1);
+	Device->SetStreamSource(Instanced.Stream, NULL, 0, 0);
+}
+
+
+/*
+* Releases the instance buffer and the extended declarations with the references held on their keys.
+* Called before the device is reset, the buffer must not be alive then.
+*/
+void InstanceStream::Release() {
+	if (Buffer) Buffer->Release();
+	Buffer = NULL;
+	Offset = Next = 0;
+
+	for (auto& Item : Declarations) {
+		if (Item.second.Extended) Item.second.Extended->Release();
+		Item.first->Release();
+	}
+	Declarations.clear();
+}
+
+
+void InstanceStream::RegisterReset() {
+	static bool Registered = false;
+
+	if (!Registered) TESRDirect3DDevice9::AddResetCallback(Release);
+	Registered = true;
+}
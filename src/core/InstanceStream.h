@@ -0,0 +1,33 @@
+#pragma once
+
+#include <unordered_map>
+
+/*
+* Per instance stream of the instanced draws: a ring buffer of world transforms, and the geometry declarations extended to read it.
+* The buffer is in the default pool, so everything is released by a reset callback of the device proxy and created again on the next draw.
+*/
+class InstanceStream {
+public:
+	static const UInt32 BufferSize = 8192;	// instances in the ring buffer
+	static const UInt32 Stride = 48;		// 3 columns of the world transform
+
+	struct Declaration {
+		IDirect3DVertexDeclaration9*	Extended;	// geometry declaration with the instance stream, NULL if it cannot be extended
+		UInt32							Stream;		// stream of the instance data
+	};
+
+	static Declaration		GetDeclaration(IDirect3DDevice9* Device, IDirect3DVertexDeclaration9* GeometryDeclaration);
+	static float*			Lock(IDirect3DDevice9* Device, UInt32 Count);
+	static void				Unlock();
+	static void				Bind(IDirect3DDevice9* Device, const Declaration& Instanced, UInt32 GeometryStreams, UInt32 Count);
+	static void				Unbind(IDirect3DDevice9* Device, const Declaration& Instanced, UInt32 GeometryStreams);
+	static void				Release();
+
+	static IDirect3DVertexBuffer9*	Buffer;
+	static UInt32					Offset;		// first instance of the last lock
+	static UInt32					Next;		// first free instance of the ring buffer
+	static std::unordered_map<IDirect3DVertexDeclaration9*, Declaration> Declarations;
+
+private:
+	static void				RegisterReset();
+};
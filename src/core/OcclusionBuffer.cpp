@@ -0,0 +1,257 @@
+OcclusionBuffer::OcclusionBuffer() {
+
+	Width = 0;
+	Height = 0;
+	Pitch = 0;
+	TilesX = 0;
+	TilesY = 0;
+	TrianglesDrawn = 0;
+	OccludeesTested = 0;
+	OccludeesCulled = 0;
+	ReversedDepth = false;
+	Depth = NULL;
+	TileDepth = NULL;
+
+}
+
+OcclusionBuffer::~OcclusionBuffer() {
+
+	if (Depth) _mm_free(Depth);
+	if (TileDepth) _mm_free(TileDepth);
+
+}
+
+void OcclusionBuffer::Initialize(UInt32 BufferWidth, UInt32 BufferHeight) {
+
+	if (Depth) _mm_free(Depth);
+	if (TileDepth) _mm_free(TileDepth);
+
+	Width = BufferWidth;
+	Height = BufferHeight;
+	Pitch = (Width + 3) & ~3;
+	TilesX = (Width + TileSize - 1) / TileSize;
+	TilesY = (Height + TileSize - 1) / TileSize;
+	Depth = (float*)_mm_malloc(Pitch * Height * sizeof(float), 16);
+	TileDepth = (float*)_mm_malloc(TilesX * TilesY * sizeof(float), 16);
+	Clear(ReversedDepth);
+
+}
+
+/*
+* Clears to the far plane. Reversed tells if the projection used to draw and test this frame maps the near plane to 1.
+*/
+void OcclusionBuffer::Clear(bool Reversed) {
+
+	float Far = Reversed ? 0.0f : 1.0f;
+
+	ReversedDepth = Reversed;
+	std::fill(Depth, Depth + Pitch * Height, Far);
+	std::fill(TileDepth, TileDepth + TilesX * TilesY, Far);
+	TrianglesDrawn = 0;
+	OccludeesTested = 0;
+	OccludeesCulled = 0;
+
+}
+
+/*
+* Draws indexed triangles (list or strip) given in object space. Vertices are transformed once, triangles are clipped against the near plane only,
+* the other planes are handled by the screen bounds of the rasterizer.
+*/
+void OcclusionBuffer::DrawTriangles(const NiPoint3* Vertices, UInt32 VerticesCount, const UInt16* Indices, UInt32 IndicesCount, bool Strip, const D3DXMATRIX* WorldViewProj) {
+
+	if (!Depth || IndicesCount < 3) return;
+
+	Transformed.resize(VerticesCount);
+	for (UInt32 i = 0; i < VerticesCount; i++) {
+		D3DXVECTOR3 Vertex = D3DXVECTOR3(Vertices[i].x, Vertices[i].y, Vertices[i].z);
+		D3DXVec3Transform(&Transformed[i], &Vertex, WorldViewProj);
+	}
+
+	UInt32 Step = Strip ? 1 : 3;
+	for (UInt32 i = 0; i + 2 < IndicesCount; i += Step) {
+		UInt16 i0 = Indices[i];
+		UInt16 i1 = Indices[i + 1];
+		UInt16 i2 = Indices[i + 2];
+		if (i0 >= VerticesCount || i1 >= VerticesCount || i2 >= VerticesCount) continue;
+		if (i0 == i1 || i1 == i2 || i0 == i2) continue; // degenerate strip joints
+		DrawTriangle(&Transformed[i0], &Transformed[i1], &Transformed[i2]);
+	}
+
+}
+
+D3DXVECTOR3 OcclusionBuffer::ToScreen(const D3DXVECTOR4* Clip) {
+
+	float InvW = 1.0f / Clip->w;
+	return D3DXVECTOR3((Clip->x * InvW * 0.5f + 0.5f) * Width, (0.5f - Clip->y * InvW * 0.5f) * Height, Clip->z * InvW);
+
+}
+
+/*
+* Clips the triangle against the near plane (z >= 0 in D3D clip space, z <= w with reversed depth), which can produce a quad drawn as 2 triangles.
+*/
+void OcclusionBuffer::DrawTriangle(const D3DXVECTOR4* Clip0, const D3DXVECTOR4* Clip1, const D3DXVECTOR4* Clip2) {
+
+	const D3DXVECTOR4* Input[3] = { Clip0, Clip1, Clip2 };
+	D3DXVECTOR4 Output[4];
+	UInt32 OutputCount = 0;
+
+	float Distance[3] = { GetNearDistance(Clip0), GetNearDistance(Clip1), GetNearDistance(Clip2) };
+	if (Distance[0] >= 0.0f && Distance[1] >= 0.0f && Distance[2] >= 0.0f) {
+		RasterizeTriangle(ToScreen(Clip0), ToScreen(Clip1), ToScreen(Clip2));
+		return;
+	}
+
+	for (UInt32 i = 0; i < 3; i++) {
+		const D3DXVECTOR4* Current = Input[i];
+		const D3DXVECTOR4* Next = Input[(i + 1) % 3];
+		float CurrentDistance = Distance[i];
+		float NextDistance = Distance[(i + 1) % 3];
+		if (CurrentDistance >= 0.0f) Output[OutputCount++] = *Current;
+		if ((CurrentDistance >= 0.0f) != (NextDistance >= 0.0f)) {
+			float t = CurrentDistance / (CurrentDistance - NextDistance);
+			Output[OutputCount++] = *Current + (*Next - *Current) * t;
+		}
+	}
+	if (OutputCount < 3) return;
+
+	D3DXVECTOR3 Screen[4];
+	for (UInt32 i = 0; i < OutputCount; i++) Screen[i] = ToScreen(&Output[i]);
+	RasterizeTriangle(Screen[0], Screen[1], Screen[2]);
+	if (OutputCount == 4) RasterizeTriangle(Screen[0], Screen[2], Screen[3]);
+
+}
+
+/*
+* Half space rasterization of a screen space triangle, 4 pixels per iteration. Pixel centers exactly on an edge are not covered,
+* so occluders never grow beyond their real coverage.
+*/
+void OcclusionBuffer::RasterizeTriangle(D3DXVECTOR3 v0, D3DXVECTOR3 v1, D3DXVECTOR3 v2) {
+
+	float Area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (fabs(Area) < 0.0001f) return;
+	if (Area < 0.0f) {
+		std::swap(v1, v2);
+		Area = -Area;
+	}
+
+	SInt32 MinX = max((SInt32)floorf(min(v0.x, min(v1.x, v2.x))), 0);
+	SInt32 MaxX = min((SInt32)ceilf(max(v0.x, max(v1.x, v2.x))), (SInt32)Width - 1);
+	SInt32 MinY = max((SInt32)floorf(min(v0.y, min(v1.y, v2.y))), 0);
+	SInt32 MaxY = min((SInt32)ceilf(max(v0.y, max(v1.y, v2.y))), (SInt32)Height - 1);
+	if (MinX > MaxX || MinY > MaxY) return;
+	MinX &= ~3;
+
+	// edge functions E(x, y) = A * x + B * y + C, positive inside
+	float A0 = v1.y - v2.y, B0 = v2.x - v1.x, C0 = -(A0 * v1.x + B0 * v1.y);	// edge 1-2, weight of v0
+	float A1 = v2.y - v0.y, B1 = v0.x - v2.x, C1 = -(A1 * v2.x + B1 * v2.y);	// edge 2-0, weight of v1
+	float A2 = v0.y - v1.y, B2 = v1.x - v0.x, C2 = -(A2 * v0.x + B2 * v0.y);	// edge 0-1, weight of v2
+
+	// depth plane
+	float InvArea = 1.0f / Area;
+	float Zx = (A0 * v0.z + A1 * v1.z + A2 * v2.z) * InvArea;
+	float Zy = (B0 * v0.z + B1 * v1.z + B2 * v2.z) * InvArea;
+	float Z0 = (C0 * v0.z + C1 * v1.z + C2 * v2.z) * InvArea;
+
+	__m128 Offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 Zero = _mm_setzero_ps();
+	__m128 EA0 = _mm_set1_ps(A0), EA1 = _mm_set1_ps(A1), EA2 = _mm_set1_ps(A2);
+	__m128 ZX = _mm_set1_ps(Zx);
+
+	for (SInt32 y = MinY; y <= MaxY; y++) {
+		float py = y + 0.5f;
+		__m128 Row0 = _mm_set1_ps(B0 * py + C0);
+		__m128 Row1 = _mm_set1_ps(B1 * py + C1);
+		__m128 Row2 = _mm_set1_ps(B2 * py + C2);
+		__m128 RowZ = _mm_set1_ps(Zy * py + Z0);
+		float* Line = Depth + y * Pitch;
+
+		for (SInt32 x = MinX; x <= MaxX; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), Offsets);
+			__m128 Inside = _mm_and_ps(
+				_mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(EA0, px), Row0), Zero), _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(EA1, px), Row1), Zero)),
+				_mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(EA2, px), Row2), Zero));
+			if (!_mm_movemask_ps(Inside)) continue;
+
+			__m128 z = _mm_add_ps(_mm_mul_ps(ZX, px), RowZ);
+			__m128 Old = _mm_load_ps(Line + x);
+			__m128 New = ReversedDepth ? _mm_max_ps(Old, z) : _mm_min_ps(Old, z);
+			_mm_store_ps(Line + x, _mm_or_ps(_mm_and_ps(Inside, New), _mm_andnot_ps(Inside, Old)));
+		}
+	}
+	TrianglesDrawn++;
+
+}
+
+/*
+* Builds the tiles once all the occluders are drawn: each tile keeps the farthest depth of its pixels.
+*/
+void OcclusionBuffer::Finalize() {
+
+	for (UInt32 ty = 0; ty < TilesY; ty++) {
+		for (UInt32 tx = 0; tx < TilesX; tx++) {
+			float Farthest = ReversedDepth ? 1.0f : 0.0f;
+			UInt32 EndX = min((tx + 1) * TileSize, Width);
+			UInt32 EndY = min((ty + 1) * TileSize, Height);
+			for (UInt32 y = ty * TileSize; y < EndY; y++) {
+				for (UInt32 x = tx * TileSize; x < EndX; x++) {
+					if (IsCloser(Farthest, Depth[y * Pitch + x])) Farthest = Depth[y * Pitch + x];
+				}
+			}
+			TileDepth[ty * TilesX + tx] = Farthest;
+		}
+	}
+
+}
+
+/*
+* Tests the box around the bound against the buffer. The object is occluded only if its closest depth is behind every covered pixel.
+* Objects crossing the near plane or outside of the screen are left to the other culling and reported visible.
+*/
+bool OcclusionBuffer::IsVisible(const NiBound* Bound, const D3DXMATRIX* ViewProj) {
+
+	if (!Depth) return true;
+	OccludeesTested++;
+
+	float MinX = FLT_MAX, MinY = FLT_MAX, MaxX = -FLT_MAX, MaxY = -FLT_MAX;
+	float ClosestZ = ReversedDepth ? -FLT_MAX : FLT_MAX;
+	for (UInt32 i = 0; i < 8; i++) {
+		D3DXVECTOR3 Corner = D3DXVECTOR3(
+			Bound->Center.x + ((i & 1) ? Bound->Radius : -Bound->Radius),
+			Bound->Center.y + ((i & 2) ? Bound->Radius : -Bound->Radius),
+			Bound->Center.z + ((i & 4) ? Bound->Radius : -Bound->Radius));
+		D3DXVECTOR4 Clip;
+		D3DXVec3Transform(&Clip, &Corner, ViewProj);
+		if (GetNearDistance(&Clip) < 0.0f) return true;
+
+		D3DXVECTOR3 Screen = ToScreen(&Clip);
+		MinX = min(MinX, Screen.x);
+		MaxX = max(MaxX, Screen.x);
+		MinY = min(MinY, Screen.y);
+		MaxY = max(MaxY, Screen.y);
+		if (IsCloser(Screen.z, ClosestZ)) ClosestZ = Screen.z;
+	}
+
+	SInt32 x0 = max((SInt32)floorf(MinX), 0);
+	SInt32 x1 = min((SInt32)ceilf(MaxX), (SInt32)Width - 1);
+	SInt32 y0 = max((SInt32)floorf(MinY), 0);
+	SInt32 y1 = min((SInt32)ceilf(MaxY), (SInt32)Height - 1);
+	if (x0 > x1 || y0 > y1) return true;
+
+	for (SInt32 ty = y0 / (SInt32)TileSize; ty <= y1 / (SInt32)TileSize; ty++) {
+		for (SInt32 tx = x0 / (SInt32)TileSize; tx <= x1 / (SInt32)TileSize; tx++) {
+			if (!IsCloser(ClosestZ, TileDepth[ty * TilesX + tx])) continue; // the whole tile is in front of the object
+
+			SInt32 StartY = max(y0, ty * (SInt32)TileSize), EndY = min(y1, (ty + 1) * (SInt32)TileSize - 1);
+			SInt32 StartX = max(x0, tx * (SInt32)TileSize), EndX = min(x1, (tx + 1) * (SInt32)TileSize - 1);
+			for (SInt32 y = StartY; y <= EndY; y++) {
+				for (SInt32 x = StartX; x <= EndX; x++) {
+					if (IsCloser(ClosestZ, Depth[y * Pitch + x])) return true;
+				}
+			}
+		}
+	}
+
+	OccludeesCulled++;
+	return false;
+
+}
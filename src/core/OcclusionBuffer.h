@@ -0,0 +1,45 @@
+#pragma once
+
+#include <xmmintrin.h>
+
+/*
+* Low resolution depth buffer rasterized on the CPU, used to test occludees in the same frame without any GPU query.
+* Occluders are rasterized 4 pixels at a time with SSE, keeping the closest depth. Once all the occluders are drawn the buffer is
+* reduced into tiles holding their farthest depth, so most occludees are accepted or rejected on the tiles alone.
+* Depths are post projection z/w, with the near plane at 0 and the far plane at 1, or the opposite with a reversed depth projection.
+*/
+class OcclusionBuffer {
+public:
+	static const UInt32	TileSize = 8;
+
+	OcclusionBuffer();
+	~OcclusionBuffer();
+
+	void				Initialize(UInt32 BufferWidth, UInt32 BufferHeight);
+	void				Clear(bool Reversed);
+	void				DrawTriangles(const NiPoint3* Vertices, UInt32 VerticesCount, const UInt16* Indices, UInt32 IndicesCount, bool Strip, const D3DXMATRIX* WorldViewProj);
+	void				Finalize();
+	bool				IsVisible(const NiBound* Bound, const D3DXMATRIX* ViewProj);
+	float				GetDepth(UInt32 x, UInt32 y) { return Depth[y * Pitch + x]; }
+
+	UInt32				Width;
+	UInt32				Height;
+	UInt32				Pitch;			// row length, multiple of 4
+	UInt32				TilesX;
+	UInt32				TilesY;
+	UInt32				TrianglesDrawn;	// stats since the last clear
+	UInt32				OccludeesTested;
+	UInt32				OccludeesCulled;
+	bool				ReversedDepth;	// the near plane is at 1: the buffer keeps the highest depth and the clear value is 0
+
+private:
+	void				DrawTriangle(const D3DXVECTOR4* Clip0, const D3DXVECTOR4* Clip1, const D3DXVECTOR4* Clip2);
+	void				RasterizeTriangle(D3DXVECTOR3 v0, D3DXVECTOR3 v1, D3DXVECTOR3 v2);
+	D3DXVECTOR3			ToScreen(const D3DXVECTOR4* Clip);
+	float				GetNearDistance(const D3DXVECTOR4* Clip) { return ReversedDepth ? Clip->w - Clip->z : Clip->z; }
+	bool				IsCloser(float z, float Other) { return ReversedDepth ? z > Other : z < Other; }
+
+	float*				Depth;
+	float*				TileDepth;
+	std::vector<D3DXVECTOR4>	Transformed;
+};
@@ -22,7 +22,9 @@ void OcclusionManager::Initialize() {
 	TheOcclusionManager->OcclusionMapVertex = (ShaderRecordVertex*)ShaderRecord::LoadShader(VertexShaderName, NULL);
 	TheOcclusionManager->OcclusionMapPixel = (ShaderRecordPixel*)ShaderRecord::LoadShader(PixelShaderName, NULL);
 
-	Device->CreateQuery(D3DQUERYTYPE_OCCLUSION, &TheOcclusionManager->OcclusionQuery);
+	TheOcclusionManager->OcclusionQueries.Initialize(Device, 1024);
+	TheOcclusionManager->SoftwareOcclusion = TheSettingManager->SettingsMain.OcclusionCulling.SoftwareRasterizer;
+	if (TheOcclusionManager->SoftwareOcclusion) TheOcclusionManager->OcclusionDepth.Initialize(OcclusionMapSizeX, OcclusionMapSizeY);
 	Device->CreateTexture(OcclusionMapSizeX, OcclusionMapSizeY, 1, D3DUSAGE_RENDERTARGET, D3DFMT_X8R8G8B8, D3DPOOL_DEFAULT, &TheOcclusionManager->OcclusionMapTexture, NULL);
 	TheOcclusionManager->OcclusionMapTexture->GetSurfaceLevel(0, &TheOcclusionManager->OcclusionMapSurface);
 	Device->CreateDepthStencilSurface(OcclusionMapSizeX, OcclusionMapSizeY, D3DFMT_D16, D3DMULTISAMPLE_NONE, 0, true, &TheOcclusionManager->OcclusionMapDepthSurface, NULL);
@@ -113,8 +115,6 @@ void OcclusionManager::RenderStatic(NiAVObject* Object, float MinBoundSize, floa
 
 void OcclusionManager::RenderImmediate(NiAVObject* Object, bool PerformOcclusion) {
 	
-	DWORD Pixels = 0;
-	
 	if (Object) {
 		void* VFT = *(void**)Object;
 		if (VFT == Pointers::VirtualTables::NiNode) {
@@ -126,16 +126,10 @@ void OcclusionManager::RenderImmediate(NiAVObject* Object, bool PerformOcclusion
 		else if (VFT == Pointers::VirtualTables::NiTriShape || VFT == Pointers::VirtualTables::NiTriStrips) {
 			NiGeometry* Geo = (NiGeometry*)Object;
 			if (!Geo->geomData->BuffData) TheRenderManager->unsharedGeometryGroup->AddObject(Geo->geomData, NULL, NULL);
-			if (PerformOcclusion) OcclusionQuery->Issue(D3DISSUE_BEGIN);
-			Render(Geo);
-			if (PerformOcclusion) {
-				OcclusionQuery->Issue(D3DISSUE_END);
-				while (OcclusionQuery->GetData((void*)&Pixels, sizeof(DWORD), D3DGETDATA_FLUSH) == S_FALSE);
-				if (Pixels <= 10)
-					Geo->m_flags |= NiAVObject::NiFlags::IS_OCCLUDED;
-				else
-					Geo->m_flags &= ~NiAVObject::NiFlags::IS_OCCLUDED;
-			}
+			if (PerformOcclusion)
+				RenderQuery(Geo);
+			else
+				RenderOccluder(Geo);
 		}
 	}
 
@@ -155,7 +149,7 @@ void OcclusionManager::RenderTerrain(NiAVObject* Object) {
 		}
 		else if (VFT == Pointers::VirtualTables::NiTriShape || VFT == Pointers::VirtualTables::NiTriStrips) {
 			NiGeometry* Geo = (NiGeometry*)Object;
-			if (Geo->geomData->BuffData) Render(Geo);
+			if (Geo->geomData->BuffData) RenderOccluder(Geo);
 		}
 	}
 
@@ -163,8 +157,6 @@ void OcclusionManager::RenderTerrain(NiAVObject* Object) {
 
 void OcclusionManager::RenderWater(NiAVObject* Object) {
 	
-	DWORD Pixels = 0;
-
 	if (Object && !(Object->m_flags & NiAVObject::NiFlags::APP_CULLED)) {
 		void* VFT = *(void**)Object;
 		if (VFT == Pointers::VirtualTables::NiNode) {
@@ -177,24 +169,72 @@ void OcclusionManager::RenderWater(NiAVObject* Object) {
 		}
 		else if (VFT == Pointers::VirtualTables::NiTriShape || VFT == Pointers::VirtualTables::NiTriStrips) {
 			NiGeometry* Geo = (NiGeometry*)Object;
-			if (Geo->geomData->BuffData) {
-				OcclusionQuery->Issue(D3DISSUE_BEGIN);
-				Render(Geo);
-				OcclusionQuery->Issue(D3DISSUE_END);
-				while (OcclusionQuery->GetData((void*)&Pixels, sizeof(DWORD), D3DGETDATA_FLUSH) == S_FALSE);
-				if (Pixels <= 10) {
-					Geo->m_flags |= NiAVObject::NiFlags::IS_OCCLUDED;
-				}
-				else {
-					WaterOccluded = false;
-					Geo->m_flags &= ~NiAVObject::NiFlags::IS_OCCLUDED;
-				}
-			}
+			if (Geo->geomData->BuffData && RenderQuery(Geo)) WaterOccluded = false;
 		}
 	}
 
 }
 
+/*
+* Renders the geometry inside a query of the pool (if its previous one is done) and flags it with the latest known result.
+* Returns true if the geometry is considered visible.
+*/
+bool OcclusionManager::RenderQuery(NiGeometry* Geo) {
+
+	if (SoftwareOcclusion) {
+		bool Visible = OcclusionDepth.IsVisible(Geo->GetWorldBound(), &TheRenderManager->ViewProjMatrix);
+		if (Visible)
+			Geo->m_flags &= ~NiAVObject::NiFlags::IS_OCCLUDED;
+		else
+			Geo->m_flags |= NiAVObject::NiFlags::IS_OCCLUDED;
+		return Visible;
+	}
+
+	OcclusionQueryPool::ObjectState* State = OcclusionQueries.GetState(Geo, Geo->GetWorldBound());
+
+	if (OcclusionQueries.BeginQuery(State)) {
+		Render(Geo);
+		OcclusionQueries.EndQuery(State);
+	}
+	if (State->Occluded)
+		Geo->m_flags |= NiAVObject::NiFlags::IS_OCCLUDED;
+	else
+		Geo->m_flags &= ~NiAVObject::NiFlags::IS_OCCLUDED;
+	return !State->Occluded;
+
+}
+
+/*
+* Draws an occluder, on the GPU occlusion map or in the CPU depth buffer when the software rasterizer is enabled.
+* The CPU path reads the system memory copy of the geometry: positions from the geometry data, indices from the buffer data.
+*/
+void OcclusionManager::RenderOccluder(NiGeometry* Geo) {
+
+	NiGeometryData* ModelData = Geo->geomData;
+	NiGeometryBufferData* GeoData = ModelData->BuffData;
+	D3DXMATRIX WorldMatrix;
+	D3DXMATRIX WorldViewProj;
+	UInt32 StartIndex = 0;
+
+	if (!SoftwareOcclusion) {
+		Render(Geo);
+		return;
+	}
+	if (!ModelData->Vertex || !GeoData || !GeoData->IndexArray) return;
+
+	TheRenderManager->CreateD3DMatrix(&WorldMatrix, &Geo->m_worldTransform);
+	D3DXMatrixMultiply(&WorldViewProj, &WorldMatrix, &TheRenderManager->ViewProjMatrix);
+	bool Strip = GeoData->PrimitiveType == D3DPT_TRIANGLESTRIP;
+	for (UInt32 i = 0; i < GeoData->NumArrays; i++) {
+		UInt32 PrimitiveCount = GeoData->ArrayLengths ? GeoData->ArrayLengths[i] - 2 : GeoData->TriCount;
+		UInt32 IndicesCount = Strip ? PrimitiveCount + 2 : PrimitiveCount * 3;
+		if (StartIndex + IndicesCount > GeoData->IndexCount) break;
+		OcclusionDepth.DrawTriangles(ModelData->Vertex, ModelData->Vertices, GeoData->IndexArray + StartIndex, IndicesCount, Strip, &WorldViewProj);
+		StartIndex += IndicesCount;
+	}
+
+}
+
 void OcclusionManager::Render(NiGeometry* Geo) {
 
 	IDirect3DDevice9* Device = TheRenderManager->device;
@@ -325,20 +365,25 @@ void OcclusionManager::RenderOcclusionMap(SettingsMainStruct::OcclusionCullingSt
 	float OccludedStaticMin = OcclusionCulling->OccludedStaticMin;
 	float OccludedStaticMax = OcclusionCulling->OccludedStaticMax;
 
-	Device->SetRenderTarget(0, OcclusionMapSurface);
-	Device->SetDepthStencilSurface(OcclusionMapDepthSurface);
-	Device->SetViewport(&OcclusionMapViewPort);
-	Device->Clear(0L, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f), 1.0f, 0L);
-	RenderState->SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE, RenderStateArgs);
-	RenderState->SetRenderState(D3DRS_ZWRITEENABLE, D3DZB_TRUE, RenderStateArgs);
-	RenderState->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE, RenderStateArgs);
-	RenderState->SetRenderState(D3DRS_ALPHABLENDENABLE, 0, RenderStateArgs);
-	RenderState->SetVertexShader(OcclusionMapVertex->ShaderHandle, false);
-	RenderState->SetPixelShader(OcclusionMapPixel->ShaderHandle, false);
-	Device->BeginScene();
+	if (SoftwareOcclusion) {
+		OcclusionDepth.Clear(TheRenderManager->IsReversedDepth());
+	}
+	else {
+		Device->SetRenderTarget(0, OcclusionMapSurface);
+		Device->SetDepthStencilSurface(OcclusionMapDepthSurface);
+		Device->SetViewport(&OcclusionMapViewPort);
+		Device->Clear(0L, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f), 1.0f, 0L);
+		RenderState->SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE, RenderStateArgs);
+		RenderState->SetRenderState(D3DRS_ZWRITEENABLE, D3DZB_TRUE, RenderStateArgs);
+		RenderState->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE, RenderStateArgs);
+		RenderState->SetRenderState(D3DRS_ALPHABLENDENABLE, 0, RenderStateArgs);
+		RenderState->SetVertexShader(OcclusionMapVertex->ShaderHandle, false);
+		RenderState->SetPixelShader(OcclusionMapPixel->ShaderHandle, false);
+		Device->BeginScene();
 #if !DEBUGOC
-	RenderState->SetRenderState(D3DRS_COLORWRITEENABLE, D3DZB_FALSE, RenderStateArgs);
+		RenderState->SetRenderState(D3DRS_COLORWRITEENABLE, D3DZB_FALSE, RenderStateArgs);
 #endif
+	}
 	for (UInt32 i = 0; i < CellArraySize; i++) {
 		if (TESObjectCELL* Cell = CellArray->GetCell(i)) {
 			NiNode* CellNode = Cell->niNode;
@@ -359,15 +404,20 @@ void OcclusionManager::RenderOcclusionMap(SettingsMainStruct::OcclusionCullingSt
 		}
 	}
 
-	if (TheSettingManager->SettingsMain.Develop.DebugMode) {
-		NiNode* DistantRefLOD = *(NiNode**)0x00B34424;
-		for (int i = 1; i < DistantRefLOD->m_children.end; i++) {
-			NiNode* ChildNode = (NiNode*)DistantRefLOD->m_children.data[i];
-			RenderDistantStatic(ChildNode);
+	if (SoftwareOcclusion) {
+		OcclusionDepth.Finalize();
+	}
+	else {
+		if (TheSettingManager->SettingsMain.Develop.DebugMode) {
+			NiNode* DistantRefLOD = *(NiNode**)0x00B34424;
+			for (int i = 1; i < DistantRefLOD->m_children.end; i++) {
+				NiNode* ChildNode = (NiNode*)DistantRefLOD->m_children.data[i];
+				RenderDistantStatic(ChildNode);
+			}
 		}
+		RenderState->SetRenderState(D3DRS_ZWRITEENABLE, D3DZB_FALSE, RenderStateArgs);
 	}
 
-	RenderState->SetRenderState(D3DRS_ZWRITEENABLE, D3DZB_FALSE, RenderStateArgs);
 	WaterOccluded = true;
 	RenderWater(WaterRoot);
 	if (OcclusionCulling->OccludedStatic) {
@@ -388,6 +438,8 @@ void OcclusionManager::RenderOcclusionMap(SettingsMainStruct::OcclusionCullingSt
 		}
 	}
 
+	if (SoftwareOcclusion) return;
+
 	if (TheSettingManager->SettingsMain.Develop.DebugMode) {
 		RenderState->SetRenderState(D3DRS_COLORWRITEENABLE, D3DZB_TRUE, RenderStateArgs);
 	}
@@ -397,6 +449,7 @@ void OcclusionManager::RenderOcclusionMap(SettingsMainStruct::OcclusionCullingSt
 
 void OcclusionManager::PerformOcclusionCulling() {
 	
+	TraceZone Zone("OcclusionManager::PerformOcclusionCulling");
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	IDirect3DSurface9* DepthSurface = NULL;
 	SettingsMainStruct::OcclusionCullingStruct* OcclusionCulling = &TheSettingManager->SettingsMain.OcclusionCulling;
@@ -404,6 +457,7 @@ void OcclusionManager::PerformOcclusionCulling() {
 	if (Player->GetWorldSpace() && !Player->isMovingToNewSpace) {
 		Device->GetDepthStencilSurface(&DepthSurface);
 		TheRenderManager->SetupSceneCamera();
+		OcclusionQueries.BeginFrame();
 		RenderOcclusionMap(OcclusionCulling);
 		Device->SetDepthStencilSurface(DepthSurface);
 	}
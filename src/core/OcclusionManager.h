@@ -1,5 +1,8 @@
 #pragma once
 
+#include "OcclusionBuffer.h"
+#include "OcclusionQueryPool.h"
+
 class OcclusionManager { // Never disposed
 public:
 	static void Initialize();
@@ -11,6 +14,8 @@ public:
 	void					RenderTerrain(NiAVObject* Object);
 	void					RenderWater(NiAVObject* Object);
 	void					Render(NiGeometry* Geo);
+	bool					RenderQuery(NiGeometry* Geo);
+	void					RenderOccluder(NiGeometry* Geo);
 	void					ManageDistantStatic();
 	void					ManageDistantStatic(NiAVObject* Object, float MaxBoundSize);
 	void					RenderDistantStatic(NiAVObject* Object);
@@ -19,7 +24,9 @@ public:
 	
 	ShaderRecordVertex*		OcclusionMapVertex;
 	ShaderRecordPixel*		OcclusionMapPixel;
-	IDirect3DQuery9*		OcclusionQuery;
+	OcclusionQueryPool		OcclusionQueries;
+	OcclusionBuffer			OcclusionDepth;
+	bool					SoftwareOcclusion;
 	IDirect3DTexture9*		OcclusionMapTexture;
 	IDirect3DSurface9*		OcclusionMapSurface;
 	IDirect3DSurface9*		OcclusionMapDepthSurface;
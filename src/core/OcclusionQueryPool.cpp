@@ -0,0 +1,117 @@
+OcclusionQueryPool::OcclusionQueryPool() {
+
+	Device = NULL;
+	MaxQueries = 0;
+	Frame = 0;
+	QueriesCount = 0;
+	InFlightCount = 0;
+	DroppedCount = 0;
+
+}
+
+void OcclusionQueryPool::Initialize(IDirect3DDevice9* QueriesDevice, UInt32 Max) {
+
+	Device = QueriesDevice;
+	MaxQueries = Max;
+
+}
+
+/*
+* Collects the results that are ready without flushing the command buffer, drops the ones that are too late and forgets the objects not tested anymore.
+*/
+void OcclusionQueryPool::BeginFrame() {
+
+	DWORD Pixels = 0;
+
+	Frame++;
+	for (auto Item = States.begin(); Item != States.end();) {
+		ObjectState* State = &Item->second;
+		if (State->Query) {
+			if (State->Query->GetData((void*)&Pixels, sizeof(DWORD), 0) == S_OK) {
+				SetResult(State, Pixels);
+			}
+			else if (Frame - State->IssuedFrame > MaxLatency) {
+				State->OccludedCount = 0;
+				State->Occluded = false; // visible until proven occluded
+				State->Stale = false;
+				DroppedCount++;
+			}
+			else {
+				Item++;
+				continue;
+			}
+			FreeQueries.push_back(State->Query);
+			State->Query = NULL;
+			InFlightCount--;
+		}
+		if (Frame - State->LastSeenFrame > EvictFrames)
+			Item = States.erase(Item);
+		else
+			Item++;
+	}
+
+}
+
+OcclusionQueryPool::ObjectState* OcclusionQueryPool::GetState(void* Object, const NiBound* Bound) {
+
+	auto [Item, Created] = States.try_emplace(Object, ObjectState{ NULL, 0, Frame, 0, false, false, *Bound });
+	ObjectState* State = &Item->second;
+
+	State->LastSeenFrame = Frame;
+	if (!Created && memcmp(&State->Bound, Bound, sizeof(NiBound))) {
+		State->Bound = *Bound;
+		State->OccludedCount = 0;
+		State->Occluded = false;
+		State->Stale = State->Query != NULL;
+	}
+	return State;
+
+}
+
+/*
+* Starts a query for the object, unless the previous one is still in flight or the pool is exhausted.
+*/
+bool OcclusionQueryPool::BeginQuery(ObjectState* State) {
+
+	IDirect3DQuery9* Query = NULL;
+
+	if (State->Query) return false;
+	if (!FreeQueries.empty()) {
+		Query = FreeQueries.back();
+		FreeQueries.pop_back();
+	}
+	else {
+		if (QueriesCount >= MaxQueries || Device->CreateQuery(D3DQUERYTYPE_OCCLUSION, &Query) != D3D_OK) return false;
+		QueriesCount++;
+	}
+
+	Query->Issue(D3DISSUE_BEGIN);
+	State->Query = Query;
+	State->IssuedFrame = Frame;
+	InFlightCount++;
+	return true;
+
+}
+
+void OcclusionQueryPool::EndQuery(ObjectState* State) {
+
+	State->Query->Issue(D3DISSUE_END);
+
+}
+
+void OcclusionQueryPool::SetResult(ObjectState* State, DWORD Pixels) {
+
+	if (State->Stale) {
+		State->Stale = false;
+		return;
+	}
+	if (Pixels <= VisiblePixels) {
+		if (State->OccludedCount < 255) State->OccludedCount++;
+		State->Occluded = State->OccludedCount >= OccludedResults;
+	}
+	else {
+		State->OccludedCount = 0;
+		State->Occluded = false;
+	}
+
+}
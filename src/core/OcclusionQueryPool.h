@@ -0,0 +1,47 @@
+#pragma once
+
+#include <unordered_map>
+
+/*
+* Pool of occlusion queries whose results are read one or more frames after being issued, so the CPU never waits for the GPU.
+* An object is considered visible until a query proves it occluded for OccludedResults results in a row (hysteresis),
+* and becomes visible again as soon as one result sees it. A result that takes more than MaxLatency frames is dropped and the object stays visible.
+* The states are keyed by address, so an object whose world bound changed (moved, or another object allocated at the same address) starts over as visible.
+*/
+class OcclusionQueryPool {
+public:
+	struct ObjectState {
+		IDirect3DQuery9*	Query;			// in flight, NULL if none
+		UInt32				IssuedFrame;
+		UInt32				LastSeenFrame;
+		UInt8				OccludedCount;	// consecutive occluded results
+		bool				Occluded;
+		bool				Stale;			// the query in flight was issued for the previous bound, its result is ignored
+		NiBound				Bound;			// world bound the results are about
+	};
+
+	static const UInt32		MaxLatency = 3;
+	static const UInt32		OccludedResults = 2;
+	static const UInt32		VisiblePixels = 10;
+	static const UInt32		EvictFrames = 120;
+
+	OcclusionQueryPool();
+
+	void					Initialize(IDirect3DDevice9* Device, UInt32 MaxQueries);
+	void					BeginFrame();
+	ObjectState*			GetState(void* Object, const NiBound* Bound);
+	bool					BeginQuery(ObjectState* State);
+	void					EndQuery(ObjectState* State);
+	void					SetResult(ObjectState* State, DWORD Pixels);
+
+	UInt32					Frame;
+	UInt32					QueriesCount;	// created
+	UInt32					InFlightCount;
+	UInt32					DroppedCount;	// results given up on since the start
+
+private:
+	IDirect3DDevice9*		Device;
+	UInt32					MaxQueries;
+	std::vector<IDirect3DQuery9*>				FreeQueries;
+	std::unordered_map<void*, ObjectState>		States;
+};
@@ -0,0 +1,269 @@
+/*
+* Render graph describing the post process effects chain.
+*/
+RenderGraph::RenderGraph() {
+
+	for (UInt32 i = 0; i < ResourcesCount; i++) {
+		Resources[i] = { "", 0, 0, D3DFMT_UNKNOWN, false, -1, -1, -1 };
+	}
+	ActivePassesCount = 0;
+	CulledPassesCount = 0;
+	SourceCopiesCount = 0;
+	TransientMemory = 0;
+	PeakTransientMemory = 0;
+	AliasedTransientMemory = 0;
+	CompiledMask = 0;
+
+}
+
+
+/*
+* Converts a resource flag to its index in the resources array.
+*/
+UInt32 RenderGraph::GetResourceIndex(Resource Id) {
+	UInt32 Index = 0;
+	while ((1u << Index) != (UInt32)Id && Index < ResourcesCount) Index++;
+	return Index;
+}
+
+
+/*
+* Returns the amount of bytes per pixel for the formats used by the effects buffers.
+*/
+UInt32 RenderGraph::GetFormatSize(D3DFORMAT Format) {
+	switch (Format) {
+	case D3DFMT_A32B32G32R32F:
+		return 16;
+	case D3DFMT_A16B16G16R16F:
+	case D3DFMT_A16B16G16R16:
+	case D3DFMT_G32R32F:
+		return 8;
+	case D3DFMT_R16F:
+	case D3DFMT_L16:
+		return 2;
+	case D3DFMT_L8:
+	case D3DFMT_A8:
+		return 1;
+	default:
+		return 4;
+	}
+}
+
+
+void RenderGraph::AddResource(Resource Id, const char* Name, UInt32 Width, UInt32 Height, D3DFORMAT Format, bool Persistent) {
+	Resources[GetResourceIndex(Id)] = { Name, Width, Height, Format, Persistent, -1, -1, -1 };
+}
+
+
+/*
+* Appends a pass to the graph. Passes are executed in the order they are added, per stage.
+*/
+void RenderGraph::AddPass(const char* Name, Stage PassStage, EffectRecord* Effect, UInt32 Reads, UInt32 Writes, std::function<void(IDirect3DSurface9*)> Execute, std::function<bool()> Condition) {
+	Pass Node;
+	Node.Name = Name;
+	Node.PassStage = PassStage;
+	Node.Effect = Effect;
+	Node.Reads = Reads;
+	Node.Writes = Writes;
+	Node.Condition = Condition;
+	Node.Execute = Execute;
+	Node.Enabled = false;
+	Node.Culled = true; // until the graph is compiled
+	Passes.push_back(Node);
+}
+
+
+/*
+* Declares the post process passes with the buffers they read and write. The order of declaration is the order of rendering.
+* Bind supplies the effect, the render function and the condition of each pass by name.
+*/
+void RenderGraph::DeclareEffectsChain(UInt32 Width, UInt32 Height, UInt32 BloomWidth, UInt32 BloomHeight, const PassBinder& Bind) {
+
+	AddResource(ColorBuffer, "Color", Width, Height, D3DFMT_A16B16G16R16F, true);
+	AddResource(DepthBuffer, "TESR_DepthBuffer", Width, Height, D3DFMT_G32R32F);
+	AddResource(NormalsBuffer, "TESR_NormalsBuffer", Width, Height, D3DFMT_A16B16G16R16F);
+	AddResource(ShadowPassBuffer, "TESR_PointShadowBuffer", Width, Height, D3DFMT_G16R16);
+	AddResource(AvgLumaBuffer, "TESR_AvgLumaBuffer", 1, 1, D3DFMT_A16B16G16R16F, true); // blended with the previous frame
+	AddResource(BloomBuffer, "TESR_BloomBuffer", BloomWidth, BloomHeight, D3DFMT_A16B16G16R16F);
+
+	auto Declare = [this, &Bind](const char* Name, Stage PassStage, UInt32 Reads, UInt32 Writes) {
+		PassBinding Binding = Bind(Name);
+		AddPass(Name, PassStage, Binding.Effect, Reads, Writes, Binding.Execute, Binding.Condition);
+	};
+	UInt32 Lighting = ColorBuffer | DepthBuffer | NormalsBuffer | ShadowPassBuffer;
+
+	// before tonemapping
+	Declare("CombineDepth", PreTonemapping, 0, DepthBuffer);
+	Declare("Normals", PreTonemapping, DepthBuffer, NormalsBuffer);
+	Declare("PointShadows", PreTonemapping, DepthBuffer | NormalsBuffer, ShadowPassBuffer);
+	Declare("PointShadows2", PreTonemapping, DepthBuffer | NormalsBuffer | ShadowPassBuffer, ShadowPassBuffer);
+	Declare("SunShadows", PreTonemapping, DepthBuffer | NormalsBuffer | ShadowPassBuffer, ShadowPassBuffer);
+	Declare("ShadowsExteriors", PreTonemapping, Lighting, ColorBuffer);
+	Declare("ShadowsInteriors", PreTonemapping, Lighting, ColorBuffer);
+	Declare("SnowAccumulation", PreTonemapping, Lighting, ColorBuffer);
+	Declare("AmbientOcclusion", PreTonemapping, ColorBuffer | DepthBuffer | NormalsBuffer, ColorBuffer);
+	Declare("WetWorld", PreTonemapping, Lighting, ColorBuffer);
+	Declare("Flashlight", PreTonemapping, Lighting, ColorBuffer);
+	Declare("Specular", PreTonemapping, Lighting, ColorBuffer);
+	Declare("Underwater", PreTonemapping, Lighting, ColorBuffer);
+	Declare("VolumetricFog", PreTonemapping, ColorBuffer | DepthBuffer, ColorBuffer);
+	Declare("GodRays", PreTonemapping, ColorBuffer | DepthBuffer | AvgLumaBuffer, ColorBuffer);
+	Declare("AvgLuma", PreTonemapping, ColorBuffer | DepthBuffer | AvgLumaBuffer, AvgLumaBuffer);
+	Declare("Exposure", PreTonemapping, ColorBuffer | AvgLumaBuffer, ColorBuffer);
+	Declare("Bloom", PreTonemapping, ColorBuffer, BloomBuffer);
+	Declare("Lens", PreTonemapping, ColorBuffer | BloomBuffer, ColorBuffer);
+
+	// the game tonemapping shaders sample the bloom buffer between the two stages
+	Declare("Tonemapping", PreTonemapping, BloomBuffer, 0);
+
+	// after tonemapping
+	Declare("Rain", PostTonemapping, ColorBuffer | DepthBuffer | BloomBuffer, ColorBuffer);
+	Declare("Snow", PostTonemapping, ColorBuffer | DepthBuffer, ColorBuffer);
+	Declare("BloomLegacy", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("Coloring", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("DepthOfField", PostTonemapping, ColorBuffer | DepthBuffer | AvgLumaBuffer, ColorBuffer);
+	Declare("MotionBlur", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("BloodLens", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("WaterLens", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("LowHF", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("SMAA", PostTonemapping, ColorBuffer | DepthBuffer, ColorBuffer);
+	Declare("Sharpening", PostTonemapping, ColorBuffer | DepthBuffer, ColorBuffer);
+	Declare("Cinema", PostTonemapping, ColorBuffer | DepthBuffer, ColorBuffer); // vignetting/letterboxing
+	Declare("ImageAdjust", PostTonemapping, ColorBuffer, ColorBuffer);
+	Declare("Debug", PostTonemapping, ColorBuffer | DepthBuffer | NormalsBuffer | ShadowPassBuffer | AvgLumaBuffer | BloomBuffer, ColorBuffer);
+
+}
+
+
+/*
+* Checks if the pass would render this frame, regardless of its outputs being used.
+*/
+bool RenderGraph::IsActive(const Pass& Node) {
+	if (Node.Effect && (!Node.Effect->Enabled || !Node.Effect->IsLoaded() || !Node.Effect->ShouldRender())) return false;
+	if (Node.Condition && !Node.Condition()) return false;
+	return true;
+}
+
+
+/*
+* Resolves which passes will run this frame. Doesn't touch the device, so it can be evaluated at any time.
+* - passes that are disabled or whose outputs are never read by a later pass are culled;
+* - the lifetime of every transient buffer is computed to get the peak memory and the aliasing slots;
+* - the copies of the color buffer required by the effects (source/rendered buffers) are counted.
+*/
+void RenderGraph::Compile() {
+
+	SInt32 PassesCount = Passes.size();
+	UInt32 PersistentReads = 0;
+
+	for (Pass& Node : Passes) {
+		Node.Enabled = IsActive(Node);
+		Node.Culled = !Node.Enabled;
+		if (Node.Enabled) PersistentReads |= Node.Reads & ~Node.Writes;
+	}
+
+	// history buffers are needed at the end of the frame if a pass other than their producer reads them
+	UInt32 Live = ColorBuffer;
+	for (UInt32 r = 0; r < ResourcesCount; r++) {
+		if (Resources[r].Persistent) Live |= PersistentReads & (1 << r);
+	}
+
+	// walk the passes backwards, a pass is kept only if one of its outputs is still needed
+	for (SInt32 i = PassesCount - 1; i >= 0; i--) {
+		Pass& Node = Passes[i];
+		if (!Node.Enabled) continue;
+
+		if (Node.Writes && !(Node.Writes & Live)) {
+			Node.Culled = true;
+			continue;
+		}
+		Live = (Live & ~(Node.Writes & ~Node.Reads)) | Node.Reads;
+	}
+
+	// lifetimes of the buffers used by the remaining passes
+	for (UInt32 r = 0; r < ResourcesCount; r++) {
+		Resources[r].FirstUse = -1;
+		Resources[r].LastUse = -1;
+		Resources[r].AliasSlot = -1;
+	}
+
+	ActivePassesCount = 0;
+	CulledPassesCount = 0;
+	SourceCopiesCount = 0;
+	UInt64 Mask = 0;
+	for (SInt32 i = 0; i < PassesCount; i++) {
+		Pass& Node = Passes[i];
+		if (Node.Culled) {
+			CulledPassesCount++;
+			continue;
+		}
+
+		ActivePassesCount++;
+		if (i < 64) Mask |= 1ull << i;
+		if (Node.Effect && (Node.Writes & ColorBuffer) && (Node.Effect->HasSourceBuffer || Node.Effect->RenderedBufferSampler != -1)) SourceCopiesCount++;
+
+		UInt32 Used = Node.Reads | Node.Writes;
+		for (UInt32 r = 0; r < ResourcesCount; r++) {
+			if (!(Used & (1 << r))) continue;
+			if (Resources[r].FirstUse == -1) Resources[r].FirstUse = i;
+			Resources[r].LastUse = i;
+		}
+	}
+
+	// transient buffers (not the color buffer, not history) can share a slot if their lifetimes don't overlap
+	std::vector<UInt32> Order;
+	for (UInt32 r = 1; r < ResourcesCount; r++) {
+		if (!Resources[r].Persistent && Resources[r].FirstUse != -1) Order.push_back(r);
+	}
+	std::sort(Order.begin(), Order.end(), [this](UInt32 a, UInt32 b) { return Resources[a].FirstUse < Resources[b].FirstUse; });
+
+	std::vector<SInt32> SlotLastUse;
+	std::vector<UInt32> SlotOwner;
+	TransientMemory = 0;
+	AliasedTransientMemory = 0;
+	for (UInt32 r : Order) {
+		ResourceDesc& Desc = Resources[r];
+		UInt32 Size = Desc.Width * Desc.Height * GetFormatSize(Desc.Format);
+		TransientMemory += Size;
+
+		for (UInt32 s = 0; s < SlotOwner.size() && Desc.AliasSlot == -1; s++) {
+			ResourceDesc& Owner = Resources[SlotOwner[s]];
+			if (SlotLastUse[s] < Desc.FirstUse && Owner.Width == Desc.Width && Owner.Height == Desc.Height && Owner.Format == Desc.Format) {
+				Desc.AliasSlot = s;
+				SlotLastUse[s] = Desc.LastUse;
+			}
+		}
+		if (Desc.AliasSlot == -1) {
+			Desc.AliasSlot = SlotOwner.size();
+			SlotOwner.push_back(r);
+			SlotLastUse.push_back(Desc.LastUse);
+			AliasedTransientMemory += Size;
+		}
+	}
+
+	PeakTransientMemory = 0;
+	for (SInt32 i = 0; i < PassesCount; i++) {
+		UInt32 Alive = 0;
+		for (UInt32 r : Order) {
+			if (Resources[r].FirstUse <= i && i <= Resources[r].LastUse) Alive += Resources[r].Width * Resources[r].Height * GetFormatSize(Resources[r].Format);
+		}
+		PeakTransientMemory = max(PeakTransientMemory, Alive);
+	}
+
+	if (Mask != CompiledMask) {
+		CompiledMask = Mask;
+		Logger::Log("RenderGraph: %u passes active, %u culled, %u source copies, transient memory %u KB (peak %u KB, aliased %u KB)",
+			ActivePassesCount, CulledPassesCount, SourceCopiesCount, TransientMemory / 1024, PeakTransientMemory / 1024, AliasedTransientMemory / 1024);
+	}
+}
+
+
+/*
+* Runs the passes of the given stage that survived the last compilation.
+*/
+void RenderGraph::Execute(Stage PassStage, IDirect3DSurface9* RenderTarget) {
+	for (Pass& Node : Passes) {
+		if (Node.PassStage != PassStage || Node.Culled || !Node.Execute) continue;
+		Node.Execute(RenderTarget);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <functional>
+
+/*
+* Describes the post process chain as a list of passes declaring which resources they read and write.
+* Compiling the graph culls the passes whose outputs aren't consumed and plans the lifetime of the transient buffers.
+*/
+class RenderGraph {
+public:
+	enum Resource {
+		ColorBuffer			= 1 << 0,	// the render target the effects chain is applied to
+		DepthBuffer			= 1 << 1,	// TESR_DepthBuffer (combined world and view model depth)
+		NormalsBuffer		= 1 << 2,
+		ShadowPassBuffer	= 1 << 3,	// TESR_PointShadowBuffer
+		AvgLumaBuffer		= 1 << 4,
+		BloomBuffer			= 1 << 5,
+	};
+	static const UInt32 ResourcesCount = 6;
+
+	enum Stage {
+		PreTonemapping,
+		PostTonemapping,
+	};
+
+	struct ResourceDesc {
+		const char*		Name;
+		UInt32			Width;
+		UInt32			Height;
+		D3DFORMAT		Format;
+		bool			Persistent;		// content is kept from one frame to the next (history buffers)
+		SInt32			FirstUse;		// index of the first/last active pass using the resource, -1 if unused
+		SInt32			LastUse;
+		SInt32			AliasSlot;		// transient buffers with disjoint lifetimes and the same description share a slot
+	};
+
+	struct Pass {
+		const char*		Name;
+		Stage			PassStage;
+		EffectRecord*	Effect;			// the pass is skipped when the effect is disabled or shouldn't render
+		UInt32			Reads;
+		UInt32			Writes;			// passes writing nothing are sinks (e.g. game shaders reading our buffers) and are never culled
+		std::function<bool()>						Condition;
+		std::function<void(IDirect3DSurface9*)>		Execute;
+		bool			Enabled;
+		bool			Culled;
+	};
+
+	/*
+	* What the owner of the graph supplies for a declared pass: the effect, how the pass renders and when it applies.
+	*/
+	struct PassBinding {
+		EffectRecord*								Effect;
+		std::function<void(IDirect3DSurface9*)>		Execute;
+		std::function<bool()>						Condition;
+	};
+	typedef std::function<PassBinding(const char* PassName)> PassBinder;
+
+	RenderGraph();
+
+	void				AddResource(Resource Id, const char* Name, UInt32 Width, UInt32 Height, D3DFORMAT Format, bool Persistent = false);
+	void				AddPass(const char* Name, Stage PassStage, EffectRecord* Effect, UInt32 Reads, UInt32 Writes, std::function<void(IDirect3DSurface9*)> Execute, std::function<bool()> Condition = nullptr);
+	void				DeclareEffectsChain(UInt32 Width, UInt32 Height, UInt32 BloomWidth, UInt32 BloomHeight, const PassBinder& Bind);
+	void				Compile();
+	void				Execute(Stage PassStage, IDirect3DSurface9* RenderTarget);
+	bool				IsActive(const Pass& Node);
+
+	static UInt32		GetResourceIndex(Resource Id);
+	static UInt32		GetFormatSize(D3DFORMAT Format);
+
+	std::vector<Pass>	Passes;
+	ResourceDesc		Resources[ResourcesCount];
+	UInt32				ActivePassesCount;
+	UInt32				CulledPassesCount;
+	UInt32				SourceCopiesCount;		// copies of the color buffer scheduled by the active passes
+	UInt32				TransientMemory;		// bytes used by the transient buffers of the active passes
+	UInt32				PeakTransientMemory;	// highest amount of transient bytes alive at the same time
+	UInt32				AliasedTransientMemory;	// bytes needed if the slots were backed by shared textures
+	UInt64				CompiledMask;			// active passes of the last compilation, used to log changes only
+};
@@ -1,4 +1,5 @@
 #include "RenderManager.h"
+#include "Device/Device.h"
 
 #define RESZ_CODE 0x7FA05000
 
@@ -304,6 +305,7 @@ void RenderManager::Initialize() {
 	BackBuffer = NULL;
 	SaveGameScreenShotRECT = { 0, 0, 256, 144 };
 	IsSaveGameScreenShot = false;
+	StateCaptureRequested = false;
 	device->GetDirect3D(&D3D);
 	D3D->GetAdapterDisplayMode(D3DADAPTER_DEFAULT, &currentDisplayMode);
 	RESZ = D3D->CheckDeviceFormat(D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, currentDisplayMode.Format, D3DUSAGE_RENDERTARGET, D3DRTYPE_SURFACE, (D3DFORMAT)MAKEFOURCC('R','E','S','Z')) == D3D_OK;
@@ -447,6 +449,76 @@ void RenderManager::CheckAndTakeScreenShot(IDirect3DSurface9* RenderTarget, bool
 }
 
 
+/*
+* Starts or stops the CPU trace capture when its setting is toggled from the menu. Called at the frame boundary so the capture holds whole frames.
+* Enabling the state capture records the device calls of the next frames, written once they are all recorded.
+*/
+void RenderManager::UpdateTraceCapture() {
+	bool Enabled = TheSettingManager->SettingsMain.Develop.TraceCapture;
+
+	UpdateStateCapture();
+	if (Enabled == TraceRecorder::Recording) return;
+
+	if (Enabled) {
+		TraceRecorder::Start();
+		InterfaceManager->ShowMessage("Trace capture started");
+		return;
+	}
+
+	char Filename[MAX_PATH];
+	char Name[80];
+	time_t CurrentTime = time(NULL);
+
+	GetCurrentDirectoryA(MAX_PATH, Filename);
+	strcat(Filename, "\\Test");
+	if (GetFileAttributesA(Filename) == INVALID_FILE_ATTRIBUTES) CreateDirectoryA(Filename, NULL);
+	strftime(Name, 80, "\\trace %Y%m%d %H.%M.%S.json", localtime(&CurrentTime));
+	strcat(Filename, Name);
+	if (TraceRecorder::Stop(Filename))
+		InterfaceManager->ShowMessage("Trace capture saved in the Test folder");
+	else
+		InterfaceManager->ShowMessage("Trace capture failed, see the log");
+}
+
+
+void RenderManager::UpdateStateCapture() {
+	SettingsMainStruct::DevelopStruct* Develop = &TheSettingManager->SettingsMain.Develop;
+
+	if (!Develop->TraceStates) {
+		if (StateCaptureRequested) StateCapture::Stop();
+		StateCaptureRequested = false;
+		return;
+	}
+
+	if (!StateCaptureRequested) {
+		StateCaptureRequested = true;
+		if (!TESRDirect3DDevice9::Instance) {
+			InterfaceManager->ShowMessage("State capture needs the device proxy");
+			return;
+		}
+		StateCapture::Start(Develop->TraceStatesFrames);
+		InterfaceManager->ShowMessage("State capture started");
+		return;
+	}
+
+	if (!StateCapture::Complete) return;
+
+	char Filename[MAX_PATH];
+	char Name[80];
+	time_t CurrentTime = time(NULL);
+
+	GetCurrentDirectoryA(MAX_PATH, Filename);
+	strcat(Filename, "\\Test");
+	if (GetFileAttributesA(Filename) == INVALID_FILE_ATTRIBUTES) CreateDirectoryA(Filename, NULL);
+	strftime(Name, 80, "\\states %Y%m%d %H.%M.%S.bin", localtime(&CurrentTime));
+	strcat(Filename, Name);
+	if (StateCapture::Write(Filename))
+		InterfaceManager->ShowMessage("State capture saved in the Test folder");
+	else
+		InterfaceManager->ShowMessage("State capture failed, see the log");
+}
+
+
 void DWNode::Create() { 
 	
 	DWNode* Node = (DWNode*)Pointers::Functions::MemoryAlloc(sizeof(DWNode)); Node->New(2048);
@@ -26,6 +26,8 @@ public:
 	void				UpdateSceneCameraData();
 	void				SetupSceneCamera();
 	void				CheckAndTakeScreenShot(IDirect3DSurface9* RenderTarget, bool HDR);
+	void				UpdateTraceCapture();
+	void				UpdateStateCapture();
     float               GetObjectDistance(NiBound* Bound);
 	bool				IsReversedDepth();
 	void				TryCacheVulkanDevice();
@@ -46,6 +48,7 @@ public:
 	//VulkanQueueData		VkQueueData;
 	RECT				SaveGameScreenShotRECT;
 	bool				IsSaveGameScreenShot;
+	bool				StateCaptureRequested;	// the state capture setting is enabled and its capture was started
 	bool				RESZ;
 	bool				DXVK;
 	bool				ILS;
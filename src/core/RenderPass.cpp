@@ -4,23 +4,152 @@
 void RenderPass::RenderAccum() {
 	if (GeometryList.empty()) return;
 
+	TraceZone Zone(Name);
+
 	// Could add setup of device/renderstate/current shaders here
 	NiDX9RenderState* RenderState = TheRenderManager->renderState;
 	RenderState->SetPixelShader(PixelShader->ShaderHandle, false);
 	RenderState->SetVertexShader(VertexShader->ShaderHandle, false);
+	UInt32 GpuScope = TheShaderManager->Profiler.BeginScope(Name);
 
-	// Render normal geometry
-	while (!GeometryList.empty()) {
-		NiGeometry* Geo = GeometryList.top();
-		if (!Geo) continue;
+	SortGeometry();
+
+	// Render normal geometry. Only the registers that changed between objects are uploaded.
+	ShaderConstantCache::BeginBatch();
+	for (UInt32 i = 0; i < Entries.size();) {
+		UInt32 Count = InstancedVertexShader ? GetInstancesCount(i) : 1;
+		if (Count > 1 && RenderInstances(&Entries[i], Count)) {
+			i += Count;
+			continue;
+		}
 
+		NiGeometry* Geo = Entries[i].Geo;
 		UpdateConstants(Geo);
 		PixelShader->SetCT();
 		VertexShader->SetCT();
 
 		RenderGeometry(Geo);
-		GeometryList.pop();
+		i++;
+	}
+	ShaderConstantCache::EndBatch();
+	TheShaderManager->Profiler.EndScope(GpuScope);
+
+	GeometryList.clear();
+	Entries.clear();
+}
+
+
+/*
+* Moves the accumulated objects to the entries, sorted by vertex declaration, texture, buffers and mesh.
+* The buffers are the ones of the last pack, a mesh packed for the first time sorts as having none.
+*/
+void RenderPass::SortGeometry() {
+	Entries.clear();
+	Entries.reserve(GeometryList.size());
+
+	for (NiGeometry* Geo : GeometryList) {
+		if (!Geo) continue;
+
+		AccumEntry Entry = {};
+		Entry.Geo = Geo;
+		Entry.GeoData = Geo->geomData ? Geo->geomData->m_pkBuffData : NULL;
+		Entry.Texture = GetTexture(Geo);
+		if (NiGeometryBufferData* GeoData = Entry.GeoData) {
+			Entry.Declaration = GeoData->FVF ? (void*)GeoData->FVF : (void*)GeoData->VertexDeclaration;
+			Entry.VertexBuffer = (GeoData->StreamCount && GeoData->VBChip[0]) ? GeoData->VBChip[0]->VB : NULL;
+			Entry.IndexBuffer = GeoData->IB;
+		}
+		NiStencilProperty* StencilProperty = (NiStencilProperty*)Geo->GetProperty(NiProperty::PropertyType::kType_Stencil);
+		Entry.CullMode = StencilProperty ? StencilProperty->GetDrawMode() + 1 : 0;
+		Entries.push_back(Entry);
+	}
+
+	std::sort(Entries.begin(), Entries.end(), [](const AccumEntry& A, const AccumEntry& B) {
+		return std::tie(A.Declaration, A.Texture, A.VertexBuffer, A.IndexBuffer, A.GeoData, A.CullMode) < std::tie(B.Declaration, B.Texture, B.VertexBuffer, B.IndexBuffer, B.GeoData, B.CullMode);
+	});
+}
+
+
+/*
+* Returns how many entries from First can be drawn as instances of a single draw: same mesh, texture and cull mode.
+* Only indexed triangle lists with a vertex declaration can be instanced, the others are drawn by the game functions.
+*/
+UInt32 RenderPass::GetInstancesCount(UInt32 First) {
+	const AccumEntry& Entry = Entries[First];
+	NiGeometryBufferData* GeoData = Entry.GeoData;
+
+	if (!Instancing || !GeoData || !GeoData->IB || GeoData->FVF || !GeoData->VertexDeclaration) return 1;
+	if (GeoData->PrimitiveType != D3DPT_TRIANGLELIST || GeoData->NumArrays > 1 || Entry.Geo->IsTriStrips()) return 1;
+
+	UInt32 Count = 1;
+	while (First + Count < Entries.size() && Count < InstancesMax) {
+		const AccumEntry& Next = Entries[First + Count];
+		if (Next.GeoData != GeoData || Next.Texture != Entry.Texture || Next.CullMode != Entry.CullMode) break;
+		Count++;
+	}
+	return Count;
+}
+
+
+/*
+* Draws the mesh of First once per entry. The world transforms of the entries are written to the instance stream,
+* the instanced vertex shader reads them instead of TESR_ShadowWorldTransform. Returns false if the mesh cannot be instanced.
+* The instance elements are only in the declarations used with the instanced shader, the pass shader is restored after the draw.
+*/
+bool RenderPass::RenderInstances(AccumEntry* First, UInt32 Count) {
+	IDirect3DDevice9* Device = TheRenderManager->device;
+	NiDX9RenderState* RenderState = TheRenderManager->renderState;
+	NiGeometry* Geo = First->Geo;
+	NiGeometryData* ModelData = Geo->geomData;
+	NiGeometryBufferData* GeoData = First->GeoData;
+
+	InstanceStream::Declaration Declaration = InstanceStream::GetDeclaration(Device, GeoData->VertexDeclaration);
+	if (!Declaration.Extended) return false;
+
+	float* Instances = InstanceStream::Lock(Device, Count);
+	if (!Instances) {
+		if (!InstanceStream::Buffer) Instancing = false;
+		return false;
 	}
+
+	D3DXMATRIX World;
+	for (UInt32 i = 0; i < Count; i++) {
+		TheRenderManager->CreateD3DMatrix(&World, &First[i].Geo->m_worldTransform);
+		float* Instance = Instances + i * 12;
+		for (UInt32 c = 0; c < 3; c++) {
+			Instance[c * 4 + 0] = World.m[0][c];
+			Instance[c * 4 + 1] = World.m[1][c];
+			Instance[c * 4 + 2] = World.m[2][c];
+			Instance[c * 4 + 3] = World.m[3][c];
+		}
+	}
+	InstanceStream::Unlock();
+
+	UpdateConstants(Geo);
+	RenderState->SetVertexShader(InstancedVertexShader->ShaderHandle, false);
+	PixelShader->SetCT();
+	InstancedVertexShader->SetCT();
+
+	if (First->CullMode)
+		RenderState->SetCullMode((NiStencilProperty::DrawMode)(First->CullMode - 1));
+	else
+		RenderState->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW, RenderStateArgs);
+
+	TheRenderManager->PackGeometryBuffer(GeoData, ModelData, NULL, Geo->shader->ShaderDeclaration);
+	if (GeoData->VertCount && GeoData->TriCount) {
+		for (UInt32 i = 0; i < GeoData->StreamCount; i++) {
+			Device->SetStreamSource(i, GeoData->VBChip[i]->VB, 0, GeoData->VertexStride[i]);
+		}
+		InstanceStream::Bind(Device, Declaration, GeoData->StreamCount, Count);
+		Device->SetIndices(GeoData->IB);
+		RenderState->SetVertexDeclaration(Declaration.Extended, false);
+
+		Device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, GeoData->BaseVertexIndex, 0, GeoData->VertCount, 0, GeoData->TriCount);
+
+		InstanceStream::Unbind(Device, Declaration, GeoData->StreamCount);
+	}
+	RenderState->SetVertexShader(VertexShader->ShaderHandle, false);
+	return true;
 }
 
 
@@ -95,8 +224,10 @@ void RenderPass::DrawSkinnedGeometryBuffer(NiGeometry* Geo, NiGeometryBufferData
 
 
 ShadowRenderPass::ShadowRenderPass() {
+	Name = "Pass Geometry";
 	PixelShader = TheShadowManager->ShadowMapPixel;
 	VertexShader = TheShadowManager->ShadowMapVertex;
+	Instancing = true;
 	RegisterConstants();
 }
 
@@ -107,7 +238,7 @@ bool ShadowRenderPass::AccumObject(NiGeometry* Geo) {
 	BSShaderProperty* ShaderProperty = (BSShaderProperty*)Geo->GetProperty(NiProperty::PropertyType::kType_Shade);
 	if (!ShaderProperty || !ShaderProperty->IsLightingProperty()) return false;
 
-	GeometryList.push(Geo);
+	GeometryList.push_back(Geo);
 	return true;
 }
 
@@ -128,8 +259,10 @@ void ShadowRenderPass::UpdateConstants(NiGeometry* Geo) {
 
 
 AlphaShadowRenderPass::AlphaShadowRenderPass() {
+	Name = "Pass Alpha";
 	PixelShader = TheShadowManager->ShadowMapPixel;
 	VertexShader = TheShadowManager->ShadowMapVertex;
+	Instancing = true;
 	RegisterConstants();
 }
 
@@ -144,7 +277,7 @@ bool AlphaShadowRenderPass::AccumObject(NiGeometry* Geo) {
 	if (!AProp) return false;
 	if (!(AProp->flags & NiAlphaProperty::AlphaFlags::ALPHA_BLEND_MASK) && !(AProp->flags & NiAlphaProperty::AlphaFlags::TEST_ENABLE_MASK)) return false;
 
-	GeometryList.push(Geo);
+	GeometryList.push_back(Geo);
 	return true;
 }
 
@@ -159,17 +292,15 @@ void AlphaShadowRenderPass::UpdateConstants(NiGeometry* Geo) {
 	ShadowConstants->Data.y = 0.0f; // Alpha Control
 	TheRenderManager->CreateD3DMatrix(&TheShaderManager->ShaderConst.ShadowWorld, &Geo->m_worldTransform);
 
-	BSShaderProperty* ShaderProperty = (BSShaderProperty*)Geo->GetProperty(NiProperty::PropertyType::kType_Shade);
-	NiTexture* Texture = *((BSShaderPPLightingProperty*)ShaderProperty)->ppTextures[0];
-
-	if (Texture && Texture->rendererData->dTexture) {
+	IDirect3DBaseTexture9* Texture = GetTexture(Geo);
+	if (Texture) {
 
 		ShadowConstants->Data.y = 1.0f; // Alpha Control
 //			Constants.DiffuseMap = Texture->rendererData->dTexture;
 
 		//// Set diffuse texture at register 0
 		NiDX9RenderState* RenderState = TheRenderManager->renderState;
-		RenderState->SetTexture(0, Texture->rendererData->dTexture);
+		RenderState->SetTexture(0, Texture);
 		RenderState->SetSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_WRAP, false);
 		RenderState->SetSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_WRAP, false);
 		RenderState->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT, false);
@@ -179,7 +310,19 @@ void AlphaShadowRenderPass::UpdateConstants(NiGeometry* Geo) {
 }
 
 
+/*
+* Diffuse texture used for the alpha test.
+*/
+IDirect3DBaseTexture9* AlphaShadowRenderPass::GetTexture(NiGeometry* Geo) {
+	BSShaderProperty* ShaderProperty = (BSShaderProperty*)Geo->GetProperty(NiProperty::PropertyType::kType_Shade);
+	NiTexture* Texture = *((BSShaderPPLightingProperty*)ShaderProperty)->ppTextures[0];
+
+	return (Texture && Texture->rendererData) ? Texture->rendererData->dTexture : NULL;
+}
+
+
 SkinnedGeoShadowRenderPass::SkinnedGeoShadowRenderPass() {
+	Name = "Pass SkinnedGeo";
 	PixelShader = TheShadowManager->ShadowMapPixel;
 	VertexShader = TheShadowManager->ShadowMapVertex;
 	RegisterConstants();
@@ -199,7 +342,7 @@ bool SkinnedGeoShadowRenderPass::AccumObject(NiGeometry* Geo) {
 
 		// only accum if valid data preset
 		//if (Geo->skinInstance->SkinPartition->Partitions[0].BuffData)
-			GeometryList.push(Geo);
+			GeometryList.push_back(Geo);
 	
 		// we return true in any case because we still found skinned geo either way
 		return true;
@@ -303,6 +446,7 @@ void SkinnedGeoShadowRenderPass::RenderGeometry(NiGeometry* Geo) {
 
 
 SpeedTreeShadowRenderPass::SpeedTreeShadowRenderPass() {
+	Name = "Pass SpeedTree";
 	PixelShader = TheShadowManager->ShadowMapPixel;
 	VertexShader = TheShadowManager->ShadowMapVertex;
 	RegisterConstants();
@@ -325,7 +469,7 @@ bool SpeedTreeShadowRenderPass::AccumObject(NiGeometry* Geo) {
 	NiShadeProperty* shaderProp = static_cast<NiShadeProperty*>(Geo->GetProperty(NiProperty::kType_Shade));
 	if (shaderProp->m_eShaderType != NiShadeProperty::kProp_SpeedTreeLeaf) return false;
 
-	GeometryList.push(Geo);
+	GeometryList.push_back(Geo);
 	return true;
 }
 
@@ -348,8 +492,7 @@ void SpeedTreeShadowRenderPass::UpdateConstants(NiGeometry* Geo) {
 	Device->SetVertexShaderConstantF(67, Pointers::ShaderParams::WindMatrixes, 16);
 
 	SpeedTreeLeafShaderProperty* STProp = (SpeedTreeLeafShaderProperty*)Geo->GetProperty(NiProperty::PropertyType::kType_Shade);
-	BSTreeNode* Node = (BSTreeNode*)Geo->m_parent->m_parent;
-	NiDX9SourceTextureData* Texture = (NiDX9SourceTextureData*)Node->TreeModel->LeavesTexture->rendererData;
+	IDirect3DBaseTexture9* Texture = GetTexture(Geo);
 
 	if (Texture) ShadowConstants->Data.y = 1.0f;
 
@@ -357,7 +500,7 @@ void SpeedTreeShadowRenderPass::UpdateConstants(NiGeometry* Geo) {
 	Device->SetVertexShaderConstantF(83, STProp->leafData->leafBase, 48);
 	
 	// Set diffuse texture at register 0
-	RenderState->SetTexture(0, Texture->dTexture);
+	RenderState->SetTexture(0, Texture);
 	RenderState->SetSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_WRAP, false);
 	RenderState->SetSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_WRAP, false);
 	RenderState->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT, false);
@@ -366,7 +509,19 @@ void SpeedTreeShadowRenderPass::UpdateConstants(NiGeometry* Geo) {
 }
 
 
+/*
+* Leaves texture of the tree.
+*/
+IDirect3DBaseTexture9* SpeedTreeShadowRenderPass::GetTexture(NiGeometry* Geo) {
+	BSTreeNode* Node = (BSTreeNode*)Geo->m_parent->m_parent;
+	NiDX9SourceTextureData* Texture = (NiDX9SourceTextureData*)Node->TreeModel->LeavesTexture->rendererData;
+
+	return Texture ? Texture->dTexture : NULL;
+}
+
+
 TerrainLODPass::TerrainLODPass() {
+	Name = "Pass TerrainLOD";
 	PixelShader = TheShadowManager->ShadowMapPixel;
 	VertexShader = TheShadowManager->ShadowMapVertex;
 	RegisterConstants();
@@ -379,7 +534,7 @@ bool TerrainLODPass::AccumObject(NiGeometry* Geo) {
 	BSShaderProperty* ShaderProperty = (BSShaderProperty*)Geo->GetProperty(NiProperty::PropertyType::kType_Shade);
 	if (!ShaderProperty || !ShaderProperty->IsLightingProperty()) return false;
 
-	GeometryList.push(Geo);
+	GeometryList.push_back(Geo);
 	return true;
 }
 
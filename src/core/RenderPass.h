@@ -1,24 +1,50 @@
 #pragma once
 
+#include "InstanceStream.h"
+
 class RenderPass {
 public:
-	RenderPass() {};
+	static const UInt32 InstancesMax = 1024;		// instances of a single draw
+
+	/*
+	* An accumulated object and the state it is sorted by, so the objects sharing buffers and textures are drawn one after another.
+	*/
+	struct AccumEntry {
+		NiGeometry*					Geo;
+		NiGeometryBufferData*		GeoData;
+		void*						Declaration;	// vertex declaration, or FVF of the geometry
+		IDirect3DBaseTexture9*		Texture;		// texture bound by the pass
+		IDirect3DVertexBuffer9*		VertexBuffer;
+		IDirect3DIndexBuffer9*		IndexBuffer;
+		UInt32						CullMode;		// stencil property draw mode + 1, 0 without stencil property
+	};
+
+	RenderPass() { Instancing = false; InstancedVertexShader = NULL; };
 	virtual ~RenderPass() {
 		VertexShader = NULL;
+		InstancedVertexShader = NULL;
 		PixelShader = NULL;
 	};
 
 	ShaderRecordVertex* VertexShader;
+	ShaderRecordVertex* InstancedVertexShader; // variant of the vertex shader reading the instance stream, NULL to draw the meshes one by one
 	ShaderRecordPixel* PixelShader;
+	const char* Name; // GPU profiler scope
+	bool Instancing; // identical meshes are drawn with hardware instancing
 
-	std::stack<NiGeometry*>	GeometryList;
+	std::vector<NiGeometry*>	GeometryList;
+	std::vector<AccumEntry>		Entries;
 	virtual bool AccumObject(NiGeometry* Geo) { return true; };
 	virtual void UpdateConstants(NiGeometry* Geo) {};
+	virtual IDirect3DBaseTexture9* GetTexture(NiGeometry* Geo) { return NULL; };
 	virtual void RenderGeometry(NiGeometry* Geo);
 	virtual void RegisterConstants() {};
 
 	void DrawGeometryBuffer(NiGeometry* Geo, NiGeometryBufferData* GeoData);
 	void DrawSkinnedGeometryBuffer(NiGeometry* Geo, NiGeometryBufferData* GeoData, NiSkinPartition::Partition* Partition);
+	void SortGeometry();
+	UInt32 GetInstancesCount(UInt32 First);
+	bool RenderInstances(AccumEntry* First, UInt32 Count);
 	void RenderAccum();
 };
 
@@ -48,6 +74,7 @@ public:
 	bool AccumObject(NiGeometry* Geo);
 	void RegisterConstants();
 	void UpdateConstants(NiGeometry* Geo);
+	IDirect3DBaseTexture9* GetTexture(NiGeometry* Geo);
 };
 
 
@@ -82,6 +109,7 @@ public:
 	bool AccumObject(NiGeometry* Geo);
 	void RegisterConstants(); 
 	void UpdateConstants(NiGeometry* Geo);
+	IDirect3DBaseTexture9* GetTexture(NiGeometry* Geo);
 };
 
 
@@ -136,7 +136,7 @@ bool SettingManager::Configuration::FillNode(ConfigNode* Node, const char* Secti
 			return false;
 		}
 	}
-	catch (std::out_of_range) {
+	catch (const std::out_of_range&) {
 		//Logger::Log("Key %s not found in default section %s", Key, path);
 		return false;
 	}
@@ -209,7 +209,7 @@ tomlValue* SettingManager::Configuration::FindSection(tomlValue* table, StringLi
 		keys->erase(keys->begin()); // remove first element
 		return FindSection(sub, std::move(keys));
 	}
-	catch (std::out_of_range e) {
+	catch (const std::out_of_range&) {
 		return NULL;
 	}
 }
@@ -350,20 +350,29 @@ void SettingManager::Initialize() {
 	TheSettingManager->GameLoading = false;
 	TheSettingManager->SettingsChanged = true;
 	TheSettingManager->hasUnsavedChanges = false;
+	TheSettingManager->RecordingSubscriber = NULL;
+	memset(TheSettingManager->SlotCache, 0, sizeof(TheSettingManager->SlotCache));
+
+	// the settings structs are refreshed like any other subscriber, each area only when a section it reads changes
+	TheSettingManager->Subscribe("Settings.Main", []() { TheSettingManager->LoadMainSettings(); });
+	TheSettingManager->Subscribe("Settings.Gameplay", []() { TheSettingManager->LoadGameplaySettings(); });
+	TheSettingManager->Subscribe("Settings.Menu", []() {
+		TheSettingManager->LoadMenuSettings();
+		if (TheGameMenuManager) {
+			TheGameMenuManager->UpdateSettings();
+			TheGameMenuManager->ValidateSelection();
+		}
+	});
+	TheSettingManager->Subscribe("Settings.Develop", []() { TheSettingManager->LoadDevelopSettings(); });
+	TheSettingManager->Subscribe("Settings.Weathers", []() { TheSettingManager->LoadWeatherSettings(); });
+	TheSettingManager->Subscribe("Settings.Coloring", []() { TheSettingManager->LoadColoringSettings(); });
+	TheSettingManager->Subscribe("Settings.Water", []() { TheSettingManager->LoadWaterSettings(); });
 }
 
-void SettingManager::LoadSettings() {
-
-	auto timer = TimeLogger();
-
-	StringList List;
-	StringList InnerList;
-	SettingsWaterStruct SW{};
-	SettingsColoringStruct SC{};
-	SettingsWeatherStruct SE{};
-	char Value[80];
-
-	if (!Config.configLoaded) Config.Init();
+/*
+* Engine and rendering options.
+*/
+void SettingManager::LoadMainSettings() {
 
 	SettingsMain.Main.RemoveUnderwater = GetSettingI("Main.Main.Water", "RemoveUnderwater");
 	SettingsMain.Main.RemovePrecipitations = GetSettingI("Main.Main.Precipitations", "RemovePrecipitations");
@@ -375,6 +384,9 @@ void SettingManager::LoadSettings() {
 	SettingsMain.Main.ScreenshotKey = GetSettingI("Main.Main.Misc", "ScreenshotKey");
 	SettingsMain.Main.HDRScreenshot = GetSettingI("Main.Main.Misc", "HDRScreenshot");
 	SettingsMain.Main.ReplaceIntro = GetSettingI("Main.Main.Misc", "ReplaceIntro");
+	SettingsMain.Main.AsyncTextureLoading = GetSettingI("Main.Main.Misc", "AsyncTextureLoading");
+	SettingsMain.Main.FilterDeviceStates = GetSettingI("Main.Main.Misc", "FilterDeviceStates");
+	SettingsMain.Main.RenderTargetsBudget = GetSettingI("Main.Main.Misc", "RenderTargetsBudget");
 	SettingsMain.Main.ForceMSAA = GetSettingI("Main.Main.Misc", "ForceMSAA");
 	SettingsMain.Main.SkipFog = GetSettingI("Main.Main.Misc", "SkipFog");
 	SettingsMain.Main.RenderEffects = GetSettingI("Main.Main.Misc", "RenderEffects");
@@ -383,6 +395,7 @@ void SettingManager::LoadSettings() {
 	SettingsMain.FrameRate.SmartControl = GetSettingI("Main.FrameRate.SmartControl", "SmartControl");
 	SettingsMain.FrameRate.SmartControlFPS = GetSettingI("Main.FrameRate.SmartControl", "SmartControlFPS");
 	SettingsMain.FrameRate.FlowControl = GetSettingF("Main.FrameRate.SmartControl", "FlowControl");
+	SettingsMain.FrameRate.FrameSmoothing = GetSettingF("Main.FrameRate.SmartControl", "FrameSmoothing");
 	SettingsMain.FrameRate.SmartBackgroundProcess = GetSettingI("Main.FrameRate.Stuttering", "SmartBackgroundProcess");
 	SettingsMain.FrameRate.BackgroundThreadPriority = GetSettingI("Main.FrameRate.Stuttering", "BackgroundThreadPriority");
 
@@ -397,11 +410,27 @@ void SettingManager::LoadSettings() {
 	SettingsMain.OcclusionCulling.OccludedStatic = GetSettingI("Main.OcclusionCulling.Main", "OccludedStatic");
 	SettingsMain.OcclusionCulling.OccludedDistantStatic = GetSettingI("Main.OcclusionCulling.Main", "OccludedDistantStatic");
 	SettingsMain.OcclusionCulling.OccludedDistantStaticIC = GetSettingI("Main.OcclusionCulling.Main", "OccludedDistantStaticIC");
+	SettingsMain.OcclusionCulling.SoftwareRasterizer = GetSettingI("Main.OcclusionCulling.Main", "SoftwareRasterizer");
 	SettingsMain.OcclusionCulling.OccludingStaticMin = GetSettingF("Main.OcclusionCulling.Main", "OccludingStaticMin");
 	SettingsMain.OcclusionCulling.OccludedStaticMin = GetSettingF("Main.OcclusionCulling.Main", "OccludedStaticMin");
 	SettingsMain.OcclusionCulling.OccludedStaticMax = GetSettingF("Main.OcclusionCulling.Main", "OccludedStaticMax");
 	SettingsMain.OcclusionCulling.OccludedDistantStaticMax = GetSettingF("Main.OcclusionCulling.Main", "OccludedDistantStaticMax");
 
+	SettingsMain.ShadowMode.NearQuality = GetSettingF("Main.ShadowMode.Main", "NearQuality");
+
+	SettingsMain.Purger.Enabled = GetSettingI("Main.Purger.Main", "Enabled");
+	SettingsMain.Purger.Time = GetSettingI("Main.Purger.Main", "Time");
+	SettingsMain.Purger.PurgeTextures = GetSettingI("Main.Purger.Main", "PurgeTextures");
+	SettingsMain.Purger.PurgeCells = GetSettingI("Main.Purger.Main", "PurgeCells");
+	SettingsMain.Purger.Key = GetSettingI("Main.Purger.Main", "Key");
+
+}
+
+/*
+* Camera, equipment and the other gameplay features.
+*/
+void SettingManager::LoadGameplaySettings() {
+
 	SettingsMain.CameraMode.Enabled = GetSettingI("Main.CameraMode.Main", "Enabled");
 	SettingsMain.CameraMode.Crosshair = GetSettingI("Main.CameraMode.Main", "Crosshair");
 	SettingsMain.CameraMode.ChasingFirst = GetSettingI("Main.CameraMode.Main", "ChasingFirst");
@@ -509,7 +538,28 @@ void SettingManager::LoadSettings() {
 	SettingsMain.WeatherMode.CoeffSun.y = GetSettingF("Main.WeatherMode.General", "CoeffSunG");
 	SettingsMain.WeatherMode.CoeffSun.z = GetSettingF("Main.WeatherMode.General", "CoeffSunB");
 
-	SettingsMain.ShadowMode.NearQuality = GetSettingF("Main.ShadowMode.Main", "NearQuality");
+	SettingsMain.Gravity.Enabled = GetSettingI("Main.Gravity.Main", "Enabled");
+	SettingsMain.Gravity.Value = GetSettingF("Main.Gravity.Main", "Value");
+
+	SettingsMain.Dodge.Enabled = GetSettingI("Main.Dodge.Main", "Enabled");
+	SettingsMain.Dodge.AcrobaticsLevel = GetSettingI("Main.Dodge.Main", "AcrobaticsLevel");
+	SettingsMain.Dodge.DoubleTap = GetSettingI("Main.Dodge.Main", "DoubleTap");
+	SettingsMain.Dodge.DoubleTapTime = GetSettingF("Main.Dodge.Main", "DoubleTapTime");
+
+	SettingsMain.FlyCam.Enabled = GetSettingI("Main.FlyCam.Main", "Enabled");
+	SettingsMain.FlyCam.ScrollMultiplier = GetSettingF("Main.FlyCam.Main", "ScrollMultiplier");
+	SettingsMain.FlyCam.KeyAdd = GetSettingI("Main.FlyCam.Main", "KeyAdd");
+	SettingsMain.FlyCam.KeySubtract = GetSettingI("Main.FlyCam.Main", "KeySubtract");
+	SettingsMain.FlyCam.StepValue = GetSettingF("Main.FlyCam.Main", "StepValue");
+
+}
+
+/*
+* Style and keys of the menu.
+*/
+void SettingManager::LoadMenuSettings() {
+
+	char Value[80];
 
 	strcpy(SettingsMain.Menu.TextFont, GetSettingS("Main.Menu.Style", "TextFont", Value));
 	SettingsMain.Menu.TextSize = GetSettingI("Main.Menu.Style", "TextSize");
@@ -544,29 +594,31 @@ void SettingManager::LoadSettings() {
 	SettingsMain.Menu.KeyEditing = GetSettingI("Main.Menu.Keys", "KeyEditing");
 	SettingsMain.Menu.UseNumpadForEditing = GetSettingI("Main.Menu.Keys", "EntryUseNumpad");
 
-	SettingsMain.Purger.Enabled = GetSettingI("Main.Purger.Main", "Enabled");
-	SettingsMain.Purger.Time = GetSettingI("Main.Purger.Main", "Time");
-	SettingsMain.Purger.PurgeTextures = GetSettingI("Main.Purger.Main", "PurgeTextures");
-	SettingsMain.Purger.PurgeCells = GetSettingI("Main.Purger.Main", "PurgeCells");
-	SettingsMain.Purger.Key = GetSettingI("Main.Purger.Main", "Key");
-
-	SettingsMain.Gravity.Enabled = GetSettingI("Main.Gravity.Main", "Enabled");
-	SettingsMain.Gravity.Value = GetSettingF("Main.Gravity.Main", "Value");
-
-	SettingsMain.Dodge.Enabled = GetSettingI("Main.Dodge.Main", "Enabled");
-	SettingsMain.Dodge.AcrobaticsLevel = GetSettingI("Main.Dodge.Main", "AcrobaticsLevel");
-	SettingsMain.Dodge.DoubleTap = GetSettingI("Main.Dodge.Main", "DoubleTap");
-	SettingsMain.Dodge.DoubleTapTime = GetSettingF("Main.Dodge.Main", "DoubleTapTime");
+}
 
-	SettingsMain.FlyCam.Enabled = GetSettingI("Main.FlyCam.Main", "Enabled");
-	SettingsMain.FlyCam.ScrollMultiplier = GetSettingF("Main.FlyCam.Main", "ScrollMultiplier");
-	SettingsMain.FlyCam.KeyAdd = GetSettingI("Main.FlyCam.Main", "KeyAdd");
-	SettingsMain.FlyCam.KeySubtract = GetSettingI("Main.FlyCam.Main", "KeySubtract");
-	SettingsMain.FlyCam.StepValue = GetSettingF("Main.FlyCam.Main", "StepValue");
+/*
+* Debug and logging options.
+*/
+void SettingManager::LoadDevelopSettings() {
 
 	SettingsMain.Develop.DebugMode = GetSettingI("Main.Develop.Main", "DebugMode");
 	SettingsMain.Develop.TraceShaders = GetSettingI("Main.Develop.Main", "TraceShaders");
+	SettingsMain.Develop.TraceCapture = GetSettingI("Main.Develop.Main", "TraceCapture");
+	SettingsMain.Develop.TraceStates = GetSettingI("Main.Develop.Main", "TraceStates");
+	SettingsMain.Develop.TraceStatesFrames = GetSettingI("Main.Develop.Main", "TraceStatesFrames");
+	Logger::SetLevel(Logger::CategoryGeneral, GetSettingI("Main.Develop.Log", "General"));
+	Logger::SetLevel(Logger::CategoryTexture, GetSettingI("Main.Develop.Log", "Texture"));
+	Logger::SetLevel(Logger::CategoryVulkan, GetSettingI("Main.Develop.Log", "Vulkan"));
+	Logger::SetRateLimit(GetSettingI("Main.Develop.Log", "RateLimit"));
+
+}
 
+void SettingManager::LoadWeatherSettings() {
+
+	StringList List;
+	StringList InnerList;
+	SettingsWeatherStruct SE{};
+	char Value[80];
 
 	Config.FillSections(&List, "Weathers"); // get the list of weathers
 	for (StringList::iterator Iter = List.begin(); Iter != List.end(); ++Iter) {
@@ -609,6 +661,13 @@ void SettingManager::LoadSettings() {
 		SettingsWeather[WeatherSection] = SE;
 	}
 
+}
+
+void SettingManager::LoadColoringSettings() {
+
+	StringList List;
+	SettingsColoringStruct SC{};
+
 	Config.FillSections(&List, "Shaders.Coloring"); // get the list of coloring sections
 	for (StringList::iterator Iter = List.begin(); Iter != List.end(); ++Iter) {
 		const char* ColoringSection = Iter->c_str();
@@ -636,6 +695,13 @@ void SettingManager::LoadSettings() {
 		}
 	}
 
+}
+
+void SettingManager::LoadWaterSettings() {
+
+	StringList List;
+	SettingsWaterStruct SW{};
+
 	Config.FillSections(&List, "Shaders.Water"); // get the list of waters
 	for (StringList::iterator Iter = List.begin(); Iter != List.end(); ++Iter) {
 		const char* WaterSection = Iter->c_str();
@@ -661,11 +727,6 @@ void SettingManager::LoadSettings() {
 		}
 	}
 
-	SettingsChanged = true;
-	timer.LogTime("SettingsManager::LoadSettings");
-
-	if (TheGameMenuManager)
-		TheGameMenuManager->ValidateSelection();
 }
 
 
@@ -704,27 +765,65 @@ void SettingManager::SaveSettings() {
 	hasUnsavedChanges = false;
 }
 
-int SettingManager::GetSettingI(const char* Section, const char* Key) {
+/*
+* Returns the slot holding the setting, resolving it the first time it is requested.
+* Repeated calls with the same strings are answered from the slot cache without building the name.
+*/
+SettingSlot* SettingManager::GetSettingSlot(const char* Section, const char* Key) {
+	if (!Config.configLoaded) Config.Init();
+	if (RecordingSubscriber) RecordingSubscriber->Sections.insert(Section);
+
+	UINT_PTR Hash = ((UINT_PTR)Section >> 2) ^ ((UINT_PTR)Key * 31);
+	SlotCacheEntry* Cached = &SlotCache[(Hash ^ (Hash >> 11)) & (SlotCacheSize - 1)];
+	if (Cached->Section == Section && Cached->Key == Key && Cached->Slot->Section == Section && Cached->Slot->Key == Key) return Cached->Slot;
+
+	std::string Name = Section;
+	Name += ':';
+	Name += Key;
+
+	auto Item = SettingSlots.try_emplace(Name);
+	SettingSlot* Slot = &Item.first->second;
+	if (Item.second) {
+		Slot->Section = Section;
+		Slot->Key = Key;
+		ResolveSettingSlot(Slot);
+	}
+	*Cached = { Section, Key, Slot };
+	return Slot;
+}
+
+/*
+* Reads the setting from the config (or the defaults) and stores it in its native types.
+* Conversions are the same the string based getters always did, so values read through handles are identical.
+*/
+void SettingManager::ResolveSettingSlot(SettingSlot* Slot) {
 	Configuration::ConfigNode Node;
-	int Value = 0; //default in case the setting doesn't exist
 
-	if (Config.FillNode(&Node, Section, Key)) Value = atoi(Node.Value); // convert back from string to final type (TODO: store as native type)
-	return Value;
+	Slot->Exists = Config.FillNode(&Node, Slot->Section.c_str(), Slot->Key.c_str());
+	if (Slot->Exists) {
+		Slot->Type = Node.Type;
+		Slot->IntValue = atoi(Node.Value);
+		Slot->FloatValue = atof(Node.Value);
+		Slot->StringValue = Node.Value;
+	}
+	else {
+		Slot->Type = Configuration::NodeType::String;
+		Slot->IntValue = 0; //default in case the setting doesn't exist
+		Slot->FloatValue = 0.0f;
+		Slot->StringValue = "\"";
+	}
 }
 
-float SettingManager::GetSettingF(const char* Section, const char* Key) {
-	Configuration::ConfigNode Node;
-	float Value = 0.0f; //default in case the setting doesn't exist
+int SettingManager::GetSettingI(const char* Section, const char* Key) {
+	return GetSettingSlot(Section, Key)->IntValue;
+}
 
-	if (Config.FillNode(&Node, Section, Key)) Value = atof(Node.Value); // convert back from string to final type (TODO: store as native type)
-	return Value;
+float SettingManager::GetSettingF(const char* Section, const char* Key) {
+	return GetSettingSlot(Section, Key)->FloatValue;
 }
 
 char* SettingManager::GetSettingS(const char* Section, const char* Key, char* Value) {
-	Configuration::ConfigNode Node;
-	
-	strcpy(Value, "\""); //default in case the setting doesn't exist
-	if (Config.FillNode(&Node, Section, Key)) strcpy(Value, Node.Value);
+	strcpy(Value, GetSettingSlot(Section, Key)->StringValue.c_str());
 	return Value;
 }
 
@@ -811,8 +910,7 @@ void SettingManager::SetSettingF(const char* Section, const char* Key, float Val
 		break;
 	}
 
-	SetSetting(&Node);
-	LoadSettings(); // refresh settings struct
+	SetSetting(&Node); // the settings structs are refreshed by their subscriber
 }
 
 
@@ -824,6 +922,119 @@ void SettingManager::SetSetting(Configuration::ConfigNode* Node) {
 	hasUnsavedChanges = true;
 
 	Config.SetValue(Node);
+
+	// keep the handles on this setting up to date, and only notify the readers of the section if the value actually changed
+	std::string Name = Node->Section;
+	Name += ':';
+	Name += Node->Key;
+	if (auto Item = SettingSlots.find(Name); Item != SettingSlots.end()) {
+		std::string Previous = Item->second.StringValue;
+		ResolveSettingSlot(&Item->second);
+		if (Previous == Item->second.StringValue) return;
+	}
+	NotifySectionChanged(Node->Section);
+}
+
+
+/*
+* Registers an update callback. It runs on the next UpdateSubscribers, then again only when a section it read changed.
+*/
+void SettingManager::Subscribe(const char* Name, std::function<void()> Update, std::function<const char*()> Context) {
+	SettingsSubscriber& Subscriber = Subscribers.emplace_back();
+	Subscriber.Name = Name;
+	Subscriber.Update = Update;
+	Subscriber.Context = Context;
+	Subscriber.Pending = true;
+}
+
+
+void SettingManager::NotifySectionChanged(const char* Section) {
+	for (SettingsSubscriber& Subscriber : Subscribers) {
+		if (Subscriber.Sections.count(Section)) Subscriber.Pending = true;
+	}
+	SettingsChanged = true;
+}
+
+
+/*
+* Runs the pending subscribers, recording the sections each one reads. Returns true if any ran.
+*/
+bool SettingManager::UpdateSubscribers() {
+	bool Updated = false;
+	for (SettingsSubscriber& Subscriber : Subscribers) {
+		if (!Subscriber.Pending) continue;
+
+		TraceZone Zone(Subscriber.Name.c_str());
+		Subscriber.Pending = false;
+		Subscriber.Sections.clear();
+		RecordingSubscriber = &Subscriber;
+		Subscriber.Update();
+		RecordingSubscriber = NULL;
+		if (Subscriber.Context) {
+			const char* Context = Subscriber.Context();
+			Subscriber.LastContext = Context ? Context : "";
+		}
+		Updated = true;
+	}
+	if (Updated) SettingsChanged = true;
+	return Updated;
+}
+
+
+/*
+* Called on cell changes. Subscribers whose settings depend on the game state only refresh if the section they would read now
+* resolves to different values than the one they read last time. Contexts that aren't sections always refresh when they change.
+*/
+void SettingManager::RefreshSubscribersContext() {
+	for (SettingsSubscriber& Subscriber : Subscribers) {
+		if (!Subscriber.Context || Subscriber.Pending) continue;
+
+		const char* Context = Subscriber.Context();
+		if (!Context) Context = "";
+		if (Subscriber.LastContext == Context) continue;
+
+		if (SectionsDiffer(Subscriber.LastContext.c_str(), Context)) {
+			Subscriber.Pending = true;
+		}
+		else {
+			Subscriber.Sections.insert(Context); // same values, but later edits of the new section must reach it
+			Subscriber.LastContext = Context;
+		}
+	}
+}
+
+
+/*
+* Compares two sections key by key, using the resolved values. The keys are the ones of both sections in the defaults and in the
+* user config, so a key only one of them sets is compared too. Names that are a section of neither config always differ.
+*/
+bool SettingManager::SectionsDiffer(const char* Section, const char* OtherSection) {
+	std::unordered_set<std::string> Keys;
+	bool Found = false;
+
+	for (const char* Name : { Section, OtherSection }) {
+		char Path[256] = "_";
+		strcat(Path, Name);
+		for (tomlValue* Root : { &Config.DefaultConfig, &Config.TomlConfig }) {
+			StringList Parts;
+			SplitString(Path, ".", &Parts);
+			tomlValue* Table = Config.FindSection(Root, &Parts);
+			if (!Table || !Table->is_table()) continue;
+
+			Found = true;
+			for (const auto& [Key, Value] : Table->as_table()) {
+				if (!Value.is_table()) Keys.insert(Key);
+			}
+		}
+	}
+	if (!Found) return true;
+
+	for (const std::string& Key : Keys) {
+		SettingSlot* Slot = GetSettingSlot(Section, Key.c_str());
+		SettingSlot* OtherSlot = GetSettingSlot(OtherSection, Key.c_str());
+		if (Slot->Exists != OtherSlot->Exists || Slot->StringValue != OtherSlot->StringValue) return true;
+	}
+	return false;
 }
 
 void SettingManager::Increment(const char* Section, const char* Key) {
@@ -962,7 +1173,7 @@ void SettingManager::SetSettingWeather(const char* Section, const char* Key, flo
 				strcat(ColorSection, Values[1].c_str());
 				strcat(ColorSection, ".");
 				strcat(ColorSection, "Colors");
-				sprintf(ColorNode, "Color%i", x);
+				sprintf(ColorNode, "Color%i", (int)x);
 				CreateNodeS(&Node, ColorSection, ColorNode, AttributeValue, 0);
 				break;
 			}
@@ -1192,7 +1403,7 @@ bool SettingManager::GetMenuShaderEnabled(const char* Name) {
 	}
 
 	strcat(settingString, ".Status");
-	bool enabled = (bool*)GetSettingI(settingString, "Enabled");
+	bool enabled = GetSettingI(settingString, "Enabled");
 	if (!enabled && IsShaderForced(Name)) {
 		SetMenuShaderEnabled(Name, true);
 		enabled = true;
@@ -1212,7 +1423,7 @@ void SettingManager::SetMenuShaderEnabled(const char* Name, bool enabled) {
 bool SettingManager::GetMenuMiscEnabled(const char* Name) {
 	char settingString[256];
 	strcpy(settingString, "Main.Main.Misc");
-	return (bool*)GetSettingI(settingString, Name);
+	return GetSettingI(settingString, Name);
 }
 
 
@@ -2,6 +2,9 @@
 
 #define TOML11_PRESERVE_COMMENTS_BY_DEFAULT
 #include "../lib/toml11/toml.hpp"
+#include <list>
+#include <unordered_set>
+#include <functional>
 
 
 struct SettingsMainStruct {
@@ -13,12 +16,15 @@ struct SettingsMainStruct {
 		bool	RemovePrecipitations;
 		bool	MemoryHeapManagement;
 		bool	MemoryTextureManagement;
+		bool	AsyncTextureLoading;
+		bool	FilterDeviceStates;
 		bool	ReplaceIntro;
         bool    SkipFog;
         bool    RenderEffects;
         bool    RenderPreTonemapping;
 		UInt8	AnisotropicFilter;
 		UInt16	ScreenshotKey;
+		UInt32	RenderTargetsBudget;
 		bool	HDRScreenshot;
 		float	FarPlaneDistance;
 	};
@@ -29,6 +35,7 @@ struct SettingsMainStruct {
 		UInt32	SmartControlFPS;
 		UInt32  BackgroundThreadPriority;
 		float	FlowControl;
+		float	FrameSmoothing;
 	};
 
 	struct CullingProcessStruct {
@@ -44,6 +51,7 @@ struct SettingsMainStruct {
 		bool	OccludedStatic;
 		bool	OccludedDistantStatic;
 		bool	OccludedDistantStaticIC;
+		bool	SoftwareRasterizer;
 		UInt32	OcclusionMapRatio;
 		float	OccludingStaticMin;
 		float	OccludedStaticMin;
@@ -202,6 +210,9 @@ struct SettingsMainStruct {
 	struct DevelopStruct {
 		bool    DebugMode;       // enables hotkeys to print textures
 		UInt8	TraceShaders;
+		bool	TraceCapture;	// records the CPU zones while enabled, written as a Chrome trace when disabled
+		bool	TraceStates;	// records the device calls of TraceStatesFrames frames when enabled, decoded by decodeStateCapture.py
+		UInt32	TraceStatesFrames;
 	};
 
 	MainStruct					Main;
@@ -288,6 +299,54 @@ typedef std::map<std::string, SettingsWeatherStruct> SettingsWeatherMap;
 typedef std::vector<std::string> StringList;
 typedef toml::basic_value<toml::preserve_comments, std::map, std::vector> tomlValue;
 
+/*
+* Stable storage for a setting resolved by section/key. The value is converted once to every native type it can be read as.
+*/
+struct SettingSlot {
+	std::string		Section;
+	std::string		Key;
+	UInt32			Type;
+	bool			Exists;
+	int				IntValue;
+	float			FloatValue;
+	std::string		StringValue;
+};
+
+/*
+* Something that reads settings and has to refresh when they change (effects, shader collections, the settings structs).
+* The sections read by the last update are recorded, so only changes to those sections mark it as pending.
+* Context optionally returns the section it reads for the current game state, checked when the cell changes.
+*/
+struct SettingsSubscriber {
+	std::string							Name;
+	std::function<void()>				Update;
+	std::function<const char*()>		Context;
+	std::string							LastContext;
+	std::unordered_set<std::string>		Sections;
+	bool								Pending;
+};
+
+/*
+* Handle to a setting resolved once through SettingManager::GetSettingHandle. Reading it doesn't look up or parse anything,
+* and it always reflects the last value set since the slot is refreshed when the setting changes.
+*/
+template <typename T> class SettingHandle {
+public:
+	SettingHandle() : Slot(NULL) {};
+	SettingHandle(SettingSlot* Setting) : Slot(Setting) {};
+
+	T Get() const {
+		if constexpr (std::is_same_v<T, float>) return Slot ? Slot->FloatValue : 0.0f;
+		else if constexpr (std::is_same_v<T, bool>) return Slot ? Slot->IntValue != 0 : false;
+		else if constexpr (std::is_same_v<T, const char*>) return Slot ? Slot->StringValue.c_str() : "";
+		else return Slot ? (T)Slot->IntValue : (T)0;
+	};
+	operator T() const { return Get(); };
+	bool IsValid() const { return Slot && Slot->Exists; };
+
+	SettingSlot* Slot;
+};
+
 class SettingManager : public SettingManagerBase {
 public:
 	class Configuration {
@@ -337,8 +396,16 @@ public:
 	};
 
 	static void				Initialize();
-	void					LoadSettings();
+	void					LoadMainSettings();
+	void					LoadGameplaySettings();
+	void					LoadMenuSettings();
+	void					LoadDevelopSettings();
+	void					LoadWeatherSettings();
+	void					LoadColoringSettings();
+	void					LoadWaterSettings();
 	void					SaveSettings();
+	SettingSlot*			GetSettingSlot(const char* Section, const char* Key);
+	template <typename T> SettingHandle<T> GetSettingHandle(const char* Section, const char* Key) { return SettingHandle<T>(GetSettingSlot(Section, Key)); };
 	int						GetSettingI(const char* Section, const char* Key);
 	float					GetSettingF(const char* Section, const char* Key);
 	char*					GetSettingS(const char* Section, const char* Key, char* Value);
@@ -368,6 +435,11 @@ public:
 	SettingsWeatherStruct*	GetSettingsWeather(const char* WeatherName);
 	void					SetSettingsWeather(TESWeather* Weather);
 	bool					IsShaderForced(const char* Name);
+	void					Subscribe(const char* Name, std::function<void()> Update, std::function<const char*()> Context = nullptr);
+	void					NotifySectionChanged(const char* Section);
+	bool					UpdateSubscribers();
+	void					RefreshSubscribersContext();
+	bool					SectionsDiffer(const char* Section, const char* OtherSection);
 
 	template <typename T> static std::string	ToString(const T Value);
 	template <typename T> static T				FromString(const char* Value);
@@ -384,5 +456,22 @@ public:
 	SettingsWeatherMap				SettingsWeather;
 
 private:
+	/*
+	* Direct-mapped cache of the slots by the addresses of the section and key, so the getters called with literals don't build
+	* and hash the setting name. A hit is checked against the slot text, as a buffer can be reused for another section.
+	*/
+	struct SlotCacheEntry {
+		const char*		Section;
+		const char*		Key;
+		SettingSlot*	Slot;
+	};
+	static const UInt32 SlotCacheSize = 2048;
+
 	void					FilterMenuSections(StringList* Sections, const char* ParentSection);
+	void					ResolveSettingSlot(SettingSlot* Slot);
+
+	std::unordered_map<std::string, SettingSlot>	SettingSlots; // nodes are never moved, handles keep pointing to them
+	SlotCacheEntry									SlotCache[SlotCacheSize];
+	std::list<SettingsSubscriber>					Subscribers;
+	SettingsSubscriber*								RecordingSubscriber;
 };
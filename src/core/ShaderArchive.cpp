@@ -0,0 +1,135 @@
+ShaderArchive ShaderArchive::Precompiled(ShaderArchivePath);
+
+ShaderArchive::ShaderArchive(const char* ArchiveFile) {
+
+	Path = ArchiveFile;
+	FileHandle = INVALID_HANDLE_VALUE;
+	Mapping = NULL;
+	View = NULL;
+	ViewSize = 0;
+	Head = NULL;
+	Entries = NULL;
+	Files = NULL;
+	Dependencies = NULL;
+	Opened = false;
+
+}
+
+
+ShaderArchive::~ShaderArchive() {
+
+	if (View) UnmapViewOfFile(View);
+	if (Mapping) CloseHandle(Mapping);
+	if (FileHandle != INVALID_HANDLE_VALUE) CloseHandle(FileHandle);
+
+}
+
+
+/*
+* Maps the archive on the first lookup. A missing archive is not an error, every lookup then fails.
+*/
+void ShaderArchive::Open() {
+
+	Opened = true;
+
+	FileHandle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (FileHandle == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(FileHandle, &Size) || Size.QuadPart < (LONGLONG)sizeof(Header)) {
+		Logger::Log("[ERROR] Shader archive %s is invalid.", Path.c_str());
+		return;
+	}
+	Mapping = CreateFileMappingA(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (Mapping) View = (const UInt8*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!View) {
+		Logger::Log("[ERROR] Couldn't map shader archive %s.", Path.c_str());
+		return;
+	}
+	ViewSize = Size.QuadPart;
+
+	const Header* Item = (const Header*)View;
+	UInt64 TablesSize = sizeof(Header) + (UInt64)Item->EntriesCount * sizeof(Entry) + (UInt64)Item->FilesCount * sizeof(File) + (UInt64)Item->DependenciesCount * sizeof(uint32_t);
+	if (memcmp(Item->Magic, "TRSP", 4) || Item->Version != Version || TablesSize > ViewSize) {
+		Logger::Log("[ERROR] Shader archive %s has an unsupported format, it is ignored.", Path.c_str());
+		return;
+	}
+
+	Head = Item;
+	Entries = (const Entry*)(View + sizeof(Header));
+	Files = (const File*)(Entries + Head->EntriesCount);
+	Dependencies = (const uint32_t*)(Files + Head->FilesCount);
+	States.assign(Head->FilesCount, Unchecked);
+	Logger::Log("Shader archive loaded: %u shaders and effects.", Head->EntriesCount);
+
+}
+
+
+bool ShaderArchive::IsRangeValid(UInt32 Offset, UInt32 Size) {
+
+	return (UInt64)Offset + Size <= ViewSize;
+
+}
+
+
+/*
+* The files are hashed the first time an entry depends on them; a file that changed invalidates all the entries using it.
+*/
+bool ShaderArchive::IsEntryValid(const Entry* Item) {
+
+	if ((UInt64)Item->FirstDependency + Item->DependenciesCount > Head->DependenciesCount) return false;
+
+	for (UInt32 i = 0; i < Item->DependenciesCount; i++) {
+		UInt32 Index = Dependencies[Item->FirstDependency + i];
+		if (Index >= Head->FilesCount) return false;
+
+		if (States[Index] == Unchecked) {
+			const File* Dependency = &Files[Index];
+			UInt64 Hash = 0;
+			bool Same = IsRangeValid(Dependency->PathOffset, Dependency->PathSize + 1) && !View[Dependency->PathOffset + Dependency->PathSize] &&
+				ShaderCache::HashFile((const char*)View + Dependency->PathOffset, &Hash) && Hash == Dependency->Hash;
+			States[Index] = Same ? Unchanged : Changed;
+		}
+		if (States[Index] != Unchanged) return false;
+	}
+	return true;
+
+}
+
+
+bool ShaderArchive::CreateBuffer(const UInt8* Data, UInt32 Size, ID3DXBuffer** Buffer) {
+
+	if (!Size || FAILED(D3DXCreateBuffer(Size, Buffer))) return false;
+	memcpy((*Buffer)->GetBufferPointer(), Data, Size);
+	return true;
+
+}
+
+
+/*
+* Copies the preprocessed source and the binary of an entry into new buffers (the caller releases them).
+* Returns false, with no buffer created, if the archive has no valid entry for this setup.
+*/
+bool ShaderArchive::Find(const char* CompiledPath, UInt64 ConfigHash, ID3DXBuffer** Source, ID3DXBuffer** Binary) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	if (!Opened) Open();
+	if (!Head) return false;
+
+	UInt64 Key = ShaderCache::HashString(CompiledPath, ConfigHash);
+	const Entry* End = Entries + Head->EntriesCount;
+	const Entry* Item = std::lower_bound(Entries, End, Key, [](const Entry& Other, UInt64 Value) { return Other.Key < Value; });
+	if (Item == End || Item->Key != Key) return false;
+
+	if (!IsRangeValid(Item->SourceOffset, Item->SourceSize) || !IsRangeValid(Item->BinaryOffset, Item->BinarySize) || !IsEntryValid(Item)) return false;
+
+	*Source = NULL;
+	*Binary = NULL;
+	if (!CreateBuffer(View + Item->SourceOffset, Item->SourceSize, Source) || !CreateBuffer(View + Item->BinaryOffset, Item->BinarySize, Binary)) {
+		if (*Source) (*Source)->Release();
+		*Source = NULL;
+		return false;
+	}
+	return true;
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+
+/*
+* Read only archive of precompiled shaders and effects, built offline by packShaders.py and mapped in memory.
+* An entry is found by its compiled path and the hash of its compilation setup (ShaderCache::HashConfig), and is only used while
+* the source and every file it includes still have the content they were compiled from. Otherwise the loose cache and the compiler take over.
+*
+* File layout, offsets from the start of the file:
+* Header, Entry[EntriesCount] sorted by key, File[FilesCount], uint32_t Dependencies[DependenciesCount] (file indexes), then the data.
+* The records use fixed width fields, packShaders.py writes them the same way whatever the platform.
+*/
+class ShaderArchive {
+public:
+	static const UInt32 Version = 1;
+
+	struct Header {
+		char		Magic[4];	// TRSP
+		uint32_t	Version;
+		uint32_t	EntriesCount;
+		uint32_t	FilesCount;
+		uint32_t	DependenciesCount;
+		uint32_t	Reserved;
+	};
+
+	struct Entry {
+		UInt64		Key;		// ShaderCache::HashString(compiled path, config hash)
+		uint32_t	SourceOffset;	// preprocessed source
+		uint32_t	SourceSize;
+		uint32_t	BinaryOffset;
+		uint32_t	BinarySize;
+		uint32_t	FirstDependency;
+		uint32_t	DependenciesCount;
+	};
+
+	struct File {
+		UInt64		Hash;		// ShaderCache::Hash of the content
+		uint32_t	PathOffset;	// null terminated, relative to the game folder
+		uint32_t	PathSize;
+	};
+
+	ShaderArchive(const char* ArchiveFile);
+	~ShaderArchive();
+
+	bool				Find(const char* CompiledPath, UInt64 ConfigHash, ID3DXBuffer** Source, ID3DXBuffer** Binary);
+
+	static ShaderArchive Precompiled;
+
+private:
+	enum FileState : UInt8 {
+		Unchecked,
+		Unchanged,
+		Changed,
+	};
+
+	void				Open();
+	bool				IsRangeValid(UInt32 Offset, UInt32 Size);
+	bool				IsEntryValid(const Entry* Item);
+	static bool			CreateBuffer(const UInt8* Data, UInt32 Size, ID3DXBuffer** Buffer);
+
+	std::string			Path;
+	HANDLE				FileHandle;
+	HANDLE				Mapping;
+	const UInt8*		View;
+	UInt64				ViewSize;
+	const Header*		Head;
+	const Entry*		Entries;
+	const File*			Files;
+	const uint32_t*		Dependencies;
+	std::vector<FileState> States;	// validation of the files, done once per file
+	std::mutex			Lock;
+	bool				Opened;
+};
@@ -0,0 +1,235 @@
+ShaderCache ShaderCache::Shaders(ShadersPath "Cache\\CacheIndex.txt");
+ShaderCache ShaderCache::Effects(EffectsPath "Cache\\CacheIndex.txt");
+
+ShaderCache::ShaderCache(const char* IndexFile) {
+
+	IndexPath = IndexFile;
+	Loaded = false;
+	Dirty = false;
+
+}
+
+
+ShaderCache::~ShaderCache() {
+
+	Flush();
+
+}
+
+
+/*
+* Writes the index if entries changed. The changes are only marked while compiling, the index is written once the compile queue is flushed and at exit.
+*/
+void ShaderCache::Flush() {
+	std::lock_guard<std::mutex> Guard(Lock);
+	if (!Dirty) return;
+
+	Save();
+	Dirty = false;
+}
+
+
+/*
+* FNV-1a hash, used for file contents and compilation setups.
+*/
+UInt64 ShaderCache::Hash(const void* Data, size_t Size, UInt64 Seed) {
+	const UInt8* Bytes = (const UInt8*)Data;
+	UInt64 Result = Seed;
+	for (size_t i = 0; i < Size; i++) {
+		Result ^= Bytes[i];
+		Result *= 1099511628211ull;
+	}
+	return Result;
+}
+
+
+UInt64 ShaderCache::HashString(const char* String, UInt64 Seed) {
+	if (!String) return Hash("", 1, Seed);
+	return Hash(String, strlen(String) + 1, Seed); // hash the terminator too so that consecutive strings can't collide
+}
+
+
+bool ShaderCache::HashFile(const char* Path, UInt64* Result) {
+	std::ifstream File(Path, std::ios::in | std::ios::binary);
+	if (!File.is_open()) return false;
+
+	std::string Content((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+	*Result = Hash(Content.data(), Content.size());
+	return true;
+}
+
+
+/*
+* Hashes everything that changes the compilation result besides the files content.
+*/
+UInt64 ShaderCache::HashConfig(const char* SourcePath, const char* TemplateName, const D3DXMACRO* Macros, const char* Profile) {
+	UInt64 Result = HashString(SourcePath, Hash(nullptr, 0));
+	Result = HashString(TemplateName, Result);
+	Result = HashString(Profile, Result);
+	for (const D3DXMACRO* Macro = Macros; Macro && Macro->Name; Macro++) {
+		Result = HashString(Macro->Name, Result);
+		Result = HashString(Macro->Definition, Result);
+	}
+	return Result;
+}
+
+
+/*
+* Returns the last write time of a file, 0 if it doesn't exist.
+*/
+UInt64 ShaderCache::GetWriteTime(const char* Path) {
+	WIN32_FILE_ATTRIBUTE_DATA Attributes = { 0 };
+	if (!GetFileAttributesExA(Path, GetFileExInfoStandard, &Attributes)) return 0;
+	return ((UInt64)Attributes.ftLastWriteTime.dwHighDateTime << 32) | Attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+
+/*
+* Collects the source file and every file it includes, recursively. Includes are resolved from the including file folder, then from the source folder.
+* Includes inside disabled preprocessor branches are collected as well, which only makes the invalidation more conservative.
+*/
+void ShaderCache::GetIncludes(const char* SourcePath, std::vector<std::string>& Includes) {
+	std::string Root = SourcePath;
+	Root = Root.substr(0, Root.find_last_of("\\/") + 1);
+
+	std::vector<std::string> Pending = { SourcePath };
+	while (!Pending.empty()) {
+		std::string Path = Pending.back();
+		Pending.pop_back();
+		if (std::find_if(Includes.begin(), Includes.end(), [&Path](const std::string& Other) { return !_stricmp(Other.c_str(), Path.c_str()); }) != Includes.end()) continue;
+		Includes.push_back(Path);
+
+		std::ifstream File(Path);
+		if (!File.is_open()) continue;
+
+		std::string Folder = Path.substr(0, Path.find_last_of("\\/") + 1);
+		std::string Line;
+		while (std::getline(File, Line)) {
+			size_t Directive = Line.find("#include");
+			if (Directive == std::string::npos) continue;
+			size_t Start = Line.find('"', Directive);
+			size_t End = Line.find('"', Start + 1);
+			if (Start == std::string::npos || End == std::string::npos) continue;
+
+			std::string Name = Line.substr(Start + 1, End - Start - 1);
+			if (GetWriteTime((Folder + Name).c_str()))
+				Pending.push_back(Folder + Name);
+			else if (GetWriteTime((Root + Name).c_str()))
+				Pending.push_back(Root + Name);
+		}
+	}
+}
+
+
+/*
+* Checks that the setup of the entry is unchanged and that none of its files changed since it was compiled.
+* Files are only hashed again when their write time changed.
+*/
+bool ShaderCache::IsEntryValid(const char* Key, UInt64 ConfigHash) {
+	std::lock_guard<std::mutex> Guard(Lock);
+	if (!Loaded) Load();
+
+	auto Item = Entries.find(Key);
+	if (Item == Entries.end() || Item->second.ConfigHash != ConfigHash) return false;
+
+	bool Touched = false;
+	for (Dependency& File : Item->second.Dependencies) {
+		UInt64 WriteTime = GetWriteTime(File.Path.c_str());
+		if (WriteTime == File.WriteTime) continue;
+
+		UInt64 FileHash = 0;
+		if (!WriteTime || !HashFile(File.Path.c_str(), &FileHash) || FileHash != File.Hash) {
+			Entries.erase(Item);
+			Dirty = true;
+			return false;
+		}
+		File.WriteTime = WriteTime; // content is the same, only remember the new time
+		Touched = true;
+	}
+
+	if (Touched) Dirty = true;
+	return true;
+}
+
+
+/*
+* Records the current state of the files used to compile the entry.
+*/
+void ShaderCache::UpdateEntry(const char* Key, const char* SourcePath, UInt64 ConfigHash) {
+	std::vector<std::string> Files;
+	GetIncludes(SourcePath, Files);
+
+	Entry Item;
+	Item.ConfigHash = ConfigHash;
+	for (std::string& Path : Files) {
+		Dependency File = { Path, GetWriteTime(Path.c_str()), 0 };
+		if (!HashFile(Path.c_str(), &File.Hash)) continue;
+		Item.Dependencies.push_back(File);
+	}
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	if (!Loaded) Load();
+	Entries[Key] = Item;
+	Dirty = true;
+}
+
+
+void ShaderCache::InvalidateEntry(const char* Key) {
+	std::lock_guard<std::mutex> Guard(Lock);
+	if (!Loaded) Load();
+	if (Entries.erase(Key)) Dirty = true;
+}
+
+
+/*
+* Index format, one line per record:
+* E <config hash> <key>
+* D <write time> <content hash> <path>		(dependencies of the previous entry)
+*/
+void ShaderCache::Load() {
+	Loaded = true;
+
+	std::ifstream File(IndexPath);
+	if (!File.is_open()) return;
+
+	std::string Line;
+	Entry* Current = nullptr;
+	while (std::getline(File, Line)) {
+		if (!Line.empty() && Line.back() == '\r') Line.pop_back();
+		if (Line.size() < 2) continue;
+
+		std::istringstream Stream(Line.substr(2));
+		if (Line[0] == 'E') {
+			Entry Item = {};
+			std::string Key;
+			Stream >> std::hex >> Item.ConfigHash;
+			Stream.get();
+			std::getline(Stream, Key);
+			Current = &(Entries[Key] = Item);
+		}
+		else if (Line[0] == 'D' && Current) {
+			Dependency Item;
+			Stream >> std::hex >> Item.WriteTime >> Item.Hash;
+			Stream.get();
+			std::getline(Stream, Item.Path);
+			Current->Dependencies.push_back(Item);
+		}
+	}
+}
+
+
+void ShaderCache::Save() {
+	std::ofstream File(IndexPath, std::ios::out | std::ios::trunc);
+	if (!File.is_open()) {
+		Logger::Log("[ERROR] Couldn't write shader cache index %s", IndexPath.c_str());
+		return;
+	}
+
+	File << std::hex;
+	for (auto& [Key, Item] : Entries) {
+		File << "E " << Item.ConfigHash << " " << Key << "\n";
+		for (Dependency& Dep : Item.Dependencies) {
+			File << "D " << Dep.WriteTime << " " << Dep.Hash << " " << Dep.Path << "\n";
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mutex>
+
+/*
+* Persistent index of the compiled shaders/effects cache.
+* An entry is keyed by the compiled file path and stores a hash of the compilation setup (source, template, defines, profile)
+* plus the write time and content hash of the source and of every file it includes.
+* When an entry is still valid the cached preprocessed source and binary can be used without running the preprocessor.
+*/
+class ShaderCache {
+public:
+	struct Dependency {
+		std::string		Path;
+		UInt64			WriteTime;
+		UInt64			Hash;
+	};
+
+	struct Entry {
+		UInt64					ConfigHash;
+		std::vector<Dependency>	Dependencies;
+	};
+
+	ShaderCache(const char* IndexFile);
+	~ShaderCache();
+
+	bool				IsEntryValid(const char* Key, UInt64 ConfigHash);
+	void				UpdateEntry(const char* Key, const char* SourcePath, UInt64 ConfigHash);
+	void				InvalidateEntry(const char* Key);
+	void				Flush();
+
+	static UInt64		Hash(const void* Data, size_t Size, UInt64 Seed = 14695981039346656037ull);
+	static UInt64		HashString(const char* String, UInt64 Seed);
+	static bool			HashFile(const char* Path, UInt64* Result);
+	static UInt64		HashConfig(const char* SourcePath, const char* TemplateName, const D3DXMACRO* Macros, const char* Profile);
+	static UInt64		GetWriteTime(const char* Path);
+	static void			GetIncludes(const char* SourcePath, std::vector<std::string>& Includes);
+
+	static ShaderCache	Shaders;
+	static ShaderCache	Effects;
+
+private:
+	void				Load();
+	void				Save();
+
+	std::string								IndexPath;
+	std::unordered_map<std::string, Entry>	Entries;
+	std::mutex								Lock;
+	bool									Loaded;
+	bool									Dirty;		// entries changed since the index was written
+};
@@ -25,13 +25,3 @@ void ShaderCollection::DisposeShaders() {
 		vertexShader->DisposeShader();
 	}
 }
-
-ShaderTemplate ShaderCollection::GetTemplate(const char* Name) {
-	std::map<std::string_view, ShaderTemplate> templates = Templates();
-	if (auto temp = templates.find(Name); temp != templates.end()) {
-		return temp->second;
-	}
-	else {
-		return ShaderTemplate{};
-	}
-}
\ No newline at end of file
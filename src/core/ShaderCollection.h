@@ -17,6 +17,7 @@ public:
 
 	virtual void			UpdateConstants() {};
 	virtual void			UpdateSettings() {};
+	virtual const char*		GetSettingsContext() { return NULL; }; // reimplement in subclasses whose settings depend on the game state
 	virtual void			RegisterConstants() {};
 	virtual void			RegisterTextures() {};
 
@@ -29,8 +30,8 @@ public:
 	std::vector<NiD3DPixelShaderEx*>	PixelShaderList;
 	std::vector<NiD3DVertexShaderEx*>	VertexShaderList;
 
+	// only read once to build the ShaderManager registry, use ShaderManager::FindGameShader to get a template
 	virtual std::map<std::string_view, ShaderTemplate> Templates() {
 		return std::map<std::string_view, ShaderTemplate>();
 	};
-	ShaderTemplate GetTemplate(const char*);
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+UInt32 ShaderConstantCache::BatchGeneration = 0;
+bool ShaderConstantCache::BatchActive = false;
+ShaderConstantCache* ShaderConstantCache::Owner[2] = { nullptr, nullptr };
+
+ShaderConstantCache::ShaderConstantCache() {
+
+	Stage = 0;
+	Shadow = nullptr;
+	Dirty = nullptr;
+	Start = 0;
+	Count = 0;
+	Generation = 0;
+
+}
+
+ShaderConstantCache::~ShaderConstantCache() {
+
+	if (Owner[Stage] == this) Owner[Stage] = nullptr;
+	delete[] Shadow;
+	delete[] Dirty;
+
+}
+
+void ShaderConstantCache::Initialize(UInt32 RegisterStart, UInt32 RegisterCount) {
+
+	delete[] Shadow;
+	delete[] Dirty;
+
+	Start = RegisterStart;
+	Count = RegisterCount;
+	Shadow = new D3DXVECTOR4[Count];
+	std::fill(Shadow, Shadow + Count, D3DXVECTOR4(0.0f, 0.0f, 0.0f, 0.0f));
+	Dirty = new bool[Count]();
+	Generation = 0;
+
+}
+
+/*
+* Copies the values of a constant, marking its registers dirty if they differ from the last upload or if the copy can't be trusted.
+*/
+void ShaderConstantCache::Set(UInt32 RegisterIndex, const D3DXVECTOR4* Values, UInt32 RegisterCount) {
+
+	UInt32 Offset = RegisterIndex - Start;
+	size_t Size = RegisterCount * sizeof(D3DXVECTOR4);
+	if (!IsValid() || memcmp(&Shadow[Offset], Values, Size)) {
+		memcpy(&Shadow[Offset], Values, Size);
+		memset(&Dirty[Offset], true, RegisterCount * sizeof(bool));
+	}
+
+}
+
+/*
+* Opens a scope in which the constant registers are only touched by the shader records (e.g. our own render passes).
+* Inside it, a record only uploads the registers whose value changed since its previous upload.
+*/
+void ShaderConstantCache::BeginBatch() {
+
+	BatchGeneration++;
+	BatchActive = true;
+	Owner[0] = Owner[1] = nullptr;
+
+}
+
+/*
+* Closes the constant batch. The game can write any register afterwards, so every copy is invalidated.
+*/
+void ShaderConstantCache::EndBatch() {
+
+	BatchGeneration++;
+	BatchActive = false;
+	Owner[0] = Owner[1] = nullptr;
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+* Copy of the last values a shader record uploaded to its span of float registers, so that only the changed registers are sent again.
+* The game writes the registers behind our back, so the copy is only trusted inside a constant batch and while this cache is the
+* last one that uploaded to its stage. Dirty registers are uploaded in runs of adjacent registers, one call per run.
+*/
+class ShaderConstantCache {
+public:
+	ShaderConstantCache();
+	~ShaderConstantCache();
+
+	void				Initialize(UInt32 RegisterStart, UInt32 RegisterCount);
+	void				Set(UInt32 RegisterIndex, const D3DXVECTOR4* Values, UInt32 RegisterCount);
+	template <typename F> void Upload(F SetShaderConstantF);
+	bool				IsValid() { return BatchActive && Generation == BatchGeneration && Owner[Stage] == this; }
+
+	static void			BeginBatch();
+	static void			EndBatch();
+
+	UInt32				Stage;			// 0 vertex, 1 pixel
+	D3DXVECTOR4*		Shadow;
+	bool*				Dirty;
+	UInt32				Start;			// first register of the span
+	UInt32				Count;
+	UInt32				Generation;		// batch generation of the last upload
+
+	static UInt32		BatchGeneration;
+	static bool			BatchActive;
+	static ShaderConstantCache* Owner[2];	// last cache that uploaded to each stage
+};
+
+
+/*
+* Sends the dirty registers through SetShaderConstantF(RegisterIndex, Values, RegisterCount) and makes this cache the owner of its stage.
+*/
+template <typename F> void ShaderConstantCache::Upload(F SetShaderConstantF) {
+
+	UInt32 Register = 0;
+	while (Register < Count) {
+		if (!Dirty[Register]) {
+			Register++;
+			continue;
+		}
+
+		UInt32 RunStart = Register;
+		while (Register < Count && Dirty[Register]) Dirty[Register++] = false;
+		SetShaderConstantF(Start + RunStart, &Shadow[RunStart], Register - RunStart);
+	}
+	Generation = BatchGeneration;
+	Owner[Stage] = this;
+
+}
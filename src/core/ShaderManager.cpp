@@ -81,6 +81,17 @@ void ShaderManager::Initialize() {
 	TheShaderManager->RegisterShaderCollection<SkinShaders>(&TheShaderManager->Shaders.Skin);
 	TheShaderManager->RegisterShaderCollection<GrassShaders>(&TheShaderManager->Shaders.Grass);
 	TheShaderManager->RegisterShaderCollection<TerrainShaders>(&TheShaderManager->Shaders.Terrain);
+	TheShaderManager->RegisterGameShaders();
+
+	// sky settings are used in several shaders whether the shader is active or not
+	TheSettingManager->Subscribe("SunGlare", []() { TheShaderManager->ShaderConst.SunAmount.w = TheSettingManager->GetSettingF("Shaders.Sky.Main", "GlareStrength"); });
+
+	// compile the effects and the game shaders templates on worker threads, the effects are created on this thread once compiled
+	CompileQueue Queue;
+	TheShaderManager->QueueEffects(&Queue);
+	TheShaderManager->QueueShaderTemplates(&Queue);
+	Queue.Flush();
+	ShaderRecord::ClearCompiledPrograms();
 	
 	//setup map of constant names
 	TheShaderManager->RegisterConstant("TESR_WorldTransform", (D3DXVECTOR4*)&TheRenderManager->worldMatrix);
@@ -121,10 +132,88 @@ void ShaderManager::Initialize() {
 	TheShaderManager->RegisterConstant("TESR_HorizonColor", &TheShaderManager->ShaderConst.horizonColor);
 
 	TheShaderManager->InitializeConstants();
+	TheShaderManager->InitializeRenderGraph();
 
 	timer.LogTime("ShaderManager::Initialize");
 }
 
+/*
+* Binds the post process passes declared by RenderGraph::DeclareEffectsChain to the effects and the game state.
+*/
+void ShaderManager::InitializeRenderGraph() {
+	typedef RenderGraph RG;
+
+	// effects applied on the chain render target, sampling the rendered/source buffers
+	auto Chained = [](EffectRecord* Effect, bool Clear) {
+		return [Effect, Clear](IDirect3DSurface9* RenderTarget) {
+			Effect->Render(TheRenderManager->device, RenderTarget, TheTextureManager->RenderedSurface, 0, Clear, TheTextureManager->SourceSurface);
+		};
+	};
+	// effects rendering into their own buffer
+	auto ToTarget = [this](EffectRecord* Effect, IDirect3DSurface9** Target, bool Clear) {
+		return [this, Effect, Target, Clear](IDirect3DSurface9* RenderTarget) {
+			TheTextureManager->RestoreTargets(Effect); // before reading the target, it is NULL while released
+			RenderEffectToRT(*Target, Effect, Clear);
+			TheRenderManager->device->SetRenderTarget(0, RenderTarget);
+		};
+	};
+	auto ShadowsEnabled = [this]() { return (GameState.isExterior && Effects.ShadowsExteriors->Enabled) || (!GameState.isExterior && Effects.ShadowsInteriors->Enabled); };
+	IDirect3DSurface9** ShadowPass = &Effects.ShadowsExteriors->Textures.ShadowPassSurface;
+
+	std::map<std::string_view, RG::PassBinding> Bindings = {
+		{ "CombineDepth", { Effects.CombineDepth, ToTarget(Effects.CombineDepth, &Effects.CombineDepth->Textures.CombinedDepthSurface, false) } },
+		{ "Normals", { Effects.Normals, ToTarget(Effects.Normals, &Effects.Normals->Textures.NormalsSurface, false) } },
+		{ "PointShadows", { Effects.PointShadows, ToTarget(Effects.PointShadows, ShadowPass, true), ShadowsEnabled } },
+		{ "PointShadows2", { Effects.PointShadows2, ToTarget(Effects.PointShadows2, ShadowPass, false), [this, ShadowsEnabled]() { return ShadowsEnabled() && Effects.ShadowsExteriors->Settings.Interiors.LightPoints > 6; } } },
+		{ "SunShadows", { Effects.SunShadows, ToTarget(Effects.SunShadows, ShadowPass, false), [this, ShadowsEnabled]() { return ShadowsEnabled() && GameState.isExterior; } } },
+		{ "ShadowsExteriors", { Effects.ShadowsExteriors, Chained(Effects.ShadowsExteriors, false), [this]() { return GameState.isExterior; } } },
+		{ "ShadowsInteriors", { Effects.ShadowsInteriors, Chained(Effects.ShadowsInteriors, true), [this]() { return !GameState.isExterior; } } },
+		{ "SnowAccumulation", { Effects.SnowAccumulation, Chained(Effects.SnowAccumulation, false) } },
+		{ "AmbientOcclusion", { Effects.AmbientOcclusion, Chained(Effects.AmbientOcclusion, false) } },
+		{ "WetWorld", { Effects.WetWorld, Chained(Effects.WetWorld, false) } },
+		{ "Flashlight", { Effects.Flashlight, [this](IDirect3DSurface9* RenderTarget) {
+			Effects.Flashlight->Render(TheRenderManager->device, RenderTarget, TheTextureManager->RenderedSurface, Effects.Flashlight->selectedPass, true, TheTextureManager->SourceSurface);
+		} } },
+		{ "Specular", { Effects.Specular, Chained(Effects.Specular, false) } },
+		{ "Underwater", { Effects.Underwater, Chained(Effects.Underwater, false) } },
+		{ "VolumetricFog", { Effects.VolumetricFog, Chained(Effects.VolumetricFog, false) } },
+		{ "GodRays", { Effects.GodRays, Chained(Effects.GodRays, true) } },
+		{ "AvgLuma", { Effects.AvgLuma, [this](IDirect3DSurface9* RenderTarget) {
+			TheTextureManager->ResolveRenderedBuffer(RenderTarget);
+			RenderEffectToRT(Effects.AvgLuma->Textures.AvgLumaSurface, Effects.AvgLuma, false);
+			TheRenderManager->device->SetRenderTarget(0, RenderTarget); // restore device used for effects
+		} } },
+		{ "Exposure", { Effects.Exposure, Chained(Effects.Exposure, false) } },
+		{ "Bloom", { Effects.Bloom, [this](IDirect3DSurface9* RenderTarget) { Effects.Bloom->RenderBloomBuffer(RenderTarget); } } },
+		{ "Lens", { Effects.Lens, Chained(Effects.Lens, false) } },
+		{ "Tonemapping", { nullptr, nullptr, [this]() { return Shaders.Tonemapping->Enabled; } } },
+		{ "Rain", { Effects.Rain, Chained(Effects.Rain, false) } },
+		{ "Snow", { Effects.Snow, Chained(Effects.Snow, false) } },
+		{ "BloomLegacy", { Effects.BloomLegacy, Chained(Effects.BloomLegacy, false) } },
+		{ "Coloring", { Effects.Coloring, Chained(Effects.Coloring, false) } },
+		{ "DepthOfField", { Effects.DepthOfField, Chained(Effects.DepthOfField, false) } },
+		{ "MotionBlur", { Effects.MotionBlur, Chained(Effects.MotionBlur, false) } },
+		{ "BloodLens", { Effects.BloodLens, Chained(Effects.BloodLens, false) } },
+		{ "WaterLens", { Effects.WaterLens, Chained(Effects.WaterLens, false) } },
+		{ "LowHF", { Effects.LowHF, Chained(Effects.LowHF, false) } },
+		{ "SMAA", { Effects.SMAA, Chained(Effects.SMAA, false) } },
+		{ "Sharpening", { Effects.Sharpening, Chained(Effects.Sharpening, false) } },
+		{ "Cinema", { Effects.Cinema, Chained(Effects.Cinema, false) } },
+		{ "ImageAdjust", { Effects.ImageAdjust, Chained(Effects.ImageAdjust, false) } },
+		{ "Debug", { Effects.Debug, Chained(Effects.Debug, false) } },
+	};
+
+	EffectsGraph.DeclareEffectsChain(TheRenderManager->width, TheRenderManager->height, Effects.Bloom->Settings.Resolution[0].x, Effects.Bloom->Settings.Resolution[0].y, [&Bindings](const char* Name) {
+		auto Binding = Bindings.find(Name);
+		if (Binding == Bindings.end()) {
+			Logger::Log("ERROR: RenderGraph pass %s has no binding", Name);
+			return RG::PassBinding{ nullptr, nullptr, []() { return false; } };
+		}
+		return Binding->second;
+	});
+}
+
+
 void ShaderManager::CreateFrameVertex(UInt32 Width, UInt32 Height, IDirect3DVertexBuffer9** FrameVertex) {
 	
 	void* VertexData = NULL;
@@ -154,10 +243,12 @@ template <typename T> void ShaderManager::RegisterEffect(T** Pointer)
 	*Pointer = effect;
 
 	EffectsNames[effect->Name] = (EffectRecord**)Pointer;
-	effect->UpdateSettings();
+	TheSettingManager->Subscribe(effect->Name, [effect]() { effect->UpdateSettings(); }, [effect]() { return effect->GetSettingsContext(); });
+	TheSettingManager->UpdateSubscribers();
 	effect->RegisterConstants();
+	TheTextureManager->TargetsOwner = effect;
 	effect->RegisterTextures();
-	effect->LoadEffect();
+	TheTextureManager->TargetsOwner = NULL;
 }
 
 
@@ -167,6 +258,7 @@ template <typename T> void ShaderManager::RegisterShaderCollection(T** Pointer)
 	*Pointer = collection;
 	
 	ShaderNames[collection->Name] = (ShaderCollection**)Pointer;
+	TheSettingManager->Subscribe(collection->Name, [collection]() { collection->UpdateSettings(); }, [collection]() { return collection->GetSettingsContext(); });
 	collection->RegisterConstants();
 }
 
@@ -209,11 +301,8 @@ void ShaderManager::UpdateConstants() {
 	float weatherPercent = WorldSky->weatherPercent;
 	float lastGameTime = ShaderConst.GameTime.y;
 	const char* sectionName = NULL;
-	avglumaRequired = false; // toggle for rendering AvgLuma
 	orthoRequired = false; // toggle for rendering Ortho map
 
-	if (Effects.Debug->Enabled) avglumaRequired = true;
-
 	// context variables
 	GameState.PipBoyIsOn = InterfaceManager->getIsMenuOpen();
 	GameState.VATSIsOn = InterfaceManager->IsActive(Menu::kMenuType_VATS);
@@ -232,7 +321,10 @@ void ShaderManager::UpdateConstants() {
 	GameState.isExterior = !currentCell->IsInterior();// || Player->parentCell->flags0 & TESObjectCELL::kFlags0_BehaveLikeExterior; // < use exterior flag, broken for now
 	GameState.isCellChanged = currentCell != PreviousCell;
 	PreviousCell = currentCell;
-	if (GameState.isCellChanged) TheSettingManager->SettingsChanged = true; // force update constants during cell transition
+	if (GameState.isCellChanged) {
+		TheSettingManager->SettingsChanged = true; // force update constants during cell transition
+		TheSettingManager->RefreshSubscribersContext(); // settings are only read again where the cell changes their values
+	}
 
 	GameState.isUnderwater = Tes->sky->GetIsUnderWater();
 	GameState.isRainy = currentWeather?currentWeather->GetWeatherType() == TESWeather::WeatherType::kType_Rainy : false;
@@ -364,21 +456,8 @@ void ShaderManager::UpdateConstants() {
 
 	timer.LogTime("ShaderManager::UpdateConstants for generic constants");
 
-	if (TheSettingManager->SettingsChanged) {
-		TheGameMenuManager->UpdateSettings();
-
-		// update settings
-		for (const auto [Name, effect] : EffectsNames) {
-			(*effect)->UpdateSettings();
-		}
-		for (const auto [Name, shader] : ShaderNames) {
-			(*shader)->UpdateSettings();
-		}
-
-		// sky settings are used in several shaders whether the shader is active or not
-		ShaderConst.SunAmount.w = TheSettingManager->GetSettingF("Shaders.Sky.Main", "GlareStrength");
-		timer.LogTime("ShaderManager::UpdateSettings for shaders & effects");
-	}
+	// update the settings of the effects and shaders reading a changed section
+	if (TheSettingManager->UpdateSubscribers()) timer.LogTime("ShaderManager::UpdateSettings for shaders & effects");
 
 	// update Constants
 	for (const auto [Name, shader] : ShaderNames) {
@@ -415,18 +494,43 @@ float ShaderManager::GetTransitionValue(float Day, float Night, float Interior)
 }
 
 
+/*
+* Builds the registry of the game shaders named by the collection templates and the blood shaders, once after the collections are registered.
+* A shader matched by prefix belongs to that collection whatever the templates of the other collections.
+*/
+void ShaderManager::RegisterGameShaders() {
+
+	auto GetByPrefix = [this](const char* Name) { return GetShaderCollectionByPrefix(Name); };
+
+	GameShaders.RegisterNames(BloodShaders, Shaders.Blood, GetByPrefix);
+	for (const auto& [Name, collection] : ShaderNames) {
+		GameShaders.RegisterTemplates(*collection, GetByPrefix);
+	}
+	Logger::Log("Game shaders registered: %u", (UInt32)GameShaders.Shaders.size());
+
+}
+
+const ShaderRegistration* ShaderManager::FindGameShader(const char* Name) {
+
+	return GameShaders.Find(Name);
+
+}
+
 ShaderCollection* ShaderManager::GetShaderCollection(const char* Name) {
 
+	if (const ShaderRegistration* Registration = FindGameShader(Name)) return Registration->Collection;
+	return GetShaderCollectionByPrefix(Name);
+
+}
+
+ShaderCollection* ShaderManager::GetShaderCollectionByPrefix(const char* Name) {
+
 	if (!memcmp(Name, "WATER", 5)) return Shaders.Water;
 	if (!memcmp(Name, "GRASS", 5)) return Shaders.Grass;
 	if (!memcmp(Name, "ISHDR", 5) || !memcmp(Name, "HDR", 3)) return Shaders.Tonemapping; // tonemapping shaders have different names between New vegas and Oblivion
 	if (!memcmp(Name, "PAR", 3)) return Shaders.POM;
 	//if (!memcmp(Name, "SKIN", 4)) return Shaders.Skin; // temporarily disabled, the shaders are half broken
 	if (!memcmp(Name, "SKY", 3)) return Shaders.Sky;
-	if (strstr(BloodShaders, Name)) return Shaders.Blood;
-
-	if (Shaders.PBR->GetTemplate(Name).Name != NULL) return Shaders.PBR;
-	if (Shaders.Terrain->GetTemplate(Name).Name != NULL) return Shaders.Terrain;
 
 	return NULL;
 }
@@ -437,7 +541,38 @@ ShaderCollection* ShaderManager::GetShaderCollection(const char* Name) {
 void ShaderManager::ReloadEffects() {
 	for (const auto [Name, effect] : EffectsNames) {
 		(*effect)->DisposeEffect();
-		(*effect)->LoadEffect();
+	}
+
+	CompileQueue Queue;
+	QueueEffects(&Queue);
+	Queue.Flush();
+}
+
+/*
+* Adds a job per effect: compiled on a worker, created when the queue is flushed.
+*/
+void ShaderManager::QueueEffects(CompileQueue* Queue) {
+	for (const auto [Name, effect] : EffectsNames) {
+		EffectRecord* Effect = *effect;
+		Queue->Enqueue(Effect->Name, [Effect]() { return Effect->CompileEffect(); }, [Effect](bool Compiled) { Effect->CreateEffect(Compiled); });
+	}
+}
+
+/*
+* Compiles the templated game shaders ahead of time, so that they are only read from the cache when the game creates them.
+* Only the templates the game shaders will actually resolve to are compiled, for the generic, exteriors and interiors folders.
+*/
+void ShaderManager::QueueShaderTemplates(CompileQueue* Queue) {
+	static const char* SubPaths[] = { NULL, "Exteriors\\", "Interiors\\" };
+
+	for (const auto& [ShaderName, Registration] : GameShaders.Shaders) {
+		if (Registration.Template.Name == NULL) continue;
+		const char* Shader = ShaderName.data(); // the template keys are string literals
+
+		for (const char* SubPath : SubPaths) {
+			ShaderTemplate Defines = Registration.Template;
+			Queue->Enqueue(Shader, [Shader, SubPath, Defines]() { return ShaderRecord::CompileShader(Shader, SubPath, Defines, NULL, NULL); });
+		}
 	}
 }
 
@@ -448,7 +583,8 @@ void ShaderManager::ReloadEffects() {
 bool ShaderManager::LoadShader(NiD3DVertexShader* Shader) {
 	
 	NiD3DVertexShaderEx* VertexShader = (NiD3DVertexShaderEx*)Shader;
-	ShaderCollection* Collection = GetShaderCollection(VertexShader->Name);
+	const ShaderRegistration* Registration = FindGameShader(VertexShader->Name);
+	ShaderCollection* Collection = Registration ? Registration->Collection : GetShaderCollectionByPrefix(VertexShader->Name);
 
 	if (!Collection) {
 		VertexShader->ShaderProg[ShaderRecordType::Default] = NULL;
@@ -460,7 +596,7 @@ bool ShaderManager::LoadShader(NiD3DVertexShader* Shader) {
 	
 	bool enabled = Collection->Enabled;
 
-	ShaderTemplate Template = Collection->GetTemplate(VertexShader->Name);
+	ShaderTemplate Template = Registration ? Registration->Template : ShaderTemplate{};
 
 	// Load generic, interior and exterior shaders
 	VertexShader->ShaderProg[ShaderRecordType::Default]  = (ShaderRecordVertex*)ShaderRecord::LoadShader(VertexShader->Name, NULL, Template);
@@ -484,7 +620,8 @@ bool ShaderManager::LoadShader(NiD3DVertexShader* Shader) {
 bool ShaderManager::LoadShader(NiD3DPixelShader* Shader) {
 
 	NiD3DPixelShaderEx* PixelShader = (NiD3DPixelShaderEx*)Shader;
-	ShaderCollection* Collection = GetShaderCollection(PixelShader->Name);
+	const ShaderRegistration* Registration = FindGameShader(PixelShader->Name);
+	ShaderCollection* Collection = Registration ? Registration->Collection : GetShaderCollectionByPrefix(PixelShader->Name);
 
 	if (!Collection) {
 		PixelShader->ShaderProg[ShaderRecordType::Default] = NULL;
@@ -496,7 +633,7 @@ bool ShaderManager::LoadShader(NiD3DPixelShader* Shader) {
 
 	bool enabled = Collection->Enabled;
 
-	ShaderTemplate Template = Collection->GetTemplate(PixelShader->Name);
+	ShaderTemplate Template = Registration ? Registration->Template : ShaderTemplate{};
 
 	PixelShader->ShaderProg[ShaderRecordType::Default]  = (ShaderRecordPixel*)ShaderRecord::LoadShader(PixelShader->Name, NULL, Template);
 	PixelShader->ShaderProg[ShaderRecordType::Exterior] = (ShaderRecordPixel*)ShaderRecord::LoadShader(PixelShader->Name, "Exteriors\\", Template);
@@ -679,7 +816,7 @@ bool ShaderManager::ShouldRenderShadowMaps() {
 void ShaderManager::RenderEffectToRT(IDirect3DSurface9* RenderTarget, EffectRecord* Effect, bool clearRenderTarget) {
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	Device->SetRenderTarget(0, RenderTarget);
-	Effect->Render(Device, RenderTarget, RenderTarget, 0, clearRenderTarget, RenderTarget);
+	Effect->Render(Device, RenderTarget, NULL, 0, clearRenderTarget, NULL);
 };
 
 
@@ -691,55 +828,18 @@ void ShaderManager::RenderEffectsPreTonemapping(IDirect3DSurface9* RenderTarget)
 	auto timer = TimeLogger();
 
 	IDirect3DDevice9* Device = TheRenderManager->device;
-	IDirect3DSurface9* SourceSurface = TheTextureManager->SourceSurface;
-	IDirect3DSurface9* RenderedSurface = TheTextureManager->RenderedSurface;
 
 	// prepare device for effects
 	Device->SetStreamSource(0, FrameVertex, 0, sizeof(FrameVS));
 	Device->SetFVF(FrameFVF);
-
-	// render post process normals for use by shaders
-	RenderEffectToRT(Effects.CombineDepth->Textures.CombinedDepthSurface, Effects.CombineDepth, false);
-	RenderEffectToRT(Effects.Normals->Textures.NormalsSurface, Effects.Normals, false);
-
-	// render a shadow pass for point lights
-	if ((GameState.isExterior && Effects.ShadowsExteriors->Enabled) || (!GameState.isExterior && Effects.ShadowsInteriors->Enabled)) {
-		// separate lights in 2 batches
-		RenderEffectToRT(Effects.ShadowsExteriors->Textures.ShadowPassSurface, Effects.PointShadows, true);
-		if (Effects.ShadowsExteriors->Settings.Interiors.LightPoints > 6) RenderEffectToRT(Effects.ShadowsExteriors->Textures.ShadowPassSurface, Effects.PointShadows2, false);
-		if (GameState.isExterior) RenderEffectToRT(Effects.ShadowsExteriors->Textures.ShadowPassSurface, Effects.SunShadows, false);
-	}
-
 	Device->SetRenderTarget(0, RenderTarget);
 
-	// copy the source render target to both the rendered and source textures (rendered gets updated after every pass, source once per effect)
-	Device->StretchRect(RenderTarget, NULL, RenderedSurface, NULL, D3DTEXF_NONE);
-	Device->StretchRect(RenderTarget, NULL, SourceSurface, NULL, D3DTEXF_NONE);
-
-	if (GameState.isExterior) 
-		Effects.ShadowsExteriors->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	else 
-		Effects.ShadowsInteriors->Render(Device, RenderTarget, RenderedSurface, 0, true, SourceSurface);
-
-	Effects.SnowAccumulation->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.AmbientOcclusion->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.WetWorld->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.Flashlight->Render(Device, RenderTarget, RenderedSurface, Effects.Flashlight->selectedPass, true, SourceSurface);
-	Effects.Specular->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.Underwater->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.VolumetricFog->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.GodRays->Render(Device, RenderTarget, RenderedSurface, 0, true, SourceSurface);
-
-	// calculate average luma for use by shaders
-	if (avglumaRequired) {
-		RenderEffectToRT(Effects.AvgLuma->Textures.AvgLumaSurface, Effects.AvgLuma, NULL);
-		Device->SetRenderTarget(0, RenderTarget); 	// restore device used for effects
-	}
-
-	Effects.Exposure->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.Bloom->RenderBloomBuffer(RenderTarget);
+	// the source and rendered buffers get a copy of the render target only when an effect samples them
+	TheTextureManager->InvalidateRenderedBuffer();
 
-	Effects.Lens->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
+	// resolve the passes for the frame, then render those happening before tonemapping
+	EffectsGraph.Compile();
+	EffectsGraph.Execute(RenderGraph::PreTonemapping, RenderTarget);
 
 	timer.LogTime("ShaderManager::RenderEffectsPreTonemapping");
 }
@@ -760,8 +860,6 @@ void ShaderManager::RenderEffects(IDirect3DSurface9* RenderTarget) {
 
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	NiDX9RenderState* RenderState = TheRenderManager->renderState;
-	IDirect3DSurface9* SourceSurface = TheTextureManager->SourceSurface;
-	IDirect3DSurface9* RenderedSurface = TheTextureManager->RenderedSurface;
 
 	Device->SetStreamSource(0, FrameVertex, 0, sizeof(FrameVS));
 	Device->SetFVF(FrameFVF);
@@ -769,38 +867,10 @@ void ShaderManager::RenderEffects(IDirect3DSurface9* RenderTarget) {
 	// prepare device for effects
 	Device->SetRenderTarget(0, RenderTarget);
 
-	// copy the source render target to both the rendered and source textures (rendered gets updated after every pass, source once per effect)
-	Device->StretchRect(RenderTarget, NULL, RenderedSurface, NULL, D3DTEXF_NONE);
-	Device->StretchRect(RenderTarget, NULL, SourceSurface, NULL, D3DTEXF_NONE);
-
-	Effects.Rain->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.Snow->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	//Effects.Linearization->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.BloomLegacy->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	// screenspace coloring/blurring effects get rendered last
-	Effects.Coloring->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.DepthOfField->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.MotionBlur->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	// lens effects
-	Effects.BloodLens->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.WaterLens->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-	Effects.LowHF->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	Effects.SMAA->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	Effects.Sharpening->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	// cinema effect gets rendered very last because of vignetting/letterboxing
-	Effects.Cinema->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
-
-	// final adjustments
-	Effects.ImageAdjust->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
+	// the source and rendered buffers get a copy of the render target only when an effect samples them
+	TheTextureManager->InvalidateRenderedBuffer();
 
-	// debug shader allows to display some of the buffers
-	Effects.Debug->Render(Device, RenderTarget, RenderedSurface, 0, false, SourceSurface);
+	EffectsGraph.Execute(RenderGraph::PostTonemapping, RenderTarget);
 
 	timer.LogTime("ShaderManager::RenderEffects");
 }
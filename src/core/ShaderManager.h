@@ -4,7 +4,11 @@
 #include "../Effects/Animator.h"
 #include "ShaderRecord.h"
 #include "EffectRecord.h"
+#include "RenderGraph.h"
+#include "CompileQueue.h"
+#include "GpuProfiler.h"
 #include "ShaderCollection.h"
+#include "ShaderRegistry.h"
 #include "../Effects/Effects.h"
 
 struct ShaderConstants {
@@ -62,12 +66,18 @@ public:
 	void					RegisterConstant(const char* Name, D3DXVECTOR4* FloatValue);
 	void					CreateFrameVertex(UInt32 Width, UInt32 Height, IDirect3DVertexBuffer9** FrameVertex);
 	void					InitializeConstants();
+	void					InitializeRenderGraph();
 	void					UpdateConstants();
 	void					GetNearbyLights(ShadowSceneLight* ShadowLightsList[], NiPointLight* LightsList[], NiSpotLight* SpotLightList[]);
 	bool					LoadShader(NiD3DVertexShader* VertexShader);
 	bool					LoadShader(NiD3DPixelShader* PixelShader);
 	void					ReloadEffects();
+	void					QueueEffects(CompileQueue* Queue);
+	void					QueueShaderTemplates(CompileQueue* Queue);
+	void					RegisterGameShaders();
+	const ShaderRegistration* FindGameShader(const char* Name);
 	ShaderCollection*		GetShaderCollection(const char* Name);
+	ShaderCollection*		GetShaderCollectionByPrefix(const char* Name);
 	float					GetTransitionValue(float Day, float Night, float Interior);
 	bool					ShouldRenderShadowMaps();
 	void					RenderEffects(IDirect3DSurface9* RenderTarget);
@@ -145,8 +155,11 @@ public:
 	ShadersStruct			Shaders;
 	EffectsList				EffectsNames;
 	ShaderList				ShaderNames;
+	ShaderRegistry			GameShaders;
 	GameStateStruct			GameState;
 	ShaderConstants			ShaderConst;
+	RenderGraph				EffectsGraph;
+	GpuProfiler				Profiler;
 	CustomConstants			CustomConst;
 	std::map<std::string, D3DXVECTOR4*>	ConstantsTable;
 	IDirect3DVertexBuffer9*	FrameVertex;
@@ -155,7 +168,6 @@ public:
     TESObjectCELL*          PreviousCell;
     bool                    IsMenuSwitch;
     bool                    orthoRequired;
-    bool                    avglumaRequired;
 	bool					EffectReloadQueued;
 	D3DXVECTOR4				SpotLightPosition[SpotLightsMax];
 	D3DXVECTOR4				SpotLightColor[SpotLightsMax];
@@ -0,0 +1,90 @@
+ShaderProgramCache::ShaderProgramCache() {
+
+	UsersCount = 0;
+
+}
+
+/*
+* Returns the program added with the same key and data, with a reference added for the caller, or NULL.
+*/
+IUnknown* ShaderProgramCache::Find(UInt64 Key, ID3DXBuffer* Data) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	auto Item = Programs.find(Key);
+	if (Item == Programs.end()) return NULL;
+
+	ID3DXBuffer* Other = Item->second.Data;
+	if (Other->GetBufferSize() != Data->GetBufferSize() || memcmp(Other->GetBufferPointer(), Data->GetBufferPointer(), Data->GetBufferSize())) return NULL;
+	Item->second.Object->AddRef();
+	Item->second.Users++;
+	UsersCount++;
+	return Item->second.Object;
+
+}
+
+/*
+* Adds a program for the next identical permutations, the caller keeps its own reference. A colliding key keeps the first program.
+*/
+void ShaderProgramCache::Add(UInt64 Key, ID3DXBuffer* Data, IUnknown* Object) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	UsersCount++;
+	if (Programs.count(Key)) return;
+
+	Data->AddRef();
+	Object->AddRef();
+	Programs[Key] = { Data, Object, 1 };
+
+}
+
+/*
+* Releases a user's reference. The last user of an entry also releases the entry. A program kept out of the cache by a colliding key,
+* or added before a Clear, only has its user's reference.
+*/
+void ShaderProgramCache::Release(IUnknown* Object) {
+
+	if (!Object) return;
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	UsersCount--;
+	for (auto Item = Programs.begin(); Item != Programs.end(); ++Item) {
+		if (Item->second.Object != Object) continue;
+		if (--Item->second.Users == 0) {
+			Item->second.Data->Release();
+			Item->second.Object->Release();
+			Programs.erase(Item);
+		}
+		break;
+	}
+	Object->Release();
+
+}
+
+/*
+* Releases every entry, the users keep their own references.
+*/
+void ShaderProgramCache::Clear() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	for (auto& Item : Programs) {
+		Item.second.Data->Release();
+		Item.second.Object->Release();
+	}
+	Programs.clear();
+	UsersCount = 0;
+
+}
+
+UInt32 ShaderProgramCache::GetProgramsCount() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	return Programs.size();
+
+}
+
+UInt32 ShaderProgramCache::GetUsersCount() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	return UsersCount;
+
+}
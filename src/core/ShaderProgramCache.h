@@ -0,0 +1,30 @@
+#pragma once
+
+/*
+* Programs shared by identical shader permutations, keyed by a hash of what they were built from (preprocessed source and profile,
+* or binary). That data is kept with the entry and compared on lookup, so that a hash collision can't share different programs.
+* The cache holds its own reference on the data and on the program. Every Find hit and Add counts a user, dropped by Release;
+* an entry is released with its last user, whatever references the device still holds on a bound shader.
+*/
+class ShaderProgramCache {
+public:
+	struct Program {
+		ID3DXBuffer*		Data;
+		IUnknown*			Object;		// binary of a compiled program, or device shader
+		UInt32				Users;
+	};
+
+	ShaderProgramCache();
+
+	IUnknown*			Find(UInt64 Key, ID3DXBuffer* Data);
+	void				Add(UInt64 Key, ID3DXBuffer* Data, IUnknown* Object);
+	void				Release(IUnknown* Object);
+	void				Clear();
+	UInt32				GetProgramsCount();
+	UInt32				GetUsersCount();
+
+private:
+	std::unordered_map<UInt64, Program>	Programs;
+	std::mutex			Lock;
+	UInt32				UsersCount;
+};
@@ -15,6 +15,11 @@ ShaderProgram::~ShaderProgram() {
 }
 
 
+ShaderProgramCache ShaderRecord::CompiledPrograms;
+ShaderProgramCache ShaderRecord::DeviceShaders;
+std::atomic<UInt32> ShaderRecord::CompilesCount;
+std::atomic<UInt32> ShaderRecord::CompilesShared;
+
 ShaderRecord::ShaderRecord() {
 
 	HasRenderedBuffer = false;
@@ -22,7 +27,20 @@ ShaderRecord::ShaderRecord() {
 	ClearSamplers = true;
 
 }
-ShaderRecord::~ShaderRecord() {}
+ShaderRecord::~ShaderRecord() {
+}
+
+/*
+* Frees the programs kept to share the compilations, once the startup shaders are compiled.
+*/
+void ShaderRecord::ClearCompiledPrograms() {
+
+	if (CompilesCount) Logger::Log("Shader permutations compiled: %u, unique programs: %u", (UInt32)CompilesCount, (UInt32)(CompilesCount - CompilesShared));
+	CompiledPrograms.Clear();
+	CompilesCount = 0;
+	CompilesShared = 0;
+
+}
 
 void ShaderProgram::ReportError(HRESULT result) {
 	if (result == E_ABORT) Logger::Log("Operation aborted");
@@ -85,175 +103,237 @@ bool ShaderProgram::CheckPreprocessResult(const char* CachedPreprocessPath, ID3D
 }
 
 /*
-Loads the shader by name from a given subfolder (optionally). Shader will be compiled if needed.
-@returns the ShaderRecord for this shader.
+* Reads a whole file into a new D3DX buffer.
 */
-ShaderRecord* ShaderRecord::LoadShader(const char* Name, const char* SubPath, ShaderTemplate Template) {
-	auto timer = TimeLogger();
+bool ShaderProgram::LoadFileBuffer(const char* Path, ID3DXBuffer** Buffer) {
+	std::ifstream File(Path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!File.is_open()) return false;
 
-	ShaderRecord* ShaderProg = NULL;
-	ID3DXBuffer* ShaderSource = NULL;
-	ID3DXBuffer* Shader = NULL;
-	ID3DXBuffer* Errors = NULL;
-	ID3DXConstantTable* ConstantTable = NULL;
-	void* Function = NULL;
-	char ShaderProfile[7];
-	
+	std::streamoff Size = File.tellg();
+	if (Size <= 0 || FAILED(D3DXCreateBuffer(Size, Buffer))) {
+		Logger::Log("ERROR: Failed to create buffer for file %s", Path);
+		return false;
+	}
+
+	File.seekg(0, std::ios::beg);
+	File.read((char*)(*Buffer)->GetBufferPointer(), Size);
+	return true;
+}
+
+/*
+Builds the source, preprocessed and compiled paths of a shader, and the defines used to compile it.
+@returns false if the shader has no source.
+*/
+bool ShaderRecord::GetShaderPaths(const char* Name, const char* SubPath, ShaderTemplate* Template, char* SourcePath, char* PreprocessedPath, char* CompiledPath) {
 	char BaseDirectory[MAX_PATH];
 	char CacheDirectory[MAX_PATH];
-	char ShaderSourcePath[MAX_PATH];
-	char ShaderPreprocessedPath[MAX_PATH];
-	char ShaderCompiledPath[MAX_PATH];
-	
-	// Build filenames.
+
 	strcpy(BaseDirectory, ShadersPath);
 	strcpy(CacheDirectory, BaseDirectory);
 	strcat(CacheDirectory, "Cache\\");
 	if (SubPath) strcat(BaseDirectory, SubPath);
 	if (SubPath) strcat(CacheDirectory, SubPath);
 
-	strcpy(ShaderSourcePath, BaseDirectory);
-	if (Template.Name != NULL) {
-		strcat(ShaderSourcePath, Template.Name);
+	strcpy(SourcePath, BaseDirectory);
+	if (Template->Name != NULL) {
+		strcat(SourcePath, Template->Name);
 	}
 	else {
-		strcat(ShaderSourcePath, Name);
+		strcat(SourcePath, Name);
 	}
-	strcat(ShaderSourcePath, ".hlsl");
+	strcat(SourcePath, ".hlsl");
 
-	if (!FileExists(ShaderSourcePath)) {
-		return ShaderProg;
-	}
+	if (!FileExists(SourcePath)) return false;
 
-	strcpy(ShaderPreprocessedPath, CacheDirectory);
-	strcat(ShaderPreprocessedPath, Name);
-	strcat(ShaderPreprocessedPath, ".hlsl");
+	strcpy(PreprocessedPath, CacheDirectory);
+	strcat(PreprocessedPath, Name);
+	strcat(PreprocessedPath, ".hlsl");
 
-	strcpy(ShaderCompiledPath, CacheDirectory);
-	strcat(ShaderCompiledPath, Name);
+	strcpy(CompiledPath, CacheDirectory);
+	strcat(CompiledPath, Name);
 
-	D3DXMACRO* Macros = &(Template.Defines[0]);
 	if (TheRenderManager->IsReversedDepth()) {
 		int i = 0;
 		bool nullFound = false;
 		while (!nullFound && i < 28) {
-			nullFound = Template.Defines[i].Name == NULL;
+			nullFound = Template->Defines[i].Name == NULL;
 			if (!nullFound) i++;
 		}
-		Template.Defines[i] = { "REVERSED_DEPTH", "" };
-		Template.Defines[i + 1] = { NULL, NULL }; // Ensure null termination
-	}
-
-	HRESULT prepass = D3DXPreprocessShaderFromFileA(ShaderSourcePath, Macros, NULL, &ShaderSource, &Errors);
-	if (prepass == D3D_OK) {
-		bool Compile = !CheckPreprocessResult(ShaderPreprocessedPath, ShaderSource);
-
-		if (strstr(Name, ".vso"))
-			strcpy(ShaderProfile, "vs_3_0");
-		else if (strstr(Name, ".pso"))
-			strcpy(ShaderProfile, "ps_3_0");
-
-		if (!Compile){
-			std::ifstream FileBinary(ShaderCompiledPath, std::ios::in | std::ios::binary | std::ios::ate);
-			if (FileBinary.is_open()) {
-				std::streamoff Size = FileBinary.tellg();
-				if (Size > 0 && SUCCEEDED(D3DXCreateBuffer(Size, &Shader))) {
-					FileBinary.seekg(0, std::ios::beg);
-					Function = Shader->GetBufferPointer();
-					FileBinary.read((char*)Function, Size);
-					FileBinary.close();
+		Template->Defines[i] = { "REVERSED_DEPTH", "" };
+		Template->Defines[i + 1] = { NULL, NULL }; // Ensure null termination
+	}
+	return true;
+}
+
+/*
+Preprocesses and compiles the shader if the cache is outdated. Doesn't use the device, so it can run on a worker thread.
+@returns the preprocessed source and the binary if requested (the caller releases them), false if the shader has no source or failed to compile.
+*/
+bool ShaderRecord::CompileShader(const char* Name, const char* SubPath, ShaderTemplate Template, ID3DXBuffer** SourceBuffer, ID3DXBuffer** BinaryBuffer) {
+	auto timer = TimeLogger();
+
+	ID3DXBuffer* ShaderSource = NULL;
+	ID3DXBuffer* Shader = NULL;
+	ID3DXBuffer* Errors = NULL;
+	char ShaderProfile[7] = "";
+
+	char ShaderSourcePath[MAX_PATH];
+	char ShaderPreprocessedPath[MAX_PATH];
+	char ShaderCompiledPath[MAX_PATH];
+
+	if (!GetShaderPaths(Name, SubPath, &Template, ShaderSourcePath, ShaderPreprocessedPath, ShaderCompiledPath)) return false;
+	D3DXMACRO* Macros = &(Template.Defines[0]);
+
+	if (strstr(Name, ".vso"))
+		strcpy(ShaderProfile, "vs_3_0");
+	else if (strstr(Name, ".pso"))
+		strcpy(ShaderProfile, "ps_3_0");
+
+	// a precompiled entry or an unchanged index entry means the preprocessed source and binary can be used without running the preprocessor
+	UInt64 ConfigHash = ShaderCache::HashConfig(ShaderSourcePath, Template.Name, Macros, ShaderProfile);
+	bool Cached = ShaderArchive::Precompiled.Find(ShaderCompiledPath, ConfigHash, &ShaderSource, &Shader) ||
+		(ShaderCache::Shaders.IsEntryValid(ShaderCompiledPath, ConfigHash) && LoadFileBuffer(ShaderPreprocessedPath, &ShaderSource) && LoadFileBuffer(ShaderCompiledPath, &Shader));
+	if (!Cached) {
+		if (ShaderSource) ShaderSource->Release();
+		ShaderSource = NULL;
+
+		HRESULT prepass = D3DXPreprocessShaderFromFileA(ShaderSourcePath, Macros, NULL, &ShaderSource, &Errors);
+		if (prepass == D3D_OK) {
+			bool Compile = !CheckPreprocessResult(ShaderPreprocessedPath, ShaderSource);
+
+			if (!Compile && !LoadFileBuffer(ShaderCompiledPath, &Shader))
+				Logger::Log("ERROR: Shader binary %s not found.", ShaderCompiledPath);
+
+			if (Compile || !Shader) {
+				// compile if option was enabled or compiled version not found, unless an identical permutation already preprocessed to the same code
+				if (Errors) { Errors->Release(); Errors = NULL; }
+				UInt64 ProgramKey = ShaderCache::Hash(ShaderSource->GetBufferPointer(), ShaderSource->GetBufferSize(), ShaderCache::HashString(ShaderProfile, ShaderCache::Hash(nullptr, 0)));
+				Shader = (ID3DXBuffer*)CompiledPrograms.Find(ProgramKey, ShaderSource);
+				bool Shared = Shader != NULL;
+				CompilesCount++;
+				if (Shared) {
+					CompilesShared++;
 				}
 				else {
+					D3DXCompileShader(
+						(const char*)ShaderSource->GetBufferPointer(),
+						ShaderSource->GetBufferSize(),
+						NULL,
+						NULL,
+						"main",
+						ShaderProfile,
+						NULL,
+						&Shader,
+						&Errors,
+						NULL
+					);
+					if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
+					if (Shader) CompiledPrograms.Add(ProgramKey, ShaderSource, Shader);
+				}
+				if (Shader) {
+					std::ofstream FileBinary(ShaderCompiledPath, std::ios::out | std::ios::binary);
+					FileBinary.write((const char*)Shader->GetBufferPointer(), Shader->GetBufferSize());
+					FileBinary.flush();
 					FileBinary.close();
-					Logger::Log("ERROR: Failed to create buffer for shader binary %s", ShaderCompiledPath);
+
+					std::ofstream FilePreprocess(ShaderPreprocessedPath, std::ios::out | std::ios::binary);
+					FilePreprocess.write((const char*)ShaderSource->GetBufferPointer(), ShaderSource->GetBufferSize());
+					FilePreprocess.flush();
+					FilePreprocess.close();
+
+					if (Shared)
+						Logger::Log("Shader compiled: %s shares the program of an identical permutation", ShaderCompiledPath);
+					else if (Template.Name == NULL)
+						Logger::Log("Shader compiled: %s", ShaderCompiledPath);
+					else
+						Logger::Log("Shader compiled: %s using template: %s", ShaderCompiledPath, ShaderSourcePath);
 				}
 			}
-			else {
-				Logger::Log("ERROR: Shader binary %s not found.", ShaderCompiledPath);
-			}
-		}
 
-		if (Compile || !Function) {
-			// compile if option was enabled or compiled version not found
-			D3DXCompileShader(
-				(const char*)ShaderSource->GetBufferPointer(),
-				ShaderSource->GetBufferSize(),
-				NULL,
-				NULL,
-				"main",
-				ShaderProfile,
-				NULL,
-				&Shader,
-				&Errors,
-				&ConstantTable
-			);
+			// remember the state of the sources so that the next launch can skip preprocessing
+			if (Shader) ShaderCache::Shaders.UpdateEntry(ShaderCompiledPath, ShaderSourcePath, ConfigHash);
+		}
+		else {
 			if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
-			if (Shader) {
-				Function = Shader->GetBufferPointer();
-				std::ofstream FileBinary(ShaderCompiledPath, std::ios::out | std::ios::binary);
-				FileBinary.write((const char*)Function, Shader->GetBufferSize());
-				FileBinary.flush();
-				FileBinary.close();
-
-				std::ofstream FilePreprocess(ShaderPreprocessedPath, std::ios::out | std::ios::binary);
-				FilePreprocess.write((const char*)ShaderSource->GetBufferPointer(), ShaderSource->GetBufferSize());
-				FilePreprocess.flush();
-				FilePreprocess.close();
-
-				if (Template.Name == NULL)
-					Logger::Log("Shader compiled: %s", ShaderCompiledPath);
-				else
-					Logger::Log("Shader compiled: %s using template: %s", ShaderCompiledPath, ShaderSourcePath);
-			}
 		}
+	}
+
+	timer.LogTime("ShaderRecord::CompileShader");
+
+	bool Result = Shader != NULL;
+	if (Errors) Errors->Release();
+	if (SourceBuffer && Result) *SourceBuffer = ShaderSource; else if (ShaderSource) ShaderSource->Release();
+	if (BinaryBuffer && Result) *BinaryBuffer = Shader; else if (Shader) Shader->Release();
+	return Result;
+}
+
+/*
+Loads the shader by name from a given subfolder (optionally). Shader will be compiled if needed.
+@returns the ShaderRecord for this shader.
+*/
+ShaderRecord* ShaderRecord::LoadShader(const char* Name, const char* SubPath, ShaderTemplate Template) {
+	auto timer = TimeLogger();
+
+	ShaderRecord* ShaderProg = NULL;
+	ID3DXBuffer* ShaderSource = NULL;
+	ID3DXBuffer* Shader = NULL;
+	ID3DXConstantTable* ConstantTable = NULL;
+
+	if (!CompileShader(Name, SubPath, Template, &ShaderSource, &Shader)) return ShaderProg;
 
-		HRESULT get = D3DXGetShaderConstantTableEx((const DWORD*)Function, D3DXCONSTTABLE_LARGEADDRESSAWARE, &ConstantTable);
+	const DWORD* Function = (const DWORD*)Shader->GetBufferPointer();
+	HRESULT get = D3DXGetShaderConstantTableEx(Function, D3DXCONSTTABLE_LARGEADDRESSAWARE, &ConstantTable);
+
+	if (FAILED(get)) {
+		Logger::Log("Encountered an issue getting constant table for %s", Name);
+		ReportError(get);
+	}
+	else {
+		D3DXCONSTANTTABLE_DESC ConstantTableDesc;
+		get = ConstantTable->GetDesc(&ConstantTableDesc);
+		ReportError(get);
 
 		if (FAILED(get)) {
-			Logger::Log("Encountered an issue getting constant table for %s", Name);
-			ReportError(get);
+			Logger::Log("Issues getting constants descriptions for %s", Name);
 		}
 		else {
-			D3DXCONSTANTTABLE_DESC ConstantTableDesc;
-			get = ConstantTable->GetDesc(&ConstantTableDesc);
-			ReportError(get);
+			// permutations compiled to the same binary use the same device shader
+			HRESULT createResult = E_FAIL;
+			UInt64 ProgramKey = ShaderCache::Hash(Function, Shader->GetBufferSize());
+			IUnknown* Shared = DeviceShaders.Find(ProgramKey, Shader);
+			if (strstr(Name, ".vso")) {
+				ShaderRecordVertex* Record = new ShaderRecordVertex(Name);
+				Record->ShaderHandle = (IDirect3DVertexShader9*)Shared;
+				createResult = Shared ? D3D_OK : TheRenderManager->device->CreateVertexShader(Function, &Record->ShaderHandle);
+				if (!Shared && SUCCEEDED(createResult)) DeviceShaders.Add(ProgramKey, Shader, Record->ShaderHandle);
+				ShaderProg = Record;
+			}
+			else {
+				ShaderRecordPixel* Record = new ShaderRecordPixel(Name);
+				Record->ShaderHandle = (IDirect3DPixelShader9*)Shared;
+				createResult = Shared ? D3D_OK : TheRenderManager->device->CreatePixelShader(Function, &Record->ShaderHandle);
+				if (!Shared && SUCCEEDED(createResult)) DeviceShaders.Add(ProgramKey, Shader, Record->ShaderHandle);
+				ShaderProg = Record;
+			}
 
-			if (FAILED(get)) {
-				Logger::Log("Issues getting constants descriptions for %s", Name);
+			if (SUCCEEDED(createResult)) {
+				ShaderProg->CreateCT(ShaderSource, ConstantTable);
+				Logger::Log("Shader loaded: %s%s%s", SubPath ? SubPath : "", Name, Shared ? " (shared program)" : "");
 			}
-			else if (Shader) {
-				HRESULT createResult = E_FAIL;
-				if (ShaderProfile[0] == 'v') {
-					ShaderProg = new ShaderRecordVertex(Name);
-					createResult = TheRenderManager->device->CreateVertexShader((const DWORD*)Function, &((ShaderRecordVertex*)ShaderProg)->ShaderHandle);
-				}
-				else {
-					ShaderProg = new ShaderRecordPixel(Name);
-					createResult = TheRenderManager->device->CreatePixelShader((const DWORD*)Function, &((ShaderRecordPixel*)ShaderProg)->ShaderHandle);
-				}
-				
-				if (SUCCEEDED(createResult)) {
-					ShaderProg->CreateCT(ShaderSource, ConstantTable);
-					Logger::Log("Shader loaded: %s", ShaderCompiledPath);
-				}
-				else {
-					Logger::Log("ERROR: Failed to create DirectX shader for %s", Name);
-					ReportError(createResult);
-					delete ShaderProg;
-					ShaderProg = nullptr;
-				}
+			else {
+				Logger::Log("ERROR: Failed to create DirectX shader for %s", Name);
+				ReportError(createResult);
+				delete ShaderProg;
+				ShaderProg = nullptr;
 			}
 		}
 	}
-	else {
-		if (Errors) Logger::Log((char*)Errors->GetBufferPointer());
-	}
 
 	timer.LogTime("ShaderRecord::LoadShader");
 
+	if (ConstantTable) ConstantTable->Release();
 	if (ShaderSource) ShaderSource->Release();
 	if (Shader) Shader->Release();
-	if (Errors) Errors->Release();
 	return ShaderProg;
 }
 
@@ -329,6 +409,17 @@ void ShaderRecord::CreateCT(ID3DXBuffer* ShaderSource, ID3DXConstantTable* Const
 		}
 	}
 
+	// keep the float constants ordered by register so that adjacent registers can be uploaded in a single call
+	std::sort(FloatShaderValues, FloatShaderValues + FloatShaderValuesCount, [](const ShaderFloatValue& a, const ShaderFloatValue& b) { return a.RegisterIndex < b.RegisterIndex; });
+
+	if (FloatShaderValuesCount) {
+		UInt32 RegisterEnd = 0;
+		for (UInt32 c = 0; c < FloatShaderValuesCount; c++) {
+			RegisterEnd = max(RegisterEnd, FloatShaderValues[c].RegisterIndex + FloatShaderValues[c].RegisterCount);
+		}
+		ConstantCache.Initialize(FloatShaderValues[0].RegisterIndex, RegisterEnd - FloatShaderValues[0].RegisterIndex);
+	}
+
 	timer.LogTime("ShaderRecord::createCT Done");
 }
 
@@ -389,7 +480,7 @@ void ShaderTextureValue::GetTextureRecord() {
 	Texture = new TextureRecord();
 
 	// preload file textures, game textures will get bind during constant table setting
-	if (TexturePath != "") Texture->Texture = TheTextureManager->GetFileTexture(TexturePath, Type);
+	if (TexturePath != "") Texture->Texture = TheTextureManager->GetFileTexture(TexturePath, Type, &Texture->Texture);
 
 	// override default sampler states if the sampler string was found
 	if (!SamplerString.empty()) Texture->GetSamplerStates(trim(SamplerString));
@@ -422,7 +513,10 @@ void ShaderFloatValue::GetValueFromConstantTable() {
 */
 void ShaderRecord::SetCT() {
 
-	if (HasRenderedBuffer) TheRenderManager->device->StretchRect(TheRenderManager->currentRTGroup->RenderTargets[0]->data->Surface, NULL, TheTextureManager->RenderedSurface, NULL, D3DTEXF_NONE);
+	if (HasRenderedBuffer) {
+		TheRenderManager->device->StretchRect(TheRenderManager->currentRTGroup->RenderTargets[0]->data->Surface, NULL, TheTextureManager->RenderedSurface, NULL, D3DTEXF_NONE);
+		TheTextureManager->InvalidateRenderedBuffer(); // holds the game render target, not the effects one
+	}
 	if (HasDepthBuffer) {
 		//Logger::Log("Resolving depth buffer for shader %s", Name);
 		TheRenderManager->ResolveDepthBuffer(TheTextureManager->DepthTexture);
@@ -458,7 +552,7 @@ void ShaderRecord::SetCT() {
 		}
 	}
 
-	// update constants
+	// update constants, only the registers that changed since the last upload are sent inside a constant batch
 	ShaderFloatValue* Constant;
 	for (UInt32 c = 0; c < FloatShaderValuesCount; c++) {
 		Constant = &FloatShaderValues[c];
@@ -469,8 +563,11 @@ void ShaderRecord::SetCT() {
 			continue;
 		}
 
-		SetShaderConstantF(Constant->RegisterIndex, Constant->Value, Constant->RegisterCount); // TODO: for matrices, rows and columns are inverted because of the way this works.
+		// TODO: for matrices, rows and columns are inverted because of the way this works.
+		ConstantCache.Set(Constant->RegisterIndex, Constant->Value, Constant->RegisterCount);
 	}
+
+	ConstantCache.Upload([this](UInt32 RegisterIndex, D3DXVECTOR4* Values, UInt32 RegisterCount) { SetShaderConstantF(RegisterIndex, Values, RegisterCount); });
 }
 
 
@@ -587,7 +684,7 @@ ShaderRecordVertex::ShaderRecordVertex(const char* shaderName) {
 
 ShaderRecordVertex::~ShaderRecordVertex() {
 
-	ShaderHandle->Release();
+	DeviceShaders.Release(ShaderHandle);
 
 }
 
@@ -595,12 +692,13 @@ ShaderRecordPixel::ShaderRecordPixel(const char* shaderName) {
 	Name = shaderName;
 	ShaderHandle = NULL;
 	ClearSamplers = true;
+	ConstantCache.Stage = 1;
 
 }
 
 ShaderRecordPixel::~ShaderRecordPixel() {
 
-	ShaderHandle->Release();
+	DeviceShaders.Release(ShaderHandle);
 
 }
 
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "ShaderTemplate.h"
+#include "ShaderCache.h"
+#include "ShaderArchive.h"
+#include "ShaderConstantCache.h"
+#include "ShaderProgramCache.h"
 
 enum ShaderCompileType {
 	AlwaysOff,
@@ -65,6 +69,7 @@ public:
 	static void				ReportError(HRESULT result);
 	static bool				FileExists(const char* path);
 	static bool				CheckPreprocessResult(const char* CachedPreprocessPath, ID3DXBuffer* ShaderSource);
+	static bool				LoadFileBuffer(const char* Path, ID3DXBuffer** Buffer);
 
 
 	ShaderFloatValue*		FloatShaderValues;
@@ -83,11 +88,21 @@ public:
 	virtual void			SetShaderConstantF(UInt32 RegisterIndex, D3DXVECTOR4* Value, UInt32 RegisterCount) = 0;
 
 	static ShaderRecord*	LoadShader(const char* Name, const char* SubPath, ShaderTemplate Template = ShaderTemplate{});
+	static bool				CompileShader(const char* Name, const char* SubPath, ShaderTemplate Template, ID3DXBuffer** SourceBuffer, ID3DXBuffer** BinaryBuffer);
+	static bool				GetShaderPaths(const char* Name, const char* SubPath, ShaderTemplate* Template, char* SourcePath, char* PreprocessedPath, char* CompiledPath);
+
+	static void				ClearCompiledPrograms();
 
 	const char* Name;
 	bool					HasRenderedBuffer;
 	bool					HasDepthBuffer;
 	bool					ClearSamplers;
+	ShaderConstantCache		ConstantCache;				// last values uploaded for the TESR register span
+
+	static ShaderProgramCache CompiledPrograms;		// preprocessed source and profile -> binary, kept while the shaders are compiled at startup
+	static ShaderProgramCache DeviceShaders;		// binary -> device shader, an entry lives as long as a record uses the shader
+	static std::atomic<UInt32> CompilesCount;
+	static std::atomic<UInt32> CompilesShared;
 };
 
 class ShaderRecordVertex : public ShaderRecord {
@@ -0,0 +1,34 @@
+/*
+* Registers the shaders of a space separated list in a string literal (e.g. the blood shaders), without template. The keys point into the list.
+* The names match exactly: a part of a listed name (e.g. "DECAL.pso" in "GDECAL.pso") isn't registered.
+*/
+void ShaderRegistry::RegisterNames(const char* Names, ShaderCollection* Collection, const PrefixRule& GetCollectionByPrefix) {
+
+	for (const char* Name = Names; *Name;) {
+		size_t Length = strcspn(Name, " ");
+		if (Length && !GetCollectionByPrefix(Name)) Shaders.emplace(std::string_view(Name, Length), ShaderRegistration{ Collection, ShaderTemplate{} });
+		Name += Length;
+		while (*Name == ' ') Name++;
+	}
+
+}
+
+/*
+* Registers the shaders of a collection's templates. Templates() is only read here, its keys are string literals.
+*/
+void ShaderRegistry::RegisterTemplates(ShaderCollection* Collection, const PrefixRule& GetCollectionByPrefix) {
+
+	for (const auto& [ShaderName, Template] : Collection->Templates()) {
+		ShaderCollection* Owner = GetCollectionByPrefix(ShaderName.data());
+		if (Owner && Owner != Collection) continue;
+		Shaders.emplace(ShaderName, ShaderRegistration{ Collection, Template });
+	}
+
+}
+
+const ShaderRegistration* ShaderRegistry::Find(const char* Name) {
+
+	auto Registration = Shaders.find(Name);
+	return Registration != Shaders.end() ? &Registration->second : NULL;
+
+}
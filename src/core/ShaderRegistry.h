@@ -0,0 +1,25 @@
+#pragma once
+
+/*
+* Game shader handled by a collection, with the template it is compiled from (Template.Name is NULL without template).
+*/
+struct ShaderRegistration {
+	ShaderCollection*		Collection;
+	ShaderTemplate			Template;
+};
+
+/*
+* Game shaders named by the collection templates and by name lists, built once after the collections are registered.
+* The keys are views of string literals, so a lookup hashes the name without allocating. A name is registered once,
+* the first collection keeps it, and a name the prefix rule gives to another collection is skipped.
+*/
+class ShaderRegistry {
+public:
+	typedef std::function<ShaderCollection*(const char* Name)> PrefixRule;
+
+	void					RegisterNames(const char* Names, ShaderCollection* Collection, const PrefixRule& GetCollectionByPrefix);
+	void					RegisterTemplates(ShaderCollection* Collection, const PrefixRule& GetCollectionByPrefix);
+	const ShaderRegistration* Find(const char* Name);
+
+	std::unordered_map<std::string_view, ShaderRegistration> Shaders;
+};
@@ -0,0 +1,203 @@
+ShadowCasterCache::ShadowCasterCache() {
+
+	Frame = 0;
+	CellsRebuilt = 0;
+	CastersReclassified = 0;
+	CastersMoved = 0;
+	CastersCount = 0;
+
+}
+
+
+/*
+* Maps a base form type to the category filtered by the shadows forms settings. Land is handled separately and is never a caster.
+*/
+UInt32 ShadowCasterCache::GetCasterType(TESForm* Form) {
+	if (!Form) return CasterNone;
+
+	switch (Form->formType) {
+	case TESForm::FormType::kFormType_Land:
+		return CasterNone;
+	case TESForm::FormType::kFormType_Activator:
+		return CasterActivator;
+	case TESForm::FormType::kFormType_Apparatus:
+		return CasterApparatus;
+	case TESForm::FormType::kFormType_Book:
+		return CasterBook;
+	case TESForm::FormType::kFormType_Container:
+		return CasterContainer;
+	case TESForm::FormType::kFormType_Door:
+		return CasterDoor;
+	case TESForm::FormType::kFormType_Misc:
+		return CasterMisc;
+	case TESForm::FormType::kFormType_Tree:
+		return CasterTree;
+	case TESForm::FormType::kFormType_Furniture:
+		return CasterFurniture;
+	case TESForm::FormType::kFormType_NPC:
+	case TESForm::FormType::kFormType_Creature:
+	case TESForm::FormType::kFormType_LeveledCreature:
+		return CasterActor;
+	case TESForm::FormType::kFormType_Stat:
+	case TESForm::FormType::kFormType_StaticCollection:
+	case TESForm::FormType::kFormType_MoveableStatic:
+		return CasterStatic;
+	default:
+		return CasterOther;
+	}
+}
+
+
+/*
+* Converts the forms settings of a shadow map to the mask of the caster categories it renders.
+*/
+UInt32 ShadowCasterCache::GetFormsMask(ShadowsExteriorEffect::FormsStruct* Forms) {
+	UInt32 Mask = CasterOther;
+	if (Forms->Activators) Mask |= CasterActivator;
+	if (Forms->Actors) Mask |= CasterActor;
+	if (Forms->Apparatus) Mask |= CasterApparatus;
+	if (Forms->Books) Mask |= CasterBook;
+	if (Forms->Containers) Mask |= CasterContainer;
+	if (Forms->Doors) Mask |= CasterDoor;
+	if (Forms->Furniture) Mask |= CasterFurniture;
+	if (Forms->Misc) Mask |= CasterMisc;
+	if (Forms->Statics) Mask |= CasterStatic;
+	if (Forms->Trees) Mask |= CasterTree;
+	return Mask;
+}
+
+
+bool ShadowCasterCache::IsRefracted(TESObjectREFR* Ref) {
+	ExtraRefractionProperty* RefractionExtraProperty = (ExtraRefractionProperty*)Ref->extraDataList.GetExtraData(BSExtraData::ExtraDataType::kExtraData_RefractionProperty);
+	float Refraction = RefractionExtraProperty ? (1 - RefractionExtraProperty->refractionAmount) : 0.0f;
+	return Refraction >= 0.5;
+}
+
+
+/*
+* Cheap signature of the object list of a cell, used to detect refs being added or removed without classifying them.
+*/
+void ShadowCasterCache::HashRefs(TESObjectCELL* Cell, UInt32* Count, UInt32* Hash) {
+	UInt32 Result = 2166136261u;
+	UInt32 Refs = 0;
+
+	TList<TESObjectREFR>::Entry* Entry = &Cell->objectList.First;
+	while (Entry) {
+		if (Entry->item) {
+			Result = (Result ^ (UInt32)Entry->item) * 16777619u;
+			Refs++;
+		}
+		Entry = Entry->next;
+	}
+	*Count = Refs;
+	*Hash = Result;
+}
+
+
+void ShadowCasterCache::BuildCell(TESObjectCELL* Cell, CellEntry* Entry) {
+	RemoveCell(Entry);
+
+	TList<TESObjectREFR>::Entry* RefEntry = &Cell->objectList.First;
+	while (RefEntry) {
+		TESObjectREFR* Ref = RefEntry->item;
+		RefEntry = RefEntry->next;
+
+		if (!Ref) continue;
+		UInt32 Type = GetCasterType(Ref->baseForm);
+		if (Type == CasterNone) continue;
+
+		Caster Item = { Ref, NULL, { NiPoint3(0.0f, 0.0f, 0.0f), 0.0f }, Type, 0, false };
+		Entry->Casters.push_back(Item);
+	}
+
+	// the vector doesn't grow anymore, the hierarchy can point to its items
+	for (Caster& Item : Entry->Casters) {
+		Item.Handle = Tree.Insert(&Item, Item.Bound);
+		RefreshCaster(&Item);
+	}
+
+	HashRefs(Cell, &Entry->RefsCount, &Entry->RefsHash);
+	CellsRebuilt++;
+}
+
+
+void ShadowCasterCache::RemoveCell(CellEntry* Entry) {
+	for (Caster& Item : Entry->Casters) Tree.Remove(Item.Handle);
+	Entry->Casters.clear();
+}
+
+
+/*
+* Keeps a caster in sync with its reference: new 3D is classified again, a moved node only updates the bound.
+* Actors can turn refracted at any time (stealth), other refs only when their 3D is reloaded.
+*/
+void ShadowCasterCache::RefreshCaster(Caster* Item) {
+	NiNode* Node = Item->Ref->GetNode();
+
+	if (Node != Item->Node) {
+		Item->Node = Node;
+		Item->Refracted = Node && IsRefracted(Item->Ref);
+		CastersReclassified++;
+	}
+	else if (Node && Item->Type == CasterActor) {
+		Item->Refracted = IsRefracted(Item->Ref);
+	}
+
+	if (!Node) return;
+
+	NiBound* Bound = Node->GetWorldBound();
+	if (Bound->Radius != Item->Bound.Radius || Bound->Center.x != Item->Bound.Center.x || Bound->Center.y != Item->Bound.Center.y || Bound->Center.z != Item->Bound.Center.z) {
+		Item->Bound = *Bound;
+		Tree.Move(Item->Handle, Item->Bound);
+		CastersMoved++;
+	}
+}
+
+
+/*
+* Synchronizes the cache with the loaded cells, then updates the hierarchy. Called once per frame before the shadow maps are rendered.
+*/
+void ShadowCasterCache::Update(TESObjectCELL** LoadedCells, UInt32 CellsCount) {
+	Frame++;
+	CellsRebuilt = 0;
+	CastersReclassified = 0;
+	CastersMoved = 0;
+	CastersCount = 0;
+
+	for (UInt32 i = 0; i < CellsCount; i++) {
+		TESObjectCELL* Cell = LoadedCells[i];
+		if (!Cell) continue;
+
+		auto [Item, Created] = Cells.try_emplace(Cell);
+		CellEntry* Entry = &Item->second;
+		Entry->LastFrame = Frame;
+
+		UInt32 RefsCount, RefsHash;
+		HashRefs(Cell, &RefsCount, &RefsHash);
+		if (Created || RefsCount != Entry->RefsCount || RefsHash != Entry->RefsHash) {
+			BuildCell(Cell, Entry);
+		}
+		else {
+			for (Caster& CellCaster : Entry->Casters) RefreshCaster(&CellCaster);
+		}
+		CastersCount += Entry->Casters.size();
+	}
+
+	// drop the cells unloaded since the last update
+	for (auto Item = Cells.begin(); Item != Cells.end();) {
+		if (Item->second.LastFrame != Frame) {
+			RemoveCell(&Item->second);
+			Item = Cells.erase(Item);
+		}
+		else
+			Item++;
+	}
+
+	Tree.Commit();
+}
+
+
+void ShadowCasterCache::Clear() {
+	Cells.clear();
+	Tree.Clear();
+}
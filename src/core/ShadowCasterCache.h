@@ -0,0 +1,109 @@
+#pragma once
+
+#include <unordered_map>
+#include "BoundingVolumeHierarchy.h"
+
+/*
+* Persistent list of the references able to cast a shadow in the loaded cells.
+* The references of a cell are classified once when the cell is first seen (form type, refraction, node), then only kept in sync:
+* - a cell whose object list changed (refs loaded/unloaded) is classified again;
+* - a reference whose 3D changed is classified again;
+* - a reference that moved only gets its world bound refreshed.
+* The casters of all the cells are kept in a bounding volume hierarchy, so cascades, spot lights and point lights only query their candidates.
+*/
+class ShadowCasterCache {
+public:
+	enum CasterType {
+		CasterNone			= 0,
+		CasterActivator		= 1 << 0,
+		CasterActor			= 1 << 1,
+		CasterApparatus		= 1 << 2,
+		CasterBook			= 1 << 3,
+		CasterContainer		= 1 << 4,
+		CasterDoor			= 1 << 5,
+		CasterFurniture		= 1 << 6,
+		CasterMisc			= 1 << 7,
+		CasterStatic		= 1 << 8,
+		CasterTree			= 1 << 9,
+		CasterOther			= 1 << 10,
+	};
+
+	struct Caster {
+		TESObjectREFR*	Ref;
+		NiNode*			Node;
+		NiBound			Bound;
+		UInt32			Type;
+		UInt32			Handle;		// item in the hierarchy
+		bool			Refracted;
+	};
+
+	struct CellEntry {
+		std::vector<Caster>	Casters;
+		UInt32				RefsCount;
+		UInt32				RefsHash;
+		UInt32				LastFrame;
+	};
+
+	ShadowCasterCache();
+
+	void				Update(TESObjectCELL** Cells, UInt32 CellsCount);
+	void				Clear();
+	template <typename F> void ForEachCaster(ShadowsExteriorEffect::FormsStruct* Forms, NiFrustumPlanes* Planes, F Function);
+	template <typename F> void ForEachCasterInSphere(ShadowsExteriorEffect::FormsStruct* Forms, const NiPoint3& Center, float Radius, F Function);
+	template <typename F> void ForEachCasterInCone(ShadowsExteriorEffect::FormsStruct* Forms, const NiPoint3& Apex, const NiPoint3& Direction, float Angle, float Range, F Function);
+
+	static UInt32		GetCasterType(TESForm* Form);
+	static UInt32		GetFormsMask(ShadowsExteriorEffect::FormsStruct* Forms);
+	static bool			IsRefracted(TESObjectREFR* Ref);
+	static bool			IsCasting(Caster* Item, UInt32 FormsMask);
+
+	UInt32				CellsRebuilt;		// stats of the last update
+	UInt32				CastersReclassified;
+	UInt32				CastersMoved;
+	UInt32				CastersCount;
+
+private:
+	void				BuildCell(TESObjectCELL* Cell, CellEntry* Entry);
+	void				RemoveCell(CellEntry* Entry);
+	void				RefreshCaster(Caster* Item);
+	static void			HashRefs(TESObjectCELL* Cell, UInt32* Count, UInt32* Hash);
+
+	std::unordered_map<TESObjectCELL*, CellEntry>	Cells;
+	BoundingVolumeHierarchy							Tree;
+	UInt32											Frame;
+};
+
+
+inline bool ShadowCasterCache::IsCasting(Caster* Item, UInt32 FormsMask) {
+	return Item->Node && (Item->Type & FormsMask) && !Item->Refracted && !(Item->Ref->flags & TESForm::FormFlags::kFormFlags_NotCastShadows);
+}
+
+
+/*
+* Calls the function with the node of every cached caster allowed by the forms settings and inside the frustum.
+*/
+template <typename F> void ShadowCasterCache::ForEachCaster(ShadowsExteriorEffect::FormsStruct* Forms, NiFrustumPlanes* Planes, F Function) {
+	UInt32 Mask = GetFormsMask(Forms);
+	Tree.QueryFrustum(Planes, [Mask, &Function](void* Data) {
+		Caster* Item = (Caster*)Data;
+		if (IsCasting(Item, Mask)) Function(Item->Node);
+	});
+}
+
+
+template <typename F> void ShadowCasterCache::ForEachCasterInSphere(ShadowsExteriorEffect::FormsStruct* Forms, const NiPoint3& Center, float Radius, F Function) {
+	UInt32 Mask = GetFormsMask(Forms);
+	Tree.QuerySphere(Center, Radius, [Mask, &Function](void* Data) {
+		Caster* Item = (Caster*)Data;
+		if (IsCasting(Item, Mask)) Function(Item->Node);
+	});
+}
+
+
+template <typename F> void ShadowCasterCache::ForEachCasterInCone(ShadowsExteriorEffect::FormsStruct* Forms, const NiPoint3& Apex, const NiPoint3& Direction, float Angle, float Range, F Function) {
+	UInt32 Mask = GetFormsMask(Forms);
+	Tree.QueryCone(Apex, Direction, Angle, Range, [Mask, &Function](void* Data) {
+		Caster* Item = (Caster*)Data;
+		if (IsCasting(Item, Mask)) Function(Item->Node);
+	});
+}
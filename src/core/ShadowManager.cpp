@@ -21,6 +21,10 @@ void ShadowManager::Initialize() {
 	TheShadowManager->ShadowCubeMapVertex = (ShaderRecordVertex*)ShaderRecord::LoadShader("ShadowCubeMap.vso", "Shadows\\");
 	TheShadowManager->ShadowCubeMapPixel = (ShaderRecordPixel*)ShaderRecord::LoadShader("ShadowCubeMap.pso", "Shadows\\");
 
+	// variants reading the world transforms from the instance stream, used with the extended declarations only
+	TheShadowManager->ShadowMapInstancedVertex = (ShaderRecordVertex*)ShaderRecord::LoadShader("ShadowMapInstanced.vso", "Shadows\\", ShaderTemplate{ "ShadowMap.vso", {{"INSTANCED", ""}} });
+	TheShadowManager->ShadowCubeMapInstancedVertex = (ShaderRecordVertex*)ShaderRecord::LoadShader("ShadowCubeMapInstanced.vso", "Shadows\\", ShaderTemplate{ "ShadowCubeMap.vso", {{"INSTANCED", ""}} });
+
     TheShadowManager->ShadowMapBlurVertex = (ShaderRecordVertex*) ShaderRecord::LoadShader("ShadowMapBlur.vso", "Shadows\\");
     TheShadowManager->ShadowMapBlurPixel = (ShaderRecordPixel*) ShaderRecord::LoadShader("ShadowMapBlur.pso", "Shadows\\");
 
@@ -30,6 +34,8 @@ void ShadowManager::Initialize() {
 	TheShadowManager->ShadowMapVertex->ClearSamplers = false;
 	TheShadowManager->ShadowMapPixel->ClearSamplers = false;
 	TheShadowManager->ShadowCubeMapVertex->ClearSamplers = false;
+	if (TheShadowManager->ShadowMapInstancedVertex) TheShadowManager->ShadowMapInstancedVertex->ClearSamplers = false;
+	if (TheShadowManager->ShadowCubeMapInstancedVertex) TheShadowManager->ShadowCubeMapInstancedVertex->ClearSamplers = false;
 	TheShadowManager->ShadowCubeMapPixel->ClearSamplers = false;
 	TheShadowManager->ShadowMapBlurVertex->ClearSamplers = false;
 	TheShadowManager->ShadowMapBlurPixel->ClearSamplers = false;
@@ -245,21 +251,32 @@ void ShadowManager::RenderShadowMap(ShadowsExteriorEffect::ShadowMapSettings* Sh
 	RenderState->SetRenderState(D3DRS_DEPTHBIAS, (DWORD)0.0f, RenderStateArgs);
 	RenderState->SetRenderState(D3DRS_SLOPESCALEDEPTHBIAS, (DWORD)0.0f, RenderStateArgs);
 
-	if (ShadowMap->Forms.Lod) {
-		AccumChildren(BGSTerrainManager::GetRootLandLODNode(), &ShadowMap->Forms, true, true, &ShadowMap->ShadowMapFrustumPlanes);
-		AccumChildren(BGSTerrainManager::GetRootObjectLODNode(), &ShadowMap->Forms, false, true, &ShadowMap->ShadowMapFrustumPlanes);
-	}
+	{
+		TraceZone Zone("ShadowManager::AccumShadowMap");
 
-	if (Player->GetWorldSpace()) {
-		GridCellArray* CellArray = Tes->gridCellArray;
-		UInt32 CellArraySize = CellArray->size * CellArray->size;
+		if (ShadowMap->Forms.Lod) {
+			AccumChildren(BGSTerrainManager::GetRootLandLODNode(), &ShadowMap->Forms, true, true, &ShadowMap->ShadowMapFrustumPlanes);
+			AccumChildren(BGSTerrainManager::GetRootObjectLODNode(), &ShadowMap->Forms, false, true, &ShadowMap->ShadowMapFrustumPlanes);
+		}
 
-		for (UInt32 i = 0; i < CellArraySize; i++) {
-			AccumExteriorCell(CellArray->GetCell(i), ShadowMap);
+		if (Player->GetWorldSpace()) {
+			GridCellArray* CellArray = Tes->gridCellArray;
+			UInt32 CellArraySize = CellArray->size * CellArray->size;
+
+			for (UInt32 i = 0; i < CellArraySize; i++) {
+				AccumExteriorCell(CellArray->GetCell(i), ShadowMap);
+			}
+		}
+		else {
+			AccumExteriorCell(Player->parentCell, ShadowMap);
+		}
+
+		// refs of all the loaded cells come from the caster cache, already classified and with their bounds up to date for this frame
+		if (!Player->parentCell->IsInterior()) {
+			casterCache.ForEachCaster(&ShadowMap->Forms, &ShadowMap->ShadowMapFrustumPlanes, [this, ShadowMap](NiNode* RefNode) {
+				AccumChildren(RefNode, &ShadowMap->Forms, false, false, &ShadowMap->ShadowMapFrustumPlanes);
+			});
 		}
-	}
-	else {
-		AccumExteriorCell(Player->parentCell, ShadowMap);
 	}
 
 	Device->SetViewport(&ShadowMap->ShadowMapViewPort);
@@ -278,20 +295,19 @@ void ShadowManager::AccumExteriorCell(TESObjectCELL* Cell, ShadowsExteriorEffect
 	
 	if (ShadowMap->Forms.Terrain)
 		AccumChildren(Cell->GetChildNode(TESObjectCELL::kCellNode_Land), &ShadowMap->Forms, true, false, &ShadowMap->ShadowMapFrustumPlanes);
+}
 
-	TList<TESObjectREFR>::Entry* Entry = &Cell->objectList.First;
-	while (Entry) {
-		NiNode* RefNode = GetRefNode(Entry->item, &ShadowMap->Forms);
-
-		if (!RefNode) {
-			Entry = Entry->next;
-			continue;
-		}
-
-		if (RefNode && RefNode->WithinFrustum(&ShadowMap->ShadowMapFrustumPlanes))
-			AccumChildren(RefNode, &ShadowMap->Forms, false, false, &ShadowMap->ShadowMapFrustumPlanes);
 
-		Entry = Entry->next;
+/*
+* Syncs the shadow casters cache with the loaded cells, once per frame before the shadow maps are rendered.
+*/
+void ShadowManager::UpdateCasterCache() {
+	if (Player->GetWorldSpace()) {
+		GridCellArray* CellArray = Tes->gridCellArray;
+		casterCache.Update(CellArray->gridCells, CellArray->size * CellArray->size);
+	}
+	else {
+		casterCache.Update(&Player->parentCell, 1);
 	}
 }
 
@@ -335,26 +351,12 @@ void ShadowManager::RenderShadowSpotlight(NiSpotLight** Lights, UInt32 LightInde
 	D3DXVECTOR3 CameraDirection = D3DXVECTOR3(pNiLight->m_worldTransform.rot.data[0][0], pNiLight->m_worldTransform.rot.data[1][0], pNiLight->m_worldTransform.rot.data[2][0]);
 	D3DXVECTOR3 At = Eye + CameraDirection;
 
-	TList<TESObjectREFR>::Entry* Entry = &Player->parentCell->objectList.First;
-	while (Entry) {
-		NiNode* RefNode = GetRefNode(Entry->item, &Settings->Forms);
-		if (!RefNode) {
-			Entry = Entry->next;
-			continue;
-		}
-
-		// Detect if the object is in front of the light in the direction of the current face
-		// TODO: improve to base on frustum
-		D3DXVECTOR3 ObjectPos = RefNode->m_worldTransform.pos.toD3DXVEC3();
-		D3DXVECTOR3 ObjectToLight = ObjectPos - LightPos->toD3DXVEC3();
-
-		D3DXVec3Normalize(&ObjectToLight, &ObjectToLight);
-		bool inFront = D3DXVec3Dot(&ObjectToLight, &CameraDirection) > 0;
-		if (inFront && RefNode->GetDistance(LightPos) <= Radius + RefNode->GetWorldBoundRadius()) 
-			AccumChildren(RefNode, &Settings->Forms, false, false);
-
-		Entry = Entry->next;
-	}
+	// only the casters intersecting the cone of the light
+	D3DXVECTOR3 ConeDirection;
+	D3DXVec3Normalize(&ConeDirection, &CameraDirection);
+	casterCache.ForEachCasterInCone(&Settings->Forms, *LightPos, NiPoint3(ConeDirection.x, ConeDirection.y, ConeDirection.z), D3DXToRadian(pNiLight->OuterSpotAngle), Radius, [this, Settings](NiNode* RefNode) {
+		AccumChildren(RefNode, &Settings->Forms, false, false);
+	});
 
 	D3DXMatrixLookAtRH(&View, &Eye, &At, &Up);
 	Shadows->Constants.ShadowViewProj = View * Proj;
@@ -482,20 +484,9 @@ void ShadowManager::RenderShadowCubeMap(ShadowSceneLight** Lights, UInt32 LightI
 		}
 		else {
 			// old form based geo accumulation when the one perform by the game has not handled this light
-			TList<TESObjectREFR>::Entry* Entry = &Player->parentCell->objectList.First;
-			while (Entry) {
-				if (NiNode* RefNode = GetRefNode(Entry->item, &Settings->Forms)) {
-					// Detect if the object is in front of the light in the direction of the current face
-					// TODO: improve to base on frustum
-					D3DXVECTOR3 ObjectPos = RefNode->m_worldTransform.pos.toD3DXVEC3();
-					D3DXVECTOR3 ObjectToLight = ObjectPos - LightPos->toD3DXVEC3();
-
-					D3DXVec3Normalize(&ObjectToLight, &ObjectToLight);
-					bool inFront = D3DXVec3Dot(&ObjectToLight, &CameraDirection) > 0;
-					if (RefNode->GetDistance(LightPos) <= Radius + RefNode->GetWorldBoundRadius()) AccumChildren(RefNode, &Settings->Forms, false, false);
-				}
-				Entry = Entry->next;
-			}
+			casterCache.ForEachCasterInSphere(&Settings->Forms, *LightPos, Radius, [this, Settings](NiNode* RefNode) {
+				AccumChildren(RefNode, &Settings->Forms, false, false);
+			});
 		}
 
 
@@ -604,6 +595,8 @@ void ShadowManager::RenderShadowMaps() {
 	if (!Player->parentCell) return;
 
 	auto timer = TimeLogger();
+	static const char* CascadeScopes[MapOrtho] = { "ShadowMap Near", "ShadowMap Middle", "ShadowMap Far", "ShadowMap Lod" };
+	UInt32 GpuScope = TheShaderManager->Profiler.BeginScope("ShadowMaps");
 
 	// prepare some pointers to the device and surfaces
 	IDirect3DDevice9* Device = TheRenderManager->device;
@@ -642,6 +635,10 @@ void ShadowManager::RenderShadowMaps() {
 	// Flag player geometry so we can control if it should be rendered in shadow cubemaps
 	FlagPlayerGeometry();
 
+	auto cacheTimer = TimeLogger();
+	UpdateCasterCache();
+	cacheTimer.LogTime("ShadowManager::UpdateCasterCache");
+
 	// Render directional shadows for Sun/Moon
 	NiNode* PlayerNode = Player->GetNode();
 	D3DXVECTOR3 At;
@@ -661,8 +658,10 @@ void ShadowManager::RenderShadowMaps() {
 		Shadows->GetCascadeDepths();
 
 		geometryPass->VertexShader = ShadowMapVertex;
+		geometryPass->InstancedVertexShader = ShadowMapInstancedVertex;
 		geometryPass->PixelShader = ShadowMapPixel;
 		alphaPass->VertexShader = ShadowMapVertex;
+		alphaPass->InstancedVertexShader = ShadowMapInstancedVertex;
 		alphaPass->PixelShader = ShadowMapPixel;
 		skinnedGeoPass->VertexShader = ShadowMapVertex;
 		skinnedGeoPass->PixelShader = ShadowMapPixel;
@@ -677,6 +676,7 @@ void ShadowManager::RenderShadowMaps() {
 
 			ShadowData->z = 0; // set shader constant to identify other shadow maps
 			auto shadowMapTimer = TimeLogger();
+			TheTextureManager->RestoreTargets(Shadows); // the atlas is released while the exterior shadows are disabled
 
 			if (Shadows->ShadowAtlasSurfaceMSAA)
 				Device->SetRenderTarget(0, Shadows->ShadowAtlasSurfaceMSAA);
@@ -690,7 +690,9 @@ void ShadowManager::RenderShadowMaps() {
 
 				if (!Shadows->Settings.ShadowMaps.LimitFrequency || i != MapLod || !(FrameCounter % 4)) {
 					Shadows->Constants.ShadowViewProj = Shadows->GetCascadeViewProj(ShadowMap, &SunDir);
+					UInt32 CascadeScope = TheShaderManager->Profiler.BeginScope(CascadeScopes[i]);
 					RenderShadowMap(ShadowMap, &Shadows->Constants.ShadowViewProj);
+					TheShaderManager->Profiler.EndScope(CascadeScope);
 				}
 				else {
 					// We need to update the shadowprojmatrix of MapLod by the camera translation between frames to avoid jumps in the shadows.
@@ -733,7 +735,9 @@ void ShadowManager::RenderShadowMaps() {
 				D3DXVECTOR3 OrthoDir = D3DXVECTOR3(0.05f, 0.05f, 1.0f);
 				Shadows->Constants.ShadowViewProj = Shadows->GetCascadeViewProj(ShadowMap, &OrthoDir);
 
+				UInt32 OrthoScope = TheShaderManager->Profiler.BeginScope("ShadowMap Ortho");
 				RenderShadowMap(ShadowMap, &Shadows->Constants.ShadowViewProj);
+				TheShaderManager->Profiler.EndScope(OrthoScope);
 			}
 			else {
 				D3DXVECTOR3 newCameraTranslation = WorldSceneGraph->camera->m_worldTransform.pos.toD3DXVEC3();
@@ -756,8 +760,10 @@ void ShadowManager::RenderShadowMaps() {
 
 	AlphaEnabled = ShadowsInteriors->Forms.AlphaEnabled;
 	geometryPass->VertexShader = ShadowCubeMapVertex;
+	geometryPass->InstancedVertexShader = ShadowCubeMapInstancedVertex;
 	geometryPass->PixelShader = ShadowCubeMapPixel;
 	alphaPass->VertexShader = ShadowCubeMapVertex;
+	alphaPass->InstancedVertexShader = ShadowCubeMapInstancedVertex;
 	alphaPass->PixelShader = ShadowCubeMapPixel;
 	skinnedGeoPass->VertexShader = ShadowCubeMapVertex;
 	skinnedGeoPass->PixelShader = ShadowCubeMapPixel;
@@ -770,7 +776,9 @@ void ShadowManager::RenderShadowMaps() {
 		for (int i = 0; i < ShadowsInteriors->LightPoints; i++) {
 
 			// Render targets set in function due to rendering multiple faces.
+			UInt32 CubeMapScope = TheShaderManager->Profiler.BeginScope("ShadowCubeMaps");
 			RenderShadowCubeMap(ShadowLights, i);
+			TheShaderManager->Profiler.EndScope(CubeMapScope);
 
 			std::string message = "ShadowManager::RenderShadowCubeMap ";
 			message += std::to_string(i);
@@ -785,7 +793,9 @@ void ShadowManager::RenderShadowMaps() {
 			if (!SpotLights[i] || SpotLights[i]->Spec.r == 0) continue; //bypass lights with no radius
 
 			// Render targets set in function.
+			UInt32 SpotLightScope = TheShaderManager->Profiler.BeginScope("ShadowSpotLights");
 			RenderShadowSpotlight(SpotLights, i);
+			TheShaderManager->Profiler.EndScope(SpotLightScope);
 
 			std::string message = "ShadowManager::RenderShadowSpotLight";
 			message += std::to_string(i);
@@ -818,6 +828,7 @@ void ShadowManager::RenderShadowMaps() {
 		}
 	}
 
+	TheShaderManager->Profiler.EndScope(GpuScope);
 	Device->EndScene();
 
 	FrameCounter = (FrameCounter + 1) % 4;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ShadowCasterCache.h"
 
 class ShadowManager { // Never disposed
 public:
@@ -20,6 +21,7 @@ public:
 	void					RenderAccums();
 	void					RenderShadowMap(ShadowsExteriorEffect::ShadowMapSettings* ShadowMap, D3DXMATRIX* ViewProj);
 	void					AccumExteriorCell(TESObjectCELL* Cell, ShadowsExteriorEffect::ShadowMapSettings* ShadowMap);
+	void					UpdateCasterCache();
 	void					RenderShadowCubeMap(ShadowSceneLight** Lights, UInt32 LightIndex);
 	void					RenderShadowSpotlight(NiSpotLight** Lights, UInt32 LightIndex);
 	void					RenderShadowMaps();
@@ -31,12 +33,15 @@ public:
 	SkinnedGeoShadowRenderPass*		skinnedGeoPass;
 	SpeedTreeShadowRenderPass*		speedTreePass;
 	TerrainLODPass*					terrainLODPass;
+	ShadowCasterCache				casterCache;
 
 	NiVector4				BillboardRight;
 	NiVector4				BillboardUp;
 	ShaderRecordVertex*		ShadowMapVertex;
+	ShaderRecordVertex*		ShadowMapInstancedVertex;
 	ShaderRecordPixel*		ShadowMapPixel;
 	ShaderRecordVertex*		ShadowCubeMapVertex;
+	ShaderRecordVertex*		ShadowCubeMapInstancedVertex;
 	ShaderRecordPixel*		ShadowCubeMapPixel;
 	ShaderRecordVertex*		ShadowMapBlurVertex;
 	ShaderRecordPixel*		ShadowMapBlurPixel;
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <spirv-headers/spirv.h>
+
+/*
+* What is known of an id after the declarations: the instruction declaring it and the decorations applied to it.
+*/
+struct SpirvId {
+	SpvOp					Op;
+	std::vector<UInt32>		Operands;	// operands after the result id (after the result type and id for constants and variables)
+	std::string				Name;
+	UInt32					Set;
+	UInt32					Binding;
+	bool					HasBinding;
+	bool					NonWritable;
+	bool					Block;
+	bool					BufferBlock;
+	bool					WorkgroupSize;
+	UInt32					ArrayStride;
+	std::vector<UInt32>		MemberOffsets;
+	std::vector<UInt32>		MemberMatrixStrides;
+	std::vector<bool>		MemberNonWritable;
+};
+
+static std::string ReadString(const uint32_t* Words, size_t WordsCount) {
+
+	const char* Text = (const char*)Words;
+	return std::string(Text, strnlen(Text, WordsCount * sizeof(uint32_t)));
+
+}
+
+static void ResizeMembers(SpirvId* Id, UInt32 Member) {
+
+	if (Id->MemberOffsets.size() > Member) return;
+	Id->MemberOffsets.resize(Member + 1, 0);
+	Id->MemberMatrixStrides.resize(Member + 1, 0);
+	Id->MemberNonWritable.resize(Member + 1, false);
+
+}
+
+/*
+* Computes the size in bytes of a type. Returns false if the type refers to an id out of the bound,
+* misses an operand or nests deeper than any valid shader (a cycle).
+*/
+static bool GetTypeSize(const std::vector<SpirvId>& Ids, UInt32 Type, UInt32* Size, UInt32 MatrixStride = 0, UInt32 Depth = 0) {
+
+	if (Type >= Ids.size() || Depth > 64) return false;
+
+	const SpirvId& Id = Ids[Type];
+	UInt32 ElementSize = 0;
+	*Size = 0;
+
+	switch (Id.Op) {
+		case SpvOpTypeInt:
+		case SpvOpTypeFloat:
+			if (Id.Operands.size() < 1) return false;
+			*Size = Id.Operands[0] / 8;
+			return true;
+		case SpvOpTypeBool:
+			*Size = 4;
+			return true;
+		case SpvOpTypeVector:
+			if (Id.Operands.size() < 2 || !GetTypeSize(Ids, Id.Operands[0], &ElementSize, 0, Depth + 1)) return false;
+			*Size = Id.Operands[1] * ElementSize;
+			return true;
+		case SpvOpTypeMatrix:
+			if (Id.Operands.size() < 2) return false;
+			if (!MatrixStride && !GetTypeSize(Ids, Id.Operands[0], &ElementSize, 0, Depth + 1)) return false;
+			*Size = Id.Operands[1] * (MatrixStride ? MatrixStride : ElementSize);
+			return true;
+		case SpvOpTypeArray: {
+			if (Id.Operands.size() < 2 || Id.Operands[1] >= Ids.size()) return false;
+			const SpirvId& Length = Ids[Id.Operands[1]];
+			UInt32 Count = (Length.Op == SpvOpConstant && Length.Operands.size() > 1) ? Length.Operands[1] : 1;
+			if (!Id.ArrayStride && !GetTypeSize(Ids, Id.Operands[0], &ElementSize, MatrixStride, Depth + 1)) return false;
+			*Size = Count * (Id.ArrayStride ? Id.ArrayStride : ElementSize);
+			return true;
+		}
+		case SpvOpTypeStruct:
+			for (UInt32 m = 0; m < Id.Operands.size(); m++) {
+				UInt32 Offset = m < Id.MemberOffsets.size() ? Id.MemberOffsets[m] : *Size;
+				UInt32 Stride = m < Id.MemberMatrixStrides.size() ? Id.MemberMatrixStrides[m] : 0;
+				if (!GetTypeSize(Ids, Id.Operands[m], &ElementSize, Stride, Depth + 1)) return false;
+				*Size = max(*Size, Offset + ElementSize);
+			}
+			return true;
+		default:
+			return true;
+	}
+
+}
+
+/*
+* Fills Layout with the resources, push constants and work group size of the GLCompute entry point.
+* Returns false if the code isn't valid SPIR-V, has no compute entry point, or an instruction misses the operands it is read for.
+*/
+bool SpirvReflection::Reflect(const uint32_t* Code, size_t WordsCount, SpirvLayout* Layout) {
+
+	Layout->Bindings.clear();
+	Layout->SetsCount = 0;
+	Layout->PushConstantSize = 0;
+	Layout->LocalSize[0] = Layout->LocalSize[1] = Layout->LocalSize[2] = 1;
+	Layout->EntryPoint.clear();
+
+	if (WordsCount < 5 || Code[0] != SpvMagicNumber) return false;
+
+	UInt32 Bound = Code[3];
+	if (Bound > WordsCount) return false; // every id is declared by an instruction, a larger bound is corrupt
+
+	std::vector<SpirvId> Ids(Bound);
+	std::vector<UInt32> Variables;
+	UInt32 EntryId = 0;
+
+	for (size_t Offset = 5; Offset < WordsCount;) {
+		UInt32 Count = Code[Offset] >> 16;
+		SpvOp Op = (SpvOp)(Code[Offset] & 0xFFFF);
+		const uint32_t* Args = Code + Offset + 1;
+		UInt32 ArgsCount = Count - 1;
+
+		if (!Count || Offset + Count > WordsCount) return false;
+		Offset += Count;
+
+		switch (Op) {
+			case SpvOpName:
+				if (ArgsCount >= 1 && Args[0] < Bound) Ids[Args[0]].Name = ReadString(Args + 1, ArgsCount - 1);
+				break;
+			case SpvOpEntryPoint:
+				if (ArgsCount >= 3 && Args[0] == SpvExecutionModelGLCompute && !EntryId) {
+					EntryId = Args[1];
+					Layout->EntryPoint = ReadString(Args + 2, ArgsCount - 2);
+				}
+				break;
+			case SpvOpExecutionMode:
+				if (ArgsCount >= 5 && Args[1] == SpvExecutionModeLocalSize && Args[0] == EntryId) {
+					Layout->LocalSize[0] = Args[2];
+					Layout->LocalSize[1] = Args[3];
+					Layout->LocalSize[2] = Args[4];
+				}
+				break;
+			case SpvOpDecorate: {
+				if (ArgsCount < 2 || Args[0] >= Bound) break;
+				SpirvId* Id = &Ids[Args[0]];
+				switch (Args[1]) {
+					case SpvDecorationDescriptorSet:
+					case SpvDecorationBinding:
+					case SpvDecorationArrayStride:
+					case SpvDecorationBuiltIn:
+						if (ArgsCount < 3) return false;
+						break;
+				}
+				switch (Args[1]) {
+					case SpvDecorationDescriptorSet: Id->Set = Args[2]; break;
+					case SpvDecorationBinding: Id->Binding = Args[2]; Id->HasBinding = true; break;
+					case SpvDecorationNonWritable: Id->NonWritable = true; break;
+					case SpvDecorationBlock: Id->Block = true; break;
+					case SpvDecorationBufferBlock: Id->BufferBlock = true; break;
+					case SpvDecorationArrayStride: Id->ArrayStride = Args[2]; break;
+					case SpvDecorationBuiltIn: Id->WorkgroupSize = Args[2] == SpvBuiltInWorkgroupSize; break;
+				}
+				break;
+			}
+			case SpvOpMemberDecorate: {
+				if (ArgsCount < 3 || Args[0] >= Bound) break;
+				if (Args[1] >= WordsCount) return false; // more members than the module has words
+				if ((Args[2] == SpvDecorationOffset || Args[2] == SpvDecorationMatrixStride) && ArgsCount < 4) return false;
+				SpirvId* Id = &Ids[Args[0]];
+				ResizeMembers(Id, Args[1]);
+				switch (Args[2]) {
+					case SpvDecorationOffset: Id->MemberOffsets[Args[1]] = Args[3]; break;
+					case SpvDecorationMatrixStride: Id->MemberMatrixStrides[Args[1]] = Args[3]; break;
+					case SpvDecorationNonWritable: Id->MemberNonWritable[Args[1]] = true; break;
+				}
+				break;
+			}
+			case SpvOpTypeBool:
+			case SpvOpTypeInt:
+			case SpvOpTypeFloat:
+			case SpvOpTypeVector:
+			case SpvOpTypeMatrix:
+			case SpvOpTypeImage:
+			case SpvOpTypeSampler:
+			case SpvOpTypeSampledImage:
+			case SpvOpTypeArray:
+			case SpvOpTypeRuntimeArray:
+			case SpvOpTypeStruct:
+			case SpvOpTypePointer:
+				if (ArgsCount >= 1 && Args[0] < Bound) {
+					Ids[Args[0]].Op = Op;
+					Ids[Args[0]].Operands.assign(Args + 1, Args + ArgsCount);
+				}
+				break;
+			case SpvOpConstant:
+			case SpvOpConstantComposite:
+			case SpvOpVariable:
+				if (ArgsCount >= 2 && Args[1] < Bound) {
+					Ids[Args[1]].Op = Op;
+					Ids[Args[1]].Operands.assign(Args, Args + ArgsCount);
+					Ids[Args[1]].Operands.erase(Ids[Args[1]].Operands.begin() + 1); // result type, then the operands
+					if (Op == SpvOpVariable) Variables.push_back(Args[1]);
+				}
+				break;
+			case SpvOpFunction:
+				Offset = WordsCount; // only declarations precede the first function
+				break;
+			default:
+				break;
+		}
+	}
+	if (!EntryId) return false;
+
+	for (UInt32 i = 0; i < Bound; i++) {
+		const SpirvId& Id = Ids[i];
+		if (Id.Op != SpvOpConstantComposite || !Id.WorkgroupSize || Id.Operands.size() < 4) continue;
+		for (UInt32 c = 0; c < 3; c++) {
+			if (Id.Operands[c + 1] >= Bound) return false;
+			const SpirvId& Component = Ids[Id.Operands[c + 1]];
+			if (Component.Op == SpvOpConstant && Component.Operands.size() > 1) Layout->LocalSize[c] = Component.Operands[1];
+		}
+	}
+
+	for (UInt32 VariableId : Variables) {
+		const SpirvId& Variable = Ids[VariableId];
+		if (Variable.Operands.size() < 2 || Variable.Operands[0] >= Bound) return false; // result type and storage class
+		const SpirvId& Pointer = Ids[Variable.Operands[0]];
+		if (Pointer.Op != SpvOpTypePointer || Pointer.Operands.size() < 2) continue;
+
+		SpvStorageClass Storage = (SpvStorageClass)Variable.Operands[1];
+		UInt32 TypeId = Pointer.Operands[1];
+		if (TypeId >= Bound) return false;
+
+		if (Storage == SpvStorageClassPushConstant) {
+			UInt32 Size = 0;
+			if (!GetTypeSize(Ids, TypeId, &Size)) return false;
+			Layout->PushConstantSize = max(Layout->PushConstantSize, Size);
+			continue;
+		}
+		if (!Variable.HasBinding) continue;
+
+		SpirvBinding Binding = {};
+		Binding.Set = Variable.Set;
+		Binding.Binding = Variable.Binding;
+		Binding.Count = 1;
+		Binding.Name = Variable.Name;
+
+		if (Ids[TypeId].Op == SpvOpTypeArray) {
+			if (Ids[TypeId].Operands.size() < 2 || Ids[TypeId].Operands[1] >= Bound) return false;
+			const SpirvId& Length = Ids[Ids[TypeId].Operands[1]];
+			if (Length.Op == SpvOpConstant && Length.Operands.size() > 1) Binding.Count = Length.Operands[1];
+			TypeId = Ids[TypeId].Operands[0];
+		}
+		else if (Ids[TypeId].Op == SpvOpTypeRuntimeArray) {
+			if (Ids[TypeId].Operands.size() < 1) return false;
+			TypeId = Ids[TypeId].Operands[0];
+		}
+		if (TypeId >= Bound) return false;
+
+		const SpirvId& Type = Ids[TypeId];
+		switch (Type.Op) {
+			case SpvOpTypeImage: {
+				if (Type.Operands.size() < 6) return false; // sampled type, dim, depth, arrayed, MS, sampled
+				bool StorageImage = Type.Operands[5] == 2;
+				if (Type.Operands[1] == SpvDimBuffer)
+					Binding.Type = StorageImage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				else
+					Binding.Type = StorageImage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				Binding.Writable = StorageImage && !Variable.NonWritable;
+				break;
+			}
+			case SpvOpTypeSampledImage:
+				Binding.Type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				break;
+			case SpvOpTypeSampler:
+				Binding.Type = VK_DESCRIPTOR_TYPE_SAMPLER;
+				break;
+			case SpvOpTypeStruct:
+				if (Storage == SpvStorageClassStorageBuffer || Type.BufferBlock) {
+					Binding.Type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					Binding.Writable = !Variable.NonWritable && (Type.MemberNonWritable.size() < Type.Operands.size() || std::find(Type.MemberNonWritable.begin(), Type.MemberNonWritable.end(), false) != Type.MemberNonWritable.end());
+				}
+				else {
+					Binding.Type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				}
+				if (Binding.Name.empty()) Binding.Name = Type.Name;
+				break;
+			default:
+				continue;
+		}
+		Layout->Bindings.push_back(Binding);
+		Layout->SetsCount = max(Layout->SetsCount, Binding.Set + 1);
+	}
+
+	std::sort(Layout->Bindings.begin(), Layout->Bindings.end(), [](const SpirvBinding& A, const SpirvBinding& B) {
+		return A.Set != B.Set ? A.Set < B.Set : A.Binding < B.Binding;
+	});
+	return true;
+
+}
+
+
+const SpirvBinding* SpirvReflection::FindBinding(const SpirvLayout* Layout, const char* Name) {
+
+	for (const SpirvBinding& Binding : Layout->Bindings) {
+		if (Binding.Name == Name) return &Binding;
+	}
+	return NULL;
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "VkDispatch.h"
+
+/*
+* A resource declared by a compute shader.
+*/
+struct SpirvBinding {
+	UInt32				Set;
+	UInt32				Binding;
+	VkDescriptorType	Type;
+	UInt32				Count;		// array size, 1 for a single resource
+	bool				Writable;	// storage resource not declared readonly
+	std::string			Name;		// variable name, or block name for the unnamed buffers
+};
+
+/*
+* Layout of a compute shader, reflected from its SPIR-V to create the descriptor set and pipeline layouts.
+*/
+struct SpirvLayout {
+	std::vector<SpirvBinding>	Bindings;			// sorted by set and binding
+	UInt32						SetsCount;			// highest set used + 1
+	UInt32						PushConstantSize;	// bytes, 0 without a push constant block
+	UInt32						LocalSize[3];		// work group size
+	std::string					EntryPoint;
+};
+
+/*
+* Minimal SPIR-V reader, only the declarations are parsed: decorations, types, constants and module scope variables.
+* It has no dependency on Vulkan functions or D3D, so it also runs outside of the game.
+*/
+class SpirvReflection {
+public:
+	static bool			Reflect(const uint32_t* Code, size_t WordsCount, SpirvLayout* Layout);	// SPIR-V words, as LoadSpirv reads them
+	static const SpirvBinding* FindBinding(const SpirvLayout* Layout, const char* Name);
+};
@@ -22,90 +22,51 @@ void TestVkShader::InitCompute(IDirect3DDevice9* InD3D9Device)
 
     VkDispatch::InitVulkanFunctionPointers(ComputeContext.Instance, ComputeContext.Device);
 
-    Logger::Log("TestVkShader initialized using device: %d", ComputeContext.Device);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelInfo, "TestVkShader initialized using device: %d", ComputeContext.Device);
 
-    Logger::Log("Trying to LoadSpirv()");
-    auto spirv = LoadSpirv("Data\\Shaders\\NewVegasReloaded\\Shaders\\SolidColor.comp.spv");
-    if (spirv.empty()) {
-        // handle error (file missing, etc.)
-        Logger::Log("Could not load SPIR-V shader file");
-        return;
-    }
+    // Command pool for the queue we'll use
+    VkCommandPoolCreateInfo cpPoolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    cpPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cpPoolInfo.queueFamilyIndex = ComputeContext.FamilyIndex;
+    VK_CHECK(p_vkCreateCommandPool(ComputeContext.Device, &cpPoolInfo, nullptr, &ComputeContext.cmdPool), "p_vkCreateCommandPool");
 
-    const uint32_t* spirvData = spirv.data();
-    size_t          spirvSizeBytes = spirv.size() * sizeof(uint32_t);
+    // Submissions in flight: a command buffer, a fence and a descriptor pool each
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 256 },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 256 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 256 },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 64 },
+    };
+    VkDescriptorPoolCreateInfo dpInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    dpInfo.maxSets = 128;
+    dpInfo.poolSizeCount = sizeof(poolSizes) / sizeof(*poolSizes);
+    dpInfo.pPoolSizes = poolSizes;
 
-    // 1) Shader module (SPIR-V from your AO compute shader)
-    VkShaderModuleCreateInfo smInfo{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-    smInfo.codeSize = spirvSizeBytes;
-    smInfo.pCode = spirvData;
+    VkCommandBufferAllocateInfo cbAlloc{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    cbAlloc.commandPool = ComputeContext.cmdPool;
+    cbAlloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cbAlloc.commandBufferCount = 1;
 
-    Logger::Log("Trying to call p_vkCreateShaderModule()");
-    if (!p_vkCreateShaderModule)
-    {
-        Logger::Log("p_vkCreateShaderModule() is invalid");
-    }
-    else
-    {
-        Logger::Log("p_vkCreateShaderModule() is valid");
+    VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    for (uint32_t i = 0; i < FramesCount; i++) {
+        VK_CHECK(p_vkCreateDescriptorPool(ComputeContext.Device, &dpInfo, nullptr, &Frames[i].DescriptorPool), "p_vkCreateDescriptorPool");
+        VK_CHECK(p_vkAllocateCommandBuffers(ComputeContext.Device, &cbAlloc, &Frames[i].CommandBuffer), "p_vkAllocateCommandBuffers");
+        VK_CHECK(p_vkCreateFence(ComputeContext.Device, &fenceInfo, nullptr, &Frames[i].Fence), "p_vkCreateFence");
     }
-    VK_CHECK(p_vkCreateShaderModule(ComputeContext.Device, &smInfo, nullptr, &ComputeContext.shader), "p_vkCreateShaderModule");
-    Logger::Log("Successfully called p_vkCreateShaderModule()");
-
-    // 2) Descriptor set layout: binding 0 = storage image
-    VkDescriptorSetLayoutBinding binding{};
-    binding.binding = 0;
-    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    binding.descriptorCount = 1;
-    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    VkDescriptorSetLayoutCreateInfo dslInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-    dslInfo.bindingCount = 1;
-    dslInfo.pBindings = &binding;
-    VK_CHECK(p_vkCreateDescriptorSetLayout(ComputeContext.Device, &dslInfo, nullptr, &ComputeContext.descSetLayout), "p_vkCreateDescriptorSetLayout");
-
-    // 3) Pipeline layout
-    // Describe the push constant block:
-    VkPushConstantRange pcRange{};
-    pcRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    pcRange.offset = 0;          // first byte
-    pcRange.size = sizeof(float) * 4;  // vec4 = 16 bytes
-    VkPipelineLayoutCreateInfo plInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-    plInfo.setLayoutCount = 1;
-    plInfo.pSetLayouts = &ComputeContext.descSetLayout;
-    plInfo.pushConstantRangeCount = 1;
-    plInfo.pPushConstantRanges = &pcRange;
-    VK_CHECK(p_vkCreatePipelineLayout(ComputeContext.Device, &plInfo, nullptr, &ComputeContext.pipelineLayout), "p_vkCreatePipelineLayout");
-
-    // 4) Compute pipeline
-    VkPipelineShaderStageCreateInfo stage{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
-    stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    stage.module = ComputeContext.shader;
-    stage.pName = "main"; // entry point
-
-    VkComputePipelineCreateInfo cpInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
-    cpInfo.stage = stage;
-    cpInfo.layout = ComputeContext.pipelineLayout;
-    VK_CHECK(p_vkCreateComputePipelines(ComputeContext.Device, VK_NULL_HANDLE, 1, &cpInfo, nullptr, &ComputeContext.pipeline), "p_vkCreateComputePipelines");
-
-    // 5) Descriptor pool (just some storage image descriptors)
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    poolSize.descriptorCount = 64; // enough for multiple frames
 
-    VkDescriptorPoolCreateInfo dpInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-    dpInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    dpInfo.maxSets = 64;
-    dpInfo.poolSizeCount = 1;
-    dpInfo.pPoolSizes = &poolSize;
-    VK_CHECK(p_vkCreateDescriptorPool(ComputeContext.Device, &dpInfo, nullptr, &ComputeContext.descPool),
-        "vkCreateDescriptorPool");
-
-    // 6) Command pool for the queue well use
-    VkCommandPoolCreateInfo cpPoolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-    cpPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    cpPoolInfo.queueFamilyIndex = ComputeContext.FamilyIndex;
-    VK_CHECK(p_vkCreateCommandPool(ComputeContext.Device, &cpPoolInfo, nullptr, &ComputeContext.cmdPool), "p_vkCreateCommandPool");
+    // Sampler for the sampled images
+    VkSamplerCreateInfo samplerInfo{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VK_CHECK(p_vkCreateSampler(ComputeContext.Device, &samplerInfo, nullptr, &ComputeContext.linearSampler), "p_vkCreateSampler");
+
+    p_vkGetPhysicalDeviceProperties(ComputeContext.PhysicalDevice, &ComputeContext.Properties);
+    LoadPipelineCache();
 }
 
 VkImageView TestVkShader::GetOrCreateViewForImage(VkImage image, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers)
@@ -133,146 +94,362 @@ VkImageView TestVkShader::GetOrCreateViewForImage(VkImage image, VkFormat format
 
 void TestVkShader::RunCompute(IDirect3DSurface9* InD3D9Surface)
 {
-    Logger::Log("Running compute with Device: %d, Queue: %d, QueueIndex: %d, FamilyIndex: %d, Instance: %d, PhysicalDevice: %d,", ComputeContext.Device, ComputeContext.Queue, ComputeContext.QueueIndex, ComputeContext.FamilyIndex, ComputeContext.Instance, ComputeContext.PhysicalDevice);
+    ComputePipeline* Pipeline = GetPipeline("SolidColor");
+    if (!Pipeline->Valid) return;
 
-    dxvk::Com<ID3D9VkInteropTexture> VkTexture;
-    InD3D9Surface->QueryInterface(__uuidof(ID3D9VkInteropTexture), (void**)&VkTexture);
+    D3DSURFACE_DESC Desc;
+    InD3D9Surface->GetDesc(&Desc);
 
-    VulkanImageData NewImageData{};
-    VkTexture->GetVulkanImageInfo(&NewImageData.Image, &NewImageData.ImageLayout, &NewImageData.ImageCreateInfo);
+    PushData pc{};
+    pc.color[0] = 0.0f;  // R
+    pc.color[1] = 1.0f;  // G
+    pc.color[2] = 1.0f;  // B
+    pc.color[3] = 1.0f;  // A
 
-    VkImageSubresourceRange Range{};
-    Range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    Range.baseMipLevel = 0;
-    Range.levelCount = NewImageData.ImageCreateInfo.mipLevels;
-    Range.baseArrayLayer = 0;
-    Range.layerCount = NewImageData.ImageCreateInfo.arrayLayers;
+    ComputeResource Output = { "outImage", InD3D9Surface };
+    ComputeDispatch Dispatch = { Pipeline, &Output, 1, &pc, sizeof(pc),
+        { GetGroupCount(Desc.Width, Pipeline->Layout.LocalSize[0]), GetGroupCount(Desc.Height, Pipeline->Layout.LocalSize[1]), 1 } };
+    Submit(&Dispatch, 1);
+}
 
-    ComputeContext.VulkanDevice->LockSubmissionQueue();
+/*
+ * Gets a compute pipeline by name, loading it on the first call. A pipeline that failed to load stays invalid.
+ */
+ComputePipeline* TestVkShader::GetPipeline(const char* Name)
+{
+    auto it = Pipelines.find(Name);
+    if (it != Pipelines.end())
+        return it->second;
 
-    VkImageLayout originalLayout = NewImageData.ImageLayout;
-    VkImageLayout computeLayout = VK_IMAGE_LAYOUT_GENERAL;
+    ComputePipeline* Pipeline = new ComputePipeline();
+    Pipeline->Name = Name;
+    Pipelines[Name] = Pipeline;
 
-    ComputeContext.VulkanDevice->TransitionTextureLayout(VkTexture.ptr(), &Range,
-        originalLayout,
-        computeLayout);
+    auto timer = TimeLogger();
+    Pipeline->Valid = CreatePipeline(Pipeline);
+    if (Pipeline->Valid) SavePipelineCache();
+    timer.LogTime("TestVkShader::GetPipeline");
+    return Pipeline;
+}
+
+bool TestVkShader::CreatePipeline(ComputePipeline* Pipeline)
+{
+    const char* Name = Pipeline->Name.c_str();
+    if (!ComputeContext.Device) return false;
+
+    std::string Path = std::string(ShadersPath) + Pipeline->Name + ".comp.spv";
+    std::vector<uint32_t> Spirv = LoadSpirv(Path.c_str());
+    if (Spirv.empty() || !SpirvReflection::Reflect(Spirv.data(), Spirv.size(), &Pipeline->Layout)) {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Compute pipeline %s: %s is not a valid compute shader", Name, Path.c_str());
+        return false;
+    }
 
+    // only images and samplers can be bound from D3D9 resources
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> SetBindings(Pipeline->Layout.SetsCount);
+    for (const SpirvBinding& Binding : Pipeline->Layout.Bindings) {
+        if (Binding.Count != 1 || (Binding.Type != VK_DESCRIPTOR_TYPE_STORAGE_IMAGE && Binding.Type != VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE &&
+            Binding.Type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && Binding.Type != VK_DESCRIPTOR_TYPE_SAMPLER)) {
+            Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Compute pipeline %s: unsupported resource %s (type %d, count %u)", Name, Binding.Name.c_str(), Binding.Type, Binding.Count);
+            return false;
+        }
+        VkDescriptorSetLayoutBinding LayoutBinding{};
+        LayoutBinding.binding = Binding.Binding;
+        LayoutBinding.descriptorType = Binding.Type;
+        LayoutBinding.descriptorCount = 1;
+        LayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        SetBindings[Binding.Set].push_back(LayoutBinding);
+    }
 
-    VkImageView view = GetOrCreateViewForImage(
-        NewImageData.Image,
-        NewImageData.ImageCreateInfo.format,
-        NewImageData.ImageCreateInfo.mipLevels,
-        NewImageData.ImageCreateInfo.arrayLayers
-    );
+    VkShaderModuleCreateInfo smInfo{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    smInfo.codeSize = Spirv.size() * sizeof(uint32_t);
+    smInfo.pCode = Spirv.data();
+    if (p_vkCreateShaderModule(ComputeContext.Device, &smInfo, nullptr, &Pipeline->Shader) != VK_SUCCESS) return false;
+
+    Pipeline->SetLayouts.resize(Pipeline->Layout.SetsCount);
+    for (uint32_t s = 0; s < Pipeline->Layout.SetsCount; s++) {
+        VkDescriptorSetLayoutCreateInfo dslInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        dslInfo.bindingCount = SetBindings[s].size();
+        dslInfo.pBindings = SetBindings[s].data();
+        if (p_vkCreateDescriptorSetLayout(ComputeContext.Device, &dslInfo, nullptr, &Pipeline->SetLayouts[s]) != VK_SUCCESS) return false;
+    }
 
-    // 2) Allocate descriptor set
-    VkDescriptorSetAllocateInfo dsAlloc{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-    dsAlloc.descriptorPool = ComputeContext.descPool;
-    dsAlloc.descriptorSetCount = 1;
-    dsAlloc.pSetLayouts = &ComputeContext.descSetLayout;
+    VkPushConstantRange pcRange{};
+    pcRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pcRange.size = Pipeline->Layout.PushConstantSize;
+    VkPipelineLayoutCreateInfo plInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    plInfo.setLayoutCount = Pipeline->SetLayouts.size();
+    plInfo.pSetLayouts = Pipeline->SetLayouts.data();
+    plInfo.pushConstantRangeCount = pcRange.size ? 1 : 0;
+    plInfo.pPushConstantRanges = &pcRange;
+    if (p_vkCreatePipelineLayout(ComputeContext.Device, &plInfo, nullptr, &Pipeline->PipelineLayout) != VK_SUCCESS) return false;
 
-    VkDescriptorSet descSet;
-    VK_CHECK(p_vkAllocateDescriptorSets(ComputeContext.Device, &dsAlloc, &descSet), "p_vkAllocateDescriptorSets");
+    VkComputePipelineCreateInfo cpInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    cpInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    cpInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    cpInfo.stage.module = Pipeline->Shader;
+    cpInfo.stage.pName = Pipeline->Layout.EntryPoint.c_str();
+    cpInfo.layout = Pipeline->PipelineLayout;
+    if (p_vkCreateComputePipelines(ComputeContext.Device, ComputeContext.pipelineCache, 1, &cpInfo, nullptr, &Pipeline->Pipeline) != VK_SUCCESS) {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Compute pipeline %s: vkCreateComputePipelines failed", Name);
+        return false;
+    }
 
-    // 3) Bind the storage image
-    VkDescriptorImageInfo imgDesc{};
-    imgDesc.imageView = view;
-    imgDesc.imageLayout = VK_IMAGE_LAYOUT_GENERAL; // we ensured this before
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelInfo, "Compute pipeline %s loaded: %u resources, %u bytes of push constants, groups of %ux%ux%u", Name,
+        Pipeline->Layout.Bindings.size(), Pipeline->Layout.PushConstantSize, Pipeline->Layout.LocalSize[0], Pipeline->Layout.LocalSize[1], Pipeline->Layout.LocalSize[2]);
+    return true;
+}
 
-    VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-    write.dstSet = descSet;
-    write.dstBinding = 0;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    write.pImageInfo = &imgDesc;
+/*
+ * The cache is only given to the driver if it was written by the same device and driver.
+ */
+bool TestVkShader::IsPipelineCacheCompatible(const std::vector<char>& Data, const VkPhysicalDeviceProperties& Properties)
+{
+    VkPipelineCacheHeaderVersionOne Header;
+    if (Data.size() < sizeof(Header)) return false;
 
-    p_vkUpdateDescriptorSets(ComputeContext.Device, 1, &write, 0, nullptr);
+    memcpy(&Header, Data.data(), sizeof(Header));
+    return Header.headerSize >= sizeof(Header) && Header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        Header.vendorID == Properties.vendorID && Header.deviceID == Properties.deviceID &&
+        !memcmp(Header.pipelineCacheUUID, Properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
 
-    // 4) Allocate command buffer
-    VkCommandBufferAllocateInfo cbAlloc{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-    cbAlloc.commandPool = ComputeContext.cmdPool;
-    cbAlloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    cbAlloc.commandBufferCount = 1;
+void TestVkShader::LoadPipelineCache()
+{
+    std::vector<char> Data;
+    std::ifstream File(ShadersPath "Cache\\Compute.pipelinecache", std::ios::binary | std::ios::ate);
+    if (File.is_open()) {
+        Data.resize((size_t)File.tellg());
+        File.seekg(0, std::ios::beg);
+        if (!File.read(Data.data(), Data.size())) Data.clear();
+    }
+    if (!Data.empty() && !IsPipelineCacheCompatible(Data, ComputeContext.Properties)) {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelInfo, "Compute pipeline cache discarded, it was written by another device or driver");
+        Data.clear();
+    }
 
-    VkCommandBuffer cmd;
-    VK_CHECK(p_vkAllocateCommandBuffers(ComputeContext.Device, &cbAlloc, &cmd), "p_vkAllocateCommandBuffers");
+    VkPipelineCacheCreateInfo pcInfo{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    pcInfo.initialDataSize = Data.size();
+    pcInfo.pInitialData = Data.data();
+    VK_CHECK(p_vkCreatePipelineCache(ComputeContext.Device, &pcInfo, nullptr, &ComputeContext.pipelineCache), "p_vkCreatePipelineCache");
+}
 
-    // 5) Begin command buffer
-    VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    VK_CHECK(p_vkBeginCommandBuffer(cmd, &beginInfo), "p_vkBeginCommandBuffer");
+void TestVkShader::SavePipelineCache()
+{
+    size_t Size = 0;
+    if (!ComputeContext.pipelineCache || p_vkGetPipelineCacheData(ComputeContext.Device, ComputeContext.pipelineCache, &Size, nullptr) != VK_SUCCESS || !Size) return;
 
-    // 6) Bind compute pipeline + descriptor set
-    p_vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ComputeContext.pipeline);
+    std::vector<char> Data(Size);
+    if (p_vkGetPipelineCacheData(ComputeContext.Device, ComputeContext.pipelineCache, &Size, Data.data()) != VK_SUCCESS) return;
 
-    PushData pc{};
-    pc.color[0] = 0.0f;  // R
-    pc.color[1] = 1.0f;  // G
-    pc.color[2] = 1.0f;  // B
-    pc.color[3] = 1.0f;  // A
-    p_vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
-        ComputeContext.pipelineLayout, 0, 1, &descSet,
-        0, nullptr);
+    CreateDirectoryA(ShadersPath "Cache", NULL);
+    std::ofstream File(ShadersPath "Cache\\Compute.pipelinecache", std::ios::binary | std::ios::trunc);
+    File.write(Data.data(), Size);
+}
 
-    // 7) Dispatch
-    // Choose workgroup size (e.g. 8x8 or 16x16) to match your shader.
-    const uint32_t wgSizeX = 16;
-    const uint32_t wgSizeY = 16;
+/*
+ * Next submission slot. Waiting for its fence only blocks if the GPU is FramesCount submissions late.
+ */
+TestVkShader::ComputeFrame* TestVkShader::BeginFrame()
+{
+    ComputeFrame* Frame = &Frames[FrameIndex];
+    FrameIndex = (FrameIndex + 1) % FramesCount;
+
+    if (!Frame->CommandBuffer) return nullptr;
+    if (Frame->Submitted) {
+        p_vkWaitForFences(ComputeContext.Device, 1, &Frame->Fence, VK_TRUE, UINT64_MAX);
+        p_vkResetFences(ComputeContext.Device, 1, &Frame->Fence);
+        Frame->Submitted = false;
+    }
+    p_vkResetDescriptorPool(ComputeContext.Device, Frame->DescriptorPool, 0);
+    p_vkResetCommandBuffer(Frame->CommandBuffer, 0);
+    return Frame;
+}
 
-    uint32_t groupsX = (NewImageData.ImageCreateInfo.extent.width + wgSizeX - 1) / wgSizeX;
-    uint32_t groupsY = (NewImageData.ImageCreateInfo.extent.height + wgSizeY - 1) / wgSizeY;
-    p_vkCmdPushConstants(cmd, ComputeContext.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushData), &pc);
-    p_vkCmdDispatch(cmd, groupsX, groupsY, NewImageData.ImageCreateInfo.arrayLayers);
+/*
+ * Adds the image behind a D3D9 resource to the images of a submission, returns its index or -1.
+ */
+int TestVkShader::AddImage(std::vector<ComputeImage>& Images, IDirect3DResource9* Resource)
+{
+    dxvk::Com<ID3D9VkInteropTexture> Texture;
+    if (!Resource || FAILED(Resource->QueryInterface(__uuidof(ID3D9VkInteropTexture), (void**)&Texture))) return -1;
 
-    // 8) End command buffer
-    VK_CHECK(p_vkEndCommandBuffer(cmd), "VK_CHECK");
+    VulkanImageData ImageData{};
+    ImageData.ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    if (FAILED(Texture->GetVulkanImageInfo(&ImageData.Image, &ImageData.ImageLayout, &ImageData.ImageCreateInfo)) || !ImageData.Image) return -1;
 
-    // 9) Submit + sync (simple version: wait immediately)
-    VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &cmd;
+    for (int i = 0; i < (int)Images.size(); i++) {
+        if (Images[i].Image == ImageData.Image) return i;
+    }
 
-    VkFence fence = VK_NULL_HANDLE;
-    VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-    VK_CHECK(p_vkCreateFence(ComputeContext.Device, &fenceInfo, nullptr, &fence), "p_vkCreateFence");
+    ComputeImage& Image = Images.emplace_back();
+    Image.Texture = Texture;
+    Image.Image = ImageData.Image;
+    Image.Layout = ImageData.ImageLayout;
+    Image.Range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    Image.Range.levelCount = ImageData.ImageCreateInfo.mipLevels ? ImageData.ImageCreateInfo.mipLevels : 1;
+    Image.Range.layerCount = ImageData.ImageCreateInfo.arrayLayers ? ImageData.ImageCreateInfo.arrayLayers : 1;
+    Image.View = GetOrCreateViewForImage(ImageData.Image, ImageData.ImageCreateInfo.format, Image.Range.levelCount, Image.Range.layerCount);
+    return Images.size() - 1;
+}
 
-    p_vkQueueSubmit(ComputeContext.Queue, 1, &submit, fence);
-    VK_CHECK(p_vkWaitForFences(ComputeContext.Device, 1, &fence, VK_TRUE, UINT64_MAX), "p_vkWaitForFences");
+/*
+ * Records the dispatches in one command buffer and submits it on the DXVK queue.
+ * The images are moved to the general layout on the D3D9 stream, which is flushed so the D3D9 work writing them is queued before the dispatches,
+ * and moved back after the submission. Memory barriers make the D3D9 writes visible to the first dispatch, the writes of a dispatch visible to
+ * the following ones using the same images, and the compute writes visible to the D3D9 work queued afterwards.
+ */
+bool TestVkShader::Submit(const ComputeDispatch* Dispatches, uint32_t Count)
+{
+    if (!ComputeContext.Device || !ComputeContext.VulkanDevice.ptr()) return false;
+
+    std::vector<ComputeImage> Images;
+    std::vector<std::vector<int>> BindingImages(Count); // image of each binding, -1 for the samplers
+
+    for (uint32_t d = 0; d < Count; d++) {
+        const ComputeDispatch& Dispatch = Dispatches[d];
+        if (!Dispatch.Pipeline || !Dispatch.Pipeline->Valid) return false;
+
+        for (const SpirvBinding& Binding : Dispatch.Pipeline->Layout.Bindings) {
+            if (Binding.Type == VK_DESCRIPTOR_TYPE_SAMPLER) {
+                BindingImages[d].push_back(-1);
+                continue;
+            }
+            IDirect3DResource9* Resource = nullptr;
+            for (uint32_t r = 0; r < Dispatch.ResourcesCount; r++) {
+                if (Binding.Name == Dispatch.Resources[r].Name) Resource = Dispatch.Resources[r].Resource;
+            }
+            if (!Resource) {
+                std::string TextureName = Binding.Name;
+                Resource = TheTextureManager->GetTextureByName(TextureName);
+            }
+
+            int Index = AddImage(Images, Resource);
+            if (Index < 0) {
+                Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Compute pipeline %s: no image for %s", Dispatch.Pipeline->Name.c_str(), Binding.Name.c_str());
+                return false;
+            }
+            BindingImages[d].push_back(Index);
+        }
+    }
 
-    p_vkDestroyFence(ComputeContext.Device, fence, nullptr);
+    ComputeFrame* Frame = BeginFrame();
+    if (!Frame) return false;
 
-    p_vkFreeCommandBuffers(ComputeContext.Device, ComputeContext.cmdPool, 1, &cmd);
+    for (ComputeImage& Image : Images) {
+        ComputeContext.VulkanDevice->TransitionTextureLayout(Image.Texture.ptr(), &Image.Range, Image.Layout, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    ComputeContext.VulkanDevice->FlushRenderingCommands();
 
-    p_vkFreeDescriptorSets(ComputeContext.Device, ComputeContext.descPool, 1, &descSet);
+    VkCommandBuffer cmd = Frame->CommandBuffer;
+    VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    p_vkBeginCommandBuffer(cmd, &beginInfo);
+
+    VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    p_vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    std::vector<bool> Written(Images.size(), false); // written since the last barrier
+    std::vector<VkDescriptorImageInfo> ImageInfos;
+    std::vector<VkWriteDescriptorSet> Writes;
+    std::vector<VkDescriptorSet> Sets;
+
+    for (uint32_t d = 0; d < Count; d++) {
+        const ComputeDispatch& Dispatch = Dispatches[d];
+        ComputePipeline* Pipeline = Dispatch.Pipeline;
+        const std::vector<SpirvBinding>& Bindings = Pipeline->Layout.Bindings;
+
+        bool Hazard = false;
+        for (int Index : BindingImages[d]) {
+            if (Index >= 0 && Written[Index]) Hazard = true;
+        }
+        if (Hazard) {
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            p_vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            Written.assign(Images.size(), false);
+        }
+
+        Sets.resize(Pipeline->SetLayouts.size());
+        if (!Sets.empty()) {
+            VkDescriptorSetAllocateInfo dsAlloc{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+            dsAlloc.descriptorPool = Frame->DescriptorPool;
+            dsAlloc.descriptorSetCount = Sets.size();
+            dsAlloc.pSetLayouts = Pipeline->SetLayouts.data();
+            if (p_vkAllocateDescriptorSets(ComputeContext.Device, &dsAlloc, Sets.data()) != VK_SUCCESS) {
+                Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Compute pipeline %s: descriptor pool exhausted", Pipeline->Name.c_str());
+                continue;
+            }
+        }
+
+        ImageInfos.resize(Bindings.size());
+        Writes.resize(Bindings.size());
+        for (uint32_t b = 0; b < Bindings.size(); b++) {
+            int Index = BindingImages[d][b];
+            ImageInfos[b] = {};
+            ImageInfos[b].sampler = ComputeContext.linearSampler;
+            if (Index >= 0) {
+                ImageInfos[b].imageView = Images[Index].View;
+                ImageInfos[b].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                if (Bindings[b].Writable) Written[Index] = true;
+            }
+            Writes[b] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+            Writes[b].dstSet = Sets[Bindings[b].Set];
+            Writes[b].dstBinding = Bindings[b].Binding;
+            Writes[b].descriptorCount = 1;
+            Writes[b].descriptorType = Bindings[b].Type;
+            Writes[b].pImageInfo = &ImageInfos[b];
+        }
+        if (!Writes.empty()) p_vkUpdateDescriptorSets(ComputeContext.Device, Writes.size(), Writes.data(), 0, nullptr);
+
+        p_vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->Pipeline);
+        if (!Sets.empty()) p_vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline->PipelineLayout, 0, Sets.size(), Sets.data(), 0, nullptr);
+        if (Dispatch.PushData && Pipeline->Layout.PushConstantSize)
+            p_vkCmdPushConstants(cmd, Pipeline->PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, min(Dispatch.PushSize, Pipeline->Layout.PushConstantSize), Dispatch.PushData);
+        p_vkCmdDispatch(cmd, Dispatch.Groups[0], Dispatch.Groups[1], Dispatch.Groups[2]);
+    }
 
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    p_vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    p_vkEndCommandBuffer(cmd);
 
-    ComputeContext.VulkanDevice->TransitionTextureLayout(VkTexture.ptr(), &Range,
-        computeLayout,
-        originalLayout);
+    VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &cmd;
 
+    ComputeContext.VulkanDevice->LockSubmissionQueue();
+    VkResult vr = p_vkQueueSubmit(ComputeContext.Queue, 1, &submit, Frame->Fence);
     ComputeContext.VulkanDevice->ReleaseSubmissionQueue();
-    // You can also recycle descriptor sets or just let them accumulate if pool is big enough.
+    Frame->Submitted = vr == VK_SUCCESS;
+    if (vr != VK_SUCCESS) Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Compute submission failed: %d", (int)vr);
+
+    for (ComputeImage& Image : Images) {
+        ComputeContext.VulkanDevice->TransitionTextureLayout(Image.Texture.ptr(), &Image.Range, VK_IMAGE_LAYOUT_GENERAL, Image.Layout);
+    }
+    return Frame->Submitted;
 }
 
 void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
 {
     if (!ComputeContext.Device || !ComputeContext.Queue || !ComputeContext.VulkanDevice.ptr()) {
-        Logger::Log("ClearSurfaceVulkan: missing device/queue/interp");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "ClearSurfaceVulkan: missing device/queue/interp");
         return;
     }
 
-    Logger::Log("ClearSurfaceVulkan on surface=%p", surface);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan on surface=%p", surface);
 
     dxvk::Com<ID3D9VkInteropTexture> vkTex;
     if (FAILED(surface->QueryInterface(__uuidof(ID3D9VkInteropTexture), (void**)&vkTex))) {
-        Logger::Log("ClearSurfaceVulkan: QI ID3D9VkInteropTexture failed");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "ClearSurfaceVulkan: QI ID3D9VkInteropTexture failed");
         return;
     }
 
     VulkanImageData img{};
     vkTex->GetVulkanImageInfo(&img.Image, &img.ImageLayout, &img.ImageCreateInfo);
 
-    Logger::Log("ClearSurfaceVulkan: image=%p, fmt=%d, w=%u, h=%u, layers=%u, usage=0x%08X, layout=%d",
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: image=%p, fmt=%d, w=%u, h=%u, layers=%u, usage=0x%08X, layout=%d",
         img.Image,
         img.ImageCreateInfo.format,
         img.ImageCreateInfo.extent.width,
@@ -282,7 +459,7 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
         img.ImageLayout);
 
     if (img.Image == VK_NULL_HANDLE) {
-        Logger::Log("ClearSurfaceVulkan: null VkImage");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "ClearSurfaceVulkan: null VkImage");
         return;
     }
 
@@ -312,7 +489,7 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
 
     VkCommandBuffer cmd = VK_NULL_HANDLE;
     VkResult vr = p_vkAllocateCommandBuffers(ComputeContext.Device, &cbAlloc, &cmd);
-    Logger::Log("ClearSurfaceVulkan: vkAllocateCommandBuffers -> %d, cmd=%p", (int)vr, cmd);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: vkAllocateCommandBuffers -> %d, cmd=%p", (int)vr, cmd);
     if (vr != VK_SUCCESS || !cmd) {
         ComputeContext.VulkanDevice->TransitionTextureLayout(
             vkTex.ptr(), &range,
@@ -325,7 +502,7 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
     VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     vr = p_vkBeginCommandBuffer(cmd, &beginInfo);
-    Logger::Log("ClearSurfaceVulkan: vkBeginCommandBuffer -> %d", (int)vr);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: vkBeginCommandBuffer -> %d", (int)vr);
     if (vr != VK_SUCCESS) {
         p_vkFreeCommandBuffers(ComputeContext.Device, ComputeContext.cmdPool, 1, &cmd);
         ComputeContext.VulkanDevice->TransitionTextureLayout(
@@ -352,7 +529,7 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
         &range);
 
     vr = p_vkEndCommandBuffer(cmd);
-    Logger::Log("ClearSurfaceVulkan: vkEndCommandBuffer -> %d", (int)vr);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: vkEndCommandBuffer -> %d", (int)vr);
     if (vr != VK_SUCCESS) {
         p_vkFreeCommandBuffers(ComputeContext.Device, ComputeContext.cmdPool, 1, &cmd);
         ComputeContext.VulkanDevice->TransitionTextureLayout(
@@ -370,7 +547,7 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
     VkFence fence = VK_NULL_HANDLE;
     VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
     vr = p_vkCreateFence(ComputeContext.Device, &fenceInfo, nullptr, &fence);
-    Logger::Log("ClearSurfaceVulkan: vkCreateFence -> %d, fence=%p", (int)vr, fence);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: vkCreateFence -> %d, fence=%p", (int)vr, fence);
     if (vr != VK_SUCCESS || !fence) {
         p_vkFreeCommandBuffers(ComputeContext.Device, ComputeContext.cmdPool, 1, &cmd);
         ComputeContext.VulkanDevice->TransitionTextureLayout(
@@ -382,11 +559,11 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
     }
 
     vr = p_vkQueueSubmit(ComputeContext.Queue, 1, &submit, fence);
-    Logger::Log("ClearSurfaceVulkan: vkQueueSubmit -> %d", (int)vr);
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: vkQueueSubmit -> %d", (int)vr);
 
     if (vr == VK_SUCCESS) {
         vr = p_vkWaitForFences(ComputeContext.Device, 1, &fence, VK_TRUE, UINT64_MAX);
-        Logger::Log("ClearSurfaceVulkan: vkWaitForFences -> %d", (int)vr);
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "ClearSurfaceVulkan: vkWaitForFences -> %d", (int)vr);
     }
 
     p_vkDestroyFence(ComputeContext.Device, fence, nullptr);
@@ -403,20 +580,20 @@ void TestVkShader::ClearSurfaceVulkan(IDirect3DSurface9* surface)
 
 std::vector<uint32_t> TestVkShader::LoadSpirv(const char* path)
 {
-    Logger::Log("Trying to get shader file");
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "Trying to get shader file");
     std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (!file)
     {
-        Logger::Log("Could not find valid shader file, returning {}");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Could not find valid shader file, returning {}");
         return {};
     }
 
-    Logger::Log("Got valid shader file");
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "Got valid shader file");
     std::streamsize size = file.tellg();
     file.seekg(0, std::ios::beg);
 
     std::vector<uint32_t> buffer(size / sizeof(uint32_t));
-    Logger::Log("Reading shader file");
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "Reading shader file");
     if (!file.read(reinterpret_cast<char*>(buffer.data()), size))
         return {};
 
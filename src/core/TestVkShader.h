@@ -1,7 +1,39 @@
 #pragma once
 #include "VkDispatch.h"
 #include <com_pointer.h>
-#include <DxvkInterop.h>>
+#include <DxvkInterop.h>
+#include "SpirvReflection.h"
+
+/*
+ * A compute shader loaded from Shaders\<Name>.comp.spv. The descriptor set and pipeline layouts are reflected from its SPIR-V.
+ */
+struct ComputePipeline {
+    std::string Name;
+    SpirvLayout Layout;
+    VkShaderModule Shader = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayout> SetLayouts;
+    VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline Pipeline = VK_NULL_HANDLE;
+    bool Valid = false;
+};
+
+/*
+ * D3D9 texture or surface bound to the shader resource with the given name.
+ * The resources not given are looked up by name in the TextureManager, like the samplers of the effects.
+ */
+struct ComputeResource {
+    const char* Name;
+    IDirect3DResource9* Resource;
+};
+
+struct ComputeDispatch {
+    ComputePipeline* Pipeline;
+    const ComputeResource* Resources;
+    uint32_t ResourcesCount;
+    const void* PushData;
+    uint32_t PushSize;
+    uint32_t Groups[3];
+};
 
 class TestVkShader
 {
@@ -13,12 +45,27 @@ class TestVkShader
         VkQueue Queue = VK_NULL_HANDLE;
         uint32_t FamilyIndex = -1;
         uint32_t QueueIndex = -1;
-        VkPipelineLayout      pipelineLayout = VK_NULL_HANDLE;
-        VkPipeline            pipeline = VK_NULL_HANDLE;
-        VkDescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
-        VkDescriptorPool      descPool = VK_NULL_HANDLE;
         VkCommandPool         cmdPool = VK_NULL_HANDLE;
-        VkShaderModule        shader = VK_NULL_HANDLE;
+        VkPipelineCache       pipelineCache = VK_NULL_HANDLE;
+        VkSampler             linearSampler = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties Properties{};
+    };
+
+    // Command buffer and descriptors of a submission, reused once its fence is signaled
+    struct ComputeFrame {
+        VkCommandBuffer  CommandBuffer = VK_NULL_HANDLE;
+        VkFence          Fence = VK_NULL_HANDLE;
+        VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+        bool             Submitted = false;
+    };
+
+    // D3D9 image used by the dispatches of a submission
+    struct ComputeImage {
+        dxvk::Com<ID3D9VkInteropTexture> Texture;
+        VkImage                 Image = VK_NULL_HANDLE;
+        VkImageLayout           Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageSubresourceRange Range{};
+        VkImageView             View = VK_NULL_HANDLE;
     };
 
     struct PushData {
@@ -39,7 +86,24 @@ public:
     void ClearSurfaceVulkan(IDirect3DSurface9* surface);
     static std::vector<uint32_t> LoadSpirv(const char* path);
 
+    ComputePipeline* GetPipeline(const char* Name);
+    bool Submit(const ComputeDispatch* Dispatches, uint32_t Count);
+    static uint32_t GetGroupCount(uint32_t Size, uint32_t LocalSize) { return (Size + LocalSize - 1) / LocalSize; }
+    static bool IsPipelineCacheCompatible(const std::vector<char>& Data, const VkPhysicalDeviceProperties& Properties);
+
+    static const uint32_t FramesCount = 8;
+
     ShaderComputeContext ComputeContext;
     std::unordered_map<VkImage, VkImageView> VkImageViews;
+    std::unordered_map<std::string, ComputePipeline*> Pipelines;
+    ComputeFrame Frames[FramesCount];
+    uint32_t FrameIndex = 0;
+
+private:
+    bool CreatePipeline(ComputePipeline* Pipeline);
+    void LoadPipelineCache();
+    void SavePipelineCache();
+    ComputeFrame* BeginFrame();
+    int AddImage(std::vector<ComputeImage>& Images, IDirect3DResource9* Resource);
 };
 
@@ -0,0 +1,107 @@
+TextureLoader::TextureLoader() {
+
+	Reading = 0;
+	Stopping = false;
+
+}
+
+
+TextureLoader::~TextureLoader() {
+
+	if (!Worker.joinable()) return;
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Stopping = true;
+	}
+	WorkAvailable.notify_all();
+	Worker.join();
+
+}
+
+
+/*
+* Queues the read of a file. The worker thread starts with the first request.
+*/
+void TextureLoader::Enqueue(const std::string& Path, TextureRecord::TextureRecordType Type) {
+
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Request& Item = Queued.emplace_back();
+		Item.Path = Path;
+		Item.Type = Type;
+		Item.FileType = TextureRecord::TextureRecordType::None;
+		if (!Worker.joinable()) Worker = std::thread(&TextureLoader::WorkerLoop, this);
+	}
+	WorkAvailable.notify_one();
+
+}
+
+
+/*
+* Moves the requests read so far to Output, in the order they completed.
+*/
+void TextureLoader::TakeCompleted(std::deque<Request>* Output) {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	while (!Completed.empty()) {
+		Output->push_back(std::move(Completed.front()));
+		Completed.pop_front();
+	}
+
+}
+
+
+UInt32 TextureLoader::GetPendingCount() {
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	return Queued.size() + Reading + Completed.size();
+
+}
+
+
+/*
+* Gets the kind of texture stored in a DDS file from its header (DDSCAPS2 flags), None if the data isn't a DDS.
+*/
+TextureRecord::TextureRecordType TextureLoader::GetDDSType(const char* Data, size_t Size) {
+
+	static const size_t HeaderSize = 4 + 124; // magic and DDS_HEADER
+	static const size_t Caps2Offset = 4 + 108;
+
+	if (Size < HeaderSize || memcmp(Data, "DDS ", 4) || *(DWORD*)(Data + 4) != 124) return TextureRecord::TextureRecordType::None;
+
+	DWORD Caps2 = *(DWORD*)(Data + Caps2Offset);
+	if (Caps2 & 0x200) return TextureRecord::TextureRecordType::CubeBuffer;		// DDSCAPS2_CUBEMAP
+	if (Caps2 & 0x200000) return TextureRecord::TextureRecordType::VolumeBuffer;	// DDSCAPS2_VOLUME
+	return TextureRecord::TextureRecordType::PlanarBuffer;
+
+}
+
+
+void TextureLoader::WorkerLoop() {
+
+	std::unique_lock<std::mutex> Guard(Lock);
+	while (true) {
+		WorkAvailable.wait(Guard, [this] { return Stopping || !Queued.empty(); });
+		if (Stopping) return;
+
+		Request Item = std::move(Queued.front());
+		Queued.pop_front();
+		Reading++;
+		Guard.unlock();
+
+		TraceZone Zone("TextureLoader::Read");
+		std::ifstream File(Item.Path, std::ios::binary | std::ios::ate);
+		if (File.is_open()) {
+			std::streamsize Size = File.tellg();
+			File.seekg(0, std::ios::beg);
+			Item.Data.resize(Size);
+			if (Size <= 0 || !File.read(Item.Data.data(), Size)) Item.Data.clear();
+		}
+		Item.FileType = GetDDSType(Item.Data.data(), Item.Data.size());
+
+		Guard.lock();
+		Reading--;
+		Completed.push_back(std::move(Item));
+	}
+
+}
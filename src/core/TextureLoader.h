@@ -0,0 +1,41 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+
+/*
+* Reads texture files on a background thread, so effects and shaders don't wait for the disk on the render thread.
+* Only the file is read and its DDS header checked off thread: the device objects are created by the TextureManager on the render thread,
+* when it takes the completed requests at the frame boundary.
+*/
+class TextureLoader {
+public:
+	struct Request {
+		std::string							Path;
+		TextureRecord::TextureRecordType	Type;
+		TextureRecord::TextureRecordType	FileType;	// from the DDS header, None for other formats
+		std::vector<char>					Data;		// empty if the file cannot be read
+	};
+
+	TextureLoader();
+	~TextureLoader();
+
+	void					Enqueue(const std::string& Path, TextureRecord::TextureRecordType Type);
+	void					TakeCompleted(std::deque<Request>* Output);
+	UInt32					GetPendingCount();
+
+	static TextureRecord::TextureRecordType GetDDSType(const char* Data, size_t Size);
+
+private:
+	void					WorkerLoop();
+
+	std::deque<Request>		Queued;
+	std::deque<Request>		Completed;
+	std::thread				Worker;
+	std::mutex				Lock;
+	std::condition_variable	WorkAvailable;
+	UInt32					Reading;
+	bool					Stopping;
+};
@@ -7,6 +7,10 @@ void TextureManager::Initialize() {
 	auto timer = TimeLogger();
 	
 	TheTextureManager = new TextureManager();
+	TheTextureManager->TargetsOwner = NULL;
+	TheTextureManager->TargetsMemory = 0;
+	TheTextureManager->ReleasedTargetsCount = 0;
+	TheTextureManager->FrameIndex = 0;
 
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	UInt32 Width = TheRenderManager->width;
@@ -15,15 +19,21 @@ void TextureManager::Initialize() {
 	// create textures used by NVR and bind them to surfaces
 	TheTextureManager->InitTexture("TESR_SourceBuffer", &TheTextureManager->SourceTexture, &TheTextureManager->SourceSurface, Width, Height, D3DFMT_A16B16G16R16F);
 	TheTextureManager->InitTexture("TESR_RenderedBuffer", &TheTextureManager->RenderedTexture, &TheTextureManager->RenderedSurface, Width, Height, D3DFMT_A16B16G16R16F);
+	TheTextureManager->InitTexture("TESR_PingPongBuffer", &TheTextureManager->PingPongTexture, &TheTextureManager->PingPongSurface, Width, Height, D3DFMT_A16B16G16R16F);
+	TheTextureManager->RenderedBufferValid = false;
 
 	Device->CreateTexture(Width, Height, 1, D3DUSAGE_DEPTHSTENCIL, (D3DFORMAT)MAKEFOURCC('I', 'N', 'T', 'Z'), D3DPOOL_DEFAULT, &TheTextureManager->DepthTexture, NULL);
 	TheTextureManager->RegisterTexture("TESR_DepthBufferWorld",(IDirect3DBaseTexture9**)&TheTextureManager->DepthTexture);
+	TheTextureManager->TrackTexture("TESR_DepthBufferWorld", NULL, NULL, Width, Height, (D3DFORMAT)MAKEFOURCC('I', 'N', 'T', 'Z'), false);
 	Device->CreateTexture(Width, Height, 1, D3DUSAGE_DEPTHSTENCIL, (D3DFORMAT)MAKEFOURCC('I', 'N', 'T', 'Z'), D3DPOOL_DEFAULT, &TheTextureManager->DepthTextureViewModel, NULL);
 	TheTextureManager->RegisterTexture("TESR_DepthBufferViewModel",(IDirect3DBaseTexture9**)&TheTextureManager->DepthTextureViewModel);
+	TheTextureManager->TrackTexture("TESR_DepthBufferViewModel", NULL, NULL, Width, Height, (D3DFORMAT)MAKEFOURCC('I', 'N', 'T', 'Z'), false);
 
 	TheTextureManager->RegisterTexture(WordWaterHeightMapBuffer, &TheTextureManager->WaterHeightMapB);
 	TheTextureManager->RegisterTexture(WordWaterReflectionMapBuffer, &TheTextureManager->WaterReflectionMapB);
 
+	TheTextureManager->CreatePlaceholders();
+
 	timer.LogTime("TextureManager::Initialize");
 }
 
@@ -47,6 +57,167 @@ void TextureManager::InitTexture(const char* Name, IDirect3DTexture9** Texture,
 	// set the surface level to the texture.
 	(*Texture)->GetSurfaceLevel(0, Surface);
 	RegisterTexture(Name, (IDirect3DBaseTexture9**)Texture);
+	TrackTexture(Name, Texture, Surface, Width, Height, Format, mipmaps);
+}
+
+
+/*
+* Records the description and the estimated size of a texture created by TES Reloaded. Creating a texture again under the same name
+* (e.g. after a resolution change) replaces its record but keeps its owner.
+*/
+void TextureManager::TrackTexture(const char* Name, IDirect3DTexture9** Texture, IDirect3DSurface9** Surface, UInt32 Width, UInt32 Height, D3DFORMAT Format, bool Mipmaps, UInt32 Faces) {
+	auto Item = RenderTargets.try_emplace(Name);
+	RenderTargetRecord* Record = &Item.first->second;
+
+	if (Item.second) {
+		Record->Owner = TargetsOwner;
+		Record->Evictable = false;
+		Record->Released = false;
+		Record->LastUsed = FrameIndex;
+	}
+	else if (!Record->Released) {
+		TargetsMemory -= Record->Size;
+	}
+	else {
+		Record->Released = false;
+		ReleasedTargetsCount--;
+	}
+
+	Record->Texture = Texture;
+	Record->Surface = Surface;
+	Record->Width = Width;
+	Record->Height = Height;
+	Record->Format = Format;
+	Record->Mipmaps = Mipmaps;
+	Record->Faces = Faces;
+	Record->Size = GetTextureSize(Width, Height, Format, Mipmaps, Faces);
+	TargetsMemory += Record->Size;
+}
+
+
+/*
+* Estimated video memory of a texture: the full mip chain when it has mipmaps, for every face.
+*/
+UInt32 TextureManager::GetTextureSize(UInt32 Width, UInt32 Height, D3DFORMAT Format, bool Mipmaps, UInt32 Faces) {
+	UInt32 PixelSize = RenderGraph::GetFormatSize(Format);
+	UInt32 Size = 0;
+
+	while (true) {
+		Size += Width * Height * PixelSize;
+		if (!Mipmaps || (Width == 1 && Height == 1)) break;
+		Width = max(Width / 2, 1u);
+		Height = max(Height / 2, 1u);
+	}
+	return Size * Faces;
+}
+
+
+/*
+* Flags the targets of an effect, or only the named one, as private to it: they can be released while it is disabled.
+* Only for targets sampled by effects: the samplers of the game shaders cannot be cleared when they are released.
+* Whatever renders into them must call RestoreTargets first.
+*/
+void TextureManager::SetTargetsEvictable(EffectRecord* Owner, const char* Name) {
+	for (auto& Item : RenderTargets) {
+		if (Name && Item.first != Name) continue;
+		if (Item.second.Owner == Owner && Item.second.Texture) Item.second.Evictable = true;
+	}
+}
+
+
+/*
+* Creates again the released targets of an effect, to be called before it renders.
+*/
+void TextureManager::RestoreTargets(EffectRecord* Owner) {
+	if (!ReleasedTargetsCount) return;
+
+	TargetsOwner = Owner;
+	for (auto& Item : RenderTargets) {
+		RenderTargetRecord* Record = &Item.second;
+		if (Record->Owner != Owner || !Record->Released) continue;
+
+		Logger::Log("Restoring render target %s of %s", Item.first.c_str(), Owner->Name);
+		InitTexture(Item.first.c_str(), Record->Texture, Record->Surface, Record->Width, Record->Height, Record->Format, Record->Mipmaps);
+	}
+	TargetsOwner = NULL;
+}
+
+
+/*
+* Called at the frame boundary. Over the budget, the evictable targets of the disabled effects are released,
+* the effects disabled for the longest time first. Samplers bound to them are cleared so they bind the texture again when it is restored.
+*/
+void TextureManager::UpdateTargetsBudget() {
+	UInt64 Budget = (UInt64)TheSettingManager->SettingsMain.Main.RenderTargetsBudget * 1024 * 1024;
+
+	FrameIndex++;
+	for (auto& Item : RenderTargets) {
+		if (Item.second.Owner && Item.second.Owner->Enabled) Item.second.LastUsed = FrameIndex;
+	}
+	if (!Budget) return;
+
+	while (TargetsMemory > Budget) {
+		// least recently used owner among the disabled ones
+		EffectRecord* Owner = NULL;
+		UInt32 LastUsed = FrameIndex;
+		for (auto& Item : RenderTargets) {
+			RenderTargetRecord* Record = &Item.second;
+			if (!Record->Evictable || Record->Released || Record->Owner->Enabled || Record->LastUsed >= LastUsed) continue;
+			Owner = Record->Owner;
+			LastUsed = Record->LastUsed;
+		}
+		if (!Owner) return;
+
+		for (auto& Item : RenderTargets) {
+			RenderTargetRecord* Record = &Item.second;
+			if (Record->Owner != Owner || !Record->Evictable || Record->Released) continue;
+
+			for (auto& Effect : TheShaderManager->EffectsNames) {
+				if (*Effect.second) (*Effect.second)->ClearSampler(Item.first.c_str(), Item.first.size() + 1);
+			}
+			if (*Record->Surface) (*Record->Surface)->Release();
+			if (*Record->Texture) (*Record->Texture)->Release();
+			*Record->Surface = NULL;
+			*Record->Texture = NULL;
+			Record->Released = true;
+			TargetsMemory -= Record->Size;
+			ReleasedTargetsCount++;
+		}
+		Logger::Log("Released the render targets of %s, %u MB in use", Owner->Name, TargetsMemory / (1024 * 1024));
+	}
+}
+
+
+/*
+* Bytes of the targets allocated for an effect, or of all the targets if Owner is NULL.
+*/
+UInt32 TextureManager::GetTargetsMemory(EffectRecord* Owner) {
+	if (!Owner) return TargetsMemory;
+
+	UInt32 Size = 0;
+	for (auto& Item : RenderTargets) {
+		if (Item.second.Owner == Owner && !Item.second.Released) Size += Item.second.Size;
+	}
+	return Size;
+}
+
+
+/*
+* Copies the effects render target to the rendered buffer, unless it already holds a copy of it.
+*/
+void TextureManager::ResolveRenderedBuffer(IDirect3DSurface9* RenderTarget) {
+	if (RenderedBufferValid) return;
+
+	TheRenderManager->device->StretchRect(RenderTarget, NULL, RenderedSurface, NULL, D3DTEXF_NONE);
+	RenderedBufferValid = true;
+}
+
+
+/*
+* Flags the rendered buffer as outdated, to be called whenever the effects render target or the rendered buffer are written to.
+*/
+void TextureManager::InvalidateRenderedBuffer() {
+	RenderedBufferValid = false;
 }
 
 
@@ -82,37 +253,156 @@ IDirect3DBaseTexture9* TextureManager::GetTextureByName(std::string& Name) {
 
 
 /*
-* Loads the actual texture file or get it from cache based on type/Name
+* Loads the actual texture file or get it from cache based on type/Name.
+* When a Target is given and async loading is on, the file is read in the background: the placeholder of the type is returned
+* and cached for the path, and *Target (as any later request of the same path) gets the texture when it is committed.
 */
-IDirect3DBaseTexture9* TextureManager::GetFileTexture(std::string TexturePath, TextureRecord::TextureRecordType Type) {
+IDirect3DBaseTexture9* TextureManager::GetFileTexture(std::string TexturePath, TextureRecord::TextureRecordType Type, IDirect3DBaseTexture9** Target) {
 
 	IDirect3DBaseTexture9* Texture = GetCachedTexture(TexturePath);
+
+	PendingTexturesList::iterator Pending = PendingTextures.find(TexturePath);
+	if (Pending != PendingTextures.end()) {
+		if (Target) Pending->second.push_back(Target);
+		return Texture;
+	}
 	if (Texture) return Texture;
 
+	if (Target && TheSettingManager->SettingsMain.Main.AsyncTextureLoading && Type > TextureRecord::TextureRecordType::None && Type <= TextureRecord::TextureRecordType::CubeBuffer && Placeholders[Type]) {
+		Texture = Placeholders[Type];
+		TextureCache[TexturePath] = Texture;
+		PendingTextures[TexturePath].push_back(Target);
+		FileLoader.Enqueue(TexturePath, Type);
+		return Texture;
+	}
+
+	Texture = CreateFileTexture(TexturePath, Type, NULL);
+
+	// add texture to cache
+	TextureCache[TexturePath] = Texture;
+	if (Texture) TryCacheVulkanImage(Texture, TexturePath);
+	return Texture;
+}
+
+
+/*
+* Creates the texture from the file, or from its content already read when Data is given.
+*/
+IDirect3DBaseTexture9* TextureManager::CreateFileTexture(const std::string& TexturePath, TextureRecord::TextureRecordType Type, const std::vector<char>* Data) {
+
+	IDirect3DDevice9* Device = TheRenderManager->device;
+	IDirect3DBaseTexture9* Texture = NULL;
+
 	switch (Type) {
 	case TextureRecord::TextureRecordType::PlanarBuffer:
-		D3DXCreateTextureFromFileA(TheRenderManager->device, TexturePath.data(), (IDirect3DTexture9**)&Texture);
+		if (Data)
+			D3DXCreateTextureFromFileInMemory(Device, Data->data(), Data->size(), (IDirect3DTexture9**)&Texture);
+		else
+			D3DXCreateTextureFromFileA(Device, TexturePath.c_str(), (IDirect3DTexture9**)&Texture);
 		break;
 	case TextureRecord::TextureRecordType::VolumeBuffer:
-		D3DXCreateVolumeTextureFromFileA(TheRenderManager->device, TexturePath.data(), (IDirect3DVolumeTexture9**)&Texture);
+		if (Data)
+			D3DXCreateVolumeTextureFromFileInMemory(Device, Data->data(), Data->size(), (IDirect3DVolumeTexture9**)&Texture);
+		else
+			D3DXCreateVolumeTextureFromFileA(Device, TexturePath.c_str(), (IDirect3DVolumeTexture9**)&Texture);
 		break;
 	case TextureRecord::TextureRecordType::CubeBuffer:
-		D3DXCreateCubeTextureFromFileA(TheRenderManager->device, TexturePath.data(), (IDirect3DCubeTexture9**)&Texture);
+		if (Data)
+			D3DXCreateCubeTextureFromFileInMemory(Device, Data->data(), Data->size(), (IDirect3DCubeTexture9**)&Texture);
+		else
+			D3DXCreateCubeTextureFromFileA(Device, TexturePath.c_str(), (IDirect3DCubeTexture9**)&Texture);
 		break;
 	default:
-		Logger::Log("[ERROR] : Invalid texture type %i for %s", Type, TexturePath);
+		Logger::Log("[ERROR] : Invalid texture type %i for %s", Type, TexturePath.c_str());
 	}
 
-	if (!Texture) Logger::Log("[ERROR] : Couldn't load texture file %s", TexturePath);
-	else Logger::Log("Loaded texture file %s", TexturePath);
-
-	// add texture to cache
-	TextureCache[TexturePath] = Texture;
-	TryCacheVulkanImage(Texture, TexturePath);
+	if (!Texture) Logger::Log("[ERROR] : Couldn't load texture file %s", TexturePath.c_str());
+	else Logger::Log("Loaded texture file %s", TexturePath.c_str());
 	return Texture;
 }
 
 
+/*
+* Creates the 1 pixel black textures bound to the samplers while their file is loading.
+*/
+void TextureManager::CreatePlaceholders() {
+
+	IDirect3DDevice9* Device = TheRenderManager->device;
+	IDirect3DTexture9* Planar = NULL;
+	IDirect3DVolumeTexture9* Volume = NULL;
+	IDirect3DCubeTexture9* Cube = NULL;
+	D3DLOCKED_RECT Rect;
+	D3DLOCKED_BOX Box;
+
+	memset(Placeholders, 0, sizeof(Placeholders));
+
+	if (SUCCEEDED(Device->CreateTexture(1, 1, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &Planar, NULL))) {
+		if (SUCCEEDED(Planar->LockRect(0, &Rect, NULL, 0))) {
+			*(D3DCOLOR*)Rect.pBits = 0;
+			Planar->UnlockRect(0);
+		}
+		Placeholders[TextureRecord::TextureRecordType::PlanarBuffer] = Planar;
+	}
+	if (SUCCEEDED(Device->CreateVolumeTexture(1, 1, 1, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &Volume, NULL))) {
+		if (SUCCEEDED(Volume->LockBox(0, &Box, NULL, 0))) {
+			*(D3DCOLOR*)Box.pBits = 0;
+			Volume->UnlockBox(0);
+		}
+		Placeholders[TextureRecord::TextureRecordType::VolumeBuffer] = Volume;
+	}
+	if (SUCCEEDED(Device->CreateCubeTexture(1, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &Cube, NULL))) {
+		for (UInt32 Face = 0; Face < 6; Face++) {
+			if (SUCCEEDED(Cube->LockRect((D3DCUBEMAP_FACES)Face, 0, &Rect, NULL, 0))) {
+				*(D3DCOLOR*)Rect.pBits = 0;
+				Cube->UnlockRect((D3DCUBEMAP_FACES)Face, 0);
+			}
+		}
+		Placeholders[TextureRecord::TextureRecordType::CubeBuffer] = Cube;
+	}
+}
+
+
+/*
+* Creates the textures of the files read by the loader and binds them in place of the placeholders. Called at the frame boundary.
+* Stops after MaxCommitTime ms, the remaining files are committed in the next frames.
+*/
+void TextureManager::CommitFileTextures() {
+	static const float MaxCommitTime = 2.0f;
+	std::deque<TextureLoader::Request>& Loaded = LoadedTextures;
+
+	FileLoader.TakeCompleted(&Loaded);
+	if (Loaded.empty()) return;
+
+	auto timer = TimeLogger();
+	float Elapsed = 0.0f;
+
+	while (!Loaded.empty() && Elapsed < MaxCommitTime) {
+		TextureLoader::Request& Item = Loaded.front();
+
+		if (Item.Data.empty()) Logger::Log("[ERROR] : Couldn't read texture file %s", Item.Path.c_str());
+		if (Item.FileType != TextureRecord::TextureRecordType::None && Item.FileType != Item.Type) Logger::Log("[WARNING] : Texture file %s doesn't match the sampler type %i", Item.Path.c_str(), Item.Type);
+
+		IDirect3DBaseTexture9* Texture = Item.Data.empty() ? NULL : CreateFileTexture(Item.Path, Item.Type, &Item.Data);
+		IDirect3DBaseTexture9* Placeholder = Placeholders[Item.Type];
+
+		TextureCache[Item.Path] = Texture;
+		if (Texture) TryCacheVulkanImage(Texture, Item.Path);
+
+		// samplers cleared or rebound meanwhile are left alone
+		PendingTexturesList::iterator Pending = PendingTextures.find(Item.Path);
+		if (Pending != PendingTextures.end()) {
+			for (IDirect3DBaseTexture9** Target : Pending->second) {
+				if (*Target == Placeholder) *Target = Texture;
+			}
+			PendingTextures.erase(Pending);
+		}
+
+		Loaded.pop_front();
+		Elapsed += timer.LogTime("TextureManager::CommitFileTexture");
+	}
+}
+
+
 void TextureManager::SetWaterHeightMap(IDirect3DBaseTexture9* WaterHeightMap) {
     if (WaterHeightMapB == WaterHeightMap) return;
     WaterHeightMapB = WaterHeightMap;  //This may cause crashes on certain conditions
@@ -2,6 +2,7 @@
 
 #define VK_NO_PROTOTYPES
 #include <vulkan/vulkan.h>
+#include "TextureLoader.h"
 
 typedef std::map<std::string, IDirect3DBaseTexture9*> TextureList;
 typedef std::map<std::string, IDirect3DBaseTexture9**> TexturePointersList;
@@ -15,6 +16,28 @@ struct VulkanImageData
 	VkImageCreateInfo ImageCreateInfo {};
 };
 typedef std::map<std::string, VulkanImageData> VulkanImagesList;
+typedef std::map<std::string, std::vector<IDirect3DBaseTexture9**>> PendingTexturesList;
+
+/*
+* A texture created by TES Reloaded in the default pool, with its estimated video memory.
+* Targets of effects flagged as evictable are released while their effect is disabled and the budget is exceeded,
+* and created again with the same description when the effect renders.
+*/
+struct RenderTargetRecord {
+	EffectRecord*			Owner;		// NULL for the buffers shared by all effects
+	IDirect3DTexture9**		Texture;	// NULL for the textures only accounted (cube maps, depth textures)
+	IDirect3DSurface9**		Surface;
+	UInt32					Width;
+	UInt32					Height;
+	D3DFORMAT				Format;
+	bool					Mipmaps;
+	UInt32					Faces;
+	UInt32					Size;		// bytes
+	bool					Evictable;
+	bool					Released;
+	UInt32					LastUsed;	// frame the owner was last enabled
+};
+typedef std::map<std::string, RenderTargetRecord> RenderTargetsList;
 
 class TextureManager { // Never disposed
 public:
@@ -23,17 +46,31 @@ public:
 	void					RegisterTexture(const char* Name, IDirect3DBaseTexture9** Texture);
 	void					SetWaterHeightMap(IDirect3DBaseTexture9* WaterHeightMap);
     void                    SetWaterReflectionMap(IDirect3DBaseTexture9* WaterReflectionMap);
-	IDirect3DBaseTexture9*	GetFileTexture(std::string TexturePath, TextureRecord::TextureRecordType type);
+	IDirect3DBaseTexture9*	GetFileTexture(std::string TexturePath, TextureRecord::TextureRecordType type, IDirect3DBaseTexture9** Target = NULL);
+	IDirect3DBaseTexture9*	CreateFileTexture(const std::string& TexturePath, TextureRecord::TextureRecordType Type, const std::vector<char>* Data);
+	void					CreatePlaceholders();
+	void					CommitFileTextures();
+	void					TrackTexture(const char* Name, IDirect3DTexture9** Texture, IDirect3DSurface9** Surface, UInt32 Width, UInt32 Height, D3DFORMAT Format, bool Mipmaps, UInt32 Faces = 1);
+	void					SetTargetsEvictable(EffectRecord* Owner, const char* Name = NULL);
+	void					RestoreTargets(EffectRecord* Owner);
+	void					UpdateTargetsBudget();
+	UInt32					GetTargetsMemory(EffectRecord* Owner);
+	static UInt32			GetTextureSize(UInt32 Width, UInt32 Height, D3DFORMAT Format, bool Mipmaps, UInt32 Faces);
 	IDirect3DBaseTexture9* 	GetCachedTexture(std::string& pathS);
 	IDirect3DBaseTexture9*	GetTextureByName(std::string& Name);
 	void					DumpToFile(IDirect3DTexture9* Texture, const char* Name);
 	void					TryCacheVulkanImage(IDirect3DBaseTexture9* InTexture, const std::string& InName);
 	VulkanImageData			TryGetVkImageData(const std::string& InName);
+	void					ResolveRenderedBuffer(IDirect3DSurface9* RenderTarget);
+	void					InvalidateRenderedBuffer();
 
 	IDirect3DTexture9*		SourceTexture;
 	IDirect3DSurface9*		SourceSurface;
 	IDirect3DTexture9* 		RenderedTexture;
 	IDirect3DSurface9*		RenderedSurface;
+	IDirect3DTexture9*		PingPongTexture;
+	IDirect3DSurface9*		PingPongSurface;
+	bool					RenderedBufferValid;
 	IDirect3DTexture9* 		BloomTexture;
 	IDirect3DSurface9*		BloomSurface;
 	IDirect3DTexture9*		DepthTexture;
@@ -45,6 +82,15 @@ public:
 	TextureList				TextureCache;
 	TexturePointersList		TextureNames;
 	VulkanImagesList		VulkanImages;
+	TextureLoader			FileLoader;
+	std::deque<TextureLoader::Request> LoadedTextures;	// read, waiting for their commit
+	PendingTexturesList		PendingTextures;	// pointers to update when the file texture is committed, by path
+	IDirect3DBaseTexture9*	Placeholders[4];	// by TextureRecordType, bound while the file is loading
+	RenderTargetsList		RenderTargets;
+	EffectRecord*			TargetsOwner;		// effect registering its textures, owner of the targets created meanwhile
+	UInt32					TargetsMemory;		// bytes of the targets currently allocated
+	UInt32					ReleasedTargetsCount;
+	UInt32					FrameIndex;
     WaterMapList         	WaterHeightMapTextures;
     WaterMapList         	WaterReflectionMapTextures;
 
@@ -26,12 +26,20 @@ PFN_vkCreateCommandPool p_vkCreateCommandPool = nullptr;
 PFN_vkCmdPushConstants p_vkCmdPushConstants = nullptr;
 PFN_vkFreeDescriptorSets p_vkFreeDescriptorSets = nullptr;
 PFN_vkCmdClearColorImage p_vkCmdClearColorImage = nullptr;
+PFN_vkCmdPipelineBarrier p_vkCmdPipelineBarrier = nullptr;
+PFN_vkResetFences p_vkResetFences = nullptr;
+PFN_vkResetDescriptorPool p_vkResetDescriptorPool = nullptr;
+PFN_vkResetCommandBuffer p_vkResetCommandBuffer = nullptr;
+PFN_vkCreateSampler p_vkCreateSampler = nullptr;
+PFN_vkCreatePipelineCache p_vkCreatePipelineCache = nullptr;
+PFN_vkGetPipelineCacheData p_vkGetPipelineCacheData = nullptr;
+PFN_vkGetPhysicalDeviceProperties p_vkGetPhysicalDeviceProperties = nullptr;
 
 void VkDispatch::InitVulkanFunctionPointers(VkInstance instance, VkDevice device) {
     HMODULE mod = LoadLibraryA("vulkan-1.dll");
     if (!mod)
     {
-        Logger::Log("Could not load vulkan-1.dll library");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "Could not load vulkan-1.dll library");
         return;
     }
 
@@ -43,119 +51,159 @@ void VkDispatch::InitVulkanFunctionPointers(VkInstance instance, VkDevice device
     LoadDev(p_vkQueueSubmit, "vkQueueSubmit");
     if (!p_vkQueueSubmit)
     {
-        Logger::Log("p_vkQueueSubmit is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkQueueSubmit is null");
     }
     LoadDev(p_vkCreateFence, "vkCreateFence");
     if (!p_vkCreateFence)
     {
-        Logger::Log("p_vkCreateFence is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateFence is null");
     }
     LoadDev(p_vkDestroyFence, "vkDestroyFence");
     if (!p_vkDestroyFence)
     {
-        Logger::Log("p_vkDestroyFence is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkDestroyFence is null");
     }
     LoadDev(p_vkWaitForFences, "vkWaitForFences");
     if (!p_vkWaitForFences)
     {
-        Logger::Log("p_vkWaitForFences is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkWaitForFences is null");
     }
     LoadDev(p_vkCreateImageView, "vkCreateImageView");
     if (!p_vkCreateImageView)
     {
-        Logger::Log("p_vkCreateImageView is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateImageView is null");
     }
     LoadDev(p_vkDestroyImageView, "vkDestroyImageView");
     if (!p_vkDestroyImageView)
     {
-        Logger::Log("p_vkDestroyImageView is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkDestroyImageView is null");
     }
     LoadDev(p_vkAllocateDescriptorSets, "vkAllocateDescriptorSets");
     if (!p_vkAllocateDescriptorSets)
     {
-        Logger::Log("p_vkAllocateDescriptorSets is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkAllocateDescriptorSets is null");
     }
     LoadDev(p_vkUpdateDescriptorSets, "vkUpdateDescriptorSets");
     if (!p_vkUpdateDescriptorSets)
     {
-        Logger::Log("p_vkUpdateDescriptorSets is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkUpdateDescriptorSets is null");
     }
     LoadDev(p_vkAllocateCommandBuffers, "vkAllocateCommandBuffers");
     if (!p_vkAllocateCommandBuffers)
     {
-        Logger::Log("p_vkAllocateCommandBuffers is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkAllocateCommandBuffers is null");
     }
     LoadDev(p_vkBeginCommandBuffer, "vkBeginCommandBuffer");
     if (!p_vkBeginCommandBuffer)
     {
-        Logger::Log("p_vkBeginCommandBuffer is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkBeginCommandBuffer is null");
     }
     LoadDev(p_vkEndCommandBuffer, "vkEndCommandBuffer");
     if (!p_vkEndCommandBuffer)
     {
-        Logger::Log("p_vkEndCommandBuffer is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkEndCommandBuffer is null");
     }
     LoadDev(p_vkCmdBindPipeline, "vkCmdBindPipeline");
     if (!p_vkCmdBindPipeline)
     {
-        Logger::Log("p_vkCmdBindPipeline is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCmdBindPipeline is null");
     }
     LoadDev(p_vkCmdBindDescriptorSets, "vkCmdBindDescriptorSets");
     if (!p_vkCmdBindDescriptorSets)
     {
-        Logger::Log("p_vkCmdBindDescriptorSets is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCmdBindDescriptorSets is null");
     }
     LoadDev(p_vkCmdDispatch, "vkCmdDispatch");
     if (!p_vkCmdDispatch)
     {
-        Logger::Log("p_vkCmdDispatch is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCmdDispatch is null");
     }
     LoadDev(p_vkFreeCommandBuffers, "vkFreeCommandBuffers");
     if (!p_vkFreeCommandBuffers)
     {
-        Logger::Log("p_vkFreeCommandBuffers is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkFreeCommandBuffers is null");
     }
     LoadDev(p_vkCreateDescriptorPool, "vkCreateDescriptorPool");
     if (!p_vkCreateDescriptorPool)
     {
-        Logger::Log("p_vkCreateDescriptorPool is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateDescriptorPool is null");
     }
     LoadDev(p_vkCreateShaderModule, "vkCreateShaderModule");
     if (!p_vkCreateShaderModule)
     {
-        Logger::Log("p_vkCreateShaderModule is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateShaderModule is null");
     }
     LoadDev(p_vkCreateDescriptorSetLayout, "vkCreateDescriptorSetLayout");
     if (!p_vkCreateDescriptorSetLayout)
     {
-        Logger::Log("p_vkCreateDescriptorSetLayout is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateDescriptorSetLayout is null");
     }
     LoadDev(p_vkCreatePipelineLayout, "vkCreatePipelineLayout");
     if (!p_vkCreatePipelineLayout)
     {
-        Logger::Log("p_vkCreatePipelineLayout is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreatePipelineLayout is null");
     }
     LoadDev(p_vkCreateComputePipelines, "vkCreateComputePipelines");
     if (!p_vkCreateComputePipelines)
     {
-        Logger::Log("p_vkCreateComputePipelines is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateComputePipelines is null");
     }
     LoadDev(p_vkCreateCommandPool, "vkCreateCommandPool");
     if (!p_vkCreateCommandPool)
     {
-        Logger::Log("p_vkCreateCommandPool is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateCommandPool is null");
     }
     LoadDev(p_vkCmdPushConstants, "vkCmdPushConstants");
     if (!p_vkCmdPushConstants)
     {
-        Logger::Log("p_vkCmdPushConstants is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCmdPushConstants is null");
     }
     LoadDev(p_vkFreeDescriptorSets, "vkFreeDescriptorSets");
     if (!p_vkFreeDescriptorSets)
     {
-        Logger::Log("p_vkFreeDescriptorSets is null");
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkFreeDescriptorSets is null");
     }
     LoadDev(p_vkCmdClearColorImage, "vkCmdClearColorImage");
+    LoadDev(p_vkCmdPipelineBarrier, "vkCmdPipelineBarrier");
+    if (!p_vkCmdPipelineBarrier)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCmdPipelineBarrier is null");
+    }
+    LoadDev(p_vkResetFences, "vkResetFences");
+    if (!p_vkResetFences)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkResetFences is null");
+    }
+    LoadDev(p_vkResetDescriptorPool, "vkResetDescriptorPool");
+    if (!p_vkResetDescriptorPool)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkResetDescriptorPool is null");
+    }
+    LoadDev(p_vkResetCommandBuffer, "vkResetCommandBuffer");
+    if (!p_vkResetCommandBuffer)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkResetCommandBuffer is null");
+    }
+    LoadDev(p_vkCreateSampler, "vkCreateSampler");
+    if (!p_vkCreateSampler)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreateSampler is null");
+    }
+    LoadDev(p_vkCreatePipelineCache, "vkCreatePipelineCache");
+    if (!p_vkCreatePipelineCache)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkCreatePipelineCache is null");
+    }
+    LoadDev(p_vkGetPipelineCacheData, "vkGetPipelineCacheData");
+    if (!p_vkGetPipelineCacheData)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkGetPipelineCacheData is null");
+    }
+    LoadDev(p_vkGetPhysicalDeviceProperties, "vkGetPhysicalDeviceProperties");
+    if (!p_vkGetPhysicalDeviceProperties)
+    {
+        Logger::Log(Logger::CategoryVulkan, Logger::LevelError, "p_vkGetPhysicalDeviceProperties is null");
+    }
 
-    Logger::Log("Vulkan function pointers initialized");
+    Logger::Log(Logger::CategoryVulkan, Logger::LevelInfo, "Vulkan function pointers initialized");
 }
@@ -31,6 +31,16 @@ extern PFN_vkFreeDescriptorSets p_vkFreeDescriptorSets;
 
 extern PFN_vkCmdClearColorImage p_vkCmdClearColorImage;
 
+// compute effects
+extern PFN_vkCmdPipelineBarrier p_vkCmdPipelineBarrier;
+extern PFN_vkResetFences p_vkResetFences;
+extern PFN_vkResetDescriptorPool p_vkResetDescriptorPool;
+extern PFN_vkResetCommandBuffer p_vkResetCommandBuffer;
+extern PFN_vkCreateSampler p_vkCreateSampler;
+extern PFN_vkCreatePipelineCache p_vkCreatePipelineCache;
+extern PFN_vkGetPipelineCacheData p_vkGetPipelineCacheData;
+extern PFN_vkGetPhysicalDeviceProperties p_vkGetPhysicalDeviceProperties;
+
 extern PFN_vkFreeCommandBuffers p_vkFreeCommandBuffers;
 extern PFN_vkEndCommandBuffer p_vkEndCommandBuffer;
 extern PFN_vkCmdDispatch p_vkCmdDispatch;
@@ -9,7 +9,7 @@ void AmbientOcclusionEffect::RegisterConstants() {
 }
 
 void AmbientOcclusionEffect::UpdateSettings() {
-	const char* sectionName = TheShaderManager->GameState.isExterior?"Shaders.AmbientOcclusion.Exteriors":"Shaders.AmbientOcclusion.Interiors";
+	const char* sectionName = GetSettingsContext();
 
 	Constants.Enabled = TheSettingManager->GetSettingI(sectionName, "Enabled");
 	Constants.AOData.x = TheSettingManager->GetSettingF(sectionName, "Samples");
@@ -22,6 +22,10 @@ void AmbientOcclusionEffect::UpdateSettings() {
 	Constants.Data.w = TheSettingManager->GetSettingF(sectionName, "BlurRadiusMultiplier");
 }
 
+const char* AmbientOcclusionEffect::GetSettingsContext() {
+	return TheShaderManager->GameState.isExterior ? "Shaders.AmbientOcclusion.Exteriors" : "Shaders.AmbientOcclusion.Interiors";
+}
+
 bool AmbientOcclusionEffect::ShouldRender() {
 	return Constants.Enabled;
 }
\ No newline at end of file
@@ -15,5 +15,6 @@ public:
 	void	UpdateConstants();
 	void	RegisterConstants();
 	void	UpdateSettings();
+	const char* GetSettingsContext();
 	bool	ShouldRender();
 };
\ No newline at end of file
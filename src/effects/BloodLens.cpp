@@ -28,6 +28,7 @@ void BloodLensEffect::UpdateSettings() {
 	Constants.BloodColor.x = TheSettingManager->GetSettingF("Shaders.BloodLens.Main", "ColorR");
 	Constants.BloodColor.y = TheSettingManager->GetSettingF("Shaders.BloodLens.Main", "ColorG");
 	Constants.BloodColor.z = TheSettingManager->GetSettingF("Shaders.BloodLens.Main", "ColorB");
+	Chance = TheSettingManager->GetSettingHandle<float>("Shaders.BloodLens.Main", "Chance");
 }
 
 void BloodLensEffect::RegisterConstants() {
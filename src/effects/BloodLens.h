@@ -16,6 +16,7 @@ public:
 	BloodLensStruct	Constants;
 
 	float effectTime;
+	SettingHandle<float> Chance;	// read on every hit
 
 	void	UpdateConstants();
 	void	RegisterConstants();
@@ -29,6 +29,7 @@ void BloomEffect::RegisterTextures() {
 		);
 
 		TheTextureManager->InitTexture(name.c_str(), &Textures.BloomTexture[i], &Textures.BloomSurface[i], Settings.Resolution[i].x, Settings.Resolution[i].y, D3DFMT_A16B16G16R16F);
+		if (i > 0) TheTextureManager->SetTargetsEvictable(this, name.c_str()); // the first buffer is also sampled by the tonemapping shaders and other effects
 		TheShaderManager->CreateFrameVertex(width, height, &Textures.BloomVertexBuffer[i]);
 	}
 };
@@ -104,10 +105,14 @@ void BloomEffect::RenderBloomBuffer(IDirect3DSurface9* RenderTarget) {
 	}
 
 	auto timer = TimeLogger();
+	UInt32 GpuScope = TheShaderManager->Profiler.BeginScope(Name);
 
 	IDirect3DDevice9* Device = TheRenderManager->device;
 	NiDX9RenderState* RenderState = TheRenderManager->renderState;
 
+	TheTextureManager->RestoreTargets(this); // the smaller buffers are released while bloom is disabled
+	TheTextureManager->ResolveRenderedBuffer(RenderTarget); // the downsampling starts from the rendered buffer
+
 	const int passes = std::clamp((int) TheShaderManager->GetTransitionValue(Settings.Main.Passes, Settings.Night.Passes, Settings.Interiors.Passes), 2, 8);
 
 	int passNumber = 0;
@@ -141,5 +146,6 @@ void BloomEffect::RenderBloomBuffer(IDirect3DSurface9* RenderTarget) {
 	Device->SetStreamSource(0, TheShaderManager->FrameVertex, 0, sizeof(FrameVS)); // Reset vertex buffer for other effects.
 	Device->SetRenderTarget(0, RenderTarget);  // Reset render target for other effects.
 
+	TheShaderManager->Profiler.EndScope(GpuScope);
 	renderTime = timer.LogTime("EffectRecord::Render Bloom");
 }
@@ -1,8 +1,6 @@
 #include "DepthOfField.h"
 
 void DepthOfFieldEffect::UpdateConstants() {
-	TheShaderManager->avglumaRequired = true;
-
 	ValuesStruct* category = &Settings.FirstPerson;
 	if (TheCameraManager->IsVanity())
 		category = &Settings.VanityView;
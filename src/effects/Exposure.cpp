@@ -1,8 +1,6 @@
 #include "Exposure.h"
 
 void ExposureEffect::UpdateConstants() {
-	TheShaderManager->avglumaRequired = true; // mark average luma calculation as necessary
-
 	if (TheSettingManager->SettingsChanged || TheShaderManager->GameState.isDayTimeChanged) {
 		Constants.Data.x = TheShaderManager->GetTransitionValue(Settings.Main.MinBrightness, Settings.Night.MinBrightness, Settings.Interiors.MinBrightness);
 		Constants.Data.y = TheShaderManager->GetTransitionValue(Settings.Main.MaxBrightness, Settings.Night.MaxBrightness, Settings.Interiors.MaxBrightness);
@@ -9,7 +9,7 @@ void LowHFEffect::UpdateConstants() {
 	Constants.Data.z = 0.0f;
 	Constants.Data.w = 0.0f;
 
-	float healthLimit = TheSettingManager->GetSettingF("Shaders.LowHF.Main", "HealthLimit");
+	float healthLimit = Settings.healthLimit;
 	if (Player->IsAlive()) {
 		Constants.HealthCoeff = 1.0f - PlayerHealthPercent / healthLimit;
 		Constants.FatigueCoeff = 1.0f - PlayerFatiguePercent / Settings.FatigueLimit;
@@ -6,4 +6,5 @@ void NormalsEffect::RegisterConstants() {
 	
 void NormalsEffect::RegisterTextures() {
 	TheTextureManager->InitTexture("TESR_NormalsBuffer", &Textures.NormalsTexture, &Textures.NormalsSurface, TheRenderManager->width, TheRenderManager->height, D3DFMT_A16B16G16R16F);
+	TheTextureManager->SetTargetsEvictable(this); // only sampled by effects, restored by the render graph before the pass
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ void SMAAEffect::RegisterTextures() {
 
 	TheTextureManager->InitTexture("TESR_SMAA_Edges", &Textures.SMAA_Edges_Texture, &Textures.SMAA_Edges_Surface, width, height, D3DFMT_A8R8G8B8);
 	TheTextureManager->InitTexture("TESR_SMAA_Blend", &Textures.SMAA_Blend_Texture, &Textures.SMAA_Blend_Surface, width, height, D3DFMT_A8R8G8B8);
+	TheTextureManager->SetTargetsEvictable(this); // only sampled by the SMAA passes
 };
 
 void SMAAEffect::UpdateSettings() {
@@ -34,19 +35,24 @@ void SMAAEffect::Render(IDirect3DDevice9* Device, IDirect3DSurface9* RenderTarge
 		return; // skip rendering if the effect is disabled
 	}
 
+	TheTextureManager->RestoreTargets(this);
+
 	auto timer = TimeLogger();
+	UInt32 GpuScope = TheShaderManager->Profiler.BeginScope(Name);
 
 	// Clear the stencil buffer.
 	Device->Clear(0, nullptr, D3DCLEAR_STENCIL, D3DCOLOR_ARGB(0, 0, 0, 0), 1.0f, 0);
 
+	TheTextureManager->ResolveRenderedBuffer(RenderTarget);
 	SetCT();
 
 	EdgesDetectionPass(Settings.Main.EdgeDetection);
 	BlendingWeightsCalculationPass();
 	NeighborhoodBlendingPass(RenderTarget);
 
-	if (RenderedSurface) Device->StretchRect(RenderTarget, NULL, RenderedSurface, NULL, D3DTEXF_LINEAR);
+	if (RenderedSurface) TheTextureManager->InvalidateRenderedBuffer();
 
+	TheShaderManager->Profiler.EndScope(GpuScope);
 	renderTime = timer.LogTime("EffectRecord::Render SMAA");
 }
 
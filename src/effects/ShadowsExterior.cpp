@@ -237,6 +237,10 @@ bool ShadowsExteriorEffect::UpdateSettingsFromQuality(int quality) {
 	return cascadeSettingsChanged;
 }
 
+const char* ShadowsExteriorEffect::GetSettingsContext() {
+	return TheShaderManager->GameState.isExterior ? "Exteriors" : "Interiors"; // the shadows buffer is cleared depending on the cell type
+}
+
 void ShadowsExteriorEffect::UpdateSettings() {
 
 	Constants.ScreenSpaceData.x = TheSettingManager->GetSettingI("Shaders.ShadowsExteriors.ScreenSpace", "Enabled") && Enabled;
@@ -362,6 +366,7 @@ void ShadowsExteriorEffect::RegisterTextures() {
 	ULONG ShadowAtlasSize = ShadowMapSize * 2;
 
 	TheTextureManager->InitTexture("TESR_ShadowAtlas", &ShadowAtlasTexture, &ShadowAtlasSurface, ShadowAtlasSize, ShadowAtlasSize, Settings.ShadowMaps.Format, Settings.ShadowMaps.Mipmaps);
+	TheTextureManager->SetTargetsEvictable(this, "TESR_ShadowAtlas"); // only rendered and sampled while the exterior shadows are enabled, the other maps are also used without them
 
 	if (!Settings.ShadowMaps.MSAA)
 		TheRenderManager->device->CreateDepthStencilSurface(ShadowAtlasSize, ShadowAtlasSize, D3DFMT_D24S8, D3DMULTISAMPLE_NONE, 0, true, &ShadowAtlasDepthSurface, NULL);
@@ -403,6 +408,7 @@ void ShadowsExteriorEffect::RegisterTextures() {
 		}
 		std::string textureName = "TESR_ShadowCubeMapBuffer" + std::to_string(i);
 		TheTextureManager->RegisterTexture(textureName.c_str(), (IDirect3DBaseTexture9**)&Textures.ShadowCubeMapTexture[i]);
+		TheTextureManager->TrackTexture(textureName.c_str(), NULL, NULL, ShadowCubeMapSize, ShadowCubeMapSize, D3DFMT_R32F, false, 6);
 	}
 	// Create the stencil surface used for rendering cubemaps
 	TheRenderManager->device->CreateDepthStencilSurface(ShadowCubeMapSize, ShadowCubeMapSize, D3DFMT_D24S8, D3DMULTISAMPLE_NONE, 0, true, &Textures.ShadowCubeMapDepthSurface, NULL);
@@ -185,6 +185,7 @@ public:
 	void		clearShadowsBuffer();
 	void		UpdateConstants();
 	void		UpdateSettings();
+	const char*	GetSettingsContext();
 	void		RegisterConstants();
 	void		RegisterTextures();
 	void		RecreateTextures(bool cascades, bool ortho, bool cubemaps);
@@ -13,6 +13,10 @@ void SkyShaders::UpdateConstants() {
 		Constants.SunsetColor.w = 1.0;
 }
 
+const char* SkyShaders::GetSettingsContext() {
+	return TheShaderManager->GameState.isExterior ? "Exteriors" : "Interiors"; // the sunset color is only used in exteriors
+}
+
 void SkyShaders::UpdateSettings() {
 
 	useSunDiskColor = TheSettingManager->GetSettingF("Shaders.Sky.Main", "UseSunDiskColor");
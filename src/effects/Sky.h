@@ -22,4 +22,5 @@ public:
 	void	UpdateConstants();
 	void	RegisterConstants();
 	void	UpdateSettings();
+	const char* GetSettingsContext();
 };
\ No newline at end of file
@@ -2,14 +2,13 @@
 
 void VolumetricFogEffect::UpdateConstants() {}
 
+const char* VolumetricFogEffect::GetSettingsContext() {
+	return TheShaderManager->GameState.isExterior ? "Shaders.VolumetricFog.Main" : "Shaders.VolumetricFog.Interiors";
+}
+
 void VolumetricFogEffect::UpdateSettings(){
 
-	char SettingCategory[50] = "Shaders.VolumetricFog.";
-	
-	if (TheShaderManager->GameState.isExterior) 
-		strcat(SettingCategory, "Main");
-	else
-		strcat(SettingCategory, "Interiors");
+	const char* SettingCategory = GetSettingsContext();
 
 	Constants.Data.x = TheSettingManager->GetSettingF(SettingCategory, "MinimumBaseFog");
 	//Constants.Data.y = TheSettingManager->GetSettingF(SettingCategory, "ColorCoeff");
@@ -21,5 +21,6 @@ public:
 	void	UpdateConstants();
 	void	RegisterConstants();
 	void	UpdateSettings();
+	const char* GetSettingsContext();
 	bool	ShouldRender();
 };
\ No newline at end of file
@@ -49,9 +49,14 @@ void WaterShaders::UpdateConstants() {
 	Constants.Default.waterVolume.x = Constants.Placed.waterVolume.x = causticsStrength * TheShaderManager->ShaderConst.sunGlare;
 }
 
-void WaterShaders::UpdateSettings() {
+/*
+* The water settings section used for the current cell.
+*/
+const char* WaterShaders::GetSettingsContext() {
 	//SettingsWaterStruct* sws = NULL;
 
+	if (!Player || !Player->parentCell) return "Shaders.Water.Default";
+
 	TESWaterForm* currentWater = Player->parentCell->GetWaterForm();
 	const char* sectionName = "Shaders.Water.Default";
 	if (!TheShaderManager->GameState.isExterior) sectionName = "Shaders.Water.Interiors";
@@ -67,6 +72,11 @@ void WaterShaders::UpdateSettings() {
 		//else if (!(sws = TheSettingManager->GetSettingsWater(currentCell->GetEditorName())) && currentWorldSpace)
 		//	sws = TheSettingManager->GetSettingsWater(currentWorldSpace->GetEditorName());
 	}
+	return sectionName;
+}
+
+void WaterShaders::UpdateSettings() {
+	const char* sectionName = GetSettingsContext();
 
 	Constants.Default.waterCoefficients.x = TheSettingManager->GetSettingF(sectionName, "inExtCoeff_R");
 	Constants.Default.waterCoefficients.y = TheSettingManager->GetSettingF(sectionName, "inExtCoeff_G");
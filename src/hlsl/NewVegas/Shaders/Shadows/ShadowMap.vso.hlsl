@@ -25,6 +25,11 @@ struct VS_INPUT {
     float4 texcoord_1 : TEXCOORD1;  // Terrain LOD, no idea what it represents.
     float4 blendweight : BLENDWEIGHT;
     float4 blendindexes : BLENDINDICES;
+#ifdef INSTANCED
+    float4 instance_0 : TEXCOORD4;  // Instanced geometry, columns of the world transform.
+    float4 instance_1 : TEXCOORD5;
+    float4 instance_2 : TEXCOORD6;
+#endif
 };
 
 struct VS_OUTPUT {
@@ -84,7 +89,11 @@ VS_OUTPUT main(VS_INPUT IN) {
 
         r0.z = r1.z - ((q0.x * q1.x) * LODLandParams.y);
     }
+#ifdef INSTANCED
+    r0.xyz = float3(dot(r0, IN.instance_0), dot(r0, IN.instance_1), dot(r0, IN.instance_2));
+#else
     if (TESR_ShadowData.x != 1.0f) r0 = mul(r0, TESR_ShadowWorldTransform);
+#endif
 	r0 = mul(r0, TESR_ShadowViewProjTransform);
 	
 	// Pancaking to ensure geometry outside of near plane is not culled.
@@ -10,6 +10,11 @@ struct VS_INPUT {
 	float4 texcoord_0 : TEXCOORD0;
     float4 blendweight : BLENDWEIGHT;
     float4 blendindexes : BLENDINDICES;
+#ifdef INSTANCED
+    float4 instance_0 : TEXCOORD4;  // Instanced geometry, columns of the world transform.
+    float4 instance_1 : TEXCOORD5;
+    float4 instance_2 : TEXCOORD6;
+#endif
 };
 
 struct VS_OUTPUT {
@@ -46,7 +51,11 @@ VS_OUTPUT main(VS_INPUT IN) {
 		q7.xyz = (IN.blendweight.z * q6.xyz) + ((IN.blendweight.x * q5.xyz) + (q4.xyz * IN.blendweight.y));
 		r0.xyz = ((1 - weight(IN.blendweight.xyz)) * q8.xyz) + q7.xyz;
 	}
+#ifdef INSTANCED
+    r0.xyz = float3(dot(r0, IN.instance_0), dot(r0, IN.instance_1), dot(r0, IN.instance_2));
+#else
     r0 = mul(r0, TESR_ShadowWorldTransform);
+#endif
 	r1.xyz = TESR_ShadowCubeMapLightPosition.xyz - r0.xyz;
 	r0 = mul(r0, TESR_ShadowViewProjTransform);
 	OUT.position = r0;
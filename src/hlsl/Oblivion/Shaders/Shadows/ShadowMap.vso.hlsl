@@ -15,6 +15,11 @@ struct VS_INPUT {
 	float4 texcoord_0 : TEXCOORD0;
     float4 blendweight : BLENDWEIGHT;
     float4 blendindexes : BLENDINDICES;
+#ifdef INSTANCED
+    float4 instance_0 : TEXCOORD4;  // Instanced geometry, columns of the world transform.
+    float4 instance_1 : TEXCOORD5;
+    float4 instance_2 : TEXCOORD6;
+#endif
 };
 
 struct VS_OUTPUT {
@@ -101,7 +106,11 @@ VS_OUTPUT main(VS_INPUT IN) {
 		q28.xyzw = mul(float4x4(WindMatrices[0 + offset.x].xyzw, WindMatrices[1 + offset.x].xyzw, WindMatrices[2 + offset.x].xyzw, WindMatrices[3 + offset.x].xyzw), q59.xyzw);
 		r0.xyzw = (IN.blendindexes.x * (q28.xyzw - q59.xyzw)) + q59.xyzw;
 	}
+#ifdef INSTANCED
+    r0.xyz = float3(dot(r0, IN.instance_0), dot(r0, IN.instance_1), dot(r0, IN.instance_2));
+#else
     r0 = mul(r0, TESR_ShadowWorldTransform);
+#endif
 	r0 = mul(r0, TESR_ShadowViewProjTransform);
 	OUT.position = r0;
     OUT.texcoord_0 = r0;
@@ -0,0 +1,230 @@
+#include "Test.h"
+#include "BinkFrameQueue.h"
+#include "BinkFrameQueue.cpp"
+
+/*
+* Stands in for BinkManager::DecodeLoop: every frame is filled with its index, at FrameDuration ms from the previous one.
+*/
+class FakeDecoder {
+public:
+	FakeDecoder(BinkFrameQueue* Queue, UInt32 FramesCount, double FrameDuration) : Queue(Queue), FramesCount(FramesCount), FrameDuration(FrameDuration), Decoded(0) {}
+
+	void Run() {
+		for (UInt32 Index = 0; Index < FramesCount; Index++) {
+			BinkFrameQueue::Frame* Item = Queue->AcquireWrite();
+			if (!Item) return;
+
+			for (UInt32 p = 0; p < BinkFrameQueue::PlanesCount; p++) {
+				UInt32 Pitch = (p == 0 || p == 3) ? 64 : 32;
+				Item->Planes[p].assign(Pitch * 4, (UInt8)(Index + p));
+				Item->Pitches[p] = Pitch;
+			}
+			Item->Index = Index;
+			Item->Time = Index * FrameDuration;
+			Item->Last = Index == FramesCount - 1;
+			Queue->Publish(Item);
+			Decoded++;
+		}
+	}
+
+	BinkFrameQueue*		Queue;
+	UInt32				FramesCount;
+	double				FrameDuration;
+	std::atomic<UInt32>	Decoded;
+};
+
+static bool HasContent(BinkFrameQueue::Frame* Item) {
+
+	for (UInt32 p = 0; p < BinkFrameQueue::PlanesCount; p++) {
+		for (UInt8 Byte : Item->Planes[p]) {
+			if (Byte != (UInt8)(Item->Index + p)) return false;
+		}
+	}
+	return true;
+
+}
+
+/*
+* Waits for a due frame as the render thread gets one every frame, giving up after a second.
+*/
+static BinkFrameQueue::Frame* WaitRead(BinkFrameQueue* Queue, double Now) {
+
+	for (int i = 0; i < 1000; i++) {
+		if (BinkFrameQueue::Frame* Item = Queue->AcquireRead(Now)) return Item;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return NULL;
+
+}
+
+/*
+* A renderer keeping up with the movie shows every frame once, in order, with the content the decoder wrote.
+*/
+TEST(InOrderPresentation) {
+
+	BinkFrameQueue Queue;
+	FakeDecoder Decoder(&Queue, 60, 33.3);
+	std::thread Decoding(&FakeDecoder::Run, &Decoder);
+
+	UInt32 Shown = 0;
+	UInt32 Ordered = 0;
+	UInt32 Intact = 0;
+	bool Last = false;
+	for (UInt32 Index = 0; Index < 60; Index++) {
+		BinkFrameQueue::Frame* Item = WaitRead(&Queue, Index * 33.3 + 1.0);
+		if (!Item) break;
+		Shown++;
+		if (Item->Index == Index) Ordered++;
+		if (HasContent(Item)) Intact++;
+		Last = Item->Last;
+		Queue.Release(Item);
+	}
+	Decoding.join();
+
+	CHECK_EQUAL(Shown, 60u);
+	CHECK_EQUAL(Ordered, 60u);
+	CHECK_EQUAL(Intact, 60u);
+	CHECK(Last);
+	CHECK_EQUAL(Queue.GetDroppedCount(), 0u);
+	CHECK(Queue.AcquireRead(1e9) == NULL);
+
+}
+
+/*
+* The most recent due frame is shown, the older ready ones are dropped, the ones not due yet are kept for later.
+*/
+TEST(StaleFramesDropped) {
+
+	BinkFrameQueue Queue;
+	BinkFrameQueue::Frame* Items[BinkFrameQueue::Slots];
+	for (UInt32 i = 0; i < BinkFrameQueue::Slots; i++) {
+		Items[i] = Queue.AcquireWrite();
+		Items[i]->Index = i;
+		Items[i]->Time = i * 10.0;
+		Items[i]->Last = false;
+	}
+	CHECK(Queue.AcquireRead(100.0) == NULL);		// nothing published yet
+	for (UInt32 i = 0; i < BinkFrameQueue::Slots; i++) Queue.Publish(Items[i]);
+
+	BinkFrameQueue::Frame* Item = Queue.AcquireRead(12.0);
+	CHECK(Item == Items[1]);
+	CHECK_EQUAL(Queue.GetDroppedCount(), 1u);
+	Queue.Release(Item);
+	CHECK(Queue.AcquireRead(12.0) == NULL);
+	Item = Queue.AcquireRead(20.0);
+	CHECK(Item == Items[2]);
+	CHECK_EQUAL(Queue.GetDroppedCount(), 1u);
+	Queue.Release(Item);
+
+	Queue.Reset();
+	CHECK_EQUAL(Queue.GetDroppedCount(), 0u);
+	for (UInt32 i = 0; i < BinkFrameQueue::Slots; i++) CHECK(Queue.AcquireWrite() != NULL);
+
+}
+
+/*
+* A renderer slower than the movie skips frames: the shown ones still go forward, and shown plus dropped frames are all the decoded ones.
+*/
+TEST(SlowRendererDrops) {
+
+	BinkFrameQueue Queue;
+	FakeDecoder Decoder(&Queue, 90, 10.0);
+	std::thread Decoding(&FakeDecoder::Run, &Decoder);
+
+	UInt32 Shown = 0;
+	UInt32 Backwards = 0;
+	SInt32 Previous = -1;
+	bool Last = false;
+	for (double Now = 0.0; !Last && Now < 10000.0; Now += 35.0) {
+		BinkFrameQueue::Frame* Item = WaitRead(&Queue, Now);
+		if (!Item) break;
+		if ((SInt32)Item->Index <= Previous) Backwards++;
+		Previous = Item->Index;
+		Last = Item->Last;
+		Shown++;
+		Queue.Release(Item);
+	}
+	Decoding.join();
+
+	printf("  %u frames decoded, %u shown, %u dropped\n", (unsigned)Decoder.Decoded, (unsigned)Shown, (unsigned)Queue.GetDroppedCount());
+	CHECK(Last);
+	CHECK_EQUAL(Backwards, 0u);
+	CHECK(Queue.GetDroppedCount() > 0);
+	CHECK_EQUAL(Shown + Queue.GetDroppedCount(), Decoder.Decoded);
+
+}
+
+/*
+* The decoder blocked on a full queue (ready frames and one being read) returns NULL when the queue stops.
+*/
+TEST(StopWakesBlockedWriter) {
+
+	BinkFrameQueue Queue;
+	for (UInt32 i = 0; i < BinkFrameQueue::Slots; i++) {
+		BinkFrameQueue::Frame* Item = Queue.AcquireWrite();
+		Item->Index = i;
+		Item->Time = 1000.0 + i;
+		Queue.Publish(Item);
+	}
+	BinkFrameQueue::Frame* Reading = Queue.AcquireRead(1000.0);
+	CHECK(Reading != NULL);
+
+	std::atomic<bool> Returned(false);
+	BinkFrameQueue::Frame* Written = (BinkFrameQueue::Frame*)&Queue;
+	std::thread Decoding([&]() {
+		Written = Queue.AcquireWrite();
+		Returned = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(!Returned);
+
+	Queue.Stop();
+	Decoding.join();
+	CHECK(Returned);
+	CHECK(Written == NULL);
+	CHECK(Queue.IsStopping());
+	CHECK(Queue.AcquireWrite() == NULL);
+
+	Queue.Release(Reading);
+	Queue.Reset();
+	CHECK(!Queue.IsStopping());
+	CHECK(Queue.AcquireWrite() != NULL);
+
+}
+
+/*
+* Releasing the frame being read wakes the blocked decoder with that slot.
+*/
+TEST(ReleaseWakesBlockedWriter) {
+
+	BinkFrameQueue Queue;
+	for (UInt32 i = 0; i < BinkFrameQueue::Slots; i++) {
+		BinkFrameQueue::Frame* Item = Queue.AcquireWrite();
+		Item->Index = i;
+		Item->Time = 0.0;
+		Queue.Publish(Item);
+	}
+	BinkFrameQueue::Frame* Reading = Queue.AcquireRead(0.0);		// drops the first two, which frees their slots
+	CHECK(Reading != NULL);
+	CHECK(Queue.AcquireWrite() != NULL);
+	CHECK(Queue.AcquireWrite() != NULL);
+
+	BinkFrameQueue::Frame* Written = NULL;
+	std::thread Decoding([&]() { Written = Queue.AcquireWrite(); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	Queue.Release(Reading);
+	Decoding.join();
+	CHECK(Written == Reading);
+
+}
+
+int main() {
+
+	RUN(InOrderPresentation);
+	RUN(StaleFramesDropped);
+	RUN(SlowRendererDrops);
+	RUN(StopWakesBlockedWriter);
+	RUN(ReleaseWakesBlockedWriter);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,227 @@
+#include "Test.h"
+#include <random>
+#include "BoundingVolumeHierarchy.h"
+#include "BoundingVolumeHierarchy.cpp"
+
+/*
+* Generated scenes of 10k and 100k spheres spread like the objects of loaded exterior cells: many small ones, a few large ones.
+* Every query of the hierarchy must return exactly the items a linear walk over the same tests returns, before and after the
+* items move (refit) and after items are removed and inserted (rebuild). The timings of both are printed.
+*/
+struct Scene {
+	std::vector<NiBound> Bounds;
+	std::vector<UInt32> Handles;
+	std::vector<bool> Alive;
+	BoundingVolumeHierarchy Tree;
+	std::mt19937 Random;
+
+	Scene(UInt32 Count, UInt32 Seed) : Random(Seed) {
+
+		for (UInt32 i = 0; i < Count; i++) {
+			Bounds.push_back(RandomBound());
+			Alive.push_back(true);
+			Handles.push_back(Tree.Insert((void*)(uintptr_t)(i + 1), Bounds[i]));
+		}
+		Tree.Commit();
+
+	}
+
+	float Uniform(float Min, float Max) { return std::uniform_real_distribution<float>(Min, Max)(Random); }
+
+	NiBound RandomBound() {
+
+		NiBound Bound;
+		Bound.Center = NiPoint3(Uniform(-40000.0f, 40000.0f), Uniform(-40000.0f, 40000.0f), Uniform(-2000.0f, 6000.0f));
+		Bound.Radius = Uniform(0.0f, 1.0f) < 0.95f ? Uniform(5.0f, 300.0f) : Uniform(300.0f, 6000.0f);
+		return Bound;
+
+	}
+
+	template <typename F> std::vector<UInt32> Linear(F Test) {
+
+		std::vector<UInt32> Result;
+		for (UInt32 i = 0; i < Bounds.size(); i++) {
+			if (Alive[i] && Test(Bounds[i])) Result.push_back(i + 1);
+		}
+		return Result;
+
+	}
+};
+
+static std::vector<UInt32> Sorted(std::vector<UInt32> Result) {
+
+	std::sort(Result.begin(), Result.end());
+	return Result;
+
+}
+
+/*
+* Culling planes of a camera looking along Direction (horizontal), normals pointing inside like the game frustum planes.
+*/
+static NiFrustumPlanes MakeFrustum(const NiPoint3& Eye, float Yaw, float Fov, float Near, float Far) {
+
+	NiPoint3 Forward = NiPoint3(cosf(Yaw), sinf(Yaw), 0.0f);
+	NiPoint3 Right = NiPoint3(sinf(Yaw), -cosf(Yaw), 0.0f);
+	NiPoint3 Up = NiPoint3(0.0f, 0.0f, 1.0f);
+	float s = sinf(Fov * 0.5f);
+	float c = cosf(Fov * 0.5f);
+
+	NiFrustumPlanes Planes;
+	Planes.CullingPlanes[NiFrustumPlanes::NearPlane] = NiPlane(Forward, Eye + Forward * Near);
+	Planes.CullingPlanes[NiFrustumPlanes::FarPlane] = NiPlane(-Forward, Eye + Forward * Far);
+	Planes.CullingPlanes[NiFrustumPlanes::LeftPlane] = NiPlane(Right * c + Forward * s, Eye);
+	Planes.CullingPlanes[NiFrustumPlanes::RightPlane] = NiPlane(-Right * c + Forward * s, Eye);
+	Planes.CullingPlanes[NiFrustumPlanes::TopPlane] = NiPlane(-Up * c + Forward * s, Eye);
+	Planes.CullingPlanes[NiFrustumPlanes::BottomPlane] = NiPlane(Up * c + Forward * s, Eye);
+	Planes.ActivePlanes = (1 << NiFrustumPlanes::MaxPlanes) - 1;
+	return Planes;
+
+}
+
+struct Timings {
+	double Tree = 0.0;
+	double Linear = 0.0;
+	UInt32 Queries = 0;
+	UInt32 Mismatches = 0;
+	UInt64 Results = 0;
+};
+
+template <typename F> static double Measure(F Function) {
+
+	auto Start = std::chrono::steady_clock::now();
+	Function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+}
+
+template <typename Q, typename L> static void Compare(Scene& World, Timings& Time, Q Query, L Test) {
+
+	std::vector<UInt32> FromTree, FromLinear;
+	Time.Tree += Measure([&]() { Query([&FromTree](void* Data) { FromTree.push_back((UInt32)(uintptr_t)Data); }); });
+	Time.Linear += Measure([&]() { FromLinear = World.Linear(Test); });
+	if (Sorted(FromTree) != FromLinear) Time.Mismatches++;
+	Time.Queries++;
+	Time.Results += FromLinear.size();
+
+}
+
+static void RunQueries(Scene& World, Timings& Frustum, Timings& Sphere, Timings& Cone, UInt32 Count) {
+
+	for (UInt32 q = 0; q < Count; q++) {
+		NiPoint3 Eye = NiPoint3(World.Uniform(-30000.0f, 30000.0f), World.Uniform(-30000.0f, 30000.0f), World.Uniform(0.0f, 3000.0f));
+		NiFrustumPlanes Planes = MakeFrustum(Eye, World.Uniform(0.0f, 2.0f * D3DX_PI), D3DXToRadian(75.0f), 10.0f, World.Uniform(2000.0f, 20000.0f));
+		if (q % 4 == 0) Planes.ActivePlanes &= ~(1 << NiFrustumPlanes::FarPlane);	// cascades without far plane
+		Compare(World, Frustum,
+			[&](auto Function) { World.Tree.QueryFrustum(&Planes, Function); },
+			[&](NiBound& Bound) { return Bound.WithinFrustum(&Planes); });
+
+		float Radius = World.Uniform(100.0f, 8000.0f);
+		Compare(World, Sphere,
+			[&](auto Function) { World.Tree.QuerySphere(Eye, Radius, Function); },
+			[&](NiBound& Bound) { return BoundingVolumeHierarchy::SphereInSphere(Bound, Eye, Radius); });
+
+		NiPoint3 Direction = NiPoint3(World.Uniform(-1.0f, 1.0f), World.Uniform(-1.0f, 1.0f), World.Uniform(-1.0f, 0.2f));
+		Direction = Direction / Direction.Length();
+		float Angle = World.Uniform(0.1f, 1.2f);
+		float Range = World.Uniform(500.0f, 10000.0f);
+		Compare(World, Cone,
+			[&](auto Function) { World.Tree.QueryCone(Eye, Direction, Angle, Range, Function); },
+			[&](NiBound& Bound) { return BoundingVolumeHierarchy::SphereInCone(Bound.Center, Bound.Radius, Eye, Direction, sinf(Angle), cosf(Angle), Range); });
+	}
+
+}
+
+static void Report(const char* Name, const Timings& Time) {
+
+	printf("  %-8s %5u queries, %8.1f results per query, tree %8.3f ms, linear %8.3f ms (x%.1f)\n", Name, (unsigned)Time.Queries, (double)Time.Results / Time.Queries,
+		Time.Tree, Time.Linear, Time.Linear / max(Time.Tree, 0.001));
+
+}
+
+static void RunScene(UInt32 Count, UInt32 Queries) {
+
+	Scene World(Count, Count);
+	Timings Frustum, Sphere, Cone;
+	printf("  %u items, %u nodes\n", (unsigned)World.Tree.GetItemsCount(), (unsigned)World.Tree.GetNodesCount());
+	CHECK_EQUAL(World.Tree.GetItemsCount(), Count);
+	RunQueries(World, Frustum, Sphere, Cone, Queries);
+
+	// moved items are refitted, the topology is kept
+	for (UInt32 i = 0; i < Count; i += 3) {
+		NiBound& Bound = World.Bounds[i];
+		Bound.Center = Bound.Center + NiPoint3(World.Uniform(-500.0f, 500.0f), World.Uniform(-500.0f, 500.0f), World.Uniform(-50.0f, 50.0f));
+		World.Tree.Move(World.Handles[i], Bound);
+	}
+	UInt32 Rebuilds = World.Tree.Rebuilds;
+	UInt32 Nodes = World.Tree.GetNodesCount();
+	World.Tree.Commit();
+	CHECK_EQUAL(World.Tree.Rebuilds, Rebuilds);
+	CHECK_EQUAL(World.Tree.GetNodesCount(), Nodes);
+	RunQueries(World, Frustum, Sphere, Cone, Queries);
+
+	// removed and inserted items rebuild the tree, the handles of removed items are reused
+	for (UInt32 i = 1; i < Count; i += 5) {
+		World.Tree.Remove(World.Handles[i]);
+		World.Alive[i] = false;
+	}
+	for (UInt32 i = 0; i < Count / 10; i++) {
+		World.Bounds.push_back(World.RandomBound());
+		World.Alive.push_back(true);
+		World.Handles.push_back(World.Tree.Insert((void*)(uintptr_t)World.Bounds.size(), World.Bounds.back()));
+	}
+	World.Tree.Commit();
+	CHECK_EQUAL(World.Tree.Rebuilds, Rebuilds + 1);
+	CHECK_EQUAL(World.Tree.GetItemsCount(), Count - Count / 5 + Count / 10);
+	RunQueries(World, Frustum, Sphere, Cone, Queries);
+
+	Report("frustum", Frustum);
+	Report("sphere", Sphere);
+	Report("cone", Cone);
+	CHECK_EQUAL(Frustum.Mismatches, 0);
+	CHECK_EQUAL(Sphere.Mismatches, 0);
+	CHECK_EQUAL(Cone.Mismatches, 0);
+
+}
+
+TEST(Scene10k) {
+
+	RunScene(10000, 200);
+
+}
+
+TEST(Scene100k) {
+
+	RunScene(100000, 50);
+
+}
+
+TEST(EmptyAndCleared) {
+
+	BoundingVolumeHierarchy Tree;
+	NiFrustumPlanes Planes = MakeFrustum(NiPoint3(0.0f, 0.0f, 0.0f), 0.0f, 1.0f, 1.0f, 100.0f);
+	UInt32 Found = 0;
+	Tree.Commit();
+	Tree.QueryFrustum(&Planes, [&Found](void* Data) { Found++; });
+	NiBound Bound;
+	Bound.Center = NiPoint3(50.0f, 0.0f, 0.0f);
+	Bound.Radius = 1.0f;
+	Tree.Insert(&Found, Bound);
+	Tree.Commit();
+	Tree.QueryFrustum(&Planes, [&Found](void* Data) { Found++; });
+	CHECK_EQUAL(Found, 1);
+	Tree.Clear();
+	Tree.Commit();
+	Tree.QueryFrustum(&Planes, [&Found](void* Data) { Found++; });
+	CHECK_EQUAL(Found, 1);
+	CHECK_EQUAL(Tree.GetItemsCount(), 0);
+
+}
+
+int main() {
+
+	RUN(Scene10k);
+	RUN(Scene100k);
+	RUN(EmptyAndCleared);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,192 @@
+#include "Test.h"
+
+/*
+* The indexes written once the queue is flushed.
+*/
+class ShaderCache {
+public:
+	ShaderCache() : Flushes(0) {}
+
+	void			Flush() { Flushes++; }
+
+	UInt32			Flushes;
+
+	static ShaderCache Shaders;
+	static ShaderCache Effects;
+};
+ShaderCache ShaderCache::Shaders;
+ShaderCache ShaderCache::Effects;
+
+#include "CompileQueue.h"
+#include "CompileQueue.cpp"
+
+/*
+* Stands in for the shader compiler: a job takes Duration ms and returns Result, the start and end of each job are logged in order.
+*/
+class StubCompiler {
+public:
+	CompileQueue::WorkFunction Job(const std::string& Name, UInt32 Duration, bool Result = true) {
+		return [this, Name, Duration, Result]() {
+			Record("start " + Name);
+			std::this_thread::sleep_for(std::chrono::milliseconds(Duration));
+			Record("end " + Name);
+			return Result;
+		};
+	}
+
+	void Record(const std::string& Event) {
+		std::lock_guard<std::mutex> Guard(Lock);
+		Events.push_back(Event);
+		Threads.push_back(std::this_thread::get_id());
+	}
+
+	SInt32 IndexOf(const std::string& Event) {
+		std::lock_guard<std::mutex> Guard(Lock);
+		auto Item = std::find(Events.begin(), Events.end(), Event);
+		return Item != Events.end() ? (SInt32)(Item - Events.begin()) : -1;
+	}
+
+	// the job After started once Before had ended
+	bool StartsAfter(const std::string& After, const std::string& Before) {
+		SInt32 Start = IndexOf("start " + After);
+		SInt32 End = IndexOf("end " + Before);
+		return Start != -1 && End != -1 && End < Start;
+	}
+
+	std::mutex						Lock;
+	std::vector<std::string>		Events;
+	std::vector<std::thread::id>	Threads;
+};
+
+/*
+* A job starts once all its dependencies have finished, failed ones included; the jobs without dependencies run side by side.
+*/
+TEST(DependenciesReleaseInOrder) {
+
+	StubCompiler Compiler;
+	{
+		CompileQueue Queue(4);
+		UInt32 Helpers = Queue.Enqueue("Helpers", Compiler.Job("Helpers", 30));
+		UInt32 Depth = Queue.Enqueue("Depth", Compiler.Job("Depth", 10, false));
+		UInt32 Water = Queue.Enqueue("Water", Compiler.Job("Water", 10), nullptr, { Helpers, Depth });
+		Queue.Enqueue("Underwater", Compiler.Job("Underwater", 1), nullptr, { Water });
+		Queue.Enqueue("Sky", Compiler.Job("Sky", 1), nullptr, { Helpers });
+		Queue.Enqueue("Grass", Compiler.Job("Grass", 30));
+		Queue.Flush();
+
+		CHECK_EQUAL(Compiler.Events.size(), 12);
+		CHECK(Compiler.StartsAfter("Water", "Helpers"));
+		CHECK(Compiler.StartsAfter("Water", "Depth"));
+		CHECK(Compiler.StartsAfter("Underwater", "Water"));
+		CHECK(Compiler.StartsAfter("Sky", "Helpers"));
+		CHECK(Compiler.IndexOf("start Grass") < Compiler.IndexOf("end Helpers"));		// independent of the others
+		CHECK(Queue.GetPeakConcurrency() >= 2);
+	}
+
+	// a dependency finished before the job is enqueued doesn't hold it
+	CompileQueue Queue(2);
+	UInt32 First = Queue.Enqueue("First", Compiler.Job("First", 1));
+	while (Compiler.IndexOf("end First") == -1) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	Queue.Enqueue("Second", Compiler.Job("Second", 1), nullptr, { First });
+	Queue.Flush();
+	CHECK(Compiler.StartsAfter("Second", "First"));
+
+}
+
+/*
+* The commits run on the thread calling Flush in the order the jobs were enqueued, whatever the order their work finished in,
+* with the result of their work. The cache indexes are written once the commits are done.
+*/
+TEST(CommitsInEnqueueOrder) {
+
+	StubCompiler Compiler;
+	CompileQueue Queue(4);
+	std::vector<UInt32> Committed;
+	std::vector<bool> Results;
+	std::vector<std::thread::id> CommitThreads;
+	UInt32 Flushes = ShaderCache::Shaders.Flushes;
+
+	for (UInt32 i = 0; i < 16; i++) {
+		std::string Name = "Shader" + std::to_string(i);
+		Queue.Enqueue(Name.c_str(), Compiler.Job(Name, i ? 1 : 100, i % 3 != 0), [&, i](bool Result) {
+			Committed.push_back(i);
+			Results.push_back(Result);
+			CommitThreads.push_back(std::this_thread::get_id());
+			CHECK_EQUAL(ShaderCache::Shaders.Flushes, Flushes);
+		});
+	}
+	Queue.Enqueue("NoCommit", Compiler.Job("NoCommit", 1));
+	Queue.Flush();
+
+	CHECK_EQUAL(Committed.size(), 16);
+	UInt32 Ordered = 0;
+	UInt32 Matching = 0;
+	for (UInt32 i = 0; i < Committed.size(); i++) {
+		if (Committed[i] == i) Ordered++;
+		if (Results[i] == (Committed[i] % 3 != 0)) Matching++;
+		CHECK(CommitThreads[i] == std::this_thread::get_id());
+	}
+	CHECK_EQUAL(Ordered, 16);
+	CHECK_EQUAL(Matching, 16);
+	CHECK(Compiler.IndexOf("end Shader15") < Compiler.IndexOf("end Shader0"));	// the work finished in another order
+	CHECK_EQUAL(ShaderCache::Shaders.Flushes, Flushes + 1);
+	CHECK_EQUAL(ShaderCache::Effects.Flushes, Flushes + 1);
+
+	// the queue is empty after a flush, nothing is committed twice
+	Queue.Flush();
+	CHECK_EQUAL(Committed.size(), 16);
+
+}
+
+/*
+* Without workers the thread calling Flush runs every job, one at a time and in dependency order, then commits them.
+*/
+TEST(FlushWithoutWorkers) {
+
+	StubCompiler Compiler;
+	CompileQueue Queue(0);
+	CHECK_EQUAL(Queue.GetWorkersCount(), 0);
+	std::vector<std::string> Committed;
+
+	UInt32 Helpers = Queue.Enqueue("Helpers", Compiler.Job("Helpers", 1), [&](bool Result) { Committed.push_back("Helpers"); });
+	Queue.Enqueue("Water", Compiler.Job("Water", 1), [&](bool Result) { Committed.push_back("Water"); }, { Helpers });
+	Queue.Enqueue("Sky", nullptr, [&](bool Result) { Committed.push_back(Result ? "Sky" : "Sky failed"); });
+	CHECK(Compiler.Events.empty());		// nothing runs before the flush
+	Queue.Flush();
+
+	std::vector<std::string> Expected = { "start Helpers", "end Helpers", "start Water", "end Water" };
+	CHECK(Compiler.Events == Expected);
+	for (std::thread::id Thread : Compiler.Threads) CHECK(Thread == std::this_thread::get_id());
+	CHECK(Committed == std::vector<std::string>({ "Helpers", "Water", "Sky" }));
+	CHECK_EQUAL(Queue.GetPeakConcurrency(), 1);
+
+	// the ids start over after a flush
+	UInt32 Next = Queue.Enqueue("Next", Compiler.Job("Next", 1));
+	CHECK_EQUAL(Next, 0);
+	Queue.Flush();
+	CHECK_EQUAL(Compiler.Events.size(), 6);
+
+}
+
+/*
+* By default the render thread is left out of the hardware threads, with at least one worker.
+*/
+TEST(DefaultWorkers) {
+
+	CompileQueue Queue;
+	UInt32 Expected = max(std::thread::hardware_concurrency(), 2u) - 1;
+	CHECK_EQUAL(Queue.GetWorkersCount(), Expected);
+	CHECK(Queue.GetWorkersCount() >= 1);
+
+}
+
+int main() {
+
+	RUN(DependenciesReleaseInOrder);
+	RUN(CommitsInEnqueueOrder);
+	RUN(FlushWithoutWorkers);
+	RUN(DefaultWorkers);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,479 @@
+#include "Test.h"
+#include "MockDevice.h"
+#include <random>
+#include "StateCapture.cpp"
+#include "Device.h"
+#include "Device.cpp"
+
+static UInt32 ReleasedResources = 0;
+
+static void ReleaseResources() {
+
+	ReleasedResources++;
+
+}
+
+/*
+* Backend standing in for the game device: counts the calls by method name as NullDevice and holds the pipeline state it was given, keyed by
+* "<state> <slot>", so a test can check that the state of the device is the one requested whatever the proxy dropped.
+* States set while a state block is recorded go to the block and reach the device when the block is applied.
+*/
+class MockStateBlock;
+
+class MockDevice : public NullDevice {
+public:
+	typedef std::map<std::string, UINT_PTR> StateMap;
+
+	MockDevice(bool Ex) : IsEx(Ex), Recording(NULL), Created(NULL) {}
+
+	HRESULT SetState(const char* Name, const std::string& Key, UINT_PTR Value);
+	UInt32 StateCalls();
+
+	bool					IsEx;
+	StateMap				State;
+	MockStateBlock*			Recording;
+	MockStateBlock*			Created;	// last state block created, the proxy returns it wrapped
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) {
+		Call(__func__);
+		if (riid == __uuidof(IUnknown) || riid == __uuidof(IDirect3DDevice9) || (IsEx && riid == __uuidof(IDirect3DDevice9Ex))) {
+			*ppvObj = this;
+			AddRef();
+			return S_OK;
+		}
+		*ppvObj = NULL;
+		return E_NOINTERFACE;
+	}
+
+	STDMETHOD(SetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD Value) { return SetState(__func__, "RenderState " + std::to_string(State), Value); }
+	STDMETHOD(SetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9* pTexture) { return SetState(__func__, "Texture " + std::to_string(Stage), (UINT_PTR)pTexture); }
+	STDMETHOD(SetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) { return SetState(__func__, "TextureStageState " + std::to_string(Stage) + " " + std::to_string(Type), Value); }
+	STDMETHOD(SetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) { return SetState(__func__, "SamplerState " + std::to_string(Sampler) + " " + std::to_string(Type), Value); }
+	STDMETHOD(SetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) {
+		SetState(__func__, "StreamOffset " + std::to_string(StreamNumber), OffsetInBytes);
+		SetState(NULL, "StreamStride " + std::to_string(StreamNumber), Stride);
+		return SetState(NULL, "StreamSource " + std::to_string(StreamNumber), (UINT_PTR)pStreamData);
+	}
+	STDMETHOD(SetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT Setting) { return SetState(__func__, "StreamFrequency " + std::to_string(StreamNumber), Setting); }
+	STDMETHOD(SetIndices)(THIS_ IDirect3DIndexBuffer9* pIndexData) { return SetState(__func__, "Indices", (UINT_PTR)pIndexData); }
+	STDMETHOD(SetVertexShader)(THIS_ IDirect3DVertexShader9* pShader) { return SetState(__func__, "VertexShader", (UINT_PTR)pShader); }
+	STDMETHOD(SetPixelShader)(THIS_ IDirect3DPixelShader9* pShader) { return SetState(__func__, "PixelShader", (UINT_PTR)pShader); }
+	STDMETHOD(SetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9* pDecl) {
+		SetState(NULL, "FVF", 0);	// the FVF of a declaration isn't known here
+		return SetState(__func__, "VertexDeclaration", (UINT_PTR)pDecl);
+	}
+	STDMETHOD(SetFVF)(THIS_ DWORD FVF) {
+		SetState(NULL, "VertexDeclaration", 0x7F000000 + FVF);	// the runtime builds a declaration for the FVF
+		return SetState(__func__, "FVF", FVF);
+	}
+	STDMETHOD(CreateStateBlock)(THIS_ D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB);
+	STDMETHOD(BeginStateBlock)(THIS);
+	STDMETHOD(EndStateBlock)(THIS_ IDirect3DStateBlock9** ppSB);
+};
+
+class MockStateBlock : public IDirect3DStateBlock9 {
+public:
+	MockStateBlock(MockDevice* Device) : Device(Device), References(1) {}
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) {
+		ULONG Count = --References;
+		if (!Count) delete this;
+		return Count;
+	}
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) { *ppDevice = Device; return D3D_OK; }
+	STDMETHOD(Capture)(THIS) {
+		for (auto& Entry : Changes) Entry.second = Device->State[Entry.first];
+		return D3D_OK;
+	}
+	STDMETHOD(Apply)(THIS) {
+		Device->Calls["Apply"]++;
+		for (const auto& Entry : Changes) Device->State[Entry.first] = Entry.second;
+		return D3D_OK;
+	}
+
+	MockDevice*				Device;
+	ULONG					References;
+	MockDevice::StateMap	Changes;
+};
+
+HRESULT MockDevice::SetState(const char* Name, const std::string& Key, UINT_PTR Value) {
+
+	if (Name) Calls[Name]++;
+	if (FAILED(Result)) return Result;
+	if (Recording)
+		Recording->Changes[Key] = Value;
+	else
+		State[Key] = Value;
+	return Result;
+
+}
+
+HRESULT MockDevice::CreateStateBlock(D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB) {
+
+	Call(__func__);
+	MockStateBlock* StateBlock = new MockStateBlock(this);
+	for (const auto& Entry : State) StateBlock->Changes[Entry.first] = Entry.second;
+	*ppSB = Created = StateBlock;
+	return D3D_OK;
+
+}
+
+HRESULT MockDevice::BeginStateBlock() {
+
+	Call(__func__);
+	Recording = new MockStateBlock(this);
+	return D3D_OK;
+
+}
+
+HRESULT MockDevice::EndStateBlock(IDirect3DStateBlock9** ppSB) {
+
+	Call(__func__);
+	*ppSB = Recording;
+	Recording = NULL;
+	return D3D_OK;
+
+}
+
+UInt32 MockDevice::StateCalls() {
+
+	const char* Names[] = { "SetRenderState", "SetTexture", "SetTextureStageState", "SetSamplerState", "SetStreamSource", "SetStreamSourceFreq",
+		"SetIndices", "SetVertexShader", "SetPixelShader", "SetVertexDeclaration", "SetFVF" };
+	UInt32 Count = 0;
+	for (const char* Name : Names) Count += Calls[Name];
+	return Count;
+
+}
+
+#define TEXTURE(i)		((IDirect3DBaseTexture9*)(UINT_PTR)(0x1000 + (i)))
+#define BUFFER(i)		((IDirect3DVertexBuffer9*)(UINT_PTR)(0x2000 + (i)))
+#define INDICES(i)		((IDirect3DIndexBuffer9*)(UINT_PTR)(0x3000 + (i)))
+#define VSHADER(i)		((IDirect3DVertexShader9*)(UINT_PTR)(0x4000 + (i)))
+#define PSHADER(i)		((IDirect3DPixelShader9*)(UINT_PTR)(0x5000 + (i)))
+#define DECLARATION(i)	((IDirect3DVertexDeclaration9*)(UINT_PTR)(0x6000 + (i)))
+
+TEST(RedundantStatesAreFiltered) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	for (int i = 0; i < 3; i++) {
+		Proxy.SetRenderState(D3DRS_ZENABLE, 1);
+		Proxy.SetSamplerState(0, D3DSAMP_ADDRESSU, 3);
+		Proxy.SetSamplerState(D3DVERTEXTEXTURESAMPLER0, D3DSAMP_ADDRESSU, 3);
+		Proxy.SetTexture(0, TEXTURE(0));
+		Proxy.SetTexture(D3DDMAPSAMPLER, TEXTURE(1));
+		Proxy.SetTextureStageState(0, D3DTSS_COLOROP, 4);
+		Proxy.SetStreamSource(0, BUFFER(0), 0, 32);
+		Proxy.SetStreamSourceFreq(0, 1);
+		Proxy.SetIndices(INDICES(0));
+		Proxy.SetVertexShader(VSHADER(0));
+		Proxy.SetPixelShader(PSHADER(0));
+		Proxy.SetVertexDeclaration(DECLARATION(0));
+	}
+	CHECK_EQUAL(Backend.StateCalls(), 12);
+	CHECK_EQUAL(Backend.Calls["SetSamplerState"], 2);	// the vertex sampler is its own slot
+	CHECK_EQUAL(Backend.Calls["SetTexture"], 2);
+
+	// a different value, offset or stride is forwarded
+	Proxy.SetRenderState(D3DRS_ZENABLE, 0);
+	Proxy.SetStreamSource(0, BUFFER(0), 16, 32);
+	Proxy.SetStreamSource(0, BUFFER(0), 16, 16);
+	Proxy.SetSamplerState(1, D3DSAMP_ADDRESSU, 3);
+	CHECK_EQUAL(Backend.StateCalls(), 16);
+	CHECK_EQUAL(Backend.State["RenderState 7"], 0);
+	CHECK_EQUAL(Backend.State["StreamStride 0"], 16);
+
+	// states outside the shadow are always forwarded
+	Proxy.SetTexture(100, TEXTURE(0));
+	Proxy.SetTexture(100, TEXTURE(0));
+	Proxy.SetStreamSource(TESRDirect3DDevice9::StreamsCount, BUFFER(0), 0, 0);
+	Proxy.SetStreamSource(TESRDirect3DDevice9::StreamsCount, BUFFER(0), 0, 0);
+	CHECK_EQUAL(Backend.StateCalls(), 20);
+
+}
+
+TEST(CountersOfLastFrame) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	for (int i = 0; i < 10; i++) Proxy.SetRenderState(D3DRS_CULLMODE, 2);
+	Proxy.SetPixelShader(PSHADER(0));
+	Proxy.Present(NULL, NULL, NULL, NULL);
+	CHECK_EQUAL(Proxy.LastFrame.Forwarded, 2);
+	CHECK_EQUAL(Proxy.LastFrame.Filtered, 9);
+	Proxy.PresentEx(NULL, NULL, NULL, NULL, 0);
+	CHECK_EQUAL(Proxy.LastFrame.Forwarded, 0);
+	CHECK_EQUAL(Proxy.LastFrame.Filtered, 0);
+
+}
+
+TEST(InvalidationForwardsTheNextCall) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	TESRDirect3DDevice9::AddResetCallback(ReleaseResources);
+	Proxy.SetRenderState(D3DRS_ZWRITEENABLE, 1);
+	Proxy.Present(NULL, NULL, NULL, NULL);
+	Proxy.SetRenderState(D3DRS_ZWRITEENABLE, 1);
+	CHECK_EQUAL(Backend.Calls["SetRenderState"], 2);
+
+	Proxy.Reset(NULL);
+	Proxy.SetRenderState(D3DRS_ZWRITEENABLE, 1);
+	CHECK_EQUAL(Backend.Calls["SetRenderState"], 3);
+	CHECK_EQUAL(ReleasedResources, 1);
+	Proxy.ResetEx(NULL, NULL);
+	Proxy.SetRenderState(D3DRS_ZWRITEENABLE, 1);
+	CHECK_EQUAL(Backend.Calls["SetRenderState"], 4);
+	CHECK_EQUAL(ReleasedResources, 2);
+
+	// a state block applied through the proxy changes the device behind the shadow
+	IDirect3DStateBlock9* StateBlock = NULL;
+	Proxy.CreateStateBlock(D3DSBT_ALL, &StateBlock);
+	Proxy.SetRenderState(D3DRS_ZWRITEENABLE, 0);
+	StateBlock->Apply();
+	CHECK_EQUAL(Backend.State["RenderState 14"], 1);
+	Proxy.SetRenderState(D3DRS_ZWRITEENABLE, 0);
+	CHECK_EQUAL(Backend.State["RenderState 14"], 0);
+	IDirect3DDevice9* Owner = NULL;
+	StateBlock->GetDevice(&Owner);
+	CHECK(Owner == &Proxy);
+	StateBlock->Release();
+
+}
+
+TEST(NothingFilteredWhileRecording) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	Proxy.SetRenderState(D3DRS_ALPHABLENDENABLE, 1);
+	Proxy.SetTexture(3, TEXTURE(3));
+
+	IDirect3DStateBlock9* StateBlock = NULL;
+	Proxy.BeginStateBlock();
+	Proxy.SetRenderState(D3DRS_ALPHABLENDENABLE, 1);	// must be recorded even if the device already has it
+	Proxy.SetRenderState(D3DRS_ALPHATESTENABLE, 1);
+	Proxy.SetTexture(3, TEXTURE(4));
+	Proxy.EndStateBlock(&StateBlock);
+	CHECK_EQUAL(Backend.Calls["SetRenderState"], 3);
+	CHECK_EQUAL(Backend.Calls["SetTexture"], 2);
+
+	// recording didn't change the device, the shadow is still right
+	Proxy.SetRenderState(D3DRS_ALPHABLENDENABLE, 1);
+	Proxy.SetTexture(3, TEXTURE(3));
+	CHECK_EQUAL(Backend.Calls["SetRenderState"], 3);
+	CHECK_EQUAL(Backend.Calls["SetTexture"], 2);
+
+	Proxy.SetRenderState(D3DRS_ALPHABLENDENABLE, 0);
+	StateBlock->Apply();
+	Proxy.SetRenderState(D3DRS_ALPHABLENDENABLE, 0);
+	Proxy.SetTexture(3, TEXTURE(3));
+	CHECK_EQUAL(Backend.State["RenderState 27"], 0);
+	CHECK_EQUAL(Backend.State["Texture 3"], (UINT_PTR)TEXTURE(3));
+	StateBlock->Release();
+
+}
+
+TEST(FailedCallsAreNotTracked) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	Backend.Result = D3DERR_INVALIDCALL;
+	CHECK(FAILED(Proxy.SetRenderState(D3DRS_ZENABLE, 1)));
+	CHECK(FAILED(Proxy.SetStreamSource(1, BUFFER(1), 0, 12)));
+	Backend.Result = D3D_OK;
+	Proxy.SetRenderState(D3DRS_ZENABLE, 1);
+	Proxy.SetStreamSource(1, BUFFER(1), 0, 12);
+	CHECK_EQUAL(Backend.Calls["SetRenderState"], 2);
+	CHECK_EQUAL(Backend.Calls["SetStreamSource"], 2);
+	CHECK_EQUAL(Backend.State["RenderState 7"], 1);
+
+}
+
+TEST(ExInterfaceOnlyWithExDevice) {
+
+	for (int Ex = 0; Ex < 2; Ex++) {
+		MockDevice Backend(Ex == 1);
+		TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+		void* Interface = NULL;
+		CHECK(SUCCEEDED(Proxy.QueryInterface(IID_IDirect3DDevice9, &Interface)));
+		CHECK(Interface == &Proxy);
+		HRESULT Result = Proxy.QueryInterface(IID_IDirect3DDevice9Ex, &Interface);
+		CHECK_EQUAL(SUCCEEDED(Result), Ex == 1);
+		CHECK(Interface == (Ex ? &Proxy : NULL));
+		CHECK_EQUAL(Backend.References, 1u + 1 + Ex);	// the temporary reference of the Ex check is released
+
+		// other interfaces are answered by the device
+		CHECK(FAILED(Proxy.QueryInterface(IID_IDirect3DStateBlock9, &Interface)));
+	}
+
+}
+
+TEST(DeclarationAndFVFInvalidateEachOther) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	Proxy.SetVertexDeclaration(DECLARATION(0));
+	Proxy.SetFVF(0x142);
+	Proxy.SetVertexDeclaration(DECLARATION(0));	// the FVF replaced the declaration
+	CHECK_EQUAL(Backend.Calls["SetVertexDeclaration"], 2);
+	Proxy.SetFVF(0x142);	// and the declaration replaced the FVF
+	CHECK_EQUAL(Backend.Calls["SetFVF"], 2);
+	Proxy.SetFVF(0x142);
+	CHECK_EQUAL(Backend.Calls["SetFVF"], 2);
+	CHECK_EQUAL(Backend.State["FVF"], 0x142);
+
+}
+
+/*
+* Random state calls mixed with frames, resets and state blocks: after every call the device must hold the last requested value
+* of every state, i.e. the proxy never drops a call that changes the state.
+*/
+TEST(RandomSequenceKeepsDeviceState) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	std::mt19937 Random(21);
+	MockDevice::StateMap Expected;
+	IDirect3DStateBlock9* StateBlock = NULL;
+	Proxy.CreateStateBlock(D3DSBT_ALL, &StateBlock);
+	UInt32 StateCalls = 0, Mismatches = 0;
+
+	for (UInt32 i = 0; i < 200000; i++) {
+		UInt32 Action = Random() % 1000;
+		UInt32 Value = Random() % 3;
+		UInt32 Slot = Random() % 4;
+		if (Action < 300) {
+			Proxy.SetRenderState((D3DRENDERSTATETYPE)(7 + Slot), Value);
+			Expected["RenderState " + std::to_string(7 + Slot)] = Value;
+		}
+		else if (Action < 500) {
+			Proxy.SetSamplerState(Slot, D3DSAMP_MINFILTER, Value);
+			Expected["SamplerState " + std::to_string(Slot) + " 6"] = Value;
+		}
+		else if (Action < 650) {
+			Proxy.SetTexture(Slot, TEXTURE(Value));
+			Expected["Texture " + std::to_string(Slot)] = (UINT_PTR)TEXTURE(Value);
+		}
+		else if (Action < 750) {
+			Proxy.SetStreamSource(0, BUFFER(Value), Slot * 16, 32);
+			Expected["StreamSource 0"] = (UINT_PTR)BUFFER(Value);
+			Expected["StreamOffset 0"] = Slot * 16;
+			Expected["StreamStride 0"] = 32;
+		}
+		else if (Action < 850) {
+			Proxy.SetPixelShader(PSHADER(Value));
+			Expected["PixelShader"] = (UINT_PTR)PSHADER(Value);
+		}
+		else if (Action < 900) {
+			Proxy.SetFVF(0x100 + Value);
+			Expected["FVF"] = 0x100 + Value;
+			Expected["VertexDeclaration"] = 0x7F000000 + 0x100 + Value;
+		}
+		else if (Action < 950) {
+			Proxy.SetVertexDeclaration(DECLARATION(Value));
+			Expected["VertexDeclaration"] = (UINT_PTR)DECLARATION(Value);
+			Expected["FVF"] = 0;
+		}
+		else if (Action < 990) {
+			Proxy.Present(NULL, NULL, NULL, NULL);
+		}
+		else if (Action < 995) {
+			StateBlock->Capture();
+		}
+		else {
+			StateBlock->Apply();
+			for (const auto& Entry : Backend.Created->Changes) Expected[Entry.first] = Entry.second;
+		}
+		if (Action < 950) StateCalls++;
+		if (Backend.State != Expected) Mismatches++;
+	}
+	StateBlock->Release();
+	printf("  %u of %u state calls forwarded\n", (unsigned)Backend.StateCalls(), (unsigned)StateCalls);
+	CHECK_EQUAL(Mismatches, 0);
+	CHECK(Backend.StateCalls() < StateCalls);
+
+}
+
+/*
+* Without filtering the proxy forwards every call, it still runs the reset callbacks.
+*/
+TEST(UnfilteredProxyForwardsAll) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, false);
+	for (int i = 0; i < 3; i++) {
+		Proxy.SetRenderState(D3DRS_ZENABLE, 1);
+		Proxy.SetTexture(0, TEXTURE(0));
+		Proxy.SetStreamSource(0, BUFFER(0), 0, 32);
+	}
+	CHECK_EQUAL(Backend.StateCalls(), 9);
+	Proxy.Present(NULL, NULL, NULL, NULL);
+	CHECK_EQUAL(Proxy.LastFrame.Filtered, 0);
+
+	UInt32 Released = ReleasedResources;
+	Proxy.Reset(NULL);
+	CHECK_EQUAL(ReleasedResources, Released + 1);
+
+}
+
+/*
+* The events captured through the proxy carry the filtered flag, the calls made while a state block is recorded aren't captured.
+*/
+TEST(CapturedEventsAreFlagged) {
+
+	MockDevice Backend(true);
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	std::string FileName = std::string(P_tmpdir) + "/DeviceTest.trsc";
+	StateCapture::Start(1);
+	Proxy.Present(NULL, NULL, NULL, NULL);	// recording starts at the frame boundary
+	Proxy.SetRenderState(D3DRS_ZENABLE, 1);
+	Proxy.SetRenderState(D3DRS_ZENABLE, 1);
+	IDirect3DStateBlock9* StateBlock = NULL;
+	Proxy.BeginStateBlock();
+	Proxy.SetRenderState(D3DRS_ZENABLE, 0);
+	Proxy.EndStateBlock(&StateBlock);
+	StateBlock->Apply();
+	Proxy.DrawPrimitive(D3DPT_TRIANGLELIST, 0, 10);
+	Proxy.Present(NULL, NULL, NULL, NULL);
+	CHECK(StateCapture::Complete);
+	CHECK(StateCapture::Write(FileName.c_str()));
+	StateBlock->Release();
+
+	FILE* File = fopen(FileName.c_str(), "rb");
+	CHECK(File != NULL);
+	if (!File) return;
+	StateCapture::FileHeader Header;
+	fread(&Header, sizeof(Header), 1, File);
+	fseek(File, sizeof(Header) + Header.PassesCount * StateCapture::NameSize + StateCapture::RenderStatesCount * StateCapture::StateNameSize, SEEK_SET);
+	std::vector<StateCapture::Event> Events(Header.EventsCount);
+	fread(Events.data(), sizeof(StateCapture::Event), Events.size(), File);
+	fclose(File);
+	remove(FileName.c_str());
+
+	UInt8 Types[] = { StateCapture::Frame, StateCapture::RenderState, StateCapture::RenderState, StateCapture::StateBlock, StateCapture::Draw };
+	UInt8 Filtered[] = { 0, 0, 1, 0, 0 };
+	CHECK_EQUAL(Events.size(), 5);
+	for (UInt32 i = 0; i < Events.size() && i < 5; i++) {
+		CHECK_EQUAL(Events[i].Type, Types[i]);
+		CHECK_EQUAL(Events[i].Filtered, Filtered[i]);
+	}
+
+}
+
+int main() {
+
+	RUN(RedundantStatesAreFiltered);
+	RUN(CountersOfLastFrame);
+	RUN(InvalidationForwardsTheNextCall);
+	RUN(NothingFilteredWhileRecording);
+	RUN(FailedCallsAreNotTracked);
+	RUN(ExInterfaceOnlyWithExDevice);
+	RUN(DeclarationAndFVFInvalidateEachOther);
+	RUN(RandomSequenceKeepsDeviceState);
+	RUN(UnfilteredProxyForwardsAll);
+	RUN(CapturedEventsAreFlagged);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,385 @@
+#include "Test.h"
+#include "MockDevice.h"
+
+/*
+* The parts of the shader records and managers used by EffectRecord. Only Render runs, the loading code is built against stand-ins
+* doing nothing.
+*/
+#define EffectsPath			"Effects/"
+#define SamplerStatesMax	12
+
+class TextureRecord {
+public:
+	enum TextureRecordType {
+		None,
+		PlanarBuffer,
+		VolumeBuffer,
+		CubeBuffer
+	};
+
+	static TextureRecordType	GetTextureType(UINT Type) { return PlanarBuffer; }
+	bool						BindTexture(const char* Name) { return false; }
+
+	IDirect3DBaseTexture9*		Texture;
+	DWORD						SamplerStates[SamplerStatesMax];
+};
+
+class ShaderValue {
+public:
+	virtual ~ShaderValue() {}
+
+	const char*			Name;
+	UInt32				RegisterIndex;
+	UInt32				RegisterCount;
+};
+
+class ShaderFloatValue : public ShaderValue {
+public:
+	void				GetValueFromConstantTable() {}
+
+	D3DXVECTOR4*		Value = nullptr;
+	D3DXPARAMETER_TYPE	Type;
+};
+
+class ShaderTextureValue : public ShaderValue {
+public:
+	void				GetSamplerStateString(ID3DXBuffer* ShaderSource, UINT32 Index) {}
+	void				GetTextureRecord() {}
+
+	TextureRecord*		Texture = nullptr;
+	TextureRecord::TextureRecordType Type;
+};
+
+class ShaderProgram {
+public:
+	ShaderProgram() : FloatShaderValues(NULL), FloatShaderValuesCount(0), TextureShaderValues(NULL), TextureShaderValuesCount(0) {}
+	virtual ~ShaderProgram() { delete[] FloatShaderValues; delete[] TextureShaderValues; }
+
+	virtual void			SetCT() = 0;
+	virtual void			CreateCT(ID3DXBuffer* ShaderSource, ID3DXConstantTable* ConstantTable) = 0;
+
+	static void				ReportError(HRESULT result) {}
+	static bool				FileExists(const char* path) { return false; }
+	static bool				CheckPreprocessResult(const char* CachedPreprocessPath, ID3DXBuffer* ShaderSource) { return false; }
+	static bool				LoadFileBuffer(const char* Path, ID3DXBuffer** Buffer) { return false; }
+
+	ShaderFloatValue*		FloatShaderValues;
+	UInt32					FloatShaderValuesCount;
+	ShaderTextureValue*		TextureShaderValues;
+	UInt32					TextureShaderValuesCount;
+};
+
+class ShaderCache {
+public:
+	bool				IsEntryValid(const char* Key, UInt64 ConfigHash) { return false; }
+	void				UpdateEntry(const char* Key, const char* SourcePath, UInt64 ConfigHash) {}
+	void				InvalidateEntry(const char* Key) {}
+
+	static UInt64		HashConfig(const char* SourcePath, const char* TemplateName, const D3DXMACRO* Macros, const char* Profile) { return 0; }
+	static ShaderCache	Effects;
+};
+ShaderCache ShaderCache::Effects;
+
+class ShaderArchive {
+public:
+	bool				Find(const char* CompiledPath, UInt64 ConfigHash, ID3DXBuffer** Source, ID3DXBuffer** Binary) { return false; }
+
+	static ShaderArchive Precompiled;
+};
+ShaderArchive ShaderArchive::Precompiled;
+
+HRESULT WINAPI D3DXPreprocessShaderFromFileA(const char* pSrcFile, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, ID3DXBuffer** ppShaderText, ID3DXBuffer** ppErrorMsgs) { return D3DERR_INVALIDCALL; }
+HRESULT WINAPI D3DXCreateEffectCompiler(const char* pSrcData, UINT SrcDataLen, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, DWORD Flags, ID3DXEffectCompiler** ppCompiler, ID3DXBuffer** ppParseErrors) { return D3DERR_INVALIDCALL; }
+HRESULT WINAPI D3DXCreateEffect(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataLen, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, DWORD Flags, ID3DXEffectPool* pPool, ID3DXEffect** ppEffect, ID3DXBuffer** ppCompilationErrors) { return D3DERR_INVALIDCALL; }
+HRESULT WINAPI D3DXCreateEffectFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, DWORD Flags, ID3DXEffectPool* pPool, ID3DXEffect** ppEffect, ID3DXBuffer** ppCompilationErrors) { return D3DERR_INVALIDCALL; }
+
+struct RenderManager {
+	void				SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE State, DWORD Value) {}
+
+	IDirect3DDevice9*	device;
+};
+
+struct SettingManager {
+	bool				GetMenuShaderEnabled(const char* Name) { return true; }
+};
+
+struct MenuInterfaceManager {
+	void				ShowMessage(const char* Message) {}
+};
+
+struct GpuProfiler {
+	UInt32				BeginScope(const char* Name) { return 0; }
+	void				EndScope(UInt32 Index) {}
+};
+
+struct ShaderManager {
+	GpuProfiler			Profiler;
+};
+
+static RenderManager* TheRenderManager = NULL;
+
+#define SURFACE(i)		((IDirect3DSurface9*)(UINT_PTR)(0x1000 + (i)))
+#define TEXTURE(i)		((IDirect3DTexture9*)(UINT_PTR)(0x2000 + (i)))
+
+/*
+* The buffers of the effects chain as TextureManager holds them, the rendered buffer copy is made once until the render target changes.
+*/
+struct TextureManager {
+	void ResolveRenderedBuffer(IDirect3DSurface9* RenderTarget) {
+		if (RenderedBufferValid) return;
+		TheRenderManager->device->StretchRect(RenderTarget, NULL, RenderedSurface, NULL, D3DTEXF_NONE);
+		RenderedBufferValid = true;
+	}
+	void InvalidateRenderedBuffer() { RenderedBufferValid = false; }
+
+	IDirect3DSurface9*	SourceSurface = SURFACE(1);
+	IDirect3DSurface9*	RenderedSurface = SURFACE(2);
+	IDirect3DSurface9*	PingPongSurface = SURFACE(3);
+	IDirect3DTexture9*	SourceTexture = TEXTURE(1);
+	IDirect3DTexture9*	RenderedTexture = TEXTURE(2);
+	IDirect3DTexture9*	PingPongTexture = TEXTURE(3);
+	bool				RenderedBufferValid = false;
+};
+
+static SettingManager* TheSettingManager = NULL;
+static ShaderManager* TheShaderManager = NULL;
+static TextureManager* TheTextureManager = NULL;
+static MenuInterfaceManager* InterfaceManager = NULL;
+
+#include "EffectRecord.h"
+#include "EffectRecord.cpp"
+
+#define RENDERTARGET	SURFACE(0)
+
+static std::vector<std::string> Log;	// the copies, targets, inputs and draws of the passes, in order
+
+static std::string NameOf(const void* Resource) {
+
+	static const std::map<const void*, std::string> Names = {
+		{ NULL, "NULL" }, { RENDERTARGET, "RenderTarget" }, { SURFACE(1), "Source" }, { SURFACE(2), "Rendered" }, { SURFACE(3), "PingPong" },
+		{ TEXTURE(1), "SourceTexture" }, { TEXTURE(2), "RenderedTexture" }, { TEXTURE(3), "PingPongTexture" },
+	};
+	auto Item = Names.find(Resource);
+	return Item != Names.end() ? Item->second : "?";
+
+}
+
+/*
+* Game device counting the calls, and logging those Render decides on.
+*/
+class CopyDevice : public NullDevice {
+public:
+	STDMETHOD(StretchRect)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter) {
+		Log.push_back("StretchRect " + NameOf(pSourceSurface) + " " + NameOf(pDestSurface));
+		return Call(__func__);
+	}
+	STDMETHOD(SetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) {
+		Log.push_back("SetRenderTarget " + NameOf(pRenderTarget));
+		return Call(__func__);
+	}
+	STDMETHOD(SetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9* pTexture) {
+		Log.push_back("SetTexture " + std::to_string(Stage) + " " + NameOf(pTexture));
+		return Call(__func__);
+	}
+	STDMETHOD(DrawPrimitive)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) {
+		Log.push_back("DrawPrimitive");
+		return Call(__func__);
+	}
+};
+
+class MockEffect : public ID3DXEffect {
+public:
+	MockEffect(UINT Passes) : References(1), Passes(Passes) {}
+	virtual ~MockEffect() {}
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) { return --References; }
+	STDMETHOD(GetDesc)(THIS_ D3DXEFFECT_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetParameterDesc)(THIS_ D3DXHANDLE hParameter, D3DXPARAMETER_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetTechniqueDesc)(THIS_ D3DXHANDLE hTechnique, D3DXTECHNIQUE_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetPassDesc)(THIS_ D3DXHANDLE hPass, D3DXPASS_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD_(D3DXHANDLE, GetParameter)(THIS_ D3DXHANDLE hParameter, UINT Index) { return NULL; }
+	STDMETHOD_(D3DXHANDLE, GetTechnique)(THIS_ UINT Index) { return "Technique"; }
+	STDMETHOD_(D3DXHANDLE, GetPass)(THIS_ D3DXHANDLE hTechnique, UINT Index) { return NULL; }
+	STDMETHOD(SetVector)(THIS_ D3DXHANDLE hParameter, CONST D3DXVECTOR4* pVector) { return D3D_OK; }
+	STDMETHOD(SetVectorArray)(THIS_ D3DXHANDLE hParameter, CONST D3DXVECTOR4* pVector, UINT Count) { return D3D_OK; }
+	STDMETHOD(SetMatrix)(THIS_ D3DXHANDLE hParameter, CONST D3DXMATRIX* pMatrix) { return D3D_OK; }
+	STDMETHOD(SetMatrixArray)(THIS_ D3DXHANDLE hParameter, CONST D3DXMATRIX* pMatrix, UINT Count) { return D3D_OK; }
+	STDMETHOD(SetTechnique)(THIS_ D3DXHANDLE hTechnique) { return D3D_OK; }
+	STDMETHOD(Begin)(THIS_ UINT* pPasses, DWORD Flags) { *pPasses = Passes; return D3D_OK; }
+	STDMETHOD(BeginPass)(THIS_ UINT Pass) { return D3D_OK; }
+	STDMETHOD(EndPass)(THIS) { return D3D_OK; }
+	STDMETHOD(End)(THIS) { return D3D_OK; }
+
+	ULONG	References;
+	UINT	Passes;
+};
+
+/*
+* The managers of the game, set up once, and an enabled effect of Passes passes sampling the rendered buffer on sampler 0 if it's set.
+*/
+struct Chain {
+	Chain() {
+		Render.device = &Device;
+		TheRenderManager = &Render;
+		TheSettingManager = &Settings;
+		TheShaderManager = &Shaders;
+		TheTextureManager = &Textures;
+		Log.clear();
+	}
+
+	CopyDevice		Device;
+	RenderManager	Render;
+	SettingManager	Settings;
+	ShaderManager	Shaders;
+	TextureManager	Textures;
+};
+
+struct TestEffect : public EffectRecord {
+	TestEffect(UINT Passes, bool SamplesRendered) : EffectRecord("Test"), Mock(Passes) {
+		Effect = &Mock;
+		Enabled = true;
+		if (SamplesRendered) RenderedBufferSampler = 0;
+	}
+	~TestEffect() { Effect = NULL; }
+
+	/*
+	* As ShaderManager renders the effects chain.
+	*/
+	void RenderChained(Chain& Chain, bool Clear = false) {
+		EffectRecord::Render(&Chain.Device, RENDERTARGET, Chain.Textures.RenderedSurface, 0, Clear, Chain.Textures.SourceSurface);
+	}
+
+	MockEffect	Mock;
+};
+
+static void CheckLog(const std::vector<std::string>& Expected) {
+
+	CHECK(Log == Expected);
+	if (Log != Expected) for (const std::string& Line : Log) printf("  %s\n", Line.c_str());
+
+}
+
+/*
+* The passes ping-pong between the buffer pair and the last one writes to the render target, an effect sampling no buffer copies nothing.
+*/
+TEST(NoBufferSampledNoCopy) {
+
+	Chain Chain;
+	TestEffect Effect(3, false);
+	Effect.RenderChained(Chain);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 0);
+	CheckLog({
+		"SetRenderTarget PingPong", "DrawPrimitive",
+		"SetRenderTarget Rendered", "DrawPrimitive",
+		"SetRenderTarget RenderTarget", "DrawPrimitive",
+	});
+
+}
+
+/*
+* The rendered buffer is copied once for all the passes, each pass then reads the output of the previous one.
+*/
+TEST(RenderedBufferCopiedOnce) {
+
+	Chain Chain;
+	TestEffect Effect(4, true);
+	Effect.RenderChained(Chain);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 1);		// the copy after every pass made 4
+	CheckLog({
+		"StretchRect RenderTarget Rendered",
+		"SetRenderTarget PingPong", "SetTexture 0 RenderedTexture", "DrawPrimitive",
+		"SetRenderTarget Rendered", "SetTexture 0 PingPongTexture", "DrawPrimitive",
+		"SetRenderTarget PingPong", "SetTexture 0 RenderedTexture", "DrawPrimitive",
+		"SetRenderTarget RenderTarget", "SetTexture 0 PingPongTexture", "DrawPrimitive",
+	});
+	CHECK(!Chain.Textures.RenderedBufferValid);
+
+	// the next effect of the chain reads what the previous one wrote to the render target
+	TestEffect Next(1, true);
+	Next.RenderChained(Chain);
+	TestEffect Unsampled(2, false);
+	Unsampled.RenderChained(Chain);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 2);
+
+}
+
+/*
+* An effect sampling the source buffer has the render target copied there, which also feeds its first pass.
+*/
+TEST(SourceBufferCopiedOnce) {
+
+	Chain Chain;
+	TestEffect Effect(2, true);
+	Effect.HasSourceBuffer = true;
+	Effect.RenderChained(Chain);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 1);
+	CheckLog({
+		"StretchRect RenderTarget Source",
+		"SetRenderTarget PingPong", "SetTexture 0 SourceTexture", "DrawPrimitive",
+		"SetRenderTarget RenderTarget", "SetTexture 0 PingPongTexture", "DrawPrimitive",
+	});
+
+}
+
+/*
+* The target of a pass that discards pixels is seeded with the previous output, unless the passes clear their target.
+*/
+TEST(DiscardingPassesSeeded) {
+
+	Chain Chain;
+	TestEffect Effect(3, true);
+	Effect.DiscardsPixels = true;
+	Effect.RenderChained(Chain);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 4);
+	CheckLog({
+		"StretchRect RenderTarget Rendered",
+		"StretchRect RenderTarget PingPong", "SetRenderTarget PingPong", "SetTexture 0 RenderedTexture", "DrawPrimitive",
+		"StretchRect PingPong Rendered", "SetRenderTarget Rendered", "SetTexture 0 PingPongTexture", "DrawPrimitive",
+		"StretchRect Rendered RenderTarget", "SetRenderTarget RenderTarget", "SetTexture 0 RenderedTexture", "DrawPrimitive",
+	});
+
+	Effect.RenderChained(Chain, true);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 5);
+	CHECK_EQUAL(Chain.Device.Calls["Clear"], 3);
+
+	// a single pass already writes to the render target holding the previous output
+	TestEffect Single(1, false);
+	Single.DiscardsPixels = true;
+	Single.RenderChained(Chain);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 5);
+
+}
+
+/*
+* Outside of the chain the passes all render to the render target, nothing is copied. A disabled effect does nothing.
+*/
+TEST(UnchainedNoCopy) {
+
+	Chain Chain;
+	TestEffect Effect(3, true);
+	Effect.DiscardsPixels = true;
+	Effect.Render(&Chain.Device, RENDERTARGET, NULL, 0, true, NULL);
+	CHECK_EQUAL(Chain.Device.Calls["StretchRect"], 0);
+	CHECK_EQUAL(Chain.Device.Calls["SetRenderTarget"], 0);
+	CHECK_EQUAL(Chain.Device.Calls["Clear"], 3);
+	CHECK_EQUAL(Chain.Device.Calls["DrawPrimitive"], 3);
+
+	Effect.Enabled = false;
+	Log.clear();
+	Effect.RenderChained(Chain);
+	CHECK(Log.empty());
+
+}
+
+int main() {
+
+	RUN(NoBufferSampledNoCopy);
+	RUN(RenderedBufferCopiedOnce);
+	RUN(SourceBufferCopiedOnce);
+	RUN(DiscardingPassesSeeded);
+	RUN(UnchainedNoCopy);
+	TEST_RESULT();
+
+}
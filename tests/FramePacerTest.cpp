@@ -0,0 +1,230 @@
+#include "Test.h"
+#include "FramePacer.h"
+#include "FramePacer.cpp"
+
+// the performance counter clock is built but never created, the tests drive the pacer with their own clock
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* Frequency) { Frequency->QuadPart = 1; return TRUE; }
+BOOL QueryPerformanceCounter(LARGE_INTEGER* PerformanceCount) { PerformanceCount->QuadPart = 0; return TRUE; }
+HANDLE CreateWaitableTimerExW(SECURITY_ATTRIBUTES* Attributes, const wchar_t* TimerName, DWORD Flags, DWORD DesiredAccess) { return NULL; }
+BOOL SetWaitableTimer(HANDLE Timer, const LARGE_INTEGER* DueTime, LONG Period, void* CompletionRoutine, void* ArgToCompletionRoutine, BOOL Resume) { return FALSE; }
+BOOL CloseHandle(HANDLE Object) { return TRUE; }
+UINT timeBeginPeriod(UINT Period) { return 0; }
+UINT timeEndPeriod(UINT Period) { return 0; }
+DWORD WaitForSingleObject(HANDLE Handle, DWORD Milliseconds) { return WAIT_OBJECT_0; }
+void Sleep(DWORD Milliseconds) {}
+
+/*
+* Simulated time in ms: the frame work and the waits move it forward, each coarse wait overshoots by Overshoot ms.
+*/
+class SimulatedClock : public FrameClock {
+public:
+	SimulatedClock() : Time(100.0), Overshoot(0.0), SpinStep(0.01), Waits(0), Spins(0) {}
+
+	double		Now() { return Time; }
+	void		Wait(double Duration) { Time += Duration + Overshoot; Waits++; }
+	void		Spin() { Time += SpinStep; Spins++; }
+	void		Work(double Duration) { Time += Duration; }
+
+	double		Time;
+	double		Overshoot;
+	double		SpinStep;
+	UInt32		Waits;
+	UInt32		Spins;
+};
+
+static const double Target = 1000.0 / 60.0;
+
+static bool Near(double Value, double Expected, double Tolerance = 1e-6) {
+
+	return fabs(Value - Expected) < Tolerance;
+
+}
+
+/*
+* Runs Frames frames of Work ms each and returns how many were synced exactly TargetDuration after the previous one.
+*/
+static UInt32 RunFrames(FramePacer& Pacer, SimulatedClock& Clock, UInt32 Frames, double Work) {
+
+	UInt32 OnSchedule = 0;
+	for (UInt32 i = 0; i < Frames; i++) {
+		Clock.Work(Work);
+		if (Near(Pacer.Sync(), Pacer.TargetDuration)) OnSchedule++;
+	}
+	return OnSchedule;
+
+}
+
+/*
+* The first sync starts the schedule, the following ones land exactly on it: the coarse wait wakes early and the spin ends
+* on the target, whatever the work of the frame.
+*/
+TEST(SteadySchedule) {
+
+	SimulatedClock Clock;
+	FramePacer Pacer(&Clock);
+	Pacer.SetTarget(Target);
+
+	CHECK(Near(Pacer.Sync(), 0.0));
+	double Start = Pacer.LastSync;
+	CHECK(Near(Start, Clock.Time));
+
+	UInt32 OnSchedule = 0;
+	UInt32 SpinEnded = 0;
+	for (UInt32 i = 0; i < 120; i++) {
+		Clock.Work(i % 2 ? 5.0 : 12.0);
+		if (Near(Pacer.Sync(), Target)) OnSchedule++;
+		if (Clock.Time >= Pacer.LastSync && Clock.Time - Pacer.LastSync < Clock.SpinStep + 1e-9) SpinEnded++;
+	}
+	CHECK_EQUAL(OnSchedule, 120);
+	CHECK_EQUAL(SpinEnded, 120);
+	CHECK(Near(Pacer.LastSync, Start + 120 * Target, 1e-6));
+	CHECK_EQUAL(Clock.Waits, 120);
+	CHECK(Clock.Spins > 0);
+
+}
+
+/*
+* Without a target the pacer only measures the time between the syncs.
+*/
+TEST(Uncapped) {
+
+	SimulatedClock Clock;
+	FramePacer Pacer(&Clock);
+
+	Pacer.Sync();
+	Clock.Work(7.0);
+	CHECK(Near(Pacer.Sync(), 7.0));
+	Clock.Work(3.0);
+	CHECK(Near(Pacer.Sync(), 3.0));
+	CHECK_EQUAL(Clock.Waits, 0);
+	CHECK_EQUAL(Clock.Spins, 0);
+
+}
+
+/*
+* A frame longer than the target is returned as is and restarts the schedule from its end, the next frame isn't shortened.
+* A coarse wait overshooting by more than a whole frame restarts it too, a smaller lateness keeps it.
+*/
+TEST(LateFrameRestartsSchedule) {
+
+	SimulatedClock Clock;
+	FramePacer Pacer(&Clock);
+	Pacer.SetTarget(Target);
+	Pacer.Sync();
+
+	Clock.Work(25.0);
+	UInt32 Waits = Clock.Waits;
+	CHECK(Near(Pacer.Sync(), 25.0));
+	CHECK_EQUAL(Clock.Waits, Waits);
+	double Restart = Pacer.LastSync;
+	CHECK(Near(Restart, Clock.Time));
+	Clock.Work(5.0);
+	CHECK(Near(Pacer.Sync(), Target));
+	CHECK(Near(Pacer.LastSync, Restart + Target));
+
+	// late by less than a frame: still on schedule
+	Clock.Overshoot = 3.0;
+	Clock.Work(5.0);
+	CHECK(Near(Pacer.Sync(), Target));
+	CHECK(Clock.Time > Pacer.LastSync);
+
+	// late by more than a frame: the schedule starts over from the end of the wait
+	double Previous = Pacer.LastSync;
+	Clock.Overshoot = 30.0;
+	Clock.Work(5.0);
+	double Duration = Pacer.Sync();
+	CHECK(Near(Pacer.LastSync, Clock.Time));
+	CHECK(Near(Duration, Clock.Time - Previous));
+	CHECK(Duration > 2.0 * Target);
+
+}
+
+/*
+* The spin margin jumps up to an overshoot spike at once, clamped to MaxSpinMargin, settles on twice the average overshoot
+* and shrinks back to MinSpinMargin once the waits are accurate. The frames stay on schedule meanwhile.
+*/
+TEST(SpinMarginFollowsOvershoot) {
+
+	SimulatedClock Clock;
+	FramePacer Pacer(&Clock);
+	Pacer.SetTarget(Target);
+	Pacer.Sync();
+	CHECK(Near(Pacer.SpinMargin, 1.0));
+
+	Clock.Overshoot = 3.0;
+	CHECK_EQUAL(RunFrames(Pacer, Clock, 1, 5.0), 1);
+	CHECK(Near(Pacer.SpinMargin, 3.0));
+
+	Clock.Overshoot = 10.0;
+	CHECK_EQUAL(RunFrames(Pacer, Clock, 1, 5.0), 1);
+	CHECK(Near(Pacer.SpinMargin, FramePacer::MaxSpinMargin));
+
+	// a steady overshoot: the spin covers it, every frame lands on the target
+	Clock.Overshoot = 0.5;
+	UInt32 Spins = Clock.Spins;
+	CHECK_EQUAL(RunFrames(Pacer, Clock, 400, 5.0), 400);
+	CHECK(Near(Pacer.SpinMargin, 2.0 * 0.5, 0.01));
+	CHECK(Clock.Spins > Spins);
+
+	Clock.Overshoot = 0.0;
+	CHECK_EQUAL(RunFrames(Pacer, Clock, 1000, 5.0), 1000);
+	CHECK(Near(Pacer.SpinMargin, FramePacer::MinSpinMargin));
+
+	// a wait can't end early, a clock going back is taken as no overshoot
+	Clock.Overshoot = -1.0;
+	CHECK_EQUAL(RunFrames(Pacer, Clock, 10, 5.0), 10);
+	CHECK(Near(Pacer.SpinMargin, FramePacer::MinSpinMargin));
+
+}
+
+/*
+* Without smoothing, and on the first frame, the measured time is returned. The smoothing is capped at 0.95 and converges
+* to a steady frame time.
+*/
+TEST(Predict) {
+
+	SimulatedClock Clock;
+	FramePacer Pacer(&Clock);
+
+	CHECK(Near(Pacer.Predict(20.0, 0.5f), 20.0));
+	CHECK(Near(Pacer.Predict(10.0, 0.5f), 15.0));
+	CHECK(Near(Pacer.Predict(10.0, 0.0f), 10.0));
+	CHECK(Near(Pacer.Predict(20.0, 0.99f), 10.0 + 10.0 * (1.0 - 0.95f)));
+
+	double Predicted = 0.0;
+	for (UInt32 i = 0; i < 200; i++) Predicted = Pacer.Predict(30.0, 0.9f);
+	CHECK(Near(Predicted, 30.0, 1e-3));
+
+}
+
+/*
+* Nearest rank percentiles over the last WindowSize frames.
+*/
+TEST(Percentiles) {
+
+	FrameTimeStats Stats;
+	CHECK(Near(Stats.GetPercentile(50.0), 0.0));
+
+	for (UInt32 i = 1; i <= 100; i++) Stats.Add(i);
+	CHECK(Near(Stats.GetPercentile(50.0), 50.0));
+	CHECK(Near(Stats.GetPercentile(99.0), 99.0));
+	CHECK(Near(Stats.GetPercentile(0.0), 1.0));
+
+	for (UInt32 i = 101; i <= 300; i++) Stats.Add(i);
+	CHECK_EQUAL(Stats.Count, FrameTimeStats::WindowSize);
+	CHECK(Near(Stats.GetPercentile(0.0), 300 - FrameTimeStats::WindowSize + 1));
+	CHECK(Near(Stats.GetPercentile(100.0), 300.0));
+
+}
+
+int main() {
+
+	RUN(SteadySchedule);
+	RUN(Uncapped);
+	RUN(LateFrameRestartsSchedule);
+	RUN(SpinMarginFollowsOvershoot);
+	RUN(Predict);
+	RUN(Percentiles);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,274 @@
+#include "Test.h"
+#include "MockDevice.h"
+#include "StateCapture.cpp"
+
+/*
+* The managers read by the profiler: the device it creates the queries on and the debug mode it runs in.
+*/
+struct RenderManager {
+	IDirect3DDevice9*	device;
+};
+
+struct SettingManager {
+	struct { struct { bool DebugMode; } Develop; } SettingsMain;
+};
+
+static RenderManager* TheRenderManager = NULL;
+static SettingManager* TheSettingManager = NULL;
+
+#include "GpuProfiler.h"
+#include "GpuProfiler.cpp"
+
+/*
+* Timestamp query of a fake GPU: a timestamp is the GPU clock when the query is issued, its result is available Latency
+* GetData calls after the issue. The disjoint and frequency queries answer with the values of the device.
+*/
+class MockQueryDevice;
+
+class MockQuery : public IDirect3DQuery9 {
+public:
+	MockQuery(MockQueryDevice* Device, D3DQUERYTYPE Type) : Device(Device), Type(Type), References(1), Value(0), Pending(0) {}
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS);
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) { return E_FAIL; }
+	STDMETHOD_(D3DQUERYTYPE, GetType)(THIS) { return Type; }
+	STDMETHOD_(DWORD, GetDataSize)(THIS) { return Type == D3DQUERYTYPE_TIMESTAMPDISJOINT ? sizeof(BOOL) : sizeof(UINT64); }
+	STDMETHOD(Issue)(THIS_ DWORD dwIssueFlags);
+	STDMETHOD(GetData)(THIS_ void* pData, DWORD dwSize, DWORD dwGetDataFlags);
+
+	MockQueryDevice*	Device;
+	D3DQUERYTYPE		Type;
+	ULONG				References;
+	UINT64				Value;
+	UInt32				Pending;	// GetData calls before the result is available
+};
+
+class MockQueryDevice : public NullDevice {
+public:
+	MockQueryDevice() : Clock(0), Frequency(1000000), Latency(0), Disjoint(FALSE), Timestamps(true), Queries(0) {}
+
+	STDMETHOD(CreateQuery)(THIS_ D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery) {
+		Call(__func__);
+		if (!Timestamps && Type != D3DQUERYTYPE_OCCLUSION) return D3DERR_INVALIDCALL;
+		if (ppQuery) {
+			*ppQuery = new MockQuery(this, Type);
+			Queries++;
+		}
+		return D3D_OK;
+	}
+
+	UINT64				Clock;		// GPU ticks
+	UINT64				Frequency;	// ticks per second
+	UInt32				Latency;
+	BOOL				Disjoint;
+	bool				Timestamps;
+	int					Queries;	// alive
+};
+
+ULONG MockQuery::Release() {
+
+	ULONG Result = --References;
+	if (!Result) {
+		Device->Queries--;
+		delete this;
+	}
+	return Result;
+
+}
+
+HRESULT MockQuery::Issue(DWORD dwIssueFlags) {
+
+	Device->Call("Issue");
+	if (Type == D3DQUERYTYPE_TIMESTAMP) Value = Device->Clock;
+	if (Type == D3DQUERYTYPE_TIMESTAMPFREQ) Value = Device->Frequency;
+	if (dwIssueFlags & D3DISSUE_END) Pending = Device->Latency;
+	return D3D_OK;
+
+}
+
+HRESULT MockQuery::GetData(void* pData, DWORD dwSize, DWORD dwGetDataFlags) {
+
+	Device->Call("GetData");
+	if (dwGetDataFlags & D3DGETDATA_FLUSH) Device->Call("Flush");
+	if (Pending) {
+		Pending--;
+		return S_FALSE;
+	}
+	if (dwSize != GetDataSize()) return D3DERR_INVALIDCALL;
+	memcpy(pData, Type == D3DQUERYTYPE_TIMESTAMPDISJOINT ? (void*)&Device->Disjoint : (void*)&Value, dwSize);
+	return S_OK;
+
+}
+
+static bool Near(float a, float b) {
+
+	return fabsf(a - b) < 0.0001f;
+
+}
+
+/*
+* Scopes with the same name are summed within a frame, the averages are per frame.
+*/
+TEST(ScopesAreSummedByName) {
+
+	GpuTimings Timings;
+	for (int i = 0; i < 10; i++) {
+		Timings.BeginFrame();
+		Timings.AddScope("Shadows", 1000, 3000, 1000000);	// 2 ms
+		Timings.AddScope("Shadows", 5000, 6000, 1000000);	// 1 ms
+		Timings.AddScope("Bloom", 0, 500 + 100 * i, 1000000);
+		Timings.EndFrame(false);
+	}
+	CHECK(Near(Timings.GetAverage("Shadows"), 3.0f));
+	CHECK(Near(Timings.GetAverage("Bloom"), 0.95f));
+	CHECK(Near(Timings.GetAverage("SMAA"), 0.0f));
+	CHECK_EQUAL(Timings.FramesCommitted, 10u);
+	CHECK_EQUAL(Timings.FramesDropped, 0u);
+
+}
+
+/*
+* A disjoint frame is dropped, invalid timestamps are ignored, a scope that didn't run counts 0 for the frame.
+*/
+TEST(InvalidFramesAndScopes) {
+
+	GpuTimings Timings;
+	Timings.BeginFrame();
+	Timings.AddScope("Bloom", 0, 4000, 1000000);
+	Timings.EndFrame(false);
+
+	Timings.BeginFrame();
+	Timings.AddScope("Bloom", 0, 100000, 1000000);
+	Timings.EndFrame(true);
+	CHECK(Near(Timings.GetAverage("Bloom"), 4.0f));
+	CHECK_EQUAL(Timings.FramesDropped, 1u);
+
+	Timings.BeginFrame();
+	Timings.AddScope("Bloom", 0, 1000, 0);
+	Timings.AddScope("Bloom", 2000, 1000, 1000000);
+	Timings.AddScope("SMAA", 0, 2000, 1000000);
+	Timings.EndFrame(false);
+	CHECK(Near(Timings.GetAverage("Bloom"), 2.0f));		// (4 + 0) / 2
+	CHECK(Near(Timings.GetAverage("SMAA"), 2.0f));		// first sampled on the second frame
+	CHECK_EQUAL(Timings.FramesCommitted, 2u);
+
+	Timings.Clear();
+	CHECK(Near(Timings.GetAverage("Bloom"), 0.0f));
+	CHECK_EQUAL(Timings.FramesCommitted, 0u);
+
+}
+
+/*
+* The average covers the last WindowSize frames only.
+*/
+TEST(RollingWindow) {
+
+	GpuTimings Timings;
+	for (UInt32 i = 0; i < GpuTimings::WindowSize * 3; i++) {
+		Timings.BeginFrame();
+		Timings.AddScope("Effect", 0, i < GpuTimings::WindowSize * 2 ? 10000 : 1000, 1000000);
+		Timings.EndFrame(false);
+		if (i == GpuTimings::WindowSize * 2 + GpuTimings::WindowSize / 2 - 1) CHECK(Near(Timings.GetAverage("Effect"), 5.5f));
+	}
+	CHECK(Near(Timings.GetAverage("Effect"), 1.0f));
+	CHECK_EQUAL(Timings.Entries["Effect"].Count, GpuTimings::WindowSize);
+
+}
+
+/*
+* Renders frames with two scopes on the fake GPU, which takes 1 ms per scope.
+*/
+static void RenderFrames(GpuProfiler* Profiler, MockQueryDevice* Device, int Frames) {
+
+	for (int i = 0; i < Frames; i++) {
+		Profiler->BeginFrame();
+		UInt32 Outer = Profiler->BeginScope("Effects");
+		UInt32 Inner = Profiler->BeginScope("Bloom");
+		Device->Clock += Device->Frequency / 1000;
+		Profiler->EndScope(Inner);
+		Device->Clock += Device->Frequency / 1000;
+		Profiler->EndScope(Outer);
+		Profiler->EndFrame();
+	}
+
+}
+
+/*
+* Frames are read back FramesLatency frames later without flushing; results that aren't ready then drop the frame.
+*/
+TEST(ProfilerReadsBackLater) {
+
+	MockQueryDevice Device;
+	RenderManager Render = { &Device };
+	SettingManager Settings = {};
+	TheRenderManager = &Render;
+	TheSettingManager = &Settings;
+
+	GpuProfiler Profiler;
+	RenderFrames(&Profiler, &Device, 2);
+	CHECK_EQUAL(Device.Calls["CreateQuery"], 0u);		// not in debug mode
+	CHECK(Profiler.BeginScope("Effects") == GpuProfiler::InvalidScope);
+
+	Settings.SettingsMain.Develop.DebugMode = true;
+	RenderFrames(&Profiler, &Device, GpuProfiler::FramesLatency);
+	CHECK(Profiler.Supported);
+	CHECK_EQUAL(Profiler.Timings.FramesCommitted, 0u);
+	CHECK_EQUAL(Device.Calls["GetData"], 0u);
+
+	RenderFrames(&Profiler, &Device, 10);
+	CHECK_EQUAL(Profiler.Timings.FramesCommitted, 10u);
+	CHECK(Near(Profiler.GetTime("Effects"), 2.0f));
+	CHECK(Near(Profiler.GetTime("Bloom"), 1.0f));
+	CHECK_EQUAL(Device.Calls["Flush"], 0u);
+
+	// the GPU runs FramesLatency + 1 frames behind: every frame read is dropped, never waited for
+	Device.Latency = GpuProfiler::FramesLatency + 1;
+	RenderFrames(&Profiler, &Device, GpuProfiler::FramesLatency * 2);
+	CHECK_EQUAL(Profiler.Timings.FramesCommitted, 10u + GpuProfiler::FramesLatency);
+	CHECK_EQUAL(Profiler.Timings.FramesDropped, GpuProfiler::FramesLatency);
+
+	Device.Latency = 0;
+	Device.Disjoint = TRUE;
+	UInt32 Dropped = Profiler.Timings.FramesDropped;
+	RenderFrames(&Profiler, &Device, GpuProfiler::FramesLatency);
+	CHECK_EQUAL(Profiler.Timings.FramesDropped, Dropped + GpuProfiler::FramesLatency);
+
+	// the scope queries are created once and reused by the frames
+	CHECK_EQUAL(Device.Queries, (int)GpuProfiler::FramesLatency * (2 + 4));
+	Profiler.Release();
+	CHECK_EQUAL(Device.Queries, 0);
+	CHECK(!Profiler.Supported);
+
+}
+
+TEST(ProfilerWithoutTimestamps) {
+
+	MockQueryDevice Device;
+	RenderManager Render = { &Device };
+	SettingManager Settings = {};
+	Settings.SettingsMain.Develop.DebugMode = true;
+	TheRenderManager = &Render;
+	TheSettingManager = &Settings;
+
+	Device.Timestamps = false;
+	GpuProfiler Profiler;
+	RenderFrames(&Profiler, &Device, 3);
+	CHECK(!Profiler.Supported);
+	CHECK_EQUAL(Device.Calls["CreateQuery"], 1u);
+	CHECK_EQUAL(Device.Calls["Issue"], 0u);
+	CHECK_EQUAL(Device.Queries, 0);
+
+}
+
+int main() {
+
+	RUN(ScopesAreSummedByName);
+	RUN(InvalidFramesAndScopes);
+	RUN(RollingWindow);
+	RUN(ProfilerReadsBackLater);
+	RUN(ProfilerWithoutTimestamps);
+	TEST_RESULT();
+
+}
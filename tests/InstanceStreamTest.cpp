@@ -0,0 +1,323 @@
+#include "Test.h"
+#include "MockDevice.h"
+#include "StateCapture.cpp"
+#include "Device.h"
+#include "Device.cpp"
+#include "InstanceStream.h"
+#include "InstanceStream.cpp"
+
+static std::vector<std::string> Log;	// calls reaching the device, in order
+
+static std::string Entry(const char* Name, UINT_PTR a = 0, UINT_PTR b = 0, UINT_PTR c = 0, UINT_PTR d = 0) {
+
+	char Text[128];
+	snprintf(Text, sizeof(Text), "%s %llx %llx %llx %llx", Name, (unsigned long long)a, (unsigned long long)b, (unsigned long long)c, (unsigned long long)d);
+	return Text;
+
+}
+
+class MockBuffer : public IDirect3DVertexBuffer9 {
+public:
+	MockBuffer(UINT Length) : References(1), Data(Length) {}
+	virtual ~MockBuffer() {}
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) { return --References; }
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(SetPrivateData)(THIS_ REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetPrivateData)(THIS_ REFGUID refguid, void* pData, DWORD* pSizeOfData) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(FreePrivateData)(THIS_ REFGUID refguid) { return D3DERR_INVALIDCALL; }
+	STDMETHOD_(DWORD, SetPriority)(THIS_ DWORD PriorityNew) { return 0; }
+	STDMETHOD_(DWORD, GetPriority)(THIS) { return 0; }
+	STDMETHOD_(void, PreLoad)(THIS) {}
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) { return D3DRTYPE_SURFACE; }
+	STDMETHOD(Lock)(THIS_ UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) {
+		Log.push_back(Entry(__func__, OffsetToLock, SizeToLock, Flags));
+		if (OffsetToLock + SizeToLock > Data.size()) return D3DERR_INVALIDCALL;
+		*ppbData = Data.data() + OffsetToLock;
+		return D3D_OK;
+	}
+	STDMETHOD(Unlock)(THIS) { Log.push_back(Entry(__func__)); return D3D_OK; }
+	STDMETHOD(GetDesc)(THIS_ D3DVERTEXBUFFER_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+
+	ULONG				References;
+	std::vector<UInt8>	Data;
+};
+
+class MockDeclaration : public IDirect3DVertexDeclaration9 {
+public:
+	MockDeclaration(const D3DVERTEXELEMENT9* Elements) : References(1), Reads(0) {
+		do {
+			this->Elements.push_back(*Elements);
+		} while ((Elements++)->Stream != 0xFF);
+	}
+	virtual ~MockDeclaration() {}
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) { return --References; }
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetDeclaration)(THIS_ D3DVERTEXELEMENT9* pElement, UINT* pNumElements) {
+		Reads++;
+		if (pElement) memcpy(pElement, Elements.data(), Elements.size() * sizeof(D3DVERTEXELEMENT9));
+		*pNumElements = (UINT)Elements.size();
+		return D3D_OK;
+	}
+
+	ULONG							References;
+	UInt32							Reads;
+	std::vector<D3DVERTEXELEMENT9>	Elements;
+};
+
+/*
+* Game device logging the calls of the instanced draws, the created buffers and declarations are kept to check their references.
+*/
+class DrawDevice : public NullDevice {
+public:
+	~DrawDevice() {
+		for (MockBuffer* Buffer : Buffers) delete Buffer;
+		for (MockDeclaration* Declaration : Declarations) delete Declaration;
+	}
+
+	STDMETHOD(CreateVertexBuffer)(THIS_ UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) {
+		Log.push_back(Entry(__func__, Length, Usage, Pool));
+		if (FAILED(Call(__func__))) return Result;
+		Buffers.push_back(new MockBuffer(Length));
+		*ppVertexBuffer = Buffers.back();
+		return D3D_OK;
+	}
+	STDMETHOD(CreateVertexDeclaration)(THIS_ CONST D3DVERTEXELEMENT9* pVertexElements, IDirect3DVertexDeclaration9** ppDecl) {
+		Log.push_back(Entry(__func__));
+		Call(__func__);
+		Declarations.push_back(new MockDeclaration(pVertexElements));
+		*ppDecl = Declarations.back();
+		return D3D_OK;
+	}
+	STDMETHOD(SetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) {
+		Log.push_back(Entry(__func__, StreamNumber, (UINT_PTR)pStreamData, OffsetInBytes, Stride));
+		return D3D_OK;
+	}
+	STDMETHOD(SetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT Setting) {
+		Log.push_back(Entry(__func__, StreamNumber, Setting));
+		return D3D_OK;
+	}
+	STDMETHOD(SetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9* pDecl) {
+		Log.push_back(Entry(__func__, (UINT_PTR)pDecl));
+		return D3D_OK;
+	}
+	STDMETHOD(DrawIndexedPrimitive)(THIS_ D3DPRIMITIVETYPE Type, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount) {
+		Log.push_back(Entry(__func__, NumVertices, primCount));
+		return D3D_OK;
+	}
+
+	std::vector<MockBuffer*>		Buffers;
+	std::vector<MockDeclaration*>	Declarations;
+};
+
+#define GEOMETRY	((IDirect3DVertexBuffer9*)(UINT_PTR)0x2000)
+
+static const D3DVERTEXELEMENT9 GeometryElements[] = {
+	{ 0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+	{ 0, 12, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+	D3DDECL_END()
+};
+
+/*
+* An instanced draw of RenderPass::RenderInstances with one geometry stream, through the proxy as in the game.
+*/
+static bool Draw(IDirect3DDevice9* Device, IDirect3DVertexDeclaration9* GeometryDeclaration, UInt32 Count) {
+
+	InstanceStream::Declaration Declaration = InstanceStream::GetDeclaration(Device, GeometryDeclaration);
+	if (!Declaration.Extended) return false;
+
+	float* Instances = InstanceStream::Lock(Device, Count);
+	if (!Instances) return false;
+	for (UInt32 i = 0; i < Count * InstanceStream::Stride / sizeof(float); i++) Instances[i] = (float)i;
+	InstanceStream::Unlock();
+
+	Device->SetStreamSource(0, GEOMETRY, 0, 28);
+	InstanceStream::Bind(Device, Declaration, 1, Count);
+	Device->SetVertexDeclaration(Declaration.Extended);
+	Device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, 24, 0, 12);
+	InstanceStream::Unbind(Device, Declaration, 1);
+	return true;
+
+}
+
+static void PrintLog() {
+
+	for (const std::string& Line : Log) printf("  %s\n", Line.c_str());
+
+}
+
+/*
+* The first draw creates the extended declaration and the buffer, the instances of each draw are read after the ones of the previous draw.
+*/
+TEST(DrawLog) {
+
+	DrawDevice Backend;
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	MockDeclaration Geometry(GeometryElements);
+	Log.clear();
+
+	CHECK(Draw(&Proxy, &Geometry, 4));
+	CHECK_EQUAL(Backend.Buffers.size(), 1);
+	CHECK_EQUAL(Backend.Declarations.size(), 1);
+	if (Backend.Buffers.empty() || Backend.Declarations.empty()) return;
+	UINT_PTR Buffer = (UINT_PTR)Backend.Buffers[0];
+	UINT_PTR Extended = (UINT_PTR)Backend.Declarations[0];
+	std::vector<std::string> Expected = {
+		Entry("CreateVertexDeclaration"),
+		Entry("CreateVertexBuffer", InstanceStream::BufferSize * InstanceStream::Stride, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, D3DPOOL_DEFAULT),
+		Entry("Lock", 0, 4 * InstanceStream::Stride, D3DLOCK_NOOVERWRITE),
+		Entry("Unlock"),
+		Entry("SetStreamSource", 0, (UINT_PTR)GEOMETRY, 0, 28),
+		Entry("SetStreamSourceFreq", 0, D3DSTREAMSOURCE_INDEXEDDATA | 4),
+		Entry("SetStreamSource", 1, Buffer, 0, InstanceStream::Stride),
+		Entry("SetStreamSourceFreq", 1, D3DSTREAMSOURCE_INSTANCEDATA | 1),
+		Entry("SetVertexDeclaration", Extended),
+		Entry("DrawIndexedPrimitive", 24, 12),
+		Entry("SetStreamSourceFreq", 0, 1),
+		Entry("SetStreamSourceFreq", 1, 1),
+		Entry("SetStreamSource", 1, 0, 0, 0),
+	};
+	CHECK(Log == Expected);
+	if (Log != Expected) PrintLog();
+
+	// the transform columns are read from the instance stream as TEXCOORD4 to TEXCOORD6
+	const std::vector<D3DVERTEXELEMENT9>& Elements = Backend.Declarations[0]->Elements;
+	CHECK_EQUAL(Elements.size(), 6);
+	for (UInt32 c = 0; c < 3 && Elements.size() == 6; c++) {
+		CHECK_EQUAL(Elements[2 + c].Stream, 1);
+		CHECK_EQUAL(Elements[2 + c].Offset, c * 16);
+		CHECK_EQUAL(Elements[2 + c].Usage, D3DDECLUSAGE_TEXCOORD);
+		CHECK_EQUAL(Elements[2 + c].UsageIndex, 4 + c);
+	}
+	float Written[2];
+	memcpy(Written, Backend.Buffers[0]->Data.data(), sizeof(Written));
+	CHECK(Written[0] == 0.0f && Written[1] == 1.0f);
+
+	// the second draw reuses both and appends its instances, the geometry stream already set is filtered by the proxy
+	Log.clear();
+	CHECK(Draw(&Proxy, &Geometry, 2));
+	Expected = {
+		Entry("Lock", 4 * InstanceStream::Stride, 2 * InstanceStream::Stride, D3DLOCK_NOOVERWRITE),
+		Entry("Unlock"),
+		Entry("SetStreamSourceFreq", 0, D3DSTREAMSOURCE_INDEXEDDATA | 2),
+		Entry("SetStreamSource", 1, Buffer, 4 * InstanceStream::Stride, InstanceStream::Stride),
+		Entry("SetStreamSourceFreq", 1, D3DSTREAMSOURCE_INSTANCEDATA | 1),
+		Entry("DrawIndexedPrimitive", 24, 12),
+		Entry("SetStreamSourceFreq", 0, 1),
+		Entry("SetStreamSourceFreq", 1, 1),
+		Entry("SetStreamSource", 1, 0, 0, 0),
+	};
+	CHECK(Log == Expected);
+	if (Log != Expected) PrintLog();
+	CHECK_EQUAL(Geometry.Reads, 2);		// the count and the elements, once
+
+	InstanceStream::Release();
+
+}
+
+/*
+* The instances not fitting at the end of the buffer start over at the beginning, discarding what the GPU may still read.
+*/
+TEST(RingWrapsWithDiscard) {
+
+	DrawDevice Backend;
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	Log.clear();
+
+	CHECK(InstanceStream::Lock(&Proxy, InstanceStream::BufferSize - 2) != NULL);
+	InstanceStream::Unlock();
+	CHECK(InstanceStream::Lock(&Proxy, 2) != NULL);
+	InstanceStream::Unlock();
+	CHECK_EQUAL(InstanceStream::Next, InstanceStream::BufferSize);
+	CHECK(InstanceStream::Lock(&Proxy, 4) != NULL);
+	InstanceStream::Unlock();
+	CHECK_EQUAL(InstanceStream::Offset, 0);
+	CHECK_EQUAL(InstanceStream::Next, 4);
+	CHECK(Log.size() >= 7 && Log[5] == Entry("Lock", 0, 4 * InstanceStream::Stride, D3DLOCK_DISCARD));
+	CHECK(Log.size() >= 7 && Log[3] == Entry("Lock", (InstanceStream::BufferSize - 2) * InstanceStream::Stride, 2 * InstanceStream::Stride, D3DLOCK_NOOVERWRITE));
+	CHECK_EQUAL(Backend.Calls["CreateVertexBuffer"], 1);
+
+	InstanceStream::Release();
+
+}
+
+/*
+* A geometry already reading TEXCOORD4 to TEXCOORD6 isn't drawn instanced, and its declaration isn't read again.
+*/
+TEST(UsedTexcoordsNotExtended) {
+
+	DrawDevice Backend;
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, true);
+	D3DVERTEXELEMENT9 Elements[] = {
+		{ 0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+		{ 1, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 5 },
+		D3DDECL_END()
+	};
+	MockDeclaration Geometry(Elements);
+	Log.clear();
+
+	CHECK(!Draw(&Proxy, &Geometry, 4));
+	CHECK(!Draw(&Proxy, &Geometry, 4));
+	CHECK(Log.empty());
+	CHECK_EQUAL(Geometry.Reads, 2);
+	CHECK_EQUAL(Geometry.References, 2);	// held as key of the cache
+
+	InstanceStream::Release();
+	CHECK_EQUAL(Geometry.References, 1);
+
+}
+
+/*
+* Resetting the device through the proxy releases the default pool buffer and the declarations, the next draw creates them again.
+* A buffer that cannot be created disables the instancing without a lock.
+*/
+TEST(ResetReleasesStream) {
+
+	DrawDevice Backend;
+	TESRDirect3DDevice9 Proxy(NULL, &Backend, false);
+	MockDeclaration Geometry(GeometryElements);
+	CHECK(Draw(&Proxy, &Geometry, 4));
+	CHECK_EQUAL(Geometry.References, 2);
+
+	Proxy.Reset(NULL);
+	CHECK(InstanceStream::Buffer == NULL);
+	CHECK(InstanceStream::Declarations.empty());
+	CHECK_EQUAL(InstanceStream::Next, 0);
+	CHECK_EQUAL(Geometry.References, 1);
+	for (MockBuffer* Buffer : Backend.Buffers) CHECK_EQUAL(Buffer->References, 0);
+	for (MockDeclaration* Declaration : Backend.Declarations) CHECK_EQUAL(Declaration->References, 0);
+
+	CHECK(Draw(&Proxy, &Geometry, 4));
+	CHECK_EQUAL(Backend.Calls["CreateVertexBuffer"], 2);
+	CHECK_EQUAL(Backend.Calls["CreateVertexDeclaration"], 2);
+	CHECK_EQUAL(InstanceStream::Offset, 0);
+
+	Proxy.ResetEx(NULL, NULL);
+	CHECK(InstanceStream::Buffer == NULL);
+	CHECK_EQUAL(Backend.Buffers.back()->References, 0);
+
+	Backend.Result = D3DERR_INVALIDCALL;
+	Log.clear();
+	CHECK(InstanceStream::Lock(&Proxy, 4) == NULL);
+	CHECK(InstanceStream::Buffer == NULL);
+	CHECK_EQUAL(Log.size(), 1);
+	CHECK_EQUAL(Backend.Buffers.size(), 2);
+
+	InstanceStream::Release();
+
+}
+
+int main() {
+
+	RUN(DrawLog);
+	RUN(RingWrapsWithDiscard);
+	RUN(UsedTexcoordsNotExtended);
+	RUN(ResetReleasesStream);
+	TEST_RESULT();
+
+}
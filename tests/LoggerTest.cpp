@@ -0,0 +1,319 @@
+#include "Test.h"
+#include <condition_variable>
+#include <filesystem>
+
+/*
+* The parts of the game read by Logger::TraceRenderState.
+*/
+class NiDX9RenderState {
+public:
+	struct NiRenderStateSetting {
+		UInt32 CurrentValue;
+		UInt32 DefaultValue;
+	};
+
+	NiRenderStateSetting RenderStateSettings[256];
+};
+
+struct RenderManager {
+	NiDX9RenderState* renderState;
+};
+
+static RenderManager* TheRenderManager = NULL;
+
+#include "../src/base/Logger.cpp"		// not the shim one of the include path
+
+/*
+* Auto reset event of the writer thread. The writer can be held in WaitForSingleObject so that the producers fill the ring.
+*/
+struct FakeEvent {
+	std::mutex				Lock;
+	std::condition_variable	Signal;
+	bool					Set = false;
+};
+
+static std::atomic<bool> WriterStalled;
+static std::atomic<bool> WriterParked;
+static std::atomic<DWORD> FakeTicks;
+
+HANDLE CreateEventA(SECURITY_ATTRIBUTES* Attributes, BOOL ManualReset, BOOL InitialState, const char* Name) {
+
+	return new FakeEvent();
+
+}
+
+BOOL SetEvent(HANDLE Event) {
+
+	FakeEvent* Item = (FakeEvent*)Event;
+	std::lock_guard<std::mutex> Guard(Item->Lock);
+	Item->Set = true;
+	Item->Signal.notify_one();
+	return TRUE;
+
+}
+
+DWORD WaitForSingleObject(HANDLE Handle, DWORD Milliseconds) {
+
+	FakeEvent* Item = (FakeEvent*)Handle;
+	while (WriterStalled) {
+		WriterParked = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	WriterParked = false;
+
+	std::unique_lock<std::mutex> Guard(Item->Lock);
+	bool Signaled = Item->Signal.wait_for(Guard, std::chrono::milliseconds(Milliseconds), [Item]() { return Item->Set; });
+	Item->Set = false;
+	return Signaled ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+
+}
+
+void Sleep(DWORD Milliseconds) {
+
+	if (Milliseconds)
+		std::this_thread::sleep_for(std::chrono::milliseconds(Milliseconds));
+	else
+		std::this_thread::yield();
+
+}
+
+DWORD GetTickCount() {
+
+	return FakeTicks;
+
+}
+
+LPTOP_LEVEL_EXCEPTION_FILTER SetUnhandledExceptionFilter(LPTOP_LEVEL_EXCEPTION_FILTER Filter) {
+
+	return NULL;
+
+}
+
+static std::string LogPath;
+static size_t LogOffset = 0;
+
+/*
+* Flushes the logger and returns the lines written since the last call.
+*/
+static std::vector<std::string> ReadLines() {
+
+	std::vector<std::string> Lines;
+	std::string Line;
+
+	Logger::Flush();
+	std::ifstream File(LogPath, std::ios::binary);
+	File.seekg(LogOffset);
+	while (std::getline(File, Line)) {
+		LogOffset += Line.size() + 1;
+		Lines.push_back(Line);
+	}
+	return Lines;
+
+}
+
+/*
+* Holds the writer thread out of the ring until ReleaseWriter.
+*/
+static void StallWriter() {
+
+	WriterStalled = true;
+	while (!WriterParked) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+}
+
+static void ReleaseWriter() {
+
+	WriterStalled = false;
+
+}
+
+/*
+* Every producer finds its own messages in the file in the order it logged them, none lost or duplicated.
+*/
+TEST(ProducersOrder) {
+
+	const UInt32 Producers = 8;
+	const UInt32 Messages = 20000;
+
+	Logger::SetRateLimit(0);
+	std::vector<std::thread> Threads;
+	for (UInt32 t = 0; t < Producers; t++) {
+		Threads.emplace_back([t]() {
+			for (UInt32 i = 0; i < Messages; i++) Logger::Log("Producer %u message %u", (unsigned)t, (unsigned)i);
+		});
+	}
+	for (std::thread& Thread : Threads) Thread.join();
+
+	std::vector<UInt32> Next(Producers, 0);
+	UInt32 Unexpected = 0;
+	std::vector<std::string> Lines = ReadLines();
+	for (std::string& Line : Lines) {
+		unsigned Producer, Index;
+		if (sscanf(Line.c_str(), "Producer %u message %u", &Producer, &Index) != 2 || Producer >= Producers || Next[Producer] != Index) {
+			Unexpected++;
+			continue;
+		}
+		Next[Producer]++;
+	}
+	CHECK_EQUAL(Lines.size(), Producers * Messages);
+	CHECK_EQUAL(Unexpected, 0);
+	for (UInt32 t = 0; t < Producers; t++) CHECK_EQUAL(Next[t], Messages);
+
+}
+
+/*
+* The ring is full while the writer is held: the next message drains it and is written synchronously, after the ones already queued.
+* Messages longer than an entry take the same path.
+*/
+TEST(OverflowFallback) {
+
+	const UInt32 Messages = 2048 + 16;
+
+	Logger::SetRateLimit(0);
+	ReadLines();
+	UInt32 Overflows = Logger::OverflowCount;
+
+	StallWriter();
+	for (UInt32 i = 0; i < Messages; i++) Logger::Log("Queued %u", (unsigned)i);
+	CHECK_EQUAL(Logger::OverflowCount - Overflows, 1u);
+
+	std::string Long(600, 'x');
+	Logger::Log("Long %s", Long.c_str());
+	Logger::Log("After the long message");
+	CHECK_EQUAL(Logger::OverflowCount - Overflows, 1u);
+	ReleaseWriter();
+
+	std::vector<std::string> Lines = ReadLines();
+	CHECK_EQUAL(Lines.size(), Messages + 2);
+	UInt32 Ordered = 0;
+	for (UInt32 i = 0; i < Messages && i < Lines.size(); i++) {
+		if (Lines[i] == "Queued " + std::to_string(i)) Ordered++;
+	}
+	CHECK_EQUAL(Ordered, Messages);
+	if (Lines.size() == Messages + 2) {
+		CHECK(Lines[Messages] == "Long " + Long);
+		CHECK(Lines[Messages + 1] == "After the long message");
+	}
+
+}
+
+/*
+* Identical messages over the limit in the same second are dropped and counted, the count goes with the next one written.
+*/
+TEST(RateSuppression) {
+
+	Logger::SetRateLimit(20);
+	ReadLines();
+	UInt32 Suppressed = Logger::SuppressedCount;
+	FakeTicks = 10000;
+
+	for (int i = 0; i < 25; i++) Logger::Log("Repeated message");
+	Logger::Log("Other message");
+	std::vector<std::string> Lines = ReadLines();
+	CHECK_EQUAL(Lines.size(), 21u);
+	CHECK_EQUAL(std::count(Lines.begin(), Lines.end(), "Repeated message"), 20);
+	CHECK(Lines.size() && Lines.back() == "Other message");
+	CHECK_EQUAL(Logger::SuppressedCount - Suppressed, 5u);
+
+	// the same second still drops, the next second writes with the count and starts again
+	Logger::Log("Repeated message");
+	FakeTicks += 1000;
+	Logger::Log("Repeated message");
+	Logger::Log("Repeated message");
+	Lines = ReadLines();
+	CHECK_EQUAL(Lines.size(), 2u);
+	if (Lines.size() == 2) {
+		CHECK(Lines[0] == "(6 identical messages suppressed) Repeated message");
+		CHECK(Lines[1] == "Repeated message");
+	}
+	CHECK_EQUAL(Logger::SuppressedCount - Suppressed, 6u);
+
+	Logger::SetRateLimit(0);
+	for (int i = 0; i < 25; i++) Logger::Log("Repeated message");
+	CHECK_EQUAL(ReadLines().size(), 25u);
+
+}
+
+TEST(CategoryLevels) {
+
+	ReadLines();
+	Logger::SetLevel(Logger::CategoryTexture, Logger::LevelWarning);
+	Logger::Log(Logger::CategoryTexture, Logger::LevelInfo, "Texture info");
+	Logger::Log(Logger::CategoryTexture, Logger::LevelWarning, "Texture warning");
+	Logger::Log(Logger::CategoryVulkan, Logger::LevelInfo, "Vulkan info");
+	Logger::Log(Logger::CategoryVulkan, Logger::LevelDebug, "Vulkan debug");
+	Logger::SetLevel(Logger::CategoryTexture, Logger::LevelInfo);
+
+	std::vector<std::string> Lines = ReadLines();
+	CHECK_EQUAL(Lines.size(), 2u);
+	if (Lines.size() == 2) {
+		CHECK(Lines[0] == "Texture warning");
+		CHECK(Lines[1] == "Vulkan info");
+	}
+
+}
+
+/*
+* Messages per second from 4 threads through the ring, against the synchronous writes flushing every line the logger did before.
+*/
+TEST(Throughput) {
+
+	const UInt32 Producers = 4;
+	const UInt32 Messages = 50000;
+
+	Logger::SetRateLimit(0);
+	ReadLines();
+	UInt32 Overflows = Logger::OverflowCount;
+	std::vector<std::thread> Threads;
+	auto Start = std::chrono::steady_clock::now();
+	for (UInt32 t = 0; t < Producers; t++) {
+		Threads.emplace_back([t]() {
+			for (UInt32 i = 0; i < Messages; i++) Logger::Log("Throughput %u message %u with some text after it", (unsigned)t, (unsigned)i);
+		});
+	}
+	for (std::thread& Thread : Threads) Thread.join();
+	double Producing = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	Logger::Flush();
+	double Ring = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	CHECK_EQUAL(ReadLines().size(), Producers * Messages);
+
+	std::string SyncPath = LogPath + ".sync";
+	FILE* File = fopen(SyncPath.c_str(), "w");
+	Threads.clear();
+	Start = std::chrono::steady_clock::now();
+	for (UInt32 t = 0; t < Producers; t++) {
+		Threads.emplace_back([t, File]() {
+			for (UInt32 i = 0; i < Messages; i++) {
+				fprintf(File, "Throughput %u message %u with some text after it", (unsigned)t, (unsigned)i);
+				fputc('\n', File);
+				fflush(File);
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) Thread.join();
+	double Sync = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	fclose(File);
+	std::filesystem::remove(SyncPath);
+
+	UInt32 Total = Producers * Messages;
+	printf("  %u messages: ring %.0f/s (%.0f/s on the producers, %u overflows), flushed lines %.0f/s\n", (unsigned)Total,
+		Total / Ring, Total / Producing, (unsigned)(Logger::OverflowCount - Overflows), Total / Sync);
+
+}
+
+int main() {
+
+	LogPath = (std::filesystem::temp_directory_path() / "TESR_LoggerTest.log").string();
+	Logger::Initialize(LogPath.c_str());
+	CHECK(Logger::LogFile != NULL);
+
+	RUN(ProducersOrder);
+	RUN(OverflowFallback);
+	RUN(RateSuppression);
+	RUN(CategoryLevels);
+	RUN(Throughput);
+	Logger::Shutdown();
+	std::filesystem::remove(LogPath);
+	TEST_RESULT();
+
+}
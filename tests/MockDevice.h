@@ -0,0 +1,278 @@
+#pragma once
+
+/*
+* Device of the tests: every method counts its calls by name and returns Result, without doing anything else.
+* Mocks derive from it and override the methods the tested code relies on.
+*/
+class NullDevice : public IDirect3DDevice9Ex {
+public:
+	NullDevice() : References(1), Result(D3D_OK) {}
+	virtual ~NullDevice() {}
+
+	HRESULT Call(const char* Name) {
+
+		Calls[Name]++;
+		return Result;
+
+	}
+
+	ULONG					References;
+	HRESULT					Result;		// returned by every call
+	std::map<std::string, UInt32> Calls;
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) {
+		Call(__func__);
+		if (riid == __uuidof(IUnknown) || riid == __uuidof(IDirect3DDevice9) || riid == __uuidof(IDirect3DDevice9Ex)) {
+			*ppvObj = this;
+			AddRef();
+			return S_OK;
+		}
+		*ppvObj = NULL;
+		return E_NOINTERFACE;
+	}
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) { return --References; }
+	STDMETHOD(TestCooperativeLevel)(THIS) { return Call(__func__); }
+	STDMETHOD_(UINT, GetAvailableTextureMem)(THIS) { Call(__func__); return 0; }
+	STDMETHOD(EvictManagedResources)(THIS) { return Call(__func__); }
+	STDMETHOD(GetDirect3D)(THIS_ IDirect3D9** ppD3D9) { return Call(__func__); }
+	STDMETHOD(GetDeviceCaps)(THIS_ D3DCAPS9* pCaps) { return Call(__func__); }
+	STDMETHOD(GetDisplayMode)(THIS_ UINT iSwapChain, D3DDISPLAYMODE* pMode) { return Call(__func__); }
+	STDMETHOD(GetCreationParameters)(THIS_ D3DDEVICE_CREATION_PARAMETERS *pParameters) { return Call(__func__); }
+	STDMETHOD(SetCursorProperties)(THIS_ UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap) { return Call(__func__); }
+	STDMETHOD_(void, SetCursorPosition)(THIS_ int X, int Y, DWORD Flags) { Call(__func__); }
+	STDMETHOD_(BOOL, ShowCursor)(THIS_ BOOL bShow) { Call(__func__); return 0; }
+	STDMETHOD(CreateAdditionalSwapChain)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DSwapChain9** pSwapChain) { return Call(__func__); }
+	STDMETHOD(GetSwapChain)(THIS_ UINT iSwapChain, IDirect3DSwapChain9** pSwapChain) { return Call(__func__); }
+	STDMETHOD_(UINT, GetNumberOfSwapChains)(THIS) { Call(__func__); return 0; }
+	STDMETHOD(Reset)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters) { return Call(__func__); }
+	STDMETHOD(Present)(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion) { return Call(__func__); }
+	STDMETHOD(GetBackBuffer)(THIS_ UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer) { return Call(__func__); }
+	STDMETHOD(GetRasterStatus)(THIS_ UINT iSwapChain, D3DRASTER_STATUS* pRasterStatus) { return Call(__func__); }
+	STDMETHOD(SetDialogBoxMode)(THIS_ BOOL bEnableDialogs) { return Call(__func__); }
+	STDMETHOD_(void, SetGammaRamp)(THIS_ UINT iSwapChain, DWORD Flags, CONST D3DGAMMARAMP* pRamp) { Call(__func__); }
+	STDMETHOD_(void, GetGammaRamp)(THIS_ UINT iSwapChain, D3DGAMMARAMP* pRamp) { Call(__func__); }
+	STDMETHOD(CreateTexture)(THIS_ UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(CreateVolumeTexture)(THIS_ UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(CreateCubeTexture)(THIS_ UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(CreateVertexBuffer)(THIS_ UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(CreateIndexBuffer)(THIS_ UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer9** ppIndexBuffer, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(CreateRenderTarget)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(CreateDepthStencilSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(UpdateSurface)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestinationSurface, CONST POINT* pDestPoint) { return Call(__func__); }
+	STDMETHOD(UpdateTexture)(THIS_ IDirect3DBaseTexture9* pSourceTexture, IDirect3DBaseTexture9* pDestinationTexture) { return Call(__func__); }
+	STDMETHOD(GetRenderTargetData)(THIS_ IDirect3DSurface9* pRenderTarget, IDirect3DSurface9* pDestSurface) { return Call(__func__); }
+	STDMETHOD(GetFrontBufferData)(THIS_ UINT iSwapChain, IDirect3DSurface9* pDestSurface) { return Call(__func__); }
+	STDMETHOD(StretchRect)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter) { return Call(__func__); }
+	STDMETHOD(ColorFill)(THIS_ IDirect3DSurface9* pSurface, CONST RECT* pRect, D3DCOLOR color) { return Call(__func__); }
+	STDMETHOD(CreateOffscreenPlainSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DPOOL Pool, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) { return Call(__func__); }
+	STDMETHOD(SetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) { return Call(__func__); }
+	STDMETHOD(GetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) { return Call(__func__); }
+	STDMETHOD(SetDepthStencilSurface)(THIS_ IDirect3DSurface9* pNewZStencil) { return Call(__func__); }
+	STDMETHOD(GetDepthStencilSurface)(THIS_ IDirect3DSurface9** ppZStencilSurface) { return Call(__func__); }
+	STDMETHOD(BeginScene)(THIS) { return Call(__func__); }
+	STDMETHOD(EndScene)(THIS) { return Call(__func__); }
+	STDMETHOD(Clear)(THIS_ DWORD Count, CONST D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil) { return Call(__func__); }
+	STDMETHOD(SetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix) { return Call(__func__); }
+	STDMETHOD(GetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix) { return Call(__func__); }
+	STDMETHOD(MultiplyTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix) { return Call(__func__); }
+	STDMETHOD(SetViewport)(THIS_ CONST D3DVIEWPORT9* pViewport) { return Call(__func__); }
+	STDMETHOD(GetViewport)(THIS_ D3DVIEWPORT9* pViewport) { return Call(__func__); }
+	STDMETHOD(SetMaterial)(THIS_ CONST D3DMATERIAL9* pMaterial) { return Call(__func__); }
+	STDMETHOD(GetMaterial)(THIS_ D3DMATERIAL9* pMaterial) { return Call(__func__); }
+	STDMETHOD(SetLight)(THIS_ DWORD Index, CONST D3DLIGHT9* pLight) { return Call(__func__); }
+	STDMETHOD(GetLight)(THIS_ DWORD Index, D3DLIGHT9* pLight) { return Call(__func__); }
+	STDMETHOD(LightEnable)(THIS_ DWORD Index, BOOL Enable) { return Call(__func__); }
+	STDMETHOD(GetLightEnable)(THIS_ DWORD Index, BOOL* pEnable) { return Call(__func__); }
+	STDMETHOD(SetClipPlane)(THIS_ DWORD Index, CONST float* pPlane) { return Call(__func__); }
+	STDMETHOD(GetClipPlane)(THIS_ DWORD Index, float* pPlane) { return Call(__func__); }
+	STDMETHOD(SetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD Value) { return Call(__func__); }
+	STDMETHOD(GetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD* pValue) { return Call(__func__); }
+	STDMETHOD(CreateStateBlock)(THIS_ D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB) { return Call(__func__); }
+	STDMETHOD(BeginStateBlock)(THIS) { return Call(__func__); }
+	STDMETHOD(EndStateBlock)(THIS_ IDirect3DStateBlock9** ppSB) { return Call(__func__); }
+	STDMETHOD(SetClipStatus)(THIS_ CONST D3DCLIPSTATUS9* pClipStatus) { return Call(__func__); }
+	STDMETHOD(GetClipStatus)(THIS_ D3DCLIPSTATUS9* pClipStatus) { return Call(__func__); }
+	STDMETHOD(GetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9** ppTexture) { return Call(__func__); }
+	STDMETHOD(SetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9* pTexture) { return Call(__func__); }
+	STDMETHOD(GetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) { return Call(__func__); }
+	STDMETHOD(SetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) { return Call(__func__); }
+	STDMETHOD(GetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD* pValue) { return Call(__func__); }
+	STDMETHOD(SetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) { return Call(__func__); }
+	STDMETHOD(ValidateDevice)(THIS_ DWORD* pNumPasses) { return Call(__func__); }
+	STDMETHOD(SetPaletteEntries)(THIS_ UINT PaletteNumber, CONST PALETTEENTRY* pEntries) { return Call(__func__); }
+	STDMETHOD(GetPaletteEntries)(THIS_ UINT PaletteNumber, PALETTEENTRY* pEntries) { return Call(__func__); }
+	STDMETHOD(SetCurrentTexturePalette)(THIS_ UINT PaletteNumber) { return Call(__func__); }
+	STDMETHOD(GetCurrentTexturePalette)(THIS_ UINT *PaletteNumber) { return Call(__func__); }
+	STDMETHOD(SetScissorRect)(THIS_ CONST RECT* pRect) { return Call(__func__); }
+	STDMETHOD(GetScissorRect)(THIS_ RECT* pRect) { return Call(__func__); }
+	STDMETHOD(SetSoftwareVertexProcessing)(THIS_ BOOL bSoftware) { return Call(__func__); }
+	STDMETHOD_(BOOL, GetSoftwareVertexProcessing)(THIS) { Call(__func__); return 0; }
+	STDMETHOD(SetNPatchMode)(THIS_ float nSegments) { return Call(__func__); }
+	STDMETHOD_(float, GetNPatchMode)(THIS) { Call(__func__); return 0; }
+	STDMETHOD(DrawPrimitive)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) { return Call(__func__); }
+	STDMETHOD(DrawIndexedPrimitive)(THIS_ D3DPRIMITIVETYPE, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount) { return Call(__func__); }
+	STDMETHOD(DrawPrimitiveUP)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) { return Call(__func__); }
+	STDMETHOD(DrawIndexedPrimitiveUP)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) { return Call(__func__); }
+	STDMETHOD(ProcessVertices)(THIS_ UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags) { return Call(__func__); }
+	STDMETHOD(CreateVertexDeclaration)(THIS_ CONST D3DVERTEXELEMENT9* pVertexElements, IDirect3DVertexDeclaration9** ppDecl) { return Call(__func__); }
+	STDMETHOD(SetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9* pDecl) { return Call(__func__); }
+	STDMETHOD(GetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9** ppDecl) { return Call(__func__); }
+	STDMETHOD(SetFVF)(THIS_ DWORD FVF) { return Call(__func__); }
+	STDMETHOD(GetFVF)(THIS_ DWORD* pFVF) { return Call(__func__); }
+	STDMETHOD(CreateVertexShader)(THIS_ CONST DWORD* pFunction, IDirect3DVertexShader9** ppShader) { return Call(__func__); }
+	STDMETHOD(SetVertexShader)(THIS_ IDirect3DVertexShader9* pShader) { return Call(__func__); }
+	STDMETHOD(GetVertexShader)(THIS_ IDirect3DVertexShader9** ppShader) { return Call(__func__); }
+	STDMETHOD(SetVertexShaderConstantF)(THIS_ UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount) { return Call(__func__); }
+	STDMETHOD(GetVertexShaderConstantF)(THIS_ UINT StartRegister, float* pConstantData, UINT Vector4fCount) { return Call(__func__); }
+	STDMETHOD(SetVertexShaderConstantI)(THIS_ UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount) { return Call(__func__); }
+	STDMETHOD(GetVertexShaderConstantI)(THIS_ UINT StartRegister, int* pConstantData, UINT Vector4iCount) { return Call(__func__); }
+	STDMETHOD(SetVertexShaderConstantB)(THIS_ UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount) { return Call(__func__); }
+	STDMETHOD(GetVertexShaderConstantB)(THIS_ UINT StartRegister, BOOL* pConstantData, UINT BoolCount) { return Call(__func__); }
+	STDMETHOD(SetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) { return Call(__func__); }
+	STDMETHOD(GetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) { return Call(__func__); }
+	STDMETHOD(SetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT Setting) { return Call(__func__); }
+	STDMETHOD(GetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT* pSetting) { return Call(__func__); }
+	STDMETHOD(SetIndices)(THIS_ IDirect3DIndexBuffer9* pIndexData) { return Call(__func__); }
+	STDMETHOD(GetIndices)(THIS_ IDirect3DIndexBuffer9** ppIndexData) { return Call(__func__); }
+	STDMETHOD(CreatePixelShader)(THIS_ CONST DWORD* pFunction, IDirect3DPixelShader9** ppShader) { return Call(__func__); }
+	STDMETHOD(SetPixelShader)(THIS_ IDirect3DPixelShader9* pShader) { return Call(__func__); }
+	STDMETHOD(GetPixelShader)(THIS_ IDirect3DPixelShader9** ppShader) { return Call(__func__); }
+	STDMETHOD(SetPixelShaderConstantF)(THIS_ UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount) { return Call(__func__); }
+	STDMETHOD(GetPixelShaderConstantF)(THIS_ UINT StartRegister, float* pConstantData, UINT Vector4fCount) { return Call(__func__); }
+	STDMETHOD(SetPixelShaderConstantI)(THIS_ UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount) { return Call(__func__); }
+	STDMETHOD(GetPixelShaderConstantI)(THIS_ UINT StartRegister, int* pConstantData, UINT Vector4iCount) { return Call(__func__); }
+	STDMETHOD(SetPixelShaderConstantB)(THIS_ UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount) { return Call(__func__); }
+	STDMETHOD(GetPixelShaderConstantB)(THIS_ UINT StartRegister, BOOL* pConstantData, UINT BoolCount) { return Call(__func__); }
+	STDMETHOD(DrawRectPatch)(THIS_ UINT Handle, CONST float* pNumSegs, CONST D3DRECTPATCH_INFO* pRectPatchInfo) { return Call(__func__); }
+	STDMETHOD(DrawTriPatch)(THIS_ UINT Handle, CONST float* pNumSegs, CONST D3DTRIPATCH_INFO* pTriPatchInfo) { return Call(__func__); }
+	STDMETHOD(DeletePatch)(THIS_ UINT Handle) { return Call(__func__); }
+	STDMETHOD(CreateQuery)(THIS_ D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery) { return Call(__func__); }
+
+	STDMETHOD(SetConvolutionMonoKernel)(THIS_ UINT width, UINT height, float* rows, float* columns) { return Call(__func__); }
+	STDMETHOD(ComposeRects)(THIS_ IDirect3DSurface9* pSrc, IDirect3DSurface9* pDst, IDirect3DVertexBuffer9* pSrcRectDescs, UINT NumRects, IDirect3DVertexBuffer9* pDstRectDescs, D3DCOMPOSERECTSOP Operation, int Xoffset, int Yoffset) { return Call(__func__); }
+	STDMETHOD(PresentEx)(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags) { return Call(__func__); }
+	STDMETHOD(GetGPUThreadPriority)(THIS_ INT* pPriority) { return Call(__func__); }
+	STDMETHOD(SetGPUThreadPriority)(THIS_ INT Priority) { return Call(__func__); }
+	STDMETHOD(WaitForVBlank)(THIS_ UINT iSwapChain) { return Call(__func__); }
+	STDMETHOD(CheckResourceResidency)(THIS_ IDirect3DResource9** pResourceArray, UINT32 NumResources) { return Call(__func__); }
+	STDMETHOD(SetMaximumFrameLatency)(THIS_ UINT MaxLatency) { return Call(__func__); }
+	STDMETHOD(GetMaximumFrameLatency)(THIS_ UINT* pMaxLatency) { return Call(__func__); }
+	STDMETHOD(CheckDeviceState)(THIS_ HWND hDestinationWindow) { return Call(__func__); }
+	STDMETHOD(CreateRenderTargetEx)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle, DWORD Usage) { return Call(__func__); }
+	STDMETHOD(CreateOffscreenPlainSurfaceEx)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DPOOL Pool, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle, DWORD Usage) { return Call(__func__); }
+	STDMETHOD(CreateDepthStencilSurfaceEx)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle, DWORD Usage) { return Call(__func__); }
+	STDMETHOD(ResetEx)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX *pFullscreenDisplayMode) { return Call(__func__); }
+	STDMETHOD(GetDisplayModeEx)(THIS_ UINT iSwapChain, D3DDISPLAYMODEEX* pMode, D3DDISPLAYROTATION* pRotation) { return Call(__func__); }
+};
+
+
+/*
+* Resources of the tests: reference counted, they count the live instances so that the tests see leaks and double releases.
+* The textures have a single level of Size bytes per face that LockRect and LockBox give access to.
+*/
+static int LiveResources = 0;
+
+template <class Interface> class MockResource : public Interface {
+public:
+	MockResource() : References(1) { LiveResources++; }
+	virtual ~MockResource() { LiveResources--; }
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) {
+		ULONG Result = --References;
+		if (!Result) delete this;
+		return Result;
+	}
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(SetPrivateData)(THIS_ REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetPrivateData)(THIS_ REFGUID refguid, void* pData, DWORD* pSizeOfData) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(FreePrivateData)(THIS_ REFGUID refguid) { return D3DERR_INVALIDCALL; }
+	STDMETHOD_(DWORD, SetPriority)(THIS_ DWORD PriorityNew) { return 0; }
+	STDMETHOD_(DWORD, GetPriority)(THIS) { return 0; }
+	STDMETHOD_(void, PreLoad)(THIS) {}
+
+	ULONG					References;
+};
+
+template <class Interface> class MockBaseTexture : public MockResource<Interface> {
+public:
+	MockBaseTexture(UInt32 Size, UInt32 Faces) : Bits(Size * Faces), Size(Size) {}
+
+	STDMETHOD_(DWORD, SetLOD)(THIS_ DWORD LODNew) { return 0; }
+	STDMETHOD_(DWORD, GetLOD)(THIS) { return 0; }
+	STDMETHOD_(DWORD, GetLevelCount)(THIS) { return 1; }
+	STDMETHOD(SetAutoGenFilterType)(THIS_ D3DTEXTUREFILTERTYPE FilterType) { return D3D_OK; }
+	STDMETHOD_(D3DTEXTUREFILTERTYPE, GetAutoGenFilterType)(THIS) { return D3DTEXF_LINEAR; }
+	STDMETHOD_(void, GenerateMipSubLevels)(THIS) {}
+
+	std::vector<char>		Bits;
+	UInt32					Size;
+};
+
+class MockSurface : public MockResource<IDirect3DSurface9> {
+public:
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) { return D3DRTYPE_SURFACE; }
+	STDMETHOD(GetContainer)(THIS_ REFIID riid, void** ppContainer) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetDesc)(THIS_ D3DSURFACE_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(LockRect)(THIS_ D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(UnlockRect)(THIS) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetDC)(THIS_ HDC* phdc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(ReleaseDC)(THIS_ HDC hdc) { return D3DERR_INVALIDCALL; }
+};
+
+class MockTexture : public MockBaseTexture<IDirect3DTexture9> {
+public:
+	MockTexture(UInt32 Size) : MockBaseTexture(Size, 1) {}
+
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) { return D3DRTYPE_TEXTURE; }
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetSurfaceLevel)(THIS_ UINT Level, IDirect3DSurface9** ppSurfaceLevel) {
+		if (Level) return D3DERR_INVALIDCALL;
+		*ppSurfaceLevel = new MockSurface();
+		return D3D_OK;
+	}
+	STDMETHOD(LockRect)(THIS_ UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) {
+		if (Level) return D3DERR_INVALIDCALL;
+		pLockedRect->Pitch = Size;
+		pLockedRect->pBits = Bits.data();
+		return D3D_OK;
+	}
+	STDMETHOD(UnlockRect)(THIS_ UINT Level) { return D3D_OK; }
+	STDMETHOD(AddDirtyRect)(THIS_ CONST RECT* pDirtyRect) { return D3D_OK; }
+};
+
+class MockVolumeTexture : public MockBaseTexture<IDirect3DVolumeTexture9> {
+public:
+	MockVolumeTexture(UInt32 Size) : MockBaseTexture(Size, 1) {}
+
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) { return D3DRTYPE_VOLUMETEXTURE; }
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DVOLUME_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetVolumeLevel)(THIS_ UINT Level, IDirect3DVolume9** ppVolumeLevel) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(LockBox)(THIS_ UINT Level, D3DLOCKED_BOX* pLockedVolume, CONST D3DBOX* pBox, DWORD Flags) {
+		if (Level) return D3DERR_INVALIDCALL;
+		pLockedVolume->RowPitch = pLockedVolume->SlicePitch = Size;
+		pLockedVolume->pBits = Bits.data();
+		return D3D_OK;
+	}
+	STDMETHOD(UnlockBox)(THIS_ UINT Level) { return D3D_OK; }
+	STDMETHOD(AddDirtyBox)(THIS_ CONST D3DBOX* pDirtyBox) { return D3D_OK; }
+};
+
+class MockCubeTexture : public MockBaseTexture<IDirect3DCubeTexture9> {
+public:
+	MockCubeTexture(UInt32 Size) : MockBaseTexture(Size, 6) {}
+
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) { return D3DRTYPE_CUBETEXTURE; }
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC* pDesc) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(GetCubeMapSurface)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface9** ppCubeMapSurface) { return D3DERR_INVALIDCALL; }
+	STDMETHOD(LockRect)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) {
+		if (Level || FaceType > 5) return D3DERR_INVALIDCALL;
+		pLockedRect->Pitch = Size;
+		pLockedRect->pBits = Bits.data() + FaceType * Size;
+		return D3D_OK;
+	}
+	STDMETHOD(UnlockRect)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level) { return D3D_OK; }
+	STDMETHOD(AddDirtyRect)(THIS_ D3DCUBEMAP_FACES FaceType, CONST RECT* pDirtyRect) { return D3D_OK; }
+};
@@ -0,0 +1,197 @@
+#include "Test.h"
+#include "OcclusionBuffer.h"
+#include "OcclusionBuffer.cpp"
+
+/*
+* Draws a fixed scene into a 128x72 buffer and compares the depth with tests/data/OcclusionBuffer.pgm, a 16 bit grey map of the
+* standard depth that any image viewer opens. Run with --update to write it again after an intended change of the rasterizer.
+* The same scene drawn with the reversed projection must give 1 - depth, and both modes must agree on every occludee.
+*/
+static const UInt32 Width = 128;
+static const UInt32 Height = 72;
+static const float Near = 10.0f;
+static const float Far = 10000.0f;
+static const char* GoldenFile = "data/OcclusionBuffer.pgm";
+
+static D3DXMATRIX GetProjection(bool Reversed) {
+
+	D3DXMATRIX Projection;
+	if (Reversed)
+		D3DXMatrixPerspectiveFovLH(&Projection, D3DXToRadian(75.0f), (float)Width / Height, Far, Near);
+	else
+		D3DXMatrixPerspectiveFovLH(&Projection, D3DXToRadian(75.0f), (float)Width / Height, Near, Far);
+	return Projection;
+
+}
+
+/*
+* The camera is at the origin looking along +z, so the scene is given in view space and drawn with the projection alone.
+* - a ground strip from behind the camera to the distance, crossing the near plane;
+* - a wall list at 500 covering the lower middle of the screen;
+* - a tilted triangle at 200 to 300 partly in front of the wall;
+* - a triangle behind the camera, entirely clipped.
+*/
+static void DrawScene(OcclusionBuffer* Buffer, bool Reversed) {
+
+	D3DXMATRIX Projection = GetProjection(Reversed);
+	Buffer->Clear(Reversed);
+
+	NiPoint3 Ground[] = { NiPoint3(-2000.0f, -100.0f, -50.0f), NiPoint3(2000.0f, -100.0f, -50.0f), NiPoint3(-2000.0f, -100.0f, 5000.0f), NiPoint3(2000.0f, -100.0f, 5000.0f) };
+	UInt16 GroundStrip[] = { 0, 2, 1, 3 };
+	Buffer->DrawTriangles(Ground, 4, GroundStrip, 4, true, &Projection);
+
+	NiPoint3 Wall[] = { NiPoint3(-200.0f, -100.0f, 500.0f), NiPoint3(200.0f, -100.0f, 500.0f), NiPoint3(-200.0f, 150.0f, 500.0f), NiPoint3(200.0f, 150.0f, 500.0f) };
+	UInt16 WallList[] = { 0, 2, 1, 1, 2, 3 };
+	Buffer->DrawTriangles(Wall, 4, WallList, 6, false, &Projection);
+
+	NiPoint3 Tilted[] = { NiPoint3(-150.0f, -50.0f, 200.0f), NiPoint3(-50.0f, 80.0f, 300.0f), NiPoint3(20.0f, -80.0f, 250.0f) };
+	UInt16 TiltedList[] = { 0, 1, 2 };
+	Buffer->DrawTriangles(Tilted, 3, TiltedList, 3, false, &Projection);
+
+	NiPoint3 Behind[] = { NiPoint3(-100.0f, 0.0f, -100.0f), NiPoint3(100.0f, 0.0f, -100.0f), NiPoint3(0.0f, 100.0f, -100.0f) };
+	Buffer->DrawTriangles(Behind, 3, TiltedList, 3, false, &Projection);
+
+	Buffer->Finalize();
+
+}
+
+static bool ReadGolden(std::vector<unsigned>& Values) {
+
+	FILE* File = fopen(GoldenFile, "r");
+	if (!File) return false;
+
+	unsigned FileWidth = 0, FileHeight = 0, MaxValue = 0;
+	bool Valid = fscanf(File, "P2 %u %u %u", &FileWidth, &FileHeight, &MaxValue) == 3 && FileWidth == Width && FileHeight == Height && MaxValue == 65535;
+	Values.resize(Width * Height);
+	for (UInt32 i = 0; Valid && i < Width * Height; i++) Valid = fscanf(File, "%u", &Values[i]) == 1;
+	fclose(File);
+	return Valid;
+
+}
+
+static void WriteGolden(OcclusionBuffer* Buffer) {
+
+	FILE* File = fopen(GoldenFile, "w");
+	if (!File) {
+		printf("  cannot write %s\n", GoldenFile);
+		TestFailures++;
+		return;
+	}
+
+	fprintf(File, "P2\n%u %u\n65535\n", (unsigned)Width, (unsigned)Height);
+	for (UInt32 y = 0; y < Height; y++) {
+		for (UInt32 x = 0; x < Width; x++) fprintf(File, "%u%c", (unsigned)lroundf(Buffer->GetDepth(x, y) * 65535.0f), x + 1 < Width ? ' ' : '\n');
+	}
+	fclose(File);
+	printf("  %s written\n", GoldenFile);
+
+}
+
+static bool UpdateGolden = false;
+
+TEST(DepthMatchesGolden) {
+
+	OcclusionBuffer Buffer;
+	Buffer.Initialize(Width, Height);
+	DrawScene(&Buffer, false);
+	CHECK_EQUAL(Buffer.TrianglesDrawn, 6);	// the ground quad clipped by the near plane gives 3 triangles, the one behind is dropped
+
+	if (UpdateGolden) WriteGolden(&Buffer);
+
+	std::vector<unsigned> Golden;
+	CHECK(ReadGolden(Golden));
+	if (Golden.size() != Width * Height) return;
+
+	UInt32 Mismatches = 0, Covered = 0;
+	for (UInt32 y = 0; y < Height; y++) {
+		for (UInt32 x = 0; x < Width; x++) {
+			SInt32 Value = lroundf(Buffer.GetDepth(x, y) * 65535.0f);
+			if (abs(Value - (SInt32)Golden[y * Width + x]) > 1) Mismatches++;
+			if (Value < 65535) Covered++;
+		}
+	}
+	printf("  %u pixels covered, %u differ from the golden depth\n", (unsigned)Covered, (unsigned)Mismatches);
+	CHECK_EQUAL(Mismatches, 0);
+
+	// the rows under the horizon are covered by the ground, whose depth grows towards the horizon
+	CHECK(Buffer.GetDepth(0, Height - 1) < Buffer.GetDepth(0, Height / 2 + 2));
+	CHECK_EQUAL(Buffer.GetDepth(0, 0), 1.0f);
+
+}
+
+TEST(ReversedDepthIsComplement) {
+
+	OcclusionBuffer Standard, Reversed;
+	Standard.Initialize(Width, Height);
+	Reversed.Initialize(Width, Height);
+	DrawScene(&Standard, false);
+	DrawScene(&Reversed, true);
+	CHECK_EQUAL(Reversed.TrianglesDrawn, Standard.TrianglesDrawn);
+
+	UInt32 Mismatches = 0;
+	float MaxError = 0.0f;
+	for (UInt32 y = 0; y < Height; y++) {
+		for (UInt32 x = 0; x < Width; x++) {
+			float Error = fabsf(Reversed.GetDepth(x, y) - (1.0f - Standard.GetDepth(x, y)));
+			MaxError = max(MaxError, Error);
+			if (Error > 1e-4f) Mismatches++;
+		}
+	}
+	printf("  max difference with 1 - depth %g\n", MaxError);
+	CHECK_EQUAL(Mismatches, 0);
+	CHECK_EQUAL(Reversed.GetDepth(0, 0), 0.0f);
+
+}
+
+struct Occludee {
+	const char*		Name;
+	NiPoint3		Center;
+	float			Radius;
+	bool			Visible;
+};
+
+TEST(OccludeesAgreeInBothModes) {
+
+	Occludee Occludees[] = {
+		{ "behind the wall", NiPoint3(0.0f, 20.0f, 900.0f), 40.0f, false },
+		{ "in front of the wall", NiPoint3(100.0f, 50.0f, 400.0f), 20.0f, true },
+		{ "above the wall", NiPoint3(0.0f, 400.0f, 900.0f), 40.0f, true },
+		{ "under the ground", NiPoint3(300.0f, -300.0f, 1500.0f), 50.0f, false },
+		{ "on the ground", NiPoint3(600.0f, -60.0f, 1500.0f), 50.0f, true },
+		{ "crossing the near plane", NiPoint3(0.0f, 0.0f, 5.0f), 20.0f, true },
+		{ "behind the camera", NiPoint3(0.0f, 0.0f, -500.0f), 20.0f, true },
+		{ "off the screen", NiPoint3(5000.0f, 0.0f, 900.0f), 20.0f, true },
+		{ "behind the tilted triangle", NiPoint3(-70.0f, 0.0f, 450.0f), 10.0f, false },
+	};
+
+	for (UInt32 Mode = 0; Mode < 2; Mode++) {
+		bool Reversed = Mode == 1;
+		D3DXMATRIX Projection = GetProjection(Reversed);
+		OcclusionBuffer Buffer;
+		Buffer.Initialize(Width, Height);
+		DrawScene(&Buffer, Reversed);
+		for (const Occludee& Object : Occludees) {
+			NiBound Bound;
+			Bound.Center = Object.Center;
+			Bound.Radius = Object.Radius;
+			bool Visible = Buffer.IsVisible(&Bound, &Projection);
+			if (Visible != Object.Visible) {
+				printf("  %s depth: %s is %s\n", Reversed ? "reversed" : "standard", Object.Name, Visible ? "visible" : "occluded");
+				TestFailures++;
+			}
+		}
+		CHECK_EQUAL(Buffer.OccludeesTested, 9);
+		CHECK_EQUAL(Buffer.OccludeesCulled, 3);
+	}
+
+}
+
+int main(int argc, char** argv) {
+
+	UpdateGolden = argc > 1 && !strcmp(argv[1], "--update");
+	RUN(DepthMatchesGolden);
+	RUN(ReversedDepthIsComplement);
+	RUN(OccludeesAgreeInBothModes);
+	TEST_RESULT();
+
+}
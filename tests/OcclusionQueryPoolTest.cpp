@@ -0,0 +1,272 @@
+#include "Test.h"
+#include "MockDevice.h"
+#include "OcclusionQueryPool.h"
+#include "OcclusionQueryPool.cpp"
+
+/*
+* Result the GPU gives to the next query ended: the visible pixels, available Latency frames after the query was issued.
+*/
+struct ScriptedResult {
+	UInt32	Latency;
+	DWORD	Pixels;
+};
+
+static std::deque<ScriptedResult> Script;
+static ScriptedResult NextResult = { 1, 0 };		// when the script is empty
+static OcclusionQueryPool* CurrentPool = NULL;
+
+class MockQuery : public IDirect3DQuery9 {
+public:
+	MockQuery() : References(1), ReadyFrame(0), Pixels(0), Flushes(0) {}
+	virtual ~MockQuery() {}
+
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) { *ppvObj = NULL; return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)(THIS) { return ++References; }
+	STDMETHOD_(ULONG, Release)(THIS) { return --References; }
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) { return D3D_OK; }
+	STDMETHOD_(D3DQUERYTYPE, GetType)(THIS) { return D3DQUERYTYPE_OCCLUSION; }
+	STDMETHOD_(DWORD, GetDataSize)(THIS) { return sizeof(DWORD); }
+	STDMETHOD(Issue)(THIS_ DWORD dwIssueFlags) {
+		if (dwIssueFlags & D3DISSUE_END) {
+			ScriptedResult Result = NextResult;
+			if (!Script.empty()) {
+				Result = Script.front();
+				Script.pop_front();
+			}
+			ReadyFrame = CurrentPool->Frame + Result.Latency;
+			Pixels = Result.Pixels;
+		}
+		return D3D_OK;
+	}
+	STDMETHOD(GetData)(THIS_ void* pData, DWORD dwSize, DWORD dwGetDataFlags) {
+		if (dwGetDataFlags & D3DGETDATA_FLUSH) Flushes++;
+		if (CurrentPool->Frame < ReadyFrame) return S_FALSE;
+		*(DWORD*)pData = Pixels;
+		return S_OK;
+	}
+
+	ULONG	References;
+	UInt32	ReadyFrame;
+	DWORD	Pixels;
+	UInt32	Flushes;		// the pool must never stall the CPU on a result
+};
+
+class QueryDevice : public NullDevice {
+public:
+	~QueryDevice() { for (MockQuery* Query : Queries) delete Query; }
+
+	STDMETHOD(CreateQuery)(THIS_ D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery) {
+		Call(__func__);
+		MockQuery* Query = new MockQuery();
+		Queries.push_back(Query);
+		*ppQuery = Query;
+		return D3D_OK;
+	}
+
+	UInt32 GetFlushes() {
+		UInt32 Result = 0;
+		for (MockQuery* Query : Queries) Result += Query->Flushes;
+		return Result;
+	}
+
+	std::vector<MockQuery*> Queries;
+};
+
+/*
+* A frame of OcclusionManager::RenderQuery for one object: collects the results, queries the object if it has none in flight.
+* Returns true if the object is considered occluded.
+*/
+static bool RunFrame(OcclusionQueryPool* Pool, void* Object, const NiBound* Bound) {
+
+	Pool->BeginFrame();
+	OcclusionQueryPool::ObjectState* State = Pool->GetState(Object, Bound);
+	if (Pool->BeginQuery(State)) Pool->EndQuery(State);
+	return State->Occluded;
+
+}
+
+static void Reset(OcclusionQueryPool* Pool, QueryDevice* Device, UInt32 MaxQueries) {
+
+	CurrentPool = Pool;
+	Script.clear();
+	NextResult = { 1, 0 };
+	Pool->Initialize(Device, MaxQueries);
+
+}
+
+static const NiBound Bound = { { 100.0f, 200.0f, 0.0f }, 50.0f };
+static const NiBound Moved = { { 110.0f, 200.0f, 0.0f }, 50.0f };
+
+/*
+* OccludedResults occluded results in a row occlude the object, a single visible one shows it again. VisiblePixels is still occluded.
+*/
+TEST(OccludedHysteresis) {
+
+	OcclusionQueryPool Pool;
+	QueryDevice Device;
+	int Object = 0;
+	Reset(&Pool, &Device, 16);
+
+	Script = { { 1, 0 }, { 1, OcclusionQueryPool::VisiblePixels }, { 1, 500 }, { 1, 0 }, { 1, 0 } };
+	CHECK(!RunFrame(&Pool, &Object, &Bound));		// issued, no result yet
+	CHECK(!RunFrame(&Pool, &Object, &Bound));		// first occluded result
+	CHECK(RunFrame(&Pool, &Object, &Bound));		// second occluded result
+	CHECK(!RunFrame(&Pool, &Object, &Bound));		// visible
+	CHECK(!RunFrame(&Pool, &Object, &Bound));
+	CHECK(RunFrame(&Pool, &Object, &Bound));
+	CHECK_EQUAL(Pool.GetState(&Object, &Bound)->OccludedCount, 2u);
+
+	CHECK_EQUAL(Pool.QueriesCount, 1u);				// the query goes back to the pool each frame
+	CHECK_EQUAL(Pool.InFlightCount, 1u);
+	CHECK_EQUAL(Pool.DroppedCount, 0u);
+	CHECK_EQUAL(Device.GetFlushes(), 0u);
+
+}
+
+/*
+* A result later than MaxLatency frames is given up on and the object is visible, the results in time are used whatever their latency.
+*/
+TEST(LateResultDropped) {
+
+	OcclusionQueryPool Pool;
+	QueryDevice Device;
+	int Object = 0;
+	Reset(&Pool, &Device, 16);
+
+	Script = { { 1, 0 }, { OcclusionQueryPool::MaxLatency, 0 }, { 10, 0 } };
+	RunFrame(&Pool, &Object, &Bound);
+	RunFrame(&Pool, &Object, &Bound);
+	for (UInt32 i = 1; i < OcclusionQueryPool::MaxLatency; i++) CHECK(!RunFrame(&Pool, &Object, &Bound));
+	CHECK(RunFrame(&Pool, &Object, &Bound));		// in time on the last frame allowed
+
+	OcclusionQueryPool::ObjectState* State = Pool.GetState(&Object, &Bound);
+	UInt32 Issued = State->IssuedFrame;
+	for (UInt32 i = 0; i < OcclusionQueryPool::MaxLatency; i++) {
+		CHECK(RunFrame(&Pool, &Object, &Bound));	// still waiting, no other query for the object
+		CHECK_EQUAL(State->IssuedFrame, Issued);
+	}
+	CHECK(!RunFrame(&Pool, &Object, &Bound));		// dropped, visible, and queried again
+	CHECK_EQUAL(State->IssuedFrame, Pool.Frame);
+	CHECK_EQUAL(State->OccludedCount, 0u);
+	CHECK_EQUAL(Pool.DroppedCount, 1u);
+	CHECK_EQUAL(Pool.QueriesCount, 1u);
+	CHECK_EQUAL(Pool.InFlightCount, 1u);
+
+}
+
+/*
+* The result of a query issued before the object moved is about the old bound: it is ignored and the object starts over as visible.
+*/
+TEST(StaleOnBoundChange) {
+
+	OcclusionQueryPool Pool;
+	QueryDevice Device;
+	int Object = 0;
+	Reset(&Pool, &Device, 16);
+
+	Script = { { 1, 0 }, { 1, 0 }, { 1, 0 } };
+	RunFrame(&Pool, &Object, &Bound);
+	RunFrame(&Pool, &Object, &Bound);
+	CHECK(RunFrame(&Pool, &Object, &Bound));
+
+	OcclusionQueryPool::ObjectState* State = Pool.GetState(&Object, &Moved);
+	CHECK(!State->Occluded);
+	CHECK(State->Stale);
+	CHECK(!RunFrame(&Pool, &Object, &Moved));		// the occluded result of the old bound is ignored
+	CHECK(!State->Stale);
+	CHECK_EQUAL(State->OccludedCount, 0u);
+	CHECK(!RunFrame(&Pool, &Object, &Moved));
+	CHECK(RunFrame(&Pool, &Object, &Moved));
+
+	// moving without a query in flight has nothing to ignore
+	Pool.BeginFrame();
+	State = Pool.GetState(&Object, &Bound);
+	CHECK(State->Query == NULL);
+	CHECK(!State->Occluded);
+	CHECK(!State->Stale);
+	CHECK(Pool.GetState(&Object, &Bound) == State);
+
+}
+
+/*
+* The objects not tested for more than EvictFrames frames are forgotten and start over as visible.
+*/
+TEST(EvictUnseen) {
+
+	OcclusionQueryPool Pool;
+	QueryDevice Device;
+	int Kept = 0;
+	int Evicted = 0;
+	Reset(&Pool, &Device, 16);
+
+	for (int i = 0; i < 3; i++) {
+		Pool.BeginFrame();
+		for (int* Object : { &Kept, &Evicted }) {
+			OcclusionQueryPool::ObjectState* State = Pool.GetState(Object, &Bound);
+			if (Pool.BeginQuery(State)) Pool.EndQuery(State);
+		}
+	}
+	CHECK_EQUAL(Pool.QueriesCount, 2u);
+
+	for (UInt32 i = 0; i < OcclusionQueryPool::EvictFrames; i++) {
+		Pool.BeginFrame();
+		if (i % 60 == 0) Pool.GetState(&Kept, &Bound);
+	}
+	CHECK(Pool.GetState(&Kept, &Bound)->Occluded);
+	CHECK(Pool.GetState(&Evicted, &Bound)->Occluded);	// EvictFrames frames unseen is still kept
+
+	for (UInt32 i = 0; i <= OcclusionQueryPool::EvictFrames; i++) {
+		Pool.BeginFrame();
+		if (i % 60 == 0) Pool.GetState(&Kept, &Bound);
+	}
+	CHECK(Pool.GetState(&Kept, &Bound)->Occluded);
+	OcclusionQueryPool::ObjectState* State = Pool.GetState(&Evicted, &Bound);
+	CHECK(!State->Occluded);
+	CHECK_EQUAL(State->OccludedCount, 0u);
+	CHECK(State->Query == NULL);
+	CHECK_EQUAL(Pool.InFlightCount, 0u);
+	CHECK_EQUAL(Pool.DroppedCount, 0u);
+
+	// the queries of the last results are free, no new one is created for two objects
+	Pool.BeginFrame();
+	CHECK(Pool.BeginQuery(Pool.GetState(&Kept, &Bound)));
+	CHECK(Pool.BeginQuery(State));
+	CHECK_EQUAL(Pool.QueriesCount, 2u);
+
+}
+
+/*
+* Past MaxQueries the objects are not queried and keep their last state.
+*/
+TEST(PoolExhausted) {
+
+	OcclusionQueryPool Pool;
+	QueryDevice Device;
+	int Objects[3] = {};
+	Reset(&Pool, &Device, 2);
+
+	Pool.BeginFrame();
+	CHECK(Pool.BeginQuery(Pool.GetState(&Objects[0], &Bound)));
+	CHECK(Pool.BeginQuery(Pool.GetState(&Objects[1], &Bound)));
+	CHECK(!Pool.BeginQuery(Pool.GetState(&Objects[2], &Bound)));
+	CHECK(!Pool.BeginQuery(Pool.GetState(&Objects[0], &Bound)));		// already in flight
+	CHECK_EQUAL(Pool.QueriesCount, 2u);
+	CHECK_EQUAL(Device.Calls["CreateQuery"], 2u);
+
+	Pool.BeginFrame();
+	CHECK_EQUAL(Pool.InFlightCount, 0u);
+	CHECK(Pool.BeginQuery(Pool.GetState(&Objects[2], &Bound)));
+	CHECK_EQUAL(Device.Calls["CreateQuery"], 2u);
+
+}
+
+int main() {
+
+	RUN(OccludedHysteresis);
+	RUN(LateResultDropped);
+	RUN(StaleOnBoundChange);
+	RUN(EvictUnseen);
+	RUN(PoolExhausted);
+	TEST_RESULT();
+
+}
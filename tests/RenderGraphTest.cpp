@@ -0,0 +1,312 @@
+#include "Test.h"
+
+/*
+* The members of EffectRecord read by the graph. An effect renders when it is enabled, loaded and its ShouldRender agrees.
+*/
+class EffectRecord {
+public:
+	EffectRecord() : Enabled(false), Loaded(true), Render(true), RenderedBufferSampler(-1), HasSourceBuffer(false) {}
+
+	bool					IsLoaded() { return Loaded; }
+	bool					ShouldRender() { return Render; }
+
+	bool					Enabled;
+	bool					Loaded;
+	bool					Render;
+	SInt32					RenderedBufferSampler;
+	bool					HasSourceBuffer;
+};
+
+#include "RenderGraph.h"
+#include "RenderGraph.cpp"
+
+typedef RenderGraph RG;
+
+static const UInt32 Width = 1920;
+static const UInt32 Height = 1080;
+
+/*
+* The chain of RenderGraph::DeclareEffectsChain, bound as ShaderManager::InitializeRenderGraph does: an effect per pass and the same
+* conditions on the game state. The passes record their name when executed instead of rendering.
+*/
+struct EffectsChain {
+	std::map<std::string, EffectRecord> Effects;
+	bool TonemappingEnabled = false;
+	bool isExterior = true;
+	UInt32 LightPoints = 6;
+	std::vector<std::string> Executed;
+	RenderGraph Graph;
+
+	EffectsChain() {
+
+		Graph.DeclareEffectsChain(Width, Height, Width / 2, Height / 2, [this](const char* Name) {
+			std::string Pass = Name;
+			if (Pass == "Tonemapping") return RG::PassBinding{ nullptr, nullptr, [this]() { return TonemappingEnabled; } };
+
+			auto ShadowsEnabled = [this]() { return (isExterior && Effects["ShadowsExteriors"].Enabled) || (!isExterior && Effects["ShadowsInteriors"].Enabled); };
+			std::function<bool()> Condition;
+			if (Pass == "PointShadows") Condition = ShadowsEnabled;
+			if (Pass == "PointShadows2") Condition = [this, ShadowsEnabled]() { return ShadowsEnabled() && LightPoints > 6; };
+			if (Pass == "SunShadows") Condition = [this, ShadowsEnabled]() { return ShadowsEnabled() && isExterior; };
+			if (Pass == "ShadowsExteriors") Condition = [this]() { return isExterior; };
+			if (Pass == "ShadowsInteriors") Condition = [this]() { return !isExterior; };
+			return RG::PassBinding{ &Effects[Pass], Record(Name), Condition };
+		});
+
+	}
+
+	EffectRecord& operator [] (const char* Name) {
+
+		CHECK(Effects.count(Name));
+		return Effects[Name];
+
+	}
+
+	std::function<void(IDirect3DSurface9*)> Record(const char* Name) {
+
+		return [this, Name](IDirect3DSurface9* RenderTarget) { Executed.push_back(Name); };
+
+	}
+
+	// compiles and runs both stages on a null device, returns the executed passes separated by spaces
+	std::string Run() {
+
+		Executed.clear();
+		Graph.Compile();
+		Graph.Execute(RG::PreTonemapping, nullptr);
+		Executed.push_back("|");
+		Graph.Execute(RG::PostTonemapping, nullptr);
+		std::string Result;
+		for (const std::string& Name : Executed) Result += (Result.empty() ? "" : " ") + Name;
+		return Result;
+
+	}
+
+	SInt32 PassIndex(const char* Name) {
+
+		for (UInt32 i = 0; i < Graph.Passes.size(); i++) {
+			if (!strcmp(Graph.Passes[i].Name, Name)) return i;
+		}
+		return -1;
+
+	}
+
+	const RG::ResourceDesc& Resource(RG::Resource Id) { return Graph.Resources[RG::GetResourceIndex(Id)]; }
+};
+
+#define CHECK_RUN(Chain, Expected) { \
+	std::string Result = (Chain).Run(); \
+	if (Result != (Expected)) { printf("%s:%d: executed \"%s\", expected \"%s\"\n", __FILE__, __LINE__, Result.c_str(), Expected); TestFailures++; } \
+}
+
+TEST(NothingEnabled) {
+
+	EffectsChain Chain;
+	CHECK_RUN(Chain, "|");
+	CHECK_EQUAL(Chain.Graph.ActivePassesCount, 0);
+	CHECK_EQUAL(Chain.Graph.CulledPassesCount, Chain.Graph.Passes.size());
+	CHECK_EQUAL(Chain.Graph.TransientMemory, 0);
+	CHECK_EQUAL(Chain.Graph.PeakTransientMemory, 0);
+
+}
+
+TEST(ProducersWithoutConsumersAreCulled) {
+
+	EffectsChain Chain;
+	Chain["CombineDepth"].Enabled = true;
+	Chain["Normals"].Enabled = true;
+	Chain["Bloom"].Enabled = true;
+	Chain["SMAA"].Enabled = true;
+	CHECK_RUN(Chain, "CombineDepth | SMAA");
+	CHECK_EQUAL(Chain.Resource(RG::NormalsBuffer).FirstUse, -1);
+	CHECK_EQUAL(Chain.Resource(RG::BloomBuffer).FirstUse, -1);
+
+	Chain["AmbientOcclusion"].Enabled = true;
+	CHECK_RUN(Chain, "CombineDepth Normals AmbientOcclusion | SMAA");
+	Chain["Lens"].Enabled = true;
+	CHECK_RUN(Chain, "CombineDepth Normals AmbientOcclusion Bloom Lens | SMAA");
+
+}
+
+TEST(DisabledAndConditionalPasses) {
+
+	EffectsChain Chain;
+	Chain["CombineDepth"].Enabled = true;
+	Chain["Normals"].Enabled = true;
+	Chain["PointShadows"].Enabled = true;
+	Chain["ShadowsExteriors"].Enabled = true;
+	CHECK_RUN(Chain, "CombineDepth Normals PointShadows ShadowsExteriors |");
+	Chain.isExterior = false;
+	CHECK_RUN(Chain, "|");	// nothing reads the lighting buffers in interiors
+	Chain.isExterior = true;
+	Chain["ShadowsExteriors"].Loaded = false;
+	CHECK_RUN(Chain, "|");
+	Chain["ShadowsExteriors"].Loaded = true;
+	Chain["ShadowsExteriors"].Render = false;
+	CHECK_RUN(Chain, "|");
+
+}
+
+/*
+* The shadow passes follow the game state: interiors use their own lighting pass and more than 6 point lights need the second pass.
+*/
+TEST(ShadowPassesFollowGameState) {
+
+	EffectsChain Chain;
+	const char* Shadows[] = { "CombineDepth", "Normals", "PointShadows", "PointShadows2", "SunShadows", "ShadowsExteriors", "ShadowsInteriors" };
+	for (const char* Name : Shadows) Chain[Name].Enabled = true;
+	CHECK_RUN(Chain, "CombineDepth Normals PointShadows SunShadows ShadowsExteriors |");
+	Chain.isExterior = false;
+	CHECK_RUN(Chain, "CombineDepth Normals PointShadows ShadowsInteriors |");
+	Chain.LightPoints = 8;
+	CHECK_RUN(Chain, "CombineDepth Normals PointShadows PointShadows2 ShadowsInteriors |");
+	Chain["ShadowsInteriors"].Enabled = false;
+	CHECK_RUN(Chain, "|");
+
+}
+
+/*
+* Every declared pass but the tonemapping sink has an effect.
+*/
+TEST(EveryPassIsBound) {
+
+	EffectsChain Chain;
+	CHECK_EQUAL(Chain.Graph.Passes.size(), Chain.Effects.size() + 1);
+	for (RG::Pass& Node : Chain.Graph.Passes) CHECK(Node.Effect || !strcmp(Node.Name, "Tonemapping"));
+	CHECK(Chain.PassIndex("Tonemapping") < Chain.PassIndex("Rain"));
+	CHECK_EQUAL(Chain.Resource(RG::BloomBuffer).Width, Width / 2);
+
+}
+
+TEST(SinkKeepsItsInputs) {
+
+	EffectsChain Chain;
+	Chain["Bloom"].Enabled = true;
+	CHECK_RUN(Chain, "|");
+	Chain.TonemappingEnabled = true;
+	CHECK_RUN(Chain, "Bloom |");	// the sink has no Execute, it only keeps the bloom buffer alive
+
+}
+
+TEST(AvgLumaRunsOnlyForItsReaders) {
+
+	EffectsChain Chain;
+	Chain["AvgLuma"].Enabled = true;
+	CHECK_RUN(Chain, "|");	// its own history read doesn't keep it alive
+	Chain.TonemappingEnabled = true;
+	CHECK_RUN(Chain, "|");
+	Chain["Exposure"].Enabled = true;
+	CHECK_RUN(Chain, "AvgLuma Exposure |");
+	Chain["Exposure"].Enabled = false;
+	Chain["DepthOfField"].Enabled = true;
+	CHECK_RUN(Chain, "AvgLuma | DepthOfField");
+	Chain["DepthOfField"].Enabled = false;
+	Chain["GodRays"].Enabled = true;
+	CHECK_RUN(Chain, "GodRays AvgLuma |");	// reads the previous frame's luma
+	Chain["GodRays"].Enabled = false;
+	Chain["Debug"].Enabled = true;
+	CHECK_RUN(Chain, "AvgLuma | Debug");
+
+}
+
+TEST(PassesRunInDeclarationOrder) {
+
+	EffectsChain Chain;
+	EffectRecord* All[] = { &Chain["CombineDepth"], &Chain["Normals"], &Chain["PointShadows"], &Chain["ShadowsExteriors"], &Chain["AmbientOcclusion"], &Chain["GodRays"],
+		&Chain["AvgLuma"], &Chain["Exposure"], &Chain["Bloom"], &Chain["Lens"], &Chain["Rain"], &Chain["DepthOfField"], &Chain["SMAA"], &Chain["Debug"] };
+	for (EffectRecord* Effect : All) Effect->Enabled = true;
+	Chain.TonemappingEnabled = true;
+	CHECK_RUN(Chain, "CombineDepth Normals PointShadows ShadowsExteriors AmbientOcclusion GodRays AvgLuma Exposure Bloom Lens | Rain DepthOfField SMAA Debug");
+	CHECK_EQUAL(Chain.Graph.ActivePassesCount, 15);
+	CHECK_EQUAL(Chain.Graph.CulledPassesCount, Chain.Graph.Passes.size() - 15);
+
+}
+
+TEST(SourceCopiesCount) {
+
+	EffectsChain Chain;
+	Chain["SMAA"].Enabled = true;
+	Chain["SMAA"].RenderedBufferSampler = 0;
+	Chain["Exposure"].Enabled = true;
+	Chain["Exposure"].HasSourceBuffer = true;
+	Chain["Bloom"].Enabled = true;
+	Chain["Bloom"].HasSourceBuffer = true;	// culled, and it doesn't write the color buffer anyway
+	Chain.Run();
+	CHECK_EQUAL(Chain.Graph.SourceCopiesCount, 2);
+
+}
+
+TEST(TransientMemoryAndAliasing) {
+
+	UInt32 FullScreen16 = Width * Height * 8;
+	EffectsChain Chain;
+	Chain["CombineDepth"].Enabled = true;
+	Chain["SMAA"].Enabled = true;
+	Chain.Run();
+	CHECK_EQUAL(Chain.Graph.TransientMemory, FullScreen16);
+	CHECK_EQUAL(Chain.Graph.PeakTransientMemory, FullScreen16);
+	CHECK_EQUAL(Chain.Resource(RG::DepthBuffer).FirstUse, 0);
+	CHECK_EQUAL(Chain.Resource(RG::DepthBuffer).LastUse, Chain.PassIndex("SMAA"));
+	CHECK_EQUAL(Chain.Resource(RG::ColorBuffer).AliasSlot, -1);	// the color buffer is never aliased
+
+	// depth and normals are alive together up to AmbientOcclusion, then depth and bloom until Lens
+	Chain["Normals"].Enabled = true;
+	Chain["AmbientOcclusion"].Enabled = true;
+	Chain["Bloom"].Enabled = true;
+	Chain["Lens"].Enabled = true;
+	Chain.Run();
+	UInt32 Bloom = (Width / 2) * (Height / 2) * 8;
+	CHECK_EQUAL(Chain.Graph.TransientMemory, FullScreen16 * 2 + Bloom);
+	CHECK_EQUAL(Chain.Graph.PeakTransientMemory, FullScreen16 * 2);	// normals end at AmbientOcclusion, before Bloom starts
+	CHECK_EQUAL(Chain.Graph.AliasedTransientMemory, FullScreen16 * 2 + Bloom);	// no two buffers share a description
+	CHECK(Chain.Resource(RG::DepthBuffer).AliasSlot != Chain.Resource(RG::NormalsBuffer).AliasSlot);
+
+}
+
+/*
+* Two buffers with the same description and disjoint lifetimes share a slot, a third overlapping one gets its own.
+*/
+TEST(DisjointBuffersShareSlot) {
+
+	EffectRecord First, Second, Third;
+	First.Enabled = Second.Enabled = Third.Enabled = true;
+	RenderGraph Graph;
+	Graph.AddResource(RG::ColorBuffer, "Color", 64, 64, D3DFMT_A8R8G8B8, true);
+	Graph.AddResource(RG::NormalsBuffer, "A", 64, 64, D3DFMT_A16B16G16R16F);
+	Graph.AddResource(RG::BloomBuffer, "B", 64, 64, D3DFMT_A16B16G16R16F);
+	Graph.AddResource(RG::ShadowPassBuffer, "C", 64, 64, D3DFMT_A16B16G16R16F);
+	Graph.AddPass("WriteA", RG::PreTonemapping, &First, 0, RG::NormalsBuffer, nullptr);
+	Graph.AddPass("ReadA", RG::PreTonemapping, &First, RG::ColorBuffer | RG::NormalsBuffer, RG::ColorBuffer, nullptr);
+	Graph.AddPass("WriteB", RG::PreTonemapping, &Second, 0, RG::BloomBuffer, nullptr);
+	Graph.AddPass("WriteC", RG::PreTonemapping, &Third, 0, RG::ShadowPassBuffer, nullptr);
+	Graph.AddPass("ReadBC", RG::PreTonemapping, &Second, RG::ColorBuffer | RG::BloomBuffer | RG::ShadowPassBuffer, RG::ColorBuffer, nullptr);
+	Graph.Compile();
+
+	UInt32 Size = 64 * 64 * 8;
+	const RG::ResourceDesc& A = Graph.Resources[RG::GetResourceIndex(RG::NormalsBuffer)];
+	const RG::ResourceDesc& B = Graph.Resources[RG::GetResourceIndex(RG::BloomBuffer)];
+	const RG::ResourceDesc& C = Graph.Resources[RG::GetResourceIndex(RG::ShadowPassBuffer)];
+	CHECK_EQUAL(A.AliasSlot, B.AliasSlot);
+	CHECK(C.AliasSlot != B.AliasSlot);
+	CHECK_EQUAL(Graph.TransientMemory, Size * 3);
+	CHECK_EQUAL(Graph.PeakTransientMemory, Size * 2);
+	CHECK_EQUAL(Graph.AliasedTransientMemory, Size * 2);
+
+}
+
+int main() {
+
+	RUN(NothingEnabled);
+	RUN(ProducersWithoutConsumersAreCulled);
+	RUN(DisabledAndConditionalPasses);
+	RUN(ShadowPassesFollowGameState);
+	RUN(EveryPassIsBound);
+	RUN(SinkKeepsItsInputs);
+	RUN(AvgLumaRunsOnlyForItsReaders);
+	RUN(PassesRunInDeclarationOrder);
+	RUN(SourceCopiesCount);
+	RUN(TransientMemoryAndAliasing);
+	RUN(DisjointBuffersShareSlot);
+	TEST_RESULT();
+
+}
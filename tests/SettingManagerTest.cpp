@@ -0,0 +1,371 @@
+#include "Test.h"
+#include <filesystem>
+
+/*
+* The parts of the game and of the other managers used by SettingManager. The weathers are never read by the tested paths.
+*/
+class TESForm {
+public:
+	enum FormType {
+		kFormType_Weather = 0x35,
+	};
+};
+
+class TESWeather : public TESForm {
+public:
+	enum TimeOfDay {
+		eTime_Sunrise = 0,
+		eTime_Day,
+		eTime_Sunset,
+		eTime_Night,
+	};
+	enum ColorTypes {
+		eColor_SkyUpper = 0,
+		eColor_Fog,
+		eColor_CloudsLower,
+		eColor_Ambient,
+		eColor_Sunlight,
+		eColor_Sun,
+		eColor_Stars,
+		eColor_SkyLower,
+		eColor_Horizon,
+		eColor_CloudsUpper,
+		eColor_Lighting = eColor_Stars,
+	};
+	static const int kNumTimeOfDay = 4;
+	static const int kNumColorTypes = 10;
+	struct RGBA {
+		UInt8 r, g, b, a;
+	};
+	struct ColorData {
+		RGBA colors[kNumTimeOfDay];
+	};
+
+	UInt8 GetCloudSpeedLower() { return 0; }
+	UInt8 GetCloudSpeedUpper() { return 0; }
+	float GetFogDayFar() { return 0.0f; }
+	float GetFogNightFar() { return 0.0f; }
+	float GetFogDayNear() { return 0.0f; }
+	float GetFogNightNear() { return 0.0f; }
+	UInt8 GetSunDamage() { return 0; }
+	UInt8 GetSunGlare() { return 0; }
+	UInt8 GetTransDelta() { return 0; }
+	UInt8 GetWindSpeed() { return 0; }
+	float GetHDR(UInt32 Index) { return 0.0f; }
+
+	ColorData colors[kNumColorTypes];
+};
+
+class TESWeatherEx : public TESWeather {
+public:
+	const char* GetEditorName() { return ""; }
+	void SetWindSpeed(UInt8 Value) {}
+	void SetCloudSpeedLower(UInt8 Value) {}
+	void SetCloudSpeedUpper(UInt8 Value) {}
+	void SetTransDelta(UInt8 Value) {}
+	void SetSunGlare(UInt8 Value) {}
+	void SetSunDamage(UInt8 Value) {}
+	void SetFogDayNear(float Value) {}
+	void SetFogDayFar(float Value) {}
+	void SetFogNightNear(float Value) {}
+	void SetFogNightFar(float Value) {}
+
+	ColorData colorsb[kNumColorTypes];
+};
+
+class SettingManagerBase {
+public:
+	void SetTextureAndHDR(TESWeatherEx* WeatherEx, char* UpperLayer, char* LowerLayer, float* HDR) {}
+};
+
+struct DataHandlerStub {
+	TESForm* GetFormByName(const char* Name, UInt32 Type) { return NULL; }
+	void FillNames(std::vector<std::string>* Names, UInt32 Type) {}
+};
+
+struct ShaderManager {
+	void SwitchShaderStatus(const char* Name) {}
+};
+
+struct GameMenuManager {
+	void UpdateSettings() { Updates++; }
+	void ValidateSelection() {}
+
+	UInt32 Updates = 0;
+};
+
+class SettingManager;
+static SettingManager* TheSettingManager = NULL;
+static ShaderManager* TheShaderManager = NULL;
+static GameMenuManager* TheGameMenuManager = NULL;
+static DataHandlerStub* DataHandler = NULL;
+
+static const char* WeatherColorTypes[TESWeather::kNumColorTypes] = { "SkyUpper", "Fog", "CloudsLower", "Ambient", "Sunlight", "Sun", "Stars", "SkyLower", "Horizon", "CloudsUpper" };
+static const char* WeatherTimesOfDay[TESWeather::kNumTimeOfDay] = { "Sunrise", "Day", "Sunset", "Night" };
+static const char* WeatherHDRTypes[14] = { "EyeAdaptation", "BlurRadius", "BlurPasses", "EmissiveMult", "TargetLUM", "UpperLUMClamp", "BrightScale", "BrightClamp", "LUMRampNoTex", "LUMRampMin", "LUMRampMax", "SunlightDimmer", "GrassDimmer", "TreeDimmer" };
+
+// the configs are read from CurrentDirectory, as the plugin reads them from the game directory
+static std::string CurrentDirectory;
+static const char* TomlSettingsFile = NULL;
+static const char* DefaultsSettingsFile = NULL;
+
+DWORD GetCurrentDirectoryA(DWORD BufferLength, char* Buffer) {
+
+	strcpy(Buffer, CurrentDirectory.c_str());
+	return CurrentDirectory.size();
+
+}
+
+#include "SettingManager.h"
+#include "SettingManager.cpp"
+
+/*
+* Starts a settings manager over the configs of the given directory.
+*/
+static void LoadConfig(const char* Directory, const char* Settings, const char* Defaults) {
+
+	CurrentDirectory = (std::filesystem::current_path() / Directory).string();
+	TomlSettingsFile = Settings;
+	DefaultsSettingsFile = Defaults;
+	delete TheSettingManager;
+	SettingManager::Initialize();
+	TheSettingManager->Config.Init();
+
+}
+
+struct SettingName {
+	std::string Section;
+	std::string Key;
+};
+
+/*
+* Every number setting of the defaults, in the order of the file.
+*/
+static void GetNumberSettings(tomlValue* Table, std::string Section, std::vector<SettingName>* Names) {
+
+	for (auto& [Key, Value] : Table->as_table()) {
+		if (Value.is_table()) {
+			std::string Name = Key[0] == '_' ? Key.substr(1) : Key;
+			GetNumberSettings(&Value, Section.empty() ? Name : Section + "." + Name, Names);
+		}
+		else if ((Value.is_integer() || Value.is_floating()) && Section.find('.') != std::string::npos) {
+			Names->push_back({ Section, Key });
+		}
+	}
+
+}
+
+/*
+* 100k reads of the number settings of the shipped defaults: through Configuration::FillNode and atof as the getters did before the slots,
+* through the getters with the same strings (slot cache), with the section built in a buffer (slot map), and through handles.
+*/
+TEST(LookupBenchmark) {
+
+	const UInt32 Lookups = 100000;
+
+	LoadConfig("../resource", "/NewVegasReloaded.dll.defaults.toml", "/NewVegasReloaded.dll.defaults.toml");		// a complete user config
+	std::vector<SettingName> Names;
+	GetNumberSettings(&TheSettingManager->Config.DefaultConfig, "", &Names);
+	printf("  %u number settings in the defaults\n", (unsigned)Names.size());
+	CHECK(Names.size() > 100);
+	if (Names.empty()) return;
+
+	std::vector<SettingHandle<float>> Handles;
+	for (SettingName& Name : Names) Handles.push_back(TheSettingManager->GetSettingHandle<float>(Name.Section.c_str(), Name.Key.c_str()));
+
+	double Sums[4] = {};
+	double Times[4] = {};
+	for (int Method = 0; Method < 4; Method++) {
+		char Section[256];
+		SettingManager::Configuration::ConfigNode Node;
+		auto Start = std::chrono::steady_clock::now();
+		for (UInt32 i = 0; i < Lookups; i++) {
+			SettingName& Name = Names[i % Names.size()];
+			switch (Method) {
+			case 0:
+				TheSettingManager->Config.FillNode(&Node, Name.Section.c_str(), Name.Key.c_str());
+				Sums[Method] += atof(Node.Value);
+				break;
+			case 1:
+				Sums[Method] += TheSettingManager->GetSettingF(Name.Section.c_str(), Name.Key.c_str());
+				break;
+			case 2:
+				strcpy(Section, Name.Section.c_str());
+				Sums[Method] += TheSettingManager->GetSettingF(Section, Name.Key.c_str());
+				break;
+			default:
+				Sums[Method] += Handles[i % Names.size()];
+				break;
+			}
+		}
+		Times[Method] = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+
+	printf("  %u lookups: FillNode %.2f ms, getters %.2f ms, getters with built sections %.2f ms, handles %.2f ms\n", (unsigned)Lookups,
+		Times[0] * 1000.0, Times[1] * 1000.0, Times[2] * 1000.0, Times[3] * 1000.0);
+	for (int Method = 1; Method < 4; Method++) CHECK(fabs(Sums[Method] - Sums[0]) <= fabs(Sums[0]) * 1e-6);
+	CHECK(Times[1] < Times[0]);
+	CHECK(Times[3] < Times[1]);
+
+}
+
+/*
+* A handle reads the value set after it was resolved, the getters with a reused buffer don't mix the settings up.
+*/
+TEST(HandlesFollowChanges) {
+
+	LoadConfig("../resource", "/NewVegasReloaded.dll.defaults.toml", "/NewVegasReloaded.dll.defaults.toml");
+	SettingHandle<float> Handle = TheSettingManager->GetSettingHandle<float>("Shaders.BloodLens.Main", "Chance");
+	SettingHandle<int> Missing = TheSettingManager->GetSettingHandle<int>("Shaders.BloodLens.Main", "Missing");
+	CHECK(Handle.IsValid());
+	CHECK(!Missing.IsValid());
+	CHECK_EQUAL(Missing.Get(), 0);
+
+	float Chance = Handle;
+	TheSettingManager->SetSettingF("Shaders.BloodLens.Main", "Chance", Chance + 10.0f);
+	CHECK(Handle.Get() == Chance + 10.0f);
+	CHECK(TheSettingManager->GetSettingF("Shaders.BloodLens.Main", "Chance") == Chance + 10.0f);
+
+	char Section[80];
+	strcpy(Section, "Shaders.BloodLens.Main");
+	float First = TheSettingManager->GetSettingF(Section, "Chance");
+	strcpy(Section, "Shaders.BloodLens.Status");
+	int Second = TheSettingManager->GetSettingI(Section, "Enabled");
+	CHECK(First == Chance + 10.0f);
+	CHECK_EQUAL(Second, TheSettingManager->GetSettingI("Shaders.BloodLens.Status", "Enabled"));
+	CHECK(TheSettingManager->GetSettingF(Section, "Chance") == 0.0f);		// not a key of the status section
+
+}
+
+static GameMenuManager MenuManager;
+
+/*
+* Sets the settings structs to values the fixture doesn't have, so the areas loaded again can be told apart.
+*/
+static void MarkAreas() {
+
+	TheSettingManager->SettingsMain.Main.FarPlaneDistance = -1.0f;
+	TheSettingManager->SettingsMain.CameraMode.FoV = -1.0f;
+	TheSettingManager->SettingsMain.Develop.TraceStatesFrames = 0;
+	TheSettingManager->SettingsColoring["Default"].Strength = -1.0f;
+	TheSettingManager->SettingsWater["Default"].choppiness = -1.0f;
+	MenuManager.Updates = 0;
+
+}
+
+/*
+* Runs the pending subscribers and lists the areas loaded since MarkAreas.
+*/
+static std::string UpdateAreas() {
+
+	TheSettingManager->UpdateSubscribers();
+
+	std::string Areas;
+	if (TheSettingManager->SettingsMain.Main.FarPlaneDistance != -1.0f) Areas += "Main ";
+	if (TheSettingManager->SettingsMain.CameraMode.FoV != -1.0f) Areas += "Gameplay ";
+	if (MenuManager.Updates) Areas += "Menu ";
+	if (TheSettingManager->SettingsMain.Develop.TraceStatesFrames) Areas += "Develop ";
+	if (TheSettingManager->SettingsColoring["Default"].Strength != -1.0f) Areas += "Coloring ";
+	if (TheSettingManager->SettingsWater["Default"].choppiness != -1.0f) Areas += "Water ";
+	MarkAreas();
+	return Areas;
+
+}
+
+/*
+* A change only loads the area of its section again, the menu layout is only updated by the menu settings, a value set again to
+* what it was loads nothing.
+*/
+TEST(SubscribersByArea) {
+
+	TheGameMenuManager = &MenuManager;
+	LoadConfig("data", "/Settings.toml", "/Settings.defaults.toml");
+	MarkAreas();
+	CHECK(UpdateAreas() == "Main Gameplay Menu Develop Coloring Water ");		// everything the first time
+	CHECK_EQUAL(TheSettingManager->SettingsWater.size(), 3u);
+	CHECK(!TheSettingManager->UpdateSubscribers());
+
+	TheSettingManager->SetSettingF("Main.CameraMode.Main", "FoV", 90.0f);
+	CHECK(UpdateAreas() == "Gameplay ");
+	TheSettingManager->SetSettingF("Main.CameraMode.Main", "FoV", 60.0f);
+	TheSettingManager->UpdateSubscribers();
+	CHECK(TheSettingManager->SettingsMain.CameraMode.FoV == 60.0f);
+	MarkAreas();
+
+	TheSettingManager->SetSettingF("Main.Main.Misc", "FarPlaneDistance", 100000.0f);
+	CHECK(UpdateAreas() == "Main ");
+	TheSettingManager->SetSetting("Main.Menu.Style", "TextSize", 24);
+	CHECK(UpdateAreas() == "Menu ");
+	TheSettingManager->SetSetting("Main.Develop.Main", "TraceStatesFrames", 5);
+	CHECK(UpdateAreas() == "Develop ");
+	TheSettingManager->SetSettingF("Shaders.Coloring.Default", "Strength", 0.5f);
+	CHECK(UpdateAreas() == "Coloring ");
+	TheSettingManager->SetSettingF("Shaders.Water.Interiors", "waveSpeed", 0.9f);
+	CHECK(UpdateAreas() == "Water ");
+	CHECK(TheSettingManager->SettingsWater["Interiors"].waveSpeed == 0.9f);
+
+	TheSettingManager->SetSettingF("Main.CameraMode.Main", "FoV", 60.0f);
+	TheSettingManager->SetSetting("Main.Menu.Style", "TextSize", 24);
+	CHECK(UpdateAreas() == "");
+	TheGameMenuManager = NULL;
+
+}
+
+static const char* WaterContext = NULL;
+static UInt32 WaterUpdates = 0;
+
+/*
+* A subscriber reading the water section of the cell is only updated on a cell change if the new section resolves to other values.
+* The keys of the user config count as much as the ones of the defaults.
+*/
+TEST(SubscribersFollowContext) {
+
+	LoadConfig("data", "/Settings.toml", "/Settings.defaults.toml");
+	CHECK(!TheSettingManager->SectionsDiffer("Shaders.Water.Default", "Shaders.Water.Placed"));		// Placed is overridden to the Default values
+	CHECK(TheSettingManager->SectionsDiffer("Shaders.Water.Default", "Shaders.Water.Interiors"));		// Interiors has the Default values in the defaults only
+	CHECK(TheSettingManager->SectionsDiffer("Shaders.Water.Default", "Shaders.Water.Custom"));		// in the user config only, so never read
+	CHECK(TheSettingManager->SectionsDiffer("Exterior", "Interior"));
+
+	WaterContext = "Shaders.Water.Default";
+	WaterUpdates = 0;
+	TheSettingManager->Subscribe("Water", []() {
+		WaterUpdates++;
+		TheSettingManager->GetSettingF(WaterContext, "choppiness");
+		TheSettingManager->GetSettingF(WaterContext, "waveSpeed");
+	}, []() { return WaterContext; });
+	TheSettingManager->UpdateSubscribers();
+	CHECK_EQUAL(WaterUpdates, 1u);
+
+	WaterContext = "Shaders.Water.Placed";
+	TheSettingManager->RefreshSubscribersContext();
+	TheSettingManager->UpdateSubscribers();
+	CHECK_EQUAL(WaterUpdates, 1u);
+	TheSettingManager->SetSettingF("Shaders.Water.Placed", "waveSpeed", 0.8f);		// the section it didn't read yet is followed
+	TheSettingManager->UpdateSubscribers();
+	CHECK_EQUAL(WaterUpdates, 2u);
+
+	WaterContext = "Shaders.Water.Interiors";
+	TheSettingManager->RefreshSubscribersContext();
+	TheSettingManager->UpdateSubscribers();
+	CHECK_EQUAL(WaterUpdates, 3u);
+	TheSettingManager->RefreshSubscribersContext();
+	TheSettingManager->UpdateSubscribers();
+	CHECK_EQUAL(WaterUpdates, 3u);
+
+	WaterContext = "Shaders.Water.Custom";
+	TheSettingManager->RefreshSubscribersContext();
+	TheSettingManager->UpdateSubscribers();
+	CHECK_EQUAL(WaterUpdates, 4u);
+
+}
+
+int main() {
+
+	RUN(LookupBenchmark);
+	RUN(HandlesFollowChanges);
+	RUN(SubscribersByArea);
+	RUN(SubscribersFollowContext);
+	delete TheSettingManager;
+	TEST_RESULT();
+
+}
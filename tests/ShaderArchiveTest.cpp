@@ -0,0 +1,339 @@
+#include "Test.h"
+#include <filesystem>
+#include <set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+#define ShadersPath			"Data\\Shaders\\NewVegasReloaded\\Shaders\\"
+#define EffectsPath			"Data\\Shaders\\NewVegasReloaded\\Effects\\"
+#define ShaderArchivePath	"Shaders.pack"
+
+#include "ShaderCache.h"
+#include "ShaderCache.cpp"
+#include "ShaderArchive.h"
+#include "ShaderArchive.cpp"
+
+BOOL GetFileAttributesExA(const char* FileName, GET_FILEEX_INFO_LEVELS InfoLevelId, void* FileInformation) {
+
+	std::error_code Error;
+	fs::file_time_type Time = fs::last_write_time(FileName, Error);
+	if (Error) return FALSE;
+
+	UInt64 Ticks = Time.time_since_epoch().count();
+	WIN32_FILE_ATTRIBUTE_DATA* Attributes = (WIN32_FILE_ATTRIBUTE_DATA*)FileInformation;
+	Attributes->ftLastWriteTime.dwLowDateTime = (DWORD)Ticks;
+	Attributes->ftLastWriteTime.dwHighDateTime = (DWORD)(Ticks >> 32);
+	return TRUE;
+
+}
+
+// the archive is mapped with mmap, a handle is a file descriptor
+static std::map<const void*, size_t> Views;
+
+HANDLE CreateFileA(const char* FileName, DWORD DesiredAccess, DWORD ShareMode, SECURITY_ATTRIBUTES* Attributes, DWORD CreationDisposition, DWORD FlagsAndAttributes, HANDLE TemplateFile) {
+
+	int File = open(FileName, O_RDONLY);
+	return File < 0 ? INVALID_HANDLE_VALUE : (HANDLE)(intptr_t)File;
+
+}
+
+BOOL GetFileSizeEx(HANDLE File, LARGE_INTEGER* FileSize) {
+
+	struct stat Info;
+	if (fstat((int)(intptr_t)File, &Info)) return FALSE;
+	FileSize->QuadPart = Info.st_size;
+	return TRUE;
+
+}
+
+HANDLE CreateFileMappingA(HANDLE File, SECURITY_ATTRIBUTES* Attributes, DWORD Protect, DWORD MaximumSizeHigh, DWORD MaximumSizeLow, const char* Name) {
+
+	int Mapping = dup((int)(intptr_t)File);
+	return Mapping < 0 ? NULL : (HANDLE)(intptr_t)Mapping;
+
+}
+
+void* MapViewOfFile(HANDLE FileMappingObject, DWORD DesiredAccess, DWORD FileOffsetHigh, DWORD FileOffsetLow, size_t NumberOfBytesToMap) {
+
+	struct stat Info;
+	if (fstat((int)(intptr_t)FileMappingObject, &Info)) return NULL;
+	void* View = mmap(NULL, Info.st_size, PROT_READ, MAP_PRIVATE, (int)(intptr_t)FileMappingObject, 0);
+	if (View == MAP_FAILED) return NULL;
+	Views[View] = Info.st_size;
+	return View;
+
+}
+
+BOOL UnmapViewOfFile(const void* BaseAddress) {
+
+	munmap((void*)BaseAddress, Views[BaseAddress]);
+	Views.erase(BaseAddress);
+	return TRUE;
+
+}
+
+BOOL CloseHandle(HANDLE Object) {
+
+	return !close((int)(intptr_t)Object);
+
+}
+
+class Buffer : public ID3DXBuffer {
+public:
+	Buffer(DWORD Size) : References(1), Content(Size, '\0') {}
+	virtual ~Buffer() {}
+
+	STDMETHOD(QueryInterface)(REFIID riid, void** ppvObj) { return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)() { return ++References; }
+	STDMETHOD_(ULONG, Release)() {
+		ULONG Result = --References;
+		if (!Result) delete this;
+		return Result;
+	}
+	STDMETHOD_(void*, GetBufferPointer)() { return (void*)Content.data(); }
+	STDMETHOD_(DWORD, GetBufferSize)() { return Content.size(); }
+
+	ULONG References;
+	std::string Content;
+};
+
+HRESULT WINAPI D3DXCreateBuffer(DWORD NumBytes, ID3DXBuffer** ppBuffer) {
+
+	*ppBuffer = new Buffer(NumBytes);
+	return S_OK;
+
+}
+
+/*
+* A compiled shader or effect of the loose cache: its sources are opened by the plugin with their game relative paths,
+* its compiled files are named by their game paths.
+*/
+struct CacheItem {
+	std::string		Compiled;	// game path, the key of the cache index and of the archive
+	std::string		Source;
+	UInt64			ConfigHash;
+	std::string		Preprocessed;
+	std::string		Binary;
+	bool			Helpers;	// includes Helpers.hlsl
+};
+
+static const fs::path Root = fs::temp_directory_path() / "TESR_ShaderArchiveTest";
+static const std::string Script = fs::absolute("../packShaders.py").string();
+static const char* ShadersFolder = "Data/Shaders/NewVegasReloaded/Shaders/";
+static const char* EffectsFolder = "Data/Shaders/NewVegasReloaded/Effects/";
+static std::vector<CacheItem> Items;
+
+static void WriteFile(const fs::path& Path, const std::string& Content) {
+
+	fs::create_directories(Path.parent_path());
+	std::ofstream(Path, std::ios::binary) << Content;
+
+}
+
+static std::string GetContent(ID3DXBuffer* Buffer) {
+
+	return std::string((const char*)Buffer->GetBufferPointer(), Buffer->GetBufferSize());
+
+}
+
+/*
+* Runs packShaders.py, returns its output.
+*/
+static std::string RunScript(const std::string& Arguments) {
+
+	std::string Output;
+	char Line[4096];
+	FILE* Pipe = popen(("\"" PythonExecutable "\" \"" + Script + "\" " + Arguments).c_str(), "r");
+	if (!Pipe) return Output;
+	while (fgets(Line, sizeof(Line), Pipe)) Output += Line;
+	CHECK_EQUAL(pclose(Pipe), 0);
+	return Output;
+
+}
+
+/*
+* Fills a game folder with the loose cache the plugin writes: sources, preprocessed sources, binaries and the cache indexes,
+* the indexes written by ShaderCache itself. Then packs it with packShaders.py pack-cache.
+*/
+static void BuildCache() {
+
+	fs::remove_all(Root);
+	fs::create_directories(Root);
+	fs::current_path(Root);
+	WriteFile(std::string(ShadersFolder) + "Includes/Helpers.hlsl", "float4 Helper() { return 1; }\n");
+	WriteFile(std::string(EffectsFolder) + "Includes/Helpers.hlsl", "float4 Helper() { return 2; }\n");
+
+	for (UInt32 i = 0; i < 48; i++) {
+		bool Effect = i >= 40;
+		std::string Name = Effect ? "TESTFX" + std::to_string(i) : "TEST" + std::to_string(i) + ".pso";
+		std::string Folder = Effect ? EffectsFolder : ShadersFolder;
+		CacheItem Item;
+		Item.Helpers = i % 2 == 0;
+		Item.Source = Folder + Name + (Effect ? ".fx.hlsl" : ".hlsl");
+		Item.Compiled = (Effect ? EffectsPath "Cache\\" + Name + ".fx" : ShadersPath "Cache\\" + Name);
+		Item.ConfigHash = ShaderCache::HashConfig(Item.Source.c_str(), NULL, NULL, Effect ? "fx_2_0" : "ps_3_0");
+		Item.Preprocessed = "preprocessed " + Name;
+		Item.Binary = std::string("binary\0", 7) + Name;
+		WriteFile(Item.Source, std::string(Item.Helpers ? "#include \"Includes/Helpers.hlsl\"\n" : "") + "float4 main() : COLOR0 { return " + std::to_string(i) + "; }\n");
+		std::string Compiled = Item.Compiled;
+		std::replace(Compiled.begin(), Compiled.end(), '\\', '/');
+		WriteFile(Compiled, Item.Binary);
+		WriteFile(Compiled + ".hlsl", Item.Preprocessed);
+		Items.push_back(Item);
+	}
+
+	{
+		ShaderCache Shaders((std::string(ShadersFolder) + "Cache/CacheIndex.txt").c_str());
+		ShaderCache Effects((std::string(EffectsFolder) + "Cache/CacheIndex.txt").c_str());
+		for (CacheItem& Item : Items) {
+			ShaderCache* Cache = Item.Source.find("Effects") != std::string::npos ? &Effects : &Shaders;
+			Cache->UpdateEntry(Item.Compiled.c_str(), Item.Source.c_str(), Item.ConfigHash);
+		}
+	}
+
+	printf("  %s", RunScript("pack-cache --game NewVegas --game-folder . --out " ShaderArchivePath).c_str());
+
+}
+
+/*
+* Every permutation listed is counted once in the summary, with a unique key, and the REVERSED_DEPTH variants double all the shaders
+* but not the effects.
+*/
+TEST(ListCount) {
+
+	UInt32 Counts[2] = { 0 };
+	UInt32 Summaries[2] = { 0 };
+	const char* Variants[2] = { "off", "both" };
+	std::set<std::string> Keys;
+
+	for (UInt32 v = 0; v < 2; v++) {
+		std::istringstream Output(RunScript(std::string("list --game NewVegas --reversed-depth ") + Variants[v]));
+		std::string Line;
+		while (std::getline(Output, Line)) {
+			if (Line.find(" <- ") != std::string::npos) {
+				Counts[v]++;
+				if (v) Keys.insert(Line.substr(0, 16));
+			}
+			else if (Line.find(" permutations, ") != std::string::npos) Summaries[v] = std::stoul(Line);
+		}
+	}
+
+	UInt32 Effects = 0;
+	for (const fs::directory_entry& Item : fs::directory_iterator("../src/hlsl/NewVegas/Effects")) {
+		std::string Name = Item.path().filename().string();
+		if (Name.size() > 8 && !Name.compare(Name.size() - 8, 8, ".fx.hlsl")) Effects++;
+	}
+	printf("  %u permutations, %u without REVERSED_DEPTH, %u effects\n", (unsigned)Counts[1], (unsigned)Counts[0], (unsigned)Effects);
+	CHECK(Counts[0] > Effects);
+	CHECK_EQUAL(Summaries[0], Counts[0]);
+	CHECK_EQUAL(Summaries[1], Counts[1]);
+	CHECK_EQUAL(Keys.size(), Counts[1]);
+	CHECK_EQUAL(Counts[1], 2 * Counts[0] - Effects);
+
+}
+
+/*
+* The keys listed are the ones the plugin looks up: ShaderCache::HashString of the compiled path over ShaderCache::HashConfig of the setup.
+*/
+TEST(ListKeysMatch) {
+
+	std::istringstream Output(RunScript("list --game NewVegas --reversed-depth both"));
+	std::string Line;
+	UInt32 Listed = 0;
+	UInt32 Matching = 0;
+	while (std::getline(Output, Line)) {
+		std::istringstream Fields(Line);
+		std::string Key, Profile, Compiled, Arrow, Source, Define;
+		if (!(Fields >> Key >> Profile >> Compiled >> Arrow >> Source) || Arrow != "<-") continue;
+		Listed++;
+
+		// the templated permutations name their template as source, the others their own file
+		std::string FileName = Source.substr(Source.rfind('\\') + 1);
+		std::string Template = FileName.substr(0, FileName.size() - 5);
+		bool Templated = Template.find(".vso") == std::string::npos && Template.find(".pso") == std::string::npos && Template.find(".fx") == std::string::npos;
+		std::vector<std::string> Names, Definitions;
+		while (Fields >> Define) {
+			size_t Separator = Define.find('=');
+			Names.push_back(Define.substr(0, Separator));
+			Definitions.push_back(Separator == std::string::npos ? "" : Define.substr(Separator + 1));
+		}
+		std::vector<D3DXMACRO> Macros;
+		for (UInt32 i = 0; i < Names.size(); i++) Macros.push_back({ Names[i].c_str(), Definitions[i].c_str() });
+		Macros.push_back({ NULL, NULL });
+
+		UInt64 ConfigHash = ShaderCache::HashConfig(Source.c_str(), Templated ? Template.c_str() : NULL, Macros.data(), Profile.c_str());
+		if (std::stoull(Key, nullptr, 16) == ShaderCache::HashString(Compiled.c_str(), ConfigHash)) Matching++;
+		else printf("  %s\n", Line.c_str());
+	}
+	CHECK(Listed > 0);
+	CHECK_EQUAL(Matching, Listed);
+
+}
+
+/*
+* Every entry of the cache indexes is found in the packed archive by its compiled path and setup, with its preprocessed source and
+* binary. An unknown path or another setup finds nothing.
+*/
+TEST(PackedEntriesFound) {
+
+	ShaderArchive Archive(ShaderArchivePath);
+	UInt32 Found = 0;
+	for (CacheItem& Item : Items) {
+		ID3DXBuffer* Source = NULL;
+		ID3DXBuffer* Binary = NULL;
+		if (!Archive.Find(Item.Compiled.c_str(), Item.ConfigHash, &Source, &Binary)) continue;
+		if (GetContent(Source) == Item.Preprocessed && GetContent(Binary) == Item.Binary) Found++;
+		Source->Release();
+		Binary->Release();
+	}
+	CHECK_EQUAL(Found, Items.size());
+
+	ID3DXBuffer* Source = NULL;
+	ID3DXBuffer* Binary = NULL;
+	const CacheItem& Item = Items.front();
+	CHECK(!Archive.Find(ShadersPath "Cache\\UNKNOWN.pso", Item.ConfigHash, &Source, &Binary));
+	CHECK(!Archive.Find(Item.Compiled.c_str(), ShaderCache::HashConfig(Item.Source.c_str(), NULL, NULL, "ps_2_0"), &Source, &Binary));
+	CHECK(!Source && !Binary);
+
+}
+
+/*
+* Changing a file invalidates the entries depending on it, the others are still found.
+*/
+TEST(ChangedIncludeInvalidates) {
+
+	std::ofstream(std::string(ShadersFolder) + "Includes/Helpers.hlsl", std::ios::app) << "// changed\n";
+
+	ShaderArchive Archive(ShaderArchivePath);
+	UInt32 Matching = 0;
+	for (CacheItem& Item : Items) {
+		ID3DXBuffer* Source = NULL;
+		ID3DXBuffer* Binary = NULL;
+		bool Expected = !Item.Helpers || Item.Source.find("Effects") != std::string::npos;
+		bool Found = Archive.Find(Item.Compiled.c_str(), Item.ConfigHash, &Source, &Binary);
+		if (Found == Expected) Matching++;
+		if (Found) {
+			Source->Release();
+			Binary->Release();
+		}
+	}
+	CHECK_EQUAL(Matching, Items.size());
+
+}
+
+int main() {
+
+	RUN(ListCount);
+	RUN(ListKeysMatch);
+	BuildCache();
+	RUN(PackedEntriesFound);
+	RUN(ChangedIncludeInvalidates);
+	fs::current_path(Root.parent_path());
+	fs::remove_all(Root);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,228 @@
+#include "Test.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// the indexes of the plugin are never loaded, the tests use their own
+#define ShadersPath		"ShaderCacheTest\\Shaders\\"
+#define EffectsPath		"ShaderCacheTest\\Effects\\"
+
+#include "ShaderCache.h"
+#include "ShaderCache.cpp"
+
+BOOL GetFileAttributesExA(const char* FileName, GET_FILEEX_INFO_LEVELS InfoLevelId, void* FileInformation) {
+
+	std::error_code Error;
+	fs::file_time_type Time = fs::last_write_time(FileName, Error);
+	if (Error) return FALSE;
+
+	UInt64 Ticks = Time.time_since_epoch().count();
+	WIN32_FILE_ATTRIBUTE_DATA* Attributes = (WIN32_FILE_ATTRIBUTE_DATA*)FileInformation;
+	Attributes->ftLastWriteTime.dwLowDateTime = (DWORD)Ticks;
+	Attributes->ftLastWriteTime.dwHighDateTime = (DWORD)(Ticks >> 32);
+	return TRUE;
+
+}
+
+static const fs::path Root = fs::temp_directory_path() / "TESR_ShaderCacheTest";
+static const fs::path Helpers[] = { Root / "Shaders" / "Includes" / "Helpers.hlsl", Root / "Effects" / "Includes" / "Helpers.hlsl" };
+static std::vector<std::string> Sources;	// the shaders and effects of the copy, the includes left out
+
+static std::vector<std::string> GetIncludeNames(const fs::path& Path) {
+
+	std::vector<std::string> Names;
+	std::ifstream File(Path);
+	std::string Line;
+	while (std::getline(File, Line)) {
+		size_t Directive = Line.find("#include");
+		size_t Start = Line.find('"', Directive);
+		size_t End = Line.find('"', Start + 1);
+		if (Directive != std::string::npos && Start != std::string::npos && End != std::string::npos) Names.push_back(Line.substr(Start + 1, End - Start - 1));
+	}
+	return Names;
+
+}
+
+/*
+* Windows finds the included files whatever the case of their names: the differently cased folders and files are linked to the real ones.
+*/
+static void LinkCase(const fs::path& Folder, const std::string& Name) {
+
+	fs::path Current = Folder;
+	for (const fs::path& Part : fs::path(Name)) {
+		fs::path Exact = Current / Part;
+		if (Part != ".." && !fs::exists(Exact)) {
+			if (!fs::is_directory(Current)) return;
+			fs::path Match;
+			for (const fs::directory_entry& Item : fs::directory_iterator(Current)) {
+				if (!_stricmp(Item.path().filename().c_str(), Part.c_str())) Match = Item.path().filename();
+			}
+			if (Match.empty()) return;
+			fs::create_symlink(Match, Exact);
+		}
+		Current = Exact;
+	}
+
+}
+
+/*
+* Copies the New Vegas shaders and effects, which the tests then change.
+*/
+static void CopySources() {
+
+	fs::remove_all(Root);
+	fs::copy("../src/hlsl/NewVegas", Root, fs::copy_options::recursive);
+
+	std::vector<fs::path> Files;
+	std::vector<fs::path> Folders = { Root };
+	for (const fs::directory_entry& Item : fs::recursive_directory_iterator(Root)) {
+		if (Item.is_directory()) Folders.push_back(Item.path());
+		if (Item.path().extension() != ".hlsl") continue;
+		Files.push_back(Item.path());
+		if (Item.path().parent_path().filename() != "Includes") Sources.push_back(Item.path().string());
+	}
+	for (const fs::path& File : Files) {
+		for (const std::string& Name : GetIncludeNames(File)) {
+			for (const fs::path& Folder : Folders) LinkCase(Folder, Name);
+		}
+	}
+
+}
+
+static std::string GetKey(const std::string& Source) {
+
+	return Source + ".cso";
+
+}
+
+static bool IncludesHelpers(const std::string& Source) {
+
+	std::vector<std::string> Files;
+	ShaderCache::GetIncludes(Source.c_str(), Files);
+	for (const std::string& File : Files) {
+		for (const fs::path& Path : Helpers) {
+			std::error_code Error;
+			if (fs::equivalent(File, Path, Error)) return true;
+		}
+	}
+	return false;
+
+}
+
+/*
+* Every source included by name, whatever the case, is a dependency of the entry: all the files naming Helpers.hlsl depend on it.
+*/
+TEST(IncludesFound) {
+
+	UInt32 Naming = 0;
+	UInt32 Found = 0;
+	for (const std::string& Source : Sources) {
+		bool Names = false;
+		for (const std::string& Name : GetIncludeNames(Source)) {
+			if (!_stricmp(fs::path(Name).filename().c_str(), "Helpers.hlsl")) Names = true;
+		}
+		if (!Names) continue;
+		Naming++;
+		if (IncludesHelpers(Source)) Found++;
+	}
+	printf("  %u sources, %u include Helpers.hlsl\n", (unsigned)Sources.size(), (unsigned)Naming);
+	CHECK(Naming > 0);
+	CHECK_EQUAL(Found, Naming);
+
+}
+
+/*
+* The entries of all the sources are valid once recorded, and still after the index is written and loaded again.
+* A different compilation setup isn't.
+*/
+TEST(IndexRoundTrip) {
+
+	std::string IndexPath = (Root / "CacheIndex.txt").string();
+	{
+		ShaderCache Cache(IndexPath.c_str());
+		for (const std::string& Source : Sources) Cache.UpdateEntry(GetKey(Source).c_str(), Source.c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_3_0"));
+		UInt32 Valid = 0;
+		for (const std::string& Source : Sources) {
+			if (Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_3_0"))) Valid++;
+		}
+		CHECK_EQUAL(Valid, Sources.size());
+	}
+	CHECK(fs::exists(IndexPath));
+
+	ShaderCache Cache(IndexPath.c_str());
+	UInt32 Valid = 0;
+	for (const std::string& Source : Sources) {
+		if (Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_3_0"))) Valid++;
+	}
+	CHECK_EQUAL(Valid, Sources.size());
+
+	D3DXMACRO Macros[] = { { "SHADOWS", "1" }, { NULL, NULL } };
+	const std::string& Source = Sources.front();
+	CHECK(!Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_2_0")));
+	CHECK(!Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, Macros, "ps_3_0")));
+	CHECK(!Cache.IsEntryValid("Unknown.cso", 0));
+
+}
+
+/*
+* Touching Helpers.hlsl keeps every entry. Changing it invalidates exactly the entries including it, and the index written then
+* has forgotten them.
+*/
+TEST(HelpersChangeInvalidates) {
+
+	std::string IndexPath = (Root / "CacheIndex.txt").string();
+	std::map<std::string, bool> Expected;
+	UInt32 Including = 0;
+	for (const std::string& Source : Sources) {
+		Expected[Source] = !IncludesHelpers(Source);
+		if (!Expected[Source]) Including++;
+	}
+	CHECK(Including > 0);
+	CHECK(Including < Sources.size());
+
+	for (const fs::path& Path : Helpers) fs::last_write_time(Path, fs::last_write_time(Path) + std::chrono::seconds(10));
+	{
+		ShaderCache Cache(IndexPath.c_str());
+		UInt32 Valid = 0;
+		for (const std::string& Source : Sources) {
+			if (Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_3_0"))) Valid++;
+		}
+		CHECK_EQUAL(Valid, Sources.size());
+	}
+
+	for (const fs::path& Path : Helpers) {
+		fs::file_time_type Time = fs::last_write_time(Path);
+		std::ofstream(Path, std::ios::app) << "\n// changed\n";
+		fs::last_write_time(Path, Time + std::chrono::seconds(10));
+	}
+	{
+		ShaderCache Cache(IndexPath.c_str());
+		UInt32 Matching = 0;
+		for (const std::string& Source : Sources) {
+			bool Valid = Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_3_0"));
+			if (Valid == Expected[Source]) Matching++;
+			else printf("  %s: %s\n", Source.c_str(), Valid ? "valid" : "invalid");
+		}
+		CHECK_EQUAL(Matching, Sources.size());
+	}
+
+	// the invalid entries were dropped from the index, the others were kept
+	ShaderCache Cache(IndexPath.c_str());
+	UInt32 Matching = 0;
+	for (const std::string& Source : Sources) {
+		if (Cache.IsEntryValid(GetKey(Source).c_str(), ShaderCache::HashConfig(Source.c_str(), NULL, NULL, "ps_3_0")) == Expected[Source]) Matching++;
+	}
+	CHECK_EQUAL(Matching, Sources.size());
+
+}
+
+int main() {
+
+	CopySources();
+	RUN(IncludesFound);
+	RUN(IndexRoundTrip);
+	RUN(HelpersChangeInvalidates);
+	fs::remove_all(Root);
+	TEST_RESULT();
+
+}
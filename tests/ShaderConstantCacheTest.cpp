@@ -0,0 +1,268 @@
+#include "Test.h"
+#include "ShaderConstantCache.h"
+#include "ShaderConstantCache.cpp"
+
+/*
+* A shader record reduced to what SetCT does with its constants: a table of (register, values, registers count) copied into the
+* cache, then uploaded through a backend that counts the calls and the registers sent, like the device would receive them.
+*/
+struct Constant {
+	UInt32			RegisterIndex;
+	UInt32			RegisterCount;
+	D3DXVECTOR4*	Value;
+};
+
+struct Upload {
+	UInt32			Stage;
+	UInt32			RegisterIndex;
+	UInt32			RegisterCount;
+};
+
+static std::vector<Upload> Uploads;
+static D3DXVECTOR4 Device[2][256];
+
+class MockRecord {
+public:
+	MockRecord(UInt32 Stage, std::vector<Constant> Table) : Constants(Table) {
+
+		UInt32 RegisterEnd = 0;
+		for (const Constant& c : Constants) RegisterEnd = max(RegisterEnd, c.RegisterIndex + c.RegisterCount);
+		Cache.Stage = Stage;
+		Cache.Initialize(Constants[0].RegisterIndex, RegisterEnd - Constants[0].RegisterIndex);
+
+	}
+
+	void SetCT() {
+
+		for (const Constant& c : Constants) Cache.Set(c.RegisterIndex, c.Value, c.RegisterCount);
+		UInt32 Stage = Cache.Stage;
+		Cache.Upload([Stage](UInt32 RegisterIndex, D3DXVECTOR4* Values, UInt32 RegisterCount) {
+			Uploads.push_back({ Stage, RegisterIndex, RegisterCount });
+			memcpy(&Device[Stage][RegisterIndex], Values, RegisterCount * sizeof(D3DXVECTOR4));
+		});
+
+	}
+
+	// the device holds the values of the table, whatever was skipped
+	bool DeviceMatches() {
+
+		for (const Constant& c : Constants) {
+			if (memcmp(&Device[Cache.Stage][c.RegisterIndex], c.Value, c.RegisterCount * sizeof(D3DXVECTOR4))) return false;
+		}
+		return true;
+
+	}
+
+	std::vector<Constant> Constants;
+	ShaderConstantCache Cache;
+};
+
+static UInt32 UploadedRegisters() {
+
+	UInt32 Count = 0;
+	for (const Upload& u : Uploads) Count += u.RegisterCount;
+	return Count;
+
+}
+
+static void Reset() {
+
+	Uploads.clear();
+	memset(Device, 0, sizeof(Device));
+	ShaderConstantCache::EndBatch();
+
+}
+
+static D3DXVECTOR4 A[4], B, C, D;
+
+// registers 10-13 (a matrix), 14, 15 and 20: two runs when everything is dirty
+static MockRecord* MakeRecord(UInt32 Stage) {
+
+	for (int i = 0; i < 4; i++) A[i] = D3DXVECTOR4(1.0f + i, 0.0f, 0.0f, 1.0f);
+	B = D3DXVECTOR4(2.0f, 2.0f, 2.0f, 2.0f);
+	C = D3DXVECTOR4(3.0f, 3.0f, 3.0f, 3.0f);
+	D = D3DXVECTOR4(4.0f, 4.0f, 4.0f, 4.0f);
+	return new MockRecord(Stage, { { 10, 4, A }, { 14, 1, &B }, { 15, 1, &C }, { 20, 1, &D } });
+
+}
+
+TEST(OutsideBatchUploadsEverythingInMergedRuns) {
+
+	Reset();
+	MockRecord* Record = MakeRecord(0);
+	for (int i = 0; i < 3; i++) Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 6);
+	CHECK_EQUAL(Uploads[0].RegisterIndex, 10);
+	CHECK_EQUAL(Uploads[0].RegisterCount, 6);
+	CHECK_EQUAL(Uploads[1].RegisterIndex, 20);
+	CHECK_EQUAL(Uploads[1].RegisterCount, 1);
+	CHECK(Record->DeviceMatches());
+	delete Record;
+
+}
+
+TEST(UnchangedValuesAreSkippedInsideBatch) {
+
+	Reset();
+	MockRecord* Record = MakeRecord(0);
+	ShaderConstantCache::BeginBatch();
+	Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 2);
+	for (int i = 0; i < 100; i++) Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 2);
+	CHECK(Record->DeviceMatches());
+	ShaderConstantCache::EndBatch();
+	delete Record;
+
+}
+
+TEST(ChangedRegisterIsUploadedAlone) {
+
+	Reset();
+	MockRecord* Record = MakeRecord(0);
+	ShaderConstantCache::BeginBatch();
+	Record->SetCT();
+	Uploads.clear();
+	A[2].y = 5.0f;
+	Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 1);
+	CHECK_EQUAL(Uploads[0].RegisterIndex, 10);	// the whole constant is compared, the matrix is sent again
+	CHECK_EQUAL(Uploads[0].RegisterCount, 4);
+	Uploads.clear();
+	D.w = 0.5f;
+	Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 1);
+	CHECK_EQUAL(Uploads[0].RegisterIndex, 20);
+	CHECK_EQUAL(Uploads[0].RegisterCount, 1);
+	CHECK(Record->DeviceMatches());
+	ShaderConstantCache::EndBatch();
+	delete Record;
+
+}
+
+TEST(AdjacentChangedRegistersAreMerged) {
+
+	Reset();
+	MockRecord* Record = MakeRecord(0);
+	ShaderConstantCache::BeginBatch();
+	Record->SetCT();
+	Uploads.clear();
+	B.x = 7.0f;
+	C.x = 7.0f;
+	Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 1);
+	CHECK_EQUAL(Uploads[0].RegisterIndex, 14);
+	CHECK_EQUAL(Uploads[0].RegisterCount, 2);
+	Uploads.clear();
+	B.x = 8.0f;
+	D.x = 8.0f;
+	Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 2);
+	CHECK_EQUAL(UploadedRegisters(), 2);
+	CHECK(Record->DeviceMatches());
+	ShaderConstantCache::EndBatch();
+	delete Record;
+
+}
+
+TEST(OtherRecordOnSameStageInvalidatesCopy) {
+
+	Reset();
+	MockRecord* First = MakeRecord(0);
+	MockRecord* Second = MakeRecord(0);
+	MockRecord* Pixel = MakeRecord(1);
+	ShaderConstantCache::BeginBatch();
+	First->SetCT();
+	Pixel->SetCT();
+	Uploads.clear();
+	First->SetCT();
+	CHECK_EQUAL(Uploads.size(), 0);	// the pixel stage has its own registers
+	Second->SetCT();
+	CHECK_EQUAL(Uploads.size(), 2);
+	Uploads.clear();
+	First->SetCT();
+	CHECK_EQUAL(Uploads.size(), 2);	// the second record owned the stage, the first one's copy is stale
+	CHECK_EQUAL(UploadedRegisters(), 7);
+	CHECK(First->DeviceMatches());
+	CHECK(Pixel->DeviceMatches());
+	ShaderConstantCache::EndBatch();
+	delete First;
+	delete Second;
+	delete Pixel;
+
+}
+
+TEST(EndBatchInvalidatesCopy) {
+
+	Reset();
+	MockRecord* Record = MakeRecord(1);
+	ShaderConstantCache::BeginBatch();
+	Record->SetCT();
+	ShaderConstantCache::EndBatch();
+	memset(Device, 0, sizeof(Device));	// the game writes the registers between the batches
+	ShaderConstantCache::BeginBatch();
+	Uploads.clear();
+	Record->SetCT();
+	CHECK_EQUAL(Uploads.size(), 2);
+	CHECK(Record->DeviceMatches());
+	ShaderConstantCache::EndBatch();
+	delete Record;
+
+}
+
+TEST(DeletedOwnerReleasesStage) {
+
+	Reset();
+	MockRecord* First = MakeRecord(0);
+	ShaderConstantCache::BeginBatch();
+	First->SetCT();
+	delete First;
+	CHECK(ShaderConstantCache::Owner[0] == nullptr);
+	ShaderConstantCache::EndBatch();
+
+}
+
+/*
+* A frame of shadow and object passes: 4 records alternating on 2000 draws, one constant changing on every draw.
+* Counts the calls against what the unfiltered loop sent, one call per constant per draw.
+*/
+TEST(RepeatedDrawsCountUploads) {
+
+	Reset();
+	MockRecord* Vertex[2] = { MakeRecord(0), MakeRecord(0) };
+	MockRecord* Pixel[2] = { MakeRecord(1), MakeRecord(1) };
+	const UInt32 Draws = 2000;
+	ShaderConstantCache::BeginBatch();
+	for (UInt32 i = 0; i < Draws; i++) {
+		UInt32 Pass = i / 500 % 2;
+		D.x = (float)i;
+		Vertex[Pass]->SetCT();
+		Pixel[Pass]->SetCT();
+		CHECK(Vertex[Pass]->DeviceMatches());
+		CHECK(Pixel[Pass]->DeviceMatches());
+	}
+	ShaderConstantCache::EndBatch();
+	UInt32 Unfiltered = Draws * 2 * 4;
+	printf("  %u calls and %u registers uploaded, %u calls without the cache\n", (unsigned)Uploads.size(), (unsigned)UploadedRegisters(), (unsigned)Unfiltered);
+	CHECK(Uploads.size() < Draws * 2 + 16);
+	CHECK(UploadedRegisters() < Draws * 2 + 64);
+	for (int i = 0; i < 2; i++) {
+		delete Vertex[i];
+		delete Pixel[i];
+	}
+
+}
+
+int main() {
+
+	RUN(OutsideBatchUploadsEverythingInMergedRuns);
+	RUN(UnchangedValuesAreSkippedInsideBatch);
+	RUN(ChangedRegisterIsUploadedAlone);
+	RUN(AdjacentChangedRegistersAreMerged);
+	RUN(OtherRecordOnSameStageInvalidatesCopy);
+	RUN(EndBatchInvalidatesCopy);
+	RUN(DeletedOwnerReleasesStage);
+	RUN(RepeatedDrawsCountUploads);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,319 @@
+#include "Test.h"
+#include "ShaderTemplate.h"
+
+/*
+* The part of ShaderCollection read by the test: the template table of a collection.
+*/
+class ShaderCollection {
+public:
+	ShaderCollection(const char* ShaderName) : Name(ShaderName) {}
+	virtual ~ShaderCollection() {}
+
+	virtual std::map<std::string_view, ShaderTemplate> Templates() { return std::map<std::string_view, ShaderTemplate>(); }
+
+	const char* Name;
+};
+
+#include "PBR.h"
+#include "POM.h"
+#include "Terrain.h"
+
+#include "ShaderProgramCache.h"
+#include "ShaderProgramCache.cpp"
+
+static int LiveObjects = 0;
+
+/*
+* Reference counted COM object, counting the live instances so that the tests see leaks and double releases.
+*/
+class MockObject : public IUnknown {
+public:
+	MockObject() : References(1) { LiveObjects++; }
+	virtual ~MockObject() { LiveObjects--; }
+
+	STDMETHOD(QueryInterface)(REFIID riid, void** ppvObj) { return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)() { return ++References; }
+	STDMETHOD_(ULONG, Release)() {
+		ULONG Result = --References;
+		if (!Result) delete this;
+		return Result;
+	}
+
+	ULONG References;
+};
+
+class MockBuffer : public ID3DXBuffer {
+public:
+	MockBuffer(const std::string& Content) : References(1), Content(Content) { LiveObjects++; }
+	virtual ~MockBuffer() { LiveObjects--; }
+
+	STDMETHOD(QueryInterface)(REFIID riid, void** ppvObj) { return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)() { return ++References; }
+	STDMETHOD_(ULONG, Release)() {
+		ULONG Result = --References;
+		if (!Result) delete this;
+		return Result;
+	}
+	STDMETHOD_(void*, GetBufferPointer)() { return (void*)Content.data(); }
+	STDMETHOD_(DWORD, GetBufferSize)() { return Content.size(); }
+
+	ULONG References;
+	std::string Content;
+};
+
+/*
+* FNV-1a, as ShaderCache::Hash keys the programs in ShaderRecord.
+*/
+static UInt64 Hash(const std::string& Data) {
+
+	UInt64 Result = 14695981039346656037ull;
+	for (unsigned char Byte : Data) {
+		Result ^= Byte;
+		Result *= 1099511628211ull;
+	}
+	return Result;
+
+}
+
+struct Permutation {
+	std::string Name;
+	std::string Program;		// stands in for the preprocessed source and profile
+};
+
+/*
+* The template permutations of the effects, with the program a permutation preprocesses to: same source, profile and defines
+* in any order give the same code, as packShaders.py groups them.
+*/
+static std::vector<Permutation> GetPermutations() {
+
+	std::vector<Permutation> Result;
+	PBRShaders PBR;
+	POMShaders POM;
+	TerrainShaders Terrain;
+	ShaderCollection* Collections[] = { &PBR, &POM, &Terrain };
+	for (ShaderCollection* Collection : Collections) {
+		for (auto& Item : Collection->Templates()) {
+			std::vector<std::string> Defines;
+			for (const D3DXMACRO* Macro = Item.second.Defines; Macro->Name; Macro++) Defines.push_back(std::string(Macro->Name) + "=" + Macro->Definition);
+			std::sort(Defines.begin(), Defines.end());
+
+			std::string Program = std::string(Item.second.Name) + (Item.first.find(".vso") != std::string_view::npos ? " vs_3_0" : " ps_3_0");
+			for (std::string& Define : Defines) Program += " " + Define;
+			Result.push_back({ std::string(Item.first), Program });
+		}
+	}
+	return Result;
+
+}
+
+/*
+* The startup compilation of ShaderRecord::CompileShader: a permutation compiles unless an identical one already did.
+*/
+TEST(CompilesOnceByProgram) {
+
+	std::vector<Permutation> Permutations = GetPermutations();
+	std::map<std::string, std::string> Expected;		// program -> first permutation compiling it
+	for (Permutation& Item : Permutations) Expected.emplace(Item.Program, Item.Name);
+
+	ShaderProgramCache Cache;
+	std::map<std::string, IUnknown*> Binaries;
+	UInt32 Compiles = 0;
+	for (Permutation& Item : Permutations) {
+		MockBuffer* Source = new MockBuffer(Item.Program);
+		IUnknown* Binary = Cache.Find(Hash(Item.Program), Source);
+		if (!Binary) {
+			Binary = new MockObject();
+			Cache.Add(Hash(Item.Program), Source, Binary);
+			Compiles++;
+			CHECK(Expected[Item.Program] == Item.Name);
+		}
+		CHECK(!Binaries.count(Item.Program) || Binaries[Item.Program] == Binary);
+		Binaries[Item.Program] = Binary;
+		Binary->Release();
+		Source->Release();
+	}
+	printf("  %u permutations, %u compiled\n", (unsigned)Permutations.size(), (unsigned)Compiles);
+	CHECK_EQUAL(Compiles, Expected.size());
+	CHECK_EQUAL(Cache.GetProgramsCount(), Expected.size());
+	CHECK(Compiles < Permutations.size());
+	CHECK(Binaries[Permutations[0].Program] != nullptr);
+
+	Cache.Clear();
+	CHECK_EQUAL(Cache.GetProgramsCount(), 0);
+	CHECK_EQUAL(LiveObjects, 0);
+
+}
+
+/*
+* SLS2000, SLS2001 and SLS2007.vso have the same template and defines in the PBR table.
+*/
+TEST(IdenticalPermutationsShare) {
+
+	std::map<std::string, std::string> Programs;
+	for (Permutation& Item : GetPermutations()) Programs[Item.Name] = Item.Program;
+	CHECK(Programs["SLS2000.vso"] == Programs["SLS2001.vso"]);
+	CHECK(Programs["SLS2000.vso"] == Programs["SLS2007.vso"]);
+	CHECK(Programs["SLS2000.vso"] != Programs["SLS2003.vso"]);
+	CHECK(Programs["SLS2000.vso"] != Programs["SLS2000.pso"]);
+
+}
+
+/*
+* The device shaders of ShaderRecord::LoadShader: the records of a binary share a shader, the last one released frees the entry.
+*/
+TEST(DeviceShaderLifetime) {
+
+	ShaderProgramCache Cache;
+	MockBuffer* Binary = new MockBuffer("binary");
+	UInt64 Key = Hash(Binary->Content);
+
+	CHECK(!Cache.Find(Key, Binary));
+	MockObject* Shader = new MockObject();
+	Cache.Add(Key, Binary, Shader);
+	CHECK_EQUAL(Shader->References, 2);
+	CHECK_EQUAL(Binary->References, 2);
+
+	IUnknown* Records[3] = { Shader, nullptr, nullptr };
+	for (int i = 1; i < 3; i++) {
+		MockBuffer* Other = new MockBuffer("binary");
+		Records[i] = Cache.Find(Key, Other);
+		Other->Release();
+		CHECK(Records[i] == Shader);
+	}
+	CHECK_EQUAL(Shader->References, 4);
+	CHECK_EQUAL(Cache.GetUsersCount(), 3);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 1);
+
+	Cache.Release(Records[0]);
+	Cache.Release(Records[1]);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 1);
+	CHECK_EQUAL(Shader->References, 2);
+	Cache.Release(Records[2]);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 0);
+	CHECK_EQUAL(Cache.GetUsersCount(), 0);
+	CHECK_EQUAL(Binary->References, 1);
+	Cache.Release(nullptr);
+
+	Binary->Release();
+	CHECK_EQUAL(LiveObjects, 0);
+
+}
+
+/*
+* The device keeps a reference on a bound shader: the records released while it is still set (e.g. on ReloadShaders) free the entry anyway.
+*/
+TEST(BoundShaderRelease) {
+
+	ShaderProgramCache Cache;
+	MockBuffer* Binary = new MockBuffer("bound");
+	UInt64 Key = Hash(Binary->Content);
+
+	MockObject* Shader = new MockObject();
+	Cache.Add(Key, Binary, Shader);
+	IUnknown* Other = Cache.Find(Key, Binary);
+	CHECK(Other == Shader);
+	Shader->AddRef();		// SetVertexShader
+
+	Cache.Release(Shader);
+	Cache.Release(Other);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 0);
+	CHECK_EQUAL(Cache.GetUsersCount(), 0);
+	CHECK_EQUAL(Binary->References, 1u);
+	CHECK_EQUAL(Shader->References, 1u);
+
+	Shader->Release();		// the device sets another shader
+	Binary->Release();
+	CHECK_EQUAL(LiveObjects, 0);
+
+}
+
+/*
+* Every key collides: different data must never get another program, and a colliding record keeps its own shader.
+*/
+TEST(CollisionsAreNotShared) {
+
+	ShaderProgramCache Cache;
+	MockBuffer* First = new MockBuffer("first");
+	MockBuffer* Second = new MockBuffer("secnd");
+	MockBuffer* Longer = new MockBuffer("first program");
+
+	MockObject* FirstShader = new MockObject();
+	Cache.Add(0, First, FirstShader);
+	CHECK(!Cache.Find(0, Second));
+	CHECK(!Cache.Find(0, Longer));
+
+	MockObject* SecondShader = new MockObject();
+	Cache.Add(0, Second, SecondShader);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 1);
+	CHECK_EQUAL(SecondShader->References, 1);
+	CHECK(!Cache.Find(0, Second));
+	CHECK(Cache.Find(0, First) == FirstShader);
+
+	Cache.Release(SecondShader);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 1);
+	Cache.Release(FirstShader);
+	Cache.Release(FirstShader);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 0);
+
+	First->Release();
+	Second->Release();
+	Longer->Release();
+	CHECK_EQUAL(LiveObjects, 0);
+
+}
+
+/*
+* The records load on the compile threads, the users count and the entries stay consistent.
+*/
+TEST(ConcurrentLoads) {
+
+	ShaderProgramCache Cache;
+	std::vector<MockBuffer*> Binaries;
+	for (int i = 0; i < 16; i++) Binaries.push_back(new MockBuffer("binary " + std::to_string(i)));
+
+	std::vector<std::thread> Threads;
+	std::vector<std::vector<IUnknown*>> Records(8);
+	for (int t = 0; t < 8; t++) {
+		Threads.emplace_back([&, t]() {
+			for (int i = 0; i < 1000; i++) {
+				MockBuffer* Binary = Binaries[(i * 7 + t) % Binaries.size()];
+				UInt64 Key = Hash(Binary->Content);
+				IUnknown* Shader = Cache.Find(Key, Binary);
+				if (!Shader) {
+					Shader = new MockObject();
+					Cache.Add(Key, Binary, Shader);
+				}
+				Records[t].push_back(Shader);
+			}
+		});
+	}
+	for (std::thread& Thread : Threads) Thread.join();
+	CHECK_EQUAL(Cache.GetUsersCount(), 8000);
+	CHECK_EQUAL(Cache.GetProgramsCount(), Binaries.size());
+
+	Threads.clear();
+	for (int t = 0; t < 8; t++) {
+		Threads.emplace_back([&, t]() {
+			for (IUnknown* Shader : Records[t]) Cache.Release(Shader);
+		});
+	}
+	for (std::thread& Thread : Threads) Thread.join();
+	CHECK_EQUAL(Cache.GetUsersCount(), 0);
+	CHECK_EQUAL(Cache.GetProgramsCount(), 0);
+
+	for (MockBuffer* Binary : Binaries) Binary->Release();
+	CHECK_EQUAL(LiveObjects, 0);
+
+}
+
+int main() {
+
+	RUN(CompilesOnceByProgram);
+	RUN(IdenticalPermutationsShare);
+	RUN(DeviceShaderLifetime);
+	RUN(BoundShaderRelease);
+	RUN(CollisionsAreNotShared);
+	RUN(ConcurrentLoads);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,214 @@
+#include "Test.h"
+#include "ShaderTemplate.h"
+
+/*
+* The part of ShaderCollection read by the registry, and GetTemplate as the collections had it before the registry:
+* the template map was built again for every lookup.
+*/
+class ShaderCollection {
+public:
+	ShaderCollection(const char* ShaderName) : Name(ShaderName) {}
+	virtual ~ShaderCollection() {}
+
+	virtual std::map<std::string_view, ShaderTemplate> Templates() { return std::map<std::string_view, ShaderTemplate>(); }
+
+	ShaderTemplate GetTemplate(const char* Name) {
+		std::map<std::string_view, ShaderTemplate> templates = Templates();
+		if (auto temp = templates.find(Name); temp != templates.end()) return temp->second;
+		return ShaderTemplate{};
+	}
+
+	const char* Name;
+};
+
+#include "PBR.h"
+#include "POM.h"
+#include "Terrain.h"
+
+#include "ShaderRegistry.h"
+#include "ShaderRegistry.cpp"
+
+#define BloodShaders "GDECALS.vso GDECAL.pso SLS2040.vso SLS2046.pso"	// Oblivion list, New Vegas has none
+
+/*
+* The collections of ShaderManager::Initialize, the ones without templates only matter for the prefix rule.
+*/
+struct Collections {
+	PBRShaders PBR;
+	POMShaders POM;
+	TerrainShaders Terrain;
+	ShaderCollection Water = ShaderCollection("Water");
+	ShaderCollection Grass = ShaderCollection("Grass");
+	ShaderCollection Tonemapping = ShaderCollection("Tonemapping");
+	ShaderCollection Sky = ShaderCollection("Sky");
+	ShaderCollection Blood = ShaderCollection("Blood");
+
+	// ShaderManager::GetShaderCollectionByPrefix
+	ShaderCollection* GetByPrefix(const char* Name) {
+
+		if (!memcmp(Name, "WATER", 5)) return &Water;
+		if (!memcmp(Name, "GRASS", 5)) return &Grass;
+		if (!memcmp(Name, "ISHDR", 5) || !memcmp(Name, "HDR", 3)) return &Tonemapping;
+		if (!memcmp(Name, "PAR", 3)) return &POM;
+		if (!memcmp(Name, "SKY", 3)) return &Sky;
+		return NULL;
+
+	}
+
+	// ShaderManager::GetShaderCollection before the registry
+	ShaderCollection* GetLinear(const char* Name) {
+
+		if (ShaderCollection* Collection = GetByPrefix(Name)) return Collection;
+		if (strstr(BloodShaders, Name)) return &Blood;
+		if (PBR.GetTemplate(Name).Name != NULL) return &PBR;
+		if (Terrain.GetTemplate(Name).Name != NULL) return &Terrain;
+		return NULL;
+
+	}
+
+	// ShaderManager::RegisterGameShaders, ShaderNames is sorted by collection name
+	void Register(ShaderRegistry* Registry) {
+
+		auto Prefix = [this](const char* Name) { return GetByPrefix(Name); };
+		Registry->RegisterNames(BloodShaders, &Blood, Prefix);
+		ShaderCollection* Sorted[] = { &Blood, &Grass, &PBR, &POM, &Sky, &Terrain, &Tonemapping, &Water };
+		for (ShaderCollection* Collection : Sorted) Registry->RegisterTemplates(Collection, Prefix);
+
+	}
+};
+
+static bool SameTemplate(const ShaderTemplate& a, const ShaderTemplate& b) {
+
+	if ((a.Name == NULL) != (b.Name == NULL) || (a.Name && strcmp(a.Name, b.Name))) return false;
+	for (int i = 0; i < 30; i++) {
+		const D3DXMACRO& ma = a.Defines[i];
+		const D3DXMACRO& mb = b.Defines[i];
+		if ((ma.Name == NULL) != (mb.Name == NULL)) return false;
+		if (!ma.Name) break;
+		if (strcmp(ma.Name, mb.Name) || strcmp(ma.Definition, mb.Definition)) return false;
+	}
+	return true;
+
+}
+
+/*
+* The names the game creates: the template names, the blood and prefixed shaders, and the vanilla range of names without a collection.
+* The vanilla list isn't shipped, SLS1000 to SLS2199 stands in for it.
+*/
+static std::vector<std::string> GetNames(Collections& Shaders) {
+
+	std::vector<std::string> Names;
+	ShaderCollection* Tables[] = { &Shaders.PBR, &Shaders.POM, &Shaders.Terrain };
+	for (ShaderCollection* Table : Tables) {
+		for (auto& Item : Table->Templates()) Names.push_back(std::string(Item.first));
+	}
+	const char* Others[] = { "GDECALS.vso", "GDECAL.pso", "WATER000.vso", "WATER001.pso", "GRASS2000.vso", "ISHDR000.pso", "HDR000.pso", "SKY000.vso", "PAR9999.pso" };
+	for (const char* Name : Others) Names.push_back(Name);
+	char Name[16];
+	for (int i = 1000; i < 2200; i++) {
+		snprintf(Name, sizeof(Name), "SLS%04d.vso", i);
+		Names.push_back(Name);
+		snprintf(Name, sizeof(Name), "SLS%04d.pso", i);
+		Names.push_back(Name);
+	}
+	return Names;
+
+}
+
+/*
+* Every name resolves to the same collection and template as the linear resolution (prefix, blood list, PBR then Terrain templates).
+*/
+TEST(SameResolution) {
+
+	Collections Shaders;
+	ShaderRegistry Registry;
+	Shaders.Register(&Registry);
+
+	UInt32 Resolved = 0;
+	for (std::string& Name : GetNames(Shaders)) {
+		const ShaderRegistration* Registration = Registry.Find(Name.c_str());
+		ShaderCollection* Collection = Registration ? Registration->Collection : Shaders.GetByPrefix(Name.c_str());
+		ShaderTemplate Template = Registration ? Registration->Template : ShaderTemplate{};
+
+		ShaderCollection* Expected = Shaders.GetLinear(Name.c_str());
+		CHECK(Collection == Expected);
+		if (Collection != Expected) printf("  %s: %s != %s\n", Name.c_str(), Collection ? Collection->Name : "none", Expected ? Expected->Name : "none");
+		if (Expected) CHECK(SameTemplate(Template, Expected->GetTemplate(Name.c_str())));
+		if (Collection) Resolved++;
+	}
+	printf("  %u names registered, %u resolved\n", (unsigned)Registry.Shaders.size(), (unsigned)Resolved);
+
+}
+
+/*
+* The blood shaders win over the PBR templates with the same name and have no template, the prefixed names aren't registered.
+*/
+TEST(RegistrationRules) {
+
+	Collections Shaders;
+	ShaderRegistry Registry;
+	Shaders.Register(&Registry);
+
+	const ShaderRegistration* Blood = Registry.Find("SLS2040.vso");
+	CHECK(Blood && Blood->Collection == &Shaders.Blood && Blood->Template.Name == NULL);
+	CHECK(Shaders.PBR.GetTemplate("SLS2040.vso").Name != NULL);
+	CHECK(!Registry.Find("GDECALS"));
+	CHECK(!Registry.Find("DECAL.pso"));
+	CHECK(Registry.Find("GDECAL.pso") != NULL);
+
+	const ShaderRegistration* POM = Registry.Find("PAR2000.vso");
+	CHECK(POM && POM->Collection == &Shaders.POM && POM->Template.Name != NULL);
+	const ShaderRegistration* Terrain = Registry.Find("SLS2002.vso");
+	CHECK(Terrain && Terrain->Collection == &Shaders.Terrain);
+	CHECK(!Registry.Find("WATER000.vso"));
+
+	// the keys point into the template literals, not into copies
+	for (auto& Item : Registry.Shaders) CHECK(Item.first.data()[Item.first.size()] == '\0' || Item.first.data()[Item.first.size()] == ' ');
+
+}
+
+/*
+* Lookup time of the registry against the linear resolution, over the names the game creates.
+*/
+TEST(LookupTime) {
+
+	Collections Shaders;
+	ShaderRegistry Registry;
+	Shaders.Register(&Registry);
+	std::vector<std::string> Names = GetNames(Shaders);
+
+	const int Rounds = 20;
+	UInt32 Found = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++) {
+		for (std::string& Name : Names) {
+			ShaderCollection* Collection = Shaders.GetLinear(Name.c_str());
+			if (Collection && Collection->GetTemplate(Name.c_str()).Name) Found++;
+		}
+	}
+	double Linear = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count() / (Rounds * Names.size());
+
+	UInt32 RegistryFound = 0;
+	Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++) {
+		for (std::string& Name : Names) {
+			const ShaderRegistration* Registration = Registry.Find(Name.c_str());
+			if (Registration && Registration->Template.Name) RegistryFound++;
+		}
+	}
+	double Map = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count() / (Rounds * Names.size());
+
+	printf("  %u names: linear %.3f us, registry %.3f us per lookup\n", (unsigned)Names.size(), Linear, Map);
+	CHECK_EQUAL(RegistryFound, Found);
+	CHECK(Map < Linear);
+
+}
+
+int main() {
+
+	RUN(SameResolution);
+	RUN(RegistrationRules);
+	RUN(LookupTime);
+	TEST_RESULT();
+
+}
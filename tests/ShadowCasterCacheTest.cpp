@@ -0,0 +1,389 @@
+#include "Test.h"
+#include <set>
+
+/*
+* The parts of the game scene graph read by ShadowCasterCache: cells holding their references in a linked list, references with a base form,
+* a node and their extra data.
+*/
+class BSExtraData {
+public:
+	enum ExtraDataType {
+		kExtraData_RefractionProperty = 0x5B,
+	};
+};
+
+class ExtraRefractionProperty : public BSExtraData {
+public:
+	float refractionAmount;
+};
+
+class ExtraDataList {
+public:
+	BSExtraData* GetExtraData(UInt32 Type) { return Type == BSExtraData::kExtraData_RefractionProperty ? Refraction : NULL; }
+
+	ExtraRefractionProperty* Refraction;
+};
+
+class NiNode {
+public:
+	NiBound* GetWorldBound() { return &WorldBound; }
+
+	NiBound WorldBound;
+};
+
+class TESForm {
+public:
+	enum FormType {
+		kFormType_Land,
+		kFormType_Activator,
+		kFormType_Apparatus,
+		kFormType_Book,
+		kFormType_Container,
+		kFormType_Door,
+		kFormType_Misc,
+		kFormType_Tree,
+		kFormType_Furniture,
+		kFormType_NPC,
+		kFormType_Creature,
+		kFormType_LeveledCreature,
+		kFormType_Stat,
+		kFormType_StaticCollection,
+		kFormType_MoveableStatic,
+		kFormType_Light,
+	};
+	enum FormFlags {
+		kFormFlags_NotCastShadows = 0x200,
+	};
+
+	UInt8	formType;
+	UInt32	flags;
+};
+
+class TESObjectREFR : public TESForm {
+public:
+	NiNode* GetNode() { return Node; }
+
+	TESForm*		baseForm;
+	ExtraDataList	extraDataList;
+	NiNode*			Node;
+};
+
+template <typename T> class TList {
+public:
+	struct Entry {
+		T*		item;
+		Entry*	next;
+	};
+
+	Entry First;
+};
+
+class TESObjectCELL {
+public:
+	TList<TESObjectREFR> objectList;
+};
+
+class ShadowsExteriorEffect {
+public:
+	struct FormsStruct {
+		bool Activators;
+		bool Actors;
+		bool Apparatus;
+		bool Books;
+		bool Containers;
+		bool Doors;
+		bool Furniture;
+		bool Misc;
+		bool Statics;
+		bool Trees;
+	};
+};
+
+#include "BoundingVolumeHierarchy.h"
+#include "BoundingVolumeHierarchy.cpp"
+#include "ShadowCasterCache.h"
+#include "ShadowCasterCache.cpp"
+
+/*
+* Synthetic exterior: the forms, references and nodes live as long as the scene, the cells list their references like the game does.
+*/
+struct Scene {
+	std::deque<TESForm> Forms;
+	std::deque<TESObjectREFR> Refs;
+	std::deque<NiNode> Nodes;
+	std::deque<TList<TESObjectREFR>::Entry> Entries;
+	std::deque<ExtraRefractionProperty> Refractions;
+
+	NiNode* AddNode(float x, float y, float Radius) {
+
+		Nodes.push_back({ { NiPoint3(x, y, 0.0f), Radius } });
+		return &Nodes.back();
+
+	}
+
+	TESObjectREFR* AddRef(UInt8 FormType, float x, float y) {
+
+		Forms.push_back({ FormType, 0 });
+		Refs.push_back({});
+		TESObjectREFR* Ref = &Refs.back();
+		Ref->baseForm = &Forms.back();
+		Ref->extraDataList.Refraction = NULL;
+		Ref->Node = AddNode(x, y, 50.0f);
+		return Ref;
+
+	}
+
+	void SetRefraction(TESObjectREFR* Ref, float Amount) {
+
+		Refractions.push_back({});
+		Refractions.back().refractionAmount = Amount;
+		Ref->extraDataList.Refraction = &Refractions.back();
+
+	}
+
+	void SetRefs(TESObjectCELL* Cell, std::vector<TESObjectREFR*> CellRefs) {
+
+		TList<TESObjectREFR>::Entry* Entry = &Cell->objectList.First;
+		*Entry = { NULL, NULL };
+		for (size_t i = 0; i < CellRefs.size(); i++) {
+			if (i) {
+				Entries.push_back({ NULL, NULL });
+				Entry->next = &Entries.back();
+				Entry = Entry->next;
+			}
+			Entry->item = CellRefs[i];
+		}
+
+	}
+};
+
+static ShadowsExteriorEffect::FormsStruct AllForms = { true, true, true, true, true, true, true, true, true, true };
+
+/*
+* The nodes the shadow maps render around a point.
+*/
+static std::set<NiNode*> Query(ShadowCasterCache* Cache, float x, float y, float Radius, ShadowsExteriorEffect::FormsStruct* Forms = &AllForms) {
+
+	std::set<NiNode*> Result;
+	Cache->ForEachCasterInSphere(Forms, NiPoint3(x, y, 0.0f), Radius, [&Result](NiNode* Node) { Result.insert(Node); });
+	return Result;
+
+}
+
+static std::set<NiNode*> QueryAll(ShadowCasterCache* Cache, ShadowsExteriorEffect::FormsStruct* Forms = &AllForms) {
+
+	return Query(Cache, 0.0f, 0.0f, 100000.0f, Forms);
+
+}
+
+/*
+* A new cell classifies its references once: land is not cached, the flagged, refracted and unloaded ones are cached but not rendered.
+*/
+TEST(ClassifyCell) {
+
+	Scene World;
+	TESObjectCELL Cell;
+	ShadowCasterCache Cache;
+
+	TESObjectREFR* Static = World.AddRef(TESForm::kFormType_Stat, 0.0f, 0.0f);
+	TESObjectREFR* Actor = World.AddRef(TESForm::kFormType_NPC, 500.0f, 0.0f);
+	TESObjectREFR* Land = World.AddRef(TESForm::kFormType_Land, 0.0f, 0.0f);
+	TESObjectREFR* Door = World.AddRef(TESForm::kFormType_Door, 1000.0f, 0.0f);
+	TESObjectREFR* Glass = World.AddRef(TESForm::kFormType_Activator, 1500.0f, 0.0f);
+	TESObjectREFR* Unloaded = World.AddRef(TESForm::kFormType_Misc, 2000.0f, 0.0f);
+	Door->flags |= TESForm::kFormFlags_NotCastShadows;
+	World.SetRefraction(Glass, 0.2f);
+	Unloaded->Node = NULL;
+	World.SetRefs(&Cell, { Static, Actor, Land, Door, Glass, Unloaded });
+
+	TESObjectCELL* Cells[] = { &Cell, NULL };
+	Cache.Update(Cells, 2);
+	CHECK_EQUAL(Cache.CellsRebuilt, 1u);
+	CHECK_EQUAL(Cache.CastersCount, 5u);
+	CHECK_EQUAL(Cache.CastersReclassified, 4u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ Static->Node, Actor->Node }));
+
+	ShadowsExteriorEffect::FormsStruct NoStatics = AllForms;
+	NoStatics.Statics = false;
+	CHECK(QueryAll(&Cache, &NoStatics) == std::set<NiNode*>({ Actor->Node }));
+	CHECK(Query(&Cache, 500.0f, 0.0f, 10.0f) == std::set<NiNode*>({ Actor->Node }));
+
+}
+
+/*
+* A cell is classified again only when its object list changes: a ref loaded, unloaded, or replaced by another one at the same place in the list.
+*/
+TEST(RebuildOnRefsChange) {
+
+	Scene World;
+	TESObjectCELL Cell;
+	ShadowCasterCache Cache;
+	TESObjectCELL* Cells[] = { &Cell };
+
+	TESObjectREFR* First = World.AddRef(TESForm::kFormType_Stat, 0.0f, 0.0f);
+	TESObjectREFR* Second = World.AddRef(TESForm::kFormType_Tree, 500.0f, 0.0f);
+	TESObjectREFR* Third = World.AddRef(TESForm::kFormType_Furniture, 1000.0f, 0.0f);
+	World.SetRefs(&Cell, { First, Second });
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 1u);
+
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 0u);
+	CHECK_EQUAL(Cache.CastersReclassified, 0u);
+	CHECK_EQUAL(Cache.CastersMoved, 0u);
+	CHECK_EQUAL(Cache.CastersCount, 2u);
+
+	World.SetRefs(&Cell, { First, Second, Third });
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 1u);
+	CHECK_EQUAL(Cache.CastersCount, 3u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ First->Node, Second->Node, Third->Node }));
+
+	World.SetRefs(&Cell, { First, Third });
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 1u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ First->Node, Third->Node }));
+
+	World.SetRefs(&Cell, { First, Second });		// same count, another ref
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 1u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ First->Node, Second->Node }));
+
+	World.SetRefs(&Cell, { First, NULL, Second });	// empty entries are not refs
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 0u);
+
+}
+
+/*
+* A reference whose 3D is loaded or reloaded is classified again without rebuilding its cell. Only actors change their refraction on the fly.
+*/
+TEST(ReclassifyOnNewNode) {
+
+	Scene World;
+	TESObjectCELL Cell;
+	ShadowCasterCache Cache;
+	TESObjectCELL* Cells[] = { &Cell };
+
+	TESObjectREFR* Static = World.AddRef(TESForm::kFormType_Stat, 0.0f, 0.0f);
+	TESObjectREFR* Actor = World.AddRef(TESForm::kFormType_Creature, 500.0f, 0.0f);
+	NiNode* Loaded = Static->Node;
+	Static->Node = NULL;
+	World.SetRefs(&Cell, { Static, Actor });
+	Cache.Update(Cells, 1);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ Actor->Node }));
+
+	Static->Node = Loaded;
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 0u);
+	CHECK_EQUAL(Cache.CastersReclassified, 1u);
+	CHECK_EQUAL(Cache.CastersMoved, 1u);				// the bound of the new node
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ Static->Node, Actor->Node }));
+
+	// refraction of a static is read again with its 3D only, the one of an actor every update
+	World.SetRefraction(Static, 0.2f);
+	World.SetRefraction(Actor, 0.2f);
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CastersReclassified, 0u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ Static->Node }));
+
+	Static->Node = World.AddNode(0.0f, 0.0f, 50.0f);
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CastersReclassified, 1u);
+	CHECK_EQUAL(Cache.CastersMoved, 0u);				// same bound
+	CHECK(QueryAll(&Cache).empty());
+
+	World.SetRefraction(Actor, 1.0f);
+	Static->Node = NULL;
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CastersReclassified, 1u);
+	CHECK_EQUAL(Cache.CastersCount, 2u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ Actor->Node }));
+
+}
+
+/*
+* A moved node only updates its bound in the hierarchy.
+*/
+TEST(MoveBoundOnly) {
+
+	Scene World;
+	TESObjectCELL Cell;
+	ShadowCasterCache Cache;
+	TESObjectCELL* Cells[] = { &Cell };
+
+	TESObjectREFR* Moving = World.AddRef(TESForm::kFormType_NPC, 0.0f, 0.0f);
+	TESObjectREFR* Still = World.AddRef(TESForm::kFormType_Stat, 3000.0f, 0.0f);
+	World.SetRefs(&Cell, { Moving, Still });
+	Cache.Update(Cells, 1);
+	CHECK(Query(&Cache, 0.0f, 0.0f, 100.0f) == std::set<NiNode*>({ Moving->Node }));
+
+	Moving->Node->WorldBound.Center = NiPoint3(2000.0f, 0.0f, 0.0f);
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CellsRebuilt, 0u);
+	CHECK_EQUAL(Cache.CastersReclassified, 0u);
+	CHECK_EQUAL(Cache.CastersMoved, 1u);
+	CHECK(Query(&Cache, 0.0f, 0.0f, 100.0f).empty());
+	CHECK(Query(&Cache, 2000.0f, 0.0f, 100.0f) == std::set<NiNode*>({ Moving->Node }));
+
+	Moving->Node->WorldBound.Radius = 1500.0f;
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CastersMoved, 1u);
+	CHECK(Query(&Cache, 3000.0f, 0.0f, 10.0f) == std::set<NiNode*>({ Moving->Node, Still->Node }));
+
+	Cache.Update(Cells, 1);
+	CHECK_EQUAL(Cache.CastersMoved, 0u);
+
+}
+
+/*
+* The cells missing from the loaded ones are dropped with their casters, and classified again if they come back.
+*/
+TEST(DropUnloadedCells) {
+
+	Scene World;
+	TESObjectCELL Near;
+	TESObjectCELL Far;
+	ShadowCasterCache Cache;
+
+	TESObjectREFR* NearRef = World.AddRef(TESForm::kFormType_Stat, 0.0f, 0.0f);
+	TESObjectREFR* FarRef = World.AddRef(TESForm::kFormType_Stat, 4096.0f, 0.0f);
+	World.SetRefs(&Near, { NearRef });
+	World.SetRefs(&Far, { FarRef });
+
+	TESObjectCELL* Both[] = { &Near, &Far };
+	Cache.Update(Both, 2);
+	CHECK_EQUAL(Cache.CellsRebuilt, 2u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ NearRef->Node, FarRef->Node }));
+
+	TESObjectCELL* NearOnly[] = { NULL, &Near };
+	Cache.Update(NearOnly, 2);
+	CHECK_EQUAL(Cache.CellsRebuilt, 0u);
+	CHECK_EQUAL(Cache.CastersCount, 1u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ NearRef->Node }));
+
+	Cache.Update(Both, 2);
+	CHECK_EQUAL(Cache.CellsRebuilt, 1u);
+	CHECK(QueryAll(&Cache) == std::set<NiNode*>({ NearRef->Node, FarRef->Node }));
+
+	Cache.Update(NULL, 0);
+	CHECK_EQUAL(Cache.CastersCount, 0u);
+	CHECK(QueryAll(&Cache).empty());
+
+	Cache.Update(Both, 2);
+	CHECK_EQUAL(Cache.CellsRebuilt, 2u);
+	Cache.Clear();
+	CHECK(QueryAll(&Cache).empty());
+
+}
+
+int main() {
+
+	RUN(ClassifyCell);
+	RUN(RebuildOnRefsChange);
+	RUN(ReclassifyOnNewNode);
+	RUN(MoveBoundOnly);
+	RUN(DropUnloadedCells);
+	TEST_RESULT();
+
+}
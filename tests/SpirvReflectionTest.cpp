@@ -0,0 +1,650 @@
+#include "Test.h"
+#include "MockDevice.h"
+#include <filesystem>
+#include <spirv_cross/spirv.hpp>
+
+static const IID IID_ID3D9VkInteropDevice = { 0x2EAA4B89, 0x0107, 0x4BDB, { 0x87, 0xF7, 0x0F, 0x54, 0x1C, 0x49, 0x3C, 0xE0 } };
+static const IID IID_ID3D9VkInteropTexture = { 0xD56344F5, 0x8D35, 0x46FD, { 0x80, 0x6D, 0x94, 0xC3, 0x51, 0xB4, 0x72, 0xC1 } };
+
+#include "TestVkShader.h"
+
+/*
+* The parts of the TextureManager read by TestVkShader: no texture is bound by name in these tests.
+*/
+struct VulkanImageData {
+	VkImage Image = VK_NULL_HANDLE;
+	VkImageLayout ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImageCreateInfo ImageCreateInfo {};
+};
+
+class TextureManager {
+public:
+	IDirect3DBaseTexture9* GetTextureByName(std::string& Name) { return NULL; }
+};
+
+static TextureManager* TheTextureManager = NULL;
+static TestVkShader* TheVulkanTestShader = NULL;
+
+#include "SpirvReflection.cpp"
+#include "VkDispatch.cpp"
+#include "TestVkShader.cpp"
+
+/*
+* Builds SPIR-V modules with the enums of the SPIRV-Cross headers of the SDK, independent from the ones the reflection is built with.
+*/
+class SpirvModule {
+public:
+	SpirvModule() : Words({ spv::MagicNumber, 0x00010000, 0, 0, 0 }), Bound(0) {}
+
+	uint32_t Id() { return ++Bound; }
+
+	// Instruction with the operands, then the literal string if any, then the operands following the string
+	void Op(spv::Op Code, std::vector<uint32_t> Operands, const char* Text = NULL, std::vector<uint32_t> After = {}) {
+		size_t Start = Words.size();
+		Words.push_back(0);
+		Words.insert(Words.end(), Operands.begin(), Operands.end());
+		if (Text) {
+			size_t Length = strlen(Text) + 1;
+			std::vector<uint32_t> Packed((Length + 3) / 4, 0);
+			memcpy(Packed.data(), Text, Length);
+			Words.insert(Words.end(), Packed.begin(), Packed.end());
+		}
+		Words.insert(Words.end(), After.begin(), After.end());
+		Words[Start] = ((uint32_t)(Words.size() - Start) << 16) | Code;
+	}
+
+	std::vector<uint32_t> Code() {
+		std::vector<uint32_t> Result = Words;
+		Result[3] = Bound + 1;
+		return Result;
+	}
+
+	std::vector<uint32_t> Words;
+	uint32_t Bound;
+};
+
+/*
+* A compute shader declaring every kind of resource in 3 sets, out of order, with push constants and a WorkgroupSize constant.
+*/
+static std::vector<uint32_t> GetResourcesModule(spv::ExecutionModel Model = spv::ExecutionModelGLCompute) {
+
+	SpirvModule M;
+	uint32_t Main = M.Id(), Void = M.Id(), Function = M.Id(), Float = M.Id(), Vec4 = M.Id(), Mat4 = M.Id(), UInt = M.Id();
+	uint32_t Four = M.Id(), Three = M.Id(), Eight = M.Id(), Two = M.Id(), One = M.Id(), GroupSize = M.Id();
+	uint32_t Params = M.Id(), ParamsPointer = M.Id(), ParamsVariable = M.Id();
+	uint32_t Image2D = M.Id(), Sampled = M.Id(), SampledArray = M.Id(), SampledPointer = M.Id(), Textures = M.Id();
+	uint32_t Sampler = M.Id(), SamplerPointer = M.Id(), LinearSampler = M.Id();
+	uint32_t FloatArray = M.Id(), InputBlock = M.Id(), InputPointer = M.Id(), Input = M.Id();
+	uint32_t OutputBlock = M.Id(), OutputPointer = M.Id(), Output = M.Id();
+	uint32_t StorageImage = M.Id(), StorageImagePointer = M.Id(), Result = M.Id();
+	uint32_t SourcePointer = M.Id(), Source = M.Id();
+	uint32_t TexelBuffer = M.Id(), TexelPointer = M.Id(), Texels = M.Id();
+	uint32_t FloatArray3 = M.Id(), Push = M.Id(), PushPointer = M.Id(), PushVariable = M.Id();
+	uint32_t SharedArray = M.Id(), SharedPointer = M.Id(), Shared = M.Id();
+
+	M.Op(spv::OpCapability, { spv::CapabilityShader });
+	M.Op(spv::OpMemoryModel, { spv::AddressingModelLogical, spv::MemoryModelGLSL450 });
+	M.Op(spv::OpEntryPoint, { (uint32_t)Model, Main }, "main");
+	M.Op(spv::OpExecutionMode, { Main, spv::ExecutionModeLocalSize, 1, 1, 1 });
+
+	M.Op(spv::OpName, { Params }, "Params");
+	M.Op(spv::OpName, { Textures }, "Textures");
+	M.Op(spv::OpName, { LinearSampler }, "LinearSampler");
+	M.Op(spv::OpName, { Input }, "Input");
+	M.Op(spv::OpName, { OutputBlock }, "OutputBlock");
+	M.Op(spv::OpName, { Output }, "Output");
+	M.Op(spv::OpName, { Result }, "Result");
+	M.Op(spv::OpName, { Source }, "Source");
+	M.Op(spv::OpName, { Texels }, "Texels");
+
+	M.Op(spv::OpDecorate, { Params, spv::DecorationBlock });
+	M.Op(spv::OpMemberDecorate, { Params, 0, spv::DecorationOffset, 0 });
+	M.Op(spv::OpMemberDecorate, { Params, 1, spv::DecorationColMajor });
+	M.Op(spv::OpMemberDecorate, { Params, 1, spv::DecorationOffset, 16 });
+	M.Op(spv::OpMemberDecorate, { Params, 1, spv::DecorationMatrixStride, 16 });
+	M.Op(spv::OpDecorate, { ParamsVariable, spv::DecorationDescriptorSet, 0 });
+	M.Op(spv::OpDecorate, { ParamsVariable, spv::DecorationBinding, 0 });
+	M.Op(spv::OpDecorate, { Textures, spv::DecorationDescriptorSet, 0 });
+	M.Op(spv::OpDecorate, { Textures, spv::DecorationBinding, 1 });
+	M.Op(spv::OpDecorate, { LinearSampler, spv::DecorationDescriptorSet, 0 });
+	M.Op(spv::OpDecorate, { LinearSampler, spv::DecorationBinding, 2 });
+	M.Op(spv::OpDecorate, { FloatArray, spv::DecorationArrayStride, 4 });
+	M.Op(spv::OpDecorate, { InputBlock, spv::DecorationBlock });
+	M.Op(spv::OpMemberDecorate, { InputBlock, 0, spv::DecorationNonWritable });
+	M.Op(spv::OpMemberDecorate, { InputBlock, 0, spv::DecorationOffset, 0 });
+	M.Op(spv::OpDecorate, { Input, spv::DecorationDescriptorSet, 1 });
+	M.Op(spv::OpDecorate, { Input, spv::DecorationBinding, 0 });
+	M.Op(spv::OpDecorate, { OutputBlock, spv::DecorationBufferBlock });
+	M.Op(spv::OpMemberDecorate, { OutputBlock, 0, spv::DecorationOffset, 0 });
+	M.Op(spv::OpDecorate, { Output, spv::DecorationDescriptorSet, 1 });
+	M.Op(spv::OpDecorate, { Output, spv::DecorationBinding, 1 });
+	M.Op(spv::OpDecorate, { Result, spv::DecorationDescriptorSet, 2 });
+	M.Op(spv::OpDecorate, { Result, spv::DecorationBinding, 3 });
+	M.Op(spv::OpDecorate, { Result, spv::DecorationNonReadable });
+	M.Op(spv::OpDecorate, { Source, spv::DecorationDescriptorSet, 2 });
+	M.Op(spv::OpDecorate, { Source, spv::DecorationBinding, 0 });
+	M.Op(spv::OpDecorate, { Texels, spv::DecorationDescriptorSet, 2 });
+	M.Op(spv::OpDecorate, { Texels, spv::DecorationBinding, 1 });
+	M.Op(spv::OpDecorate, { Texels, spv::DecorationNonWritable });
+	M.Op(spv::OpDecorate, { FloatArray3, spv::DecorationArrayStride, 16 });
+	M.Op(spv::OpDecorate, { Push, spv::DecorationBlock });
+	M.Op(spv::OpMemberDecorate, { Push, 0, spv::DecorationOffset, 0 });
+	M.Op(spv::OpMemberDecorate, { Push, 1, spv::DecorationOffset, 16 });
+	M.Op(spv::OpDecorate, { GroupSize, spv::DecorationBuiltIn, spv::BuiltInWorkgroupSize });
+
+	M.Op(spv::OpTypeVoid, { Void });
+	M.Op(spv::OpTypeFunction, { Function, Void });
+	M.Op(spv::OpTypeFloat, { Float, 32 });
+	M.Op(spv::OpTypeVector, { Vec4, Float, 4 });
+	M.Op(spv::OpTypeMatrix, { Mat4, Vec4, 4 });
+	M.Op(spv::OpTypeInt, { UInt, 32, 0 });
+	M.Op(spv::OpConstant, { UInt, Four, 4 });
+	M.Op(spv::OpConstant, { UInt, Three, 3 });
+	M.Op(spv::OpConstant, { UInt, Eight, 8 });
+	M.Op(spv::OpConstant, { UInt, Two, 2 });
+	M.Op(spv::OpConstant, { UInt, One, 1 });
+	M.Op(spv::OpTypeVector, { M.Id(), UInt, 3 });
+	uint32_t UVec3 = M.Bound;
+	M.Op(spv::OpConstantComposite, { UVec3, GroupSize, Eight, Four, Two });
+
+	M.Op(spv::OpTypeStruct, { Params, Vec4, Mat4 });
+	M.Op(spv::OpTypePointer, { ParamsPointer, spv::StorageClassUniform, Params });
+	M.Op(spv::OpVariable, { ParamsPointer, ParamsVariable, spv::StorageClassUniform });
+
+	M.Op(spv::OpTypeImage, { Image2D, Float, spv::Dim2D, 0, 0, 0, 1, spv::ImageFormatUnknown });
+	M.Op(spv::OpTypeSampledImage, { Sampled, Image2D });
+	M.Op(spv::OpTypeArray, { SampledArray, Sampled, Four });
+	M.Op(spv::OpTypePointer, { SampledPointer, spv::StorageClassUniformConstant, SampledArray });
+	M.Op(spv::OpVariable, { SampledPointer, Textures, spv::StorageClassUniformConstant });
+
+	M.Op(spv::OpTypeSampler, { Sampler });
+	M.Op(spv::OpTypePointer, { SamplerPointer, spv::StorageClassUniformConstant, Sampler });
+	M.Op(spv::OpVariable, { SamplerPointer, LinearSampler, spv::StorageClassUniformConstant });
+
+	M.Op(spv::OpTypeRuntimeArray, { FloatArray, Float });
+	M.Op(spv::OpTypeStruct, { InputBlock, FloatArray });
+	M.Op(spv::OpTypePointer, { InputPointer, spv::StorageClassStorageBuffer, InputBlock });
+	M.Op(spv::OpVariable, { InputPointer, Input, spv::StorageClassStorageBuffer });
+
+	M.Op(spv::OpTypeStruct, { OutputBlock, FloatArray });
+	M.Op(spv::OpTypePointer, { OutputPointer, spv::StorageClassUniform, OutputBlock });
+	M.Op(spv::OpVariable, { OutputPointer, Output, spv::StorageClassUniform });
+
+	M.Op(spv::OpTypeImage, { StorageImage, Float, spv::Dim2D, 0, 0, 0, 2, spv::ImageFormatRgba8 });
+	M.Op(spv::OpTypePointer, { StorageImagePointer, spv::StorageClassUniformConstant, StorageImage });
+	M.Op(spv::OpVariable, { StorageImagePointer, Result, spv::StorageClassUniformConstant });
+
+	M.Op(spv::OpTypePointer, { SourcePointer, spv::StorageClassUniformConstant, Image2D });
+	M.Op(spv::OpVariable, { SourcePointer, Source, spv::StorageClassUniformConstant });
+
+	M.Op(spv::OpTypeImage, { TexelBuffer, Float, spv::DimBuffer, 0, 0, 0, 2, spv::ImageFormatR32f });
+	M.Op(spv::OpTypePointer, { TexelPointer, spv::StorageClassUniformConstant, TexelBuffer });
+	M.Op(spv::OpVariable, { TexelPointer, Texels, spv::StorageClassUniformConstant });
+
+	M.Op(spv::OpTypeArray, { FloatArray3, Float, Three });
+	M.Op(spv::OpTypeStruct, { Push, Vec4, FloatArray3 });
+	M.Op(spv::OpTypePointer, { PushPointer, spv::StorageClassPushConstant, Push });
+	M.Op(spv::OpVariable, { PushPointer, PushVariable, spv::StorageClassPushConstant });
+
+	M.Op(spv::OpTypeArray, { SharedArray, Float, Eight });
+	M.Op(spv::OpTypePointer, { SharedPointer, spv::StorageClassWorkgroup, SharedArray });
+	M.Op(spv::OpVariable, { SharedPointer, Shared, spv::StorageClassWorkgroup });
+
+	M.Op(spv::OpFunction, { Void, Main, spv::FunctionControlMaskNone, Function });
+	M.Op(spv::OpLabel, { M.Id() });
+	M.Op(spv::OpReturn, {});
+	M.Op(spv::OpFunctionEnd, {});
+	return M.Code();
+
+}
+
+static std::vector<uint32_t> ReadSpirv(const char* Path) {
+
+	std::ifstream File(Path, std::ios::binary | std::ios::ate);
+	std::vector<uint32_t> Code((size_t)File.tellg() / sizeof(uint32_t));
+	File.seekg(0);
+	File.read((char*)Code.data(), Code.size() * sizeof(uint32_t));
+	return Code;
+
+}
+
+static void WriteSpirv(const std::string& Path, const std::vector<uint32_t>& Code) {
+
+	std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+	File.write((const char*)Code.data(), Code.size() * sizeof(uint32_t));
+
+}
+
+static void CheckBinding(const SpirvBinding& Binding, UInt32 Set, UInt32 Index, VkDescriptorType Type, UInt32 Count, bool Writable, const char* Name) {
+
+	CHECK_EQUAL(Binding.Set, Set);
+	CHECK_EQUAL(Binding.Binding, Index);
+	CHECK_EQUAL(Binding.Type, Type);
+	CHECK_EQUAL(Binding.Count, Count);
+	CHECK_EQUAL(Binding.Writable, Writable);
+	CHECK(Binding.Name == Name);
+	if (Binding.Name != Name) printf("  %s != %s\n", Binding.Name.c_str(), Name);
+
+}
+
+/*
+* The shader shipped with the plugin, compiled by glslang from SolidColor.comp.glsl.
+*/
+TEST(ReflectSolidColor) {
+
+	std::vector<uint32_t> Code = ReadSpirv("../src/hlsl/NewVegas/Vulkan/SolidColor.comp.spv");
+	SpirvLayout Layout;
+
+	CHECK(Code.size() > 5);
+	CHECK(SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+	CHECK(Layout.EntryPoint == "main");
+	CHECK_EQUAL(Layout.LocalSize[0], 16u);
+	CHECK_EQUAL(Layout.LocalSize[1], 16u);
+	CHECK_EQUAL(Layout.LocalSize[2], 1u);
+	CHECK_EQUAL(Layout.PushConstantSize, 16u);
+	CHECK_EQUAL(Layout.SetsCount, 1u);
+	CHECK_EQUAL(Layout.Bindings.size(), 1u);
+	if (Layout.Bindings.size() == 1) CheckBinding(Layout.Bindings[0], 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, true, "outImage");
+	CHECK(SpirvReflection::FindBinding(&Layout, "outImage") == &Layout.Bindings[0]);
+	CHECK(SpirvReflection::FindBinding(&Layout, "solid") == NULL);
+
+}
+
+/*
+* Every descriptor type, sorted by set and binding; the buffers without a variable name take their block name.
+*/
+TEST(ReflectDescriptors) {
+
+	std::vector<uint32_t> Code = GetResourcesModule();
+	SpirvLayout Layout;
+
+	CHECK(SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+	CHECK_EQUAL(Layout.SetsCount, 3u);
+	CHECK_EQUAL(Layout.PushConstantSize, 16u + 3 * 16);
+	CHECK_EQUAL(Layout.LocalSize[0], 8u);		// the WorkgroupSize constant wins over the execution mode
+	CHECK_EQUAL(Layout.LocalSize[1], 4u);
+	CHECK_EQUAL(Layout.LocalSize[2], 2u);
+	CHECK_EQUAL(Layout.Bindings.size(), 8u);
+	if (Layout.Bindings.size() != 8) return;
+
+	CheckBinding(Layout.Bindings[0], 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, false, "Params");
+	CheckBinding(Layout.Bindings[1], 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, false, "Textures");
+	CheckBinding(Layout.Bindings[2], 0, 2, VK_DESCRIPTOR_TYPE_SAMPLER, 1, false, "LinearSampler");
+	CheckBinding(Layout.Bindings[3], 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, false, "Input");
+	CheckBinding(Layout.Bindings[4], 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, true, "Output");
+	CheckBinding(Layout.Bindings[5], 2, 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, false, "Source");
+	CheckBinding(Layout.Bindings[6], 2, 1, VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1, false, "Texels");
+	CheckBinding(Layout.Bindings[7], 2, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, true, "Result");
+	CHECK(SpirvReflection::FindBinding(&Layout, "Texels") == &Layout.Bindings[6]);
+
+}
+
+/*
+* Modules the reflection must refuse without reading out of the code.
+*/
+TEST(RejectInvalidModules) {
+
+	SpirvLayout Layout;
+	std::vector<uint32_t> Valid = GetResourcesModule();
+	std::vector<uint32_t> Code;
+
+	Code = Valid;
+	Code[0] = 0x12345678;
+	CHECK(!SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+
+	Code = GetResourcesModule(spv::ExecutionModelVertex);
+	CHECK(!SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+	CHECK(Layout.Bindings.empty());
+
+	Code = Valid;
+	Code[3] = Code.size() + 1;		// bound over the words count
+	CHECK(!SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+
+	Code = Valid;
+	Code[5] = (1000u << 16) | spv::OpCapability;		// instruction past the end
+	CHECK(!SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+
+	Code = Valid;
+	Code[5] = spv::OpCapability;		// word count 0
+	CHECK(!SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+
+	// every truncation of the declarations fails or reflects a subset, never more
+	for (size_t Size = 0; Size < Valid.size(); Size++) {
+		if (SpirvReflection::Reflect(Valid.data(), Size, &Layout)) CHECK(Layout.Bindings.size() <= 8);
+	}
+
+	// a push constant struct containing itself
+	SpirvModule M;
+	uint32_t Main = M.Id(), Block = M.Id(), Pointer = M.Id(), Variable = M.Id();
+	M.Op(spv::OpEntryPoint, { spv::ExecutionModelGLCompute, Main }, "main");
+	M.Op(spv::OpTypeStruct, { Block, Block });
+	M.Op(spv::OpTypePointer, { Pointer, spv::StorageClassPushConstant, Block });
+	M.Op(spv::OpVariable, { Pointer, Variable, spv::StorageClassPushConstant });
+	Code = M.Code();
+	CHECK(!SpirvReflection::Reflect(Code.data(), Code.size(), &Layout));
+
+}
+
+/*
+* Vulkan driver of the pipeline tests: handles are counters, the creations are recorded, the pipeline cache data is given by the test.
+*/
+struct FakeVulkan {
+	VkPhysicalDeviceProperties		Properties;
+	std::vector<char>				CacheData;
+	std::vector<char>				InitialData;
+	UInt32							CachesCreated = 0;
+	UInt32							PipelinesCreated = 0;
+	VkPipelineCache					PipelineCache = VK_NULL_HANDLE;
+	VkPipelineCache					PipelineCacheUsed = VK_NULL_HANDLE;
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> SetLayouts;
+	UInt32							PushConstantSize = 0;
+	std::string						EntryPoint;
+	uintptr_t						Handles = 0;
+};
+
+static FakeVulkan Vulkan;
+
+template <class Handle> static Handle NewHandle() {
+
+	return (Handle)++Vulkan.Handles;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateCommandPool(VkDevice Device, const VkCommandPoolCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkCommandPool* Pool) {
+
+	*Pool = NewHandle<VkCommandPool>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateDescriptorPool(VkDevice Device, const VkDescriptorPoolCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkDescriptorPool* Pool) {
+
+	*Pool = NewHandle<VkDescriptorPool>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeAllocateCommandBuffers(VkDevice Device, const VkCommandBufferAllocateInfo* Info, VkCommandBuffer* Buffers) {
+
+	for (uint32_t i = 0; i < Info->commandBufferCount; i++) Buffers[i] = NewHandle<VkCommandBuffer>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateFence(VkDevice Device, const VkFenceCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkFence* Fence) {
+
+	*Fence = NewHandle<VkFence>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateSampler(VkDevice Device, const VkSamplerCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkSampler* Sampler) {
+
+	*Sampler = NewHandle<VkSampler>();
+	return VK_SUCCESS;
+
+}
+
+static void VKAPI_CALL FakeGetPhysicalDeviceProperties(VkPhysicalDevice PhysicalDevice, VkPhysicalDeviceProperties* Properties) {
+
+	*Properties = Vulkan.Properties;
+
+}
+
+static VkResult VKAPI_CALL FakeCreatePipelineCache(VkDevice Device, const VkPipelineCacheCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkPipelineCache* Cache) {
+
+	Vulkan.InitialData.assign((const char*)Info->pInitialData, (const char*)Info->pInitialData + Info->initialDataSize);
+	Vulkan.CachesCreated++;
+	Vulkan.PipelineCache = *Cache = NewHandle<VkPipelineCache>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeGetPipelineCacheData(VkDevice Device, VkPipelineCache Cache, size_t* Size, void* Data) {
+
+	if (Data) memcpy(Data, Vulkan.CacheData.data(), min(*Size, Vulkan.CacheData.size()));
+	*Size = Vulkan.CacheData.size();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateShaderModule(VkDevice Device, const VkShaderModuleCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkShaderModule* Module) {
+
+	*Module = NewHandle<VkShaderModule>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateDescriptorSetLayout(VkDevice Device, const VkDescriptorSetLayoutCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkDescriptorSetLayout* Layout) {
+
+	Vulkan.SetLayouts.emplace_back(Info->pBindings, Info->pBindings + Info->bindingCount);
+	*Layout = NewHandle<VkDescriptorSetLayout>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreatePipelineLayout(VkDevice Device, const VkPipelineLayoutCreateInfo* Info, const VkAllocationCallbacks* Allocator, VkPipelineLayout* Layout) {
+
+	Vulkan.PushConstantSize = Info->pushConstantRangeCount ? Info->pPushConstantRanges[0].size : 0;
+	*Layout = NewHandle<VkPipelineLayout>();
+	return VK_SUCCESS;
+
+}
+
+static VkResult VKAPI_CALL FakeCreateComputePipelines(VkDevice Device, VkPipelineCache Cache, uint32_t Count, const VkComputePipelineCreateInfo* Infos, const VkAllocationCallbacks* Allocator, VkPipeline* Pipelines) {
+
+	Vulkan.PipelineCacheUsed = Cache;
+	Vulkan.EntryPoint = Infos[0].stage.pName;
+	Vulkan.PipelinesCreated++;
+	Pipelines[0] = NewHandle<VkPipeline>();
+	return VK_SUCCESS;
+
+}
+
+HMODULE LoadLibraryA(const char* FileName) {
+
+	return strcmp(FileName, "vulkan-1.dll") ? NULL : (HMODULE)&Vulkan;
+
+}
+
+FARPROC GetProcAddress(HMODULE Module, const char* ProcName) {
+
+	static const std::map<std::string, FARPROC> Functions = {
+		{ "vkCreateCommandPool", (FARPROC)FakeCreateCommandPool },
+		{ "vkCreateDescriptorPool", (FARPROC)FakeCreateDescriptorPool },
+		{ "vkAllocateCommandBuffers", (FARPROC)FakeAllocateCommandBuffers },
+		{ "vkCreateFence", (FARPROC)FakeCreateFence },
+		{ "vkCreateSampler", (FARPROC)FakeCreateSampler },
+		{ "vkGetPhysicalDeviceProperties", (FARPROC)FakeGetPhysicalDeviceProperties },
+		{ "vkCreatePipelineCache", (FARPROC)FakeCreatePipelineCache },
+		{ "vkGetPipelineCacheData", (FARPROC)FakeGetPipelineCacheData },
+		{ "vkCreateShaderModule", (FARPROC)FakeCreateShaderModule },
+		{ "vkCreateDescriptorSetLayout", (FARPROC)FakeCreateDescriptorSetLayout },
+		{ "vkCreatePipelineLayout", (FARPROC)FakeCreatePipelineLayout },
+		{ "vkCreateComputePipelines", (FARPROC)FakeCreateComputePipelines },
+	};
+	auto Function = Functions.find(ProcName);
+	return Function != Functions.end() ? Function->second : NULL;
+
+}
+
+BOOL CreateDirectoryA(const char* PathName, SECURITY_ATTRIBUTES* Attributes) {
+
+	return std::filesystem::create_directories(PathName);
+
+}
+
+/*
+* The DXVK device behind the D3D9 device.
+*/
+class FakeInteropDevice : public ID3D9VkInteropDevice {
+public:
+	STDMETHOD(QueryInterface)(REFIID riid, void** ppvObj) { return E_NOINTERFACE; }
+	STDMETHOD_(ULONG, AddRef)() { return 1; }
+	STDMETHOD_(ULONG, Release)() { return 1; }
+
+	void STDMETHODCALLTYPE GetVulkanHandles(VkInstance* pInstance, VkPhysicalDevice* pPhysDev, VkDevice* pDevice) {
+		*pInstance = (VkInstance)0x100;
+		*pPhysDev = (VkPhysicalDevice)0x200;
+		*pDevice = (VkDevice)0x300;
+	}
+	void STDMETHODCALLTYPE GetSubmissionQueue(VkQueue* pQueue, uint32_t* pQueueIndex, uint32_t* pQueueFamilyIndex) {
+		*pQueue = (VkQueue)0x400;
+		*pQueueIndex = 0;
+		*pQueueFamilyIndex = 0;
+	}
+	void STDMETHODCALLTYPE TransitionTextureLayout(ID3D9VkInteropTexture* pTexture, const VkImageSubresourceRange* pSubresources, VkImageLayout OldLayout, VkImageLayout NewLayout) {}
+	void STDMETHODCALLTYPE FlushRenderingCommands() {}
+	void STDMETHODCALLTYPE LockSubmissionQueue() {}
+	void STDMETHODCALLTYPE ReleaseSubmissionQueue() {}
+	void STDMETHODCALLTYPE LockDevice() {}
+	void STDMETHODCALLTYPE UnlockDevice() {}
+	bool STDMETHODCALLTYPE WaitForResource(IDirect3DResource9* pResource, DWORD MapFlags) { return true; }
+	HRESULT STDMETHODCALLTYPE CreateImage(const D3D9VkExtImageDesc* desc, IDirect3DResource9** ppResult) { return E_FAIL; }
+};
+
+class InteropDevice : public NullDevice {
+public:
+	STDMETHOD(QueryInterface)(REFIID riid, void** ppvObj) {
+		if (riid == IID_ID3D9VkInteropDevice) {
+			*ppvObj = &Interop;
+			return S_OK;
+		}
+		return NullDevice::QueryInterface(riid, ppvObj);
+	}
+
+	FakeInteropDevice Interop;
+};
+
+static const std::string CachePath = ShadersPath "Cache\\Compute.pipelinecache";	// a file name with a backslash outside of Windows
+
+/*
+* Pipeline cache data as a driver writes it: the version one header, then the driver data.
+*/
+static std::vector<char> GetCacheData(UInt32 VendorId, UInt32 DeviceId, UInt8 UuidSeed, const char* Payload) {
+
+	VkPipelineCacheHeaderVersionOne Header = {};
+	Header.headerSize = sizeof(Header);
+	Header.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+	Header.vendorID = VendorId;
+	Header.deviceID = DeviceId;
+	for (UInt32 i = 0; i < VK_UUID_SIZE; i++) Header.pipelineCacheUUID[i] = UuidSeed + i;
+	std::vector<char> Data(sizeof(Header) + strlen(Payload));
+	memcpy(Data.data(), &Header, sizeof(Header));
+	memcpy(Data.data() + sizeof(Header), Payload, strlen(Payload));
+	return Data;
+
+}
+
+static void SetDevice(UInt32 VendorId, UInt32 DeviceId, UInt8 UuidSeed) {
+
+	Vulkan.Properties = {};
+	Vulkan.Properties.vendorID = VendorId;
+	Vulkan.Properties.deviceID = DeviceId;
+	for (UInt32 i = 0; i < VK_UUID_SIZE; i++) Vulkan.Properties.pipelineCacheUUID[i] = UuidSeed + i;
+
+}
+
+static std::vector<char> ReadCache() {
+
+	std::ifstream File(CachePath, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+
+}
+
+TEST(PipelineCacheHeader) {
+
+	SetDevice(0x10DE, 0x2204, 1);
+	CHECK(TestVkShader::IsPipelineCacheCompatible(GetCacheData(0x10DE, 0x2204, 1, "data"), Vulkan.Properties));
+	CHECK(!TestVkShader::IsPipelineCacheCompatible(GetCacheData(0x1002, 0x2204, 1, "data"), Vulkan.Properties));
+	CHECK(!TestVkShader::IsPipelineCacheCompatible(GetCacheData(0x10DE, 0x2206, 1, "data"), Vulkan.Properties));
+	CHECK(!TestVkShader::IsPipelineCacheCompatible(GetCacheData(0x10DE, 0x2204, 2, "data"), Vulkan.Properties));
+
+	std::vector<char> Data = GetCacheData(0x10DE, 0x2204, 1, "");
+	CHECK(TestVkShader::IsPipelineCacheCompatible(Data, Vulkan.Properties));
+	Data.pop_back();
+	CHECK(!TestVkShader::IsPipelineCacheCompatible(Data, Vulkan.Properties));
+	Data = GetCacheData(0x10DE, 0x2204, 1, "data");
+	Data[4] = 2;		// header version
+	CHECK(!TestVkShader::IsPipelineCacheCompatible(Data, Vulkan.Properties));
+	Data = GetCacheData(0x10DE, 0x2204, 1, "data");
+	Data[0] = 8;		// header size
+	CHECK(!TestVkShader::IsPipelineCacheCompatible(Data, Vulkan.Properties));
+
+}
+
+/*
+* A pipeline is created from the reflected layout with the cache of the device, the cache is written once a pipeline is created
+* and given back to the driver on the next start only if the same device wrote it.
+*/
+TEST(PipelineCacheRoundTrip) {
+
+	std::filesystem::remove_all(ShadersPath);
+	std::filesystem::create_directories(ShadersPath);
+	std::filesystem::copy_file("../src/hlsl/NewVegas/Vulkan/SolidColor.comp.spv", ShadersPath "SolidColor.comp.spv");
+	WriteSpirv(ShadersPath "Resources.comp.spv", GetResourcesModule());
+	InteropDevice Device;
+
+	// first start, no cache
+	SetDevice(0x10DE, 0x2204, 1);
+	Vulkan.CacheData = GetCacheData(0x10DE, 0x2204, 1, "first pipelines");
+	TestVkShader First;
+	First.InitCompute(&Device);
+	CHECK_EQUAL(Vulkan.CachesCreated, 1u);
+	CHECK(Vulkan.InitialData.empty());
+	CHECK(First.ComputeContext.pipelineCache == Vulkan.PipelineCache);
+
+	ComputePipeline* Pipeline = First.GetPipeline("SolidColor");
+	CHECK(Pipeline->Valid);
+	CHECK_EQUAL(Vulkan.PipelinesCreated, 1u);
+	CHECK(Vulkan.PipelineCacheUsed == First.ComputeContext.pipelineCache);
+	CHECK(Vulkan.EntryPoint == "main");
+	CHECK_EQUAL(Vulkan.PushConstantSize, 16u);
+	CHECK_EQUAL(Vulkan.SetLayouts.size(), 1u);
+	if (Vulkan.SetLayouts.size() == 1 && Vulkan.SetLayouts[0].size() == 1) {
+		CHECK_EQUAL(Vulkan.SetLayouts[0][0].binding, 0u);
+		CHECK_EQUAL(Vulkan.SetLayouts[0][0].descriptorType, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+		CHECK_EQUAL(Vulkan.SetLayouts[0][0].stageFlags, VK_SHADER_STAGE_COMPUTE_BIT);
+	}
+	CHECK(ReadCache() == Vulkan.CacheData);
+	CHECK(First.GetPipeline("SolidColor") == Pipeline);
+	CHECK_EQUAL(Vulkan.PipelinesCreated, 1u);
+
+	// buffers can't be bound from D3D9 resources, the pipeline stays invalid and the cache isn't written again
+	Vulkan.CacheData = GetCacheData(0x10DE, 0x2204, 1, "not written");
+	ComputePipeline* Resources = First.GetPipeline("Resources");
+	CHECK(!Resources->Valid);
+	CHECK(!First.GetPipeline("Missing")->Valid);
+	CHECK(First.GetPipeline("Resources") == Resources);
+	CHECK_EQUAL(Vulkan.PipelinesCreated, 1u);
+	CHECK(ReadCache() == GetCacheData(0x10DE, 0x2204, 1, "first pipelines"));
+
+	// next start on the same device
+	TestVkShader Second;
+	Second.InitCompute(&Device);
+	CHECK(Vulkan.InitialData == GetCacheData(0x10DE, 0x2204, 1, "first pipelines"));
+
+	// driver update
+	SetDevice(0x10DE, 0x2204, 7);
+	TestVkShader Third;
+	Third.InitCompute(&Device);
+	CHECK(Vulkan.InitialData.empty());
+	CHECK_EQUAL(Vulkan.CachesCreated, 3u);
+
+	for (TestVkShader* Shader : { &First, &Second, &Third }) {
+		for (auto& Item : Shader->Pipelines) delete Item.second;
+	}
+	std::filesystem::remove_all(ShadersPath);
+
+}
+
+int main() {
+
+	RUN(ReflectSolidColor);
+	RUN(ReflectDescriptors);
+	RUN(RejectInvalidModules);
+	RUN(PipelineCacheHeader);
+	RUN(PipelineCacheRoundTrip);
+	TEST_RESULT();
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+* Minimal checks for the test executables: a failed check is printed and counted, the executable returns the failures count.
+*/
+static int TestFailures = 0;
+
+#define CHECK(Condition) \
+	if (!(Condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition); TestFailures++; }
+
+#define CHECK_EQUAL(Actual, Expected) \
+	if (!((Actual) == (Expected))) { printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #Actual, #Expected, (long long)(Actual), (long long)(Expected)); TestFailures++; }
+
+#define TEST(Name) static void Name()
+
+#define RUN(Name) \
+	printf("%s\n", #Name); Name();
+
+#define TEST_RESULT() \
+	printf("%d failure(s)\n", TestFailures); return TestFailures ? 1 : 0;
@@ -0,0 +1,510 @@
+#include "Test.h"
+#include "MockDevice.h"
+
+/*
+* The parts of the records and managers read by the texture manager: the texture types, the effect owning targets, the device
+* and the settings of the loading.
+*/
+class TextureRecord {
+public:
+	enum TextureRecordType {
+		None,
+		PlanarBuffer,
+		VolumeBuffer,
+		CubeBuffer
+	};
+
+	IDirect3DBaseTexture9*	Texture;
+};
+
+class EffectRecord {
+public:
+	EffectRecord(const char* Name = "Effect") : Name(Name), Enabled(false), Loaded(true), Render(true), RenderedBufferSampler(-1), HasSourceBuffer(false) {}
+
+	bool					IsLoaded() { return Loaded; }
+	bool					ShouldRender() { return Render; }
+	void					ClearSampler(const char* TextureName, size_t Length) { Cleared.push_back(std::string(TextureName, Length - 1)); }
+
+	std::vector<std::string> Cleared;
+	const char*				Name;
+	bool					Enabled;
+	bool					Loaded;
+	bool					Render;
+	SInt32					RenderedBufferSampler;
+	bool					HasSourceBuffer;
+};
+
+struct RenderManager {
+	IDirect3DDevice9*	device;
+	UInt32				width;
+	UInt32				height;
+	bool				DXVK;
+};
+
+struct SettingManager {
+	struct { struct { bool AsyncTextureLoading; UInt32 RenderTargetsBudget; } Main; } SettingsMain;
+};
+
+struct ShaderManager {
+	std::map<std::string, EffectRecord**> EffectsNames;
+};
+
+#define WordWaterHeightMapBuffer "TESR_WaterHeightMapBuffer"
+#define WordWaterReflectionMapBuffer "TESR_WaterReflectionMapBuffer"
+
+#include "RenderGraph.h"
+#include "RenderGraph.cpp"
+#include "TextureManager.h"
+
+// the DXVK interop is only queried when the device is DXVK
+namespace dxvk {
+	template <class T> struct Com {
+		T* Pointer = NULL;
+		~Com() { if (Pointer) Pointer->Release(); }
+		T** operator & () { return &Pointer; }
+		T* operator -> () { return Pointer; }
+	};
+}
+
+struct ID3D9VkInteropTexture : public IUnknown {
+	virtual HRESULT STDMETHODCALLTYPE GetVulkanImageInfo(VkImage* pHandle, VkImageLayout* pLayout, VkImageCreateInfo* pInfo) PURE;
+};
+static const IID IID_ID3D9VkInteropTexture = { 0xD56344F5, 0x8D35, 0x46FD, { 0x80, 0x6D, 0x94, 0xC3, 0x51, 0xB4, 0x72, 0xC1 } };
+
+static RenderManager* TheRenderManager = NULL;
+static SettingManager* TheSettingManager = NULL;
+static ShaderManager* TheShaderManager = NULL;
+static TextureManager* TheTextureManager = NULL;
+
+#include "TextureLoader.cpp"
+#include "TextureManager.cpp"
+
+/*
+* The D3DX loaders create mock textures and record the creations in order, with the content they were given
+* ("file:" and the path when loading from a file).
+*/
+struct Creation {
+	TextureRecord::TextureRecordType	Type;
+	std::string							Content;
+	IDirect3DBaseTexture9*				Texture;
+};
+static std::vector<Creation> Created;
+
+static HRESULT Create(TextureRecord::TextureRecordType Type, const std::string& Content, IDirect3DBaseTexture9** Texture) {
+
+	if (Content.empty()) return D3DERR_INVALIDCALL;
+	if (Type == TextureRecord::TextureRecordType::PlanarBuffer) *Texture = new MockTexture(4);
+	if (Type == TextureRecord::TextureRecordType::VolumeBuffer) *Texture = new MockVolumeTexture(4);
+	if (Type == TextureRecord::TextureRecordType::CubeBuffer) *Texture = new MockCubeTexture(4);
+	Created.push_back({ Type, Content, *Texture });
+	return D3D_OK;
+
+}
+
+static std::string FileContent(const char* pSrcFile) {
+
+	std::ifstream File(pSrcFile, std::ios::binary);
+	return File.is_open() ? std::string("file:") + pSrcFile : std::string();
+
+}
+
+HRESULT WINAPI D3DXCreateTextureFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, IDirect3DTexture9** ppTexture) {
+	return Create(TextureRecord::TextureRecordType::PlanarBuffer, FileContent(pSrcFile), (IDirect3DBaseTexture9**)ppTexture);
+}
+
+HRESULT WINAPI D3DXCreateTextureFromFileInMemory(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataSize, IDirect3DTexture9** ppTexture) {
+	return Create(TextureRecord::TextureRecordType::PlanarBuffer, std::string((const char*)pSrcData, SrcDataSize), (IDirect3DBaseTexture9**)ppTexture);
+}
+
+HRESULT WINAPI D3DXCreateVolumeTextureFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, IDirect3DVolumeTexture9** ppVolumeTexture) {
+	return Create(TextureRecord::TextureRecordType::VolumeBuffer, FileContent(pSrcFile), (IDirect3DBaseTexture9**)ppVolumeTexture);
+}
+
+HRESULT WINAPI D3DXCreateVolumeTextureFromFileInMemory(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataSize, IDirect3DVolumeTexture9** ppVolumeTexture) {
+	return Create(TextureRecord::TextureRecordType::VolumeBuffer, std::string((const char*)pSrcData, SrcDataSize), (IDirect3DBaseTexture9**)ppVolumeTexture);
+}
+
+HRESULT WINAPI D3DXCreateCubeTextureFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, IDirect3DCubeTexture9** ppCubeTexture) {
+	return Create(TextureRecord::TextureRecordType::CubeBuffer, FileContent(pSrcFile), (IDirect3DBaseTexture9**)ppCubeTexture);
+}
+
+HRESULT WINAPI D3DXCreateCubeTextureFromFileInMemory(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataSize, IDirect3DCubeTexture9** ppCubeTexture) {
+	return Create(TextureRecord::TextureRecordType::CubeBuffer, std::string((const char*)pSrcData, SrcDataSize), (IDirect3DBaseTexture9**)ppCubeTexture);
+}
+
+HRESULT WINAPI D3DXSaveSurfaceToFileA(const char* pDestFile, D3DXIMAGE_FILEFORMAT DestFormat, IDirect3DSurface9* pSrcSurface, const PALETTEENTRY* pSrcPalette, const RECT* pSrcRect) {
+	return D3DERR_INVALIDCALL;
+}
+
+/*
+* Device creating the placeholders and the render targets of the manager.
+*/
+class TextureDevice : public NullDevice {
+public:
+	STDMETHOD(CreateTexture)(THIS_ UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) {
+		Call(__func__);
+		*ppTexture = new MockTexture(Width * Height * 4);
+		return D3D_OK;
+	}
+	STDMETHOD(CreateVolumeTexture)(THIS_ UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) {
+		Call(__func__);
+		*ppVolumeTexture = new MockVolumeTexture(Width * Height * Depth * 4);
+		return D3D_OK;
+	}
+	STDMETHOD(CreateCubeTexture)(THIS_ UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) {
+		Call(__func__);
+		*ppCubeTexture = new MockCubeTexture(EdgeLength * EdgeLength * 4);
+		return D3D_OK;
+	}
+};
+
+/*
+* The DDS fixtures of tests/data: a 4x4 planar, a 2x2 cube map with its six faces and a 2x2x2 volume, all A8R8G8B8 without mipmaps.
+*/
+#define PlanarFile	"data/Planar.dds"
+#define CubeFile	"data/Cube.dds"
+#define VolumeFile	"data/Volume.dds"
+#define OtherFile	"data/OcclusionBuffer.pgm"
+#define MissingFile	"data/Missing.dds"
+
+static std::string ReadFile(const char* Path) {
+
+	std::ifstream File(Path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+
+}
+
+/*
+* A manager as TextureManager::Initialize leaves it for the file textures: the placeholders created, async loading on.
+*/
+struct Fixture {
+	TextureDevice Device;
+	RenderManager Render = { &Device, 1920, 1080, false };
+	SettingManager Settings = {};
+	ShaderManager Shaders;
+	TextureManager* Manager;
+
+	Fixture() {
+
+		TheRenderManager = &Render;
+		TheSettingManager = &Settings;
+		TheShaderManager = &Shaders;
+		Settings.SettingsMain.Main.AsyncTextureLoading = true;
+		Manager = TheTextureManager = new TextureManager();
+		Manager->CreatePlaceholders();
+		Created.clear();
+
+	}
+
+	~Fixture() {
+
+		for (auto& Item : Manager->TextureCache) {
+			bool Placeholder = std::find(std::begin(Manager->Placeholders), std::end(Manager->Placeholders), Item.second) != std::end(Manager->Placeholders);
+			if (Item.second && !Placeholder) Item.second->Release();
+		}
+		for (IDirect3DBaseTexture9* Placeholder : Manager->Placeholders) {
+			if (Placeholder) Placeholder->Release();
+		}
+		delete Manager;
+		TheTextureManager = NULL;
+
+	}
+
+	// commits at every frame boundary until the pending files are bound, as the render hook does
+	bool CommitAll() {
+
+		for (int Frame = 0; Frame < 5000 && !Manager->PendingTextures.empty(); Frame++) {
+			Manager->CommitFileTextures();
+			if (!Manager->PendingTextures.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return Manager->PendingTextures.empty() && Manager->FileLoader.GetPendingCount() == 0;
+
+	}
+};
+
+TEST(DDSHeaderTypes) {
+
+	std::string Planar = ReadFile(PlanarFile);
+	std::string Cube = ReadFile(CubeFile);
+	std::string Volume = ReadFile(VolumeFile);
+	std::string Other = ReadFile(OtherFile);
+	CHECK(Planar.size() == 128 + 4 * 4 * 4 && Cube.size() == 128 + 2 * 2 * 4 * 6 && Volume.size() == 128 + 2 * 2 * 2 * 4);
+
+	CHECK_EQUAL(TextureLoader::GetDDSType(Planar.data(), Planar.size()), TextureRecord::TextureRecordType::PlanarBuffer);
+	CHECK_EQUAL(TextureLoader::GetDDSType(Cube.data(), Cube.size()), TextureRecord::TextureRecordType::CubeBuffer);
+	CHECK_EQUAL(TextureLoader::GetDDSType(Volume.data(), Volume.size()), TextureRecord::TextureRecordType::VolumeBuffer);
+	CHECK_EQUAL(TextureLoader::GetDDSType(Other.data(), Other.size()), TextureRecord::TextureRecordType::None);
+	CHECK_EQUAL(TextureLoader::GetDDSType(NULL, 0), TextureRecord::TextureRecordType::None);
+
+	// the header alone is enough, a truncated one or a wrong header size isn't a DDS
+	CHECK_EQUAL(TextureLoader::GetDDSType(Cube.data(), 128), TextureRecord::TextureRecordType::CubeBuffer);
+	CHECK_EQUAL(TextureLoader::GetDDSType(Cube.data(), 127), TextureRecord::TextureRecordType::None);
+	std::string Wrong = Planar;
+	Wrong[4] = 100;
+	CHECK_EQUAL(TextureLoader::GetDDSType(Wrong.data(), Wrong.size()), TextureRecord::TextureRecordType::None);
+
+}
+
+/*
+* The worker reads the files in the order they were queued, a missing file completes with no data.
+*/
+TEST(LoaderReadsInOrder) {
+
+	TextureLoader Loader;
+	const char* Paths[] = { VolumeFile, MissingFile, PlanarFile, CubeFile, OtherFile };
+	for (const char* Path : Paths) Loader.Enqueue(Path, TextureRecord::TextureRecordType::PlanarBuffer);
+
+	std::deque<TextureLoader::Request> Completed;
+	for (int i = 0; i < 5000 && Completed.size() < 5; i++) {
+		Loader.TakeCompleted(&Completed);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK_EQUAL(Completed.size(), 5u);
+	CHECK_EQUAL(Loader.GetPendingCount(), 0u);
+	if (Completed.size() != 5) return;
+
+	TextureRecord::TextureRecordType Types[] = { TextureRecord::TextureRecordType::VolumeBuffer, TextureRecord::TextureRecordType::None,
+		TextureRecord::TextureRecordType::PlanarBuffer, TextureRecord::TextureRecordType::CubeBuffer, TextureRecord::TextureRecordType::None };
+	for (int i = 0; i < 5; i++) {
+		CHECK(Completed[i].Path == Paths[i]);
+		CHECK_EQUAL(Completed[i].FileType, Types[i]);
+		CHECK_EQUAL(Completed[i].Type, TextureRecord::TextureRecordType::PlanarBuffer);
+		CHECK(std::string(Completed[i].Data.begin(), Completed[i].Data.end()) == ReadFile(Paths[i]));
+	}
+	CHECK(Completed[1].Data.empty());
+
+}
+
+/*
+* Samplers requesting a path already loading share its request: one read, one texture, every target bound when it is committed.
+*/
+TEST(PendingPathsAreShared) {
+
+	Fixture Test;
+	TextureManager* Manager = Test.Manager;
+	IDirect3DBaseTexture9* Placeholder = Manager->Placeholders[TextureRecord::TextureRecordType::PlanarBuffer];
+	IDirect3DBaseTexture9* Targets[3] = {};
+
+	for (IDirect3DBaseTexture9*& Target : Targets) {
+		Target = Manager->GetFileTexture(PlanarFile, TextureRecord::TextureRecordType::PlanarBuffer, &Target);
+		CHECK(Target == Placeholder);
+	}
+	CHECK(Manager->GetFileTexture(PlanarFile, TextureRecord::TextureRecordType::PlanarBuffer) == Placeholder);	// no target, gets the cached placeholder
+	CHECK_EQUAL(Manager->PendingTextures.size(), 1u);
+	CHECK_EQUAL(Manager->PendingTextures[PlanarFile].size(), 3u);
+	CHECK_EQUAL(Manager->FileLoader.GetPendingCount(), 1u);
+	CHECK(Created.empty());
+
+	CHECK(Test.CommitAll());
+	CHECK_EQUAL(Created.size(), 1u);
+	if (Created.size() != 1) return;
+	CHECK(Created[0].Content == ReadFile(PlanarFile));
+	for (IDirect3DBaseTexture9* Target : Targets) CHECK(Target == Created[0].Texture);
+	CHECK(Manager->TextureCache[PlanarFile] == Created[0].Texture);
+
+	// loaded: served from the cache without another read
+	IDirect3DBaseTexture9* Late = NULL;
+	CHECK(Manager->GetFileTexture(PlanarFile, TextureRecord::TextureRecordType::PlanarBuffer, &Late) == Created[0].Texture);
+	CHECK(Manager->PendingTextures.empty());
+	CHECK_EQUAL(Manager->FileLoader.GetPendingCount(), 0u);
+
+}
+
+/*
+* Only the targets still holding the placeholder are bound to the loaded texture: the samplers rebound or cleared meanwhile keep their texture.
+*/
+TEST(CommitRebindsPlaceholdersOnly) {
+
+	Fixture Test;
+	TextureManager* Manager = Test.Manager;
+	IDirect3DBaseTexture9* Placeholder = Manager->Placeholders[TextureRecord::TextureRecordType::CubeBuffer];
+	IDirect3DBaseTexture9* Kept = Placeholder;
+	IDirect3DBaseTexture9* Rebound = Placeholder;
+	IDirect3DBaseTexture9* Cleared = Placeholder;
+	Kept = Manager->GetFileTexture(CubeFile, TextureRecord::TextureRecordType::CubeBuffer, &Kept);
+	Rebound = Manager->GetFileTexture(CubeFile, TextureRecord::TextureRecordType::CubeBuffer, &Rebound);
+	Cleared = Manager->GetFileTexture(CubeFile, TextureRecord::TextureRecordType::CubeBuffer, &Cleared);
+
+	MockCubeTexture* Other = new MockCubeTexture(4);
+	Rebound = Other;
+	Cleared = NULL;
+	CHECK(Test.CommitAll());
+	CHECK_EQUAL(Created.size(), 1u);
+	CHECK(Kept != Placeholder && Kept == Manager->TextureCache[CubeFile]);
+	CHECK(Rebound == Other);
+	CHECK(Cleared == NULL);
+	Other->Release();
+
+}
+
+/*
+* The textures are created on the render thread in the order the files were requested, with the type of the sampler.
+* A file that cannot be read leaves its samplers and the cache empty.
+*/
+TEST(CreationOrder) {
+
+	Fixture Test;
+	TextureManager* Manager = Test.Manager;
+	struct { const char* Path; TextureRecord::TextureRecordType Type; IDirect3DBaseTexture9* Target; } Requests[] = {
+		{ VolumeFile, TextureRecord::TextureRecordType::VolumeBuffer, NULL },
+		{ CubeFile, TextureRecord::TextureRecordType::CubeBuffer, NULL },
+		{ MissingFile, TextureRecord::TextureRecordType::PlanarBuffer, NULL },
+		{ PlanarFile, TextureRecord::TextureRecordType::PlanarBuffer, NULL },
+		{ VolumeFile, TextureRecord::TextureRecordType::VolumeBuffer, NULL },
+	};
+	for (auto& Request : Requests) {
+		Request.Target = Manager->GetFileTexture(Request.Path, Request.Type, &Request.Target);
+		CHECK(Request.Target == Manager->Placeholders[Request.Type]);
+	}
+	CHECK(Test.CommitAll());
+
+	CHECK_EQUAL(Created.size(), 3u);
+	if (Created.size() != 3) return;
+	CHECK(Created[0].Type == TextureRecord::TextureRecordType::VolumeBuffer && Created[0].Content == ReadFile(VolumeFile));
+	CHECK(Created[1].Type == TextureRecord::TextureRecordType::CubeBuffer && Created[1].Content == ReadFile(CubeFile));
+	CHECK(Created[2].Type == TextureRecord::TextureRecordType::PlanarBuffer && Created[2].Content == ReadFile(PlanarFile));
+	CHECK(Requests[0].Target == Created[0].Texture && Requests[4].Target == Created[0].Texture);
+	CHECK(Requests[1].Target == Created[1].Texture);
+	CHECK(Requests[2].Target == NULL);
+	CHECK(Requests[3].Target == Created[2].Texture);
+	CHECK(Manager->TextureCache.count(MissingFile) && Manager->TextureCache[MissingFile] == NULL);
+
+}
+
+/*
+* Without async loading, or without a target to bind later, the file is loaded at once.
+*/
+TEST(SynchronousLoads) {
+
+	Fixture Test;
+	TextureManager* Manager = Test.Manager;
+	IDirect3DBaseTexture9* Target = NULL;
+	IDirect3DBaseTexture9* Texture = Manager->GetFileTexture(VolumeFile, TextureRecord::TextureRecordType::VolumeBuffer);
+	CHECK_EQUAL(Created.size(), 1u);
+	CHECK(Texture && Texture->GetType() == D3DRTYPE_VOLUMETEXTURE);
+
+	Test.Settings.SettingsMain.Main.AsyncTextureLoading = false;
+	Target = Manager->GetFileTexture(PlanarFile, TextureRecord::TextureRecordType::PlanarBuffer, &Target);
+	CHECK_EQUAL(Created.size(), 2u);
+	CHECK(Target && Target->GetType() == D3DRTYPE_TEXTURE);
+	CHECK(Created.back().Content == std::string("file:") + PlanarFile);
+	CHECK(Manager->PendingTextures.empty());
+
+}
+
+/*
+* Bytes per pixel of the formats the plugin creates targets with, and the estimate of a texture with its mip chain and faces.
+*/
+TEST(FormatSizes) {
+
+	struct { D3DFORMAT Format; UInt32 Size; } Formats[] = {
+		{ D3DFMT_A32B32G32R32F, 16 }, { D3DFMT_A16B16G16R16F, 8 }, { D3DFMT_A16B16G16R16, 8 }, { D3DFMT_G32R32F, 8 },
+		{ D3DFMT_A8R8G8B8, 4 }, { D3DFMT_X8R8G8B8, 4 }, { D3DFMT_G16R16, 4 }, { D3DFMT_G16R16F, 4 }, { D3DFMT_R32F, 4 },
+		{ (D3DFORMAT)MAKEFOURCC('I', 'N', 'T', 'Z'), 4 }, { D3DFMT_D24S8, 4 },
+		{ D3DFMT_R16F, 2 }, { D3DFMT_L16, 2 }, { D3DFMT_L8, 1 }, { D3DFMT_A8, 1 },
+	};
+	for (auto& Item : Formats) {
+		CHECK_EQUAL(RenderGraph::GetFormatSize(Item.Format), Item.Size);
+		CHECK_EQUAL(TextureManager::GetTextureSize(16, 16, Item.Format, false, 1), 256 * Item.Size);
+	}
+
+	CHECK_EQUAL(TextureManager::GetTextureSize(1920, 1080, D3DFMT_A16B16G16R16F, false, 1), 1920u * 1080 * 8);
+	CHECK_EQUAL(TextureManager::GetTextureSize(4, 4, D3DFMT_A8R8G8B8, true, 1), (16u + 4 + 1) * 4);
+	CHECK_EQUAL(TextureManager::GetTextureSize(8, 2, D3DFMT_A8R8G8B8, true, 1), (16u + 4 + 2 + 1) * 4);		// the short side stops at 1
+	CHECK_EQUAL(TextureManager::GetTextureSize(512, 512, D3DFMT_R32F, false, 6), 512u * 512 * 4 * 6);
+	CHECK_EQUAL(TextureManager::GetTextureSize(1, 1, D3DFMT_A8, true, 1), 1u);
+
+}
+
+/*
+* Targets registered as Bloom registers its mip chain: the first buffer kept, the smaller ones evictable. Over the budget, the targets of the
+* disabled effects go, the one disabled for the longest time first, and come back with the same description when the effect renders.
+*/
+TEST(TargetsBudget) {
+
+	Fixture Test;
+	TextureManager* Manager = Test.Manager;
+	EffectRecord Bloom("Bloom");
+	EffectRecord SMAA("SMAA");
+	EffectRecord* BloomPointer = &Bloom;
+	EffectRecord* SMAAPointer = &SMAA;
+	Test.Shaders.EffectsNames["Bloom"] = &BloomPointer;
+	Test.Shaders.EffectsNames["SMAA"] = &SMAAPointer;
+
+	IDirect3DTexture9* BloomTextures[4] = {};
+	IDirect3DSurface9* BloomSurfaces[4] = {};
+	Manager->TargetsOwner = &Bloom;
+	for (int i = 0; i < 4; i++) {
+		std::string Name = i ? "TESR_BloomBuffer" + std::to_string(1 << i) : "TESR_BloomBuffer";
+		Manager->InitTexture(Name.c_str(), &BloomTextures[i], &BloomSurfaces[i], 960 >> i, 540 >> i, D3DFMT_A16B16G16R16F);
+		if (i > 0) Manager->SetTargetsEvictable(&Bloom, Name.c_str());
+	}
+	IDirect3DTexture9* EdgesTexture = NULL;
+	IDirect3DSurface9* EdgesSurface = NULL;
+	Manager->TargetsOwner = &SMAA;
+	Manager->InitTexture("TESR_SMAA_Edges", &EdgesTexture, &EdgesSurface, 1920, 1080, D3DFMT_A8R8G8B8);
+	Manager->SetTargetsEvictable(&SMAA);
+	Manager->TargetsOwner = NULL;
+
+	UInt32 BloomSize = 0;
+	for (int i = 0; i < 4; i++) BloomSize += (960u >> i) * (540u >> i) * 8;
+	UInt32 ChainSize = BloomSize - 960 * 540 * 8;
+	UInt32 EdgesSize = 1920 * 1080 * 4;
+	CHECK_EQUAL(Manager->GetTargetsMemory(&Bloom), BloomSize);
+	CHECK_EQUAL(Manager->GetTargetsMemory(NULL), BloomSize + EdgesSize);
+	CHECK(Manager->RenderTargets["TESR_BloomBuffer"].Owner == &Bloom && !Manager->RenderTargets["TESR_BloomBuffer"].Evictable);
+	CHECK(Manager->RenderTargets["TESR_BloomBuffer8"].Evictable);
+
+	// Bloom disabled first, both over the budget of 1 MB: Bloom goes first, then SMAA
+	Test.Settings.SettingsMain.Main.RenderTargetsBudget = 1;
+	Bloom.Enabled = false;
+	SMAA.Enabled = true;
+	Manager->UpdateTargetsBudget();
+	SMAA.Enabled = false;
+	Manager->UpdateTargetsBudget();
+	CHECK_EQUAL(Manager->ReleasedTargetsCount, 4u);
+	CHECK_EQUAL(Manager->GetTargetsMemory(NULL), 960u * 540 * 8);
+	CHECK(BloomTextures[0] && BloomSurfaces[0]);
+	for (int i = 1; i < 4; i++) CHECK(!BloomTextures[i] && !BloomSurfaces[i]);
+	CHECK(!EdgesTexture && !EdgesSurface);
+	CHECK_EQUAL(SMAA.Cleared.size(), 4u);
+	CHECK(std::count(Bloom.Cleared.begin(), Bloom.Cleared.end(), "TESR_BloomBuffer8") == 1);
+	CHECK(std::count(Bloom.Cleared.begin(), Bloom.Cleared.end(), "TESR_BloomBuffer") == 0);
+
+	// within the budget nothing more is released, RestoreTargets brings back the targets of its effect only
+	Test.Settings.SettingsMain.Main.RenderTargetsBudget = 0;
+	Bloom.Enabled = true;
+	Manager->RestoreTargets(&Bloom);
+	for (int i = 0; i < 4; i++) CHECK(BloomTextures[i] && BloomSurfaces[i]);
+	CHECK(!EdgesTexture);
+	CHECK_EQUAL(Manager->ReleasedTargetsCount, 1u);
+	CHECK_EQUAL(Manager->GetTargetsMemory(NULL), BloomSize);
+	CHECK_EQUAL(Manager->RenderTargets["TESR_BloomBuffer4"].Width, 240u);
+	CHECK(Manager->RenderTargets["TESR_BloomBuffer4"].Evictable);
+	Manager->RestoreTargets(&SMAA);
+	CHECK_EQUAL(Manager->GetTargetsMemory(NULL), BloomSize + EdgesSize);
+	CHECK_EQUAL(ChainSize, BloomSize - Manager->RenderTargets["TESR_BloomBuffer"].Size);
+
+	for (int i = 0; i < 4; i++) {
+		BloomSurfaces[i]->Release();
+		BloomTextures[i]->Release();
+	}
+	EdgesSurface->Release();
+	EdgesTexture->Release();
+
+}
+
+int main() {
+
+	RUN(FormatSizes);
+	RUN(TargetsBudget);
+	RUN(DDSHeaderTypes);
+	RUN(LoaderReadsInOrder);
+	RUN(PendingPathsAreShared);
+	RUN(CommitRebindsPlaceholdersOnly);
+	RUN(CreationOrder);
+	RUN(SynchronousLoads);
+	CHECK_EQUAL(LiveResources, 0);
+	TEST_RESULT();
+
+}
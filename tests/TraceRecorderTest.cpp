@@ -0,0 +1,222 @@
+#include "Test.h"
+#include <filesystem>
+#include <regex>
+
+struct TraceEvent {
+	std::string	Name;
+	UInt32		ThreadId;
+	UInt64		Start;
+	UInt64		Duration;
+};
+
+struct Trace {
+	std::map<UInt32, std::string> Threads;		// thread name metadata
+	std::vector<TraceEvent> Events;				// in the order of the file
+	bool		Valid;
+};
+
+/*
+* Reads back the events written by TraceRecorder::Serialize, checking the envelope and that every event is separated by a single comma.
+*/
+static Trace Parse(const std::string& Text) {
+
+	static const std::regex Metadata("\\{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":(\\d+),\"args\":\\{\"name\":\"([^\"]*)\"\\}\\}");
+	static const std::regex Complete("\\{\"name\":\"((?:[^\"\\\\]|\\\\.)*)\",\"cat\":\"TESR\",\"ph\":\"X\",\"pid\":1,\"tid\":(\\d+),\"ts\":(\\d+),\"dur\":(\\d+)\\}");
+	const std::string Head = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	const std::string Tail = "]}\n";
+	Trace Result;
+	std::smatch Match;
+
+	Result.Valid = Text.size() >= Head.size() + Tail.size() && !Text.compare(0, Head.size(), Head) && !Text.compare(Text.size() - Tail.size(), Tail.size(), Tail);
+	if (!Result.Valid) return Result;
+
+	std::string Body = Text.substr(Head.size(), Text.size() - Head.size() - Tail.size());
+	auto Position = Body.cbegin();
+	while (Position != Body.cend()) {
+		if (Position != Body.cbegin()) {
+			if (*Position != ',') break;
+			Position++;
+		}
+		if (std::regex_search(Position, Body.cend(), Match, Metadata, std::regex_constants::match_continuous)) {
+			Result.Threads[std::stoul(Match[1])] = Match[2];
+		}
+		else if (std::regex_search(Position, Body.cend(), Match, Complete, std::regex_constants::match_continuous)) {
+			Result.Events.push_back({ Match[1], (UInt32)std::stoul(Match[2]), std::stoull(Match[3]), std::stoull(Match[4]) });
+		}
+		else {
+			break;
+		}
+		Position = Match[0].second;
+	}
+	Result.Valid = Position == Body.cend();
+	return Result;
+
+}
+
+static std::string ReadFile(const std::string& Path) {
+
+	std::ifstream File(Path, std::ios::binary);
+	std::stringstream Content;
+	Content << File.rdbuf();
+	return Content.str();
+
+}
+
+static void Wait(int Milliseconds) {
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(Milliseconds));
+
+}
+
+/*
+* A frame of two nested levels, as the render hooks and the effects record them.
+*/
+static void RecordFrame(const char* Frame, UInt32* ThreadId) {
+
+	*ThreadId = GetCurrentThreadId();
+	TraceZone Outer(Frame);
+	Wait(2);
+	{
+		TraceZone Inner("Inner");
+		Wait(2);
+		{
+			TraceZone Innermost("Innermost");
+			Wait(1);
+		}
+	}
+	{
+		TraceZone Sibling("Sibling");
+		Wait(1);
+	}
+
+}
+
+/*
+* Two threads record nested zones: each gets its name record and its zones, sorted by start time and contained in their parent.
+*/
+TEST(NestedZonesOnTwoThreads) {
+
+	std::string Path = (std::filesystem::temp_directory_path() / "TESR_TraceRecorderTest.json").string();
+	UInt32 FirstId = 0;
+	UInt32 SecondId = 0;
+
+	TraceZone Before("Before");		// opened before the capture, ignored
+	TraceRecorder::Start();
+	std::thread First(RecordFrame, "First frame", &FirstId);
+	std::thread Second(RecordFrame, "Second \"frame\"", &SecondId);
+	First.join();
+	Second.join();
+	CHECK(TraceRecorder::Stop(Path.c_str()));
+	TraceZone After("After");		// closed after the capture, ignored
+
+	Trace Result = Parse(ReadFile(Path));
+	std::filesystem::remove(Path);
+	CHECK(Result.Valid);
+	CHECK_EQUAL(Result.Threads.size(), 2u);
+	CHECK(Result.Threads[FirstId] == "Thread " + std::to_string(FirstId));
+	CHECK(Result.Threads[SecondId] == "Thread " + std::to_string(SecondId));
+	CHECK_EQUAL(Result.Events.size(), 8u);
+
+	UInt32 Ids[] = { FirstId, SecondId };
+	const char* Frames[] = { "First frame", "Second \\\"frame\\\"" };
+	for (int t = 0; t < 2; t++) {
+		std::vector<TraceEvent> Events;
+		for (TraceEvent& Item : Result.Events) {
+			if (Item.ThreadId == Ids[t]) Events.push_back(Item);
+		}
+		CHECK_EQUAL(Events.size(), 4u);
+		if (Events.size() != 4) continue;
+
+		// sorted by start: the frame, then its children in the order they were opened
+		CHECK(Events[0].Name == Frames[t]);
+		CHECK(Events[1].Name == "Inner");
+		CHECK(Events[2].Name == "Innermost");
+		CHECK(Events[3].Name == "Sibling");
+		auto Contains = [](const TraceEvent& Parent, const TraceEvent& Child) {
+			return Child.Start >= Parent.Start && Child.Start + Child.Duration <= Parent.Start + Parent.Duration;
+		};
+		CHECK(Contains(Events[0], Events[1]));
+		CHECK(Contains(Events[1], Events[2]));
+		CHECK(Contains(Events[0], Events[3]));
+		CHECK(Events[3].Start >= Events[1].Start + Events[1].Duration);
+		CHECK(Events[0].Duration >= 6000);
+		CHECK(Events[2].Duration >= 1000);
+	}
+
+	// a thread's events are written together after its name record
+	for (size_t i = 1; i < Result.Events.size(); i++) {
+		if (Result.Events[i].ThreadId == Result.Events[i - 1].ThreadId) CHECK(Result.Events[i].Start >= Result.Events[i - 1].Start);
+	}
+	CHECK(Result.Events[0].ThreadId != Result.Events[4].ThreadId);
+
+}
+
+/*
+* A new capture starts empty, and zones recorded while stopped are dropped.
+*/
+TEST(CapturesAreSeparate) {
+
+	std::string Path = (std::filesystem::temp_directory_path() / "TESR_TraceRecorderTest.json").string();
+
+	{
+		TraceZone Stopped("Stopped");
+	}
+	TraceRecorder::Start();
+	{
+		TraceZone Only("Only");
+		Wait(1);
+	}
+	CHECK(TraceRecorder::Stop(Path.c_str()));
+
+	Trace Result = Parse(ReadFile(Path));
+	std::filesystem::remove(Path);
+	CHECK(Result.Valid);
+	CHECK_EQUAL(Result.Threads.size(), 1u);
+	CHECK_EQUAL(Result.Events.size(), 1u);
+	if (Result.Events.size() == 1) CHECK(Result.Events[0].Name == "Only");
+	CHECK(!TraceRecorder::Stop("/nonexistent/directory/trace.json"));
+
+}
+
+/*
+* Zones with the same start keep the enclosing one first, names are escaped for JSON.
+*/
+TEST(SerializeOrderAndEscaping) {
+
+	TraceRecorder::ThreadBuffer Buffer;
+	Buffer.ThreadId = 7;
+	Buffer.Dropped = 0;
+	Buffer.Events.push_back({ "Child", 100, 10 });
+	Buffer.Events.push_back({ "Parent", 100, 50 });
+	Buffer.Events.push_back({ "Earlier", 20, 5 });
+	Buffer.Events.push_back({ "Tab\tQuote\"Back\\slash\x01", 200, 1 });
+	TraceRecorder::ThreadBuffer Empty;
+	Empty.ThreadId = 8;
+	Empty.Dropped = 0;
+	std::vector<TraceRecorder::ThreadBuffer*> Threads = { &Empty, &Buffer };
+
+	std::string Output;
+	TraceRecorder::Serialize(&Output, &Threads);
+	Trace Result = Parse(Output);
+	CHECK(Result.Valid);
+	CHECK_EQUAL(Result.Threads.size(), 1u);
+	CHECK_EQUAL(Result.Events.size(), 4u);
+	if (Result.Events.size() == 4) {
+		CHECK(Result.Events[0].Name == "Earlier");
+		CHECK(Result.Events[1].Name == "Parent");
+		CHECK(Result.Events[2].Name == "Child");
+		CHECK(Result.Events[3].Name == "Tab\\tQuote\\\"Back\\\\slash\\u0001");
+		CHECK_EQUAL(Result.Events[1].Duration, 50u);
+		CHECK_EQUAL(Result.Events[3].ThreadId, 7u);
+	}
+
+}
+
+int main() {
+
+	RUN(NestedZonesOnTwoThreads);
+	RUN(CapturesAreSeparate);
+	RUN(SerializeOrderAndEscaping);
+	TEST_RESULT();
+
+}
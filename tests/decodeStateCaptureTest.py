@@ -0,0 +1,83 @@
+import os
+import subprocess
+import sys
+import unittest
+
+sys.dont_write_bytecode = True    # no __pycache__ next to the scripts
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import decodeStateCapture
+
+# data/States.bin is a capture of 2 frames, written with the layout of the 32 bit plugin:
+#
+#   frame 0  ZENABLE 1 outside the passes
+#            Shadows: pixel shader set twice, ZENABLE 1 filtered by the proxy, texture 0, draw of 100 primitives,
+#                     then a sampler state after the nested pass
+#            Water (nested in Shadows): texture 0 set again, ALPHABLENDENABLE 1, FVF, declaration, the same FVF again,
+#                     indexed draw of 50 primitives
+#   frame 1  Shadows: pixel shader, state block, the same pixel shader, ZENABLE 1 filtered, draw of 100 primitives
+#            Water: ALPHABLENDENABLE 1 four times, texture 1 set twice, indexed draw of 50 primitives
+CAPTURE = os.path.join("data", "States.bin")
+DECODER = os.path.join("..", "decodeStateCapture.py")
+
+
+def run_decoder(*args):
+    return subprocess.run([sys.executable, DECODER, CAPTURE] + list(args), capture_output=True, text=True, check=True).stdout
+
+
+def pass_rows(output):
+    lines = output.splitlines()
+    first = next(i for i, line in enumerate(lines) if line.startswith("Pass")) + 1
+    last = next(i for i, line in enumerate(lines) if line.startswith("Total"))
+    return [line[:32].strip() for line in lines[first:last]]
+
+
+def state_rows(output):
+    lines = output.splitlines()
+    first = next(i for i, line in enumerate(lines) if line.startswith("State")) + 1
+    return [(line[:40].strip(), int(line[40:])) for line in lines[first:] if line]
+
+
+class DecodeStateCaptureTest(unittest.TestCase):
+    def setUp(self):
+        frames, lost, passes, state_names, events = decodeStateCapture.read_capture(CAPTURE)
+        self.assertEqual((frames, lost, passes), (2, 0, ["Shadows", "Water"]))
+        self.assertEqual(state_names[7], "D3DRS_ZENABLE")
+        stats, self.states = decodeStateCapture.decode(passes, state_names, events)
+        self.stats = {s.name: s for s in stats}
+
+    def test_redundant_states(self):
+        # a state set to its shadowed value is redundant, filtered or not; the frames and state blocks clear the shadow,
+        # a declaration forgets the FVF
+        shadows = self.stats["Shadows"]
+        self.assertEqual((shadows.calls, shadows.redundant, shadows.filtered), (8, 3, 2))
+        self.assertEqual((shadows.cost, shadows.redundant_cost), (37, 8))
+        self.assertEqual((shadows.draws, shadows.primitives), (2, 200))
+
+        water = self.stats["Water"]
+        self.assertEqual((water.calls, water.redundant, water.filtered), (11, 5, 0))
+        self.assertEqual((water.cost, water.redundant_cost), (29, 11))
+        self.assertEqual((water.draws, water.primitives), (2, 100))
+
+        outside = self.stats[decodeStateCapture.OUTSIDE_PASSES]
+        self.assertEqual((outside.calls, outside.redundant, outside.cost), (1, 0, 1))
+
+        self.assertEqual(self.states, {
+            "D3DRS_ALPHABLENDENABLE": 3, "D3DRS_ZENABLE": 2, "PixelShader": 1, "Texture 0": 1, "Texture 1": 1,
+        })
+
+    def test_pass_ranking(self):
+        self.assertEqual(pass_rows(run_decoder()), ["Shadows", "Water", decodeStateCapture.OUTSIDE_PASSES])
+        self.assertEqual(pass_rows(run_decoder("--sort", "redundant")), ["Water", "Shadows", decodeStateCapture.OUTSIDE_PASSES])
+        self.assertEqual(pass_rows(run_decoder("--sort", "calls")), ["Water", "Shadows", decodeStateCapture.OUTSIDE_PASSES])
+
+    def test_state_ranking(self):
+        # counts per frame
+        rows = state_rows(run_decoder())
+        self.assertEqual(rows[:2], [("D3DRS_ALPHABLENDENABLE", 2), ("D3DRS_ZENABLE", 1)])
+        self.assertEqual(sorted(label for label, count in rows[2:]), ["PixelShader", "Texture 0", "Texture 1"])
+        self.assertEqual([label for label, count in state_rows(run_decoder("--states", "1"))], ["D3DRS_ALPHABLENDENABLE"])
+        self.assertFalse([line for line in run_decoder("--states", "0").splitlines() if line.startswith("State")])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+* Forced include of the test builds, standing in for src/core/Framework.h: the standard headers, the subset of the Windows, Direct3D 9
+* and NetImmerse declarations used by the tested code, and the base headers of the plugin.
+*/
+#include <cstdint>
+#include <cstring>
+#include <strings.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cerrno>
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <fstream>
+#include <sstream>
+
+#define __forceinline	inline
+#define __stdcall
+#define __thiscall
+#define __cdecl
+#define __fastcall
+
+// the min and max macros of windows.h, as functions so that they don't break the standard headers
+template <typename T1, typename T2> inline typename std::common_type<T1, T2>::type min(T1 a, T2 b) { return (b < a) ? b : a; }
+template <typename T1, typename T2> inline typename std::common_type<T1, T2>::type max(T1 a, T2 b) { return (a < b) ? b : a; }
+
+#include "windows.h"
+#include "d3d9.h"
+#include "d3dx9math.h"
+#include "d3dx9.h"
+#include "Types.h"
+#include "Logger.h"
+#include "TraceRecorder.h"
+#include "StateCapture.h"
+#include "GameNi.h"
+
+class ShaderRecordVertex;
+class ShaderRecordPixel;
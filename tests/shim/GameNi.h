@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+* The NetImmerse math classes used by the code built for the tests, as declared in nvse/GameNi.h and implemented in nvse/GameNi.cpp.
+* The scene graph classes are only declared, the tested code keeps pointers to them.
+*/
+class NiGeometry;
+class NiGeometryBufferData;
+
+class NiSkinPartition {
+public:
+	struct Partition;
+};
+
+class NiPoint3 {
+public:
+	NiPoint3() : x(0.f), y(0.f), z(0.f) {};
+	NiPoint3(const float x, const float y, const float z) : x(x), y(y), z(z) {};
+
+	float operator * (const NiPoint3 pt) const { return x * pt.x + y * pt.y + z * pt.z; }
+	NiPoint3 operator+ (const NiPoint3& pt) const { return NiPoint3(x + pt.x, y + pt.y, z + pt.z); };
+	NiPoint3 operator- (const NiPoint3& pt) const { return NiPoint3(x - pt.x, y - pt.y, z - pt.z); };
+	NiPoint3 operator- () const { return NiPoint3(-x, -y, -z); };
+	NiPoint3 operator* (float fScalar) const { return NiPoint3(fScalar * x, fScalar * y, fScalar * z); };
+	NiPoint3 operator/ (float fScalar) const { return NiPoint3(x / fScalar, y / fScalar, z / fScalar); };
+
+	float Length() const { return std::sqrt(x * x + y * y + z * z); }
+	float Dot(const NiPoint3& pt) const { return x * pt.x + y * pt.y + z * pt.z; }
+	NiPoint3 Cross(const NiPoint3& pt) const { return NiPoint3(y * pt.z - z * pt.y, z * pt.x - x * pt.z, x * pt.y - y * pt.x); }
+
+	float x;
+	float y;
+	float z;
+};
+
+class NiPlane {
+public:
+	NiPlane() : Normal(0.0f, 0.0f, 0.0f), Constant(0.0f) {}
+	NiPlane(const NiPoint3& kNormal, float fConstant) : Normal(kNormal), Constant(fConstant) {}
+	NiPlane(const NiPoint3& kNormal, const NiPoint3& kPoint) : Normal(kNormal), Constant(kNormal.Dot(kPoint)) {}
+
+	enum {
+		NoSide = 0,
+		PositiveSide = 1,
+		NegativeSide = 2,
+	};
+
+	NiPoint3	Normal;
+	float		Constant;
+
+	float Distance(const NiPoint3& arPoint) const { return Normal * arPoint - Constant; }
+};
+
+class NiFrustumPlanes {
+public:
+	enum ActivePlanes {
+		NearPlane = 0,
+		FarPlane = 1,
+		LeftPlane = 2,
+		RightPlane = 3,
+		TopPlane = 4,
+		BottomPlane = 5,
+		MaxPlanes = 6
+	};
+
+	NiPlane	CullingPlanes[MaxPlanes];
+	UInt32	ActivePlanes;
+
+	bool IsPlaneActive(UInt32 ePlane) const { return (ActivePlanes & (1 << ePlane)) ? true : false; }
+};
+
+class NiBound {
+public:
+	int WhichSide(const NiPlane& kPlane) const {
+		float fDistance = kPlane.Distance(Center);
+		return (fDistance > -Radius) ? (Radius <= fDistance) : 2;
+	}
+
+	bool WithinFrustum(NiFrustumPlanes* arPlanes) {
+		for (UInt32 uiFace = 0; uiFace < arPlanes->MaxPlanes; ++uiFace) {
+			if (arPlanes->IsPlaneActive(uiFace) && WhichSide(arPlanes->CullingPlanes[uiFace]) == NiPlane::NegativeSide) return false;
+		}
+		return true;
+	}
+
+	NiPoint3	Center;
+	float		Radius;
+};
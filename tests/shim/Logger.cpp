@@ -0,0 +1,69 @@
+/*
+* The logger of the test builds writes the messages to the standard output, synchronously.
+*/
+static void WriteLine(const char* Message, va_list Args) {
+
+	vprintf(Message, Args);
+	printf("\n");
+
+}
+
+void Logger::Log(char* Message, ...) {
+
+	va_list Args;
+	va_start(Args, Message);
+	WriteLine(Message, Args);
+	va_end(Args);
+
+}
+
+void Logger::Log(const char* Message, ...) {
+
+	va_list Args;
+	va_start(Args, Message);
+	WriteLine(Message, Args);
+	va_end(Args);
+
+}
+
+void Logger::Log(LogCategory Category, LogLevel Level, const char* Message, ...) {
+
+	va_list Args;
+	va_start(Args, Message);
+	WriteLine(Message, Args);
+	va_end(Args);
+
+}
+
+TimeLogger::TimeLogger() {
+
+	start = std::chrono::steady_clock::now();
+	end = start;
+
+}
+
+TimeLogger::~TimeLogger() {}
+
+float TimeLogger::LogTime(const char* Name) {
+
+	end = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::milli> Elapsed = end - start;
+	if (TraceRecorder::Recording) TraceRecorder::AddZone(Name, start, end);
+	start = end;
+	return (float)Elapsed.count();
+
+}
+
+void Logger::Debug(char* Message, ...) {}
+
+void Logger::SetLevel(LogCategory Category, UInt32 Level) {}
+
+void Logger::SetRateLimit(UInt32 Limit) {}
+
+void Logger::Debug(const char* Message, ...) {}
+
+const char* Logger::GetRenderStateName(UInt32 State) {
+
+	return NULL;
+
+}
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "windows.h"
+
+/*
+* The D3D9 declarations used by the code built for the tests. Enumerations only list the values the code and the tests use,
+* the structures only passed by pointer are left incomplete. The device interfaces have every method, so proxies and mocks
+* override the same methods as with the SDK headers.
+*/
+typedef DWORD D3DCOLOR;
+
+#define D3D_OK					S_OK
+#define D3DERR_INVALIDCALL		((HRESULT)0x8876086C)
+
+#define D3DCOLOR_ARGB(a, r, g, b)	((D3DCOLOR)((((a) & 0xFF) << 24) | (((r) & 0xFF) << 16) | (((g) & 0xFF) << 8) | ((b) & 0xFF)))
+#define D3DCLEAR_TARGET				0x00000001L
+
+#define D3DUSAGE_RENDERTARGET		0x00000001L
+#define D3DUSAGE_DEPTHSTENCIL		0x00000002L
+#define D3DUSAGE_WRITEONLY			0x00000008L
+#define D3DUSAGE_DYNAMIC			0x00000200L
+#define D3DUSAGE_AUTOGENMIPMAP		0x00000400L
+
+#define D3DLOCK_NOOVERWRITE			0x00001000L
+#define D3DLOCK_DISCARD				0x00002000L
+
+#define D3DSTREAMSOURCE_INDEXEDDATA		(1U << 30)
+#define D3DSTREAMSOURCE_INSTANCEDATA	(2U << 30)
+
+#define MAKEFOURCC(ch0, ch1, ch2, ch3)	((DWORD)(BYTE)(ch0) | ((DWORD)(BYTE)(ch1) << 8) | ((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24))
+
+#define D3DDMAPSAMPLER				256
+#define D3DVERTEXTEXTURESAMPLER0	257
+#define D3DVERTEXTEXTURESAMPLER1	258
+#define D3DVERTEXTEXTURESAMPLER2	259
+#define D3DVERTEXTEXTURESAMPLER3	260
+
+enum D3DFORMAT {
+	D3DFMT_UNKNOWN				= 0,
+	D3DFMT_A8R8G8B8				= 21,
+	D3DFMT_X8R8G8B8				= 22,
+	D3DFMT_A8					= 28,
+	D3DFMT_G16R16				= 34,
+	D3DFMT_A16B16G16R16			= 36,
+	D3DFMT_L8					= 50,
+	D3DFMT_D24S8				= 75,
+	D3DFMT_D16					= 80,
+	D3DFMT_L16					= 81,
+	D3DFMT_INDEX16				= 101,
+	D3DFMT_R16F					= 111,
+	D3DFMT_G16R16F				= 112,
+	D3DFMT_A16B16G16R16F		= 113,
+	D3DFMT_R32F					= 114,
+	D3DFMT_G32R32F				= 115,
+	D3DFMT_A32B32G32R32F		= 116,
+};
+
+enum D3DRENDERSTATETYPE {
+	D3DRS_ZENABLE				= 7,
+	D3DRS_ZWRITEENABLE			= 14,
+	D3DRS_ALPHATESTENABLE		= 15,
+	D3DRS_CULLMODE				= 22,
+	D3DRS_ALPHABLENDENABLE		= 27,
+};
+
+enum D3DSAMPLERSTATETYPE {
+	D3DSAMP_ADDRESSU			= 1,
+	D3DSAMP_ADDRESSV			= 2,
+	D3DSAMP_MAGFILTER			= 5,
+	D3DSAMP_MINFILTER			= 6,
+	D3DSAMP_MIPFILTER			= 7,
+	D3DSAMP_DMAPOFFSET			= 13,
+};
+
+enum D3DTEXTURESTAGESTATETYPE {
+	D3DTSS_COLOROP				= 1,
+	D3DTSS_COLORARG1			= 2,
+	D3DTSS_CONSTANT				= 32,
+};
+
+enum D3DTEXTUREFILTERTYPE {
+	D3DTEXF_NONE				= 0,
+	D3DTEXF_POINT				= 1,
+	D3DTEXF_LINEAR				= 2,
+};
+
+enum D3DPRIMITIVETYPE {
+	D3DPT_TRIANGLELIST			= 4,
+	D3DPT_TRIANGLESTRIP			= 5,
+};
+
+enum D3DPOOL {
+	D3DPOOL_DEFAULT				= 0,
+	D3DPOOL_MANAGED				= 1,
+};
+
+enum D3DMULTISAMPLE_TYPE {
+	D3DMULTISAMPLE_NONE			= 0,
+};
+
+enum D3DBACKBUFFER_TYPE {
+	D3DBACKBUFFER_TYPE_MONO		= 0,
+};
+
+enum D3DTRANSFORMSTATETYPE {
+	D3DTS_VIEW					= 2,
+	D3DTS_PROJECTION			= 3,
+};
+
+enum D3DSTATEBLOCKTYPE {
+	D3DSBT_ALL					= 1,
+};
+
+enum D3DQUERYTYPE {
+	D3DQUERYTYPE_OCCLUSION		= 9,
+	D3DQUERYTYPE_TIMESTAMP		= 10,
+	D3DQUERYTYPE_TIMESTAMPDISJOINT	= 11,
+	D3DQUERYTYPE_TIMESTAMPFREQ	= 12,
+};
+
+enum D3DDECLTYPE {
+	D3DDECLTYPE_FLOAT3			= 2,
+	D3DDECLTYPE_FLOAT4			= 3,
+	D3DDECLTYPE_UNUSED			= 17,
+};
+
+enum D3DDECLMETHOD {
+	D3DDECLMETHOD_DEFAULT		= 0,
+};
+
+enum D3DDECLUSAGE {
+	D3DDECLUSAGE_POSITION		= 0,
+	D3DDECLUSAGE_TEXCOORD		= 5,
+};
+
+enum D3DCOMPOSERECTSOP {
+	D3DCOMPOSERECTS_COPY		= 1,
+};
+
+enum D3DDISPLAYROTATION {
+	D3DDISPLAYROTATION_IDENTITY	= 1,
+};
+
+enum D3DSHADER_INSTRUCTION_OPCODE_TYPE {
+	D3DSIO_MOV					= 1,
+	D3DSIO_TEXKILL				= 65,
+	D3DSIO_COMMENT				= 0xFFFE,
+	D3DSIO_END					= 0xFFFF,
+};
+
+#define D3DSI_INSTLENGTH_MASK		0x0F000000
+#define D3DSI_INSTLENGTH_SHIFT		24
+#define D3DSI_COMMENTSIZE_MASK		0x7FFF0000
+#define D3DSI_COMMENTSIZE_SHIFT		16
+
+enum D3DRESOURCETYPE {
+	D3DRTYPE_SURFACE			= 1,
+	D3DRTYPE_TEXTURE			= 3,
+	D3DRTYPE_VOLUMETEXTURE		= 4,
+	D3DRTYPE_CUBETEXTURE		= 5,
+};
+
+enum D3DCUBEMAP_FACES {
+	D3DCUBEMAP_FACE_POSITIVE_X	= 0,
+};
+
+struct D3DLOCKED_RECT {
+	INT		Pitch;
+	void*	pBits;
+};
+
+struct D3DSURFACE_DESC {
+	D3DFORMAT			Format;
+	D3DRESOURCETYPE		Type;
+	DWORD				Usage;
+	D3DPOOL				Pool;
+	D3DMULTISAMPLE_TYPE	MultiSampleType;
+	DWORD				MultiSampleQuality;
+	UINT				Width;
+	UINT				Height;
+};
+
+struct D3DLOCKED_BOX {
+	INT		RowPitch;
+	INT		SlicePitch;
+	void*	pBits;
+};
+
+#define MAXD3DDECLLENGTH	64
+#define D3DDECL_END()		{ 0xFF, 0, D3DDECLTYPE_UNUSED, 0, 0, 0 }
+
+struct D3DVERTEXELEMENT9 {
+	WORD	Stream;
+	WORD	Offset;
+	BYTE	Type;
+	BYTE	Method;
+	BYTE	Usage;
+	BYTE	UsageIndex;
+};
+
+struct D3DMATRIX {
+	union {
+		struct {
+			float	_11, _12, _13, _14;
+			float	_21, _22, _23, _24;
+			float	_31, _32, _33, _34;
+			float	_41, _42, _43, _44;
+		};
+		float	m[4][4];
+	};
+};
+
+struct D3DCAPS9;
+struct D3DDISPLAYMODE;
+struct D3DDISPLAYMODEEX;
+struct D3DDEVICE_CREATION_PARAMETERS;
+struct D3DPRESENT_PARAMETERS;
+struct D3DRASTER_STATUS;
+struct D3DGAMMARAMP;
+struct D3DRECT;
+struct D3DVIEWPORT9;
+struct D3DMATERIAL9;
+struct D3DLIGHT9;
+struct D3DCLIPSTATUS9;
+struct D3DRECTPATCH_INFO;
+struct D3DTRIPATCH_INFO;
+struct D3DVOLUME_DESC;
+struct D3DBOX;
+struct D3DVERTEXBUFFER_DESC;
+
+struct IDirect3D9 : public IUnknown {};
+struct IDirect3D9Ex : public IDirect3D9 {};
+struct IDirect3DDevice9;
+struct IDirect3DVolume9 : public IUnknown {};
+
+struct IDirect3DResource9 : public IUnknown {
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(SetPrivateData)(THIS_ REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags) PURE;
+	STDMETHOD(GetPrivateData)(THIS_ REFGUID refguid, void* pData, DWORD* pSizeOfData) PURE;
+	STDMETHOD(FreePrivateData)(THIS_ REFGUID refguid) PURE;
+	STDMETHOD_(DWORD, SetPriority)(THIS_ DWORD PriorityNew) PURE;
+	STDMETHOD_(DWORD, GetPriority)(THIS) PURE;
+	STDMETHOD_(void, PreLoad)(THIS) PURE;
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) PURE;
+};
+
+struct IDirect3DBaseTexture9 : public IDirect3DResource9 {
+	STDMETHOD_(DWORD, SetLOD)(THIS_ DWORD LODNew) PURE;
+	STDMETHOD_(DWORD, GetLOD)(THIS) PURE;
+	STDMETHOD_(DWORD, GetLevelCount)(THIS) PURE;
+	STDMETHOD(SetAutoGenFilterType)(THIS_ D3DTEXTUREFILTERTYPE FilterType) PURE;
+	STDMETHOD_(D3DTEXTUREFILTERTYPE, GetAutoGenFilterType)(THIS) PURE;
+	STDMETHOD_(void, GenerateMipSubLevels)(THIS) PURE;
+};
+
+struct IDirect3DSurface9 : public IDirect3DResource9 {
+	STDMETHOD(GetContainer)(THIS_ REFIID riid, void** ppContainer) PURE;
+	STDMETHOD(GetDesc)(THIS_ D3DSURFACE_DESC* pDesc) PURE;
+	STDMETHOD(LockRect)(THIS_ D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) PURE;
+	STDMETHOD(UnlockRect)(THIS) PURE;
+	STDMETHOD(GetDC)(THIS_ HDC* phdc) PURE;
+	STDMETHOD(ReleaseDC)(THIS_ HDC hdc) PURE;
+};
+
+struct IDirect3DTexture9 : public IDirect3DBaseTexture9 {
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC* pDesc) PURE;
+	STDMETHOD(GetSurfaceLevel)(THIS_ UINT Level, IDirect3DSurface9** ppSurfaceLevel) PURE;
+	STDMETHOD(LockRect)(THIS_ UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) PURE;
+	STDMETHOD(UnlockRect)(THIS_ UINT Level) PURE;
+	STDMETHOD(AddDirtyRect)(THIS_ CONST RECT* pDirtyRect) PURE;
+};
+
+struct IDirect3DVolumeTexture9 : public IDirect3DBaseTexture9 {
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DVOLUME_DESC* pDesc) PURE;
+	STDMETHOD(GetVolumeLevel)(THIS_ UINT Level, IDirect3DVolume9** ppVolumeLevel) PURE;
+	STDMETHOD(LockBox)(THIS_ UINT Level, D3DLOCKED_BOX* pLockedVolume, CONST D3DBOX* pBox, DWORD Flags) PURE;
+	STDMETHOD(UnlockBox)(THIS_ UINT Level) PURE;
+	STDMETHOD(AddDirtyBox)(THIS_ CONST D3DBOX* pDirtyBox) PURE;
+};
+
+struct IDirect3DCubeTexture9 : public IDirect3DBaseTexture9 {
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC* pDesc) PURE;
+	STDMETHOD(GetCubeMapSurface)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface9** ppCubeMapSurface) PURE;
+	STDMETHOD(LockRect)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) PURE;
+	STDMETHOD(UnlockRect)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level) PURE;
+	STDMETHOD(AddDirtyRect)(THIS_ D3DCUBEMAP_FACES FaceType, CONST RECT* pDirtyRect) PURE;
+};
+
+struct IDirect3DVertexBuffer9 : public IDirect3DResource9 {
+	STDMETHOD(Lock)(THIS_ UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) PURE;
+	STDMETHOD(Unlock)(THIS) PURE;
+	STDMETHOD(GetDesc)(THIS_ D3DVERTEXBUFFER_DESC* pDesc) PURE;
+};
+
+struct IDirect3DIndexBuffer9 : public IDirect3DResource9 {};
+struct IDirect3DSwapChain9 : public IUnknown {};
+
+struct IDirect3DVertexDeclaration9 : public IUnknown {
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(GetDeclaration)(THIS_ D3DVERTEXELEMENT9* pElement, UINT* pNumElements) PURE;
+};
+
+struct IDirect3DVertexShader9 : public IUnknown {};
+struct IDirect3DPixelShader9 : public IUnknown {};
+
+#define D3DISSUE_END			(1 << 0)
+#define D3DISSUE_BEGIN			(1 << 1)
+#define D3DGETDATA_FLUSH		(1 << 0)
+
+struct IDirect3DQuery9 : public IUnknown {
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD_(D3DQUERYTYPE, GetType)(THIS) PURE;
+	STDMETHOD_(DWORD, GetDataSize)(THIS) PURE;
+	STDMETHOD(Issue)(THIS_ DWORD dwIssueFlags) PURE;
+	STDMETHOD(GetData)(THIS_ void* pData, DWORD dwSize, DWORD dwGetDataFlags) PURE;
+};
+
+struct IDirect3DStateBlock9 : public IUnknown {
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(Capture)(THIS) PURE;
+	STDMETHOD(Apply)(THIS) PURE;
+};
+
+static const IID IID_IDirect3DStateBlock9 = { 0xB07C4FE5, 0x310D, 0x4BA8, { 0xA2, 0x3C, 0x4F, 0x0F, 0x20, 0x6F, 0x21, 0x8B } };
+static const IID IID_IDirect3DDevice9 = { 0xD0223B96, 0xBF7A, 0x43FD, { 0x92, 0xBD, 0xA4, 0x3B, 0x0D, 0x82, 0xB9, 0xEB } };
+static const IID IID_IDirect3DDevice9Ex = { 0xB18B10CE, 0x2649, 0x405A, { 0x87, 0x0F, 0x95, 0xF7, 0x77, 0xD4, 0x31, 0x3A } };
+
+struct IDirect3DDevice9 : public IUnknown {
+	STDMETHOD(TestCooperativeLevel)(THIS) PURE;
+	STDMETHOD_(UINT, GetAvailableTextureMem)(THIS) PURE;
+	STDMETHOD(EvictManagedResources)(THIS) PURE;
+	STDMETHOD(GetDirect3D)(THIS_ IDirect3D9** ppD3D9) PURE;
+	STDMETHOD(GetDeviceCaps)(THIS_ D3DCAPS9* pCaps) PURE;
+	STDMETHOD(GetDisplayMode)(THIS_ UINT iSwapChain, D3DDISPLAYMODE* pMode) PURE;
+	STDMETHOD(GetCreationParameters)(THIS_ D3DDEVICE_CREATION_PARAMETERS *pParameters) PURE;
+	STDMETHOD(SetCursorProperties)(THIS_ UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap) PURE;
+	STDMETHOD_(void, SetCursorPosition)(THIS_ int X, int Y, DWORD Flags) PURE;
+	STDMETHOD_(BOOL, ShowCursor)(THIS_ BOOL bShow) PURE;
+	STDMETHOD(CreateAdditionalSwapChain)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DSwapChain9** pSwapChain) PURE;
+	STDMETHOD(GetSwapChain)(THIS_ UINT iSwapChain, IDirect3DSwapChain9** pSwapChain) PURE;
+	STDMETHOD_(UINT, GetNumberOfSwapChains)(THIS) PURE;
+	STDMETHOD(Reset)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters) PURE;
+	STDMETHOD(Present)(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion) PURE;
+	STDMETHOD(GetBackBuffer)(THIS_ UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer) PURE;
+	STDMETHOD(GetRasterStatus)(THIS_ UINT iSwapChain, D3DRASTER_STATUS* pRasterStatus) PURE;
+	STDMETHOD(SetDialogBoxMode)(THIS_ BOOL bEnableDialogs) PURE;
+	STDMETHOD_(void, SetGammaRamp)(THIS_ UINT iSwapChain, DWORD Flags, CONST D3DGAMMARAMP* pRamp) PURE;
+	STDMETHOD_(void, GetGammaRamp)(THIS_ UINT iSwapChain, D3DGAMMARAMP* pRamp) PURE;
+	STDMETHOD(CreateTexture)(THIS_ UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateVolumeTexture)(THIS_ UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateCubeTexture)(THIS_ UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateVertexBuffer)(THIS_ UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateIndexBuffer)(THIS_ UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer9** ppIndexBuffer, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateRenderTarget)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateDepthStencilSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(UpdateSurface)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestinationSurface, CONST POINT* pDestPoint) PURE;
+	STDMETHOD(UpdateTexture)(THIS_ IDirect3DBaseTexture9* pSourceTexture, IDirect3DBaseTexture9* pDestinationTexture) PURE;
+	STDMETHOD(GetRenderTargetData)(THIS_ IDirect3DSurface9* pRenderTarget, IDirect3DSurface9* pDestSurface) PURE;
+	STDMETHOD(GetFrontBufferData)(THIS_ UINT iSwapChain, IDirect3DSurface9* pDestSurface) PURE;
+	STDMETHOD(StretchRect)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter) PURE;
+	STDMETHOD(ColorFill)(THIS_ IDirect3DSurface9* pSurface, CONST RECT* pRect, D3DCOLOR color) PURE;
+	STDMETHOD(CreateOffscreenPlainSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DPOOL Pool, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(SetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) PURE;
+	STDMETHOD(GetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) PURE;
+	STDMETHOD(SetDepthStencilSurface)(THIS_ IDirect3DSurface9* pNewZStencil) PURE;
+	STDMETHOD(GetDepthStencilSurface)(THIS_ IDirect3DSurface9** ppZStencilSurface) PURE;
+	STDMETHOD(BeginScene)(THIS) PURE;
+	STDMETHOD(EndScene)(THIS) PURE;
+	STDMETHOD(Clear)(THIS_ DWORD Count, CONST D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil) PURE;
+	STDMETHOD(SetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix) PURE;
+	STDMETHOD(GetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix) PURE;
+	STDMETHOD(MultiplyTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix) PURE;
+	STDMETHOD(SetViewport)(THIS_ CONST D3DVIEWPORT9* pViewport) PURE;
+	STDMETHOD(GetViewport)(THIS_ D3DVIEWPORT9* pViewport) PURE;
+	STDMETHOD(SetMaterial)(THIS_ CONST D3DMATERIAL9* pMaterial) PURE;
+	STDMETHOD(GetMaterial)(THIS_ D3DMATERIAL9* pMaterial) PURE;
+	STDMETHOD(SetLight)(THIS_ DWORD Index, CONST D3DLIGHT9* pLight) PURE;
+	STDMETHOD(GetLight)(THIS_ DWORD Index, D3DLIGHT9* pLight) PURE;
+	STDMETHOD(LightEnable)(THIS_ DWORD Index, BOOL Enable) PURE;
+	STDMETHOD(GetLightEnable)(THIS_ DWORD Index, BOOL* pEnable) PURE;
+	STDMETHOD(SetClipPlane)(THIS_ DWORD Index, CONST float* pPlane) PURE;
+	STDMETHOD(GetClipPlane)(THIS_ DWORD Index, float* pPlane) PURE;
+	STDMETHOD(SetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD Value) PURE;
+	STDMETHOD(GetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD* pValue) PURE;
+	STDMETHOD(CreateStateBlock)(THIS_ D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB) PURE;
+	STDMETHOD(BeginStateBlock)(THIS) PURE;
+	STDMETHOD(EndStateBlock)(THIS_ IDirect3DStateBlock9** ppSB) PURE;
+	STDMETHOD(SetClipStatus)(THIS_ CONST D3DCLIPSTATUS9* pClipStatus) PURE;
+	STDMETHOD(GetClipStatus)(THIS_ D3DCLIPSTATUS9* pClipStatus) PURE;
+	STDMETHOD(GetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9** ppTexture) PURE;
+	STDMETHOD(SetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9* pTexture) PURE;
+	STDMETHOD(GetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) PURE;
+	STDMETHOD(SetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) PURE;
+	STDMETHOD(GetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD* pValue) PURE;
+	STDMETHOD(SetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) PURE;
+	STDMETHOD(ValidateDevice)(THIS_ DWORD* pNumPasses) PURE;
+	STDMETHOD(SetPaletteEntries)(THIS_ UINT PaletteNumber, CONST PALETTEENTRY* pEntries) PURE;
+	STDMETHOD(GetPaletteEntries)(THIS_ UINT PaletteNumber, PALETTEENTRY* pEntries) PURE;
+	STDMETHOD(SetCurrentTexturePalette)(THIS_ UINT PaletteNumber) PURE;
+	STDMETHOD(GetCurrentTexturePalette)(THIS_ UINT *PaletteNumber) PURE;
+	STDMETHOD(SetScissorRect)(THIS_ CONST RECT* pRect) PURE;
+	STDMETHOD(GetScissorRect)(THIS_ RECT* pRect) PURE;
+	STDMETHOD(SetSoftwareVertexProcessing)(THIS_ BOOL bSoftware) PURE;
+	STDMETHOD_(BOOL, GetSoftwareVertexProcessing)(THIS) PURE;
+	STDMETHOD(SetNPatchMode)(THIS_ float nSegments) PURE;
+	STDMETHOD_(float, GetNPatchMode)(THIS) PURE;
+	STDMETHOD(DrawPrimitive)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) PURE;
+	STDMETHOD(DrawIndexedPrimitive)(THIS_ D3DPRIMITIVETYPE, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount) PURE;
+	STDMETHOD(DrawPrimitiveUP)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) PURE;
+	STDMETHOD(DrawIndexedPrimitiveUP)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) PURE;
+	STDMETHOD(ProcessVertices)(THIS_ UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags) PURE;
+	STDMETHOD(CreateVertexDeclaration)(THIS_ CONST D3DVERTEXELEMENT9* pVertexElements, IDirect3DVertexDeclaration9** ppDecl) PURE;
+	STDMETHOD(SetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9* pDecl) PURE;
+	STDMETHOD(GetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9** ppDecl) PURE;
+	STDMETHOD(SetFVF)(THIS_ DWORD FVF) PURE;
+	STDMETHOD(GetFVF)(THIS_ DWORD* pFVF) PURE;
+	STDMETHOD(CreateVertexShader)(THIS_ CONST DWORD* pFunction, IDirect3DVertexShader9** ppShader) PURE;
+	STDMETHOD(SetVertexShader)(THIS_ IDirect3DVertexShader9* pShader) PURE;
+	STDMETHOD(GetVertexShader)(THIS_ IDirect3DVertexShader9** ppShader) PURE;
+	STDMETHOD(SetVertexShaderConstantF)(THIS_ UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(GetVertexShaderConstantF)(THIS_ UINT StartRegister, float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(SetVertexShaderConstantI)(THIS_ UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(GetVertexShaderConstantI)(THIS_ UINT StartRegister, int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(SetVertexShaderConstantB)(THIS_ UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount) PURE;
+	STDMETHOD(GetVertexShaderConstantB)(THIS_ UINT StartRegister, BOOL* pConstantData, UINT BoolCount) PURE;
+	STDMETHOD(SetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) PURE;
+	STDMETHOD(GetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) PURE;
+	STDMETHOD(SetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT Setting) PURE;
+	STDMETHOD(GetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT* pSetting) PURE;
+	STDMETHOD(SetIndices)(THIS_ IDirect3DIndexBuffer9* pIndexData) PURE;
+	STDMETHOD(GetIndices)(THIS_ IDirect3DIndexBuffer9** ppIndexData) PURE;
+	STDMETHOD(CreatePixelShader)(THIS_ CONST DWORD* pFunction, IDirect3DPixelShader9** ppShader) PURE;
+	STDMETHOD(SetPixelShader)(THIS_ IDirect3DPixelShader9* pShader) PURE;
+	STDMETHOD(GetPixelShader)(THIS_ IDirect3DPixelShader9** ppShader) PURE;
+	STDMETHOD(SetPixelShaderConstantF)(THIS_ UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(GetPixelShaderConstantF)(THIS_ UINT StartRegister, float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(SetPixelShaderConstantI)(THIS_ UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(GetPixelShaderConstantI)(THIS_ UINT StartRegister, int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(SetPixelShaderConstantB)(THIS_ UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount) PURE;
+	STDMETHOD(GetPixelShaderConstantB)(THIS_ UINT StartRegister, BOOL* pConstantData, UINT BoolCount) PURE;
+	STDMETHOD(DrawRectPatch)(THIS_ UINT Handle, CONST float* pNumSegs, CONST D3DRECTPATCH_INFO* pRectPatchInfo) PURE;
+	STDMETHOD(DrawTriPatch)(THIS_ UINT Handle, CONST float* pNumSegs, CONST D3DTRIPATCH_INFO* pTriPatchInfo) PURE;
+	STDMETHOD(DeletePatch)(THIS_ UINT Handle) PURE;
+	STDMETHOD(CreateQuery)(THIS_ D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery) PURE;
+};
+
+struct IDirect3DDevice9Ex : public IDirect3DDevice9 {
+	STDMETHOD(SetConvolutionMonoKernel)(THIS_ UINT width, UINT height, float* rows, float* columns) PURE;
+	STDMETHOD(ComposeRects)(THIS_ IDirect3DSurface9* pSrc, IDirect3DSurface9* pDst, IDirect3DVertexBuffer9* pSrcRectDescs, UINT NumRects, IDirect3DVertexBuffer9* pDstRectDescs, D3DCOMPOSERECTSOP Operation, int Xoffset, int Yoffset) PURE;
+	STDMETHOD(PresentEx)(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags) PURE;
+	STDMETHOD(GetGPUThreadPriority)(THIS_ INT* pPriority) PURE;
+	STDMETHOD(SetGPUThreadPriority)(THIS_ INT Priority) PURE;
+	STDMETHOD(WaitForVBlank)(THIS_ UINT iSwapChain) PURE;
+	STDMETHOD(CheckResourceResidency)(THIS_ IDirect3DResource9** pResourceArray, UINT32 NumResources) PURE;
+	STDMETHOD(SetMaximumFrameLatency)(THIS_ UINT MaxLatency) PURE;
+	STDMETHOD(GetMaximumFrameLatency)(THIS_ UINT* pMaxLatency) PURE;
+	STDMETHOD(CheckDeviceState)(THIS_ HWND hDestinationWindow) PURE;
+	STDMETHOD(CreateRenderTargetEx)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle, DWORD Usage) PURE;
+	STDMETHOD(CreateOffscreenPlainSurfaceEx)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DPOOL Pool, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle, DWORD Usage) PURE;
+	STDMETHOD(CreateDepthStencilSurfaceEx)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle, DWORD Usage) PURE;
+	STDMETHOD(ResetEx)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX *pFullscreenDisplayMode) PURE;
+	STDMETHOD(GetDisplayModeEx)(THIS_ UINT iSwapChain, D3DDISPLAYMODEEX* pMode, D3DDISPLAYROTATION* pRotation) PURE;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "d3dx9math.h"
+
+/*
+* The D3DX shader and texture declarations used by the code built for the tests. The functions are only declared, the tests define
+* those the tested code calls.
+*/
+struct D3DXMACRO {
+	const char*	Name;
+	const char*	Definition;
+};
+
+typedef const char* D3DXHANDLE;
+
+#define D3DXFX_LARGEADDRESSAWARE	(1 << 17)
+
+enum D3DXPARAMETER_CLASS {
+	D3DXPC_SCALAR				= 0,
+	D3DXPC_VECTOR				= 1,
+	D3DXPC_MATRIX_ROWS			= 2,
+	D3DXPC_OBJECT				= 4,
+};
+
+enum D3DXPARAMETER_TYPE {
+	D3DXPT_FLOAT				= 3,
+	D3DXPT_SAMPLER				= 10,
+	D3DXPT_SAMPLER1D			= 11,
+	D3DXPT_SAMPLER2D			= 12,
+	D3DXPT_SAMPLER3D			= 13,
+	D3DXPT_SAMPLERCUBE			= 14,
+};
+
+struct D3DXEFFECT_DESC {
+	const char*	Creator;
+	UINT		Parameters;
+	UINT		Techniques;
+	UINT		Functions;
+};
+
+struct D3DXTECHNIQUE_DESC {
+	const char*	Name;
+	UINT		Passes;
+	UINT		Annotations;
+};
+
+struct D3DXPASS_DESC {
+	const char*	Name;
+	UINT		Annotations;
+	const DWORD* pVertexShaderFunction;
+	const DWORD* pPixelShaderFunction;
+};
+
+struct D3DXPARAMETER_DESC {
+	const char*			Name;
+	const char*			Semantic;
+	D3DXPARAMETER_CLASS	Class;
+	D3DXPARAMETER_TYPE	Type;
+	UINT				Rows;
+	UINT				Columns;
+	UINT				Elements;
+	UINT				Annotations;
+	UINT				StructMembers;
+	DWORD				Flags;
+	UINT				Bytes;
+};
+
+struct ID3DXBuffer : public IUnknown {
+	STDMETHOD_(void*, GetBufferPointer)(THIS) PURE;
+	STDMETHOD_(DWORD, GetBufferSize)(THIS) PURE;
+};
+
+struct ID3DXConstantTable;
+struct ID3DXInclude;
+struct ID3DXEffectPool;
+
+// only the methods of the effects used by the code built for the tests, in the order of the SDK
+struct ID3DXEffect : public IUnknown {
+	STDMETHOD(GetDesc)(THIS_ D3DXEFFECT_DESC* pDesc) PURE;
+	STDMETHOD(GetParameterDesc)(THIS_ D3DXHANDLE hParameter, D3DXPARAMETER_DESC* pDesc) PURE;
+	STDMETHOD(GetTechniqueDesc)(THIS_ D3DXHANDLE hTechnique, D3DXTECHNIQUE_DESC* pDesc) PURE;
+	STDMETHOD(GetPassDesc)(THIS_ D3DXHANDLE hPass, D3DXPASS_DESC* pDesc) PURE;
+	STDMETHOD_(D3DXHANDLE, GetParameter)(THIS_ D3DXHANDLE hParameter, UINT Index) PURE;
+	STDMETHOD_(D3DXHANDLE, GetTechnique)(THIS_ UINT Index) PURE;
+	STDMETHOD_(D3DXHANDLE, GetPass)(THIS_ D3DXHANDLE hTechnique, UINT Index) PURE;
+	STDMETHOD(SetVector)(THIS_ D3DXHANDLE hParameter, CONST D3DXVECTOR4* pVector) PURE;
+	STDMETHOD(SetVectorArray)(THIS_ D3DXHANDLE hParameter, CONST D3DXVECTOR4* pVector, UINT Count) PURE;
+	STDMETHOD(SetMatrix)(THIS_ D3DXHANDLE hParameter, CONST D3DXMATRIX* pMatrix) PURE;
+	STDMETHOD(SetMatrixArray)(THIS_ D3DXHANDLE hParameter, CONST D3DXMATRIX* pMatrix, UINT Count) PURE;
+	STDMETHOD(SetTechnique)(THIS_ D3DXHANDLE hTechnique) PURE;
+	STDMETHOD(Begin)(THIS_ UINT* pPasses, DWORD Flags) PURE;
+	STDMETHOD(BeginPass)(THIS_ UINT Pass) PURE;
+	STDMETHOD(EndPass)(THIS) PURE;
+	STDMETHOD(End)(THIS) PURE;
+};
+
+struct ID3DXEffectCompiler : public IUnknown {
+	STDMETHOD(CompileEffect)(THIS_ DWORD Flags, ID3DXBuffer** ppEffect, ID3DXBuffer** ppErrorMsgs) PURE;
+};
+
+enum D3DXIMAGE_FILEFORMAT {
+	D3DXIFF_JPG					= 1,
+};
+
+HRESULT WINAPI D3DXCreateTextureFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, IDirect3DTexture9** ppTexture);
+HRESULT WINAPI D3DXCreateTextureFromFileInMemory(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataSize, IDirect3DTexture9** ppTexture);
+HRESULT WINAPI D3DXCreateVolumeTextureFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, IDirect3DVolumeTexture9** ppVolumeTexture);
+HRESULT WINAPI D3DXCreateVolumeTextureFromFileInMemory(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataSize, IDirect3DVolumeTexture9** ppVolumeTexture);
+HRESULT WINAPI D3DXCreateCubeTextureFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, IDirect3DCubeTexture9** ppCubeTexture);
+HRESULT WINAPI D3DXCreateCubeTextureFromFileInMemory(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataSize, IDirect3DCubeTexture9** ppCubeTexture);
+HRESULT WINAPI D3DXCreateBuffer(DWORD NumBytes, ID3DXBuffer** ppBuffer);
+HRESULT WINAPI D3DXPreprocessShaderFromFileA(const char* pSrcFile, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, ID3DXBuffer** ppShaderText, ID3DXBuffer** ppErrorMsgs);
+HRESULT WINAPI D3DXCreateEffectCompiler(const char* pSrcData, UINT SrcDataLen, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, DWORD Flags, ID3DXEffectCompiler** ppCompiler, ID3DXBuffer** ppParseErrors);
+HRESULT WINAPI D3DXCreateEffect(IDirect3DDevice9* pDevice, const void* pSrcData, UINT SrcDataLen, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, DWORD Flags, ID3DXEffectPool* pPool, ID3DXEffect** ppEffect, ID3DXBuffer** ppCompilationErrors);
+HRESULT WINAPI D3DXCreateEffectFromFileA(IDirect3DDevice9* pDevice, const char* pSrcFile, CONST D3DXMACRO* pDefines, ID3DXInclude* pInclude, DWORD Flags, ID3DXEffectPool* pPool, ID3DXEffect** ppEffect, ID3DXBuffer** ppCompilationErrors);
+HRESULT WINAPI D3DXSaveSurfaceToFileA(const char* pDestFile, D3DXIMAGE_FILEFORMAT DestFormat, IDirect3DSurface9* pSrcSurface, const PALETTEENTRY* pSrcPalette, const RECT* pSrcRect);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "d3d9.h"
+
+/*
+* The D3DX math types and functions used by the code built for the tests, with the D3DX conventions: row vectors multiplied on the left.
+*/
+#define D3DX_PI					3.141592654f
+#define D3DXToRadian(Degree)	((Degree) * (D3DX_PI / 180.0f))
+#define D3DXToDegree(Radian)	((Radian) * (180.0f / D3DX_PI))
+
+struct D3DXVECTOR3 {
+	D3DXVECTOR3() {}
+	D3DXVECTOR3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+	D3DXVECTOR3 operator + (const D3DXVECTOR3& v) const { return D3DXVECTOR3(x + v.x, y + v.y, z + v.z); }
+	D3DXVECTOR3 operator - (const D3DXVECTOR3& v) const { return D3DXVECTOR3(x - v.x, y - v.y, z - v.z); }
+	D3DXVECTOR3 operator * (float f) const { return D3DXVECTOR3(x * f, y * f, z * f); }
+
+	float x, y, z;
+};
+
+struct D3DXVECTOR4 {
+	D3DXVECTOR4() {}
+	D3DXVECTOR4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+	D3DXVECTOR4 operator + (const D3DXVECTOR4& v) const { return D3DXVECTOR4(x + v.x, y + v.y, z + v.z, w + v.w); }
+	D3DXVECTOR4 operator - (const D3DXVECTOR4& v) const { return D3DXVECTOR4(x - v.x, y - v.y, z - v.z, w - v.w); }
+	D3DXVECTOR4 operator * (float f) const { return D3DXVECTOR4(x * f, y * f, z * f, w * f); }
+
+	float x, y, z, w;
+};
+
+struct D3DXMATRIX : public D3DMATRIX {
+	D3DXMATRIX() {}
+	D3DXMATRIX(float m11, float m12, float m13, float m14, float m21, float m22, float m23, float m24,
+			   float m31, float m32, float m33, float m34, float m41, float m42, float m43, float m44) {
+		_11 = m11; _12 = m12; _13 = m13; _14 = m14;
+		_21 = m21; _22 = m22; _23 = m23; _24 = m24;
+		_31 = m31; _32 = m32; _33 = m33; _34 = m34;
+		_41 = m41; _42 = m42; _43 = m43; _44 = m44;
+	}
+
+	float& operator () (UINT Row, UINT Column) { return m[Row][Column]; }
+	float operator () (UINT Row, UINT Column) const { return m[Row][Column]; }
+
+	D3DXMATRIX operator * (const D3DXMATRIX& Other) const {
+		D3DXMATRIX Result;
+		for (UINT r = 0; r < 4; r++) {
+			for (UINT c = 0; c < 4; c++) {
+				Result.m[r][c] = m[r][0] * Other.m[0][c] + m[r][1] * Other.m[1][c] + m[r][2] * Other.m[2][c] + m[r][3] * Other.m[3][c];
+			}
+		}
+		return Result;
+	}
+};
+
+inline D3DXVECTOR4* D3DXVec3Transform(D3DXVECTOR4* Out, const D3DXVECTOR3* V, const D3DXMATRIX* M) {
+	D3DXVECTOR4 Result(
+		V->x * M->_11 + V->y * M->_21 + V->z * M->_31 + M->_41,
+		V->x * M->_12 + V->y * M->_22 + V->z * M->_32 + M->_42,
+		V->x * M->_13 + V->y * M->_23 + V->z * M->_33 + M->_43,
+		V->x * M->_14 + V->y * M->_24 + V->z * M->_34 + M->_44);
+	*Out = Result;
+	return Out;
+}
+
+inline D3DXMATRIX* D3DXMatrixIdentity(D3DXMATRIX* Out) {
+	*Out = D3DXMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	return Out;
+}
+
+/*
+* Left handed perspective projection, mapping Near to 0 and Far to 1. Swapping the planes gives the reversed depth projection.
+*/
+inline D3DXMATRIX* D3DXMatrixPerspectiveFovLH(D3DXMATRIX* Out, float FovY, float Aspect, float Near, float Far) {
+	float h = 1.0f / tanf(FovY * 0.5f);
+	float w = h / Aspect;
+	*Out = D3DXMATRIX(w, 0.0f, 0.0f, 0.0f, 0.0f, h, 0.0f, 0.0f, 0.0f, 0.0f, Far / (Far - Near), 1.0f, 0.0f, 0.0f, -Near * Far / (Far - Near), 0.0f);
+	return Out;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+/*
+* The Win32 and COM declarations used by the code built for the tests, with the sizes of the 32 bit Windows headers where it matters.
+*/
+typedef uint8_t				BYTE;
+typedef uint16_t			WORD;
+typedef uint32_t			DWORD;
+typedef int32_t				LONG;
+typedef uint32_t			ULONG;
+typedef int32_t				HRESULT;
+typedef int					INT;
+typedef unsigned int		UINT;
+typedef uint32_t			UINT32;
+typedef uint64_t			UINT64;
+typedef int64_t				LONGLONG;
+typedef uintptr_t			UINT_PTR;
+typedef int					BOOL;
+typedef void*				HANDLE;
+typedef struct HWND__*		HWND;
+typedef struct HDC__*		HDC;
+typedef struct HINSTANCE__*	HMODULE;
+typedef int (*FARPROC)();
+
+struct EXCEPTION_POINTERS;
+typedef LONG (*LPTOP_LEVEL_EXCEPTION_FILTER)(EXCEPTION_POINTERS* ExceptionInfo);
+struct SECURITY_ATTRIBUTES;
+
+#define TRUE	1
+#define FALSE	0
+#define CONST	const
+#define WINAPI
+
+struct RECT {
+	LONG	left;
+	LONG	top;
+	LONG	right;
+	LONG	bottom;
+};
+
+struct POINT {
+	LONG	x;
+	LONG	y;
+};
+
+union LARGE_INTEGER {
+	struct {
+		DWORD	LowPart;
+		LONG	HighPart;
+	};
+	LONGLONG	QuadPart;
+};
+
+struct FILETIME {
+	DWORD	dwLowDateTime;
+	DWORD	dwHighDateTime;
+};
+
+struct WIN32_FILE_ATTRIBUTE_DATA {
+	DWORD		dwFileAttributes;
+	FILETIME	ftCreationTime;
+	FILETIME	ftLastAccessTime;
+	FILETIME	ftLastWriteTime;
+	DWORD		nFileSizeHigh;
+	DWORD		nFileSizeLow;
+};
+
+enum GET_FILEEX_INFO_LEVELS {
+	GetFileExInfoStandard,
+};
+
+struct RGNDATA;
+struct PALETTEENTRY;
+
+struct GUID {
+	uint32_t	Data1;
+	uint16_t	Data2;
+	uint16_t	Data3;
+	uint8_t		Data4[8];
+};
+typedef GUID IID;
+typedef const IID& REFIID;
+typedef const GUID& REFGUID;
+
+inline bool operator == (const GUID& a, const GUID& b) { return !memcmp(&a, &b, sizeof(GUID)); }
+
+#define EXCEPTION_CONTINUE_SEARCH	0
+#define WAIT_OBJECT_0		0
+#define WAIT_TIMEOUT		258
+#define MAX_PATH			260
+#define INFINITE			0xFFFFFFFF
+#define TIMER_ALL_ACCESS	0x1F0003
+#define INVALID_HANDLE_VALUE	((HANDLE)(intptr_t)-1)
+#define GENERIC_READ		0x80000000
+#define FILE_SHARE_READ		0x00000001
+#define OPEN_EXISTING		3
+#define FILE_ATTRIBUTE_NORMAL	0x00000080
+#define PAGE_READONLY		0x02
+#define FILE_MAP_READ		0x0004
+
+#define S_OK				((HRESULT)0)
+#define S_FALSE				((HRESULT)1)
+#define E_FAIL				((HRESULT)0x80004005)
+#define E_NOINTERFACE		((HRESULT)0x80004002)
+#define SUCCEEDED(hr)		(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)			(((HRESULT)(hr)) < 0)
+
+#define STDMETHODCALLTYPE
+#define COM_DECLSPEC_NOTHROW
+#define STDMETHOD(Method)			virtual HRESULT STDMETHODCALLTYPE Method
+#define STDMETHOD_(Type, Method)	virtual Type STDMETHODCALLTYPE Method
+#define STDMETHODIMP				HRESULT STDMETHODCALLTYPE
+#define STDMETHODIMP_(Type)			Type STDMETHODCALLTYPE
+#define PURE						= 0
+#define THIS_
+#define THIS						void
+
+// gcc has no __uuidof, every interface compared by the code gets an IID_<Interface> constant
+#define __uuidof(Interface)			IID_##Interface
+#define MIDL_INTERFACE(Guid)		struct
+#define __CRT_UUID_DECL(Interface, ...)
+
+static const IID IID_IUnknown = { 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+struct IUnknown {
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) PURE;
+	STDMETHOD_(ULONG, AddRef)(THIS) PURE;
+	STDMETHOD_(ULONG, Release)(THIS) PURE;
+};
+
+#define _TRUNCATE ((size_t)-1)
+
+inline int strncpy_s(char* Destination, size_t Size, const char* Source, size_t Count) {
+	size_t Length = min(strlen(Source), min(Count, Size - 1));
+	memcpy(Destination, Source, Length);
+	Destination[Length] = '\0';
+	return 0;
+}
+
+inline int _stricmp(const char* String1, const char* String2) {
+	return strcasecmp(String1, String2);
+}
+
+inline void YieldProcessor() {}
+
+inline DWORD GetCurrentThreadId() {
+	static std::atomic<DWORD> NextId(1);
+	thread_local DWORD Id = NextId++;
+	return Id;
+}
+
+// UInt32 is a long here but an int on Win32, the formats of the plugin are only checked by its own build
+inline int sprintf_s(char* Buffer, size_t Size, const char* Format, ...) {
+	va_list Args;
+	va_start(Args, Format);
+	int Result = vsnprintf(Buffer, Size, Format, Args);
+	va_end(Args);
+	return Result;
+}
+
+inline int fopen_s(FILE** File, const char* FileName, const char* Mode) {
+	*File = fopen(FileName, Mode);
+	return *File ? 0 : errno;
+}
+
+#define _SH_DENYWR	0x20
+
+inline FILE* _fsopen(const char* FileName, const char* Mode, int ShareFlag) {
+	return fopen(FileName, Mode);
+}
+
+inline int _snprintf_s(char* Buffer, size_t Size, size_t Count, const char* Format, ...) {
+	va_list Args;
+	va_start(Args, Format);
+	int Result = vsnprintf(Buffer, Size, Format, Args);
+	va_end(Args);
+	return Result < (int)Size ? Result : -1;
+}
+
+inline int vfprintf_s(FILE* File, const char* Format, va_list Args) {
+	return vfprintf(File, Format, Args);
+}
+
+// kernel objects and clock, defined by the tests that use them so that they can drive the threads and the time
+HANDLE	CreateEventA(SECURITY_ATTRIBUTES* Attributes, BOOL ManualReset, BOOL InitialState, const char* Name);
+BOOL	SetEvent(HANDLE Event);
+DWORD	WaitForSingleObject(HANDLE Handle, DWORD Milliseconds);
+void	Sleep(DWORD Milliseconds);
+DWORD	GetTickCount();
+BOOL	QueryPerformanceFrequency(LARGE_INTEGER* Frequency);
+BOOL	QueryPerformanceCounter(LARGE_INTEGER* PerformanceCount);
+HANDLE	CreateWaitableTimerExW(SECURITY_ATTRIBUTES* Attributes, const wchar_t* TimerName, DWORD Flags, DWORD DesiredAccess);
+BOOL	SetWaitableTimer(HANDLE Timer, const LARGE_INTEGER* DueTime, LONG Period, void* CompletionRoutine, void* ArgToCompletionRoutine, BOOL Resume);
+BOOL	CloseHandle(HANDLE Object);
+UINT	timeBeginPeriod(UINT Period);
+UINT	timeEndPeriod(UINT Period);
+LPTOP_LEVEL_EXCEPTION_FILTER SetUnhandledExceptionFilter(LPTOP_LEVEL_EXCEPTION_FILTER Filter);
+BOOL	CreateDirectoryA(const char* PathName, SECURITY_ATTRIBUTES* Attributes);
+HMODULE	LoadLibraryA(const char* FileName);
+FARPROC	GetProcAddress(HMODULE Module, const char* ProcName);
+DWORD	GetCurrentDirectoryA(DWORD BufferLength, char* Buffer);
+BOOL	GetFileAttributesExA(const char* FileName, GET_FILEEX_INFO_LEVELS InfoLevelId, void* FileInformation);
+HANDLE	CreateFileA(const char* FileName, DWORD DesiredAccess, DWORD ShareMode, SECURITY_ATTRIBUTES* Attributes, DWORD CreationDisposition, DWORD FlagsAndAttributes, HANDLE TemplateFile);
+BOOL	GetFileSizeEx(HANDLE File, LARGE_INTEGER* FileSize);
+HANDLE	CreateFileMappingA(HANDLE File, SECURITY_ATTRIBUTES* Attributes, DWORD Protect, DWORD MaximumSizeHigh, DWORD MaximumSizeLow, const char* Name);
+void*	MapViewOfFile(HANDLE FileMappingObject, DWORD DesiredAccess, DWORD FileOffsetHigh, DWORD FileOffsetLow, size_t NumberOfBytesToMap);
+BOOL	UnmapViewOfFile(const void* BaseAddress);